@@ -0,0 +1,338 @@
+#ifndef VOICEQWIK_BENCH_HARNESS_H
+#define VOICEQWIK_BENCH_HARNESS_H
+
+// Minimal microbenchmark harness for voiceqwik_bench. Every case runs a fixed
+// batch of operations per sample, so two runs do the same work and their
+// per-operation times compare directly: warmup samples are discarded, the
+// timed samples are reduced to min/percentiles/max, and the result can be
+// written as JSON and checked against an earlier run's JSON. Cases that run
+// once per audio frame can carry a CPU budget, reported as a share of it.
+// Cases marked real-time run their timed samples inside RT_SCOPE, so in a
+// VOICEQWIK_ENABLE_RT_CHECK build an allocation, lock or blocking call in
+// one fails the run.
+
+#include <utils/RealtimeCheck.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr int BENCH_JSON_SCHEMA = 1;
+constexpr int BENCH_DEFAULT_WARMUP = 5;
+constexpr int BENCH_DEFAULT_REPETITIONS = 31;
+constexpr double BENCH_DEFAULT_THRESHOLD = 0.10;   // p50 slowdown that counts as a regression
+
+#ifndef VOICEQWIK_BENCH_COMMIT
+#define VOICEQWIK_BENCH_COMMIT "unknown"
+#endif
+
+// Written by cases so the compiler cannot drop the work being timed
+inline volatile uint32_t benchSink;
+
+struct BenchCase {
+    std::string name;                        // "group/case"
+    uint32_t batch;                          // operations per timed sample
+    std::function<void(uint32_t)> run;       // runs that many operations
+    std::function<void()> afterSample;       // untimed cleanup, may be empty
+    double budgetNs;                         // per operation, 0 = none
+    bool realtime;                           // timed samples run inside RT_SCOPE
+};
+
+struct BenchResult {
+    std::string name;
+    uint32_t batch;
+    double minNs;
+    double p50Ns;
+    double p90Ns;
+    double p99Ns;
+    double maxNs;
+    double meanNs;
+    double budgetNs;
+};
+
+class BenchHarness {
+public:
+    BenchHarness()
+        : warmup(BENCH_DEFAULT_WARMUP), repetitions(BENCH_DEFAULT_REPETITIONS),
+          threshold(BENCH_DEFAULT_THRESHOLD), listOnly(false) {}
+
+    void Add(const char* name, uint32_t batch, std::function<void(uint32_t)> run,
+             std::function<void()> afterSample = nullptr) {
+        cases.push_back(BenchCase{name, batch, std::move(run), std::move(afterSample), 0.0, false});
+    }
+
+    // Per-operation CPU budget of an added case, e.g. a slice of the 10 ms frame
+    void SetBudget(const char* name, double budgetNs) {
+        for (auto& benchCase : cases) {
+            if (benchCase.name == name) benchCase.budgetNs = budgetNs;
+        }
+    }
+
+    // Marks an added case as audio-thread code; its warmup may still allocate
+    void SetRealtime(const char* name) {
+        for (auto& benchCase : cases) {
+            if (benchCase.name == name) benchCase.realtime = true;
+        }
+    }
+
+    // Returns false (after printing usage) on bad arguments
+    bool ParseArgs(int argc, char** argv) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--warmup" && hasValue) {
+                warmup = std::atoi(argv[++i]);
+            } else if (arg == "--reps" && hasValue) {
+                repetitions = std::atoi(argv[++i]);
+            } else if (arg == "--filter" && hasValue) {
+                filter = argv[++i];
+            } else if (arg == "--json" && hasValue) {
+                jsonPath = argv[++i];
+            } else if (arg == "--baseline" && hasValue) {
+                baselinePath = argv[++i];
+            } else if (arg == "--threshold" && hasValue) {
+                threshold = std::atof(argv[++i]) / 100.0;
+            } else if (arg == "--label" && hasValue) {
+                label = argv[++i];
+            } else if (arg == "--list") {
+                listOnly = true;
+            } else {
+                PrintUsage(argv[0]);
+                return false;
+            }
+        }
+        if (warmup < 0 || repetitions < 1 || threshold <= 0.0) {
+            PrintUsage(argv[0]);
+            return false;
+        }
+        return true;
+    }
+
+    // Runs the selected cases; the exit code is nonzero if a case's p99 is
+    // over its budget, a real-time case broke real-time rules, or a baseline
+    // was given and any case got slower than the threshold
+    int Run(const char* suite) {
+        if (listOnly) {
+            for (const auto& benchCase : cases) {
+                std::printf("%s\n", benchCase.name.c_str());
+            }
+            return 0;
+        }
+
+        std::printf("%s: %d warmup + %d timed samples per case, commit %s\n\n",
+                    suite, warmup, repetitions, VOICEQWIK_BENCH_COMMIT);
+        std::printf("%-32s %7s %10s %10s %10s %10s %10s\n",
+                    "case", "batch", "min ns", "p50 ns", "p90 ns", "p99 ns", "max ns");
+
+        std::vector<BenchResult> results;
+        for (const auto& benchCase : cases) {
+            if (!filter.empty() && benchCase.name.find(filter) == std::string::npos) continue;
+
+            BenchResult result = Measure(benchCase);
+            std::printf("%-32s %7u %10.1f %10.1f %10.1f %10.1f %10.1f\n",
+                        result.name.c_str(), result.batch, result.minNs, result.p50Ns,
+                        result.p90Ns, result.p99Ns, result.maxNs);
+            results.push_back(result);
+        }
+
+        bool withinBudget = ReportBudgets(results);
+        if (RealtimeCheck::GetViolationCount() > 0) {
+            std::printf("\nReal-time violations: ");
+            RealtimeCheck::PrintSummary(stdout);
+            withinBudget = false;
+        }
+        if (!jsonPath.empty() && !WriteJson(suite, results)) {
+            return 1;
+        }
+        if (!baselinePath.empty() && !CompareBaseline(results)) {
+            return 1;
+        }
+        return withinBudget ? 0 : 1;
+    }
+
+private:
+    std::vector<BenchCase> cases;
+    int warmup;
+    int repetitions;
+    double threshold;
+    bool listOnly;
+    std::string filter;
+    std::string jsonPath;
+    std::string baselinePath;
+    std::string label;
+
+    static void PrintUsage(const char* program) {
+        std::fprintf(stderr,
+                     "usage: %s [--filter substr] [--warmup n] [--reps n] [--json out.json]\n"
+                     "          [--baseline earlier.json [--threshold percent]] [--label text] [--list]\n",
+                     program);
+    }
+
+    // Nearest-rank percentile of sorted samples
+    static double Percentile(const std::vector<double>& sorted, double p) {
+        size_t rank = (size_t)(p * sorted.size() + 0.999999);
+        if (rank == 0) rank = 1;
+        return sorted[std::min(rank, sorted.size()) - 1];
+    }
+
+    BenchResult Measure(const BenchCase& benchCase) const {
+        using Clock = std::chrono::steady_clock;
+
+        std::vector<double> samples;
+        samples.reserve(repetitions);
+        for (int i = 0; i < warmup + repetitions; i++) {
+            auto start = Clock::now();
+            if (benchCase.realtime && i >= warmup) {
+                RT_SCOPE();
+                benchCase.run(benchCase.batch);
+            } else {
+                benchCase.run(benchCase.batch);
+            }
+            auto elapsed = Clock::now() - start;
+            if (benchCase.afterSample) benchCase.afterSample();
+
+            if (i >= warmup) {
+                samples.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / benchCase.batch);
+            }
+        }
+        std::sort(samples.begin(), samples.end());
+
+        double sum = 0.0;
+        for (double sample : samples) sum += sample;
+
+        return BenchResult{benchCase.name, benchCase.batch, samples.front(), Percentile(samples, 0.50),
+                           Percentile(samples, 0.90), Percentile(samples, 0.99), samples.back(),
+                           sum / samples.size(), benchCase.budgetNs};
+    }
+
+    // p50 and p99 as a share of each budgeted case's budget; false if a p99 is over
+    static bool ReportBudgets(const std::vector<BenchResult>& results) {
+        bool header = false;
+        bool withinBudget = true;
+        for (const auto& result : results) {
+            if (result.budgetNs <= 0.0) continue;
+            if (!header) {
+                std::printf("\nCPU budget:\n  %-32s %10s %8s %8s\n", "case", "budget ns", "p50", "p99");
+                header = true;
+            }
+            bool over = result.p99Ns > result.budgetNs;
+            if (over) withinBudget = false;
+            std::printf("  %-32s %10.0f %7.1f%% %7.1f%%%s\n", result.name.c_str(), result.budgetNs,
+                        result.p50Ns / result.budgetNs * 100.0, result.p99Ns / result.budgetNs * 100.0,
+                        over ? "  OVER BUDGET" : "");
+        }
+        return withinBudget;
+    }
+
+    static std::string CompilerString() {
+        char text[64];
+#if defined(_MSC_VER)
+        std::snprintf(text, sizeof(text), "msvc %d", _MSC_VER);
+#elif defined(__clang__)
+        std::snprintf(text, sizeof(text), "clang %s", __clang_version__);
+#elif defined(__GNUC__)
+        std::snprintf(text, sizeof(text), "gcc %s", __VERSION__);
+#else
+        std::snprintf(text, sizeof(text), "unknown");
+#endif
+        return text;
+    }
+
+    static std::string JsonEscape(const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            if (c == '"' || c == '\\') out += '\\';
+            if ((unsigned char)c >= 0x20) out += c;
+        }
+        return out;
+    }
+
+    // One result per line, so CompareBaseline can read it back without a JSON parser
+    bool WriteJson(const char* suite, const std::vector<BenchResult>& results) const {
+        FILE* file = std::fopen(jsonPath.c_str(), "w");
+        if (!file) {
+            std::fprintf(stderr, "Failed to open %s\n", jsonPath.c_str());
+            return false;
+        }
+
+#ifdef NDEBUG
+        const char* build = "release";
+#else
+        const char* build = "debug";
+#endif
+        std::fprintf(file, "{\n");
+        std::fprintf(file, "  \"schema\": %d,\n", BENCH_JSON_SCHEMA);
+        std::fprintf(file, "  \"suite\": \"%s\",\n", suite);
+        std::fprintf(file, "  \"commit\": \"%s\",\n", JsonEscape(VOICEQWIK_BENCH_COMMIT).c_str());
+        std::fprintf(file, "  \"label\": \"%s\",\n", JsonEscape(label).c_str());
+        std::fprintf(file, "  \"compiler\": \"%s\",\n", JsonEscape(CompilerString()).c_str());
+        std::fprintf(file, "  \"build\": \"%s\",\n", build);
+        std::fprintf(file, "  \"hardware_threads\": %u,\n", std::thread::hardware_concurrency());
+        std::fprintf(file, "  \"warmup\": %d,\n", warmup);
+        std::fprintf(file, "  \"repetitions\": %d,\n", repetitions);
+        std::fprintf(file, "  \"results\": [\n");
+        for (size_t i = 0; i < results.size(); i++) {
+            const BenchResult& r = results[i];
+            char budget[48] = "";
+            if (r.budgetNs > 0.0) std::snprintf(budget, sizeof(budget), ", \"budget_ns\": %.0f", r.budgetNs);
+            std::fprintf(file,
+                         "    {\"name\": \"%s\", \"batch\": %u, \"min_ns\": %.2f, \"p50_ns\": %.2f, "
+                         "\"p90_ns\": %.2f, \"p99_ns\": %.2f, \"max_ns\": %.2f, \"mean_ns\": %.2f%s}%s\n",
+                         r.name.c_str(), r.batch, r.minNs, r.p50Ns, r.p90Ns, r.p99Ns, r.maxNs, r.meanNs,
+                         budget, i + 1 < results.size() ? "," : "");
+        }
+        std::fprintf(file, "  ]\n}\n");
+        std::fclose(file);
+        std::printf("\nWrote %s\n", jsonPath.c_str());
+        return true;
+    }
+
+    // Compares p50 against a JSON file written by an earlier run
+    bool CompareBaseline(const std::vector<BenchResult>& results) const {
+        FILE* file = std::fopen(baselinePath.c_str(), "r");
+        if (!file) {
+            std::fprintf(stderr, "Failed to open baseline %s\n", baselinePath.c_str());
+            return false;
+        }
+
+        std::vector<std::pair<std::string, double>> baseline;
+        char line[512];
+        while (std::fgets(line, sizeof(line), file)) {
+            const char* name = std::strstr(line, "\"name\": \"");
+            const char* p50 = std::strstr(line, "\"p50_ns\": ");
+            if (!name || !p50) continue;
+            name += std::strlen("\"name\": \"");
+            const char* end = std::strchr(name, '"');
+            if (!end) continue;
+            baseline.emplace_back(std::string(name, end), std::atof(p50 + std::strlen("\"p50_ns\": ")));
+        }
+        std::fclose(file);
+
+        std::printf("\nAgainst %s (p50, regression above +%.0f%%):\n", baselinePath.c_str(), threshold * 100.0);
+        int regressions = 0;
+        for (const auto& result : results) {
+            auto it = std::find_if(baseline.begin(), baseline.end(),
+                                   [&](const std::pair<std::string, double>& entry) { return entry.first == result.name; });
+            if (it == baseline.end() || it->second <= 0.0) {
+                std::printf("  %-32s %10s\n", result.name.c_str(), "new");
+                continue;
+            }
+            double change = result.p50Ns / it->second - 1.0;
+            bool regressed = change > threshold;
+            if (regressed) regressions++;
+            std::printf("  %-32s %10.1f -> %10.1f  %+6.1f%%%s\n", result.name.c_str(), it->second,
+                        result.p50Ns, change * 100.0, regressed ? "  REGRESSION" : "");
+        }
+
+        std::printf("\n%d regression%s\n", regressions, regressions == 1 ? "" : "s");
+        return regressions == 0;
+    }
+};
+
+#endif // VOICEQWIK_BENCH_HARNESS_H
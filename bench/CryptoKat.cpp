@@ -0,0 +1,197 @@
+// Known-answer tests for the media crypto primitives, against the published
+// vectors: the ChaCha20-Poly1305 AEAD (RFC 8439 2.8.2), X25519 (RFC 7748
+// 5.2, including the 1000-iteration test, and the 6.1 key exchange) and
+// HChaCha20 (draft-irtf-cfrg-xchacha 2.2.1). Also checks that Open rejects
+// a flipped tag, ciphertext or AAD byte and leaves the data alone when it
+// does, and that key derivation under a room secret agrees between the two
+// sides only when their secrets do. Exits nonzero on any mismatch.
+//
+//   voiceqwik_crypto_kat
+
+#include <networking/MediaCrypto.h>
+
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+static std::vector<uint8_t> FromHex(const char* hex) {
+    std::vector<uint8_t> bytes;
+    auto nibble = [](char c) { return c <= '9' ? c - '0' : (c | 0x20) - 'a' + 10; };
+    for (size_t i = 0; hex[i] && hex[i + 1]; i += 2) {
+        bytes.push_back((uint8_t)(nibble(hex[i]) << 4 | nibble(hex[i + 1])));
+    }
+    return bytes;
+}
+
+static int failures = 0;
+
+static void Check(bool ok, const char* what) {
+    std::printf("  %-52s %s\n", what, ok ? "ok" : "FAIL");
+    if (!ok) failures++;
+}
+
+static bool Equal(const uint8_t* a, const std::vector<uint8_t>& b) {
+    return std::memcmp(a, b.data(), b.size()) == 0;
+}
+
+static void TestAead() {
+    std::printf("ChaCha20-Poly1305 (RFC 8439 2.8.2)\n");
+    const char* text = "Ladies and Gentlemen of the class of '99: If I could offer you only one tip for the future, "
+                       "sunscreen would be it.";
+    std::vector<uint8_t> plaintext(text, text + std::strlen(text));
+    std::vector<uint8_t> key = FromHex("808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f");
+    std::vector<uint8_t> nonce = FromHex("070000004041424344454647");
+    std::vector<uint8_t> aad = FromHex("50515253c0c1c2c3c4c5c6c7");
+    std::vector<uint8_t> ciphertext = FromHex(
+        "d31a8d34648e60db7b86afbc53ef7ec2a4aded51296e08fea9e2b5a736ee62d63dbea45e8ca9671282fafb69da92728b"
+        "1a71de0a9e060b2905d6a5b67ecd3b3692ddbd7f2d778b8c9803aee328091b58fab324e4fad675945585808b4831d7bc"
+        "3ff4def08e4b7a9de576d26586cec64b6116");
+    std::vector<uint8_t> tag = FromHex("1ae10b594f09e26a7e902ecbd0600691");
+
+    std::vector<uint8_t> data = plaintext;
+    uint8_t sealedTag[MEDIA_TAG_SIZE];
+    ChaCha20Poly1305Seal(key.data(), nonce.data(), aad.data(), aad.size(), data.data(), data.size(), sealedTag);
+    Check(data.size() == ciphertext.size() && Equal(data.data(), ciphertext), "seal: ciphertext");
+    Check(Equal(sealedTag, tag), "seal: tag");
+
+    bool opened = ChaCha20Poly1305Open(key.data(), nonce.data(), aad.data(), aad.size(), data.data(), data.size(),
+                                       tag.data());
+    Check(opened && data == plaintext, "open: plaintext");
+
+    // Each of these must fail, with the ciphertext left as it came
+    std::vector<uint8_t> badTag = tag;
+    badTag[0] ^= 1;
+    data = ciphertext;
+    opened = ChaCha20Poly1305Open(key.data(), nonce.data(), aad.data(), aad.size(), data.data(), data.size(),
+                                  badTag.data());
+    Check(!opened && data == ciphertext, "open: flipped tag bit rejected");
+
+    data = ciphertext;
+    data[data.size() - 1] ^= 0x80;
+    std::vector<uint8_t> tampered = data;
+    opened = ChaCha20Poly1305Open(key.data(), nonce.data(), aad.data(), aad.size(), data.data(), data.size(),
+                                  tag.data());
+    Check(!opened && data == tampered, "open: flipped ciphertext bit rejected");
+
+    std::vector<uint8_t> badAad = aad;
+    badAad[0] ^= 1;
+    data = ciphertext;
+    opened = ChaCha20Poly1305Open(key.data(), nonce.data(), badAad.data(), badAad.size(), data.data(), data.size(),
+                                  tag.data());
+    Check(!opened && data == ciphertext, "open: flipped AAD bit rejected");
+}
+
+static void TestX25519() {
+    std::printf("X25519 (RFC 7748 5.2, 6.1)\n");
+    struct Vector {
+        const char* scalar;
+        const char* point;
+        const char* result;
+    };
+    static const Vector VECTORS[] = {
+        {"a546e36bf0527c9d3b16154b82465edd62144c0ac1fc5a18506a2244ba449ac4",
+         "e6db6867583030db3594c1a424b15f7c726624ec26b3353b10a903a6d0ab1c4c",
+         "c3da55379de9c6908e94ea4df28d084f32eccf03491c71f754b4075577a28552"},
+        {"4b66e9d4d1b4673c5ad22691957d6af5c11b6421e0ea01d42ca4169e7918ba0d",
+         "e5210f12786811d3f4b7959d0538ae2c31dbe7106fc03c3efc4cd549c715a493",
+         "95cbde9476e8907d7aade45cb4b873f88b595a68799fa152e6f8f7647aac7957"},
+    };
+    uint8_t out[32];
+    for (size_t i = 0; i < sizeof(VECTORS) / sizeof(VECTORS[0]); i++) {
+        X25519(out, FromHex(VECTORS[i].scalar).data(), FromHex(VECTORS[i].point).data());
+        Check(Equal(out, FromHex(VECTORS[i].result)), i == 0 ? "vector 1" : "vector 2");
+    }
+
+    // k and u start at the base point; each round is k, u = X25519(k, u), k
+    uint8_t k[32] = {9};
+    uint8_t u[32] = {9};
+    for (int i = 1; i <= 1000; i++) {
+        X25519(out, k, u);
+        std::memcpy(u, k, sizeof(u));
+        std::memcpy(k, out, sizeof(k));
+        if (i == 1) {
+            Check(Equal(k, FromHex("422c8e7a6227d7bca1350b3e2bb7279f7897b87bb6854b783c60e80311ae3079")),
+                  "1 iteration");
+        }
+    }
+    Check(Equal(k, FromHex("684cf59ba83309552800ef566f2f4d3c1c3887c49360e3875f2eb94d99532c51")),
+          "1000 iterations");
+
+    std::vector<uint8_t> alicePrivate = FromHex("77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a");
+    std::vector<uint8_t> bobPrivate = FromHex("5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb");
+    std::vector<uint8_t> alicePublic = FromHex("8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a");
+    std::vector<uint8_t> bobPublic = FromHex("de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f");
+    std::vector<uint8_t> shared = FromHex("4a5d9d5ba4ce2de1728e3bf480350f25e07e21c947d19e3376f09b3c1e161742");
+    uint8_t base[32] = {9};
+    X25519(out, alicePrivate.data(), base);
+    Check(Equal(out, alicePublic), "Alice's public key");
+    X25519(out, bobPrivate.data(), base);
+    Check(Equal(out, bobPublic), "Bob's public key");
+    X25519(out, alicePrivate.data(), bobPublic.data());
+    Check(Equal(out, shared), "shared secret, Alice's side");
+    X25519(out, bobPrivate.data(), alicePublic.data());
+    Check(Equal(out, shared), "shared secret, Bob's side");
+}
+
+static void TestHChaCha20() {
+    std::printf("HChaCha20 (draft-irtf-cfrg-xchacha 2.2.1)\n");
+    std::vector<uint8_t> key = FromHex("000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f");
+    std::vector<uint8_t> input = FromHex("000000090000004a0000000031415927");
+    uint8_t out[32];
+    HChaCha20(out, key.data(), input.data());
+    Check(Equal(out, FromHex("82413b4227b27bfed30e42508a877d73a0f9e4d58a74a853c12ec41326d3ecdc")), "subkey");
+}
+
+// Host and joiner from the RFC 7748 6.1 key pairs, each under its own room secret
+static void DeriveBoth(const char* hostSecret, const char* joinerSecret, MediaKeys& host, MediaKeys& joiner) {
+    std::vector<uint8_t> hostPrivate = FromHex("77076d0a7318a57d3c16c17251b26645df4c2f87ebc0992ab177fba51db92c2a");
+    std::vector<uint8_t> joinerPrivate = FromHex("5dab087e624a8a4b79e17f8b83800ee66f3bb1292618b6fd1c2f8b27ff88e0eb");
+    std::vector<uint8_t> hostPublic = FromHex("8520f0098930a754748b7ddcb43ef75a0dbf3a0d26381af4eba4a98eaa9b4e6a");
+    std::vector<uint8_t> joinerPublic = FromHex("de9edb7d7b7dc1b4d35b61c2ece435373f8343c85b78674dadfc7e146f882b4f");
+    uint8_t hostRoom[MEDIA_ROOM_KEY_SIZE];
+    uint8_t joinerRoom[MEDIA_ROOM_KEY_SIZE];
+    if (hostSecret) DeriveRoomKey((const uint8_t*)hostSecret, std::strlen(hostSecret), hostRoom);
+    if (joinerSecret) DeriveRoomKey((const uint8_t*)joinerSecret, std::strlen(joinerSecret), joinerRoom);
+    DeriveMediaKeys(hostPrivate.data(), joinerPublic.data(), true, hostSecret ? hostRoom : nullptr, host);
+    DeriveMediaKeys(joinerPrivate.data(), hostPublic.data(), false, joinerSecret ? joinerRoom : nullptr, joiner);
+}
+
+static bool KeysMatch(const MediaKeys& host, const MediaKeys& joiner) {
+    return std::memcmp(&host.send, &joiner.receive, sizeof(MediaKey)) == 0 &&
+           std::memcmp(&host.receive, &joiner.send, sizeof(MediaKey)) == 0 &&
+           MediaKeyProofsEqual(host.proof, joiner.proof);
+}
+
+static void TestRoomSecret() {
+    std::printf("Room secret\n");
+    MediaKeys host;
+    MediaKeys joiner;
+    MediaKeys open;
+    DeriveBoth(nullptr, nullptr, open, joiner);
+    Check(KeysMatch(open, joiner), "no secret: keys and proof agree");
+
+    // 16 bytes exactly takes a whole padding block; one more byte must still count
+    DeriveBoth("0123456789abcdef", "0123456789abcdef", host, joiner);
+    Check(KeysMatch(host, joiner), "same secret: keys and proof agree");
+    Check(std::memcmp(&host.send, &open.send, sizeof(MediaKey)) != 0, "same secret: keys differ from none");
+    DeriveBoth("0123456789abcdef", "0123456789abcdeg", host, joiner);
+    Check(!MediaKeyProofsEqual(host.proof, joiner.proof), "secrets differ in the last byte: proof differs");
+    DeriveBoth("0123456789abcdef", "0123456789abcdef0", host, joiner);
+    Check(!MediaKeyProofsEqual(host.proof, joiner.proof), "one secret a prefix of the other: proof differs");
+    DeriveBoth("0123456789abcdef", nullptr, host, joiner);
+    Check(!KeysMatch(host, joiner), "secret on one side only: keys differ");
+}
+
+int main() {
+    TestAead();
+    TestX25519();
+    TestHChaCha20();
+    TestRoomSecret();
+
+    if (failures > 0) {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("PASS\n");
+    return 0;
+}
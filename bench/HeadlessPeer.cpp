@@ -0,0 +1,500 @@
+// Runs the real engine (PeerNetwork, AudioStreamer, AudioEngine, AudioMixer,
+// metrics) on a software audio device, so the whole capture -> network ->
+// render chain can be profiled, run under valgrind or sanitizers, and loaded
+// with voiceqwik_loadgen on any platform.
+//
+// Follows the application's main loop: listen, optionally join, and send and
+// mix while any peer is connected, each peer's audio as soon as its path
+// answers. Prints peers joining and leaving, each change of a peer's media
+// path as it happens, when a peer's audio stops arriving and starts again,
+// and session resumes; at the end, each peer's time to first audio.
+//
+//   voiceqwik_headless [--connect ip[:port]|[ipv6]:port] [--port n] [--participants n] [--duration s]
+//                      [--device tone|null|loopback[:ms]|wav:in.wav[,out.wav]] [--ptime ms]
+//                      [--measure-latency] [--max-mouth-to-ear ms] [--impair profile] [--seed n]
+//                      [--record call.wav] [--tap name] [--capture call.pcapng] [--aec] [--ns] [--agc]
+//                      [--rt] [--lock-memory] [--audio-cpu n] [--network-cpu n]
+//                      [--plaintext | --room-secret s]
+//
+// Exits nonzero if the call never started, or with --max-mouth-to-ear, if in
+// the last second of the call a peer had no latency samples or a median
+// mouth-to-ear delay over the limit. In a VOICEQWIK_ENABLE_RT_CHECK build it
+// also exits nonzero if an audio or receive thread broke real-time rules.
+
+#include <utils/Common.h>
+#include <utils/Logger.h>
+#include <utils/Metrics.h>
+#include <utils/RealtimeCheck.h>
+#include <utils/ThreadRuntime.h>
+#include <audio/AudioEngine.h>
+#include <audio/AudioMixer.h>
+#include <audio/AudioTap.h>
+#include <audio/CallRecorder.h>
+#include <networking/AudioStreamer.h>
+#include <networking/LatencyProbe.h>
+#include <networking/PeerNetwork.h>
+#include <platform/Timer.h>
+
+#include <algorithm>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+
+constexpr int HEADLESS_STATS_INTERVAL_MS = 5000;
+constexpr int HEADLESS_LATENCY_SNAPSHOT_MS = 1000;   // peers' metrics go when they leave, so keep the last view
+constexpr int HEADLESS_LOOP_MS = 1;
+constexpr int HEADLESS_AUDIO_GAP_MS = 200;   // no packets from a peer for this long: its audio stopped
+
+struct HeadlessOptions {
+    std::string connectAddress;   // empty = host only
+    uint16_t connectPort = DEFAULT_AUDIO_PORT;
+    uint16_t port = DEFAULT_AUDIO_PORT;
+    int participants = MIN_PARTICIPANTS;
+    double durationSeconds = 0.0;  // 0 = until interrupted
+    std::string device = "tone";
+    PacketTime ptime = DEFAULT_PACKET_TIME;
+    bool measureLatency = false;
+    double maxMouthToEarMs = 0.0;  // 0 = no check
+    std::string impairProfile;
+    uint64_t seed = 1;
+    std::string recordFile;
+    std::string tapName;
+    std::string captureFile;
+    bool echoCancellation = false;
+    bool noiseSuppression = false;
+    bool automaticGain = false;
+    bool realtime = false;          // off by default: shared test machines
+    bool lockMemory = false;        // only while a call is up
+    int audioCpu = THREAD_CPU_ANY;
+    int networkCpu = THREAD_CPU_ANY;
+    bool mediaEncryption = true;    // --plaintext turns it off, e.g. to compare the cost
+    std::string roomSecret;         // binds the media keys; all peers need the same one
+};
+
+static std::atomic<bool> stopRequested{false};
+
+static void OnSignal(int) {
+    stopRequested = true;
+}
+
+static bool ParseOptions(int argc, char** argv, HeadlessOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--connect" && hasValue) {
+            if (!ParseHostPort(argv[++i], options.connectAddress, options.connectPort)) return false;
+        } else if (arg == "--port" && hasValue) {
+            options.port = (uint16_t)std::atoi(argv[++i]);
+        } else if (arg == "--participants" && hasValue) {
+            options.participants = std::atoi(argv[++i]);
+        } else if (arg == "--duration" && hasValue) {
+            options.durationSeconds = std::atof(argv[++i]);
+        } else if (arg == "--device" && hasValue) {
+            options.device = argv[++i];
+        } else if (arg == "--ptime" && hasValue) {
+            double ms = std::atof(argv[++i]);
+            bool found = false;
+            for (PacketTime ptime : ALL_PACKET_TIMES) {
+                if (std::fabs(PacketTimeMicros(ptime) / 1000.0 - ms) < 0.01) {
+                    options.ptime = ptime;
+                    found = true;
+                }
+            }
+            if (!found) return false;
+        } else if (arg == "--measure-latency") {
+            options.measureLatency = true;
+        } else if (arg == "--max-mouth-to-ear" && hasValue) {
+            options.maxMouthToEarMs = std::atof(argv[++i]);
+            options.measureLatency = true;
+        } else if (arg == "--impair" && hasValue) {
+            options.impairProfile = argv[++i];
+        } else if (arg == "--record" && hasValue) {
+            options.recordFile = argv[++i];
+        } else if (arg == "--tap" && hasValue) {
+            options.tapName = argv[++i];
+        } else if (arg == "--capture" && hasValue) {
+            options.captureFile = argv[++i];
+        } else if (arg == "--aec") {
+            options.echoCancellation = true;
+        } else if (arg == "--ns") {
+            options.noiseSuppression = true;
+        } else if (arg == "--agc") {
+            options.automaticGain = true;
+        } else if (arg == "--rt") {
+            options.realtime = true;
+        } else if (arg == "--lock-memory") {
+            options.lockMemory = true;
+        } else if (arg == "--audio-cpu" && hasValue) {
+            options.audioCpu = std::atoi(argv[++i]);
+        } else if (arg == "--network-cpu" && hasValue) {
+            options.networkCpu = std::atoi(argv[++i]);
+        } else if (arg == "--plaintext") {
+            options.mediaEncryption = false;
+        } else if (arg == "--room-secret" && hasValue) {
+            options.roomSecret = argv[++i];
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else {
+            return false;
+        }
+    }
+    return options.participants >= MIN_PARTICIPANTS && options.participants <= MAX_PARTICIPANTS &&
+           (options.roomSecret.empty() || options.mediaEncryption) &&
+           options.durationSeconds >= 0.0 && options.port != 0;
+}
+
+static double MedianMillis(const MetricHistogram& histogram, bool& valid) {
+    HistogramSnapshot snapshot;
+    histogram.Snapshot(snapshot);
+    valid = valid && snapshot.count > 0;
+    return snapshot.ValueAtPercentile(50.0) / 1000.0;
+}
+
+// Same sum as the latency report: capture + network + jitter buffer + render.
+// Failures are appended to `failures`, one line each.
+static bool CheckMouthToEar(const std::vector<PeerInfo>& peers, double maxMs, std::string& failures) {
+    MetricsRegistry& metrics = MetricsRegistry::GetInstance();
+    bool renderValid = true;
+    double render = MedianMillis(metrics.renderDelayMicros, renderValid);
+
+    bool passed = true;
+    char line[128];
+    for (const auto& peer : peers) {
+        const PeerMetrics* peerMetrics = metrics.FindPeer(peer.id);
+        bool valid = renderValid && peerMetrics != nullptr;
+        double total = render;
+        if (peerMetrics) {
+            total += MedianMillis(peerMetrics->captureDelayMicros, valid);
+            total += MedianMillis(peerMetrics->networkDelayMicros, valid);
+            total += MedianMillis(peerMetrics->jitterBufferDelayMicros, valid);
+        }
+        if (!valid) {
+            std::snprintf(line, sizeof(line), "FAIL peer %u: no latency samples\n", peer.id);
+            failures += line;
+            passed = false;
+        } else if (total > maxMs) {
+            std::snprintf(line, sizeof(line), "FAIL peer %u: mouth-to-ear %.1f ms over the %.1f ms limit\n",
+                          peer.id, total, maxMs);
+            failures += line;
+            passed = false;
+        }
+    }
+    return passed;
+}
+
+int main(int argc, char** argv) {
+    HeadlessOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: %s [--connect ip[:port]|[ipv6]:port] [--port n] [--participants %d-%d] [--duration s]\n"
+                     "          [--device tone|null|loopback[:ms]|wav:in.wav[,out.wav]] [--ptime 2.5|5|10|20|40]\n"
+                     "          [--measure-latency] [--max-mouth-to-ear ms] [--impair profile] [--seed n]\n"
+                     "          [--record call.wav] [--tap name] [--capture call.pcapng] [--aec] [--ns] [--agc]\n"
+                     "          [--rt] [--lock-memory] [--audio-cpu n] [--network-cpu n]\n"
+                     "          [--plaintext | --room-secret s]\n",
+                     argv[0], MIN_PARTICIPANTS, MAX_PARTICIPANTS);
+        return 2;
+    }
+
+    std::signal(SIGINT, OnSignal);
+    std::signal(SIGTERM, OnSignal);
+
+    std::string logFile = "voiceqwik_headless_" + std::to_string(options.port) + ".log";
+    Logger::GetInstance().SetLogFile(logFile);
+    Logger::GetInstance().SetConsoleOutput(false);
+
+    // Before any thread starts: threads pick up the config as they register
+    ThreadRuntimeConfig threadConfig;
+    threadConfig.realtime = options.realtime;
+    threadConfig.lockMemory = options.lockMemory;
+    threadConfig.audioCpu = options.audioCpu;
+    threadConfig.networkCpu = options.networkCpu;
+    ThreadRuntime::GetInstance().Configure(threadConfig);
+
+    std::unique_ptr<AudioDevice> device = CreateSoftwareAudioDevice(options.device);
+    if (!device) {
+        std::fprintf(stderr, "Unknown audio device: %s\n", options.device.c_str());
+        return 2;
+    }
+
+    AudioEngine& engine = AudioEngine::GetInstance();
+    PeerNetwork& network = PeerNetwork::GetInstance();
+    AudioStreamer& streamer = AudioStreamer::GetInstance();
+    // Opens the device at a period no longer than the packet
+    engine.SetPacketTime(options.ptime);
+    if (!engine.Initialize(std::move(device)) || !network.Initialize(MAX_PARTICIPANTS) ||
+        !streamer.Initialize(options.port)) {
+        std::fprintf(stderr, "Failed to initialize (see %s)\n", logFile.c_str());
+        return 1;
+    }
+    network.SetExpectedParticipants(options.participants);
+    network.SetPreferredPacketTime(options.ptime);
+    network.SetLocalAudioPort(options.port);
+    network.SetMediaEncryption(options.mediaEncryption);
+    network.SetRoomSecret(options.roomSecret);
+    if (options.measureLatency) {
+        streamer.SetLatencyMeasurement(true);
+        engine.SetLatencyMarkers(true);
+    }
+    engine.SetEchoCancellation(options.echoCancellation);
+    engine.SetNoiseSuppression(options.noiseSuppression);
+    engine.SetAutomaticGain(options.automaticGain);
+
+    if (!options.impairProfile.empty()) {
+        const ImpairmentProfile* profile = FindImpairmentProfile(options.impairProfile);
+        if (!profile) {
+            std::fprintf(stderr, "Unknown impairment profile: %s\n", options.impairProfile.c_str());
+            return 2;
+        }
+        streamer.SetImpairment(profile, options.seed);
+    }
+
+    if (!engine.StartCapture() || !engine.StartPlayback()) {
+        std::fprintf(stderr, "Failed to start audio device %s\n", options.device.c_str());
+        return 1;
+    }
+    if (!network.StartListening(options.port)) {
+        std::fprintf(stderr, "Failed to listen on port %u\n", options.port);
+        return 1;
+    }
+    if (!options.connectAddress.empty() && !network.ConnectToPeer(options.connectAddress, options.connectPort)) {
+        std::fprintf(stderr, "Failed to connect to %s\n",
+                     FormatHostPort(options.connectAddress, options.connectPort).c_str());
+        return 1;
+    }
+
+    const char* media = ", room secret";
+    if (!options.mediaEncryption) {
+        media = ", plaintext media";
+    } else if (options.roomSecret.empty()) {
+        media = ", media unauthenticated (no room secret)";
+    }
+    std::printf("VoiceQwik headless peer: port %u, %d participants, %s device, %s preferred%s%s\n", options.port,
+                options.participants, options.device.c_str(), PacketTimeToString(options.ptime),
+                options.measureLatency ? ", latency measurement" : "", media);
+    std::fflush(stdout);
+
+    CallRecorder& recorder = CallRecorder::GetInstance();
+    if (!options.recordFile.empty() && !recorder.Start(options.recordFile)) {
+        std::fprintf(stderr, "Failed to record to %s\n", options.recordFile.c_str());
+        return 1;
+    }
+    AudioTap& tap = AudioTap::GetInstance();
+    if (!options.tapName.empty() && !tap.Start(options.tapName)) {
+        std::fprintf(stderr, "Failed to start audio tap %s\n", options.tapName.c_str());
+        return 1;
+    }
+    if (!options.captureFile.empty() && !streamer.StartPacketCapture(options.captureFile)) {
+        std::fprintf(stderr, "Failed to capture to %s\n", options.captureFile.c_str());
+        return 1;
+    }
+
+    AcquireTimerResolution();
+
+    AudioMixer mixer;
+    mixer.SetLoudnessNormalization(options.automaticGain);
+    AudioBuffer captured;
+    AudioBuffer received;
+    AudioBuffer mixed;
+    received.reserve(MAX_SAMPLES_PER_PACKET);   // the mix loop does not allocate
+    mixed.reserve(MAX_SAMPLES_PER_PACKET);
+    uint64_t mixedPackets = 0;
+    bool callStarted = false;
+    // What was last printed about each peer
+    struct PeerWatch {
+        SocketAddress path;
+        uint64_t packetsReceived = 0;
+        int64_t lastArrivalMicros = 0;
+        bool audioFlowing = false;
+        uint32_t sessionEpoch = 0;
+    };
+    std::map<PeerID, PeerWatch> watches;
+    std::string latencyReport;
+    std::string latencyFailures = "FAIL: no latency snapshot taken during the call\n";
+
+    const int64_t startMicros = LatencyClockMicros();
+    int64_t nextStats = startMicros + HEADLESS_STATS_INTERVAL_MS * 1000ll;
+    int64_t nextLatencySnapshot = startMicros + HEADLESS_LATENCY_SNAPSHOT_MS * 1000ll;
+    while (!stopRequested) {
+        int64_t now = LatencyClockMicros();
+        if (options.durationSeconds > 0.0 && now - startMicros >= (int64_t)(options.durationSeconds * 1e6)) break;
+
+        // Frame capture at whatever packet time the handshake settled on
+        engine.SetPacketTime(network.GetSessionPacketTime());
+
+        if (network.GetConnectedPeersCount() > 0) {
+            if (!callStarted) ThreadRuntime::GetInstance().BeginCall();
+            callStarted = true;
+
+            int64_t captureMicros = 0;
+            size_t capturedPackets = 0;
+            while (engine.GetCaptureBuffer(captured, captureMicros)) {
+                streamer.SendAudioToPeers(captured, captureMicros);
+                tap.PublishCapture(captured, captureMicros);
+                capturedPackets++;
+            }
+
+            // Paced like the app: one mix per captured packet, more for a backlog
+            PeerList peers = network.GetPeers();
+            for (size_t mixes = 0; mixes < capturedPackets || streamer.HasPlayoutBacklog(); mixes++) {
+                RT_SCOPE();
+                MetricStageTimer stageTimer(MetricStage::Mix);
+                mixer.Begin();
+                for (const auto& peer : *peers) {
+                    if (streamer.ReceiveAudioFromPeer(peer.id, received)) {
+                        mixer.AddSource(peer.id, received);
+                        recorder.RecordSource(peer.id, received);
+                        tap.PublishSource(peer.id, received);
+                    }
+                }
+                if (!mixer.Finish(mixed)) break;
+                recorder.RecordMix(mixed);
+                tap.PublishMix(mixed);
+                engine.QueuePlaybackBuffer(mixed);
+                mixedPackets++;
+            }
+
+            if (options.measureLatency && now >= nextLatencySnapshot) {
+                nextLatencySnapshot = now + HEADLESS_LATENCY_SNAPSHOT_MS * 1000ll;
+                latencyReport = MetricsRegistry::GetInstance().FormatLatencyReport();
+                latencyFailures.clear();
+                if (options.maxMouthToEarMs > 0.0) {
+                    CheckMouthToEar(*peers, options.maxMouthToEarMs, latencyFailures);
+                }
+            }
+        } else {
+            engine.DiscardCapture();
+        }
+
+        double seconds = (now - startMicros) / 1e6;
+        PeerList currentPeers = network.GetPeers();
+        for (auto it = watches.begin(); it != watches.end();) {
+            PeerID id = it->first;
+            bool present = std::any_of(currentPeers->begin(), currentPeers->end(),
+                                       [id](const PeerInfo& peer) { return peer.id == id; });
+            if (present) {
+                ++it;
+                continue;
+            }
+            std::printf("%6.1f s: peer %u left\n", seconds, id);
+            it = watches.erase(it);
+        }
+        for (const auto& peer : *currentPeers) {
+            bool known = watches.count(peer.id) > 0;
+            PeerWatch& watch = watches[peer.id];
+            if (!known) std::printf("%6.1f s: peer %u joined\n", seconds, peer.id);
+
+            SocketAddress path = streamer.GetPeerAudioAddress(peer);
+            if (!known || !(watch.path == path)) {
+                watch.path = path;
+                std::printf("%6.1f s: peer %u media path %s\n", seconds, peer.id,
+                            FormatHostPort(path.ToString(), path.Port()).c_str());
+            }
+            if (peer.sessionEpoch != watch.sessionEpoch) {
+                watch.sessionEpoch = peer.sessionEpoch;
+                std::printf("%6.1f s: peer %u session resumed\n", seconds, peer.id);
+            }
+
+            const PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(peer.id);
+            uint64_t packets = metrics ? metrics->packetsReceived.Get() : 0;
+            if (packets != watch.packetsReceived) {
+                watch.packetsReceived = packets;
+                watch.lastArrivalMicros = now;
+                if (!watch.audioFlowing) std::printf("%6.1f s: peer %u audio flowing\n", seconds, peer.id);
+                watch.audioFlowing = true;
+            } else if (watch.audioFlowing && now - watch.lastArrivalMicros > HEADLESS_AUDIO_GAP_MS * 1000ll) {
+                watch.audioFlowing = false;
+                std::printf("%6.1f s: peer %u audio stopped\n", seconds, peer.id);
+            }
+            std::fflush(stdout);
+        }
+
+        if (now >= nextStats) {
+            nextStats += HEADLESS_STATS_INTERVAL_MS * 1000ll;
+            std::printf("%6.1f s: %d peers, %llu packets mixed | %s\n", (now - startMicros) / 1e6,
+                        network.GetConnectedPeersCount(), (unsigned long long)mixedPackets,
+                        MetricsRegistry::GetInstance().FormatStatsLine().c_str());
+            std::fflush(stdout);
+        }
+
+        SleepMillis(HEADLESS_LOOP_MS);
+    }
+
+    ReleaseTimerResolution();
+
+    int exitCode = 0;
+    if (!callStarted) {
+        std::printf("FAIL: the call never started (%d of %d participants connected)\n",
+                    network.GetConnectedPeersCount() + 1, options.participants);
+        exitCode = 1;
+    } else if (options.measureLatency) {
+        std::printf("%s", latencyReport.c_str());
+        if (options.maxMouthToEarMs > 0.0 && !latencyFailures.empty()) {
+            std::printf("%s", latencyFailures.c_str());
+            exitCode = 1;
+        }
+    }
+    PeerList finalPeers = network.GetPeers();
+    for (const auto& peer : *finalPeers) {
+        const PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(peer.id);
+        if (metrics && metrics->firstAudioMicros.Get() > 0) {
+            std::printf("first audio: peer %u after %.1f ms\n", peer.id, metrics->firstAudioMicros.Get() / 1000.0);
+        }
+        if (!metrics || metrics->sessionResumes.Get() == 0) continue;
+        HistogramSnapshot toAudio;
+        metrics->resumeTimeToAudioMicros.Snapshot(toAudio);
+        std::printf("session: peer %u resumed %llu time(s), audio back after %.1f ms median, %.1f ms max\n",
+                    peer.id, (unsigned long long)metrics->sessionResumes.Get(),
+                    toAudio.ValueAtPercentile(50) / 1000.0, toAudio.max / 1000.0);
+    }
+    if (recorder.IsRecording()) {
+        std::printf("recording: %llu packets dropped\n", (unsigned long long)recorder.GetDroppedPackets());
+        recorder.Stop();
+    }
+    if (tap.IsRunning()) {
+        std::printf("tap: %llu packets published\n", (unsigned long long)tap.GetPublished());
+        tap.Stop();
+    }
+    if (streamer.GetPacketCapture().IsOpen()) {
+        const PacketCapture& capture = streamer.GetPacketCapture();
+        std::printf("capture: %llu datagrams, %llu dropped\n", (unsigned long long)capture.GetCapturedCount(),
+                    (unsigned long long)capture.GetDroppedCount());
+    }
+    if (engine.GetEchoCancellation()) {
+        const EchoCanceller& canceller = engine.GetEchoCanceller();
+        std::printf("echo cancellation: ERLE %.1f dB, delay %.1f ms, %llu reference blocks dropped\n",
+                    canceller.GetErleDb(), canceller.GetDelayMicros() / 1000.0,
+                    (unsigned long long)canceller.GetDroppedReferenceBlocks());
+    }
+    if (engine.GetAutomaticGain()) {
+        std::printf("gain: capture %+.1f dB", engine.GetCaptureGainDb());
+        for (const auto& peer : *finalPeers) {
+            float gainDb = 0.0f;
+            if (mixer.GetSourceGainDb(peer.id, gainDb)) std::printf(", peer %u %+.1f dB", peer.id, gainDb);
+        }
+        std::printf("\n");
+    }
+    if (engine.GetNoiseSuppression()) {
+        std::printf("noise suppression: noise floor %.1f dBFS\n", engine.GetNoiseSuppressor().GetNoiseLevelDb());
+    }
+    ThreadRuntime::GetInstance().PublishSchedulingStats();
+    std::printf("scheduling%s:\n%s", MetricsRegistry::GetInstance().memoryLocked.Get() ? " (memory locked)" : "",
+                ThreadRuntime::GetInstance().FormatSchedulingReport().c_str());
+    if (RealtimeCheck::GetViolationCount() > 0) {
+        // Only an RT-check build counts these; any at all fails the run
+        std::printf("real-time violations: ");
+        RealtimeCheck::PrintSummary(stdout);
+        exitCode = 1;
+    }
+    std::fflush(stdout);
+
+    engine.Shutdown();
+    network.Shutdown();
+    streamer.Shutdown();
+    ThreadRuntime::GetInstance().EndCall();
+    Logger::GetInstance().Flush();
+    return exitCode;
+}
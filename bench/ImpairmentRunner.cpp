@@ -0,0 +1,343 @@
+// Runs a VoiceQwik RTP stream through each canned impairment profile and
+// reports what the listener would get: loss before and after redundancy,
+// packets too late for a fixed playout delay, one-way delay percentiles,
+// RFC 3550 jitter, and an ITU-T G.107 E-model R factor and MOS.
+//
+// Virtual time, so a minute of audio takes milliseconds and every run with
+// the same seed is identical. Each profile is run twice and compared to make
+// sure of that; a mismatch exits nonzero.
+//
+//   voiceqwik_impairment_runner [--profile name] [--seed n] [--duration s]
+//                               [--playout-ms n] [--red n]
+
+#include <audio/PayloadCodec.h>
+#include <networking/LatencyProbe.h>
+#include <networking/NetworkImpairment.h>
+#include <networking/RedundantPayload.h>
+#include <networking/RtpPacket.h>
+#include <networking/RtpSourceStats.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+constexpr PacketTime RUNNER_PTIME = DEFAULT_PACKET_TIME;
+constexpr uint32_t RUNNER_SAMPLES = SamplesPerPacket(RUNNER_PTIME);
+constexpr int64_t RUNNER_PTIME_MICROS = PacketTimeMicros(RUNNER_PTIME);
+constexpr uint32_t RUNNER_SSRC = 0x51A7E;
+constexpr double RUNNER_MAX_DURATION_S = 600.0;   // stays inside one 16-bit sequence cycle
+
+// E-model (ITU-T G.107) for PCM16 / G.711 without packet loss concealment
+constexpr double EMODEL_R0 = 93.2;
+constexpr double EMODEL_IE = 0.0;
+constexpr double EMODEL_BPL = 4.3;
+
+struct RunnerOptions {
+    std::string profile;          // empty = all
+    uint64_t seed = 1;
+    double durationSeconds = 60.0;
+    double playoutMs = 60.0;      // fixed delay from send to playout
+    int redundancy = -1;          // -1 = run 0 and 1
+};
+
+struct RunResult {
+    uint64_t sent = 0;
+    uint64_t arrived = 0;         // primary copy arrived at all
+    uint64_t recovered = 0;       // playable only thanks to a redundant copy
+    uint64_t late = 0;            // arrived, but after its playout time
+    uint64_t effectiveLost = 0;   // nothing playable at playout time
+    uint64_t reordered = 0;
+    uint64_t duplicates = 0;
+    double meanBurst = 0.0;
+    double burstRatio = 1.0;
+    double delayP50Ms = 0.0;
+    double delayP95Ms = 0.0;
+    double delayP99Ms = 0.0;
+    double jitterMs = 0.0;
+    double rFactor = 0.0;
+    double mos = 0.0;
+    uint64_t digest = 0;          // FNV-1a over every delivery, for the determinism check
+    ImpairmentStats link;
+};
+
+static void Digest(uint64_t& digest, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        digest ^= (value >> (8 * i)) & 0xFF;
+        digest *= 0x100000001B3ull;
+    }
+}
+
+static double Percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, (size_t)(p * (values.size() - 1)));
+    return values[index];
+}
+
+static double MosFromR(double r) {
+    if (r <= 0.0) return 1.0;
+    if (r >= 100.0) return 4.5;
+    return std::max(1.0, 1.0 + 0.035 * r + r * (r - 60.0) * (100.0 - r) * 7e-6);
+}
+
+// Speech-band test signal; content does not affect the link, only sizes do
+static void FillSignal(int16_t* samples, uint64_t packetIndex) {
+    for (uint32_t i = 0; i < RUNNER_SAMPLES; i++) {
+        double t = (double)(packetIndex * RUNNER_SAMPLES + i) / AUDIO_SAMPLE_RATE;
+        samples[i] = (int16_t)(6000.0 * std::sin(2.0 * 3.14159265358979323846 * 440.0 * t));
+    }
+}
+
+static RunResult RunProfile(const ImpairmentProfile& profile, const RunnerOptions& options, int redundancy) {
+    NetworkImpairment link(profile, options.seed);
+    RtpSourceStats sourceStats;
+    RunResult result{};
+    result.digest = 0xCBF29CE484222325ull;
+
+    const uint64_t packetCount = (uint64_t)(options.durationSeconds * 1000000.0 / RUNNER_PTIME_MICROS);
+    const int64_t playoutMicros = (int64_t)(options.playoutMs * 1000.0);
+
+    std::vector<int64_t> primaryArrival(packetCount, -1);
+    std::vector<int64_t> redundantArrival(packetCount, -1);
+    std::vector<double> delaysMs;
+    delaysMs.reserve(packetCount);
+
+    std::array<int16_t, RUNNER_SAMPLES> samples{};
+    std::array<uint8_t, MAX_RTP_PAYLOAD_SIZE> encoded{};
+    std::array<std::array<uint8_t, MAX_RTP_PAYLOAD_SIZE>, RED_MAX_REDUNDANCY> history{};
+    std::array<size_t, RED_MAX_REDUNDANCY> historySize{};
+    std::array<uint8_t, MAX_RTP_PACKET_SIZE> packet{};
+    std::array<int16_t, MAX_SAMPLES_PER_PACKET> decoded{};
+
+    uint64_t nextSend = 0;
+    uint32_t highestExtended = 0;
+    bool anyArrival = false;
+
+    while (nextSend < packetCount || link.GetNextDeliveryMicros() != INT64_MAX) {
+        int64_t sendMicros = nextSend < packetCount ? (int64_t)nextSend * RUNNER_PTIME_MICROS : INT64_MAX;
+        int64_t now = std::min(sendMicros, link.GetNextDeliveryMicros());
+
+        if (now == sendMicros) {
+            FillSignal(samples.data(), nextSend);
+            size_t encodedSize = EncodePayload(PayloadEncoding::Pcm16, samples.data(), RUNNER_SAMPLES, encoded.data());
+
+            RTPHeader header{false, RTP_PAYLOAD_TYPE_PCM16, (uint16_t)nextSend,
+                             (uint32_t)(nextSend * RUNNER_SAMPLES), RUNNER_SSRC};
+            size_t headerSize = RTP_HEADER_SIZE + LATENCY_EXTENSION_SIZE;
+            size_t payloadSize = 0;
+
+            size_t usable = std::min<size_t>((size_t)redundancy, (size_t)nextSend);
+            if (usable > 0) {
+                RedundantBlock blocks[RED_MAX_REDUNDANCY + 1];
+                size_t count = 0;
+                for (size_t i = usable; i-- > 0;) {
+                    blocks[count++] = RedundantBlock{RTP_PAYLOAD_TYPE_PCM16, (uint32_t)((i + 1) * RUNNER_SAMPLES),
+                                                     history[i].data(), historySize[i]};
+                }
+                blocks[count++] = RedundantBlock{RTP_PAYLOAD_TYPE_PCM16, 0, encoded.data(), encodedSize};
+                payloadSize = WriteRedundantPayload(packet.data() + headerSize, packet.size() - headerSize,
+                                                    blocks, count);
+                if (payloadSize > 0) header.payloadType = RTP_PAYLOAD_TYPE_RED;
+            }
+            if (payloadSize == 0) {
+                std::memcpy(packet.data() + headerSize, encoded.data(), encodedSize);
+                payloadSize = encodedSize;
+            }
+
+            WriteRTPHeader(packet.data(), header, true);
+            WriteLatencyExtension(packet.data() + RTP_HEADER_SIZE, LatencyTimestamps{(uint32_t)now, (uint32_t)now});
+
+            for (size_t i = RED_MAX_REDUNDANCY - 1; i > 0; i--) {
+                history[i] = history[i - 1];
+                historySize[i] = historySize[i - 1];
+            }
+            std::memcpy(history[0].data(), encoded.data(), encodedSize);
+            historySize[0] = encodedSize;
+
+            link.Submit(now, packet.data(), headerSize + payloadSize, 0);
+            result.sent++;
+            nextSend++;
+            continue;
+        }
+
+        ImpairedDatagram datagram;
+        while (link.Poll(now, datagram)) {
+            Digest(result.digest, (uint64_t)now);
+            Digest(result.digest, datagram.data.size());
+
+            RTPHeader header{};
+            size_t headerSize = 0;
+            size_t payloadSize = 0;
+            LatencyTimestamps stamps{};
+            if (!ParseRTPHeader(datagram.data.data(), datagram.data.size(), header, headerSize, payloadSize) ||
+                !ParseLatencyExtension(datagram.data.data(), headerSize, stamps)) {
+                continue;
+            }
+
+            uint32_t arrivalRtp = (uint32_t)((uint64_t)now * AUDIO_SAMPLE_RATE / 1000000);
+            RtpSourceStats::Arrival arrival = sourceStats.Update(header.sequence, header.timestamp, arrivalRtp);
+            if (arrival == RtpSourceStats::Arrival::Duplicate) result.duplicates++;
+            if (arrival == RtpSourceStats::Arrival::Reordered) result.reordered++;
+
+            // Unwrap against the highest sequence seen so far
+            uint32_t extended = anyArrival ? highestExtended + (int16_t)(header.sequence - (uint16_t)highestExtended)
+                                           : header.sequence;
+            if (!anyArrival || (int32_t)(extended - highestExtended) > 0) highestExtended = extended;
+            anyArrival = true;
+            if (extended >= packetCount) continue;
+
+            if (primaryArrival[extended] < 0) {
+                primaryArrival[extended] = now;
+                result.arrived++;
+                delaysMs.push_back((now - (int64_t)stamps.sendMicros) / 1000.0);
+            }
+
+            if (header.payloadType != RTP_PAYLOAD_TYPE_RED) continue;
+            RedundantBlock blocks[RED_MAX_REDUNDANCY + 1];
+            size_t count = ParseRedundantPayload(datagram.data.data() + headerSize, payloadSize,
+                                                 blocks, RED_MAX_REDUNDANCY + 1);
+            for (size_t i = 0; i + 1 < count; i++) {
+                uint32_t earlier = extended - (uint32_t)(count - 1 - i);
+                if (earlier >= packetCount || primaryArrival[earlier] >= 0 || redundantArrival[earlier] >= 0) continue;
+                PayloadEncoding encoding;
+                if (!EncodingForPayloadType(blocks[i].payloadType, encoding) ||
+                    DecodePayload(encoding, blocks[i].data, blocks[i].length, decoded.data(), decoded.size()) == 0) {
+                    continue;
+                }
+                redundantArrival[earlier] = now;
+            }
+        }
+    }
+
+    // Playout: packet k plays playoutMicros after it was sent
+    uint64_t bursts = 0;
+    uint64_t lossAfterReceived = 0;
+    uint64_t receivedAfterLoss = 0;
+    bool previousLost = false;
+    for (uint64_t k = 0; k < packetCount; k++) {
+        int64_t deadline = (int64_t)k * RUNNER_PTIME_MICROS + playoutMicros;
+        bool primaryOnTime = primaryArrival[k] >= 0 && primaryArrival[k] <= deadline;
+        bool redundantOnTime = redundantArrival[k] >= 0 && redundantArrival[k] <= deadline;
+        bool playable = primaryOnTime || redundantOnTime;
+        if (!primaryOnTime && redundantOnTime) result.recovered++;
+        if (primaryArrival[k] > deadline) result.late++;
+        if (!playable) {
+            result.effectiveLost++;
+            if (!previousLost) {
+                bursts++;
+                if (k > 0) lossAfterReceived++;
+            }
+        } else if (previousLost) {
+            receivedAfterLoss++;
+        }
+        previousLost = !playable;
+    }
+
+    result.link = link.GetStats();
+    result.jitterMs = sourceStats.GetJitter() * 1000.0 / AUDIO_SAMPLE_RATE;
+    result.delayP50Ms = Percentile(delaysMs, 0.50);
+    result.delayP95Ms = Percentile(delaysMs, 0.95);
+    result.delayP99Ms = Percentile(delaysMs, 0.99);
+
+    // G.107 burst ratio from the observed loss pattern: 1 for random loss
+    uint64_t receivedCount = packetCount - result.effectiveLost;
+    if (result.effectiveLost > 0 && receivedCount > 0) {
+        result.meanBurst = (double)result.effectiveLost / bursts;
+        double p = (double)lossAfterReceived / receivedCount;
+        double q = (double)receivedAfterLoss / result.effectiveLost;
+        if (p + q > 0.0) result.burstRatio = 1.0 / (p + q);
+    }
+
+    double mouthToEarMs = options.playoutMs + RUNNER_PTIME_MICROS / 1000.0;
+    double delayImpairment = 0.024 * mouthToEarMs + (mouthToEarMs > 177.3 ? 0.11 * (mouthToEarMs - 177.3) : 0.0);
+    double lossPercent = 100.0 * result.effectiveLost / packetCount;
+    double equipmentImpairment = EMODEL_IE + (95.0 - EMODEL_IE) * lossPercent /
+                                             (lossPercent / result.burstRatio + EMODEL_BPL);
+    result.rFactor = std::max(0.0, EMODEL_R0 - delayImpairment - equipmentImpairment);
+    result.mos = MosFromR(result.rFactor);
+    return result;
+}
+
+static bool ParseOptions(int argc, char** argv, RunnerOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--profile" && hasValue) {
+            options.profile = argv[++i];
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--duration" && hasValue) {
+            options.durationSeconds = std::atof(argv[++i]);
+        } else if (arg == "--playout-ms" && hasValue) {
+            options.playoutMs = std::atof(argv[++i]);
+        } else if (arg == "--red" && hasValue) {
+            options.redundancy = std::atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return options.durationSeconds > 0.0 && options.durationSeconds <= RUNNER_MAX_DURATION_S &&
+           options.playoutMs >= 0.0 && options.redundancy <= (int)RED_MAX_REDUNDANCY;
+}
+
+int main(int argc, char** argv) {
+    RunnerOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s [--profile name] [--seed n] [--duration s (max %.0f)] "
+                             "[--playout-ms n] [--red 0-%zu]\n",
+                     argv[0], RUNNER_MAX_DURATION_S, RED_MAX_REDUNDANCY);
+        return 2;
+    }
+
+    size_t profileCount = 0;
+    const ImpairmentProfile* profiles = GetImpairmentProfiles(profileCount);
+    if (!options.profile.empty() && !FindImpairmentProfile(options.profile)) {
+        std::fprintf(stderr, "Unknown profile '%s'; known:", options.profile.c_str());
+        for (size_t i = 0; i < profileCount; i++) std::fprintf(stderr, " %s", profiles[i].name);
+        std::fprintf(stderr, "\n");
+        return 2;
+    }
+
+    std::printf("VoiceQwik impairment runner: %s PCM16, %.0f s per run, %.0f ms playout delay, seed %llu\n\n",
+                PacketTimeToString(RUNNER_PTIME), options.durationSeconds, options.playoutMs,
+                (unsigned long long)options.seed);
+    std::printf("%-15s %3s %6s %6s %6s %6s %6s %5s %7s %7s %7s %6s %5s %4s %6s %5s\n",
+                "profile", "red", "sent", "loss%", "recov", "late%", "eff%", "burst",
+                "p50 ms", "p95 ms", "p99 ms", "jit ms", "reord", "dup", "R", "MOS");
+
+    bool deterministic = true;
+    for (size_t i = 0; i < profileCount; i++) {
+        const ImpairmentProfile& profile = profiles[i];
+        if (!options.profile.empty() && options.profile != profile.name) continue;
+
+        int firstRed = options.redundancy < 0 ? 0 : options.redundancy;
+        int lastRed = options.redundancy < 0 ? 1 : options.redundancy;
+        for (int red = firstRed; red <= lastRed; red++) {
+            RunResult result = RunProfile(profile, options, red);
+            RunResult again = RunProfile(profile, options, red);
+            if (again.digest != result.digest || again.effectiveLost != result.effectiveLost) {
+                std::printf("%-15s red %d: NOT DETERMINISTIC\n", profile.name, red);
+                deterministic = false;
+            }
+
+            uint64_t linkLost = result.link.lost + result.link.queueDrops;
+            std::printf("%-15s %3d %6llu %6.2f %6llu %6.2f %6.2f %5.1f %7.1f %7.1f %7.1f %6.2f %5llu %4llu %6.1f %5.2f\n",
+                        profile.name, red, (unsigned long long)result.sent,
+                        100.0 * linkLost / result.sent, (unsigned long long)result.recovered,
+                        100.0 * result.late / result.sent, 100.0 * result.effectiveLost / result.sent,
+                        result.meanBurst, result.delayP50Ms, result.delayP95Ms, result.delayP99Ms,
+                        result.jitterMs, (unsigned long long)result.reordered,
+                        (unsigned long long)result.duplicates, result.rFactor, result.mos);
+        }
+    }
+
+    std::printf("\nloss%% = dropped by the link (random, burst or bottleneck); recov = lost packets rebuilt from\n"
+                "RFC 2198 redundancy; late%% = arrived after its playout time; eff%% = nothing to play;\n"
+                "burst = mean consecutive packets missing at playout; R/MOS = ITU-T G.107 E-model, no PLC\n");
+    return deterministic ? 0 : 1;
+}
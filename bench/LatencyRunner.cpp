@@ -0,0 +1,214 @@
+// Device-free mouth-to-ear latency regression. Starts two voiceqwik_headless
+// peers on this host: a host whose device loops its playback back into
+// capture after a fixed delay (so latency markers make the round trip), and a
+// joiner that sends a tone. The host checks the median mouth-to-ear delay of
+// the call against the limit; either peer failing fails the run.
+//
+// Linux only: it spawns and supervises the peers with posix_spawn and poll.
+//
+//   voiceqwik_latency_runner [--duration s] [--max-mouth-to-ear ms] [--loopback-ms n]
+//                            [--base-port n] [--ptime ms] [--impair profile]
+
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+extern char** environ;
+
+constexpr int RUNNER_JOIN_DELAY_MS = 300;       // host is listening before the joiner connects
+constexpr int RUNNER_GRACE_SECONDS = 15;        // on top of the call duration, for setup and teardown
+
+struct RunnerOptions {
+    double durationSeconds = 10.0;
+    double maxMouthToEarMs = 150.0;
+    int loopbackMs = 20;
+    int basePort = 15000;
+    std::string ptime;
+    std::string impairProfile;
+};
+
+struct ChildPeer {
+    const char* role;
+    pid_t pid = -1;
+    int outputFd = -1;
+    std::string output;
+    int status = 0;
+};
+
+static bool ParseOptions(int argc, char** argv, RunnerOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) return false;
+        if (arg == "--duration") {
+            options.durationSeconds = std::atof(argv[++i]);
+        } else if (arg == "--max-mouth-to-ear") {
+            options.maxMouthToEarMs = std::atof(argv[++i]);
+        } else if (arg == "--loopback-ms") {
+            options.loopbackMs = std::atoi(argv[++i]);
+        } else if (arg == "--base-port") {
+            options.basePort = std::atoi(argv[++i]);
+        } else if (arg == "--ptime") {
+            options.ptime = argv[++i];
+        } else if (arg == "--impair") {
+            options.impairProfile = argv[++i];
+        } else {
+            return false;
+        }
+    }
+    return options.durationSeconds > 0.0 && options.maxMouthToEarMs > 0.0 && options.loopbackMs >= 0 &&
+           options.basePort > 0 && options.basePort < 65535;
+}
+
+// voiceqwik_headless sits next to this binary in the build output
+static std::string HeadlessPath() {
+    char self[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (length <= 0) return "voiceqwik_headless";
+    std::string path(self, (size_t)length);
+    size_t slash = path.rfind('/');
+    return path.substr(0, slash + 1) + "voiceqwik_headless";
+}
+
+static bool SpawnPeer(const std::string& path, const std::vector<std::string>& args, ChildPeer& child) {
+    int pipeFds[2];
+    if (pipe(pipeFds) != 0) return false;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&actions, pipeFds[0]);
+
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(path.c_str()));
+    for (const auto& arg : args) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    int result = posix_spawn(&child.pid, path.c_str(), &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipeFds[1]);
+    if (result != 0) {
+        close(pipeFds[0]);
+        child.pid = -1;
+        return false;
+    }
+    child.outputFd = pipeFds[0];
+    return true;
+}
+
+// Collects both peers' output until they exit or the deadline passes
+static void Supervise(std::vector<ChildPeer>& children, int timeoutSeconds) {
+    int remainingMs = timeoutSeconds * 1000;
+    char buffer[4096];
+    while (remainingMs > 0) {
+        std::vector<pollfd> fds;
+        std::vector<ChildPeer*> owners;
+        for (auto& child : children) {
+            if (child.outputFd >= 0) {
+                fds.push_back(pollfd{child.outputFd, POLLIN, 0});
+                owners.push_back(&child);
+            }
+        }
+        if (fds.empty()) break;
+
+        int ready = poll(fds.data(), fds.size(), 100);
+        remainingMs -= 100;
+        if (ready <= 0) continue;
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            ssize_t received = read(fds[i].fd, buffer, sizeof(buffer));
+            if (received > 0) {
+                owners[i]->output.append(buffer, (size_t)received);
+            } else {
+                close(owners[i]->outputFd);
+                owners[i]->outputFd = -1;
+            }
+        }
+    }
+
+    for (auto& child : children) {
+        if (child.pid <= 0) continue;
+        if (child.outputFd >= 0) {
+            kill(child.pid, SIGKILL);
+            close(child.outputFd);
+            child.outputFd = -1;
+            child.output += "(killed: did not finish in time)\n";
+        }
+        waitpid(child.pid, &child.status, 0);
+    }
+}
+
+int main(int argc, char** argv) {
+    RunnerOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: %s [--duration s] [--max-mouth-to-ear ms] [--loopback-ms n]\n"
+                     "          [--base-port n] [--ptime ms] [--impair profile]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    std::string headless = HeadlessPath();
+    std::string duration = std::to_string(options.durationSeconds);
+    std::string hostPort = std::to_string(options.basePort);
+    std::string joinerPort = std::to_string(options.basePort + 1);
+
+    std::vector<std::string> common = {"--participants", "2", "--duration", duration, "--measure-latency"};
+    if (!options.ptime.empty()) {
+        common.push_back("--ptime");
+        common.push_back(options.ptime);
+    }
+    if (!options.impairProfile.empty()) {
+        common.push_back("--impair");
+        common.push_back(options.impairProfile);
+    }
+
+    // The host's loopback hears the joiner's tone and its own markers; the
+    // joiner only sends, so nothing echoes around the call
+    std::vector<std::string> hostArgs = {"--port", hostPort, "--device", "loopback:" + std::to_string(options.loopbackMs),
+                                         "--max-mouth-to-ear", std::to_string(options.maxMouthToEarMs)};
+    hostArgs.insert(hostArgs.end(), common.begin(), common.end());
+    std::vector<std::string> joinerArgs = {"--port", joinerPort, "--connect", "127.0.0.1:" + hostPort,
+                                           "--device", "tone"};
+    joinerArgs.insert(joinerArgs.end(), common.begin(), common.end());
+
+    std::printf("Latency run: %.1f s call, %d ms loopback, limit %.1f ms, peers on ports %s/%s\n",
+                options.durationSeconds, options.loopbackMs, options.maxMouthToEarMs, hostPort.c_str(),
+                joinerPort.c_str());
+    std::fflush(stdout);
+
+    std::vector<ChildPeer> children(2);
+    children[0].role = "host";
+    children[1].role = "joiner";
+    if (!SpawnPeer(headless, hostArgs, children[0])) {
+        std::fprintf(stderr, "Failed to start %s\n", headless.c_str());
+        return 1;
+    }
+    usleep(RUNNER_JOIN_DELAY_MS * 1000);
+    if (!SpawnPeer(headless, joinerArgs, children[1])) {
+        std::fprintf(stderr, "Failed to start %s\n", headless.c_str());
+        kill(children[0].pid, SIGTERM);
+        waitpid(children[0].pid, nullptr, 0);
+        return 1;
+    }
+
+    Supervise(children, (int)options.durationSeconds + RUNNER_GRACE_SECONDS);
+
+    bool passed = true;
+    for (const auto& child : children) {
+        bool ok = WIFEXITED(child.status) && WEXITSTATUS(child.status) == 0;
+        passed = passed && ok;
+        std::printf("\n--- %s (%s) ---\n%s", child.role, ok ? "ok" : "FAILED", child.output.c_str());
+    }
+    std::printf("\n%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
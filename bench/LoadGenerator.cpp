@@ -0,0 +1,1231 @@
+// Synthetic-peer load generator. Spins up N peers that each join a VoiceQwik
+// host through the control handshake, stream speech-like audio with ITU-T
+// P.59 talk/silence timing, and validate what the host sends back: SSRC and
+// sequence continuity, payload decoding, loss, jitter, clock-sync round trip
+// and one-way delay (when the host runs in latency measurement mode). While
+// it runs it samples the CPU time of the process under test from /proc.
+//
+// Peers are spread over worker threads, each with one epoll set and no
+// per-packet allocation, so the generator itself runs a few hundred peers on
+// one box. A VoiceQwik host takes MAX_PARTICIPANTS - 1 of them; it refuses
+// the rest. Every peer announces its own UDP port in the hello, which is how
+// the host tells peers on the same address apart.
+//
+// --serve runs a minimal synthetic host instead (handshake, one stream to
+// every joined peer, clock sync answers), to exercise the generator itself.
+// It has no participant cap, jitter buffer or mixer: a run against it with
+// hundreds of peers measures the generator and the synthetic host, not what
+// VoiceQwik can carry.
+//
+// Linux only: it uses the sockets, epoll and /proc directly.
+//
+//   voiceqwik_loadgen --connect host[:port] [--peers n] [--threads n] [--duration s]
+//                     [--ptime ms] [--encoding pcm16|mulaw|mulaw-half] [--base-port n]
+//                     [--ramp-ms n] [--pid n] [--seed n] [--summary]
+//   voiceqwik_loadgen --serve port [--ptime ms] [--duration s]
+
+#include <audio/PayloadCodec.h>
+#include <networking/ControlProtocol.h>
+#include <networking/LatencyProbe.h>
+#include <networking/RedundantPayload.h>
+#include <networking/RtcpPacket.h>
+#include <networking/RtpPacket.h>
+#include <networking/RtpSourceStats.h>
+#include <utils/Common.h>
+#include <utils/Metrics.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr uint32_t LOADGEN_MAX_PEERS = 4096;
+constexpr int LOADGEN_PROGRESS_INTERVAL_MS = 5000;
+constexpr int LOADGEN_RTCP_INTERVAL_MS = 1000;         // reduced minimum, well inside RATE_FEEDBACK_TIMEOUT
+constexpr int LOADGEN_MAX_EVENTS = 256;
+constexpr int LOADGEN_MAX_CATCH_UP = 4;                // packets sent at once after a stall
+
+// ITU-T P.59 artificial conversational speech: exponential talkspurts and pauses
+constexpr double SPEECH_MEAN_TALK_S = 1.004;
+constexpr double SPEECH_MEAN_PAUSE_S = 1.587;
+constexpr uint32_t SPEECH_TABLE_SAMPLES = AUDIO_SAMPLE_RATE * 4;
+
+// The app has no DTX: silence still goes out every packet time, as background noise
+static int16_t speechTable[SPEECH_TABLE_SAMPLES];
+static int16_t noiseTable[SPEECH_TABLE_SAMPLES];
+
+static std::atomic<bool> stopRequested{false};
+
+static void OnSignal(int) {
+    stopRequested = true;
+}
+
+static uint64_t NextRandom(uint64_t& state) {
+    // SplitMix64, as in NetworkImpairment
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+static double NextUniform(uint64_t& state) {
+    return (double)(NextRandom(state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static int64_t ExponentialMicros(uint64_t& state, double meanSeconds) {
+    return (int64_t)(-std::log(1.0 - NextUniform(state)) * meanSeconds * 1000000.0);
+}
+
+// Voiced speech stand-in: a harmonic series on a wandering 120 Hz pitch,
+// shaped into ~4 Hz syllables, plus a little breath noise
+static void BuildSpeechTables(uint64_t seed) {
+    const double twoPi = 2.0 * 3.14159265358979323846;
+    uint64_t state = seed ^ 0x5EEC4ull;
+    double phase = 0.0;
+    for (uint32_t i = 0; i < SPEECH_TABLE_SAMPLES; i++) {
+        double t = (double)i / AUDIO_SAMPLE_RATE;
+        double pitch = 120.0 + 25.0 * std::sin(twoPi * 0.7 * t) + 10.0 * std::sin(twoPi * 2.3 * t);
+        phase += twoPi * pitch / AUDIO_SAMPLE_RATE;
+
+        double voiced = 0.0;
+        for (int harmonic = 1; harmonic <= 12; harmonic++) {
+            voiced += std::sin(harmonic * phase) / harmonic;
+        }
+        double syllable = std::max(0.0, std::sin(twoPi * 4.1 * t + 0.8 * std::sin(twoPi * 0.3 * t)));
+        double breath = (NextUniform(state) - 0.5) * 0.15;
+
+        speechTable[i] = (int16_t)(7000.0 * std::sqrt(syllable) * (voiced + breath));
+        noiseTable[i] = (int16_t)((NextUniform(state) - 0.5) * 120.0);   // about -55 dBFS
+    }
+}
+
+static bool PacketTimeFromMs(double ms, PacketTime& ptime) {
+    for (PacketTime candidate : ALL_PACKET_TIMES) {
+        if (std::fabs(PacketTimeMicros(candidate) / 1000.0 - ms) < 0.01) {
+            ptime = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// CPU time of a process from /proc/<pid>/stat, in seconds
+static bool ReadProcessCpuSeconds(int pid, double& seconds) {
+    char path[64];
+    std::snprintf(path, sizeof(path), "/proc/%d/stat", pid);
+    FILE* file = std::fopen(path, "r");
+    if (!file) return false;
+
+    char line[1024];
+    bool ok = std::fgets(line, sizeof(line), file) != nullptr;
+    std::fclose(file);
+    if (!ok) return false;
+
+    // The command name may contain spaces; fields resume after its ')'
+    const char* p = std::strrchr(line, ')');
+    if (!p) return false;
+    unsigned long long utime = 0, stime = 0;
+    if (std::sscanf(p + 2, "%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu", &utime, &stime) != 2) {
+        return false;
+    }
+    seconds = (double)(utime + stime) / sysconf(_SC_CLK_TCK);
+    return true;
+}
+
+static long ReadProcessRssKb(int pid) {
+    char path[64];
+    std::snprintf(path, sizeof(path), "/proc/%d/status", pid);
+    FILE* file = std::fopen(path, "r");
+    if (!file) return -1;
+
+    long rss = -1;
+    char line[256];
+    while (std::fgets(line, sizeof(line), file)) {
+        if (std::sscanf(line, "VmRSS: %ld", &rss) == 1) break;
+    }
+    std::fclose(file);
+    return rss;
+}
+
+static double OwnCpuSeconds() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// Lets the generator open two sockets per peer past the usual 1024 soft limit
+static void RaiseFileLimit(size_t needed) {
+    rlimit limit{};
+    if (getrlimit(RLIMIT_NOFILE, &limit) != 0 || limit.rlim_cur >= needed) return;
+    limit.rlim_cur = std::min<rlim_t>(limit.rlim_max, (rlim_t)needed);
+    setrlimit(RLIMIT_NOFILE, &limit);
+}
+
+struct LoadOptions {
+    std::string hostAddress;
+    uint16_t controlPort = DEFAULT_AUDIO_PORT;
+    uint32_t peers = 8;
+    uint32_t threads = 0;               // 0 = one per core, at most one per peer
+    double durationSeconds = 30.0;
+    PacketTime ptime = DEFAULT_PACKET_TIME;
+    PayloadEncoding encoding = PayloadEncoding::Pcm16;
+    uint16_t basePort = 0;              // 0 = ephemeral audio ports
+    int rampMs = 10;                    // between consecutive joins
+    int pid = 0;                        // process under test
+    uint64_t seed = 1;
+    bool summaryOnly = false;
+    uint16_t servePort = 0;             // --serve
+};
+
+enum class PeerState : uint8_t {
+    Idle,
+    Connecting,
+    Handshake,
+    Joined,
+    Rejected,    // host closed the control connection before answering
+    Failed,      // connect error, timeout or bad hello
+    Dropped      // host closed the control connection after the join
+};
+
+static const char* PeerStateToString(PeerState state) {
+    switch (state) {
+        case PeerState::Idle: return "idle";
+        case PeerState::Connecting: return "connect";
+        case PeerState::Handshake: return "hello";
+        case PeerState::Joined: return "joined";
+        case PeerState::Rejected: return "rejected";
+        case PeerState::Failed: return "failed";
+        case PeerState::Dropped: return "dropped";
+        default: return "unknown";
+    }
+}
+
+struct SyntheticPeer {
+    uint32_t index = 0;
+    uint32_t slot = 0;                  // position in its worker, for epoll keys
+    PeerState state = PeerState::Idle;
+    const char* failure = "";
+    int controlSocket = -1;
+    int audioSocket = -1;
+    uint16_t audioPort = 0;
+    sockaddr_in hostAudio{};
+    PacketTime sessionPtime = DEFAULT_PACKET_TIME;
+
+    int64_t startMicros = 0;            // scheduled join
+    int64_t joinedMicros = 0;
+    int64_t firstAudioMicros = 0;
+    uint8_t hello[CONTROL_MAX_MESSAGE_SIZE] = {};
+    size_t helloReceived = 0;
+
+    // Sending
+    uint64_t random = 0;
+    uint32_t ssrc = 0;
+    uint16_t sequence = 0;
+    uint32_t rtpTimestamp = 0;
+    int64_t nextSendMicros = 0;
+    bool talking = false;
+    int64_t spurtEndMicros = 0;
+    uint32_t speechPosition = 0;
+    float gain = 1.0f;
+    int64_t nextSyncMicros = 0;
+    int64_t nextRtcpMicros = 0;
+    uint32_t packetsSent = 0;
+    uint32_t octetsSent = 0;
+    uint32_t sendErrors = 0;
+    uint32_t lateSends = 0;             // sent more than a packet time behind schedule
+
+    // Receiving and validation
+    RtpSourceStats rx;
+    bool hasRemoteSsrc = false;
+    uint32_t remoteSsrc = 0;
+    ClockOffsetEstimator clock;
+    bool hasSenderReport = false;
+    uint32_t lastSenderReportNtp = 0;
+    int64_t lastSenderReportMicros = 0;
+    uint64_t bytesReceived = 0;
+    uint32_t duplicates = 0;
+    uint32_t reordered = 0;
+    uint32_t malformed = 0;             // not parseable as RTP
+    uint32_t badPayload = 0;            // unknown type, undecodable, or not whole capture packets
+    uint32_t ssrcChanges = 0;
+    MetricHistogram oneWayMicros;
+};
+
+// One thread's share of the peers, driven by one epoll set
+class LoadWorker {
+public:
+    LoadWorker(const LoadOptions& options, std::vector<SyntheticPeer*> peers)
+        : options(options), peers(std::move(peers)), epollFd(-1) {
+        for (size_t i = 0; i < this->peers.size(); i++) this->peers[i]->slot = (uint32_t)i;
+    }
+
+    ~LoadWorker() {
+        for (SyntheticPeer* peer : peers) ClosePeer(*peer);
+        if (epollFd >= 0) close(epollFd);
+    }
+
+    void Run(int64_t stopMicros);
+
+    MetricCounter packetsSent;
+    MetricCounter packetsReceived;
+    MetricGauge joined;
+    MetricHistogram oneWayMicros;       // all of this worker's peers
+
+private:
+    const LoadOptions& options;
+    std::vector<SyntheticPeer*> peers;
+    int epollFd;
+
+    std::array<int16_t, MAX_SAMPLES_PER_PACKET> samples{};
+    std::array<int16_t, MAX_SAMPLES_PER_PACKET> decoded{};
+    std::array<uint8_t, MAX_RTP_PACKET_SIZE> packet{};
+    std::array<uint8_t, 2048> receiveBuffer{};
+
+    bool StartPeer(SyntheticPeer& peer, int64_t now);
+    void OnControlEvent(SyntheticPeer& peer, uint32_t events, int64_t now);
+    void OnAudioReadable(SyntheticPeer& peer);
+    void ValidateAudio(SyntheticPeer& peer, const uint8_t* data, size_t length, int64_t now);
+    void SendAudio(SyntheticPeer& peer, int64_t now);
+    void SendClockSync(SyntheticPeer& peer, int64_t now);
+    void SendRtcp(SyntheticPeer& peer, int64_t now);
+    void Fail(SyntheticPeer& peer, PeerState state, const char* reason);
+    void ClosePeer(SyntheticPeer& peer);
+    int64_t NextDeadline(const SyntheticPeer& peer) const;
+};
+
+void LoadWorker::Run(int64_t stopMicros) {
+    epollFd = epoll_create1(0);
+    if (epollFd < 0) {
+        std::fprintf(stderr, "epoll_create1 failed: %s\n", std::strerror(errno));
+        return;
+    }
+
+    epoll_event events[LOADGEN_MAX_EVENTS];
+    while (!stopRequested) {
+        int64_t now = LatencyClockMicros();
+        if (now >= stopMicros) break;
+
+        int64_t nextDeadline = now + 50000;
+        for (SyntheticPeer* peer : peers) {
+            switch (peer->state) {
+                case PeerState::Idle:
+                    if (now >= peer->startMicros && !StartPeer(*peer, now)) continue;
+                    break;
+                case PeerState::Connecting:
+                case PeerState::Handshake:
+                    if (now - peer->startMicros > CONNECTION_TIMEOUT * 1000ll) {
+                        Fail(*peer, PeerState::Failed, "handshake timeout");
+                    }
+                    break;
+                case PeerState::Joined: {
+                    int sent = 0;
+                    while (peer->nextSendMicros <= now && sent < LOADGEN_MAX_CATCH_UP) {
+                        SendAudio(*peer, now);
+                        sent++;
+                    }
+                    if (peer->nextSendMicros <= now) {
+                        // Too far behind to catch up; skip to the present
+                        uint32_t ptimeMicros = PacketTimeMicros(peer->sessionPtime);
+                        int64_t behind = (now - peer->nextSendMicros) / ptimeMicros + 1;
+                        peer->nextSendMicros += behind * ptimeMicros;
+                        peer->rtpTimestamp += (uint32_t)(behind * SamplesPerPacket(peer->sessionPtime));
+                        peer->lateSends += (uint32_t)behind;
+                    }
+                    if (now >= peer->nextSyncMicros) SendClockSync(*peer, now);
+                    if (now >= peer->nextRtcpMicros) SendRtcp(*peer, now);
+                    break;
+                }
+                default:
+                    break;
+            }
+            nextDeadline = std::min(nextDeadline, NextDeadline(*peer));
+        }
+
+        int64_t waitMicros = std::min(nextDeadline, stopMicros) - LatencyClockMicros();
+        int timeoutMs = waitMicros <= 0 ? 0 : (int)((waitMicros + 999) / 1000);
+        int count = epoll_wait(epollFd, events, LOADGEN_MAX_EVENTS, timeoutMs);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            std::fprintf(stderr, "epoll_wait failed: %s\n", std::strerror(errno));
+            return;
+        }
+
+        now = LatencyClockMicros();
+        for (int i = 0; i < count; i++) {
+            // Low bit: audio socket; the rest: index into this worker's peers
+            uint64_t key = events[i].data.u64;
+            SyntheticPeer& peer = *peers[key >> 1];
+            if (key & 1) {
+                OnAudioReadable(peer);
+            } else {
+                OnControlEvent(peer, events[i].events, now);
+            }
+        }
+    }
+}
+
+int64_t LoadWorker::NextDeadline(const SyntheticPeer& peer) const {
+    switch (peer.state) {
+        case PeerState::Idle:
+            return peer.startMicros;
+        case PeerState::Connecting:
+        case PeerState::Handshake:
+            return peer.startMicros + CONNECTION_TIMEOUT * 1000ll;
+        case PeerState::Joined:
+            return std::min(peer.nextSendMicros, std::min(peer.nextSyncMicros, peer.nextRtcpMicros));
+        default:
+            return INT64_MAX;
+    }
+}
+
+bool LoadWorker::StartPeer(SyntheticPeer& peer, int64_t now) {
+    peer.audioSocket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    if (peer.audioSocket < 0) {
+        Fail(peer, PeerState::Failed, "audio socket");
+        return false;
+    }
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(options.basePort ? (uint16_t)(options.basePort + peer.index) : 0);
+    socklen_t localLength = sizeof(local);
+    if (bind(peer.audioSocket, (sockaddr*)&local, sizeof(local)) != 0 ||
+        getsockname(peer.audioSocket, (sockaddr*)&local, &localLength) != 0) {
+        Fail(peer, PeerState::Failed, "audio bind");
+        return false;
+    }
+    peer.audioPort = ntohs(local.sin_port);
+
+    peer.controlSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (peer.controlSocket < 0) {
+        Fail(peer, PeerState::Failed, "control socket");
+        return false;
+    }
+
+    sockaddr_in host{};
+    host.sin_family = AF_INET;
+    host.sin_port = htons(options.controlPort);
+    inet_pton(AF_INET, options.hostAddress.c_str(), &host.sin_addr);
+    if (connect(peer.controlSocket, (sockaddr*)&host, sizeof(host)) != 0 && errno != EINPROGRESS) {
+        Fail(peer, PeerState::Failed, "connect");
+        return false;
+    }
+    peer.hostAudio = host;
+
+    epoll_event event{};
+    event.events = EPOLLOUT;
+    event.data.u64 = (uint64_t)peer.slot << 1;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, peer.controlSocket, &event);
+    event.events = EPOLLIN;
+    event.data.u64 = ((uint64_t)peer.slot << 1) | 1;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, peer.audioSocket, &event);
+
+    peer.state = PeerState::Connecting;
+    peer.startMicros = now;
+    return true;
+}
+
+void LoadWorker::OnControlEvent(SyntheticPeer& peer, uint32_t events, int64_t now) {
+    if (peer.state == PeerState::Connecting) {
+        int error = 0;
+        socklen_t errorLength = sizeof(error);
+        getsockopt(peer.controlSocket, SOL_SOCKET, SO_ERROR, &error, &errorLength);
+        if (error != 0 || (events & (EPOLLERR | EPOLLHUP))) {
+            Fail(peer, PeerState::Failed, error == ECONNREFUSED ? "connection refused" : "connect");
+            return;
+        }
+
+        // No encryption offer, so the host keeps this synthetic peer's media in the clear
+        ControlHello hello{};
+        hello.version = CONTROL_VERSION;
+        hello.audioPort = peer.audioPort;
+        hello.packetTime = options.ptime;
+        uint8_t message[CONTROL_HELLO_SIZE];
+        WriteControlHello(message, hello);
+        if (send(peer.controlSocket, message, sizeof(message), MSG_NOSIGNAL) != (ssize_t)sizeof(message)) {
+            Fail(peer, PeerState::Failed, "hello send");
+            return;
+        }
+
+        epoll_event event{};
+        event.events = EPOLLIN;
+        event.data.u64 = (uint64_t)peer.slot << 1;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, peer.controlSocket, &event);
+        peer.state = PeerState::Handshake;
+        return;
+    }
+
+    if (peer.state == PeerState::Handshake) {
+        ssize_t received = recv(peer.controlSocket, peer.hello + peer.helloReceived,
+                                sizeof(peer.hello) - peer.helloReceived, 0);
+        if (received == 0) {
+            Fail(peer, PeerState::Rejected, "host closed before hello");
+            return;
+        }
+        if (received < 0) {
+            if (errno != EAGAIN && errno != EWOULDBLOCK) Fail(peer, PeerState::Failed, "hello receive");
+            return;
+        }
+        peer.helloReceived += (size_t)received;
+        if (peer.helloReceived < CONTROL_PREFIX_SIZE) return;
+
+        size_t length = ReadControlMessageLength(peer.hello);
+        ControlHello hostHello{};
+        if (length < CONTROL_HELLO_SIZE) {
+            Fail(peer, PeerState::Failed, "bad hello");
+            return;
+        }
+        if (peer.helloReceived < length) return;
+        if (!ParseControlHello(peer.hello, length, hostHello)) {
+            Fail(peer, PeerState::Failed, "bad hello");
+            return;
+        }
+
+        // Adopt the session parameters, as PeerNetwork::ConnectToPeer does
+        peer.sessionPtime = hostHello.packetTime;
+        peer.hostAudio.sin_port = htons(hostHello.audioPort);
+        peer.state = PeerState::Joined;
+        peer.joinedMicros = now;
+        peer.nextSendMicros = now + (int64_t)(NextUniform(peer.random) * PacketTimeMicros(peer.sessionPtime));
+        peer.nextSyncMicros = now;
+        peer.nextRtcpMicros = now + LOADGEN_RTCP_INTERVAL_MS * 1000ll;
+        peer.spurtEndMicros = now;
+        joined.Set(joined.Get() + 1);
+        return;
+    }
+
+    if (peer.state == PeerState::Joined) {
+        // Nothing is expected after the hello; a close means the host dropped us
+        uint8_t discard[256];
+        ssize_t received = recv(peer.controlSocket, discard, sizeof(discard), 0);
+        if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+            joined.Set(joined.Get() - 1);
+            Fail(peer, PeerState::Dropped, "host closed control connection");
+        }
+    }
+}
+
+void LoadWorker::OnAudioReadable(SyntheticPeer& peer) {
+    while (true) {
+        sockaddr_in from{};
+        socklen_t fromLength = sizeof(from);
+        ssize_t length = recvfrom(peer.audioSocket, receiveBuffer.data(), receiveBuffer.size(), 0,
+                                  (sockaddr*)&from, &fromLength);
+        if (length <= 0) return;
+
+        int64_t now = LatencyClockMicros();
+        const uint8_t* data = receiveBuffer.data();
+
+        if (IsClockSync(data, (size_t)length)) {
+            ClockSyncMessage message{};
+            if (!ParseClockSync(data, (size_t)length, message)) continue;
+            if (message.type == ClockSyncType::Request) {
+                // Answer the host's own sync, as AudioStreamer does
+                uint8_t reply[CLOCK_SYNC_SIZE];
+                message.type = ClockSyncType::Response;
+                message.receiveMicros = now;
+                message.transmitMicros = LatencyClockMicros();
+                WriteClockSync(reply, message);
+                sendto(peer.audioSocket, reply, sizeof(reply), 0, (sockaddr*)&from, fromLength);
+            } else {
+                peer.clock.AddSample(message.originateMicros, message.receiveMicros, message.transmitMicros, now);
+            }
+            continue;
+        }
+
+        if (IsRtcpPacket(data, (size_t)length)) {
+            RtcpReport report{};
+            if (ParseRtcpCompound(data, (size_t)length, report) && report.hasSenderInfo) {
+                peer.hasSenderReport = true;
+                peer.lastSenderReportNtp = RtcpNtpMiddle(report.senderInfo.ntpTimestamp);
+                peer.lastSenderReportMicros = now;
+            }
+            continue;
+        }
+
+        ValidateAudio(peer, data, (size_t)length, now);
+    }
+}
+
+void LoadWorker::ValidateAudio(SyntheticPeer& peer, const uint8_t* data, size_t length, int64_t now) {
+    RTPHeader header{};
+    size_t headerSize = 0;
+    size_t payloadSize = 0;
+    if (!ParseRTPHeader(data, length, header, headerSize, payloadSize) || payloadSize == 0) {
+        peer.malformed++;
+        return;
+    }
+
+    if (!peer.hasRemoteSsrc) {
+        peer.hasRemoteSsrc = true;
+        peer.remoteSsrc = header.ssrc;
+        peer.firstAudioMicros = now;
+    } else if (header.ssrc != peer.remoteSsrc) {
+        peer.ssrcChanges++;
+        peer.remoteSsrc = header.ssrc;
+    }
+
+    // Decode the primary; the host may aggregate capture packets, never split them
+    const uint8_t* payload = data + headerSize;
+    uint8_t payloadType = header.payloadType;
+    if (payloadType == RTP_PAYLOAD_TYPE_RED) {
+        RedundantBlock blocks[RED_MAX_REDUNDANCY + 1];
+        size_t count = ParseRedundantPayload(payload, payloadSize, blocks, RED_MAX_REDUNDANCY + 1);
+        if (count == 0) {
+            peer.badPayload++;
+            return;
+        }
+        payloadType = blocks[count - 1].payloadType;
+        payload = blocks[count - 1].data;
+        payloadSize = blocks[count - 1].length;
+    }
+    PayloadEncoding encoding;
+    size_t sampleCount = 0;
+    if (EncodingForPayloadType(payloadType, encoding)) {
+        sampleCount = DecodePayload(encoding, payload, payloadSize, decoded.data(), decoded.size());
+    }
+    if (sampleCount == 0 || sampleCount % SamplesPerPacket(peer.sessionPtime) != 0) {
+        peer.badPayload++;
+    }
+
+    uint32_t arrivalRtp = (uint32_t)((uint64_t)now * AUDIO_SAMPLE_RATE / 1000000);
+    RtpSourceStats::Arrival arrival = peer.rx.Update(header.sequence, header.timestamp, arrivalRtp);
+    if (arrival == RtpSourceStats::Arrival::Duplicate) peer.duplicates++;
+    if (arrival == RtpSourceStats::Arrival::Reordered) peer.reordered++;
+    peer.bytesReceived += length;
+    packetsReceived.Add();
+
+    LatencyTimestamps stamps{};
+    if (peer.clock.HasEstimate() && ParseLatencyExtension(data, headerSize, stamps)) {
+        int64_t oneWay = now - peer.clock.RemoteToLocal(stamps.sendMicros, now);
+        if (oneWay >= 0) {
+            peer.oneWayMicros.Record((uint64_t)oneWay);
+            oneWayMicros.Record((uint64_t)oneWay);
+        }
+    }
+}
+
+void LoadWorker::SendAudio(SyntheticPeer& peer, int64_t now) {
+    const uint32_t sampleCount = SamplesPerPacket(peer.sessionPtime);
+    const int64_t captureMicros = peer.nextSendMicros;
+
+    bool spurtStart = false;
+    if (captureMicros >= peer.spurtEndMicros) {
+        peer.talking = !peer.talking;
+        spurtStart = peer.talking;
+        peer.spurtEndMicros = captureMicros +
+            ExponentialMicros(peer.random, peer.talking ? SPEECH_MEAN_TALK_S : SPEECH_MEAN_PAUSE_S);
+    }
+
+    const int16_t* source = peer.talking ? speechTable : noiseTable;
+    float gain = peer.talking ? peer.gain : 1.0f;
+    for (uint32_t i = 0; i < sampleCount; i++) {
+        samples[i] = (int16_t)(source[peer.speechPosition] * gain);
+        if (++peer.speechPosition == SPEECH_TABLE_SAMPLES) peer.speechPosition = 0;
+    }
+
+    RTPHeader header{spurtStart, PayloadTypeForEncoding(options.encoding), peer.sequence, peer.rtpTimestamp, peer.ssrc};
+    WriteRTPHeader(packet.data(), header, true);
+    WriteLatencyExtension(packet.data() + RTP_HEADER_SIZE,
+                          LatencyTimestamps{(uint32_t)captureMicros, (uint32_t)now});
+    size_t headerSize = RTP_HEADER_SIZE + LATENCY_EXTENSION_SIZE;
+    size_t payloadSize = EncodePayload(options.encoding, samples.data(), sampleCount, packet.data() + headerSize);
+
+    ssize_t sent = sendto(peer.audioSocket, packet.data(), headerSize + payloadSize, 0,
+                          (const sockaddr*)&peer.hostAudio, sizeof(peer.hostAudio));
+    if (sent < 0) {
+        peer.sendErrors++;
+    } else {
+        peer.packetsSent++;
+        peer.octetsSent += (uint32_t)payloadSize;
+        packetsSent.Add();
+    }
+    if (now - captureMicros > (int64_t)PacketTimeMicros(peer.sessionPtime)) peer.lateSends++;
+
+    peer.sequence++;
+    peer.rtpTimestamp += sampleCount;
+    peer.nextSendMicros += PacketTimeMicros(peer.sessionPtime);
+}
+
+void LoadWorker::SendClockSync(SyntheticPeer& peer, int64_t now) {
+    uint8_t message[CLOCK_SYNC_SIZE];
+    WriteClockSync(message, ClockSyncMessage{ClockSyncType::Request, now, 0, 0});
+    sendto(peer.audioSocket, message, sizeof(message), 0, (const sockaddr*)&peer.hostAudio, sizeof(peer.hostAudio));
+    peer.nextSyncMicros = now + CLOCK_SYNC_INTERVAL_MS * 1000ll;
+}
+
+// SR with a report block on the host's stream, so the host's rate control
+// sees feedback from every synthetic peer
+void LoadWorker::SendRtcp(SyntheticPeer& peer, int64_t now) {
+    peer.nextRtcpMicros = now + LOADGEN_RTCP_INTERVAL_MS * 1000ll;
+
+    RtcpSenderInfo senderInfo{RtcpNtpNow(), peer.rtpTimestamp, peer.packetsSent, peer.octetsSent};
+    RtcpReportBlock block{};
+    size_t blockCount = 0;
+    if (peer.hasRemoteSsrc) {
+        block.ssrc = peer.remoteSsrc;
+        block.fractionLost = peer.rx.TakeFractionLost();
+        block.cumulativeLost = peer.rx.GetCumulativeLost();
+        block.extendedHighestSequence = peer.rx.GetExtendedHighestSequence();
+        block.jitter = peer.rx.GetJitter();
+        if (peer.hasSenderReport) {
+            block.lastSenderReport = peer.lastSenderReportNtp;
+            block.delaySinceLastSenderReport = (uint32_t)((now - peer.lastSenderReportMicros) * 65536 / 1000000);
+        }
+        blockCount = 1;
+    }
+
+    char cname[32];
+    std::snprintf(cname, sizeof(cname), "loadgen-%u", peer.index);
+    uint8_t report[RTCP_MAX_PACKET_SIZE];
+    size_t size = WriteRtcpCompound(report, sizeof(report), peer.ssrc, &senderInfo, &block, blockCount, cname);
+    if (size > 0) {
+        sendto(peer.audioSocket, report, size, 0, (const sockaddr*)&peer.hostAudio, sizeof(peer.hostAudio));
+    }
+}
+
+void LoadWorker::Fail(SyntheticPeer& peer, PeerState state, const char* reason) {
+    peer.state = state;
+    peer.failure = reason;
+    ClosePeer(peer);
+}
+
+void LoadWorker::ClosePeer(SyntheticPeer& peer) {
+    if (peer.controlSocket >= 0) {
+        close(peer.controlSocket);
+        peer.controlSocket = -1;
+    }
+    if (peer.audioSocket >= 0) {
+        close(peer.audioSocket);
+        peer.audioSocket = -1;
+    }
+}
+
+// CPU share of the process under test between two samples
+struct CpuSampler {
+    int pid = 0;
+    bool valid = false;
+    double lastCpu = 0.0;
+    int64_t lastMicros = 0;
+
+    void Start(int processId) {
+        pid = processId;
+        valid = pid > 0 && ReadProcessCpuSeconds(pid, lastCpu);
+        lastMicros = LatencyClockMicros();
+    }
+
+    // Percent of one core since the previous call; negative if unavailable
+    double Sample() {
+        double cpu = 0.0;
+        if (!valid || !ReadProcessCpuSeconds(pid, cpu)) return -1.0;
+        int64_t now = LatencyClockMicros();
+        double percent = now > lastMicros ? 100.0 * (cpu - lastCpu) / ((now - lastMicros) / 1e6) : 0.0;
+        lastCpu = cpu;
+        lastMicros = now;
+        return percent;
+    }
+};
+
+static void PrintPeerTable(const std::vector<std::unique_ptr<SyntheticPeer>>& peers) {
+    std::printf("\n%5s %5s %-8s %7s %7s %7s %7s %6s %6s %4s %5s %6s %7s %7s %7s %6s %5s\n",
+                "peer", "port", "state", "join ms", "ttfa ms", "sent", "recv", "lost", "loss%", "dup",
+                "reord", "jit ms", "p50 ms", "p95 ms", "p99 ms", "rtt ms", "inval");
+    for (const auto& peer : peers) {
+        HistogramSnapshot latency{};
+        peer->oneWayMicros.Snapshot(latency);
+        int32_t lost = peer->rx.GetCumulativeLost();
+        uint32_t expected = peer->rx.GetExpected();
+        uint32_t invalid = peer->malformed + peer->badPayload + peer->ssrcChanges;
+
+        char joinMs[16] = "-", firstAudioMs[16] = "-", p50[16] = "-", p95[16] = "-", p99[16] = "-", rtt[16] = "-";
+        if (peer->joinedMicros > 0) {
+            std::snprintf(joinMs, sizeof(joinMs), "%.1f", (peer->joinedMicros - peer->startMicros) / 1000.0);
+        }
+        if (peer->firstAudioMicros > 0) {
+            std::snprintf(firstAudioMs, sizeof(firstAudioMs), "%.1f", (peer->firstAudioMicros - peer->joinedMicros) / 1000.0);
+        }
+        if (latency.count > 0) {
+            std::snprintf(p50, sizeof(p50), "%.2f", latency.ValueAtPercentile(50) / 1000.0);
+            std::snprintf(p95, sizeof(p95), "%.2f", latency.ValueAtPercentile(95) / 1000.0);
+            std::snprintf(p99, sizeof(p99), "%.2f", latency.ValueAtPercentile(99) / 1000.0);
+        }
+        if (peer->clock.HasEstimate()) {
+            std::snprintf(rtt, sizeof(rtt), "%.2f", peer->clock.GetRoundTripMicros() / 1000.0);
+        }
+
+        std::printf("%5u %5u %-8s %7s %7s %7u %7u %6d %6.2f %4u %5u %6.2f %7s %7s %7s %6s %5u\n",
+                    peer->index, peer->audioPort, PeerStateToString(peer->state), joinMs, firstAudioMs,
+                    peer->packetsSent, peer->rx.GetReceived(), lost,
+                    expected > 0 ? 100.0 * lost / expected : 0.0, peer->duplicates, peer->reordered,
+                    peer->rx.GetJitter() * 1000.0 / AUDIO_SAMPLE_RATE, p50, p95, p99, rtt, invalid);
+        if (peer->state != PeerState::Joined && peer->failure[0]) {
+            std::printf("      %s\n", peer->failure);
+        }
+    }
+}
+
+static int RunLoad(const LoadOptions& options) {
+    BuildSpeechTables(options.seed);
+    RaiseFileLimit(options.peers * 2 + 64);
+
+    uint32_t threadCount = options.threads;
+    if (threadCount == 0) threadCount = std::max(1u, std::thread::hardware_concurrency());
+    threadCount = std::min(threadCount, options.peers);
+
+    std::vector<std::unique_ptr<SyntheticPeer>> peers;
+    std::vector<std::vector<SyntheticPeer*>> shares(threadCount);
+    int64_t startMicros = LatencyClockMicros();
+    for (uint32_t i = 0; i < options.peers; i++) {
+        auto peer = std::make_unique<SyntheticPeer>();
+        peer->index = i;
+        peer->random = options.seed * 0x100000001B3ull + i;
+        peer->ssrc = (uint32_t)NextRandom(peer->random);
+        peer->sequence = (uint16_t)NextRandom(peer->random);
+        peer->rtpTimestamp = (uint32_t)NextRandom(peer->random);
+        peer->speechPosition = (uint32_t)(NextRandom(peer->random) % SPEECH_TABLE_SAMPLES);
+        peer->gain = (float)(0.5 + 0.5 * NextUniform(peer->random));
+        peer->talking = NextUniform(peer->random) < SPEECH_MEAN_TALK_S / (SPEECH_MEAN_TALK_S + SPEECH_MEAN_PAUSE_S);
+        peer->startMicros = startMicros + (int64_t)i * options.rampMs * 1000;
+        shares[i % threadCount].push_back(peer.get());
+        peers.push_back(std::move(peer));
+    }
+
+    int64_t stopMicros = startMicros + (int64_t)(options.durationSeconds * 1000000.0);
+    std::vector<std::unique_ptr<LoadWorker>> workers;
+    for (uint32_t t = 0; t < threadCount; t++) {
+        workers.push_back(std::make_unique<LoadWorker>(options, shares[t]));
+    }
+
+    std::printf("VoiceQwik load generator: %u peers -> %s:%u, %u threads, %s %s, %.0f s\n",
+                options.peers, options.hostAddress.c_str(), options.controlPort, threadCount,
+                PacketTimeToString(options.ptime), PayloadEncodingToString(options.encoding),
+                options.durationSeconds);
+    if (options.peers > (uint32_t)(MAX_PARTICIPANTS - 1)) {
+        std::printf("Note: a VoiceQwik host takes %d peers and refuses the rest; more only make sense with --serve\n",
+                    MAX_PARTICIPANTS - 1);
+    }
+
+    CpuSampler hostCpu;
+    hostCpu.Start(options.pid);
+    CpuSampler wholeRunCpu;
+    wholeRunCpu.Start(options.pid);
+    if (options.pid > 0 && !hostCpu.valid) {
+        std::fprintf(stderr, "Cannot read /proc/%d/stat; CPU of the process under test not reported\n", options.pid);
+    }
+    double ownCpuStart = OwnCpuSeconds();
+
+    std::vector<std::thread> threads;
+    for (auto& worker : workers) {
+        LoadWorker* w = worker.get();
+        threads.emplace_back([w, stopMicros] { w->Run(stopMicros); });
+    }
+
+    uint64_t lastSent = 0, lastReceived = 0;
+    int64_t lastProgress = startMicros;
+    double lastOwnCpu = ownCpuStart;
+    while (!stopRequested && LatencyClockMicros() < stopMicros) {
+        int64_t wake = std::min<int64_t>(lastProgress + LOADGEN_PROGRESS_INTERVAL_MS * 1000ll, stopMicros);
+        while (!stopRequested && LatencyClockMicros() < wake) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        }
+        int64_t now = LatencyClockMicros();
+        if (now < lastProgress + LOADGEN_PROGRESS_INTERVAL_MS * 1000ll) break;
+
+        uint64_t sent = 0, received = 0;
+        int64_t joined = 0;
+        for (auto& worker : workers) {
+            sent += worker->packetsSent.Get();
+            received += worker->packetsReceived.Get();
+            joined += worker->joined.Get();
+        }
+        double seconds = (now - lastProgress) / 1e6;
+        double ownCpu = OwnCpuSeconds();
+        double hostPercent = hostCpu.Sample();
+
+        char hostText[32] = "";
+        if (hostPercent >= 0.0) std::snprintf(hostText, sizeof(hostText), ", target CPU %.1f%%", hostPercent);
+        std::printf("%6.1f s: %lld/%u joined, tx %.0f pps, rx %.0f pps%s, loadgen CPU %.1f%%\n",
+                    (now - startMicros) / 1e6, (long long)joined, options.peers,
+                    (sent - lastSent) / seconds, (received - lastReceived) / seconds, hostText,
+                    100.0 * (ownCpu - lastOwnCpu) / seconds);
+        std::fflush(stdout);
+
+        lastSent = sent;
+        lastReceived = received;
+        lastProgress = now;
+        lastOwnCpu = ownCpu;
+    }
+
+    stopRequested = true;
+    for (auto& thread : threads) thread.join();
+
+    double elapsed = (LatencyClockMicros() - startMicros) / 1e6;
+    double targetPercent = wholeRunCpu.Sample();
+    double ownPercent = 100.0 * (OwnCpuSeconds() - ownCpuStart) / elapsed;
+
+    if (!options.summaryOnly) PrintPeerTable(peers);
+
+    // Validation: every peer joined, stayed, received audio, and nothing malformed
+    uint32_t joinedCount = 0, rejected = 0, failed = 0, dropped = 0, silent = 0;
+    uint64_t expected = 0, invalid = 0, sent = 0, lateSends = 0, sendErrors = 0;
+    int64_t lost = 0;
+    double worstLoss = 0.0;
+    uint32_t worstPeer = 0;
+    for (const auto& peer : peers) {
+        switch (peer->state) {
+            case PeerState::Joined: joinedCount++; break;
+            case PeerState::Rejected: rejected++; break;
+            case PeerState::Dropped: dropped++; break;
+            default: failed++; break;
+        }
+        if (peer->state == PeerState::Joined && peer->rx.GetReceived() == 0) silent++;
+        invalid += peer->malformed + peer->badPayload + peer->ssrcChanges;
+        sent += peer->packetsSent;
+        lateSends += peer->lateSends;
+        sendErrors += peer->sendErrors;
+        expected += peer->rx.GetExpected();
+        lost += peer->rx.GetCumulativeLost();
+        if (peer->rx.GetExpected() > 0) {
+            double loss = 100.0 * peer->rx.GetCumulativeLost() / peer->rx.GetExpected();
+            if (loss > worstLoss) {
+                worstLoss = loss;
+                worstPeer = peer->index;
+            }
+        }
+    }
+
+    HistogramSnapshot latency{};
+    for (auto& worker : workers) {
+        HistogramSnapshot part{};
+        worker->oneWayMicros.Snapshot(part);
+        if (latency.count == 0) {
+            latency = part;
+        } else {
+            for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) latency.counts[i] += part.counts[i];
+            latency.count += part.count;
+            latency.sum += part.sum;
+            latency.max = std::max(latency.max, part.max);
+        }
+    }
+
+    std::printf("\n%u joined, %u rejected, %u failed, %u dropped, %u joined without receiving audio\n",
+                joinedCount, rejected, failed, dropped, silent);
+    std::printf("receive loss %.3f%% overall, worst peer %u at %.3f%%; %llu invalid packets\n",
+                expected > 0 ? 100.0 * lost / expected : 0.0, worstPeer, worstLoss, (unsigned long long)invalid);
+    if (latency.count > 0) {
+        std::printf("one-way delay p50 %.2f ms, p95 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+                    latency.ValueAtPercentile(50) / 1000.0, latency.ValueAtPercentile(95) / 1000.0,
+                    latency.ValueAtPercentile(99) / 1000.0, latency.max / 1000.0);
+    } else {
+        std::printf("one-way delay: not measured (host not in latency measurement mode)\n");
+    }
+    if (targetPercent >= 0.0) {
+        std::printf("process under test (pid %d): %.1f%% of one core, RSS %ld KB\n",
+                    options.pid, targetPercent, ReadProcessRssKb(options.pid));
+    }
+    std::printf("load generator: %.1f%% of one core, %llu late sends, %llu send errors%s\n", ownPercent,
+                (unsigned long long)lateSends, (unsigned long long)sendErrors,
+                lateSends * 100 > sent ? " (generator saturated; numbers above include its own delay)" : "");
+
+    bool ok = joinedCount == options.peers && silent == 0 && invalid == 0;
+    return ok ? 0 : 1;
+}
+
+// Minimal host: accepts the handshake like PeerNetwork, sends one stream to
+// every joined peer like AudioStreamer (own sequence space per peer), and
+// answers clock sync. Not a mixer; it only gives the generator a counterpart.
+static int RunSyntheticHost(const LoadOptions& options) {
+    BuildSpeechTables(options.seed);
+    RaiseFileLimit(LOADGEN_MAX_PEERS + 64);
+
+    int listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    int audioSocket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK, 0);
+    int reuse = 1;
+    setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in local{};
+    local.sin_family = AF_INET;
+    local.sin_addr.s_addr = htonl(INADDR_ANY);
+    local.sin_port = htons(options.servePort);
+    if (bind(listenSocket, (sockaddr*)&local, sizeof(local)) != 0 || listen(listenSocket, 128) != 0 ||
+        bind(audioSocket, (sockaddr*)&local, sizeof(local)) != 0) {
+        std::fprintf(stderr, "Cannot listen on port %u: %s\n", options.servePort, std::strerror(errno));
+        return 1;
+    }
+    int sendBuffer = 4 * 1024 * 1024;
+    setsockopt(audioSocket, SOL_SOCKET, SO_SNDBUF, &sendBuffer, sizeof(sendBuffer));
+    setsockopt(audioSocket, SOL_SOCKET, SO_RCVBUF, &sendBuffer, sizeof(sendBuffer));
+
+    struct HostPeer {
+        int controlSocket;
+        sockaddr_in audio;
+        uint16_t sequence;
+        uint8_t hello[CONTROL_MAX_MESSAGE_SIZE];
+        size_t helloReceived;
+        bool joined;
+        RtpSourceStats rx;
+    };
+    std::map<int, HostPeer> hostPeers;
+
+    int epollFd = epoll_create1(0);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = listenSocket;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, listenSocket, &event);
+    event.data.fd = audioSocket;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, audioSocket, &event);
+
+    std::printf("VoiceQwik synthetic host on port %u (TCP control, UDP audio), preferring %s\n"
+                "No participant cap, jitter buffer or mixer: results measure the generator, not VoiceQwik\n",
+                options.servePort, PacketTimeToString(options.ptime));
+    std::fflush(stdout);
+
+    uint64_t random = options.seed;
+    const uint32_t ssrc = (uint32_t)NextRandom(random);
+    bool sessionSettled = false;
+    PacketTime sessionPtime = options.ptime;
+    uint32_t rtpTimestamp = 0;
+    uint32_t speechPosition = 0;
+    uint64_t received = 0;
+    uint64_t joinedTotal = 0;
+
+    std::array<int16_t, MAX_SAMPLES_PER_PACKET> samples{};
+    std::array<uint8_t, MAX_RTP_PACKET_SIZE> packet{};
+    std::array<uint8_t, 2048> buffer{};
+
+    const int64_t startMicros = LatencyClockMicros();
+    const int64_t stopMicros = startMicros + (int64_t)(options.durationSeconds * 1000000.0);
+    int64_t nextSend = startMicros;
+    epoll_event events[LOADGEN_MAX_EVENTS];
+
+    while (!stopRequested && LatencyClockMicros() < stopMicros) {
+        int64_t now = LatencyClockMicros();
+        if (now >= nextSend) {
+            uint32_t sampleCount = SamplesPerPacket(sessionPtime);
+            for (uint32_t i = 0; i < sampleCount; i++) {
+                samples[i] = speechTable[speechPosition];
+                if (++speechPosition == SPEECH_TABLE_SAMPLES) speechPosition = 0;
+            }
+            size_t headerSize = RTP_HEADER_SIZE + LATENCY_EXTENSION_SIZE;
+            size_t payloadSize = EncodePayload(PayloadEncoding::Pcm16, samples.data(), sampleCount,
+                                               packet.data() + headerSize);
+            for (auto& entry : hostPeers) {
+                HostPeer& peer = entry.second;
+                if (!peer.joined) continue;
+                RTPHeader header{false, RTP_PAYLOAD_TYPE_PCM16, peer.sequence++, rtpTimestamp, ssrc};
+                WriteRTPHeader(packet.data(), header, true);
+                uint32_t sendMicros = (uint32_t)LatencyClockMicros();
+                WriteLatencyExtension(packet.data() + RTP_HEADER_SIZE, LatencyTimestamps{(uint32_t)nextSend, sendMicros});
+                sendto(audioSocket, packet.data(), headerSize + payloadSize, 0,
+                       (const sockaddr*)&peer.audio, sizeof(peer.audio));
+            }
+            rtpTimestamp += sampleCount;
+            nextSend += PacketTimeMicros(sessionPtime);
+            if (nextSend < now) nextSend = now + PacketTimeMicros(sessionPtime);
+        }
+
+        int64_t waitMicros = std::min(nextSend, stopMicros) - LatencyClockMicros();
+        int timeoutMs = waitMicros <= 0 ? 0 : (int)((waitMicros + 999) / 1000);
+        int count = epoll_wait(epollFd, events, LOADGEN_MAX_EVENTS, timeoutMs);
+        if (count < 0 && errno != EINTR) break;
+
+        for (int i = 0; i < count; i++) {
+            int fd = events[i].data.fd;
+            if (fd == listenSocket) {
+                sockaddr_in from{};
+                socklen_t fromLength = sizeof(from);
+                int client;
+                while ((client = accept4(listenSocket, (sockaddr*)&from, &fromLength, SOCK_NONBLOCK)) >= 0) {
+                    HostPeer peer{};
+                    peer.controlSocket = client;
+                    peer.audio = from;
+                    peer.sequence = (uint16_t)NextRandom(random);
+                    hostPeers.emplace(client, peer);
+                    epoll_event clientEvent{};
+                    clientEvent.events = EPOLLIN;
+                    clientEvent.data.fd = client;
+                    epoll_ctl(epollFd, EPOLL_CTL_ADD, client, &clientEvent);
+                    fromLength = sizeof(from);
+                }
+            } else if (fd == audioSocket) {
+                sockaddr_in from{};
+                socklen_t fromLength = sizeof(from);
+                ssize_t length;
+                while ((length = recvfrom(audioSocket, buffer.data(), buffer.size(), 0,
+                                          (sockaddr*)&from, &fromLength)) > 0) {
+                    int64_t arrival = LatencyClockMicros();
+                    ClockSyncMessage message{};
+                    if (ParseClockSync(buffer.data(), (size_t)length, message)) {
+                        if (message.type == ClockSyncType::Request) {
+                            uint8_t reply[CLOCK_SYNC_SIZE];
+                            message.type = ClockSyncType::Response;
+                            message.receiveMicros = arrival;
+                            message.transmitMicros = LatencyClockMicros();
+                            WriteClockSync(reply, message);
+                            sendto(audioSocket, reply, sizeof(reply), 0, (sockaddr*)&from, fromLength);
+                        }
+                    } else if (!IsRtcpPacket(buffer.data(), (size_t)length)) {
+                        RTPHeader header{};
+                        size_t headerSize = 0, payloadSize = 0;
+                        if (ParseRTPHeader(buffer.data(), (size_t)length, header, headerSize, payloadSize)) {
+                            received++;
+                            for (auto& entry : hostPeers) {
+                                HostPeer& peer = entry.second;
+                                if (peer.audio.sin_addr.s_addr == from.sin_addr.s_addr &&
+                                    peer.audio.sin_port == from.sin_port) {
+                                    peer.rx.Update(header.sequence, header.timestamp,
+                                                   (uint32_t)((uint64_t)arrival * AUDIO_SAMPLE_RATE / 1000000));
+                                    break;
+                                }
+                            }
+                        }
+                    }
+                    fromLength = sizeof(from);
+                }
+            } else {
+                auto it = hostPeers.find(fd);
+                if (it == hostPeers.end()) continue;
+                HostPeer& peer = it->second;
+                ssize_t length = recv(fd, peer.hello + peer.helloReceived,
+                                      sizeof(peer.hello) - peer.helloReceived, 0);
+                if (length <= 0) {
+                    if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) continue;
+                    close(fd);
+                    hostPeers.erase(it);
+                    continue;
+                }
+                if (peer.joined) continue;
+                peer.helloReceived += (size_t)length;
+
+                ControlHello hello{};
+                size_t messageLength = peer.helloReceived >= CONTROL_PREFIX_SIZE
+                                           ? ReadControlMessageLength(peer.hello) : CONTROL_HELLO_SIZE;
+                if (peer.helloReceived < messageLength) continue;
+                if (messageLength < CONTROL_HELLO_SIZE || !ParseControlHello(peer.hello, messageLength, hello)) {
+                    close(fd);
+                    hostPeers.erase(it);
+                    continue;
+                }
+
+                // The first peer settles the session packet time, as in PeerNetwork::ExchangeHello
+                if (!sessionSettled) {
+                    sessionPtime = NegotiatePacketTime(options.ptime, hello.packetTime);
+                    sessionSettled = true;
+                }
+                ControlHello hostHello{};
+                hostHello.version = CONTROL_VERSION;
+                hostHello.audioPort = options.servePort;
+                hostHello.packetTime = sessionPtime;
+                uint8_t reply[CONTROL_HELLO_SIZE];
+                WriteControlHello(reply, hostHello);
+                send(fd, reply, sizeof(reply), MSG_NOSIGNAL);
+                peer.audio.sin_port = htons(hello.audioPort);
+                peer.joined = true;
+                joinedTotal++;
+            }
+        }
+    }
+
+    uint32_t active = 0;
+    int64_t lost = 0;
+    uint64_t expected = 0;
+    for (auto& entry : hostPeers) {
+        if (entry.second.joined) active++;
+        expected += entry.second.rx.GetExpected();
+        lost += entry.second.rx.GetCumulativeLost();
+        close(entry.first);
+    }
+    std::printf("synthetic host: %llu joined, %u still connected, %llu RTP packets received, loss %.3f%%\n",
+                (unsigned long long)joinedTotal, active, (unsigned long long)received,
+                expected > 0 ? 100.0 * lost / expected : 0.0);
+    close(epollFd);
+    close(listenSocket);
+    close(audioSocket);
+    return 0;
+}
+
+static bool ParseOptions(int argc, char** argv, LoadOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--connect" && hasValue) {
+            std::string target = argv[++i];
+            size_t colon = target.find(':');
+            options.hostAddress = target.substr(0, colon);
+            if (colon != std::string::npos) options.controlPort = (uint16_t)std::atoi(target.c_str() + colon + 1);
+        } else if (arg == "--serve" && hasValue) {
+            options.servePort = (uint16_t)std::atoi(argv[++i]);
+        } else if (arg == "--peers" && hasValue) {
+            options.peers = (uint32_t)std::atoi(argv[++i]);
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = (uint32_t)std::atoi(argv[++i]);
+        } else if (arg == "--duration" && hasValue) {
+            options.durationSeconds = std::atof(argv[++i]);
+        } else if (arg == "--ptime" && hasValue) {
+            if (!PacketTimeFromMs(std::atof(argv[++i]), options.ptime)) return false;
+        } else if (arg == "--encoding" && hasValue) {
+            std::string name = argv[++i];
+            if (name == "pcm16") options.encoding = PayloadEncoding::Pcm16;
+            else if (name == "mulaw") options.encoding = PayloadEncoding::Mulaw;
+            else if (name == "mulaw-half") options.encoding = PayloadEncoding::MulawHalfRate;
+            else return false;
+        } else if (arg == "--base-port" && hasValue) {
+            options.basePort = (uint16_t)std::atoi(argv[++i]);
+        } else if (arg == "--ramp-ms" && hasValue) {
+            options.rampMs = std::atoi(argv[++i]);
+        } else if (arg == "--pid" && hasValue) {
+            options.pid = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && hasValue) {
+            options.seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--summary") {
+            options.summaryOnly = true;
+        } else {
+            return false;
+        }
+    }
+
+    if (options.durationSeconds <= 0.0) return false;
+    if (options.servePort != 0) return true;
+
+    in_addr address{};
+    return inet_pton(AF_INET, options.hostAddress.c_str(), &address) == 1 && options.controlPort != 0 &&
+           options.peers >= 1 && options.peers <= LOADGEN_MAX_PEERS && options.rampMs >= 0 &&
+           (options.basePort == 0 || options.basePort + options.peers <= 65536);
+}
+
+int main(int argc, char** argv) {
+    LoadOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: %s --connect ipv4[:port] [--peers 1-%u] [--threads n] [--duration s]\n"
+                     "          [--ptime 2.5|5|10|20|40] [--encoding pcm16|mulaw|mulaw-half] [--base-port n]\n"
+                     "          [--ramp-ms n] [--pid n] [--seed n] [--summary]\n"
+                     "       %s --serve port [--ptime ms] [--duration s]\n",
+                     argv[0], LOADGEN_MAX_PEERS, argv[0]);
+        return 2;
+    }
+
+    signal(SIGINT, OnSignal);
+    signal(SIGTERM, OnSignal);
+    signal(SIGPIPE, SIG_IGN);
+
+    return options.servePort != 0 ? RunSyntheticHost(options) : RunLoad(options);
+}
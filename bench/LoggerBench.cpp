@@ -0,0 +1,121 @@
+// Caller-side latency of the async logger under contention.
+// N threads log concurrently; each call is timed individually and the
+// distribution across all threads is reported as p50/p99/p99.9/max.
+// The baseline row times no call at all: with more bench threads than
+// CPUs its max is a scheduler time slice, and so is the loggers'.
+
+#include <utils/Logger.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr int BENCH_THREADS = 8;
+constexpr int CALLS_PER_THREAD = 10000;
+constexpr int PACE_NS = 20000;  // gap between calls so rings drain as in a real call
+
+using BenchClock = std::chrono::steady_clock;
+
+enum class CallKind { None, Format, Literal, String };
+
+static void SpinFor(int ns) {
+    auto until = BenchClock::now() + std::chrono::nanoseconds(ns);
+    while (BenchClock::now() < until) {
+    }
+}
+
+static double Percentile(const std::vector<double>& sorted, double p) {
+    size_t index = std::min(sorted.size() - 1, (size_t)(p * (sorted.size() - 1)));
+    return sorted[index];
+}
+
+static void RunScenario(const char* name, CallKind kind) {
+    std::vector<std::vector<double>> latencies(BENCH_THREADS);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+
+    uint64_t droppedBefore = Logger::GetInstance().GetDroppedCount();
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < BENCH_THREADS; t++) {
+        threads.emplace_back([&, t] {
+            auto& samples = latencies[t];
+            samples.reserve(CALLS_PER_THREAD);
+            std::string message = "Failed to send audio to peer " + std::to_string(t) + ": 10054";
+
+            // Register this thread's ring outside the timed region
+            Logger::GetInstance().RegisterThread();
+            ready++;
+            while (!go) {
+            }
+
+            for (int i = 0; i < CALLS_PER_THREAD; i++) {
+                auto start = BenchClock::now();
+                switch (kind) {
+                    case CallKind::None:
+                        break;
+                    case CallKind::Format:
+                        LOG_ERROR_FMT("Failed to send audio to peer {}: {}", t, i);
+                        break;
+                    case CallKind::Literal:
+                        LOG_ERROR("Failed to send audio to peer");
+                        break;
+                    case CallKind::String:
+                        LOG_ERROR(message);
+                        break;
+                }
+                auto end = BenchClock::now();
+                samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+                SpinFor(PACE_NS);
+            }
+        });
+    }
+
+    while (ready < BENCH_THREADS) {
+    }
+    auto start = BenchClock::now();
+    go = true;
+    for (auto& thread : threads) {
+        thread.join();
+    }
+    auto producersDone = BenchClock::now();
+    Logger::GetInstance().Flush();
+    auto drained = BenchClock::now();
+
+    std::vector<double> all;
+    for (const auto& samples : latencies) {
+        all.insert(all.end(), samples.begin(), samples.end());
+    }
+    std::sort(all.begin(), all.end());
+
+    uint64_t dropped = Logger::GetInstance().GetDroppedCount() - droppedBefore;
+    std::printf("%-22s %8.0f %8.0f %8.0f %9.0f %10llu %9.1f %9.1f\n", name,
+                Percentile(all, 0.50), Percentile(all, 0.99), Percentile(all, 0.999), all.back(),
+                (unsigned long long)dropped,
+                std::chrono::duration<double, std::milli>(producersDone - start).count(),
+                std::chrono::duration<double, std::milli>(drained - producersDone).count());
+}
+
+int main() {
+    // Exercise the full writer path (formatting + batched file I/O) without
+    // flooding the terminal
+    Logger::GetInstance().SetConsoleOutput(false);
+    Logger::GetInstance().SetLogFile("voiceqwik_logger_bench.log");
+
+    std::printf("VoiceQwik logger benchmark: %d threads x %d calls, %d ns pacing, %u CPUs\n\n",
+                BENCH_THREADS, CALLS_PER_THREAD, PACE_NS, std::thread::hardware_concurrency());
+    std::printf("%-22s %8s %8s %8s %9s %10s %9s %9s\n", "call", "p50 ns", "p99 ns", "p99.9 ns",
+                "max ns", "dropped", "run ms", "drain ms");
+
+    RunScenario("baseline (no call)", CallKind::None);
+    RunScenario("LOG_ERROR_FMT(id, err)", CallKind::Format);
+    RunScenario("LOG_ERROR(literal)", CallKind::Literal);
+    RunScenario("LOG_ERROR(std::string)", CallKind::String);
+
+    std::printf("\nLatencies include one steady_clock::now() pair per call\n");
+    return 0;
+}
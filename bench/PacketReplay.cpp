@@ -0,0 +1,396 @@
+// Replays the inbound RTP of a packet capture (voiceqwik --capture, or any
+// pcap/pcapng of the audio port) through the receive pipeline: RTP and RED
+// parsing, payload decoding, RFC 3550 stream statistics, the playout queue
+// and the mixer. Reports what each stream (source address and SSRC) would
+// have sounded like and an FNV-1a digest of the mixed output, so two builds
+// can be compared on the exact same traffic.
+//
+// Virtual time: the capture's arrival times drive the playout clock, so a
+// run is a pure function of the file. With --speed 0 it runs as fast as
+// possible; --speed 1 paces it like the original call. It replays twice and
+// exits nonzero if the two digests differ.
+//
+//   voiceqwik_replay capture.pcapng [--playout-ms n] [--speed x] [--local-port n]
+//                    [--wav mix.wav]
+
+#include <audio/AudioMixer.h>
+#include <audio/PayloadCodec.h>
+#include <audio/WavFile.h>
+#include <networking/LatencyProbe.h>
+#include <networking/PacketCapture.h>
+#include <networking/PlayoutQueue.h>
+#include <networking/RedundantPayload.h>
+#include <networking/RtcpPacket.h>
+#include <networking/RtpPacket.h>
+#include <networking/RtpSourceStats.h>
+#include <platform/Timer.h>
+
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <tuple>
+#include <vector>
+
+constexpr PacketTime REPLAY_PTIME = DEFAULT_PACKET_TIME;   // the render loop's packet time
+constexpr uint32_t REPLAY_SAMPLES = SamplesPerPacket(REPLAY_PTIME);
+constexpr int64_t REPLAY_PTIME_MICROS = PacketTimeMicros(REPLAY_PTIME);
+
+struct ReplayOptions {
+    std::string captureFile;
+    double playoutMs = 60.0;      // from a stream's first arrival to its first playout
+    double speed = 0.0;           // 0 = as fast as possible
+    uint16_t localPort = 0;       // for captures without direction flags
+    std::string wavFile;
+};
+
+// Where a stream came from. Senders behind one address can pick the same
+// SSRC, so a source address and SSRC can hold more than one stream; index
+// tells them apart, in the order they showed up.
+struct StreamKey {
+    std::string source;
+    uint32_t ssrc;
+    uint32_t index;
+
+    bool operator<(const StreamKey& other) const {
+        return std::tie(source, ssrc, index) < std::tie(other.source, other.ssrc, other.index);
+    }
+};
+
+// One remote stream
+struct ReplayStream {
+    RtpSourceStats stats;
+    PlayoutQueue playout;
+    std::vector<int16_t> pending;   // popped samples not yet rendered
+    int64_t firstPlayoutMicros = 0;
+    uint64_t packets = 0;
+    uint64_t recovered = 0;         // rebuilt from RFC 2198 redundancy
+    uint64_t late = 0;
+    uint64_t duplicates = 0;
+    uint64_t reordered = 0;
+    uint64_t concealedTicks = 0;    // render ticks it had nothing (or not enough) to play
+    uint64_t playedTicks = 0;
+    std::vector<double> bufferDelaysMs;
+};
+
+struct ReplayResult {
+    uint64_t datagrams = 0;         // inbound UDP
+    uint64_t rtcp = 0;
+    uint64_t clockSync = 0;
+    uint64_t ignored = 0;           // outbound or not RTP
+    uint64_t ticks = 0;
+    uint64_t digest = 0;
+    double capturedSeconds = 0.0;
+    std::map<StreamKey, ReplayStream> streams;
+};
+
+static void Digest(uint64_t& digest, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        digest ^= (value >> (8 * i)) & 0xFF;
+        digest *= 0x100000001B3ull;
+    }
+}
+
+static double Percentile(std::vector<double>& values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = std::min(values.size() - 1, (size_t)(p * (values.size() - 1)));
+    return values[index];
+}
+
+static std::string FormatSource(const CapturedDatagram& datagram) {
+    char text[64];
+    const uint8_t* a = datagram.remoteAddress;
+    if (!datagram.remoteIpv6) {
+        std::snprintf(text, sizeof(text), "%u.%u.%u.%u:%u", a[0], a[1], a[2], a[3], datagram.remotePort);
+        return text;
+    }
+    std::string address = "[";
+    for (int i = 0; i < 16; i += 2) {
+        std::snprintf(text, sizeof(text), i ? ":%x" : "%x", (a[i] << 8) | a[i + 1]);
+        address += text;
+    }
+    std::snprintf(text, sizeof(text), "]:%u", datagram.remotePort);
+    return address + text;
+}
+
+// True if sequence is close enough to the highest seen to belong to stats'
+// stream (the same bounds as RtpSourceStats::Update)
+static bool ContinuesStream(const RtpSourceStats& stats, uint16_t sequence) {
+    if (!stats.IsInitialized()) return false;
+    uint16_t delta = (uint16_t)(sequence - (uint16_t)stats.GetExtendedHighestSequence());
+    return delta < RtpSourceStats::MAX_DROPOUT || delta > 0xFFFF - RtpSourceStats::MAX_MISORDER;
+}
+
+// The stream a packet belongs to among those sharing its source and SSRC:
+// the one its sequence continues, else the newest. A large jump back is a
+// second sender rather than the first going back in time; a large jump
+// forward is the newest restarting, as AudioStreamer treats it.
+static ReplayStream& FindStream(ReplayResult& result, const CapturedDatagram& datagram, const RTPHeader& header) {
+    StreamKey key{FormatSource(datagram), header.ssrc, 0};
+    auto first = result.streams.lower_bound(key);
+    auto newest = result.streams.end();
+    for (auto it = first; it != result.streams.end() && it->first.source == key.source &&
+                          it->first.ssrc == key.ssrc; ++it) {
+        if (ContinuesStream(it->second.stats, header.sequence)) return it->second;
+        newest = it;
+    }
+    if (newest == result.streams.end()) return result.streams[key];
+
+    uint16_t highest = (uint16_t)newest->second.stats.GetExtendedHighestSequence();
+    if (!RtpSequenceBefore(header.sequence, highest)) return newest->second;
+    key.index = newest->first.index + 1;
+    return result.streams[key];
+}
+
+static void QueueSamples(ReplayStream& stream, uint16_t sequence, int64_t now, const int16_t* samples,
+                         size_t count) {
+    PlayoutQueue::Insert insert = stream.playout.Add(sequence, now, samples, count);
+    if (insert == PlayoutQueue::Insert::Late) stream.late++;
+}
+
+// Same steps as AudioStreamer::HandleAudioPayload, minus the locking and metrics
+static void HandleRtp(ReplayResult& result, const CapturedDatagram& datagram, int64_t now, int64_t playoutMicros,
+                      std::array<int16_t, MAX_SAMPLES_PER_PACKET>& decoded) {
+    RTPHeader header{};
+    size_t headerSize = 0;
+    size_t payloadSize = 0;
+    if (!ParseRTPHeader(datagram.data, datagram.length, header, headerSize, payloadSize) || payloadSize == 0) {
+        result.ignored++;
+        return;
+    }
+
+    ReplayStream& stream = FindStream(result, datagram, header);
+    if (stream.packets++ == 0) {
+        // Playout starts on the render grid, the playout delay after the first packet
+        int64_t start = now + playoutMicros;
+        stream.firstPlayoutMicros = (start + REPLAY_PTIME_MICROS - 1) / REPLAY_PTIME_MICROS * REPLAY_PTIME_MICROS;
+    }
+
+    uint32_t arrivalRtp = (uint32_t)((uint64_t)now * AUDIO_SAMPLE_RATE / 1000000);
+    RtpSourceStats::Arrival arrival = stream.stats.Update(header.sequence, header.timestamp, arrivalRtp);
+    if (arrival == RtpSourceStats::Arrival::Duplicate) stream.duplicates++;
+    if (arrival == RtpSourceStats::Arrival::Reordered) stream.reordered++;
+    if (arrival == RtpSourceStats::Arrival::Restarted) stream.playout.Clear();
+
+    const uint8_t* payload = datagram.data + headerSize;
+    PayloadEncoding encoding;
+    if (header.payloadType != RTP_PAYLOAD_TYPE_RED) {
+        if (!EncodingForPayloadType(header.payloadType, encoding)) return;
+        size_t samples = DecodePayload(encoding, payload, payloadSize, decoded.data(), decoded.size());
+        if (samples > 0) QueueSamples(stream, header.sequence, now, decoded.data(), samples);
+        return;
+    }
+
+    RedundantBlock blocks[RED_MAX_REDUNDANCY + 1];
+    size_t count = ParseRedundantPayload(payload, payloadSize, blocks, RED_MAX_REDUNDANCY + 1);
+    if (count == 0) return;
+
+    if (EncodingForPayloadType(blocks[count - 1].payloadType, encoding)) {
+        size_t samples = DecodePayload(encoding, blocks[count - 1].data, blocks[count - 1].length,
+                                       decoded.data(), decoded.size());
+        if (samples > 0) QueueSamples(stream, header.sequence, now, decoded.data(), samples);
+    }
+    for (size_t i = 0; i + 1 < count; i++) {
+        uint16_t sequence = (uint16_t)(header.sequence - (count - 1 - i));
+        if (stream.playout.IsLate(sequence) || stream.playout.Contains(sequence)) continue;
+        if (!EncodingForPayloadType(blocks[i].payloadType, encoding)) continue;
+        size_t samples = DecodePayload(encoding, blocks[i].data, blocks[i].length, decoded.data(), decoded.size());
+        if (samples > 0 && stream.playout.Add(sequence, now, decoded.data(), samples) == PlayoutQueue::Insert::Queued) {
+            stream.recovered++;
+        }
+    }
+}
+
+// One render tick: every stream that has started playing contributes a
+// packet time of samples, concealed with silence where it has none
+static void RenderTick(ReplayResult& result, int64_t now, AudioMixer& mixer, AudioBuffer& mixed,
+                       WavWriter* wav) {
+    mixer.Begin();
+    AudioBuffer popped;
+    for (auto& entry : result.streams) {
+        ReplayStream& stream = entry.second;
+        if (stream.packets == 0 || now < stream.firstPlayoutMicros) continue;
+
+        int64_t arrivalMicros = 0;
+        while (stream.pending.size() < REPLAY_SAMPLES && stream.playout.Pop(popped, arrivalMicros)) {
+            stream.pending.insert(stream.pending.end(), popped.begin(), popped.end());
+            stream.bufferDelaysMs.push_back((now - arrivalMicros) / 1000.0);
+        }
+        if (stream.pending.size() < REPLAY_SAMPLES) {
+            stream.concealedTicks++;
+            stream.pending.resize(REPLAY_SAMPLES, 0);
+        }
+        stream.playedTicks++;
+        mixer.AddSource(stream.pending.data(), REPLAY_SAMPLES);
+        stream.pending.erase(stream.pending.begin(), stream.pending.begin() + REPLAY_SAMPLES);
+    }
+
+    if (!mixer.Finish(mixed)) {
+        mixed.assign(REPLAY_SAMPLES, 0);
+    }
+    for (int16_t sample : mixed) Digest(result.digest, (uint16_t)sample);
+    if (wav) wav->Write(mixed.data(), mixed.size());
+    result.ticks++;
+}
+
+static bool Replay(const ReplayOptions& options, double speed, WavWriter* wav, ReplayResult& result) {
+    PacketCaptureReader reader;
+    if (!reader.Open(options.captureFile)) return false;
+
+    result = ReplayResult{};
+    result.digest = 0xCBF29CE484222325ull;
+    const int64_t playoutMicros = (int64_t)(options.playoutMs * 1000.0);
+
+    std::array<int16_t, MAX_SAMPLES_PER_PACKET> decoded{};
+    AudioMixer mixer;
+    AudioBuffer mixed;
+    CapturedDatagram datagram;
+
+    bool started = false;
+    int64_t firstMicros = 0;
+    int64_t nextTick = 0;             // virtual time, from the first datagram
+    int64_t lastArrival = 0;
+    int64_t wallStart = LatencyClockMicros();
+
+    auto advanceTo = [&](int64_t now) {
+        while (nextTick <= now) {
+            if (speed > 0.0) {
+                int64_t due = wallStart + (int64_t)(nextTick / speed);
+                int64_t wait = due - LatencyClockMicros();
+                if (wait > 1000) SleepMillis((uint32_t)(wait / 1000));
+            }
+            RenderTick(result, nextTick, mixer, mixed, wav);
+            nextTick += REPLAY_PTIME_MICROS;
+        }
+    };
+
+    while (reader.Next(datagram, options.localPort)) {
+        if (datagram.direction != CaptureDirection::Inbound) {
+            result.ignored++;
+            continue;
+        }
+        if (!started) {
+            started = true;
+            firstMicros = datagram.micros;
+        }
+
+        // Captures can be a little out of time order across producers
+        int64_t now = std::max(lastArrival, datagram.micros - firstMicros);
+        lastArrival = now;
+        advanceTo(now - 1);
+        result.datagrams++;
+        Digest(result.digest, (uint64_t)now);
+
+        if (IsClockSync(datagram.data, datagram.length)) {
+            result.clockSync++;
+            continue;
+        }
+        if (IsRtcpPacket(datagram.data, datagram.length)) {
+            result.rtcp++;
+            continue;
+        }
+
+        HandleRtp(result, datagram, now, playoutMicros, decoded);
+    }
+
+    // Play out what is still buffered
+    bool buffered = true;
+    while (started && buffered) {
+        buffered = false;
+        for (const auto& entry : result.streams) {
+            if (!entry.second.playout.Empty() || !entry.second.pending.empty()) buffered = true;
+        }
+        if (buffered) advanceTo(nextTick);
+    }
+
+    result.capturedSeconds = lastArrival / 1000000.0;
+    return true;
+}
+
+static bool ParseOptions(int argc, char** argv, ReplayOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--playout-ms" && hasValue) {
+            options.playoutMs = std::atof(argv[++i]);
+        } else if (arg == "--speed" && hasValue) {
+            options.speed = std::atof(argv[++i]);
+        } else if (arg == "--local-port" && hasValue) {
+            options.localPort = (uint16_t)std::atoi(argv[++i]);
+        } else if (arg == "--wav" && hasValue) {
+            options.wavFile = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && options.captureFile.empty()) {
+            options.captureFile = arg;
+        } else {
+            return false;
+        }
+    }
+    return !options.captureFile.empty() && options.playoutMs >= 0.0 && options.speed >= 0.0;
+}
+
+int main(int argc, char** argv) {
+    ReplayOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr, "usage: %s capture.pcapng [--playout-ms n] [--speed x] [--local-port n] "
+                             "[--wav mix.wav]\n",
+                     argv[0]);
+        return 2;
+    }
+
+    WavWriter wav;
+    if (!options.wavFile.empty() && !wav.Open(options.wavFile, WavFormat{AUDIO_SAMPLE_RATE, AUDIO_CHANNELS})) {
+        std::fprintf(stderr, "Cannot create %s\n", options.wavFile.c_str());
+        return 1;
+    }
+
+    ReplayResult result;
+    if (options.speed > 0.0) AcquireTimerResolution();
+    bool replayed = Replay(options, options.speed, wav.IsOpen() ? &wav : nullptr, result);
+    if (options.speed > 0.0) ReleaseTimerResolution();
+    if (wav.IsOpen()) wav.Close();
+    if (!replayed) {
+        std::fprintf(stderr, "Cannot read %s\n", options.captureFile.c_str());
+        return 1;
+    }
+
+    ReplayResult again;
+    Replay(options, 0.0, nullptr, again);
+    bool deterministic = again.digest == result.digest && again.ticks == result.ticks;
+
+    std::printf("VoiceQwik replay: %s, %.1f s captured, %llu inbound datagrams (%llu RTCP, %llu clock sync), "
+                "%llu ignored\n",
+                options.captureFile.c_str(), result.capturedSeconds, (unsigned long long)result.datagrams,
+                (unsigned long long)result.rtcp, (unsigned long long)result.clockSync,
+                (unsigned long long)result.ignored);
+    std::printf("%s render ticks, %.0f ms playout delay, %llu ticks mixed\n\n", PacketTimeToString(REPLAY_PTIME),
+                options.playoutMs, (unsigned long long)result.ticks);
+    std::printf("%-21s %-10s %7s %6s %6s %5s %5s %5s %7s %6s %7s %7s %7s\n", "source", "ssrc", "packets", "lost",
+                "recov", "late", "reord", "dup", "conceal", "jit ms", "buf p50", "buf p95", "buf p99");
+
+    for (auto& entry : result.streams) {
+        ReplayStream& stream = entry.second;
+        double concealed = stream.playedTicks ? 100.0 * stream.concealedTicks / stream.playedTicks : 0.0;
+        // Duplicates can outnumber losses; the dup column already counts them
+        int32_t lost = std::max(0, stream.stats.GetCumulativeLost());
+        // A second stream on the same source and SSRC shows as ssrc#2
+        char ssrc[24];
+        int length = std::snprintf(ssrc, sizeof(ssrc), "%08x", entry.first.ssrc);
+        if (entry.first.index > 0) {
+            std::snprintf(ssrc + length, sizeof(ssrc) - length, "#%u", entry.first.index + 1);
+        }
+        std::printf("%-21s %-10s %7llu %6d %6llu %5llu %5llu %5llu %6.2f%% %6.2f %7.1f %7.1f %7.1f\n",
+                    entry.first.source.c_str(), ssrc, (unsigned long long)stream.packets, lost,
+                    (unsigned long long)stream.recovered, (unsigned long long)stream.late,
+                    (unsigned long long)stream.reordered, (unsigned long long)stream.duplicates, concealed,
+                    stream.stats.GetJitter() * 1000.0 / AUDIO_SAMPLE_RATE,
+                    Percentile(stream.bufferDelaysMs, 0.50), Percentile(stream.bufferDelaysMs, 0.95),
+                    Percentile(stream.bufferDelaysMs, 0.99));
+    }
+
+    std::printf("\ndigest %016llx%s\n", (unsigned long long)result.digest,
+                deterministic ? "" : " (NOT DETERMINISTIC: a second replay differed)");
+    return deterministic ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+// Per-packet CPU cost and header overhead for every supported packet time.
+// Headless: only uses the platform-neutral audio/RTP code.
+
+#include <audio/AudioFormat.h>
+#include <audio/AudioMixer.h>
+#include <audio/FrameKernels.h>
+#include <networking/RtpPacket.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <vector>
+
+constexpr int MIXED_PEERS = 3;
+constexpr int ITERATIONS = 20000;
+constexpr int REPETITIONS = 7;
+
+static volatile uint32_t sink;
+
+struct PacketCost {
+    double sendNs;
+    double receiveNs;
+    double mixNs;
+};
+
+template <typename Fn>
+static double MedianNsPerIteration(Fn&& fn) {
+    std::vector<double> samples;
+    for (int rep = 0; rep < REPETITIONS; rep++) {
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < ITERATIONS; i++) {
+            fn(i);
+        }
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        samples.push_back(std::chrono::duration<double, std::nano>(elapsed).count() / ITERATIONS);
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+static PacketCost MeasurePacketTime(PacketTime ptime) {
+    const uint32_t samples = SamplesPerPacket(ptime);
+    std::mt19937 rng(1234);
+    std::uniform_int_distribution<int> dist(-12000, 12000);
+
+    std::vector<AudioBuffer> peers(MIXED_PEERS, AudioBuffer(samples));
+    for (auto& peer : peers) {
+        for (auto& s : peer) s = (int16_t)dist(rng);
+    }
+
+    std::array<uint8_t, MAX_RTP_PACKET_SIZE> packet{};
+    AudioBuffer received(samples);
+    AudioBuffer mixed;
+    AudioMixer mixer;
+
+    PacketCost cost{};
+
+    // Send: header + payload copy into the reusable packet buffer
+    cost.sendNs = MedianNsPerIteration([&](int i) {
+        RTPHeader header{false, 111, (uint16_t)i, (uint32_t)i * samples, 0x1234};
+        WriteRTPHeader(packet.data(), header);
+        FrameKernels::Copy((int16_t*)(packet.data() + RTP_HEADER_SIZE), peers[0].data(), samples);
+        sink = packet[RTP_HEADER_SIZE + (i % samples)];
+    });
+
+    // Receive: header parse + payload copy out of the datagram
+    size_t packetSize = RTP_HEADER_SIZE + samples * sizeof(int16_t);
+    cost.receiveNs = MedianNsPerIteration([&](int i) {
+        RTPHeader header{};
+        size_t headerSize = 0;
+        size_t payloadSize = 0;
+        ParseRTPHeader(packet.data(), packetSize, header, headerSize, payloadSize);
+        FrameKernels::Copy(received.data(), (const int16_t*)(packet.data() + headerSize),
+                           (uint32_t)(payloadSize / sizeof(int16_t)));
+        sink = (uint32_t)received[i % samples];
+    });
+
+    // Mix: one packet from each peer into a saturated playback packet
+    cost.mixNs = MedianNsPerIteration([&](int i) {
+        mixer.Begin();
+        for (const auto& peer : peers) {
+            mixer.AddSource(peer);
+        }
+        mixer.Finish(mixed);
+        sink = (uint32_t)mixed[i % samples];
+    });
+
+    return cost;
+}
+
+int main() {
+    std::printf("VoiceQwik packet time benchmark (%d-peer mix, median of %d x %d iterations)\n\n",
+                MIXED_PEERS, REPETITIONS, ITERATIONS);
+    std::printf("%-7s %7s %8s %9s %9s %9s %9s %10s %9s %10s\n",
+                "ptime", "samples", "pkts/s", "send ns", "recv ns", "mix ns", "ns/ms",
+                "hdr bytes", "overhead", "wire kbps");
+
+    for (PacketTime ptime : ALL_PACKET_TIMES) {
+        PacketCost cost = MeasurePacketTime(ptime);
+
+        double ptimeMs = PacketTimeMicros(ptime) / 1000.0;
+        double packetsPerSecond = 1000.0 / ptimeMs;
+        double totalNs = cost.sendNs + cost.receiveNs + cost.mixNs;
+        size_t payloadBytes = SamplesPerPacket(ptime) * sizeof(int16_t);
+        size_t headerBytes = RTP_HEADER_SIZE + IPV4_UDP_OVERHEAD;
+        double overhead = 100.0 * headerBytes / (double)(headerBytes + payloadBytes);
+        double wireKbps = (headerBytes + payloadBytes) * 8.0 * packetsPerSecond / 1000.0;
+
+        std::printf("%-7s %7u %8.0f %9.1f %9.1f %9.1f %9.1f %10zu %8.2f%% %10.1f\n",
+                    PacketTimeToString(ptime), SamplesPerPacket(ptime), packetsPerSecond,
+                    cost.sendNs, cost.receiveNs, cost.mixNs, totalNs / ptimeMs,
+                    headerBytes, overhead, wireKbps);
+    }
+
+    std::printf("\nns/ms = send+recv+mix CPU per millisecond of audio; overhead = RTP+UDP+IPv4 share of each datagram\n");
+    return 0;
+}
@@ -0,0 +1,535 @@
+// Media path selection, failover and session resume check. Builds two
+// network namespaces joined by veth links with IPv4 and IPv6, and runs a
+// voiceqwik_headless peer in each; the joiner connects over the "wireless"
+// link (netem delay). Scenarios:
+//
+//   failover  a fast "wired" link too, which both peers have to find by their
+//             connectivity checks; partway through it goes down and both must
+//             fall back to the wireless one. Without netem in the kernel the
+//             links are equally fast: then the link the joiner is sending on
+//             goes down, and whoever used it must fail over.
+//   blip      the wireless link only; it goes down for --outage-ms, and once
+//             it is back both peers' audio must flow again.
+//   roam      the wireless link only; the joiner's addresses change (.2 to .3,
+//             ::2 to ::3) as on a new network, so it must resume its session
+//             from the new address and both peers' audio must flow again.
+//
+// Linux only, and needs root (ip netns). Fails if a peer fails, or misses
+// the scenario's goal or its time limit.
+//
+//   voiceqwik_path_runner [--scenario failover|blip|roam] [--duration s] [--drop-at s]
+//                         [--wireless-delay-ms n] [--max-failover-ms n] [--outage-ms n]
+//                         [--max-resume-ms n] [--ipv6] [--base-port n]
+
+#include <poll.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+extern char** environ;
+
+constexpr int RUNNER_JOIN_DELAY_MS = 300;       // host is listening before the joiner connects
+constexpr int RUNNER_GRACE_SECONDS = 15;        // on top of the call duration, for setup and teardown
+
+constexpr const char* HOST_NAMESPACE = "vqpath_host";
+constexpr const char* JOINER_NAMESPACE = "vqpath_join";
+constexpr const char* WIRED_HOST_IF = "vqwired0";
+constexpr const char* WIRED_JOINER_IF = "vqwired1";
+constexpr const char* WIRELESS_HOST_IF = "vqwless0";
+constexpr const char* WIRELESS_JOINER_IF = "vqwless1";
+
+constexpr const char* KEEP_V6_ADDRESSES = " sysctl -w net.ipv6.conf.all.keep_addr_on_down=1";
+
+// Host is .1 / ::1, joiner .2 / ::2 on each link (.3 / ::3 after a roam)
+constexpr const char* WIRED_V4 = "10.77.1.";
+constexpr const char* WIRED_V6 = "fd77:1::";
+constexpr const char* WIRELESS_V4 = "10.77.2.";
+constexpr const char* WIRELESS_V6 = "fd77:2::";
+
+enum class Scenario {
+    Failover,
+    Blip,
+    Roam
+};
+
+struct RunnerOptions {
+    Scenario scenario = Scenario::Failover;
+    double durationSeconds = 8.0;
+    double dropAtSeconds = 4.0;   // or the roam
+    int wirelessDelayMs = 10;     // each way
+    int maxFailoverMs = 2500;
+    int outageMs = 3000;          // blip: how long the link stays down
+    int maxResumeMs = 3000;       // blip: from the link coming back; roam: from the roam
+    bool ipv6 = false;            // control connection over IPv6
+    int basePort = 15100;
+};
+
+struct ChildPeer {
+    const char* role;
+    double startSeconds = 0.0;    // when it was spawned, on the runner's clock
+    pid_t pid = -1;
+    int outputFd = -1;
+    std::string output;
+    int status = 0;
+};
+
+enum class LinkKind {
+    Unknown,
+    Wired,
+    Wireless
+};
+
+struct PathChange {
+    double seconds;   // runner clock
+    LinkKind kind;
+};
+
+// What the runner did to the network, on its clock
+struct Disruption {
+    LinkKind droppedLink = LinkKind::Unknown;
+    double startSeconds = 0.0;      // link down, or the roam
+    double restoredSeconds = 0.0;   // blip: link back up; roam: the roam
+};
+
+static bool ParseOptions(int argc, char** argv, RunnerOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--ipv6") {
+            options.ipv6 = true;
+            continue;
+        }
+        if (i + 1 >= argc) return false;
+        if (arg == "--scenario") {
+            std::string name = argv[++i];
+            if (name == "failover") {
+                options.scenario = Scenario::Failover;
+            } else if (name == "blip") {
+                options.scenario = Scenario::Blip;
+            } else if (name == "roam") {
+                options.scenario = Scenario::Roam;
+            } else {
+                return false;
+            }
+        } else if (arg == "--duration") {
+            options.durationSeconds = std::atof(argv[++i]);
+        } else if (arg == "--drop-at") {
+            options.dropAtSeconds = std::atof(argv[++i]);
+        } else if (arg == "--wireless-delay-ms") {
+            options.wirelessDelayMs = std::atoi(argv[++i]);
+        } else if (arg == "--max-failover-ms") {
+            options.maxFailoverMs = std::atoi(argv[++i]);
+        } else if (arg == "--outage-ms") {
+            options.outageMs = std::atoi(argv[++i]);
+        } else if (arg == "--max-resume-ms") {
+            options.maxResumeMs = std::atoi(argv[++i]);
+        } else if (arg == "--base-port") {
+            options.basePort = std::atoi(argv[++i]);
+        } else {
+            return false;
+        }
+    }
+    return options.dropAtSeconds > 0.0 && options.durationSeconds > options.dropAtSeconds &&
+           options.wirelessDelayMs > 0 && options.maxFailoverMs > 0 &&
+           options.outageMs > 0 && options.maxResumeMs > 0 &&
+           options.basePort > 0 && options.basePort < 65535;
+}
+
+// voiceqwik_headless sits next to this binary in the build output
+static std::string HeadlessPath() {
+    char self[PATH_MAX];
+    ssize_t length = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if (length <= 0) return "voiceqwik_headless";
+    std::string path(self, (size_t)length);
+    size_t slash = path.rfind('/');
+    return path.substr(0, slash + 1) + "voiceqwik_headless";
+}
+
+static bool Run(const std::string& command) {
+    int status = std::system((command + " >/dev/null 2>&1").c_str());
+    if (status != 0) std::fprintf(stderr, "failed: %s\n", command.c_str());
+    return status == 0;
+}
+
+static void RemoveNamespaces() {
+    // Deleting a namespace takes its veth ends, and so both links, with it
+    std::system((std::string("ip netns del ") + HOST_NAMESPACE + " >/dev/null 2>&1").c_str());
+    std::system((std::string("ip netns del ") + JOINER_NAMESPACE + " >/dev/null 2>&1").c_str());
+}
+
+static bool AddLink(const char* hostIf, const char* joinerIf, const char* v4, const char* v6) {
+    std::string host = std::string("ip -n ") + HOST_NAMESPACE + " ";
+    std::string joiner = std::string("ip -n ") + JOINER_NAMESPACE + " ";
+    bool ok = Run(host + "link add " + hostIf + " type veth peer name " + joinerIf + " netns " + JOINER_NAMESPACE) &&
+              Run(host + "addr add " + v4 + "1/24 dev " + hostIf) &&
+              Run(joiner + "addr add " + v4 + "2/24 dev " + joinerIf) &&
+              Run(host + "-6 addr add " + v6 + "1/64 dev " + hostIf + " nodad") &&
+              Run(joiner + "-6 addr add " + v6 + "2/64 dev " + joinerIf + " nodad") &&
+              Run(host + "link set " + hostIf + " up") &&
+              Run(joiner + "link set " + joinerIf + " up");
+    return ok;
+}
+
+// Both directions of a link; false if the kernel has no netem
+static bool AddDelay(const char* hostIf, const char* joinerIf, int delayMs) {
+    std::string delay = " root netem delay " + std::to_string(delayMs) + "ms >/dev/null 2>&1";
+    return std::system((std::string("ip netns exec ") + HOST_NAMESPACE + " tc qdisc add dev " + hostIf +
+                        delay).c_str()) == 0 &&
+           std::system((std::string("ip netns exec ") + JOINER_NAMESPACE + " tc qdisc add dev " + joinerIf +
+                        delay).c_str()) == 0;
+}
+
+static bool SetUpNamespaces(const RunnerOptions& options, bool& delayed) {
+    RemoveNamespaces();
+    // IPv6 addresses must outlive a link going down, as IPv4 ones do
+    bool ok = Run(std::string("ip netns add ") + HOST_NAMESPACE) &&
+              Run(std::string("ip netns add ") + JOINER_NAMESPACE) &&
+              Run(std::string("ip -n ") + HOST_NAMESPACE + " link set lo up") &&
+              Run(std::string("ip -n ") + JOINER_NAMESPACE + " link set lo up") &&
+              Run(std::string("ip netns exec ") + HOST_NAMESPACE + KEEP_V6_ADDRESSES) &&
+              Run(std::string("ip netns exec ") + JOINER_NAMESPACE + KEEP_V6_ADDRESSES) &&
+              (options.scenario != Scenario::Failover || AddLink(WIRED_HOST_IF, WIRED_JOINER_IF, WIRED_V4, WIRED_V6)) &&
+              AddLink(WIRELESS_HOST_IF, WIRELESS_JOINER_IF, WIRELESS_V4, WIRELESS_V6);
+    delayed = ok && AddDelay(WIRELESS_HOST_IF, WIRELESS_JOINER_IF, options.wirelessDelayMs);
+    return ok;
+}
+
+// The joiner moves to .3 / ::3 on the wireless link, its old addresses gone
+static bool Roam() {
+    std::string joiner = std::string("ip -n ") + JOINER_NAMESPACE + " ";
+    return Run(joiner + "addr del " + WIRELESS_V4 + "2/24 dev " + WIRELESS_JOINER_IF) &&
+           Run(joiner + "-6 addr del " + WIRELESS_V6 + "2/64 dev " + WIRELESS_JOINER_IF) &&
+           Run(joiner + "addr add " + WIRELESS_V4 + "3/24 dev " + WIRELESS_JOINER_IF) &&
+           Run(joiner + "-6 addr add " + WIRELESS_V6 + "3/64 dev " + WIRELESS_JOINER_IF + " nodad");
+}
+
+static bool SpawnPeer(const char* netns, const std::string& path, const std::vector<std::string>& args,
+                      ChildPeer& child) {
+    int pipeFds[2];
+    if (pipe(pipeFds) != 0) return false;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDERR_FILENO);
+    posix_spawn_file_actions_addclose(&actions, pipeFds[0]);
+
+    std::vector<std::string> command = {"ip", "netns", "exec", netns, path};
+    command.insert(command.end(), args.begin(), args.end());
+    std::vector<char*> argv;
+    for (const auto& arg : command) argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(nullptr);
+
+    int result = posix_spawnp(&child.pid, "ip", &actions, nullptr, argv.data(), environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipeFds[1]);
+    if (result != 0) {
+        close(pipeFds[0]);
+        child.pid = -1;
+        return false;
+    }
+    child.outputFd = pipeFds[0];
+    return true;
+}
+
+static double SecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static LinkKind ClassifyPath(const std::string& path) {
+    std::string address = path[0] == '[' ? path.substr(1) : path;
+    if (address.compare(0, 8, WIRED_V4) == 0 || address.compare(0, 8, WIRED_V6) == 0) return LinkKind::Wired;
+    if (address.compare(0, 8, WIRELESS_V4) == 0 || address.compare(0, 8, WIRELESS_V6) == 0) return LinkKind::Wireless;
+    return LinkKind::Unknown;
+}
+
+// The peer's path changes so far ("  2.1 s: peer 1 media path 10.77.1.1:15100")
+static std::vector<PathChange> ParsePathChanges(const ChildPeer& child) {
+    std::vector<PathChange> changes;
+    size_t start = 0;
+    while (start < child.output.size()) {
+        size_t end = child.output.find('\n', start);
+        if (end == std::string::npos) end = child.output.size();
+        std::string line = child.output.substr(start, end - start);
+        start = end + 1;
+
+        double seconds = 0.0;
+        unsigned peer = 0;
+        char path[80];
+        if (std::sscanf(line.c_str(), "%lf s: peer %u media path %79s", &seconds, &peer, path) != 3) continue;
+        changes.push_back({seconds + child.startSeconds, ClassifyPath(path)});
+    }
+    return changes;
+}
+
+// When the peer printed event ("audio flowing", "session resumed") about
+// its peer, on the runner clock
+static std::vector<double> ParseEvents(const ChildPeer& child, const char* event) {
+    std::vector<double> times;
+    size_t start = 0;
+    while (start < child.output.size()) {
+        size_t end = child.output.find('\n', start);
+        if (end == std::string::npos) end = child.output.size();
+        std::string line = child.output.substr(start, end - start);
+        start = end + 1;
+
+        double seconds = 0.0;
+        unsigned peer = 0;
+        int consumed = 0;
+        if (std::sscanf(line.c_str(), "%lf s: peer %u %n", &seconds, &peer, &consumed) != 2 || consumed == 0) continue;
+        if (std::strcmp(line.c_str() + consumed, event) == 0) times.push_back(seconds + child.startSeconds);
+    }
+    return times;
+}
+
+static double FirstAfter(const std::vector<double>& times, double seconds) {
+    for (double time : times) {
+        if (time >= seconds) return time;
+    }
+    return -1.0;
+}
+
+static LinkKind PathAt(const std::vector<PathChange>& changes, double seconds) {
+    LinkKind kind = LinkKind::Unknown;
+    for (const auto& change : changes) {
+        if (change.seconds < seconds) kind = change.kind;
+    }
+    return kind;
+}
+
+static const char* LinkName(LinkKind kind) {
+    return kind == LinkKind::Wired ? "wired" : kind == LinkKind::Wireless ? "wireless" : "unknown";
+}
+
+// Collects both peers' output until they exit or the deadline passes,
+// disrupting the network at dropAtSeconds (runner clock, from start). For a
+// failover that takes the wired link down, or with equally fast links the
+// one the joiner sends on; a blip takes the wireless link down for the
+// outage; a roam moves the joiner to new addresses.
+static void Supervise(std::vector<ChildPeer>& children, std::chrono::steady_clock::time_point start,
+                      double timeoutSeconds, const RunnerOptions& options, bool delayed, Disruption& disruption) {
+    bool started = false;
+    bool restored = false;
+    char buffer[4096];
+    while (SecondsSince(start) < timeoutSeconds) {
+        if (!started && SecondsSince(start) >= options.dropAtSeconds) {
+            started = true;
+            if (options.scenario == Scenario::Roam) {
+                Roam();
+                disruption.startSeconds = disruption.restoredSeconds = SecondsSince(start);
+                restored = true;
+                std::printf("%6.1f s: joiner roamed to %s3 / %s3\n", disruption.startSeconds, WIRELESS_V4,
+                            WIRELESS_V6);
+            } else {
+                disruption.droppedLink = options.scenario == Scenario::Blip ? LinkKind::Wireless : LinkKind::Wired;
+                if (!delayed && options.scenario == Scenario::Failover &&
+                    PathAt(ParsePathChanges(children[1]), SecondsSince(start)) == LinkKind::Wireless) {
+                    disruption.droppedLink = LinkKind::Wireless;
+                }
+                const char* hostIf = disruption.droppedLink == LinkKind::Wired ? WIRED_HOST_IF : WIRELESS_HOST_IF;
+                Run(std::string("ip -n ") + HOST_NAMESPACE + " link set " + hostIf + " down");
+                disruption.startSeconds = SecondsSince(start);
+                std::printf("%6.1f s: %s link down\n", disruption.startSeconds, LinkName(disruption.droppedLink));
+            }
+            std::fflush(stdout);
+        }
+        if (started && !restored && options.scenario == Scenario::Blip &&
+            SecondsSince(start) >= disruption.startSeconds + options.outageMs / 1000.0) {
+            restored = true;
+            Run(std::string("ip -n ") + HOST_NAMESPACE + " link set " + WIRELESS_HOST_IF + " up");
+            disruption.restoredSeconds = SecondsSince(start);
+            std::printf("%6.1f s: %s link up\n", disruption.restoredSeconds, LinkName(disruption.droppedLink));
+            std::fflush(stdout);
+        }
+
+        std::vector<pollfd> fds;
+        std::vector<ChildPeer*> owners;
+        for (auto& child : children) {
+            if (child.outputFd >= 0) {
+                fds.push_back(pollfd{child.outputFd, POLLIN, 0});
+                owners.push_back(&child);
+            }
+        }
+        if (fds.empty()) break;
+
+        if (poll(fds.data(), fds.size(), 20) <= 0) continue;
+
+        for (size_t i = 0; i < fds.size(); i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+            ssize_t received = read(fds[i].fd, buffer, sizeof(buffer));
+            if (received > 0) {
+                owners[i]->output.append(buffer, (size_t)received);
+            } else {
+                close(owners[i]->outputFd);
+                owners[i]->outputFd = -1;
+            }
+        }
+    }
+
+    for (auto& child : children) {
+        if (child.pid <= 0) continue;
+        if (child.outputFd >= 0) {
+            kill(child.pid, SIGKILL);
+            close(child.outputFd);
+            child.outputFd = -1;
+            child.output += "(killed: did not finish in time)\n";
+        }
+        waitpid(child.pid, &child.status, 0);
+    }
+}
+
+// Wired when the drop came (if the links differ), and off the dropped link
+// within the failover limit
+static bool CheckPaths(const ChildPeer& child, const RunnerOptions& options, bool delayed,
+                       const Disruption& disruption, std::string& verdict) {
+    LinkKind droppedLink = disruption.droppedLink;
+    double droppedSeconds = disruption.startSeconds;
+    std::vector<PathChange> changes = ParsePathChanges(child);
+    LinkKind before = PathAt(changes, droppedSeconds);
+    if (droppedLink == LinkKind::Unknown || changes.empty()) {
+        verdict = "no path selected before the link went down";
+        return false;
+    }
+    if (delayed && before != LinkKind::Wired) {
+        verdict = "did not select the wired path";
+        return false;
+    }
+
+    const PathChange& last = changes.back();
+    if (before != droppedLink) {
+        verdict = std::string("stayed on the ") + LinkName(before) + " path";
+        return last.kind == before;
+    }
+    if (last.kind == droppedLink || last.kind == LinkKind::Unknown || last.seconds < droppedSeconds) {
+        verdict = std::string("did not fail over from the ") + LinkName(droppedLink) + " path";
+        return false;
+    }
+
+    double failoverMs = (last.seconds - droppedSeconds) * 1000.0;
+    char text[96];
+    std::snprintf(text, sizeof(text), "failed over to the %s path in %.0f ms", LinkName(last.kind), failoverMs);
+    verdict = text;
+    return failoverMs <= options.maxFailoverMs;
+}
+
+// The other peer's audio flowing again within the resume limit of the link
+// coming back (blip) or the roam, which must also have resumed the session
+static bool CheckResume(const ChildPeer& child, const RunnerOptions& options, const Disruption& disruption,
+                        std::string& verdict) {
+    if (disruption.restoredSeconds <= 0.0) {
+        verdict = "the network was never disrupted";
+        return false;
+    }
+    if (options.scenario == Scenario::Roam &&
+        FirstAfter(ParseEvents(child, "session resumed"), disruption.startSeconds) < 0.0) {
+        verdict = "did not resume the session";
+        return false;
+    }
+    double flowing = FirstAfter(ParseEvents(child, "audio flowing"), disruption.startSeconds);
+    if (flowing < 0.0) {
+        verdict = "audio did not come back";
+        return false;
+    }
+
+    // Peers print times to 0.1 s, so audio back right away can read as a bit early
+    double resumeMs = std::max(0.0, (flowing - disruption.restoredSeconds) * 1000.0);
+    char text[96];
+    std::snprintf(text, sizeof(text), "audio back %.0f ms after the %s", resumeMs,
+                  options.scenario == Scenario::Roam ? "roam" : "link came back");
+    verdict = text;
+    return resumeMs <= options.maxResumeMs;
+}
+
+int main(int argc, char** argv) {
+    RunnerOptions options;
+    if (!ParseOptions(argc, argv, options)) {
+        std::fprintf(stderr,
+                     "usage: %s [--scenario failover|blip|roam] [--duration s] [--drop-at s]\n"
+                     "          [--wireless-delay-ms n] [--max-failover-ms n] [--outage-ms n]\n"
+                     "          [--max-resume-ms n] [--ipv6] [--base-port n]\n",
+                     argv[0]);
+        return 2;
+    }
+    if (geteuid() != 0) {
+        std::fprintf(stderr, "%s needs root to create network namespaces\n", argv[0]);
+        return 1;
+    }
+
+    bool delayed = false;
+    if (!SetUpNamespaces(options, delayed)) {
+        std::fprintf(stderr, "Failed to set up the network namespaces\n");
+        RemoveNamespaces();
+        return 1;
+    }
+    if (!delayed && options.scenario == Scenario::Failover) {
+        std::printf("No netem in this kernel: both links are equally fast, so only failover is checked\n");
+    }
+
+    std::string headless = HeadlessPath();
+    std::string duration = std::to_string(options.durationSeconds);
+    std::string hostPort = std::to_string(options.basePort);
+    std::string joinerPort = std::to_string(options.basePort + 1);
+    std::string target = options.ipv6 ? "[" + std::string(WIRELESS_V6) + "1]:" + hostPort :
+                                        std::string(WIRELESS_V4) + "1:" + hostPort;
+
+    std::vector<std::string> common = {"--participants", "2", "--duration", duration, "--device", "tone"};
+    std::vector<std::string> hostArgs = {"--port", hostPort};
+    hostArgs.insert(hostArgs.end(), common.begin(), common.end());
+    std::vector<std::string> joinerArgs = {"--port", joinerPort, "--connect", target};
+    joinerArgs.insert(joinerArgs.end(), common.begin(), common.end());
+
+    const char* disruptionName = options.scenario == Scenario::Roam ? "the joiner roams" :
+                                 options.scenario == Scenario::Blip ? "the link blips" : "a link drops";
+    std::printf("Path run: %.1f s call, joiner connects to %s over the wireless link (%d ms each way), "
+                "%s at %.1f s\n",
+                options.durationSeconds, target.c_str(), delayed ? options.wirelessDelayMs : 0, disruptionName,
+                options.dropAtSeconds);
+    std::fflush(stdout);
+
+    std::vector<ChildPeer> children(2);
+    children[0].role = "host";
+    children[1].role = "joiner";
+    auto start = std::chrono::steady_clock::now();
+    if (!SpawnPeer(HOST_NAMESPACE, headless, hostArgs, children[0])) {
+        std::fprintf(stderr, "Failed to start %s\n", headless.c_str());
+        RemoveNamespaces();
+        return 1;
+    }
+    usleep(RUNNER_JOIN_DELAY_MS * 1000);
+    children[1].startSeconds = SecondsSince(start);
+    if (!SpawnPeer(JOINER_NAMESPACE, headless, joinerArgs, children[1])) {
+        std::fprintf(stderr, "Failed to start %s\n", headless.c_str());
+        kill(children[0].pid, SIGTERM);
+        waitpid(children[0].pid, nullptr, 0);
+        RemoveNamespaces();
+        return 1;
+    }
+
+    Disruption disruption;
+    Supervise(children, start, options.durationSeconds + RUNNER_GRACE_SECONDS, options, delayed, disruption);
+    RemoveNamespaces();
+
+    bool passed = true;
+    for (const auto& child : children) {
+        std::string verdict;
+        bool exited = WIFEXITED(child.status) && WEXITSTATUS(child.status) == 0;
+        bool ok = (options.scenario == Scenario::Failover ? CheckPaths(child, options, delayed, disruption, verdict)
+                                                          : CheckResume(child, options, disruption, verdict)) &&
+                  exited;
+        if (!exited) verdict += ", exited with failure";
+        passed = passed && ok;
+        std::printf("\n--- %s (%s: %s) ---\n%s", child.role, ok ? "ok" : "FAILED", verdict.c_str(),
+                    child.output.c_str());
+    }
+    std::printf("\n%s\n", passed ? "PASS" : "FAIL");
+    return passed ? 0 : 1;
+}
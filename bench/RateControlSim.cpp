@@ -0,0 +1,291 @@
+// Closed-loop simulation of RateController against an emulated bottleneck:
+// drop-tail queue, fixed propagation delay, optional random loss, and a
+// capacity schedule that drops below the full-quality rate and comes back.
+// Receiver reports feed the controller the way RTCP does in AudioStreamer.
+// Exits nonzero if the controller fails to back off, keep the queue short,
+// recover, or cover random loss with redundancy without congesting the link.
+
+#include <networking/RateController.h>
+#include <networking/RedundantPayload.h>
+#include <networking/RtpPacket.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <random>
+#include <vector>
+
+constexpr PacketTime CAPTURE_PTIME = PacketTime::Ms10;
+constexpr int64_t ONE_WAY_DELAY_MICROS = 20000;
+constexpr int64_t REPORT_INTERVAL_MICROS = 500000;    // RTCP with the reduced minimum
+constexpr size_t QUEUE_LIMIT_BYTES = 64 * 1024;       // a bloated home router buffer
+constexpr int64_t SETTLE_MICROS = 10000000;           // phase time before steady-state stats
+constexpr double DRAINED_QUEUE_MS = 100.0;
+
+struct LinkPhase {
+    int64_t startMicros;
+    uint32_t capacityBps;
+    double randomLoss;
+    const char* name;
+};
+
+static const LinkPhase PHASES[] = {
+    {0, 2000000, 0.0, "2 Mbps clean"},
+    {20000000, 300000, 0.0, "300 kbps bottleneck"},
+    {50000000, 2000000, 0.0, "2 Mbps restored"},
+    {90000000, 2000000, 0.04, "2 Mbps, 4% random loss"},
+};
+
+constexpr size_t PHASE_COUNT = sizeof(PHASES) / sizeof(PHASES[0]);
+constexpr int64_t SIMULATION_END_MICROS = 120000000;
+
+struct PhaseStats {
+    std::vector<double> settledQueueDelaysMs;
+    uint64_t sent = 0;
+    uint64_t delivered = 0;
+    uint64_t recovered = 0;   // lost but carried by a later packet's redundancy
+    uint64_t firstDecreaseMicros = 0;
+    int decreases = 0;
+    int64_t levelZeroMicros = -1;
+    int64_t drainedMicros = -1;     // queue back under DRAINED_QUEUE_MS after the first back-off
+    int maxRedundancy = 0;
+};
+
+struct SimResult {
+    PhaseStats phases[PHASE_COUNT];
+    int decisions = 0;
+};
+
+static size_t PhaseAt(int64_t now) {
+    size_t phase = 0;
+    while (phase + 1 < PHASE_COUNT && now >= PHASES[phase + 1].startMicros) phase++;
+    return phase;
+}
+
+static double Percentile(std::vector<double> values, double p) {
+    if (values.empty()) return 0.0;
+    std::sort(values.begin(), values.end());
+    size_t index = (size_t)(p / 100.0 * (values.size() - 1));
+    return values[index];
+}
+
+static SimResult Run(bool adaptive, bool verbose) {
+    SimResult result;
+    RateController controller(CAPTURE_PTIME);
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // Packets that left the bottleneck, on their way to the receiver
+    struct InFlight {
+        int64_t arrivalMicros;
+        uint32_t sequence;
+        size_t bytes;
+        double queueDelayMs;
+    };
+    std::deque<InFlight> inFlight;
+
+    // Reports on their way back over the uncongested reverse path
+    struct Report {
+        int64_t arrivalMicros;
+        RateFeedback feedback;
+    };
+    std::deque<Report> reports;
+
+    // Last few packets for redundancy recovery
+    struct Delivery {
+        bool arrived;
+        size_t phase;
+    };
+    std::deque<Delivery> history;
+
+    int64_t linkFreeMicros = 0;
+    int64_t nextSendMicros = 0;
+    uint32_t nextSequence = 0;
+
+    // Receiver state, RTCP-style: loss from the sequence gap per interval
+    int64_t nextReportMicros = REPORT_INTERVAL_MICROS;
+    uint32_t highestSequence = 0;
+    uint32_t reportedHighest = 0;
+    uint64_t intervalReceived = 0;
+    uint64_t intervalBytes = 0;
+    double lastQueueDelayMs = 0.0;
+    double lastTransitMs = 0.0;
+    double jitterMs = 0.0;
+
+    while (nextSendMicros < SIMULATION_END_MICROS) {
+        int64_t now = nextSendMicros;
+        size_t phase = PhaseAt(now);
+        const LinkPhase& link = PHASES[phase];
+        PhaseStats& stats = result.phases[phase];
+
+        // Receiver side: arrivals up to now, then a report when due
+        while (!inFlight.empty() && inFlight.front().arrivalMicros <= now) {
+            const InFlight& packet = inFlight.front();
+            double transitMs = ONE_WAY_DELAY_MICROS / 1000.0 + packet.queueDelayMs;
+            jitterMs += (std::abs(transitMs - lastTransitMs) - jitterMs) / 16.0;
+            lastTransitMs = transitMs;
+            lastQueueDelayMs = packet.queueDelayMs;
+            if (packet.sequence + 1 > highestSequence) highestSequence = packet.sequence + 1;
+            intervalReceived++;
+            intervalBytes += packet.bytes;
+            inFlight.pop_front();
+        }
+
+        if (now >= nextReportMicros) {
+            uint32_t expected = highestSequence - reportedHighest;
+            RateFeedback feedback{};
+            feedback.fractionLost = expected > intervalReceived ? 1.0 - (double)intervalReceived / expected : 0.0;
+            feedback.rttMs = 2 * ONE_WAY_DELAY_MICROS / 1000.0 + lastQueueDelayMs;
+            feedback.jitterMs = jitterMs;
+            feedback.receivedBitrate = intervalBytes * 8 * 1e6 / REPORT_INTERVAL_MICROS;
+            reports.push_back(Report{now + ONE_WAY_DELAY_MICROS, feedback});
+            reportedHighest = highestSequence;
+            intervalReceived = 0;
+            intervalBytes = 0;
+            nextReportMicros += REPORT_INTERVAL_MICROS;
+        }
+
+        // Sender side: reports that made it back, then the timeout check
+        while (!reports.empty() && reports.front().arrivalMicros <= now) {
+            RateDecisionRecord record;
+            if (adaptive && controller.OnFeedback(reports.front().arrivalMicros, reports.front().feedback, record)) {
+                result.decisions++;
+                if (verbose) {
+                    std::printf("  %6.1fs %s\n", reports.front().arrivalMicros / 1e6,
+                                FormatRateDecision(1, record, CAPTURE_PTIME).c_str());
+                }
+                if (record.decision == RateDecision::Decrease) {
+                    if (stats.firstDecreaseMicros == 0) {
+                        stats.firstDecreaseMicros = (uint64_t)(reports.front().arrivalMicros - link.startMicros);
+                    }
+                    stats.decreases++;
+                }
+            }
+            reports.pop_front();
+        }
+
+        RateDecisionRecord record;
+        if (adaptive && controller.OnTick(now, record)) {
+            result.decisions++;
+            if (verbose) {
+                std::printf("  %6.1fs %s\n", now / 1e6, FormatRateDecision(1, record, CAPTURE_PTIME).c_str());
+            }
+        }
+
+        const StreamConfig& config = controller.GetConfig();
+        if (controller.GetLevel() == 0 && stats.levelZeroMicros < 0) {
+            stats.levelZeroMicros = now - link.startMicros;
+        }
+        if (config.redundancy > stats.maxRedundancy) stats.maxRedundancy = config.redundancy;
+
+        // One RTP packet of the current configuration into the drop-tail queue
+        int64_t intervalMicros = (int64_t)PacketTimeMicros(CAPTURE_PTIME) * config.packetsPerRtp;
+        size_t packetBytes = (size_t)((uint64_t)controller.GetBitrate() * intervalMicros / 8 / 1000000);
+        nextSendMicros += intervalMicros;
+        stats.sent++;
+
+        int64_t backlogMicros = linkFreeMicros > now ? linkFreeMicros - now : 0;
+        size_t backlogBytes = (size_t)((double)backlogMicros * link.capacityBps / 8 / 1e6);
+        bool arrived = false;
+        if (backlogBytes + packetBytes <= QUEUE_LIMIT_BYTES && uniform(rng) >= link.randomLoss) {
+            int64_t start = std::max(now, linkFreeMicros);
+            linkFreeMicros = start + (int64_t)((double)packetBytes * 8 * 1e6 / link.capacityBps);
+            double queueDelayMs = (linkFreeMicros - now) / 1000.0;
+            inFlight.push_back(InFlight{linkFreeMicros + ONE_WAY_DELAY_MICROS, nextSequence, packetBytes, queueDelayMs});
+
+            stats.delivered++;
+            if (now - link.startMicros >= SETTLE_MICROS) {
+                stats.settledQueueDelaysMs.push_back(queueDelayMs);
+            }
+            if (stats.drainedMicros < 0 && stats.firstDecreaseMicros != 0 && queueDelayMs < DRAINED_QUEUE_MS) {
+                stats.drainedMicros = now - link.startMicros;
+            }
+            arrived = true;
+        }
+        nextSequence++;
+
+        // A packet that arrives carries the previous `redundancy` ones
+        history.push_back(Delivery{arrived, phase});
+        if (arrived) {
+            for (int back = 1; back <= config.redundancy && back < (int)history.size(); back++) {
+                Delivery& earlier = history[history.size() - 1 - back];
+                if (!earlier.arrived) {
+                    earlier.arrived = true;
+                    result.phases[earlier.phase].recovered++;
+                }
+            }
+        }
+        while (history.size() > RED_MAX_REDUNDANCY + 1) history.pop_front();
+    }
+
+    return result;
+}
+
+static void PrintPhases(const char* label, const SimResult& result) {
+    std::printf("%s\n", label);
+    for (size_t i = 0; i < PHASE_COUNT; i++) {
+        const PhaseStats& stats = result.phases[i];
+        double lost = stats.sent ? 100.0 * (stats.sent - stats.delivered) / stats.sent : 0.0;
+        double residual = stats.sent ? 100.0 * (stats.sent - stats.delivered - stats.recovered) / stats.sent : 0.0;
+        std::printf("  %-24s settled queue p50 %6.1f ms p95 %6.1f ms  loss %5.2f%% (after redundancy %5.2f%%)\n",
+                    PHASES[i].name, Percentile(stats.settledQueueDelaysMs, 50),
+                    Percentile(stats.settledQueueDelaysMs, 95), lost, residual);
+    }
+}
+
+int main() {
+    std::printf("Rate control simulation: %s capture, %d ms one-way, %zu KB drop-tail queue\n\n",
+                PacketTimeToString(CAPTURE_PTIME), (int)(ONE_WAY_DELAY_MICROS / 1000), QUEUE_LIMIT_BYTES / 1024);
+
+    std::printf("Decisions:\n");
+    SimResult adaptive = Run(true, true);
+    SimResult fixed = Run(false, false);
+
+    std::printf("\n");
+    PrintPhases("Adaptive:", adaptive);
+    PrintPhases("Fixed full quality:", fixed);
+
+    const PhaseStats& bottleneck = adaptive.phases[1];
+    const PhaseStats& restored = adaptive.phases[2];
+    const PhaseStats& lossy = adaptive.phases[3];
+    double bottleneckP95 = Percentile(bottleneck.settledQueueDelaysMs, 95);
+    double lossyResidual = lossy.sent ? (double)(lossy.sent - lossy.delivered - lossy.recovered) / lossy.sent : 1.0;
+    double lossyRaw = lossy.sent ? (double)(lossy.sent - lossy.delivered) / lossy.sent : 0.0;
+
+    std::printf("\nBack-off after capacity drop: %.1f s\n", bottleneck.firstDecreaseMicros / 1e6);
+    std::printf("Queue drained below %.0f ms: %.1f s\n", DRAINED_QUEUE_MS, bottleneck.drainedMicros / 1e6);
+    std::printf("Back to full quality after restore: %.1f s\n", restored.levelZeroMicros / 1e6);
+
+    bool pass = true;
+    if (bottleneck.firstDecreaseMicros == 0 || bottleneck.firstDecreaseMicros > 2000000) {
+        std::printf("FAIL: no back-off within 2 s of the capacity drop\n");
+        pass = false;
+    }
+    if (bottleneck.drainedMicros < 0 || bottleneck.drainedMicros > 10000000) {
+        std::printf("FAIL: queue did not drain within 10 s of the capacity drop\n");
+        pass = false;
+    }
+    // Probes above capacity queue briefly until the next report
+    if (bottleneckP95 > 150.0) {
+        std::printf("FAIL: settled queue delay p95 %.1f ms at the bottleneck (limit 150 ms)\n", bottleneckP95);
+        pass = false;
+    }
+    if (restored.levelZeroMicros < 0 || restored.levelZeroMicros > 40000000) {
+        std::printf("FAIL: did not return to full quality within 40 s\n");
+        pass = false;
+    }
+    if (lossy.maxRedundancy == 0 || lossyResidual >= lossyRaw / 2) {
+        std::printf("FAIL: redundancy did not cover random loss (%.2f%% -> %.2f%%)\n",
+                    lossyRaw * 100, lossyResidual * 100);
+        pass = false;
+    }
+    // Capacity is unchanged there: a back-off means the repeats overloaded the link
+    if (lossy.decreases > 0) {
+        std::printf("FAIL: redundancy pushed the lossy link into congestion (%d back-off(s))\n", lossy.decreases);
+        pass = false;
+    }
+
+    std::printf("%s (%d decisions)\n", pass ? "PASS" : "FAIL", adaptive.decisions);
+    return pass ? 0 : 1;
+}
@@ -0,0 +1,351 @@
+// Render pacing against a fake device clock: a device buffer drained at the
+// sample rate, a render thread woken once a device period (late by a seeded
+// jitter, now and then by a lot), and a main loop queueing mixed packets with
+// jitter and gaps. RenderScheduler and the real AudioEngine render callback
+// are driven the way WasapiAudioDevice drives them, and what the scheduler
+// saw is checked against what the fake device did. The old pacing, which
+// filled all the free space on every wake, runs alongside for comparison.
+// A second part mixes three peers packing 1, 2 and 4 capture packets into
+// each RTP packet the way the main loop does, against mixing whole packets
+// until the queues are empty.
+// Exits nonzero if a write overflows the free space or stops short of the
+// minimum, the starvations counted differ from the device's, a scenario
+// does not come out as it should, or the mix plays longer than wall time or
+// mixes frames of different lengths.
+
+#include <audio/AudioEngine.h>
+#include <audio/AudioMixer.h>
+#include <audio/RenderScheduler.h>
+#include <networking/PlayoutQueue.h>
+#include <utils/Logger.h>
+#include <utils/Metrics.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+constexpr uint32_t SAMPLE_RATE = AUDIO_SAMPLE_RATE;
+constexpr uint32_t PERIOD_FRAMES = SAMPLE_RATE / 100;           // 10 ms device events
+constexpr uint32_t DEVICE_BUFFER_FRAMES = 1056;                 // what shared mode gives for 10 ms
+constexpr uint32_t PACKET_FRAMES = FramesPerPacket(PacketTime::Ms10);
+constexpr int64_t SIMULATION_FRAMES = 60LL * SAMPLE_RATE;
+constexpr int64_t SETTLE_FRAMES = SAMPLE_RATE;   // the queues find their level, underruns not counted
+constexpr uint32_t SEED = 49;
+
+// Capture packets per RTP packet for each peer of the mixing part
+constexpr uint32_t PACKETS_PER_RTP[] = {1, 2, 4};
+constexpr size_t MIX_PEERS = sizeof(PACKETS_PER_RTP) / sizeof(PACKETS_PER_RTP[0]);
+constexpr int64_t MIX_SIMULATION_FRAMES = 10LL * SAMPLE_RATE;
+
+struct Scenario {
+    const char* name;
+    int64_t wakeJitterFrames;      // every wake is late by up to this
+    double lateWakeChance;         // and this often by much more
+    int64_t lateWakeMinFrames;
+    int64_t lateWakeMaxFrames;
+    int64_t producerJitterFrames;  // main loop queueing each packet late by up to this
+    int64_t gapEveryFrames;        // 0 = no gaps
+    int64_t gapFrames;             // main loop queues nothing for this long
+    bool expectStarvations;
+    bool expectUnderruns;
+};
+
+static const Scenario SCENARIOS[] = {
+    {"steady", 48, 0.0, 0, 0, 96, 0, 0, false, false},
+    {"late wakes", 48, 0.002, 600, 1200, 96, 0, 0, true, false},
+    {"producer gaps", 48, 0.0, 0, 0, 96, 2 * SAMPLE_RATE, 6 * PACKET_FRAMES, false, true},
+};
+
+enum class Pacing { Scheduler, FillAll };
+
+struct RunResult {
+    uint64_t wakes = 0;
+    uint64_t overflows = 0;      // wrote past the free space
+    uint64_t shortWrites = 0;    // wrote less than the minimum
+    uint64_t starvations = 0;    // the device ran dry
+    uint64_t counted = 0;        // starvations the scheduler reported
+    uint64_t underruns = 0;      // engine queue short of what was asked, once settled
+    uint64_t underrunFrames = 0;
+    double dryMs = 0.0;          // device played nothing
+    double meanQueuedMs = 0.0;   // device buffer plus engine queue after each write
+};
+
+// Render side of a WASAPI-like device; the simulation plays its clock
+class FakeClockDevice : public AudioDevice {
+public:
+    const char* GetName() const override { return "fake-clock"; }
+
+    bool Open(const AudioDeviceFormat& requested, AudioDeviceFormat& negotiated) override {
+        negotiated = requested;
+        negotiated.periodFrames = PERIOD_FRAMES;
+        return true;
+    }
+    void Close() override {}
+
+    bool StartCapture(AudioCaptureCallback) override { return false; }
+    void StopCapture() override {}
+    bool StartRender(AudioRenderCallback callback) override {
+        render = std::move(callback);
+        return true;
+    }
+    void StopRender() override { render = nullptr; }
+
+    uint32_t Render(int16_t* samples, uint32_t minFrames, uint32_t maxFrames, int64_t presentMicros) {
+        return render ? render(samples, minFrames, maxFrames, presentMicros) : 0;
+    }
+
+private:
+    AudioRenderCallback render;
+};
+
+static int64_t FramesToMicros(int64_t frames) {
+    return frames * 1000000 / SAMPLE_RATE;
+}
+
+static RunResult Run(const Scenario& scenario, Pacing pacing, FakeClockDevice& device) {
+    AudioEngine& engine = AudioEngine::GetInstance();
+    MetricsRegistry& metrics = MetricsRegistry::GetInstance();
+    std::mt19937 rng(SEED);
+    std::uniform_int_distribution<int64_t> wakeJitter(0, scenario.wakeJitterFrames);
+    std::uniform_int_distribution<int64_t> lateWake(scenario.lateWakeMinFrames, scenario.lateWakeMaxFrames);
+    std::uniform_int_distribution<int64_t> producerJitter(0, scenario.producerJitterFrames);
+    std::uniform_real_distribution<double> chance(0.0, 1.0);
+
+    RenderScheduler scheduler;
+    scheduler.Reset(DEVICE_BUFFER_FRAMES, PERIOD_FRAMES, SAMPLE_RATE);
+    engine.StartPlayback();
+    uint64_t underrunsBefore = 0;
+    uint64_t underrunFramesBefore = 0;
+    bool settled = false;
+
+    RunResult result;
+    std::vector<int16_t> window(DEVICE_BUFFER_FRAMES * AUDIO_CHANNELS);
+    AudioBuffer packet(PACKET_FRAMES * AUDIO_CHANNELS, 1000);
+    int64_t padding = 0;         // frames queued in the device
+    int64_t drainedTo = 0;
+    int64_t dryFrames = 0;
+    bool started = false;        // written to at least once
+    bool dry = false;
+    double queuedSum = 0.0;
+
+    // The device plays its buffer between events
+    auto drain = [&](int64_t now) {
+        int64_t played = now - drainedTo;
+        drainedTo = now;
+        if (!started) return;
+        if (played < padding) {
+            padding -= played;
+            return;
+        }
+        dryFrames += played - padding;
+        padding = 0;
+        if (!dry) result.starvations++;
+        dry = true;
+    };
+    auto nextWakeAfter = [&](int64_t now) {
+        int64_t event = (now / PERIOD_FRAMES + 1) * PERIOD_FRAMES;
+        int64_t late = wakeJitter(rng);
+        if (chance(rng) < scenario.lateWakeChance) late += lateWake(rng);
+        return event + late;
+    };
+
+    int64_t packetIndex = 0;
+    int64_t nextPacket = producerJitter(rng);
+    int64_t nextWake = wakeJitter(rng);
+    while (nextWake < SIMULATION_FRAMES) {
+        // Main loop: one packet per packet time, unless it is in a gap
+        if (nextPacket <= nextWake) {
+            drain(nextPacket);
+            int64_t nominal = packetIndex * PACKET_FRAMES;
+            bool inGap = scenario.gapEveryFrames > 0 &&
+                         nominal % scenario.gapEveryFrames >= scenario.gapEveryFrames - scenario.gapFrames;
+            if (!inGap) engine.QueuePlaybackBuffer(packet);
+            packetIndex++;
+            nextPacket = packetIndex * PACKET_FRAMES + producerJitter(rng);
+            continue;
+        }
+
+        // Render thread
+        int64_t now = nextWake;
+        drain(now);
+        if (!settled && now >= SETTLE_FRAMES) {
+            underrunsBefore = metrics.playbackUnderruns.Get();
+            underrunFramesBefore = metrics.playbackUnderrunFrames.Get();
+            settled = true;
+        }
+        result.wakes++;
+        uint32_t minFrames = 0;
+        uint32_t maxFrames = DEVICE_BUFFER_FRAMES - (uint32_t)padding;
+        int64_t presentMicros = FramesToMicros(now + padding);
+        bool write = maxFrames > 0;
+        if (pacing == Pacing::Scheduler) {
+            RenderRequest request;
+            write = scheduler.OnWake((uint32_t)padding, FramesToMicros(now), request);
+            minFrames = request.minFrames;
+            maxFrames = request.maxFrames;
+            presentMicros = request.presentMicros;
+        } else {
+            minFrames = maxFrames;
+        }
+
+        if (write) {
+            uint32_t written = device.Render(window.data(), minFrames, maxFrames, presentMicros);
+            if (written > maxFrames || padding + written > DEVICE_BUFFER_FRAMES) result.overflows++;
+            if (written < minFrames) result.shortWrites++;
+            if (pacing == Pacing::Scheduler) scheduler.OnWritten(written);
+            padding += written;
+            if (written > 0) {
+                started = true;
+                dry = false;
+            }
+        }
+        queuedSum += (double)padding + (double)metrics.playbackQueueDepth.Get() * PACKET_FRAMES;
+        nextWake = nextWakeAfter(now);
+    }
+
+    // Leave the engine's queue empty for the next run
+    while (device.Render(window.data(), 0, PERIOD_FRAMES, 0) > 0) {}
+    engine.StopPlayback();
+
+    result.counted = scheduler.GetStarvations();
+    result.underruns = metrics.playbackUnderruns.Get() - underrunsBefore;
+    result.underrunFrames = metrics.playbackUnderrunFrames.Get() - underrunFramesBefore;
+    result.dryMs = FramesToMicros(dryFrames) / 1000.0;
+    result.meanQueuedMs = result.wakes > 0 ? queuedSum / result.wakes * 1000.0 / SAMPLE_RATE : 0.0;
+    return result;
+}
+
+struct MixResult {
+    uint64_t mixes = 0;
+    int64_t mixedFrames = 0;
+    uint64_t unequalMixes = 0;    // sources of different lengths in one mix
+    int64_t peerFrames[MIX_PEERS] = {};
+};
+
+// One capture packet per tick; each peer's RTP packet arrives once it holds
+// its packets. Split: one capture packet per peer per mix, one mix per tick
+// plus more while a queue holds two packets, as the main loop does. Whole:
+// each packet in one piece, mixing until the queues are empty.
+static MixResult RunMix(bool split) {
+    PlayoutQueue queues[MIX_PEERS];
+    uint16_t sequences[MIX_PEERS] = {};
+    AudioMixer mixer;
+    AudioBuffer sent(PACKETS_PER_RTP[MIX_PEERS - 1] * PACKET_FRAMES * AUDIO_CHANNELS, 1000);
+    AudioBuffer received;
+    AudioBuffer mixed;
+    size_t frameSamples = split ? PACKET_FRAMES * AUDIO_CHANNELS : SIZE_MAX;
+    auto backlog = [&queues]() {
+        for (const PlayoutQueue& queue : queues) {
+            if (queue.Size() > 1) return true;
+        }
+        return false;
+    };
+
+    MixResult result;
+    for (int64_t tick = 1; tick * PACKET_FRAMES <= MIX_SIMULATION_FRAMES; tick++) {
+        for (size_t i = 0; i < MIX_PEERS; i++) {
+            if (tick % PACKETS_PER_RTP[i] == 0) {
+                queues[i].Add(++sequences[i], 0, sent.data(), PACKETS_PER_RTP[i] * PACKET_FRAMES * AUDIO_CHANNELS);
+            }
+        }
+
+        for (size_t mixes = 0; !split || mixes < 1 || backlog(); mixes++) {
+            mixer.Begin();
+            size_t shortest = SIZE_MAX;
+            size_t longest = 0;
+            for (size_t i = 0; i < MIX_PEERS; i++) {
+                int64_t arrivalMicros = 0;
+                if (!queues[i].Pop(received, arrivalMicros, frameSamples)) continue;
+                mixer.AddSource((uint32_t)i + 1, received);
+                shortest = std::min(shortest, received.size());
+                longest = std::max(longest, received.size());
+                result.peerFrames[i] += (int64_t)(received.size() / AUDIO_CHANNELS);
+            }
+            if (!mixer.Finish(mixed)) break;
+            result.mixes++;
+            result.mixedFrames += (int64_t)(mixed.size() / AUDIO_CHANNELS);
+            if (shortest != longest) result.unequalMixes++;
+        }
+    }
+    return result;
+}
+
+static void PrintMixResult(const char* mixing, const MixResult& result) {
+    std::printf("  %-10s mixes %5llu  played %7.1f ms of %7.1f ms wall  unequal mixes %4llu\n",
+                mixing, (unsigned long long)result.mixes, FramesToMicros(result.mixedFrames) / 1000.0,
+                FramesToMicros(MIX_SIMULATION_FRAMES) / 1000.0, (unsigned long long)result.unequalMixes);
+}
+
+static void PrintResult(const char* pacing, const RunResult& result) {
+    std::printf("  %-10s wakes %6llu  starvations %3llu (dry %6.1f ms)  underruns %4llu (%7.1f ms silence)"
+                "  queued %5.1f ms\n",
+                pacing, (unsigned long long)result.wakes, (unsigned long long)result.starvations, result.dryMs,
+                (unsigned long long)result.underruns, FramesToMicros((int64_t)result.underrunFrames) / 1000.0,
+                result.meanQueuedMs);
+}
+
+int main() {
+    Logger::GetInstance().SetConsoleOutput(false);
+
+    auto owned = std::make_unique<FakeClockDevice>();
+    FakeClockDevice& device = *owned;
+    AudioEngine& engine = AudioEngine::GetInstance();
+    if (!engine.Initialize(std::move(owned))) {
+        std::fprintf(stderr, "FAIL: could not initialize the audio engine\n");
+        return 1;
+    }
+
+    std::printf("Render pacing: %u-frame device buffer, %u-frame period, %u-frame safety level\n",
+                DEVICE_BUFFER_FRAMES, PERIOD_FRAMES, RENDER_SAFETY_PERIODS * PERIOD_FRAMES);
+
+    int failures = 0;
+    auto check = [&failures](bool ok, const char* scenario, const char* what) {
+        if (ok) return;
+        std::printf("  FAIL (%s): %s\n", scenario, what);
+        failures++;
+    };
+
+    for (const Scenario& scenario : SCENARIOS) {
+        std::printf("%s\n", scenario.name);
+        RunResult scheduled = Run(scenario, Pacing::Scheduler, device);
+        RunResult fillAll = Run(scenario, Pacing::FillAll, device);
+        PrintResult("scheduler", scheduled);
+        PrintResult("fill all", fillAll);
+
+        check(scheduled.overflows == 0 && fillAll.overflows == 0, scenario.name, "wrote past the free space");
+        check(scheduled.shortWrites == 0, scenario.name, "wrote less than the minimum");
+        check(scheduled.counted == scheduled.starvations, scenario.name,
+              "scheduler's starvation count differs from the device's");
+        check((scheduled.starvations > 0) == scenario.expectStarvations, scenario.name,
+              scenario.expectStarvations ? "late wakes never starved the device" : "device starved");
+        check((scheduled.underruns > 0) == scenario.expectUnderruns, scenario.name,
+              scenario.expectUnderruns ? "queue gaps were not counted as underruns" : "playback queue underran");
+        check(scheduled.underrunFrames <= fillAll.underrunFrames, scenario.name,
+              "more silence than filling all the free space");
+        check(scheduled.meanQueuedMs <= fillAll.meanQueuedMs, scenario.name,
+              "more audio queued than filling all the free space");
+    }
+
+    const char* mixName = "mixed packets per RTP (1, 2, 4)";
+    std::printf("%s\n", mixName);
+    MixResult split = RunMix(true);
+    MixResult whole = RunMix(false);
+    PrintMixResult("split", split);
+    PrintMixResult("whole", whole);
+    check(split.mixedFrames <= MIX_SIMULATION_FRAMES, mixName, "mix played longer than wall time");
+    check(split.unequalMixes == 0, mixName, "mixed frames of different lengths");
+    for (size_t i = 0; i < MIX_PEERS; i++) {
+        // All of it but what is still queued: at most one RTP packet
+        check(split.peerFrames[i] >= MIX_SIMULATION_FRAMES - (int64_t)(PACKETS_PER_RTP[i] * PACKET_FRAMES), mixName,
+              "a peer's audio was left behind");
+    }
+
+    engine.Shutdown();
+    if (failures > 0) {
+        std::printf("%d check(s) failed\n", failures);
+        return 1;
+    }
+    std::printf("PASS\n");
+    return 0;
+}
@@ -0,0 +1,296 @@
+// Reads the shared-memory audio tap of a running VoiceQwik (--tap=name) or
+// headless peer (--tap name) the way a sidecar would: maps it once, then
+// polls the published count. Prints per-stream packets, samples and lag
+// every second, and can write one stream to a WAV file, with gaps (packets
+// lost to a full ring, or a participant not talking) filled with silence
+// from the stream positions.
+//
+//   voiceqwik_tap_reader name [--duration s] [--stream mix|local|<peer id>] [--wav out.wav]
+//   voiceqwik_tap_reader --self-test
+//
+// The self-test publishes a full call's streams at ten times real time
+// from a writer thread, with one reader keeping up and one stalling for
+// half a second at a time. It exits nonzero unless the fast reader gets
+// every packet intact and in order, the stalled one loses packets but
+// accounts for all of them and never sees a torn one, and the writer keeps
+// its pace while nobody reads.
+
+#include <audio/AudioTap.h>
+#include <audio/WavFile.h>
+#include <networking/LatencyProbe.h>
+#include <utils/Logger.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+constexpr int TAP_POLL_MS = 5;
+constexpr int TAP_REPORT_INTERVAL_MS = 1000;
+
+constexpr uint32_t SELF_TEST_STREAMS = MAX_PARTICIPANTS + 1;   // mix, local and the other participants
+constexpr uint32_t SELF_TEST_PACKET_SAMPLES = SamplesPerPacket(PacketTime::Ms10);
+constexpr int SELF_TEST_ROUND_MICROS = 1000;                   // a 10 ms round of packets per ms
+constexpr int SELF_TEST_ROUNDS = 3000;
+constexpr int SELF_TEST_STALL_MS = 500;
+
+static std::string StreamName(uint32_t stream) {
+    if (stream == AUDIO_TAP_STREAM_MIX) return "mix";
+    if (stream == AUDIO_TAP_STREAM_LOCAL) return "local";
+    return "peer " + std::to_string(stream);
+}
+
+static bool ParseStream(const std::string& text, uint32_t& stream) {
+    if (text == "mix") {
+        stream = AUDIO_TAP_STREAM_MIX;
+    } else if (text == "local") {
+        stream = AUDIO_TAP_STREAM_LOCAL;
+    } else {
+        char* end = nullptr;
+        unsigned long id = std::strtoul(text.c_str(), &end, 10);
+        if (text.empty() || *end != '\0' || id == 0) return false;
+        stream = (uint32_t)id;
+    }
+    return true;
+}
+
+// Sample i of self-test packet `sequence`, so a reader can tell a torn copy
+static int16_t PatternSample(uint64_t sequence, uint32_t i) {
+    return (int16_t)(sequence * 7919 + i * 31);
+}
+
+static bool IsIntact(const AudioTapPacket& packet) {
+    if (packet.sampleCount != SELF_TEST_PACKET_SAMPLES) return false;
+    for (uint32_t i = 0; i < packet.sampleCount; i++) {
+        if (packet.samples[i] != PatternSample(packet.sequence, i)) return false;
+    }
+    return true;
+}
+
+struct SelfTestReader {
+    uint64_t read = 0;
+    uint64_t torn = 0;
+    uint64_t outOfOrder = 0;
+    uint64_t lastSequence = 0;
+    bool any = false;
+
+    void Take(const AudioTapPacket& packet) {
+        if (!IsIntact(packet)) torn++;
+        if (any && packet.sequence <= lastSequence) outOfOrder++;
+        lastSequence = packet.sequence;
+        any = true;
+        read++;
+    }
+};
+
+static int RunSelfTest() {
+    const std::string name = "selftest-" + std::to_string(LatencyClockMicros());
+    AudioTap& tap = AudioTap::GetInstance();
+    if (!tap.Start(name)) {
+        std::fprintf(stderr, "FAIL: could not start the tap\n");
+        return 1;
+    }
+
+    AudioTapReader fast;
+    AudioTapReader slow;
+    if (!fast.Open(name) || !slow.Open(name)) {
+        std::fprintf(stderr, "FAIL: could not attach to the tap\n");
+        tap.Stop();
+        return 1;
+    }
+
+    // Writer: rounds of one packet per stream, paced off the clock. Each
+    // packet's samples come from the sequence number it will get.
+    std::atomic<bool> writerDone{false};
+    int64_t writerMicros = 0;
+    std::thread writer([&] {
+        AudioBuffer packet(SELF_TEST_PACKET_SAMPLES);
+        int64_t start = LatencyClockMicros();
+        for (int round = 0; round < SELF_TEST_ROUNDS; round++) {
+            int64_t due = start + (int64_t)round * SELF_TEST_ROUND_MICROS;
+            while (LatencyClockMicros() < due) std::this_thread::sleep_for(std::chrono::microseconds(100));
+            for (uint32_t stream = 0; stream < SELF_TEST_STREAMS; stream++) {
+                uint64_t sequence = tap.GetPublished();
+                for (uint32_t i = 0; i < SELF_TEST_PACKET_SAMPLES; i++) packet[i] = PatternSample(sequence, i);
+                if (stream == 0) {
+                    tap.PublishMix(packet);
+                } else if (stream == 1) {
+                    tap.PublishCapture(packet, LatencyClockMicros());
+                } else {
+                    tap.PublishSource(stream - 1, packet);
+                }
+            }
+        }
+        writerMicros = LatencyClockMicros() - start;
+        writerDone = true;
+    });
+
+    SelfTestReader fastStats;
+    std::thread fastReader([&] {
+        AudioTapPacket packet;
+        while (true) {
+            bool done = writerDone;
+            while (fast.Read(packet)) fastStats.Take(packet);
+            if (done) break;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    SelfTestReader slowStats;
+    AudioTapPacket packet;
+    while (true) {
+        bool done = writerDone;
+        while (slow.Read(packet)) slowStats.Take(packet);
+        if (done) break;
+        std::this_thread::sleep_for(std::chrono::milliseconds(SELF_TEST_STALL_MS));
+    }
+    writer.join();
+    fastReader.join();
+
+    uint64_t published = tap.GetPublished();
+    tap.Stop();
+
+    double expectedMs = SELF_TEST_ROUNDS * SELF_TEST_ROUND_MICROS / 1000.0;
+    std::printf("writer: %llu packets in %.0f ms (paced for %.0f ms)\n", (unsigned long long)published,
+                writerMicros / 1000.0, expectedMs);
+    std::printf("fast reader: %llu read, %llu lost, %llu torn, %llu out of order\n",
+                (unsigned long long)fastStats.read, (unsigned long long)fast.GetLost(),
+                (unsigned long long)fastStats.torn, (unsigned long long)fastStats.outOfOrder);
+    std::printf("slow reader: %llu read, %llu lost, %llu torn, %llu out of order\n",
+                (unsigned long long)slowStats.read, (unsigned long long)slow.GetLost(),
+                (unsigned long long)slowStats.torn, (unsigned long long)slowStats.outOfOrder);
+
+    int failures = 0;
+    auto check = [&failures](bool ok, const char* what) {
+        if (ok) return;
+        std::printf("FAIL: %s\n", what);
+        failures++;
+    };
+    check(published == (uint64_t)SELF_TEST_ROUNDS * SELF_TEST_STREAMS, "writer did not publish every packet");
+    check(writerMicros < (int64_t)(expectedMs * 1000 * 1.5), "writer fell behind its pace");
+    check(fastStats.read == published && fast.GetLost() == 0, "fast reader missed packets");
+    check(fastStats.torn == 0 && fastStats.outOfOrder == 0, "fast reader got a bad packet");
+    check(slow.GetLost() > 0, "stalled reader lost nothing; the ring should have lapped it");
+    check(slowStats.read + slow.GetLost() == published, "stalled reader's reads and losses do not add up");
+    check(slowStats.torn == 0 && slowStats.outOfOrder == 0, "stalled reader got a bad packet");
+
+    if (failures > 0) return 1;
+    std::printf("PASS\n");
+    return 0;
+}
+
+struct StreamStats {
+    uint64_t packets = 0;
+    uint64_t samples = 0;
+    int64_t maxLagMicros = 0;
+};
+
+int main(int argc, char** argv) {
+    Logger::GetInstance().SetConsoleOutput(false);
+
+    std::string name;
+    double durationSeconds = 0.0;
+    std::string wavFile;
+    uint32_t wavStream = AUDIO_TAP_STREAM_MIX;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--self-test") {
+            return RunSelfTest();
+        } else if (arg == "--duration" && hasValue) {
+            durationSeconds = std::atof(argv[++i]);
+        } else if (arg == "--wav" && hasValue) {
+            wavFile = argv[++i];
+        } else if (arg == "--stream" && hasValue) {
+            if (!ParseStream(argv[++i], wavStream)) {
+                std::fprintf(stderr, "Bad stream: %s\n", argv[i]);
+                return 2;
+            }
+        } else if (arg[0] != '-' && name.empty()) {
+            name = arg;
+        } else {
+            name.clear();
+            break;
+        }
+    }
+    if (name.empty()) {
+        std::fprintf(stderr,
+                     "usage: %s name [--duration s] [--stream mix|local|<peer id>] [--wav out.wav]\n"
+                     "       %s --self-test\n",
+                     argv[0], argv[0]);
+        return 2;
+    }
+
+    AudioTapReader reader;
+    if (!reader.Open(name)) {
+        std::fprintf(stderr, "No audio tap named %s (or a different version)\n", name.c_str());
+        return 1;
+    }
+
+    WavWriter wav;
+    if (!wavFile.empty() && !wav.Open(wavFile, WavFormat{AUDIO_SAMPLE_RATE, AUDIO_CHANNELS})) {
+        std::fprintf(stderr, "Failed to open %s\n", wavFile.c_str());
+        return 1;
+    }
+    const std::vector<int16_t> silence(AUDIO_SAMPLE_RATE / 10 * AUDIO_CHANNELS, 0);
+    const uint64_t silenceFrames = silence.size() / AUDIO_CHANNELS;
+    uint64_t wavPosition = 0;
+    bool wavStarted = false;
+
+    std::map<uint32_t, StreamStats> streams;
+    AudioTapPacket packet;
+    const int64_t startMicros = LatencyClockMicros();
+    int64_t nextReport = startMicros + TAP_REPORT_INTERVAL_MS * 1000ll;
+    while (reader.IsLive()) {
+        int64_t now = LatencyClockMicros();
+        if (durationSeconds > 0.0 && now - startMicros >= (int64_t)(durationSeconds * 1e6)) break;
+
+        while (reader.Read(packet)) {
+            StreamStats& stats = streams[packet.stream];
+            stats.packets++;
+            stats.samples += packet.sampleCount;
+            if (now - packet.micros > stats.maxLagMicros) stats.maxLagMicros = now - packet.micros;
+
+            if (wav.IsOpen() && packet.stream == wavStream) {
+                // Silence for whatever the stream skipped since the last packet written
+                if (!wavStarted) wavPosition = packet.streamPosition;
+                wavStarted = true;
+                while (wavPosition < packet.streamPosition) {
+                    uint64_t gap = packet.streamPosition - wavPosition;
+                    uint64_t frames = gap < silenceFrames ? gap : silenceFrames;
+                    wav.Write(silence.data(), (size_t)frames);
+                    wavPosition += frames;
+                }
+                wav.Write(packet.samples, packet.sampleCount / AUDIO_CHANNELS);
+                wavPosition += packet.sampleCount / AUDIO_CHANNELS;
+            }
+        }
+
+        if (now >= nextReport) {
+            nextReport = now + TAP_REPORT_INTERVAL_MS * 1000ll;
+            std::printf("%5.1f s: lost %llu", (now - startMicros) / 1e6, (unsigned long long)reader.GetLost());
+            for (auto& [stream, stats] : streams) {
+                std::printf("  | %s: %llu packets, %.1f s, lag max %.1f ms", StreamName(stream).c_str(),
+                            (unsigned long long)stats.packets, stats.samples / (double)AUDIO_SAMPLE_RATE,
+                            stats.maxLagMicros / 1000.0);
+                stats.maxLagMicros = 0;
+            }
+            std::printf("\n");
+            std::fflush(stdout);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(TAP_POLL_MS));
+    }
+
+    if (!reader.IsLive()) std::printf("tap closed by the writer\n");
+    if (wav.IsOpen()) {
+        std::printf("%s: %llu frames of %s\n", wavFile.c_str(), (unsigned long long)wav.GetFramesWritten(),
+                    StreamName(wavStream).c_str());
+        wav.Close();
+    }
+    std::printf("lost %llu packets\n", (unsigned long long)reader.GetLost());
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Per-event cost of the tracing macros, recording on and off.
+// Fails (exit code 1) if a recorded event costs more than TRACE_BUDGET_NS.
+
+#ifndef VOICEQWIK_TRACE
+#define VOICEQWIK_TRACE 1
+#endif
+
+#include <utils/Trace.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+constexpr int BATCH_EVENTS = 2048;   // stays below TRACE_RING_CAPACITY
+constexpr int BATCHES = 200;
+constexpr int REPETITIONS = 7;
+constexpr double TRACE_BUDGET_NS = 50.0;
+
+static volatile int64_t sink;
+
+// Median ns per event; rings are drained between batches, outside the timing
+template <typename Fn>
+static double MeasureNsPerEvent(Fn&& emit) {
+    std::vector<double> samples;
+    for (int rep = 0; rep < REPETITIONS; rep++) {
+        std::chrono::steady_clock::duration total{};
+        for (int batch = 0; batch < BATCHES; batch++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int i = 0; i < BATCH_EVENTS; i++) {
+                emit(i);
+            }
+            total += std::chrono::steady_clock::now() - start;
+            Tracer::GetInstance().Collect();
+        }
+        samples.push_back(std::chrono::duration<double, std::nano>(total).count() /
+                          (BATCHES * BATCH_EVENTS));
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+int main() {
+    TRACE_THREAD_NAME("bench");
+
+    // Baseline loop with no tracing, subtracted from the results below
+    double loopNs = MeasureNsPerEvent([](int i) { sink = i; });
+
+    Tracer::GetInstance().Start();
+    double scopeNs = MeasureNsPerEvent([](int i) {
+        TRACE_SCOPE_VALUE("bench_span", i);
+        sink = i;
+    }) - loopNs;
+    double instantNs = MeasureNsPerEvent([](int i) {
+        TRACE_INSTANT("bench_instant", i);
+        sink = i;
+    }) - loopNs;
+    double counterNs = MeasureNsPerEvent([](int i) {
+        TRACE_COUNTER("bench_counter", i);
+        sink = i;
+    }) - loopNs;
+    uint64_t dropped = Tracer::GetInstance().GetDroppedCount();
+    Tracer::GetInstance().Stop();
+
+    double idleNs = MeasureNsPerEvent([](int i) {
+        TRACE_SCOPE_VALUE("bench_span", i);
+        sink = i;
+    }) - loopNs;
+
+    bool withinBudget = scopeNs <= TRACE_BUDGET_NS && instantNs <= TRACE_BUDGET_NS &&
+                        counterNs <= TRACE_BUDGET_NS;
+
+    std::printf("VoiceQwik trace benchmark (%s timestamps, median of %d x %d events)\n\n",
+                VQ_TRACE_HAS_TSC ? "TSC" : "steady_clock", REPETITIONS, BATCHES * BATCH_EVENTS);
+    std::printf("%-28s %10s\n", "event", "ns/event");
+    std::printf("%-28s %10.1f\n", "TRACE_SCOPE (recording)", scopeNs);
+    std::printf("%-28s %10.1f\n", "TRACE_INSTANT (recording)", instantNs);
+    std::printf("%-28s %10.1f\n", "TRACE_COUNTER (recording)", counterNs);
+    std::printf("%-28s %10.1f\n", "TRACE_SCOPE (stopped)", idleNs);
+    std::printf("\ndropped events: %llu\n", (unsigned long long)dropped);
+    std::printf("budget %.0f ns/event: %s\n", TRACE_BUDGET_NS, withinBudget ? "PASS" : "FAIL");
+
+    return withinBudget ? 0 : 1;
+}
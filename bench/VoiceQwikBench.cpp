@@ -0,0 +1,620 @@
+// Hot-path microbenchmarks: RTP/RTCP serialize and parse, receive demux,
+// playout queueing, mixing, payload format conversion, logging, the
+// playback copy, the call recorder handoff, media encryption and the
+// capture-path DSP, which is held to a share of the 10 ms frame. Headless; only uses the
+// platform-neutral code, so it builds on Linux as well as Windows.
+//
+//   voiceqwik_bench --json before.json
+//   voiceqwik_bench --baseline before.json        (nonzero exit on regression)
+
+#include "BenchHarness.h"
+
+#include <audio/AudioEngine.h>
+#include <audio/AudioFormat.h>
+#include <audio/AudioMixer.h>
+#include <audio/CallRecorder.h>
+#include <audio/EchoCanceller.h>
+#include <audio/FrameKernels.h>
+#include <audio/GainControl.h>
+#include <audio/LatencyMarker.h>
+#include <audio/NoiseSuppressor.h>
+#include <audio/PayloadCodec.h>
+#include <networking/LatencyProbe.h>
+#include <networking/MediaCrypto.h>
+#include <networking/PlayoutQueue.h>
+#include <networking/RedundantPayload.h>
+#include <networking/RtcpPacket.h>
+#include <networking/RtpPacket.h>
+#include <networking/RtpSourceStats.h>
+#include <utils/Common.h>
+#include <utils/Logger.h>
+#include <utils/Metrics.h>
+#include <utils/SpscRing.h>
+
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Sizes every case is measured at; changing them breaks comparison with
+// earlier JSON results
+constexpr PacketTime BENCH_PACKET_TIME = PacketTime::Ms10;
+constexpr uint32_t BENCH_SAMPLES = SamplesPerPacket(BENCH_PACKET_TIME);
+constexpr uint32_t BENCH_BATCH = 10000;
+constexpr uint32_t BENCH_LOG_BATCH = 256;      // stays below LOG_RING_CAPACITY, so nothing drops
+constexpr uint32_t BENCH_SEED = 1234;
+constexpr size_t BENCH_DEMUX_SOURCES = 3;
+constexpr size_t BENCH_PLAYOUT_DEPTH = 4;
+constexpr uint32_t BENCH_REMOTE_PEERS = MAX_PARTICIPANTS - 1;
+constexpr uint32_t BENCH_RECORD_BATCH = 256;   // stays below RECORDER_RING_CAPACITY
+constexpr const char* BENCH_RECORD_FILE = "voiceqwik_bench_record.wav";
+constexpr double BENCH_FRAME_NS = 10e6;                    // one 10 ms audio frame
+constexpr double BENCH_AEC_BUDGET_NS = 0.10 * BENCH_FRAME_NS;
+constexpr uint32_t BENCH_AEC_BATCH = 100;
+constexpr uint32_t BENCH_AEC_FAR_BLOCKS = 256;             // far-end talk, looped
+constexpr uint32_t BENCH_AEC_ECHO_FRAMES = 2 * AEC_BLOCK_FRAMES;
+constexpr uint32_t BENCH_AEC_CONVERGE_BLOCKS = 500;
+constexpr double BENCH_NS_BUDGET_NS = 0.02 * BENCH_FRAME_NS;
+constexpr uint32_t BENCH_NS_BATCH = 100;
+constexpr uint32_t BENCH_NS_BLOCKS = 64;
+
+// Cases that run on the audio and receive threads: no allocation, lock or
+// blocking call once warmed up (checked in VOICEQWIK_ENABLE_RT_CHECK builds)
+constexpr const char* BENCH_REALTIME_CASES[] = {
+    "rtp/serialize_pcm16", "rtp/serialize_red_mulaw", "rtp/parse_pcm16", "rtp/parse_red_mulaw",
+    "rtcp/write_sr", "rtcp/parse_sr", "demux/classify", "queue/spsc_packet",
+    "mix/3_peers", "mix/8_peers", "mix/3_peers_normalized", "agc/block",
+    "convert/mulaw_encode", "convert/mulaw_decode", "convert/halfrate_encode", "convert/halfrate_decode",
+    "metrics/histogram_record", "playback/queue_copy", "playback/marker_mix",
+    "record/packet", "record/overflow", "aec/block", "ns/block",
+    "crypto/seal_10ms", "crypto/open_10ms",
+};
+
+// Speech-level noise, the same on every run
+static AudioBuffer MakeSignal(uint32_t samples, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> dist(-12000, 12000);
+    AudioBuffer buffer(samples);
+    for (auto& s : buffer) s = (int16_t)dist(rng);
+    return buffer;
+}
+
+static void AddRtpCases(BenchHarness& harness) {
+    static const AudioBuffer signal = MakeSignal(BENCH_SAMPLES, BENCH_SEED);
+    static std::array<uint8_t, MAX_RTP_PACKET_SIZE> packet{};
+    static std::array<uint8_t, MAX_RTP_PAYLOAD_SIZE> encoded{};
+    static std::array<int16_t, MAX_SAMPLES_PER_PACKET> decoded{};
+    static size_t pcmPacketSize = 0;
+    static size_t redPacketSize = 0;
+    static std::array<uint8_t, MAX_RTP_PACKET_SIZE> redPacket{};
+
+    // Sender: header, latency extension and PCM16 payload into the reused buffer
+    harness.Add("rtp/serialize_pcm16", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            RTPHeader header{false, RTP_PAYLOAD_TYPE_PCM16, (uint16_t)i, i * BENCH_SAMPLES, 0x1234};
+            WriteRTPHeader(packet.data(), header, true);
+            WriteLatencyExtension(packet.data() + RTP_HEADER_SIZE, LatencyTimestamps{i, i + 1});
+            uint8_t* payload = packet.data() + RTP_HEADER_SIZE + LATENCY_EXTENSION_SIZE;
+            pcmPacketSize = RTP_HEADER_SIZE + LATENCY_EXTENSION_SIZE +
+                            EncodePayload(PayloadEncoding::Pcm16, signal.data(), BENCH_SAMPLES, payload);
+            benchSink = packet[pcmPacketSize - 1 - (i & 63)];
+        }
+    });
+
+    // Sender at the lowest rung with redundancy: mu-law encode, RFC 2198 framing
+    harness.Add("rtp/serialize_red_mulaw", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            size_t encodedSize = EncodePayload(PayloadEncoding::Mulaw, signal.data(), BENCH_SAMPLES, encoded.data());
+            RedundantBlock blocks[RED_MAX_REDUNDANCY + 1];
+            for (size_t b = 0; b <= RED_MAX_REDUNDANCY; b++) {
+                uint32_t offset = (uint32_t)(RED_MAX_REDUNDANCY - b) * BENCH_SAMPLES;
+                blocks[b] = RedundantBlock{RTP_PAYLOAD_TYPE_MULAW, offset, encoded.data(), encodedSize};
+            }
+            RTPHeader header{false, RTP_PAYLOAD_TYPE_RED, (uint16_t)i, i * BENCH_SAMPLES, 0x1234};
+            WriteRTPHeader(redPacket.data(), header);
+            redPacketSize = RTP_HEADER_SIZE + WriteRedundantPayload(redPacket.data() + RTP_HEADER_SIZE,
+                                                                    redPacket.size() - RTP_HEADER_SIZE,
+                                                                    blocks, RED_MAX_REDUNDANCY + 1);
+            benchSink = redPacket[redPacketSize - 1];
+        }
+    });
+
+    // Receiver: header + extension parse, payload decoded back to PCM16
+    harness.Add("rtp/parse_pcm16", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            RTPHeader header{};
+            size_t headerSize = 0;
+            size_t payloadSize = 0;
+            LatencyTimestamps stamps{};
+            PayloadEncoding encoding;
+            if (!ParseRTPHeader(packet.data(), pcmPacketSize, header, headerSize, payloadSize) ||
+                !ParseLatencyExtension(packet.data(), headerSize, stamps) ||
+                !EncodingForPayloadType(header.payloadType, encoding)) {
+                continue;
+            }
+            size_t samples = DecodePayload(encoding, packet.data() + headerSize, payloadSize,
+                                           decoded.data(), decoded.size());
+            benchSink = (uint32_t)decoded[(samples - 1) & i];
+        }
+    });
+
+    // Receiver: RED split plus decode of the primary and both redundant blocks
+    harness.Add("rtp/parse_red_mulaw", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            RTPHeader header{};
+            size_t headerSize = 0;
+            size_t payloadSize = 0;
+            if (!ParseRTPHeader(redPacket.data(), redPacketSize, header, headerSize, payloadSize)) continue;
+
+            RedundantBlock blocks[RED_MAX_REDUNDANCY + 1];
+            size_t count = ParseRedundantPayload(redPacket.data() + headerSize, payloadSize,
+                                                 blocks, RED_MAX_REDUNDANCY + 1);
+            for (size_t b = 0; b < count; b++) {
+                PayloadEncoding encoding;
+                if (!EncodingForPayloadType(blocks[b].payloadType, encoding)) continue;
+                DecodePayload(encoding, blocks[b].data, blocks[b].length, decoded.data(), decoded.size());
+            }
+            benchSink = (uint32_t)decoded[i % BENCH_SAMPLES];
+        }
+    });
+
+    static std::array<uint8_t, RTCP_MAX_PACKET_SIZE> rtcp{};
+    static size_t rtcpSize = 0;
+    static RtcpReportBlock reportBlocks[BENCH_REMOTE_PEERS];
+
+    harness.Add("rtcp/write_sr", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            RtcpSenderInfo info{RtcpNtpNow(), i * BENCH_SAMPLES, i, i * BENCH_SAMPLES * 2};
+            for (size_t b = 0; b < BENCH_REMOTE_PEERS; b++) {
+                reportBlocks[b] = RtcpReportBlock{0x1000u + (uint32_t)b, 3, 12, 70000u + i, 240, 0x12345678, 0x8000};
+            }
+            rtcpSize = WriteRtcpCompound(rtcp.data(), rtcp.size(), 0x1234, &info, reportBlocks,
+                                         BENCH_REMOTE_PEERS, "bench@voiceqwik");
+            benchSink = rtcp[rtcpSize - 1];
+        }
+    });
+
+    harness.Add("rtcp/parse_sr", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            RtcpReport report{};
+            if (ParseRtcpCompound(rtcp.data(), rtcpSize, report)) {
+                benchSink = report.blocks[i % report.blockCount].extendedHighestSequence;
+            }
+        }
+    });
+}
+
+// Receive thread classification: every datagram on the audio socket is
+// checked for clock sync, then RTCP, then parsed as RTP and counted against
+// its source. The mix is 12 RTP packets from three peers to one RTCP
+// compound and one clock sync message.
+static void AddDemuxCases(BenchHarness& harness) {
+    struct Datagram {
+        std::vector<uint8_t> bytes;
+    };
+    static std::vector<Datagram> datagrams;
+    static std::array<RtpSourceStats, BENCH_DEMUX_SOURCES> sources;
+    static std::array<uint16_t, BENCH_DEMUX_SOURCES> nextSequence{};
+    static const AudioBuffer signal = MakeSignal(BENCH_SAMPLES, BENCH_SEED + 1);
+
+    for (uint32_t i = 0; i < 14; i++) {
+        Datagram datagram;
+        if (i == 6) {
+            RtcpReportBlock block{0x1000, 0, 0, 100, 10, 0, 0};
+            datagram.bytes.resize(RTCP_MAX_PACKET_SIZE);
+            datagram.bytes.resize(WriteRtcpCompound(datagram.bytes.data(), datagram.bytes.size(), 0x1001,
+                                                    nullptr, &block, 1, "peer@voiceqwik"));
+        } else if (i == 13) {
+            datagram.bytes.resize(CLOCK_SYNC_SIZE);
+            WriteClockSync(datagram.bytes.data(), ClockSyncMessage{ClockSyncType::Request, 1, 0, 0});
+        } else {
+            uint32_t source = i % BENCH_DEMUX_SOURCES;
+            RTPHeader header{false, RTP_PAYLOAD_TYPE_PCM16, (uint16_t)(i / BENCH_DEMUX_SOURCES),
+                             (uint32_t)(i / BENCH_DEMUX_SOURCES) * BENCH_SAMPLES, 0x1000u + source};
+            datagram.bytes.resize(RTP_HEADER_SIZE + BENCH_SAMPLES * sizeof(int16_t));
+            WriteRTPHeader(datagram.bytes.data(), header);
+            EncodePayload(PayloadEncoding::Pcm16, signal.data(), BENCH_SAMPLES, datagram.bytes.data() + RTP_HEADER_SIZE);
+        }
+        datagrams.push_back(std::move(datagram));
+    }
+
+    harness.Add("demux/classify", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            const Datagram& datagram = datagrams[i % datagrams.size()];
+            const uint8_t* data = datagram.bytes.data();
+            size_t length = datagram.bytes.size();
+
+            if (IsClockSync(data, length)) {
+                ClockSyncMessage message{};
+                ParseClockSync(data, length, message);
+                benchSink = (uint32_t)message.originateMicros;
+                continue;
+            }
+            if (IsRtcpPacket(data, length)) {
+                RtcpReport report{};
+                ParseRtcpCompound(data, length, report);
+                benchSink = report.senderSsrc;
+                continue;
+            }
+
+            RTPHeader header{};
+            size_t headerSize = 0;
+            size_t payloadSize = 0;
+            if (!ParseRTPHeader(data, length, header, headerSize, payloadSize)) continue;
+            // Each source sees an endless in-order stream, whatever the replayed header says
+            size_t source = (header.ssrc - 0x1000u) % BENCH_DEMUX_SOURCES;
+            uint16_t sequence = nextSequence[source]++;
+            benchSink = (uint32_t)sources[source].Update(sequence, (uint32_t)sequence * BENCH_SAMPLES,
+                                                         i * BENCH_SAMPLES);
+        }
+    });
+}
+
+static void AddQueueCases(BenchHarness& harness) {
+    static const AudioBuffer signal = MakeSignal(BENCH_SAMPLES, BENCH_SEED + 2);
+    static PlayoutQueue inOrder;
+    static PlayoutQueue reordered;
+    static uint16_t inOrderSequence = 0;
+    static uint16_t reorderedIndex = 0;
+    static AudioBuffer played;
+
+    // Steady state: one packet in, one out, a few packets of depth
+    harness.Add("queue/playout_in_order", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            inOrder.Add(inOrderSequence++, i, signal.data(), BENCH_SAMPLES);
+            int64_t arrival = 0;
+            if (inOrder.Size() > BENCH_PLAYOUT_DEPTH) inOrder.Pop(played, arrival);
+            benchSink = (uint32_t)arrival;
+        }
+    });
+
+    // Every other pair swapped: each second packet inserts behind the back
+    harness.Add("queue/playout_reordered", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            uint16_t index = reorderedIndex++;
+            uint16_t sequence = (index & 3) == 1 ? index + 1 : (index & 3) == 2 ? index - 1 : index;
+            reordered.Add(sequence, i, signal.data(), BENCH_SAMPLES);
+            int64_t arrival = 0;
+            if (reordered.Size() > BENCH_PLAYOUT_DEPTH) reordered.Pop(played, arrival);
+            benchSink = (uint32_t)arrival;
+        }
+    });
+
+    // Packet handoff between threads through a ring slot, without a lock
+    using PacketSlot = std::array<int16_t, BENCH_SAMPLES>;
+    static SpscRing<PacketSlot, 16> ring;
+    harness.Add("queue/spsc_packet", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            if (PacketSlot* slot = ring.BeginPush()) {
+                FrameKernels::Copy(slot->data(), signal.data(), BENCH_SAMPLES);
+                ring.EndPush();
+            }
+            if (PacketSlot* front = ring.Front()) {
+                benchSink = (uint32_t)(*front)[i % BENCH_SAMPLES];
+                ring.Pop();
+            }
+        }
+    });
+}
+
+static void AddMixCases(BenchHarness& harness) {
+    static std::vector<AudioBuffer> peers;
+    for (uint32_t p = 0; p < 8; p++) {
+        peers.push_back(MakeSignal(BENCH_SAMPLES, BENCH_SEED + 10 + p));
+    }
+    static AudioMixer mixer;
+    static AudioBuffer mixed;
+
+    auto mixPeers = [](uint32_t count) {
+        return [count](uint32_t n) {
+            for (uint32_t i = 0; i < n; i++) {
+                mixer.Begin();
+                for (uint32_t p = 0; p < count; p++) {
+                    mixer.AddSource(peers[p]);
+                }
+                mixer.Finish(mixed);
+                benchSink = (uint32_t)mixed[i % BENCH_SAMPLES];
+            }
+        };
+    };
+
+    // A full session mixes every remote peer
+    harness.Add("mix/3_peers", BENCH_BATCH, mixPeers(BENCH_REMOTE_PEERS));
+    harness.Add("mix/8_peers", BENCH_BATCH, mixPeers(8));
+
+    // As the application mixes: per-peer loudness normalization and a master volume
+    static AudioMixer normalizingMixer;
+    normalizingMixer.SetMasterGain(0.7f);
+    harness.Add("mix/3_peers_normalized", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            normalizingMixer.Begin();
+            for (uint32_t p = 0; p < BENCH_REMOTE_PEERS; p++) {
+                normalizingMixer.AddSource(p + 1, peers[p]);
+            }
+            normalizingMixer.Finish(mixed);
+            benchSink = (uint32_t)mixed[i % BENCH_SAMPLES];
+        }
+    });
+
+    // Capture AGC: gain, limiter and level measurement in one pass
+    static GainControl captureGain(CAPTURE_GAIN_MIN_DB, CAPTURE_GAIN_MAX_DB);
+    static AudioBuffer captured(BENCH_SAMPLES);
+    harness.Add("agc/block", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            FrameKernels::Copy(captured.data(), peers[i % 8].data(), BENCH_SAMPLES);
+            uint32_t energy = FrameKernels::ScaleLimit(captured.data(), captureGain.GetLinearGain(), BENCH_SAMPLES);
+            captureGain.Update(energy, BENCH_SAMPLES);
+            benchSink = (uint32_t)captured[i % BENCH_SAMPLES];
+        }
+    });
+}
+
+static void AddConvertCases(BenchHarness& harness) {
+    static const AudioBuffer signal = MakeSignal(BENCH_SAMPLES, BENCH_SEED + 3);
+    static std::array<uint8_t, MAX_RTP_PAYLOAD_SIZE> mulaw{};
+    static std::array<uint8_t, MAX_RTP_PAYLOAD_SIZE> halfRate{};
+    static std::array<int16_t, MAX_SAMPLES_PER_PACKET> decoded{};
+    static size_t mulawSize = EncodePayload(PayloadEncoding::Mulaw, signal.data(), BENCH_SAMPLES, mulaw.data());
+    static size_t halfRateSize = EncodePayload(PayloadEncoding::MulawHalfRate, signal.data(), BENCH_SAMPLES,
+                                               halfRate.data());
+
+    harness.Add("convert/mulaw_encode", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            EncodePayload(PayloadEncoding::Mulaw, signal.data(), BENCH_SAMPLES, mulaw.data());
+            benchSink = mulaw[i % BENCH_SAMPLES];
+        }
+    });
+
+    harness.Add("convert/mulaw_decode", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            DecodePayload(PayloadEncoding::Mulaw, mulaw.data(), mulawSize, decoded.data(), decoded.size());
+            benchSink = (uint32_t)decoded[i % BENCH_SAMPLES];
+        }
+    });
+
+    harness.Add("convert/halfrate_encode", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            EncodePayload(PayloadEncoding::MulawHalfRate, signal.data(), BENCH_SAMPLES, halfRate.data());
+            benchSink = halfRate[i % (BENCH_SAMPLES / 2)];
+        }
+    });
+
+    harness.Add("convert/halfrate_decode", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            DecodePayload(PayloadEncoding::MulawHalfRate, halfRate.data(), halfRateSize, decoded.data(), decoded.size());
+            benchSink = (uint32_t)decoded[i % BENCH_SAMPLES];
+        }
+    });
+}
+
+static void AddLogCases(BenchHarness& harness) {
+    // Caller side only; the writer thread drains between samples
+    auto drain = [] { Logger::GetInstance().Flush(); };
+
+    harness.Add("log/format_2_args", BENCH_LOG_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            LOG_ERROR_FMT("Failed to send audio to peer {}: {}", i & 3, 10054);
+        }
+    }, drain);
+
+    static const std::string message = "Failed to send audio to peer 2: 10054";
+    harness.Add("log/string", BENCH_LOG_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            LOG_ERROR(message);
+        }
+    }, drain);
+
+    static MetricHistogram histogram;
+    harness.Add("metrics/histogram_record", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            histogram.Record((uint64_t)(i * 2654435761u) >> 12);
+        }
+    });
+}
+
+// Playback handoff as AudioEngine does it: the mixed buffer is copied into a
+// ring slot, read by the device's render callback and copied into the device
+// buffer, with the latency marker mixed on top when enabled.
+static void AddPlaybackCases(BenchHarness& harness) {
+    struct TimedPacket {
+        std::array<int16_t, MAX_SAMPLES_PER_PACKET> samples;
+        uint32_t count;
+        int64_t micros;
+    };
+    static SpscRing<TimedPacket, PLAYBACK_RING_PACKETS> playbackRing;
+    static const AudioBuffer mixed = MakeSignal(BENCH_SAMPLES, BENCH_SEED + 4);
+    static std::array<int16_t, MAX_SAMPLES_PER_PACKET> renderBuffer{};
+    static LatencyMarkerGenerator marker;
+
+    harness.Add("playback/queue_copy", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            if (TimedPacket* slot = playbackRing.BeginPush()) {
+                std::memcpy(slot->samples.data(), mixed.data(), mixed.size() * sizeof(int16_t));
+                slot->count = (uint32_t)mixed.size();
+                slot->micros = (int64_t)i;
+                playbackRing.EndPush();
+            }
+
+            TimedPacket* queued = playbackRing.Front();
+            std::memcpy(renderBuffer.data(), queued->samples.data(), queued->count * sizeof(int16_t));
+            playbackRing.Pop();
+            benchSink = (uint32_t)renderBuffer[i % BENCH_SAMPLES];
+        }
+    });
+
+    harness.Add("playback/marker_mix", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            if (!marker.IsActive()) marker.Trigger();
+            marker.Mix(renderBuffer.data(), FramesPerPacket(BENCH_PACKET_TIME));
+            benchSink = (uint32_t)renderBuffer[i % BENCH_SAMPLES];
+        }
+    });
+}
+
+// Media-thread side of call recording: one packet copied into the recorder's
+// ring with the writer thread running, and a burst far bigger than the ring,
+// which is almost all drops
+static void AddRecordCases(BenchHarness& harness) {
+    static const AudioBuffer packet = MakeSignal(BENCH_SAMPLES, BENCH_SEED + 5);
+
+    auto waitForWriter = [] {
+        while (CallRecorder::GetInstance().GetQueuedPackets() != 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    };
+
+    harness.Add("record/packet", BENCH_RECORD_BATCH, [](uint32_t n) {
+        CallRecorder& recorder = CallRecorder::GetInstance();
+        for (uint32_t i = 0; i < n; i++) {
+            recorder.RecordSource(1 + i % BENCH_REMOTE_PEERS, packet);
+        }
+    }, waitForWriter);
+
+    harness.Add("record/overflow", BENCH_BATCH, [](uint32_t n) {
+        CallRecorder& recorder = CallRecorder::GetInstance();
+        for (uint32_t i = 0; i < n; i++) {
+            recorder.RecordMix(packet);
+        }
+    }, waitForWriter);
+}
+
+// One capture block through a converged echo canceller: the far end talks
+// with a syllable-like envelope and comes back 20 ms later at half level
+static void AddEchoCases(BenchHarness& harness) {
+    static EchoCanceller canceller;
+    static AudioBuffer far = MakeSignal(BENCH_AEC_FAR_BLOCKS * AEC_BLOCK_FRAMES, BENCH_SEED + 6);
+    static std::array<int16_t, AEC_BLOCK_FRAMES> capture{};
+    static uint64_t block = 0;
+
+    for (uint32_t b = 0; b < BENCH_AEC_FAR_BLOCKS; b++) {
+        float level = 0.2f + 0.8f * std::fabs(std::sin(b * 0.37f));
+        for (uint32_t i = 0; i < AEC_BLOCK_FRAMES; i++) {
+            int16_t& sample = far[b * AEC_BLOCK_FRAMES + i];
+            sample = (int16_t)(sample * level);
+        }
+    }
+
+    auto process = [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++, block++) {
+            size_t farSize = far.size();
+            size_t start = (block % BENCH_AEC_FAR_BLOCKS) * AEC_BLOCK_FRAMES;
+            int64_t micros = (int64_t)block * 10000;
+            canceller.AddReference(far.data() + start, AEC_BLOCK_FRAMES, micros);
+            for (uint32_t f = 0; f < AEC_BLOCK_FRAMES; f++) {
+                size_t echo = (start + f + farSize - BENCH_AEC_ECHO_FRAMES) % farSize;
+                capture[f] = block * AEC_BLOCK_FRAMES + f >= BENCH_AEC_ECHO_FRAMES ? (int16_t)(far[echo] / 2) : 0;
+            }
+            canceller.ProcessBlock(capture.data(), micros);
+            benchSink = (uint32_t)capture[i % AEC_BLOCK_FRAMES];
+        }
+    };
+    process(BENCH_AEC_CONVERGE_BLOCKS);
+
+    harness.Add("aec/block", BENCH_AEC_BATCH, process);
+    harness.SetBudget("aec/block", BENCH_AEC_BUDGET_NS);
+}
+
+// One capture block through the noise suppressor: fan-like noise under
+// speech-level bursts, with the noise estimate settled
+static void AddNoiseCases(BenchHarness& harness) {
+    static NoiseSuppressor suppressor;
+    static AudioBuffer noisy = MakeSignal(BENCH_NS_BLOCKS * NS_BLOCK_FRAMES, BENCH_SEED + 7);
+    static std::array<int16_t, NS_BLOCK_FRAMES> capture{};
+    static uint32_t block = 0;
+
+    for (uint32_t b = 0; b < BENCH_NS_BLOCKS; b++) {
+        float level = (b / 8) % 2 ? 1.0f : 0.03f;
+        for (uint32_t i = 0; i < NS_BLOCK_FRAMES; i++) {
+            int16_t& sample = noisy[b * NS_BLOCK_FRAMES + i];
+            sample = (int16_t)(sample * level);
+        }
+    }
+
+    auto process = [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++, block++) {
+            std::memcpy(capture.data(), noisy.data() + (block % BENCH_NS_BLOCKS) * NS_BLOCK_FRAMES,
+                        NS_BLOCK_FRAMES * sizeof(int16_t));
+            suppressor.ProcessBlock(capture.data());
+            benchSink = (uint32_t)capture[i % NS_BLOCK_FRAMES];
+        }
+    };
+    process(BENCH_NS_BLOCKS);
+
+    harness.Add("ns/block", BENCH_NS_BATCH, process);
+    harness.SetBudget("ns/block", BENCH_NS_BUDGET_NS);
+}
+
+// One 10 ms PCM16 packet encrypted and decrypted in place, as the send and
+// receive threads do for an encrypted peer. Both copy the packet in first
+// (decryption consumes it), so the two stay comparable.
+static void AddCryptoCases(BenchHarness& harness) {
+    static const AudioBuffer signal = MakeSignal(BENCH_SAMPLES, BENCH_SEED + 8);
+    static std::array<uint8_t, MAX_PROTECTED_RTP_SIZE> plain{};
+    static std::array<uint8_t, MAX_PROTECTED_RTP_SIZE> sealed{};
+    static std::array<uint8_t, MAX_PROTECTED_RTP_SIZE> work{};
+    static size_t plainSize = 0;
+    static size_t sealedSize = 0;
+    static MediaKey key{};
+
+    for (size_t i = 0; i < MEDIA_KEY_SIZE; i++) key.key[i] = (uint8_t)(i * 7 + 1);
+    for (size_t i = 0; i < MEDIA_SALT_SIZE; i++) key.salt[i] = (uint8_t)(i * 13 + 5);
+    RTPHeader header{false, RTP_PAYLOAD_TYPE_PCM16, 1, 0, 0x1234};
+    WriteRTPHeader(plain.data(), header);
+    std::memcpy(plain.data() + RTP_HEADER_SIZE, signal.data(), BENCH_SAMPLES * sizeof(int16_t));
+    plainSize = RTP_HEADER_SIZE + BENCH_SAMPLES * sizeof(int16_t);
+    sealed = plain;
+    sealedSize = ProtectMediaPacket(key, MediaStream::Rtp, 0, sealed.data(), RTP_HEADER_SIZE, plainSize,
+                                    sealed.size());
+
+    harness.Add("crypto/seal_10ms", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            std::memcpy(work.data(), plain.data(), plainSize);
+            size_t size = ProtectMediaPacket(key, MediaStream::Rtp, i, work.data(), RTP_HEADER_SIZE, plainSize,
+                                             work.size());
+            benchSink = work[size - 1];
+        }
+    });
+
+    harness.Add("crypto/open_10ms", BENCH_BATCH, [](uint32_t n) {
+        for (uint32_t i = 0; i < n; i++) {
+            std::memcpy(work.data(), sealed.data(), sealedSize);
+            size_t size = sealedSize;
+            if (UnprotectMediaPacket(key, MediaStream::Rtp, work.data(), RTP_HEADER_SIZE, size)) {
+                benchSink = work[(size - 1) & i];
+            }
+        }
+    });
+}
+
+int main(int argc, char** argv) {
+    BenchHarness harness;
+    if (!harness.ParseArgs(argc, argv)) {
+        return 2;
+    }
+
+    // Exercise the full writer path without flooding the terminal
+    Logger::GetInstance().SetConsoleOutput(false);
+    Logger::GetInstance().SetLogFile("voiceqwik_bench.log");
+
+    AddRtpCases(harness);
+    AddDemuxCases(harness);
+    AddQueueCases(harness);
+    AddMixCases(harness);
+    AddConvertCases(harness);
+    AddLogCases(harness);
+    AddPlaybackCases(harness);
+    AddRecordCases(harness);
+    AddEchoCases(harness);
+    AddNoiseCases(harness);
+    AddCryptoCases(harness);
+    for (const char* name : BENCH_REALTIME_CASES) {
+        harness.SetRealtime(name);
+    }
+
+    CallRecorder::GetInstance().Start(BENCH_RECORD_FILE);
+    int result = harness.Run("voiceqwik_bench");
+    CallRecorder::GetInstance().Stop();
+    std::remove(BENCH_RECORD_FILE);
+    return result;
+}
@@ -0,0 +1,58 @@
+#ifndef VOICEQWIK_AUDIO_DEVICE_H
+#define VOICEQWIK_AUDIO_DEVICE_H
+
+#include <audio/AudioFormat.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+
+// An audio endpoint pair (capture + render) driven by its own clock. Capture
+// is pushed: the device hands over frames as they arrive. Render is pulled:
+// the device asks for what it has room for, never more than it can play, and
+// for how much of that it needs to keep playing until it next asks.
+// Callbacks run on the device's threads.
+
+struct AudioDeviceFormat {
+    uint32_t sampleRate;
+    uint16_t channels;
+    uint32_t periodFrames;   // frames per callback (render may ask for fewer)
+};
+
+// Interleaved PCM16 frames captured at captureMicros (LatencyClockMicros of the first frame)
+using AudioCaptureCallback = std::function<void(const int16_t* samples, uint32_t frames, int64_t captureMicros)>;
+
+// Fill up to maxFrames interleaved frames with queued audio, and at least
+// minFrames (silence where the queue is short); returns the frames filled.
+// The first one becomes audible at presentMicros.
+using AudioRenderCallback =
+    std::function<uint32_t(int16_t* samples, uint32_t minFrames, uint32_t maxFrames, int64_t presentMicros)>;
+
+class AudioDevice {
+public:
+    virtual ~AudioDevice() = default;
+
+    virtual const char* GetName() const = 0;
+
+    // Negotiates the format: false if the device cannot run at the requested
+    // rate and channel count (there is no resampler), otherwise negotiated
+    // holds what it will actually use
+    virtual bool Open(const AudioDeviceFormat& requested, AudioDeviceFormat& negotiated) = 0;
+    virtual void Close() = 0;
+
+    virtual bool StartCapture(AudioCaptureCallback callback) = 0;
+    virtual void StopCapture() = 0;
+    virtual bool StartRender(AudioRenderCallback callback) = 0;
+    virtual void StopRender() = 0;
+};
+
+// Device-free backends that run anywhere (see SoftwareAudioDevice.h):
+//   null                  silence in, render discarded
+//   tone                  440 Hz half-second bursts in, render discarded
+//   loopback[:ms]         render comes back as capture after ms (default 0)
+//   wav:in.wav[,out.wav]  capture read from in.wav, render written to out.wav
+// With realTime false the device clock free-runs, as fast as the callbacks
+// allow; timestamps then follow the virtual clock. nullptr on a bad spec.
+std::unique_ptr<AudioDevice> CreateSoftwareAudioDevice(const std::string& spec, bool realTime = true);
+
+#endif // VOICEQWIK_AUDIO_DEVICE_H
@@ -0,0 +1,136 @@
+#ifndef VOICEQWIK_AUDIO_ENGINE_H
+#define VOICEQWIK_AUDIO_ENGINE_H
+
+#include <utils/Common.h>
+#include <audio/AudioDevice.h>
+#include <audio/EchoCanceller.h>
+#include <audio/GainControl.h>
+#include <audio/LatencyMarker.h>
+#include <audio/NoiseSuppressor.h>
+#include <utils/SpscRing.h>
+#include <array>
+
+// Packets in flight between the device callbacks and the main loop; the
+// capture ring holds CAPTURE_QUEUE_LIMIT_US at the shortest packet time
+constexpr size_t CAPTURE_RING_PACKETS = 128;
+constexpr size_t PLAYBACK_RING_PACKETS = 256;
+
+// Frames device audio into packets and back. Capture from the device is cut
+// into packets at the session packet time and queued for the main loop; the
+// mixed packets the main loop queues are pulled out by the device's render
+// callback. Which device does the I/O (WASAPI, files, loopback) is chosen at
+// Initialize.
+class AudioEngine {
+public:
+    static AudioEngine& GetInstance();
+
+    // Opens the device at the wire format (48 kHz mono PCM16) with a 10 ms
+    // period, or the packet time if that is shorter: set a short packet time
+    // first for capture to keep up with it. The period stays until Shutdown.
+    bool Initialize(std::unique_ptr<AudioDevice> device);
+    void Shutdown();
+
+    // Capture operations (main loop only: the capture ring has one consumer)
+    bool StartCapture();
+    void StopCapture();
+    bool GetCaptureBuffer(AudioBuffer& buffer);
+    // Also returns when the packet's first sample was captured (LatencyClockMicros)
+    bool GetCaptureBuffer(AudioBuffer& buffer, int64_t& captureMicros);
+    // Drops captured packets nobody collected, e.g. while no call is up
+    void DiscardCapture();
+
+    // Captured audio is framed into packets of this duration
+    void SetPacketTime(PacketTime ptime);
+    PacketTime GetPacketTime() const;
+
+    // Playback operations
+    bool StartPlayback();
+    void StopPlayback();
+    // False if the buffer is over a packet or the device has stopped pulling
+    bool QueuePlaybackBuffer(const AudioBuffer& buffer);
+
+    // Latency measurement: periodic marker bursts in playback, detected in
+    // capture, give the device round trip
+    void SetLatencyMarkers(bool enabled);
+
+    // Acoustic echo cancellation of what playback leaks into capture
+    void SetEchoCancellation(bool enabled);
+    bool GetEchoCancellation() const { return echoCancellation; }
+    const EchoCanceller& GetEchoCanceller() const { return echoCanceller; }
+
+    // Spectral suppression of stationary noise (fans, hum) in capture; adds
+    // NS_DELAY_MICROS to the capture path while on
+    void SetNoiseSuppression(bool enabled);
+    bool GetNoiseSuppression() const { return noiseSuppression; }
+    const NoiseSuppressor& GetNoiseSuppressor() const { return noiseSuppressor; }
+
+    // Automatic gain control of capture towards GAIN_TARGET_DBFS, after the
+    // noise suppressor, with the limiter in the same pass
+    void SetAutomaticGain(bool enabled);
+    bool GetAutomaticGain() const { return automaticGain; }
+    // Current capture gain, dB (capture thread's value, read racily)
+    float GetCaptureGainDb() const { return captureGain.GetGainDb(); }
+
+    AudioDevice* GetDevice() const { return device.get(); }
+    const AudioDeviceFormat& GetFormat() const { return format; }
+
+private:
+    AudioEngine();
+    ~AudioEngine();
+
+    AudioEngine(const AudioEngine&) = delete;
+    AudioEngine& operator=(const AudioEngine&) = delete;
+
+    std::unique_ptr<AudioDevice> device;
+    AudioDeviceFormat format;
+    bool capturing;
+    bool playing;
+
+    std::atomic<PacketTime> packetTime;
+
+    // Fixed-size slots, so neither device callback allocates or locks
+    struct TimedPacket {
+        std::array<int16_t, MAX_SAMPLES_PER_PACKET> samples;
+        uint32_t count;
+        int64_t micros;   // capture time, or time queued for playback
+    };
+
+    // Capture callback accumulates device samples until a full packet is ready
+    AudioBuffer captureAccumulator;
+    int64_t captureAccumulatorMicros;   // capture time of captureAccumulator[0]
+    size_t captureProcessed;            // leading samples of captureAccumulator already echo cancelled
+    SpscRing<TimedPacket, CAPTURE_RING_PACKETS> captureRing;
+
+    // Render callback drains the front packet across as many calls as it takes
+    SpscRing<TimedPacket, PLAYBACK_RING_PACKETS> playbackRing;
+    size_t playbackOffset;              // samples of the front packet already rendered
+    bool playbackPrimed;                // audio played since the queue last ran dry
+    bool playbackGap;                   // ran dry mid-stream, audio not back yet
+    uint64_t playbackGapFrames;         // silence in the gap, counted once audio is back
+    std::array<int16_t, AUDIO_CHANNELS> renderLast;   // last frame rendered, where a gap fades from
+
+    // Marker written by the render callback, looked for by the capture callback
+    std::atomic<bool> latencyMarkers;
+    std::atomic<int64_t> markerWrittenMicros;   // 0 = none outstanding
+    int64_t lastMarkerMicros;
+    LatencyMarkerGenerator markerGenerator;
+    LatencyMarkerDetector markerDetector;
+
+    // Fed by the render callback, run by the capture callback
+    std::atomic<bool> echoCancellation;
+    std::atomic<bool> echoResetPending;
+    EchoCanceller echoCanceller;
+
+    std::atomic<bool> noiseSuppression;
+    std::atomic<bool> noiseResetPending;
+    NoiseSuppressor noiseSuppressor;
+
+    std::atomic<bool> automaticGain;
+    std::atomic<bool> gainResetPending;
+    GainControl captureGain;
+
+    void OnCapture(const int16_t* samples, uint32_t frames, int64_t captureMicros);
+    uint32_t OnRender(int16_t* samples, uint32_t minFrames, uint32_t maxFrames, int64_t presentMicros);
+};
+
+#endif // VOICEQWIK_AUDIO_ENGINE_H
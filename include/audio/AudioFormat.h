@@ -0,0 +1,77 @@
+#ifndef VOICEQWIK_AUDIO_FORMAT_H
+#define VOICEQWIK_AUDIO_FORMAT_H
+
+#include <cstdint>
+#include <vector>
+
+// Wire/device audio format
+constexpr uint16_t AUDIO_SAMPLE_RATE = 48000;
+constexpr uint16_t AUDIO_CHANNELS = 1;  // Mono for lower bandwidth
+constexpr uint16_t AUDIO_BITS_PER_SAMPLE = 16;
+
+// Packet time (ptime), stored in half-milliseconds so 2.5ms stays integral.
+// Short ptimes trade header efficiency for latency (LAN), long ones the reverse (WAN).
+enum class PacketTime : uint8_t {
+    Ms2_5 = 5,
+    Ms5 = 10,
+    Ms10 = 20,
+    Ms20 = 40,
+    Ms40 = 80
+};
+
+constexpr PacketTime DEFAULT_PACKET_TIME = PacketTime::Ms10;
+constexpr PacketTime MIN_PACKET_TIME = PacketTime::Ms2_5;
+constexpr PacketTime MAX_PACKET_TIME = PacketTime::Ms40;
+
+constexpr PacketTime ALL_PACKET_TIMES[] = {
+    PacketTime::Ms2_5, PacketTime::Ms5, PacketTime::Ms10, PacketTime::Ms20, PacketTime::Ms40
+};
+
+// Samples per channel in one packet
+constexpr uint32_t FramesPerPacket(PacketTime ptime) {
+    return static_cast<uint32_t>(ptime) * AUDIO_SAMPLE_RATE / 2000;
+}
+
+// Interleaved samples in one packet
+constexpr uint32_t SamplesPerPacket(PacketTime ptime) {
+    return FramesPerPacket(ptime) * AUDIO_CHANNELS;
+}
+
+// Packet duration in microseconds
+constexpr uint32_t PacketTimeMicros(PacketTime ptime) {
+    return static_cast<uint32_t>(ptime) * 500;
+}
+
+constexpr uint32_t MAX_FRAMES_PER_PACKET = FramesPerPacket(MAX_PACKET_TIME);
+constexpr uint32_t MAX_SAMPLES_PER_PACKET = SamplesPerPacket(MAX_PACKET_TIME);
+
+static_assert(FramesPerPacket(PacketTime::Ms10) == 480, "10ms must be 480 frames at 48kHz");
+
+inline bool IsValidPacketTime(uint8_t code) {
+    for (PacketTime ptime : ALL_PACKET_TIMES) {
+        if (static_cast<uint8_t>(ptime) == code) return true;
+    }
+    return false;
+}
+
+inline const char* PacketTimeToString(PacketTime ptime) {
+    switch (ptime) {
+        case PacketTime::Ms2_5: return "2.5ms";
+        case PacketTime::Ms5: return "5ms";
+        case PacketTime::Ms10: return "10ms";
+        case PacketTime::Ms20: return "20ms";
+        case PacketTime::Ms40: return "40ms";
+        default: return "unknown";
+    }
+}
+
+// Both ends agree on the longer of the two preferences: a peer asking for a
+// long ptime is usually on a constrained link and cannot afford the shorter one.
+inline PacketTime NegotiatePacketTime(PacketTime local, PacketTime remote) {
+    return static_cast<uint8_t>(local) >= static_cast<uint8_t>(remote) ? local : remote;
+}
+
+// Interleaved PCM16 samples
+using AudioBuffer = std::vector<int16_t>;
+
+#endif // VOICEQWIK_AUDIO_FORMAT_H
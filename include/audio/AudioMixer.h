@@ -0,0 +1,64 @@
+#ifndef VOICEQWIK_AUDIO_MIXER_H
+#define VOICEQWIK_AUDIO_MIXER_H
+
+#include <audio/AudioFormat.h>
+#include <audio/GainControl.h>
+#include <vector>
+
+// Sums one packet from each contributing peer into a single playback packet.
+// Sources may differ in length; the output covers the longest one.
+//
+// Gains cost no extra passes: each source is scaled by its loudness
+// normalization gain as it is summed (measuring its level on the way), and
+// the master volume and the limiter are applied as the sum is written out.
+class AudioMixer {
+public:
+    AudioMixer();
+
+    // Start a new output packet
+    void Begin();
+
+    // Add one source packet at unity gain (samples beyond MAX_SAMPLES_PER_PACKET are ignored)
+    void AddSource(const int16_t* samples, uint32_t count);
+    void AddSource(const AudioBuffer& buffer);
+
+    // Add a peer's packet; with normalization on, it is brought towards
+    // GAIN_TARGET_DBFS by a gain tracked per sourceId
+    void AddSource(uint32_t sourceId, const AudioBuffer& buffer);
+
+    // Scale the sum by the master gain and limit it into out; returns false if
+    // no source was added
+    bool Finish(AudioBuffer& out);
+
+    uint32_t GetSourceCount() const;
+
+    // Linear master volume applied to the mix
+    void SetMasterGain(float gain) { masterGain = gain; }
+    float GetMasterGain() const { return masterGain; }
+
+    // Per-peer loudness normalization (on by default)
+    void SetLoudnessNormalization(bool enabled);
+    // Current normalization gain of a source; false if it is not tracked
+    bool GetSourceGainDb(uint32_t sourceId, float& gainDb) const;
+
+private:
+    struct SourceLoudness {
+        uint32_t sourceId;
+        uint64_t lastMix;           // mixCount when last added
+        GainControl gain;
+    };
+
+    std::vector<float> accumulator;
+    uint32_t mixedSamples;
+    uint32_t sourceCount;
+    float masterGain;
+    bool normalize;
+    uint64_t mixCount;
+    std::vector<SourceLoudness> sources;
+
+    SourceLoudness& FindSource(uint32_t sourceId);
+    // Sums samples * gain into the accumulator; returns their energy
+    uint32_t AddScaled(const int16_t* samples, uint32_t count, float gain);
+};
+
+#endif // VOICEQWIK_AUDIO_MIXER_H
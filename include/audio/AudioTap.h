@@ -0,0 +1,132 @@
+#ifndef VOICEQWIK_AUDIO_TAP_H
+#define VOICEQWIK_AUDIO_TAP_H
+
+#include <utils/Common.h>
+#include <audio/AudioFormat.h>
+#include <platform/SharedMemory.h>
+
+// Shared-memory tap: the call's audio published for other processes
+// (transcription, archiving) to read as it happens. Each packet of our own
+// capture, of each participant as fed to the mixer, and of the mix is copied
+// into the next slot of a ring in a named shared memory region, stamped with
+// a sequence number and a time. The writer never waits for a reader and makes
+// no system call per packet. Readers map the region once and follow the
+// published count with plain loads; a reader a whole ring behind loses the
+// oldest packets, and knows how many, without slowing anybody else.
+//
+// Layout, host byte order: AudioTapHeader, then slotCount AudioTapSlots. A
+// slot holds packet `sequence` while its sequence field says so; the writer
+// sets it to AUDIO_TAP_WRITING before refilling the slot, so a reader's copy
+// that raced a refill shows as a changed sequence and is discarded (seqlock).
+
+constexpr uint32_t AUDIO_TAP_MAGIC = 0x50545156;   // "VQTP"
+constexpr uint32_t AUDIO_TAP_VERSION = 1;
+constexpr uint32_t AUDIO_TAP_SLOTS = 1024;         // 2 s of a full call at 10 ms (5 streams)
+constexpr uint64_t AUDIO_TAP_WRITING = ~0ull;
+
+// Streams: the mix, our own capture, and remote participants by peer ID
+constexpr uint32_t AUDIO_TAP_STREAM_MIX = 0;
+constexpr uint32_t AUDIO_TAP_STREAM_LOCAL = 0xFFFFFFFF;
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "The tap's counters are shared between processes");
+
+struct AudioTapHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t headerSize;
+    uint32_t slotSize;
+    uint32_t slotCount;
+    uint32_t sampleRate;
+    uint32_t channels;
+    std::atomic<uint32_t> live;         // 0 once the writer has stopped
+    alignas(64) std::atomic<uint64_t> published;   // packets written: the next sequence
+};
+
+struct alignas(64) AudioTapSlot {
+    std::atomic<uint64_t> sequence;
+    int64_t micros;           // steady clock (LatencyClockMicros): capture time for the local stream, else mix time
+    uint64_t streamPosition;  // samples of this stream published before this packet
+    uint32_t stream;
+    uint32_t sampleCount;
+    int16_t samples[MAX_SAMPLES_PER_PACKET];
+};
+
+// One packet as a reader copies it out
+struct AudioTapPacket {
+    uint64_t sequence;
+    int64_t micros;
+    uint64_t streamPosition;
+    uint32_t stream;
+    uint32_t sampleCount;
+    int16_t samples[MAX_SAMPLES_PER_PACKET];
+};
+
+// The publishing side. Publish* must all come from one thread, and
+// Start/Stop must not race them (main calls all of them from its loop).
+class AudioTap {
+public:
+    static AudioTap& GetInstance();
+
+    // Creates the region; readers attach to it by the same name
+    bool Start(const std::string& name);
+    void Stop();
+    bool IsRunning() const { return running.load(std::memory_order_relaxed); }
+
+    void PublishCapture(const AudioBuffer& samples, int64_t captureMicros);
+    void PublishSource(uint32_t peerId, const AudioBuffer& samples);
+    void PublishMix(const AudioBuffer& samples);
+
+    uint64_t GetPublished() const { return published; }
+
+private:
+    AudioTap();
+    ~AudioTap();
+
+    AudioTap(const AudioTap&) = delete;
+    AudioTap& operator=(const AudioTap&) = delete;
+
+    // Sample positions per stream; a stream not seen for longest gives up its entry
+    static constexpr size_t MAX_STREAMS = MAX_PARTICIPANTS + 4;
+    struct StreamPosition {
+        uint32_t stream;
+        uint64_t samples;
+        uint64_t lastSequence;
+    };
+
+    std::atomic<bool> running;
+    SharedMemory memory;
+    AudioTapHeader* header;
+    AudioTapSlot* slots;
+    uint64_t published;
+    StreamPosition positions[MAX_STREAMS];
+    size_t positionCount;
+
+    void Publish(uint32_t stream, const AudioBuffer& samples, int64_t micros);
+    uint64_t& PositionOf(uint32_t stream);
+};
+
+// The reading side, for tools and sidecars. Starts at the newest packet.
+class AudioTapReader {
+public:
+    AudioTapReader();
+
+    // False if there is no tap by that name or its layout is not this version's
+    bool Open(const std::string& name);
+    void Close();
+
+    // Copies out the next packet; false when caught up. Packets overwritten
+    // before they were read are skipped and counted.
+    bool Read(AudioTapPacket& packet);
+
+    bool IsLive() const { return header && header->live.load(std::memory_order_acquire) != 0; }
+    uint64_t GetLost() const { return lost; }
+
+private:
+    SharedMemory memory;
+    const AudioTapHeader* header;
+    const AudioTapSlot* slots;
+    uint64_t next;
+    uint64_t lost;
+};
+
+#endif // VOICEQWIK_AUDIO_TAP_H
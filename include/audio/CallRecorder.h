@@ -0,0 +1,85 @@
+#ifndef VOICEQWIK_CALL_RECORDER_H
+#define VOICEQWIK_CALL_RECORDER_H
+
+#include <utils/Common.h>
+#include <utils/SpscRing.h>
+#include <audio/AudioFormat.h>
+#include <audio/WavFile.h>
+
+// Channel 1 is the mix, the rest are remote participants in join order
+constexpr uint16_t RECORDER_CHANNELS = MAX_PARTICIPANTS;
+constexpr size_t RECORDER_RING_CAPACITY = 512;      // packets: about a second of a full call at 10 ms
+constexpr uint32_t RECORDER_WRITE_BUFFER_FRAMES = AUDIO_SAMPLE_RATE;   // one second per fwrite
+constexpr int RECORDER_DRAIN_INTERVAL_MS = 20;
+constexpr int RECORDER_HEADER_INTERVAL_MS = 2000;
+
+// One recorded packet, copied whole into a ring slot
+struct RecorderPacket {
+    uint32_t peerId;                            // 0 = the mix
+    uint32_t sampleCount;
+    int16_t samples[MAX_SAMPLES_PER_PACKET];
+};
+
+// Records a call to a multichannel WAV file: the mix plus each remote
+// participant's jitter-buffer output. The media thread only copies packets
+// into a preallocated lock-free ring (one bounded memcpy, no locks, no I/O)
+// and counts a drop when it is full. A below-normal-priority thread drains
+// the ring, interleaves the channels into a large buffer, writes it in
+// blocks and patches the WAV header every couple of seconds.
+//
+// RecordSource/RecordMix must all come from one thread, and Start/Stop must
+// not race them (main calls all four from its loop).
+class CallRecorder {
+public:
+    static CallRecorder& GetInstance();
+
+    bool Start(const std::string& filename);
+    void Stop();
+    bool IsRecording() const { return recording.load(std::memory_order_relaxed); }
+
+    // One packet of a participant's audio as fed to the mixer, then the mix
+    // it went into; sources recorded before a mix share its time slot
+    void RecordSource(uint32_t peerId, const AudioBuffer& samples);
+    void RecordMix(const AudioBuffer& samples);
+
+    uint64_t GetDroppedPackets() const { return droppedPackets.load(std::memory_order_relaxed); }
+    // Packets handed off but not yet taken by the writer (approximate)
+    size_t GetQueuedPackets() const { return ring ? ring->Size() : 0; }
+
+private:
+    CallRecorder();
+    ~CallRecorder();
+
+    CallRecorder(const CallRecorder&) = delete;
+    CallRecorder& operator=(const CallRecorder&) = delete;
+
+    using RecorderRing = SpscRing<RecorderPacket, RECORDER_RING_CAPACITY>;
+
+    std::atomic<bool> recording;
+    std::atomic<uint64_t> droppedPackets;
+    std::unique_ptr<RecorderRing> ring;   // allocated on first Start, kept after
+
+    // Writer thread state
+    std::thread writerThread;
+    std::mutex writerMutex;
+    std::condition_variable writerCV;
+    bool stopRequested;
+    WavWriter wavWriter;
+
+    // Time slot being assembled: one packet per channel, the mix in channel 0
+    uint32_t channelPeers[RECORDER_CHANNELS];   // 0 = channel not assigned yet
+    int16_t slotSamples[RECORDER_CHANNELS][MAX_SAMPLES_PER_PACKET];
+    uint32_t slotCounts[RECORDER_CHANNELS];
+    std::vector<int16_t> writeBuffer;           // interleaved frames awaiting fwrite
+    size_t writeBufferFrames;
+
+    void Record(uint32_t peerId, const AudioBuffer& samples);
+    void WriterThreadProc();
+    void DrainRing();
+    void AddPacket(const RecorderPacket& packet);
+    int ChannelForPeer(uint32_t peerId);
+    void EmitSlot();
+    void FlushWriteBuffer();
+};
+
+#endif // VOICEQWIK_CALL_RECORDER_H
@@ -0,0 +1,129 @@
+#ifndef VOICEQWIK_ECHO_CANCELLER_H
+#define VOICEQWIK_ECHO_CANCELLER_H
+
+#include <audio/AudioFormat.h>
+#include <audio/Fft.h>
+#include <utils/SpscRing.h>
+#include <atomic>
+#include <memory>
+#include <vector>
+
+// Echo cancellation works on 10 ms blocks; the filter is split into
+// partitions of one block, each a 1024-point overlap-save FFT
+constexpr uint32_t AEC_BLOCK_FRAMES = AUDIO_SAMPLE_RATE / 100;
+constexpr uint32_t AEC_FFT_SIZE = 1024;
+constexpr uint32_t AEC_BINS = AEC_FFT_SIZE / 2 + 1;
+constexpr uint32_t AEC_PARTITIONS = 8;                   // 80 ms echo tail past the bulk delay
+constexpr uint32_t AEC_HISTORY_FRAMES = 1 << 15;         // rendered audio kept for the delay line (~680 ms)
+constexpr size_t AEC_REFERENCE_RING_CAPACITY = 64;       // render blocks in flight to the capture thread
+
+// Bulk delay search: render and capture energy envelopes in 2 ms steps
+constexpr uint32_t AEC_ENVELOPE_FRAMES = AUDIO_SAMPLE_RATE / 500;
+constexpr uint32_t AEC_DELAY_LAGS = 200;                 // up to 400 ms
+constexpr uint32_t AEC_ENVELOPE_HISTORY = 256;           // render envelope steps kept (power of two)
+constexpr uint32_t AEC_DELAY_MARGIN_FRAMES = 2 * AEC_ENVELOPE_FRAMES;   // filter starts a little early
+
+static_assert(AEC_FFT_SIZE >= 2 * AEC_BLOCK_FRAMES, "Overlap-save needs a block and a partition per FFT");
+static_assert(AEC_BLOCK_FRAMES % AEC_ENVELOPE_FRAMES == 0, "Envelope steps must tile a block");
+static_assert((AEC_HISTORY_FRAMES & (AEC_HISTORY_FRAMES - 1)) == 0, "History is indexed by mask");
+static_assert(AEC_ENVELOPE_HISTORY > AEC_DELAY_LAGS + AEC_BLOCK_FRAMES / AEC_ENVELOPE_FRAMES,
+              "Envelope history must cover every lag");
+
+// Rendered audio on its way from the render callback to the canceller
+struct EchoReferenceBlock {
+    int64_t presentMicros;      // when the first frame is heard
+    uint32_t frames;
+    int16_t samples[AEC_BLOCK_FRAMES];
+};
+
+// Acoustic echo canceller: a partitioned-block frequency-domain NLMS filter
+// (multidelay filter) that models the path from the speaker to the
+// microphone and subtracts its estimate of the echo from capture.
+//
+// The render callback hands over what it plays through a lock-free ring;
+// the capture callback cancels one block at a time in place. Render and
+// capture are lined up by their device timestamps, and a cross-correlation
+// of their energy envelopes finds the bulk delay (device buffers plus the
+// room), so the filter only has to cover the echo tail after it.
+//
+// AddReference is called from the render thread only, everything else from
+// the capture thread only. Nothing allocates after construction.
+class EchoCanceller {
+public:
+    EchoCanceller();
+
+    // Forgets the echo path, delay and reference (capture thread)
+    void Reset();
+
+    // Render thread: mono samples about to be played, first one heard at presentMicros
+    void AddReference(const int16_t* samples, uint32_t frames, int64_t presentMicros);
+
+    // Capture thread: removes the echo from AEC_BLOCK_FRAMES mono samples
+    // captured from captureMicros on
+    void ProcessBlock(int16_t* samples, int64_t captureMicros);
+
+    // Echo return loss enhancement while the far end talks, in dB (0 until measured)
+    double GetErleDb() const { return erleDb.load(std::memory_order_relaxed); }
+    // Estimated render-to-capture delay; negative until found
+    int32_t GetDelayMicros() const { return delayMicros.load(std::memory_order_relaxed); }
+    uint64_t GetDroppedReferenceBlocks() const { return droppedReference.load(std::memory_order_relaxed); }
+
+private:
+    EchoCanceller(const EchoCanceller&) = delete;
+    EchoCanceller& operator=(const EchoCanceller&) = delete;
+
+    using ReferenceRing = SpscRing<EchoReferenceBlock, AEC_REFERENCE_RING_CAPACITY>;
+
+    std::unique_ptr<ReferenceRing> referenceRing;
+    std::atomic<uint64_t> droppedReference;
+
+    // Rendered audio by render frame index, and the frame index a timestamp maps to
+    std::vector<float> history;
+    uint64_t renderFrames;                  // frames appended to history
+    bool anchored;
+    double anchorFrames;                    // render frame index minus timestamp in frames, smoothed
+
+    // Delay search
+    std::vector<float> renderEnvelope;      // log energy per envelope step of render frames
+    uint64_t renderEnvelopeSteps;           // complete steps computed
+    float renderEnvelopeEnergy;             // energy of the step being accumulated
+    std::vector<float> correlation;         // per lag, smoothed
+    float captureMean;
+    float renderMean;
+    float captureVariance;
+    float renderVariance;
+    uint32_t candidateLag;
+    uint32_t candidateCount;
+    int64_t bulkDelayFrames;                // -1 until the delay is found
+
+    // Filter: spectra of the last AEC_PARTITIONS reference frames and the weights for each
+    RealFft fft;
+    std::vector<float> referenceRe;         // [partition][bin], newest at referenceHead
+    std::vector<float> referenceIm;
+    std::vector<float> weightsRe;           // [partition][bin]
+    std::vector<float> weightsIm;
+    uint32_t referenceHead;
+    uint32_t constrainPartition;            // round-robin gradient constraint
+    uint32_t divergedBlocks;                // consecutive blocks the filter added energy
+    std::vector<float> referencePower;      // smoothed per bin
+    std::vector<float> frame;               // time-domain scratch, AEC_FFT_SIZE
+    std::vector<float> spectrumRe;          // frequency-domain scratch, AEC_BINS
+    std::vector<float> spectrumIm;
+    std::vector<float> errorRe;
+    std::vector<float> errorIm;
+    float error[AEC_BLOCK_FRAMES];
+
+    // ERLE over the far end's active blocks
+    float captureEnergy;
+    float residualEnergy;
+    std::atomic<double> erleDb;
+    std::atomic<int32_t> delayMicros;
+
+    void DrainReference();
+    void AppendHistory(const int16_t* samples, uint32_t frames, int64_t presentMicros);
+    void UpdateDelay(const int16_t* samples, uint64_t blockFrame);
+    void ResetFilter();
+    bool ReadReference(uint64_t firstFrame, uint32_t frames, float* out) const;
+};
+
+#endif // VOICEQWIK_ECHO_CANCELLER_H
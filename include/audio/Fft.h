@@ -0,0 +1,82 @@
+#ifndef VOICEQWIK_FFT_H
+#define VOICEQWIK_FFT_H
+
+#include <audio/FrameKernels.h>
+#include <cstdint>
+#include <vector>
+
+// Real-input FFT of a fixed power-of-two size, for the capture-path DSP.
+// Spectra are kept split (separate real and imaginary arrays of size/2 + 1
+// bins) and every butterfly stage walks contiguous twiddle tables, so the
+// inner loops are plain unit-stride float loops the compiler vectorizes.
+// Tables and scratch are allocated once, in the constructor; Forward and
+// Inverse never allocate. One instance is not safe to use from two threads.
+class RealFft {
+public:
+    explicit RealFft(uint32_t size);
+
+    uint32_t GetSize() const { return size; }
+    uint32_t GetBins() const { return size / 2 + 1; }
+
+    // size samples in, GetBins() bins out
+    void Forward(const float* VQ_RESTRICT in, float* VQ_RESTRICT re, float* VQ_RESTRICT im);
+
+    // GetBins() bins in, size samples out, normalized so Inverse(Forward(x)) == x
+    void Inverse(const float* VQ_RESTRICT re, const float* VQ_RESTRICT im, float* VQ_RESTRICT out);
+
+private:
+    uint32_t size;
+    uint32_t half;                      // complex FFT length
+    std::vector<uint32_t> bitReverse;
+    std::vector<float> stageCos;        // per stage, concatenated: 1, 2, 4, ... half/2 entries
+    std::vector<float> stageSin;
+    std::vector<float> splitCos;        // e^{-2 pi i k / size}, k < half
+    std::vector<float> splitSin;
+    std::vector<float> workRe;
+    std::vector<float> workIm;
+
+    void Transform(bool inverse);
+};
+
+namespace FrameKernels {
+
+// Complex multiply-accumulate over split spectra: acc += a * b (or a * conj(b))
+inline void ComplexMultiplyAdd(float* VQ_RESTRICT accRe, float* VQ_RESTRICT accIm, const float* VQ_RESTRICT aRe,
+                               const float* VQ_RESTRICT aIm, const float* VQ_RESTRICT bRe,
+                               const float* VQ_RESTRICT bIm, uint32_t bins) {
+    for (uint32_t i = 0; i < bins; ++i) {
+        accRe[i] += aRe[i] * bRe[i] - aIm[i] * bIm[i];
+        accIm[i] += aRe[i] * bIm[i] + aIm[i] * bRe[i];
+    }
+}
+
+inline void ComplexMultiplyConjugateAdd(float* VQ_RESTRICT accRe, float* VQ_RESTRICT accIm,
+                                        const float* VQ_RESTRICT aRe, const float* VQ_RESTRICT aIm,
+                                        const float* VQ_RESTRICT bRe, const float* VQ_RESTRICT bIm,
+                                        uint32_t bins) {
+    for (uint32_t i = 0; i < bins; ++i) {
+        accRe[i] += aRe[i] * bRe[i] + aIm[i] * bIm[i];
+        accIm[i] += aIm[i] * bRe[i] - aRe[i] * bIm[i];
+    }
+}
+
+// power[i] = re[i]^2 + im[i]^2
+inline void PowerSpectrum(float* VQ_RESTRICT power, const float* VQ_RESTRICT re, const float* VQ_RESTRICT im,
+                          uint32_t bins) {
+    for (uint32_t i = 0; i < bins; ++i) {
+        power[i] = re[i] * re[i] + im[i] * im[i];
+    }
+}
+
+// re[i], im[i] *= gain[i]
+inline void ScaleSpectrum(float* VQ_RESTRICT re, float* VQ_RESTRICT im, const float* VQ_RESTRICT gain,
+                          uint32_t bins) {
+    for (uint32_t i = 0; i < bins; ++i) {
+        re[i] *= gain[i];
+        im[i] *= gain[i];
+    }
+}
+
+} // namespace FrameKernels
+
+#endif // VOICEQWIK_FFT_H
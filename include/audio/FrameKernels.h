@@ -0,0 +1,215 @@
+#ifndef VOICEQWIK_FRAME_KERNELS_H
+#define VOICEQWIK_FRAME_KERNELS_H
+
+#include <audio/AudioFormat.h>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+#if defined(_MSC_VER)
+#define VQ_RESTRICT __restrict
+#else
+#define VQ_RESTRICT __restrict__
+#endif
+
+// Per-frame sample kernels. Each kernel has a fixed-size template instantiated
+// for the supported packet times (constant trip count, so the compiler fully
+// unrolls/vectorizes it) plus a runtime entry point that dispatches to the
+// matching instantiation and falls back to a plain loop for odd sizes.
+namespace FrameKernels {
+
+// Calls fn(std::integral_constant<uint32_t, N>{}) when samples is one of the
+// packet sizes we specialize for; returns false otherwise.
+template <typename Fn>
+inline bool DispatchPacketSize(uint32_t samples, Fn&& fn) {
+    switch (samples) {
+        case SamplesPerPacket(PacketTime::Ms2_5):
+            fn(std::integral_constant<uint32_t, SamplesPerPacket(PacketTime::Ms2_5)>{});
+            return true;
+        case SamplesPerPacket(PacketTime::Ms5):
+            fn(std::integral_constant<uint32_t, SamplesPerPacket(PacketTime::Ms5)>{});
+            return true;
+        case SamplesPerPacket(PacketTime::Ms10):
+            fn(std::integral_constant<uint32_t, SamplesPerPacket(PacketTime::Ms10)>{});
+            return true;
+        case SamplesPerPacket(PacketTime::Ms20):
+            fn(std::integral_constant<uint32_t, SamplesPerPacket(PacketTime::Ms20)>{});
+            return true;
+        case SamplesPerPacket(PacketTime::Ms40):
+            fn(std::integral_constant<uint32_t, SamplesPerPacket(PacketTime::Ms40)>{});
+            return true;
+        default:
+            return false;
+    }
+}
+
+// acc[i] += in[i]
+template <uint32_t N>
+inline void Accumulate(int32_t* VQ_RESTRICT acc, const int16_t* VQ_RESTRICT in) {
+    for (uint32_t i = 0; i < N; ++i) {
+        acc[i] += in[i];
+    }
+}
+
+inline void Accumulate(int32_t* VQ_RESTRICT acc, const int16_t* VQ_RESTRICT in, uint32_t samples) {
+    if (DispatchPacketSize(samples, [&](auto n) { Accumulate<decltype(n)::value>(acc, in); })) {
+        return;
+    }
+    for (uint32_t i = 0; i < samples; ++i) {
+        acc[i] += in[i];
+    }
+}
+
+// out[i] = clamp(acc[i], INT16_MIN, INT16_MAX)
+template <uint32_t N>
+inline void Saturate(int16_t* VQ_RESTRICT out, const int32_t* VQ_RESTRICT acc) {
+    for (uint32_t i = 0; i < N; ++i) {
+        int32_t v = acc[i];
+        v = v < -32768 ? -32768 : v;
+        v = v > 32767 ? 32767 : v;
+        out[i] = static_cast<int16_t>(v);
+    }
+}
+
+inline void Saturate(int16_t* VQ_RESTRICT out, const int32_t* VQ_RESTRICT acc, uint32_t samples) {
+    if (DispatchPacketSize(samples, [&](auto n) { Saturate<decltype(n)::value>(out, acc); })) {
+        return;
+    }
+    for (uint32_t i = 0; i < samples; ++i) {
+        int32_t v = acc[i];
+        v = v < -32768 ? -32768 : v;
+        v = v > 32767 ? 32767 : v;
+        out[i] = static_cast<int16_t>(v);
+    }
+}
+
+template <uint32_t N>
+inline void Copy(int16_t* VQ_RESTRICT dst, const int16_t* VQ_RESTRICT src) {
+    std::memcpy(dst, src, N * sizeof(int16_t));
+}
+
+inline void Copy(int16_t* VQ_RESTRICT dst, const int16_t* VQ_RESTRICT src, uint32_t samples) {
+    if (DispatchPacketSize(samples, [&](auto n) { Copy<decltype(n)::value>(dst, src); })) {
+        return;
+    }
+    std::memcpy(dst, src, samples * sizeof(int16_t));
+}
+
+template <uint32_t N>
+inline void Clear(int32_t* acc) {
+    std::memset(acc, 0, N * sizeof(int32_t));
+}
+
+inline void Clear(int32_t* acc, uint32_t samples) {
+    if (DispatchPacketSize(samples, [&](auto n) { Clear<decltype(n)::value>(acc); })) {
+        return;
+    }
+    std::memset(acc, 0, samples * sizeof(int32_t));
+}
+
+template <uint32_t N>
+inline void Clear(float* acc) {
+    std::memset(acc, 0, N * sizeof(float));
+}
+
+inline void Clear(float* acc, uint32_t samples) {
+    if (DispatchPacketSize(samples, [&](auto n) { Clear<decltype(n)::value>(acc); })) {
+        return;
+    }
+    std::memset(acc, 0, samples * sizeof(float));
+}
+
+// Gain kernels report the energy of their input, sum((in[i] >> 5)^2), i.e.
+// about sum(in[i]^2) >> ENERGY_SHIFT, so loudness tracking rides along with
+// the pass that applies the gain. Squaring 16-bit values keeps it cheap.
+constexpr uint32_t ENERGY_SHIFT = 10;
+static_assert((uint64_t)MAX_SAMPLES_PER_PACKET * ((32768u * 32768u) >> ENERGY_SHIFT) <= UINT32_MAX,
+              "Packet energy must fit 32 bits");
+
+// Soft-knee limiter: unity below LIMITER_KNEE, then a parabola that bends
+// into full scale, reached (with zero slope) LIMITER_RANGE past full scale
+constexpr float LIMITER_KNEE = 24576.0f;                  // -2.5 dBFS
+constexpr float LIMITER_RANGE = 32767.0f - LIMITER_KNEE;
+
+// Written without comparisons or division so the loops around it vectorize
+inline float Limit(float v) {
+    float over = std::fabs(v) - LIMITER_KNEE;
+    float excess = 0.5f * (over + std::fabs(over));                           // max(over, 0)
+    float span = 2.0f * LIMITER_RANGE;
+    float knee = 0.5f * (excess + span - std::fabs(excess - span));           // min(excess, span)
+    float reduction = excess - knee + knee * knee * (0.25f / LIMITER_RANGE);
+    return v - std::copysign(reduction, v);
+}
+
+// acc[i] += in[i] * gain; returns the energy of in
+template <uint32_t N>
+inline uint32_t AccumulateScaled(float* VQ_RESTRICT acc, const int16_t* VQ_RESTRICT in, float gain) {
+    uint32_t energy = 0;
+    for (uint32_t i = 0; i < N; ++i) {
+        int32_t v = in[i];
+        acc[i] += (float)v * gain;
+        energy += (uint32_t)((v >> (ENERGY_SHIFT / 2)) * (v >> (ENERGY_SHIFT / 2)));
+    }
+    return energy;
+}
+
+inline uint32_t AccumulateScaled(float* VQ_RESTRICT acc, const int16_t* VQ_RESTRICT in, float gain,
+                                 uint32_t samples) {
+    uint32_t energy = 0;
+    if (DispatchPacketSize(samples, [&](auto n) { energy = AccumulateScaled<decltype(n)::value>(acc, in, gain); })) {
+        return energy;
+    }
+    for (uint32_t i = 0; i < samples; ++i) {
+        int32_t v = in[i];
+        acc[i] += (float)v * gain;
+        energy += (uint32_t)((v >> (ENERGY_SHIFT / 2)) * (v >> (ENERGY_SHIFT / 2)));
+    }
+    return energy;
+}
+
+// out[i] = Limit(acc[i] * gain)
+template <uint32_t N>
+inline void ScaleLimit(int16_t* VQ_RESTRICT out, const float* VQ_RESTRICT acc, float gain) {
+    for (uint32_t i = 0; i < N; ++i) {
+        out[i] = static_cast<int16_t>(Limit(acc[i] * gain));
+    }
+}
+
+inline void ScaleLimit(int16_t* VQ_RESTRICT out, const float* VQ_RESTRICT acc, float gain, uint32_t samples) {
+    if (DispatchPacketSize(samples, [&](auto n) { ScaleLimit<decltype(n)::value>(out, acc, gain); })) {
+        return;
+    }
+    for (uint32_t i = 0; i < samples; ++i) {
+        out[i] = static_cast<int16_t>(Limit(acc[i] * gain));
+    }
+}
+
+// samples[i] = Limit(samples[i] * gain) in place; returns the energy before the gain
+template <uint32_t N>
+inline uint32_t ScaleLimit(int16_t* VQ_RESTRICT samples, float gain) {
+    uint32_t energy = 0;
+    for (uint32_t i = 0; i < N; ++i) {
+        int32_t v = samples[i];
+        energy += (uint32_t)((v >> (ENERGY_SHIFT / 2)) * (v >> (ENERGY_SHIFT / 2)));
+        samples[i] = static_cast<int16_t>(Limit((float)v * gain));
+    }
+    return energy;
+}
+
+inline uint32_t ScaleLimit(int16_t* VQ_RESTRICT samples, float gain, uint32_t count) {
+    uint32_t energy = 0;
+    if (DispatchPacketSize(count, [&](auto n) { energy = ScaleLimit<decltype(n)::value>(samples, gain); })) {
+        return energy;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+        int32_t v = samples[i];
+        energy += (uint32_t)((v >> (ENERGY_SHIFT / 2)) * (v >> (ENERGY_SHIFT / 2)));
+        samples[i] = static_cast<int16_t>(Limit((float)v * gain));
+    }
+    return energy;
+}
+
+} // namespace FrameKernels
+
+#endif // VOICEQWIK_FRAME_KERNELS_H
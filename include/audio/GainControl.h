@@ -0,0 +1,47 @@
+#ifndef VOICEQWIK_GAIN_CONTROL_H
+#define VOICEQWIK_GAIN_CONTROL_H
+
+#include <audio/AudioFormat.h>
+#include <cstdint>
+
+// Active speech level everyone is brought to (ITU-T P.56 style, RMS)
+constexpr float GAIN_TARGET_DBFS = -24.0f;
+// Quieter packets are pauses or background and leave the level alone
+constexpr float GAIN_GATE_DBFS = -50.0f;
+
+// Capture AGC: weak microphones get up to +20 dB, hot ones down to -10 dB
+constexpr float CAPTURE_GAIN_MAX_DB = 20.0f;
+constexpr float CAPTURE_GAIN_MIN_DB = -10.0f;
+// Per-peer loudness normalization on receive
+constexpr float RECEIVE_GAIN_MAX_DB = 12.0f;
+constexpr float RECEIVE_GAIN_MIN_DB = -12.0f;
+
+// Slow automatic gain towards GAIN_TARGET_DBFS. It does not touch samples:
+// the owner applies GetLinearGain() with a FrameKernels gain kernel and feeds
+// the energy that kernel reports back into Update, so measuring and applying
+// are one pass. The gain moves a few dB per second (faster down than up), and
+// the limiter after it catches what the level estimate has not caught up with.
+class GainControl {
+public:
+    GainControl(float minGainDb, float maxGainDb);
+
+    void Reset();
+
+    // One packet of count samples with energy from a FrameKernels gain kernel
+    void Update(uint32_t energy, uint32_t count);
+
+    float GetLinearGain() const { return linearGain; }
+    float GetGainDb() const { return gainDb; }
+    // Estimated active speech level before the gain, dBFS
+    float GetLevelDb() const { return levelDb; }
+
+private:
+    float minGainDb;
+    float maxGainDb;
+    float levelDb;
+    float gainDb;
+    float linearGain;
+    bool measured;          // a packet above the gate has been seen
+};
+
+#endif // VOICEQWIK_GAIN_CONTROL_H
@@ -0,0 +1,67 @@
+#ifndef VOICEQWIK_LATENCY_MARKER_H
+#define VOICEQWIK_LATENCY_MARKER_H
+
+#include <audio/AudioFormat.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Acoustic markers for measuring device delay: a short tone burst is mixed
+// into playback and found again in capture (over a loopback device or through
+// the room), so the time between writing and hearing it is the render plus
+// capture path the timestamps cannot see.
+
+constexpr uint32_t LATENCY_MARKER_FREQUENCY = 3000;   // Hz; exact Goertzel bin for the block size
+constexpr uint32_t LATENCY_MARKER_FRAMES = AUDIO_SAMPLE_RATE / 50;         // 20 ms burst
+constexpr uint32_t LATENCY_MARKER_BLOCK_FRAMES = AUDIO_SAMPLE_RATE / 500;  // 2 ms resolution
+constexpr uint32_t LATENCY_MARKER_MIN_BLOCKS = 3;     // consecutive tonal blocks for a hit
+constexpr int LATENCY_MARKER_INTERVAL_MS = 1000;
+constexpr int LATENCY_MARKER_TIMEOUT_MS = 1000;       // give up waiting for a burst
+constexpr int16_t LATENCY_MARKER_AMPLITUDE = 8000;
+
+static_assert((LATENCY_MARKER_FREQUENCY * LATENCY_MARKER_BLOCK_FRAMES) % AUDIO_SAMPLE_RATE == 0,
+              "Marker frequency must sit on a detector bin");
+
+class LatencyMarkerGenerator {
+public:
+    LatencyMarkerGenerator();
+
+    // Starts a new burst from the next Mix() call
+    void Trigger();
+    bool IsActive() const { return active; }
+
+    // Adds the pending part of the burst into interleaved samples, saturating
+    void Mix(int16_t* samples, size_t frames);
+
+private:
+    std::vector<int16_t> burst;
+    uint32_t position;
+    bool active;
+};
+
+class LatencyMarkerDetector {
+public:
+    LatencyMarkerDetector();
+
+    void Reset();
+
+    // Feeds interleaved samples (first channel is analyzed). On a hit returns
+    // true with onsetFrame set to the burst's first frame, counted from Reset().
+    bool Process(const int16_t* samples, size_t frames, uint64_t& onsetFrame);
+
+    uint64_t GetFramesProcessed() const { return framesProcessed; }
+
+private:
+    float coefficient;
+    float s1;
+    float s2;
+    float energy;
+    uint32_t blockFill;
+    uint32_t tonalBlocks;
+    uint64_t framesProcessed;
+    uint64_t refractoryUntil;
+
+    bool FinishBlock();
+};
+
+#endif // VOICEQWIK_LATENCY_MARKER_H
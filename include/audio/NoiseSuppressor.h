@@ -0,0 +1,64 @@
+#ifndef VOICEQWIK_NOISE_SUPPRESSOR_H
+#define VOICEQWIK_NOISE_SUPPRESSOR_H
+
+#include <audio/AudioFormat.h>
+#include <audio/Fft.h>
+#include <atomic>
+#include <vector>
+
+// Noise suppression works on the capture path's 10 ms blocks, analysed in
+// two 5 ms hops of 10 ms sqrt-Hann windows (50% overlap-add)
+constexpr uint32_t NS_BLOCK_FRAMES = AUDIO_SAMPLE_RATE / 100;
+constexpr uint32_t NS_HOP_FRAMES = NS_BLOCK_FRAMES / 2;
+constexpr uint32_t NS_WINDOW_FRAMES = 2 * NS_HOP_FRAMES;
+constexpr uint32_t NS_FFT_SIZE = 512;
+constexpr uint32_t NS_BINS = NS_FFT_SIZE / 2 + 1;
+constexpr int64_t NS_DELAY_MICROS = (int64_t)NS_HOP_FRAMES * 1000000 / AUDIO_SAMPLE_RATE;   // output lags input
+
+static_assert(NS_FFT_SIZE >= NS_WINDOW_FRAMES, "Window must fit the FFT");
+static_assert(NS_BLOCK_FRAMES % NS_HOP_FRAMES == 0, "Hops must tile a block");
+
+// Spectral noise suppressor: tracks the stationary noise floor per bin
+// (smoothed minimum, rising slowly so speech pauses pull it back down) and
+// applies a Wiener gain from a decision-directed a priori SNR, floored so
+// the residual noise stays natural rather than musical.
+//
+// Output is the input delayed by NS_DELAY_MICROS. Capture thread only;
+// nothing allocates after construction.
+class NoiseSuppressor {
+public:
+    NoiseSuppressor();
+
+    // Forgets the noise estimate and the overlap
+    void Reset();
+
+    // Suppresses noise in NS_BLOCK_FRAMES mono samples in place
+    void ProcessBlock(int16_t* samples);
+
+    // Estimated noise floor, dBFS (-120 until estimated)
+    double GetNoiseLevelDb() const { return noiseLevelDb.load(std::memory_order_relaxed); }
+
+private:
+    NoiseSuppressor(const NoiseSuppressor&) = delete;
+    NoiseSuppressor& operator=(const NoiseSuppressor&) = delete;
+
+    RealFft fft;
+    std::vector<float> window;              // sqrt-Hann, analysis and synthesis
+    std::vector<float> input;               // last NS_WINDOW_FRAMES input samples
+    std::vector<float> overlap;             // second half of the previous hop's output
+    std::vector<float> frame;               // NS_FFT_SIZE scratch
+    std::vector<float> re;
+    std::vector<float> im;
+    std::vector<float> power;
+    std::vector<float> smoothedPower;
+    std::vector<float> noise;
+    std::vector<float> cleanPower;          // previous hop's gain^2 * power (decision-directed SNR)
+    std::vector<float> gain;
+    bool primed;                            // noise estimate seeded
+
+    std::atomic<double> noiseLevelDb;
+
+    void ProcessHop(int16_t* samples);
+};
+
+#endif // VOICEQWIK_NOISE_SUPPRESSOR_H
@@ -0,0 +1,39 @@
+#ifndef VOICEQWIK_PAYLOAD_CODEC_H
+#define VOICEQWIK_PAYLOAD_CODEC_H
+
+#include <audio/AudioFormat.h>
+#include <cstddef>
+#include <cstdint>
+
+// RTP payload encodings, from full quality to smallest. All decode back to
+// 48 kHz PCM16 before the jitter buffer, so nothing downstream changes.
+enum class PayloadEncoding : uint8_t {
+    Pcm16,          // 16-bit PCM, host order (768 kbps mono)
+    Mulaw,          // G.711 mu-law companding (384 kbps)
+    MulawHalfRate,  // mu-law at 24 kHz (192 kbps)
+    Count
+};
+
+// Dynamic payload types; Pcm16 keeps the original RTP_PAYLOAD_TYPE (111)
+constexpr uint8_t RTP_PAYLOAD_TYPE_PCM16 = 111;
+constexpr uint8_t RTP_PAYLOAD_TYPE_MULAW = 112;
+constexpr uint8_t RTP_PAYLOAD_TYPE_MULAW_HALF = 113;
+
+uint8_t PayloadTypeForEncoding(PayloadEncoding encoding);
+bool EncodingForPayloadType(uint8_t payloadType, PayloadEncoding& encoding);
+const char* PayloadEncodingToString(PayloadEncoding encoding);
+
+// Encoded size of sampleCount interleaved 48 kHz samples
+size_t EncodedPayloadSize(PayloadEncoding encoding, size_t sampleCount);
+
+// Encodes into out (EncodedPayloadSize bytes); returns the bytes written
+size_t EncodePayload(PayloadEncoding encoding, const int16_t* samples, size_t sampleCount, uint8_t* out);
+
+// Decodes to 48 kHz PCM16; returns samples written, 0 if it would not fit
+size_t DecodePayload(PayloadEncoding encoding, const uint8_t* data, size_t length,
+                     int16_t* out, size_t maxSamples);
+
+uint8_t MulawEncode(int16_t sample);
+int16_t MulawDecode(uint8_t value);
+
+#endif // VOICEQWIK_PAYLOAD_CODEC_H
@@ -0,0 +1,56 @@
+#ifndef VOICEQWIK_RENDER_SCHEDULER_H
+#define VOICEQWIK_RENDER_SCHEDULER_H
+
+#include <cstdint>
+
+// Render pacing for a device that drains a fixed buffer at its own clock and
+// wakes the render thread once a period (WASAPI shared mode). On each wake
+// the padding (frames still queued in the device) gives the free space, the
+// most that can be written, and how much must be written for the device to
+// last until the next wake with a period to spare. Between the two the
+// engine writes what audio it has: the device is kept fed without padding it
+// out with silence, which would be heard as a gap and then as added latency.
+// No platform calls, so it runs against a fake device clock anywhere.
+
+// Queued after a write, in periods: one until the next wake plus one for a late wake
+constexpr uint32_t RENDER_SAFETY_PERIODS = 2;
+
+struct RenderRequest {
+    uint32_t minFrames;      // to reach the safety level; silence where the queue is short
+    uint32_t maxFrames;      // free space in the device buffer
+    int64_t presentMicros;   // when the first frame written is heard
+    int64_t lateMicros;      // how long past its period the device ran before this wake; -1 on the first
+    bool starved;            // the device ran dry since the last write: an audible gap
+};
+
+class RenderScheduler {
+public:
+    RenderScheduler();
+
+    // New stream: device buffer and wake period in frames
+    void Reset(uint32_t bufferFrames, uint32_t periodFrames, uint32_t sampleRate);
+
+    // padding: frames the device still had queued at nowMicros. False when
+    // the buffer is full and there is nothing to write.
+    bool OnWake(uint32_t padding, int64_t nowMicros, RenderRequest& request);
+
+    // After the write: frames actually written (minFrames..maxFrames)
+    void OnWritten(uint32_t frames);
+
+    uint32_t GetSafetyFrames() const { return safetyFrames; }
+    uint64_t GetWakes() const { return wakes; }
+    uint64_t GetStarvations() const { return starvations; }
+
+private:
+    uint32_t bufferFrames;
+    uint32_t periodFrames;
+    uint32_t sampleRate;
+    uint32_t safetyFrames;
+    uint32_t padding;        // at the last wake
+    uint32_t queued;         // in the device after the last wake's write
+    bool written;            // anything written since Reset; an empty device before that is no gap
+    uint64_t wakes;
+    uint64_t starvations;
+};
+
+#endif // VOICEQWIK_RENDER_SCHEDULER_H
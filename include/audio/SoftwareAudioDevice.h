@@ -0,0 +1,136 @@
+#ifndef VOICEQWIK_SOFTWARE_AUDIO_DEVICE_H
+#define VOICEQWIK_SOFTWARE_AUDIO_DEVICE_H
+
+#include <audio/AudioDevice.h>
+#include <audio/WavFile.h>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Devices without hardware: one clock thread ticks once per period, pulls a
+// period of render audio and then pushes a period of capture. In real time
+// the ticks follow the steady clock; otherwise they run back to back on a
+// virtual clock that starts at the real time of the first Start call.
+//
+// Timestamps model a device with one period of buffering each way: capture
+// is stamped one period before its tick, render becomes audible one period
+// after it. Subclasses call Close() in their destructors, so the clock thread
+// stops before their members go away.
+class SoftwareAudioDevice : public AudioDevice {
+public:
+    explicit SoftwareAudioDevice(bool realTime);
+    ~SoftwareAudioDevice() override;
+
+    bool Open(const AudioDeviceFormat& requested, AudioDeviceFormat& negotiated) override;
+    void Close() override;
+
+    bool StartCapture(AudioCaptureCallback callback) override;
+    void StopCapture() override;
+    bool StartRender(AudioRenderCallback callback) override;
+    void StopRender() override;
+
+    // Device clock position, in frames since the clock started
+    uint64_t GetFramesElapsed() const { return framesElapsed; }
+
+protected:
+    AudioDeviceFormat format;
+
+    // Backend hooks, called on the clock thread (Open/Close on the caller's)
+    virtual bool OpenBackend() { return true; }
+    virtual void CloseBackend() {}
+    virtual void ProduceCapture(int16_t* samples, uint32_t frames) = 0;
+    virtual void ConsumeRender(const int16_t* samples, uint32_t frames) = 0;
+
+private:
+    bool realTime;
+    bool opened;
+
+    std::thread clockThread;
+    std::atomic<bool> clockRunning;
+    std::atomic<uint64_t> framesElapsed;
+
+    // Held by the clock thread for a whole tick, so Stop* returns only
+    // once its callback can no longer run
+    std::mutex callbackMutex;
+    AudioCaptureCallback captureCallback;
+    AudioRenderCallback renderCallback;
+
+    std::vector<int16_t> captureBuffer;
+    std::vector<int16_t> renderBuffer;
+
+    void StartClock();
+    void StopClockIfIdle();
+    void ClockThreadProc();
+};
+
+class NullAudioDevice : public SoftwareAudioDevice {
+public:
+    explicit NullAudioDevice(bool realTime) : SoftwareAudioDevice(realTime) {}
+    ~NullAudioDevice() override { Close(); }
+    const char* GetName() const override { return "null"; }
+
+protected:
+    void ProduceCapture(int16_t* samples, uint32_t frames) override;
+    void ConsumeRender(const int16_t*, uint32_t) override {}
+};
+
+// 440 Hz during the first half of every second, silence in the second
+class ToneAudioDevice : public SoftwareAudioDevice {
+public:
+    explicit ToneAudioDevice(bool realTime) : SoftwareAudioDevice(realTime), sampleClock(0) {}
+    ~ToneAudioDevice() override { Close(); }
+    const char* GetName() const override { return "tone"; }
+
+protected:
+    void ProduceCapture(int16_t* samples, uint32_t frames) override;
+    void ConsumeRender(const int16_t*, uint32_t) override {}
+
+private:
+    uint64_t sampleClock;
+};
+
+// Render comes back as capture: two periods of modeled device buffering plus
+// delayMs, so latency markers measure a known round trip
+class LoopbackAudioDevice : public SoftwareAudioDevice {
+public:
+    LoopbackAudioDevice(bool realTime, uint32_t delayMs);
+    ~LoopbackAudioDevice() override { Close(); }
+    const char* GetName() const override { return "loopback"; }
+
+protected:
+    bool OpenBackend() override;
+    void ProduceCapture(int16_t* samples, uint32_t frames) override;
+    void ConsumeRender(const int16_t* samples, uint32_t frames) override;
+
+private:
+    uint32_t delayMs;
+    size_t targetSamples;      // delay line length between ticks
+    std::deque<int16_t> delayLine;
+};
+
+// Capture from a WAV file (silence once it ends), render into another
+class WavFileAudioDevice : public SoftwareAudioDevice {
+public:
+    WavFileAudioDevice(bool realTime, const std::string& captureFile, const std::string& renderFile);
+    ~WavFileAudioDevice() override { Close(); }
+    const char* GetName() const override { return "wav"; }
+
+    bool IsCaptureFinished() const { return captureFinished; }
+
+protected:
+    bool OpenBackend() override;
+    void CloseBackend() override;
+    void ProduceCapture(int16_t* samples, uint32_t frames) override;
+    void ConsumeRender(const int16_t* samples, uint32_t frames) override;
+
+private:
+    std::string captureFile;
+    std::string renderFile;
+    WavReader reader;
+    WavWriter writer;
+    std::atomic<bool> captureFinished;
+};
+
+#endif // VOICEQWIK_SOFTWARE_AUDIO_DEVICE_H
@@ -0,0 +1,73 @@
+#ifndef VOICEQWIK_WASAPI_AUDIO_DEVICE_H
+#define VOICEQWIK_WASAPI_AUDIO_DEVICE_H
+
+#include <utils/Common.h>
+#include <audio/AudioDevice.h>
+#include <platform/Win32.h>
+#include <audioclient.h>
+#include <comdef.h>
+#include <Objbase.h>
+#include <mmdeviceapi.h>
+
+// Default console endpoints in shared, event-driven mode, at the default
+// engine period (10 ms) unless the request is shorter and the engine offers a
+// shorter one (IAudioClient3, Windows 10 and a driver that supports it).
+// Render is paced by the device padding on each event (RenderScheduler): up
+// to all the free space, at least enough to last until the next event with
+// one to spare.
+class WasapiAudioDevice : public AudioDevice {
+public:
+    WasapiAudioDevice();
+    ~WasapiAudioDevice() override;
+
+    const char* GetName() const override { return "wasapi"; }
+
+    bool Open(const AudioDeviceFormat& requested, AudioDeviceFormat& negotiated) override;
+    void Close() override;
+
+    bool StartCapture(AudioCaptureCallback callback) override;
+    void StopCapture() override;
+    bool StartRender(AudioRenderCallback callback) override;
+    void StopRender() override;
+
+    // Device management
+    bool EnumerateAudioDevices();
+    bool SelectCaptureDevice(int deviceIndex);
+    bool SelectPlaybackDevice(int deviceIndex);
+
+private:
+    WasapiAudioDevice(const WasapiAudioDevice&) = delete;
+    WasapiAudioDevice& operator=(const WasapiAudioDevice&) = delete;
+
+    bool comInitialized;
+    AudioDeviceFormat format;
+
+    // COM objects
+    IMMDeviceEnumerator* deviceEnumerator;
+    IMMDevice* captureDevice;
+    IMMDevice* playbackDevice;
+    IAudioClient* captureClient;
+    IAudioClient* playbackClient;
+    IAudioCaptureClient* captureControl;
+    IAudioRenderClient* playbackControl;
+    UINT32 playbackBufferFrames;
+
+    HANDLE captureEvent;
+    HANDLE playbackEvent;
+
+    std::thread captureThread;
+    std::thread playbackThread;
+    std::atomic<bool> captureRunning;
+    std::atomic<bool> playbackRunning;
+
+    AudioCaptureCallback captureCallback;
+    AudioRenderCallback renderCallback;
+    AudioBuffer silence;   // stands in for buffers flagged silent
+
+    void CaptureThreadProc();
+    void PlaybackThreadProc();
+    // periodFrames is the engine period the client ended up with
+    HRESULT InitializeAudioClient(IAudioClient* client, uint32_t& periodFrames);
+};
+
+#endif // VOICEQWIK_WASAPI_AUDIO_DEVICE_H
@@ -0,0 +1,68 @@
+#ifndef VOICEQWIK_WAV_FILE_H
+#define VOICEQWIK_WAV_FILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+// 16-bit PCM RIFF/WAVE files: enough for test signals and recordings, no
+// other sample formats
+
+struct WavFormat {
+    uint32_t sampleRate;
+    uint16_t channels;
+};
+
+class WavReader {
+public:
+    WavReader();
+    ~WavReader();
+
+    bool Open(const std::string& filename);
+    void Close();
+
+    const WavFormat& GetFormat() const { return format; }
+    uint64_t GetTotalFrames() const { return totalFrames; }
+
+    // Reads up to `frames` interleaved frames; returns how many were read (0 at the end)
+    size_t Read(int16_t* samples, size_t frames);
+
+private:
+    FILE* file;
+    WavFormat format;
+    uint64_t totalFrames;
+    uint64_t framesLeft;
+
+    WavReader(const WavReader&) = delete;
+    WavReader& operator=(const WavReader&) = delete;
+};
+
+class WavWriter {
+public:
+    WavWriter();
+    ~WavWriter();
+
+    bool Open(const std::string& filename, const WavFormat& format);
+
+    // Patches the header sizes; the file is valid only after this (or UpdateHeader)
+    bool Close();
+
+    // Patches the header for what has been written so far and flushes, so a
+    // long recording stays playable if the process dies
+    bool UpdateHeader();
+
+    bool IsOpen() const { return file != nullptr; }
+    bool Write(const int16_t* samples, size_t frames);
+    uint64_t GetFramesWritten() const { return framesWritten; }
+
+private:
+    FILE* file;
+    WavFormat format;
+    uint64_t framesWritten;
+
+    WavWriter(const WavWriter&) = delete;
+    WavWriter& operator=(const WavWriter&) = delete;
+};
+
+#endif // VOICEQWIK_WAV_FILE_H
@@ -2,7 +2,7 @@
 #define VOICEQWIK_GUI_WINDOW_H
 
 #include <utils/Common.h>
-#include <windows.h>
+#include <platform/Win32.h>
 #include <string>
 #include <mutex>
 
@@ -19,6 +19,8 @@ public:
     // Getters
     int GetSelectedParticipantCount() const;
     bool IsMuted() const;
+    // Master playback volume from the slider, as a linear gain
+    float GetVolumeGain() const;
     std::string GetConnectionString() const;
     std::string GetRemotePeerIP() const;
     bool TryPopConnectRequest(std::string& remotePeer);
@@ -27,6 +29,7 @@ public:
     void SetConnectionStatus(const std::string& status);
     void SetParticipantCount(int count);
     void SetMuted(bool muted);
+    void SetStatsLine(const std::string& stats);
 
 private:
     GuiWindow();
@@ -41,15 +44,18 @@ private:
 
     // Control handles
     HWND participantCombo;
+    HWND packetTimeCombo;
     HWND statusText;
     HWND connectionInfoEdit;
     HWND remotePeerEdit;
     HWND connectButton;
     HWND muteButton;
     HWND volumeSlider;
+    HWND statsText;
 
     int selectedParticipants;
     bool isMuted;
+    int volumePosition;                 // slider position, 0-100
 
     std::atomic<bool> connectRequested;
     std::string requestedPeer;
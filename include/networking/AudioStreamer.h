@@ -2,33 +2,101 @@
 #define VOICEQWIK_AUDIO_STREAMER_H
 
 #include <utils/Common.h>
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include <platform/Socket.h>
+#include <networking/RtpPacket.h>
+#include <networking/RtpSourceStats.h>
+#include <networking/PlayoutQueue.h>
+#include <networking/LatencyProbe.h>
+#include <networking/RtcpPacket.h>
+#include <networking/RateController.h>
+#include <networking/RedundantPayload.h>
+#include <networking/NetworkImpairment.h>
+#include <networking/PacketCapture.h>
+#include <networking/MediaCrypto.h>
+#include <networking/PathSelector.h>
+#include <array>
+#include <chrono>
 #include <map>
+#include <memory>
+#include <random>
 
-// Simple RTP header for audio
-struct RTPHeader {
-    uint8_t vpxcc;
-    uint8_t mpt;
-    uint16_t seq;
-    uint32_t timestamp;
-    uint32_t ssrc;
-    uint32_t csrc[15];
+struct PeerInfo;
+struct PeerMetrics;
+
+// RTP/RTCP statistics for one peer's stream pair
+struct RtpStreamStats {
+    PeerID peerId;
+    uint32_t remoteSsrc;
+
+    // The peer's stream, as we receive it
+    uint32_t packetsReceived;
+    int32_t packetsLost;
+    double jitterMs;
+
+    // Our stream, as the peer reports it in RTCP report blocks
+    bool hasRemoteReport;
+    double remoteFractionLost;   // 0..1, over the peer's last report interval
+    int32_t remotePacketsLost;
+    double remoteJitterMs;
+    double rttMs;                // from LSR/DLSR; negative until measured
+    std::chrono::steady_clock::time_point lastRemoteReport;
+
+    // What the rate controller currently sends this peer
+    StreamConfig sendConfig;
+    uint32_t sendBitrate;
 };
 
 class AudioStreamer {
 public:
     static AudioStreamer& GetInstance();
 
-    bool Initialize();
+    // Binds the UDP audio socket; a port other than the default lets two
+    // instances share a host
+    bool Initialize(uint16_t port = DEFAULT_AUDIO_PORT);
     void Shutdown();
 
-    // Send audio to peers
-    bool SendAudioToPeers(const AudioBuffer& buffer);
+    // Send audio to peers. captureMicros (LatencyClockMicros) is when the
+    // first sample was captured; it is only sent in latency measurement mode.
+    bool SendAudioToPeers(const AudioBuffer& buffer, int64_t captureMicros = 0);
 
-    // Receive audio from peer
+    // Receive the next session packet time of a peer's audio, whatever the
+    // peer packs into each RTP packet
     bool ReceiveAudioFromPeer(PeerID peerId, AudioBuffer& buffer);
 
+    // True while some peer has more than one packet waiting to play (a burst
+    // after a stall, or a sender clock running fast). Mixing once per captured
+    // packet keeps playback on the device clock; this is when to mix more.
+    bool HasPlayoutBacklog();
+
+    // Per-peer RTP/RTCP statistics
+    std::vector<RtpStreamStats> GetStreamStats();
+    bool GetStreamStats(PeerID peerId, RtpStreamStats& stats);
+
+    // Latency measurement mode: timestamp extension and clock sync
+    void SetLatencyMeasurement(bool enabled);
+    bool IsLatencyMeasurementEnabled() const;
+
+    // Loopback testing: everything received goes through an emulated bad
+    // link first (nullptr turns it off)
+    void SetImpairment(const ImpairmentProfile* profile, uint64_t seed);
+
+    // Writes every datagram on the audio socket to a pcapng file, inbound
+    // ones as received (before any impairment); for voiceqwik_replay.
+    // Encrypted peers' media is recorded in the clear: inbound once it has
+    // authenticated, outbound before it is encrypted.
+    bool StartPacketCapture(const std::string& filename);
+    void StopPacketCapture();
+    const PacketCapture& GetPacketCapture() const { return packetCapture; }
+
+    // Where this peer's media goes: the path the connectivity checks
+    // selected, else the control connection's address
+    SocketAddress GetPeerAudioAddress(const PeerInfo& peer) const;
+
+    // A peer that answers path checks gets no audio while none of its paths
+    // answers (before the first answer, or while it is away): the stream
+    // pauses rather than filling a dead path, and resumes in sequence
+    bool IsMediaHeld(const PeerInfo& peer) const;
+
     // Socket management
     bool CreateAudioSocket(uint16_t port);
     void CloseAudioSocket();
@@ -40,22 +108,180 @@ private:
     AudioStreamer(const AudioStreamer&) = delete;
     AudioStreamer& operator=(const AudioStreamer&) = delete;
 
-    SOCKET audioSocket;
+    SocketHandle audioSocket;
     uint16_t audioPort;
+    int audioFamily;        // AF_INET6 when dual-stack
 
     std::thread receiverThread;
     std::atomic<bool> receiving;
 
-    std::map<PeerID, std::queue<AudioBuffer>> receiveQueues;
-    std::map<PeerID, sockaddr_in> peerAddresses;
+    // Receiver thread: the peer list for this pass of its loop. Peers found
+    // in it (FindPeerInfoByAddress) stay valid for the pass.
+    std::shared_ptr<const std::vector<PeerInfo>> receivePeers;   // a PeerList
+
+    struct PeerReceiveState {
+        PlayoutQueue playout;
+        RtpSourceStats stats;
+        bool hasArrival = false;
+        std::chrono::steady_clock::time_point lastArrival;
+        ClockOffsetEstimator clockOffset;
+
+        // RTCP
+        uint32_t remoteSsrc = 0;
+        bool hasSenderReport = false;
+        uint32_t lastSenderReportNtp = 0;   // LSR to echo back
+        std::chrono::steady_clock::time_point lastSenderReportArrival;
+        bool hasRemoteReport = false;
+        RtcpReportBlock remoteReport{};
+        double rttMs = -1.0;
+        std::chrono::steady_clock::time_point lastRemoteReport;
+    };
+
+    // An entry per peer on receiveStatesPeers, made when the receiver thread
+    // first sees the list, so the real-time receive and mix paths only look
+    // entries up
+    std::map<PeerID, PeerReceiveState> receiveStates;
     std::mutex queuesMutex;
+    std::shared_ptr<const std::vector<PeerInfo>> receiveStatesPeers;
+
+    // Earlier payload kept for RFC 2198 redundancy
+    struct SentPayload {
+        uint8_t payloadType;
+        uint32_t timestamp;
+        size_t length;
+        std::array<uint8_t, RED_MAX_BLOCK_SIZE> data;
+    };
+
+    // Per-peer outgoing stream: each peer gets its own sequence space, so the
+    // rate controller can pick encoding, packet time and redundancy per peer
+    struct PeerSendState {
+        explicit PeerSendState(PacketTime capturePacketTime)
+            : capturePacketTime(capturePacketTime), controller(capturePacketTime) {}
+
+        PacketTime capturePacketTime;
+        RateController controller;
+        uint16_t sequence = 0;
+        uint32_t packets = 0;          // SR packet/octet counts
+        uint32_t octets = 0;
+        uint32_t reportedPackets = 0;  // packets as of the last SR
+        uint32_t protectIndex = 0;     // next media encryption index; outlives ptime changes
+
+        // Capture packets waiting to be aggregated into one RTP packet
+        AudioBuffer pending;
+        uint8_t pendingPackets = 0;
+        uint32_t pendingTimestamp = 0;
+        int64_t pendingCaptureMicros = 0;
+
+        std::array<SentPayload, RED_MAX_REDUNDANCY> history;
+        size_t historyCount = 0;       // most recent first
+
+        // Previous report about our stream, for the delivered bitrate
+        bool hasReport = false;
+        uint32_t reportHighestSequence = 0;
+        int32_t reportCumulativeLost = 0;
+        std::chrono::steady_clock::time_point reportTime;
+    };
+
+    // Sending thread, plus RTCP (receiver thread) for feedback and SR counts.
+    // Made and dropped when the peer list or packet time changes, before the
+    // real-time part of the send.
+    std::map<PeerID, PeerSendState> sendStates;
+    std::mutex sendMutex;
+    std::shared_ptr<const std::vector<PeerInfo>> sendStatesPeers;
+    PacketTime sendStatesPacketTime;
+
+    std::atomic<bool> latencyMeasurement;
+
+    // Receiver thread only: encrypted peers' replay windows, in fixed slots
+    // so the receive path never allocates; a slot whose peer left is reused
+    struct ReplayState {
+        PeerID peerId = 0;
+        MediaReplayWindow rtp;
+        MediaReplayWindow rtcp;
+    };
+    std::array<ReplayState, MAX_PARTICIPANTS> replayStates;
+    std::map<PeerID, uint32_t> rtcpProtectIndices;   // our SRTCP-style index per peer
+    std::mt19937 rtcpRandom;                         // report interval jitter
+    uint32_t byeSsrc;                                // an SSRC we dropped, 0 once its BYE went out
+
+    // Path selection per peer that answers checks, in fixed slots like the
+    // replay windows. The receiver thread checks and selects; senders read
+    // the published choice.
+    struct PathState {
+        std::atomic<PeerID> peerId{0};
+        std::atomic<uint8_t> selected{0};
+        std::atomic<bool> live{false};   // some path answers
+
+        // Receiver thread only
+        PathSelector selector;
+        bool everLive = false;
+        uint32_t sessionEpoch = 0;        // the candidates the selector has
+        int64_t awaitingAudioSince = -1;  // resumed, no audio from the peer yet
+        int64_t resumeToAudioMicros = -1; // measured, to be logged
+    };
+    std::array<PathState, MAX_PARTICIPANTS> pathStates;
+
+    // Receiver thread: senders of datagrams inside the impairment, which
+    // carries an index into this table as its tag
+    std::array<SocketAddress, MAX_PARTICIPANTS * MAX_PATH_CANDIDATES> impairmentSenders;
+    size_t impairmentSenderCount;
+    size_t impairmentSenderNext;
+
+    std::unique_ptr<NetworkImpairment> impairment;
+    std::mutex impairmentMutex;
+
+    PacketCapture packetCapture;
 
-    uint16_t rtpSequence;
     uint32_t rtpTimestamp;
-    uint32_t rtpSSRC;
+    // Drawn at random. The receiver thread draws another when it finds a peer
+    // using ours too (RFC 3550 8.2); the flag is its own note to do so.
+    std::atomic<uint32_t> rtpSSRC;
+    bool ssrcCollision;
+    std::string rtcpCname;
+
+    // RTP clock position of the last capture packet sent, for SR timestamps
+    std::atomic<uint32_t> lastSentRtpTimestamp;
+    std::atomic<int64_t> lastSentMicros;
+    double averageRtcpSize;
+
+    // Reused for every outgoing packet; sized for the longest packet time,
+    // encrypted
+    std::array<uint8_t, MAX_PROTECTED_RTP_SIZE> sendBuffer;
+    std::array<uint8_t, MAX_RTP_PAYLOAD_SIZE> encodeBuffer;
+
+    // Receiver thread: payloads decoded back to PCM16
+    std::array<int16_t, MAX_SAMPLES_PER_PACKET> decodeBuffer;
 
     void ReceiverThreadProc();
-    void BuildRTPHeader(RTPHeader& header);
+    void SyncReceiveStates();
+    void SyncSendStates(const std::shared_ptr<const std::vector<PeerInfo>>& peers, PacketTime ptime);
+    std::unique_lock<std::mutex> LockQueues();
+    bool UnprotectDatagram(uint8_t* data, size_t& length, const SocketAddress& senderAddr);
+    ReplayState* FindReplayState(PeerID peerId);
+    uint64_t TagImpairmentSender(const SocketAddress& senderAddr);
+    void ProcessDatagram(const uint8_t* data, size_t length, const SocketAddress& senderAddr);
+    void LogImpairmentStats();
+    void SendToPeer(const PeerInfo& peer, PeerSendState& send);
+    void HandleAudioPayload(PeerID senderId, const RTPHeader& header, const LatencyTimestamps* stamps,
+                            const uint8_t* payload, size_t payloadSize, size_t packetSize);
+    void QueueReceivedPacket(PeerID senderId, const RTPHeader& header, const LatencyTimestamps* stamps,
+                             const int16_t* samples, size_t sampleCount, size_t packetSize);
+    void QueueRecoveredPacket(PeerID senderId, uint16_t sequence, const int16_t* samples, size_t sampleCount);
+    void HandleClockSync(const uint8_t* data, size_t length, const SocketAddress& senderAddr);
+    void SendClockSyncRequests();
+    void CheckPaths();
+    PathState* ClaimPathState(const PeerInfo& peer);
+    static void ResetPathState(PathState& state, const PeerInfo& peer);
+    void HandlePathCheck(const uint8_t* data, size_t length, const SocketAddress& senderAddr);
+    void SendDatagram(CaptureProducer producer, const SocketAddress& address, const uint8_t* data, size_t length);
+    void HandleRtcp(const uint8_t* data, size_t length, const SocketAddress& senderAddr);
+    double SendRtcpReports(bool initial);
+    void ResolveSsrcCollision();
+    void UpdateRateControl(PeerID peerId, const RtcpReportBlock& block, double rttMs,
+                           std::chrono::steady_clock::time_point now);
+    PeerID FindPeerByAddress(const SocketAddress& addr) const;
+    const PeerInfo* FindPeerInfoByAddress(const SocketAddress& addr) const;
+    void BuildRTPHeader(RTPHeader& header, PeerSendState& send, uint8_t payloadType);
 };
 
 #endif // VOICEQWIK_AUDIO_STREAMER_H
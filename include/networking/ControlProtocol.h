@@ -0,0 +1,229 @@
+#ifndef VOICEQWIK_CONTROL_PROTOCOL_H
+#define VOICEQWIK_CONTROL_PROTOCOL_H
+
+#include <audio/AudioFormat.h>
+#include <networking/MediaCrypto.h>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// Hello exchanged over the TCP control connection right after connect.
+// The joining peer sends its hello first; the host answers with the session
+// parameters, which the joining peer adopts.
+//
+// Wire layout (network byte order):
+//   magic(4) version(2) length(2) audioPort(2) packetTime(1) flags(1)
+//   [publicKey(32)] [candidateCount(1) {family(1) preference(1) address(4|16)}...]
+//   [sessionToken(16)] [keyProof(16)]
+// length counts the whole message so later versions can append fields.
+// A hello offering media encryption carries an X25519 public key; peers that
+// predate the flag send 0 there and never see the key they ignore.
+// Candidates are the sender's local addresses, all reachable on audioPort;
+// a hello with CONTROL_FLAG_CANDIDATES also promises to answer path checks.
+//
+// CONTROL_FLAG_SESSION makes the session resumable. The joining peer sends
+// zeros for a new session, or the token it was given to resume one; the host
+// answers with the session's token. Both sides then keep the connection open
+// for control messages (prefix, then type(1)), heartbeats among them, so
+// either notices within CONTROL_HEARTBEAT_TIMEOUT_MS that it broke.
+//
+// CONTROL_FLAG_ROOM_SECRET says the sender's media keys are bound to a room
+// secret (MediaCrypto.h). The host's hello carries the proof of the keys it
+// derived for the joining peer, which checks it against its own; the joining
+// peer sends zeros there, having no keys yet.
+constexpr uint32_t CONTROL_MAGIC = 0x5651434B;  // "VQCK"
+constexpr uint16_t CONTROL_VERSION = 1;
+constexpr size_t CONTROL_PREFIX_SIZE = 8;
+constexpr size_t CONTROL_HELLO_SIZE = 12;
+constexpr size_t CONTROL_HELLO_KEY_SIZE = CONTROL_HELLO_SIZE + MEDIA_PUBLIC_KEY_SIZE;
+constexpr size_t CONTROL_MAX_MESSAGE_SIZE = 256;
+constexpr size_t CONTROL_MAX_CANDIDATES = 8;
+constexpr size_t CONTROL_SESSION_TOKEN_SIZE = 16;
+constexpr size_t CONTROL_MESSAGE_SIZE = CONTROL_PREFIX_SIZE + 1;
+
+constexpr int CONTROL_HEARTBEAT_INTERVAL_MS = 250;
+constexpr int CONTROL_HEARTBEAT_TIMEOUT_MS = 1500;
+
+constexpr uint8_t CONTROL_FLAG_MEDIA_ENCRYPTION = 0x01;
+constexpr uint8_t CONTROL_FLAG_CANDIDATES = 0x02;
+constexpr uint8_t CONTROL_FLAG_SESSION = 0x04;
+constexpr uint8_t CONTROL_FLAG_ROOM_SECRET = 0x08;
+
+// Control messages after the hello; unknown types are skipped
+enum class ControlMessageType : uint8_t {
+    Heartbeat = 1,
+    Leave = 2        // the sender is leaving the call: drop it now, it will not resume
+};
+
+// Candidate families on the wire
+constexpr uint8_t CONTROL_CANDIDATE_IPV4 = 4;
+constexpr uint8_t CONTROL_CANDIDATE_IPV6 = 6;
+
+struct ControlCandidate {
+    uint8_t family;        // CONTROL_CANDIDATE_IPV4 or _IPV6
+    uint8_t preference;    // higher is better (InterfaceKind)
+    uint8_t address[16];   // network order; IPv4 uses the first 4 bytes
+};
+
+struct ControlHello {
+    uint16_t version;
+    uint16_t audioPort;
+    PacketTime packetTime;
+    uint8_t flags;
+    uint8_t publicKey[MEDIA_PUBLIC_KEY_SIZE];   // with CONTROL_FLAG_MEDIA_ENCRYPTION
+    uint8_t candidateCount;                     // with CONTROL_FLAG_CANDIDATES
+    ControlCandidate candidates[CONTROL_MAX_CANDIDATES];
+    uint8_t sessionToken[CONTROL_SESSION_TOKEN_SIZE];   // with CONTROL_FLAG_SESSION
+    uint8_t keyProof[MEDIA_KEY_PROOF_SIZE];             // with CONTROL_FLAG_ROOM_SECRET
+};
+
+inline size_t ControlCandidateAddressSize(uint8_t family) {
+    return family == CONTROL_CANDIDATE_IPV6 ? 16 : 4;
+}
+
+// Total message length announced by the prefix, or 0 if the prefix is invalid
+inline size_t ReadControlMessageLength(const uint8_t* prefix) {
+    uint32_t magic = (static_cast<uint32_t>(prefix[0]) << 24) | (static_cast<uint32_t>(prefix[1]) << 16) |
+                     (static_cast<uint32_t>(prefix[2]) << 8) | prefix[3];
+    size_t length = (static_cast<size_t>(prefix[6]) << 8) | prefix[7];
+    if (magic != CONTROL_MAGIC || length < CONTROL_PREFIX_SIZE || length > CONTROL_MAX_MESSAGE_SIZE) {
+        return 0;
+    }
+    return length;
+}
+
+// Returns the message length; out must hold CONTROL_MAX_MESSAGE_SIZE
+inline size_t WriteControlHello(uint8_t* out, const ControlHello& hello) {
+    bool withKey = (hello.flags & CONTROL_FLAG_MEDIA_ENCRYPTION) != 0;
+    size_t length = withKey ? CONTROL_HELLO_KEY_SIZE : CONTROL_HELLO_SIZE;
+
+    if ((hello.flags & CONTROL_FLAG_CANDIDATES) != 0) {
+        size_t count = hello.candidateCount < CONTROL_MAX_CANDIDATES ? hello.candidateCount : CONTROL_MAX_CANDIDATES;
+        out[length++] = static_cast<uint8_t>(count);
+        for (size_t i = 0; i < count; i++) {
+            const ControlCandidate& candidate = hello.candidates[i];
+            size_t addressSize = ControlCandidateAddressSize(candidate.family);
+            out[length++] = candidate.family == CONTROL_CANDIDATE_IPV6 ? CONTROL_CANDIDATE_IPV6 : CONTROL_CANDIDATE_IPV4;
+            out[length++] = candidate.preference;
+            std::memcpy(out + length, candidate.address, addressSize);
+            length += addressSize;
+        }
+    }
+
+    if ((hello.flags & CONTROL_FLAG_SESSION) != 0) {
+        std::memcpy(out + length, hello.sessionToken, CONTROL_SESSION_TOKEN_SIZE);
+        length += CONTROL_SESSION_TOKEN_SIZE;
+    }
+
+    if ((hello.flags & CONTROL_FLAG_ROOM_SECRET) != 0) {
+        std::memcpy(out + length, hello.keyProof, MEDIA_KEY_PROOF_SIZE);
+        length += MEDIA_KEY_PROOF_SIZE;
+    }
+
+    out[0] = static_cast<uint8_t>(CONTROL_MAGIC >> 24);
+    out[1] = static_cast<uint8_t>(CONTROL_MAGIC >> 16);
+    out[2] = static_cast<uint8_t>(CONTROL_MAGIC >> 8);
+    out[3] = static_cast<uint8_t>(CONTROL_MAGIC);
+    out[4] = static_cast<uint8_t>(hello.version >> 8);
+    out[5] = static_cast<uint8_t>(hello.version);
+    out[6] = static_cast<uint8_t>(length >> 8);
+    out[7] = static_cast<uint8_t>(length);
+    out[8] = static_cast<uint8_t>(hello.audioPort >> 8);
+    out[9] = static_cast<uint8_t>(hello.audioPort);
+    out[10] = static_cast<uint8_t>(hello.packetTime);
+    out[11] = hello.flags;
+    if (withKey) {
+        std::memcpy(out + CONTROL_HELLO_SIZE, hello.publicKey, MEDIA_PUBLIC_KEY_SIZE);
+    }
+    return length;
+}
+
+inline bool ParseControlHello(const uint8_t* data, size_t length, ControlHello& hello) {
+    if (length < CONTROL_HELLO_SIZE) {
+        return false;
+    }
+
+    if (ReadControlMessageLength(data) == 0 || !IsValidPacketTime(data[10])) {
+        return false;
+    }
+
+    hello.version = static_cast<uint16_t>((data[4] << 8) | data[5]);
+    hello.audioPort = static_cast<uint16_t>((data[8] << 8) | data[9]);
+    hello.packetTime = static_cast<PacketTime>(data[10]);
+
+    // An encryption offer without its key is no offer
+    hello.flags = data[11];
+    size_t offset = CONTROL_HELLO_SIZE;
+    if ((hello.flags & CONTROL_FLAG_MEDIA_ENCRYPTION) != 0) {
+        if (length < CONTROL_HELLO_KEY_SIZE) {
+            hello.flags &= static_cast<uint8_t>(~CONTROL_FLAG_MEDIA_ENCRYPTION);
+        } else {
+            std::memcpy(hello.publicKey, data + CONTROL_HELLO_SIZE, MEDIA_PUBLIC_KEY_SIZE);
+            offset = CONTROL_HELLO_KEY_SIZE;
+        }
+    }
+
+    // Candidates up to the first that is cut short or of an unknown family;
+    // past such a one the fields that follow cannot be found
+    hello.candidateCount = 0;
+    bool complete = true;
+    if ((hello.flags & CONTROL_FLAG_CANDIDATES) != 0) {
+        complete = offset < length;
+        size_t count = complete ? data[offset++] : 0;
+        for (size_t i = 0; i < count; i++) {
+            uint8_t family = offset < length ? data[offset] : 0;
+            size_t addressSize = ControlCandidateAddressSize(family);
+            if ((family != CONTROL_CANDIDATE_IPV4 && family != CONTROL_CANDIDATE_IPV6) ||
+                offset + 2 + addressSize > length) {
+                complete = false;
+                break;
+            }
+
+            if (hello.candidateCount < CONTROL_MAX_CANDIDATES) {
+                ControlCandidate& candidate = hello.candidates[hello.candidateCount++];
+                candidate.family = family;
+                candidate.preference = data[offset + 1];
+                std::memset(candidate.address, 0, sizeof(candidate.address));
+                std::memcpy(candidate.address, data + offset + 2, addressSize);
+            }
+            offset += 2 + addressSize;
+        }
+    }
+
+    // A session offer without its token is no offer
+    if ((hello.flags & CONTROL_FLAG_SESSION) != 0) {
+        if (!complete || offset + CONTROL_SESSION_TOKEN_SIZE > length) {
+            hello.flags &= static_cast<uint8_t>(~CONTROL_FLAG_SESSION);
+            complete = false;
+        } else {
+            std::memcpy(hello.sessionToken, data + offset, CONTROL_SESSION_TOKEN_SIZE);
+            offset += CONTROL_SESSION_TOKEN_SIZE;
+        }
+    }
+
+    // A room secret without its proof is refused like a wrong one: the flag stays
+    if ((hello.flags & CONTROL_FLAG_ROOM_SECRET) != 0) {
+        if (!complete || offset + MEDIA_KEY_PROOF_SIZE > length) {
+            std::memset(hello.keyProof, 0, MEDIA_KEY_PROOF_SIZE);
+        } else {
+            std::memcpy(hello.keyProof, data + offset, MEDIA_KEY_PROOF_SIZE);
+        }
+    }
+    return true;
+}
+
+// A bodiless control message; out must hold CONTROL_MESSAGE_SIZE
+inline size_t WriteControlMessage(uint8_t* out, ControlMessageType type) {
+    out[0] = static_cast<uint8_t>(CONTROL_MAGIC >> 24);
+    out[1] = static_cast<uint8_t>(CONTROL_MAGIC >> 16);
+    out[2] = static_cast<uint8_t>(CONTROL_MAGIC >> 8);
+    out[3] = static_cast<uint8_t>(CONTROL_MAGIC);
+    out[4] = static_cast<uint8_t>(CONTROL_VERSION >> 8);
+    out[5] = static_cast<uint8_t>(CONTROL_VERSION);
+    out[6] = 0;
+    out[7] = static_cast<uint8_t>(CONTROL_MESSAGE_SIZE);
+    out[8] = static_cast<uint8_t>(type);
+    return CONTROL_MESSAGE_SIZE;
+}
+
+#endif // VOICEQWIK_CONTROL_PROTOCOL_H
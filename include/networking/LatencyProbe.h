@@ -0,0 +1,194 @@
+#ifndef VOICEQWIK_LATENCY_PROBE_H
+#define VOICEQWIK_LATENCY_PROBE_H
+
+#include <networking/RtpPacket.h>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+// Latency measurement mode. Audio packets carry the sender's capture and
+// send times in an RFC 8285 one-byte header extension; peers exchange
+// NTP-style clock sync messages on the audio socket so the receiver can map
+// those times onto its own clock. Together they split mouth-to-ear delay
+// into capture, network, jitter buffer and render components.
+
+constexpr int CLOCK_SYNC_INTERVAL_MS = 1000;
+constexpr size_t CLOCK_SYNC_WINDOW = 8;        // samples the offset filter keeps
+constexpr int LATENCY_REPORT_INTERVAL_MS = 5000;
+
+// All latency timestamps: local steady clock in microseconds. On Windows this
+// is QPC-based, the same clock as WASAPI's capture QPC positions.
+inline int64_t LatencyClockMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Header extension: profile 0xBEDE, one element (ID 1, 8 bytes) holding the
+// low 32 bits of capture and send time, padded to 3 words
+constexpr uint16_t RTP_ONE_BYTE_EXTENSION_PROFILE = 0xBEDE;
+constexpr uint8_t LATENCY_EXTENSION_ID = 1;
+constexpr size_t LATENCY_EXTENSION_SIZE = 16;
+static_assert(LATENCY_EXTENSION_SIZE <= MAX_RTP_HEADER_EXTENSION_SIZE,
+              "Latency extension must fit the RTP packet buffers");
+
+struct LatencyTimestamps {
+    uint32_t captureMicros;   // first sample of the packet hit the microphone
+    uint32_t sendMicros;      // packet handed to the socket
+};
+
+// Writes the extension block; the caller sets the X bit in the RTP header
+inline void WriteLatencyExtension(uint8_t* out, const LatencyTimestamps& stamps) {
+    out[0] = static_cast<uint8_t>(RTP_ONE_BYTE_EXTENSION_PROFILE >> 8);
+    out[1] = static_cast<uint8_t>(RTP_ONE_BYTE_EXTENSION_PROFILE);
+    out[2] = 0;
+    out[3] = 3;
+    out[4] = static_cast<uint8_t>((LATENCY_EXTENSION_ID << 4) | (8 - 1));
+    for (int i = 0; i < 4; i++) {
+        out[5 + i] = static_cast<uint8_t>(stamps.captureMicros >> (24 - 8 * i));
+        out[9 + i] = static_cast<uint8_t>(stamps.sendMicros >> (24 - 8 * i));
+    }
+    out[13] = out[14] = out[15] = 0;
+}
+
+// Looks for the latency element in a parsed packet's header extension
+inline bool ParseLatencyExtension(const uint8_t* data, size_t headerSize, LatencyTimestamps& stamps) {
+    if (headerSize < RTP_HEADER_SIZE || !(data[0] & 0x10)) {
+        return false;
+    }
+
+    size_t offset = RTP_HEADER_SIZE + (data[0] & 0x0F) * 4;
+    if (offset + 4 > headerSize) return false;
+
+    uint16_t profile = static_cast<uint16_t>((data[offset] << 8) | data[offset + 1]);
+    if (profile != RTP_ONE_BYTE_EXTENSION_PROFILE) return false;
+
+    size_t pos = offset + 4;
+    while (pos < headerSize) {
+        uint8_t id = data[pos] >> 4;
+        size_t length = (data[pos] & 0x0F) + 1u;
+        if (id == 0) {          // padding byte
+            pos++;
+            continue;
+        }
+        if (id == 15 || pos + 1 + length > headerSize) return false;
+
+        if (id == LATENCY_EXTENSION_ID && length == 8) {
+            const uint8_t* p = data + pos + 1;
+            stamps.captureMicros = (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+                                   (static_cast<uint32_t>(p[2]) << 8) | p[3];
+            stamps.sendMicros = (static_cast<uint32_t>(p[4]) << 24) | (static_cast<uint32_t>(p[5]) << 16) |
+                                (static_cast<uint32_t>(p[6]) << 8) | p[7];
+            return true;
+        }
+        pos += 1 + length;
+    }
+    return false;
+}
+
+// Clock sync datagram. The first byte ('V') has RTP version bits 01, so it
+// never parses as RTP or RTCP on the shared socket.
+constexpr uint32_t CLOCK_SYNC_MAGIC = 0x56514353;  // "VQCS"
+constexpr size_t CLOCK_SYNC_SIZE = 32;
+
+enum class ClockSyncType : uint8_t {
+    Request = 1,
+    Response = 2
+};
+
+struct ClockSyncMessage {
+    ClockSyncType type;
+    int64_t originateMicros;   // t0: request sent (requester clock)
+    int64_t receiveMicros;     // t1: request received (responder clock)
+    int64_t transmitMicros;    // t2: response sent (responder clock)
+};
+
+inline void WriteClockSync(uint8_t* out, const ClockSyncMessage& message) {
+    auto put64 = [](uint8_t* p, int64_t value) {
+        for (int i = 0; i < 8; i++) p[i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (56 - 8 * i));
+    };
+
+    out[0] = static_cast<uint8_t>(CLOCK_SYNC_MAGIC >> 24);
+    out[1] = static_cast<uint8_t>(CLOCK_SYNC_MAGIC >> 16);
+    out[2] = static_cast<uint8_t>(CLOCK_SYNC_MAGIC >> 8);
+    out[3] = static_cast<uint8_t>(CLOCK_SYNC_MAGIC);
+    out[4] = static_cast<uint8_t>(message.type);
+    out[5] = out[6] = out[7] = 0;
+    put64(out + 8, message.originateMicros);
+    put64(out + 16, message.receiveMicros);
+    put64(out + 24, message.transmitMicros);
+}
+
+inline bool IsClockSync(const uint8_t* data, size_t length) {
+    return length == CLOCK_SYNC_SIZE &&
+           ((static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16) |
+            (static_cast<uint32_t>(data[2]) << 8) | data[3]) == CLOCK_SYNC_MAGIC;
+}
+
+inline bool ParseClockSync(const uint8_t* data, size_t length, ClockSyncMessage& message) {
+    if (!IsClockSync(data, length)) {
+        return false;
+    }
+
+    auto get64 = [](const uint8_t* p) {
+        uint64_t value = 0;
+        for (int i = 0; i < 8; i++) value = (value << 8) | p[i];
+        return static_cast<int64_t>(value);
+    };
+
+    message.type = static_cast<ClockSyncType>(data[4]);
+    if (message.type != ClockSyncType::Request && message.type != ClockSyncType::Response) {
+        return false;
+    }
+    message.originateMicros = get64(data + 8);
+    message.receiveMicros = get64(data + 16);
+    message.transmitMicros = get64(data + 24);
+    return true;
+}
+
+// Offset of a peer's clock relative to ours (remote - local). Keeps the last
+// CLOCK_SYNC_WINDOW exchanges and trusts the one with the lowest round trip,
+// whose queueing error is smallest (the NTP clock filter idea).
+class ClockOffsetEstimator {
+public:
+    ClockOffsetEstimator() : count(0), next(0) {}
+
+    void AddSample(int64_t t0, int64_t t1, int64_t t2, int64_t t3) {
+        Sample& sample = samples[next];
+        sample.offset = ((t1 - t0) + (t2 - t3)) / 2;
+        sample.roundTrip = (t3 - t0) - (t2 - t1);
+        next = (next + 1) % CLOCK_SYNC_WINDOW;
+        if (count < CLOCK_SYNC_WINDOW) count++;
+    }
+
+    bool HasEstimate() const { return count > 0; }
+
+    int64_t GetOffsetMicros() const { return Best().offset; }
+    int64_t GetRoundTripMicros() const { return Best().roundTrip; }
+
+    // Maps a remote timestamp (low 32 bits) to the local clock near localNow
+    int64_t RemoteToLocal(uint32_t remoteMicros, int64_t localNow) const {
+        int64_t remoteNow = localNow + GetOffsetMicros();
+        int32_t age = static_cast<int32_t>(static_cast<uint32_t>(remoteNow) - remoteMicros);
+        return localNow - age;
+    }
+
+private:
+    struct Sample {
+        int64_t offset;
+        int64_t roundTrip;
+    };
+
+    const Sample& Best() const {
+        size_t best = 0;
+        for (size_t i = 1; i < count; i++) {
+            if (samples[i].roundTrip < samples[best].roundTrip) best = i;
+        }
+        return samples[best];
+    }
+
+    Sample samples[CLOCK_SYNC_WINDOW] = {};
+    size_t count;
+    size_t next;
+};
+
+#endif // VOICEQWIK_LATENCY_PROBE_H
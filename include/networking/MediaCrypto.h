@@ -0,0 +1,142 @@
+#ifndef VOICEQWIK_MEDIA_CRYPTO_H
+#define VOICEQWIK_MEDIA_CRYPTO_H
+
+#include <networking/RtpPacket.h>
+#include <networking/RtcpPacket.h>
+#include <cstddef>
+#include <cstdint>
+
+// Media encryption, SRTP/SRTCP-style: ChaCha20-Poly1305 (RFC 8439) over each
+// RTP and RTCP packet, in place in the packet buffer. Headers stay readable
+// and are authenticated; the payload is encrypted. Keys come from an X25519
+// exchange in the control handshake, one key per direction.
+//
+// On its own the exchange is unauthenticated: neither public key is tied to
+// an identity. It keeps a passive listener out, but an active man in the
+// middle on the control channel can run one exchange with each side, then
+// read and forge all media between them without either end noticing. A room
+// secret given to every participant out of band closes that: it is mixed
+// into the keys, so one in the middle without it ends up with keys that
+// match neither side, and the host proves it has the same keys in its hello.
+// A short secret can still be guessed offline by one in the middle, so it
+// should be long and random.
+//
+// Protected packet: header | ciphertext | index(4) | tag(16)
+// The index is the sender's packet counter for that key and stream (RTP and
+// RTCP count separately), sent explicitly so streams that restart their RTP
+// sequence never reuse a nonce. RTCP authenticates the first 8 bytes (header
+// and sender SSRC) and encrypts the rest, as SRTCP does.
+constexpr size_t MEDIA_KEY_SIZE = 32;
+constexpr size_t MEDIA_SALT_SIZE = 12;
+constexpr size_t MEDIA_PUBLIC_KEY_SIZE = 32;
+constexpr size_t MEDIA_INDEX_SIZE = 4;
+constexpr size_t MEDIA_TAG_SIZE = 16;
+constexpr size_t MEDIA_ROOM_KEY_SIZE = 32;
+constexpr size_t MEDIA_KEY_PROOF_SIZE = 16;
+constexpr size_t MEDIA_CRYPTO_OVERHEAD = MEDIA_INDEX_SIZE + MEDIA_TAG_SIZE;
+constexpr size_t RTCP_AUTHENTICATED_HEADER_SIZE = 8;
+constexpr uint32_t MEDIA_REPLAY_WINDOW = 64;       // packets behind the newest still accepted
+constexpr uint32_t MEDIA_INDEX_LIMIT = 0xFFFFFFFFu; // a key is retired before its index wraps
+
+constexpr size_t MAX_PROTECTED_RTP_SIZE = MAX_RTP_PACKET_SIZE + MEDIA_CRYPTO_OVERHEAD;
+constexpr size_t MAX_PROTECTED_RTCP_SIZE = RTCP_MAX_PACKET_SIZE + MEDIA_CRYPTO_OVERHEAD;
+
+// Nonce domain: RTP and RTCP share a key but never a nonce
+enum class MediaStream : uint8_t {
+    Rtp = 0,
+    Rtcp = 1
+};
+
+struct MediaKey {
+    uint8_t key[MEDIA_KEY_SIZE];
+    uint8_t salt[MEDIA_SALT_SIZE];
+};
+
+// One peer's keys: what we send with, what the peer sends with
+struct MediaKeys {
+    MediaKey send;
+    MediaKey receive;
+    uint8_t proof[MEDIA_KEY_PROOF_SIZE];   // equal on both sides exactly when the keys are
+};
+
+// RFC 8439 AEAD, in place. Open decrypts only once the tag has verified.
+void ChaCha20Poly1305Seal(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aadLength,
+                          uint8_t* data, size_t length, uint8_t* tag);
+bool ChaCha20Poly1305Open(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aadLength,
+                          uint8_t* data, size_t length, const uint8_t* tag);
+
+// RFC 7748 X25519; handshake only, so written for constant time rather than speed
+void X25519(uint8_t* out, const uint8_t* scalar, const uint8_t* point);
+
+// HChaCha20 (draft-irtf-cfrg-xchacha 2.2): a 32-byte key from a key and
+// 16-byte input, no feed-forward; turns the X25519 output into key material
+void HChaCha20(uint8_t* out, const uint8_t* key, const uint8_t* input);
+
+// Fresh ephemeral key pair from the OS random source; false if it failed
+bool GenerateMediaKeyPair(uint8_t* privateKey, uint8_t* publicKey);
+
+// A room secret of any length (a passphrase) as a key for DeriveMediaKeys:
+// HChaCha20 chained over it 16 bytes at a time, fed forward
+void DeriveRoomKey(const uint8_t* secret, size_t length, uint8_t* roomKey);
+
+// Both directions' keys from our private key and the peer's public key,
+// bound to roomKey unless it is nullptr. The host sends with the first
+// part of the derived material, the joining peer with the second; the
+// proof comes last. Wipes privateKey. False for a degenerate public key.
+bool DeriveMediaKeys(uint8_t* privateKey, const uint8_t* peerPublicKey, bool isHost, const uint8_t* roomKey,
+                     MediaKeys& keys);
+
+// Constant-time comparison of two key proofs
+bool MediaKeyProofsEqual(const uint8_t* a, const uint8_t* b);
+
+// Encrypts packet[headerSize..length) and appends index and tag. Returns the
+// protected length, or 0 if it would not fit in capacity.
+size_t ProtectMediaPacket(const MediaKey& key, MediaStream stream, uint32_t index,
+                          uint8_t* packet, size_t headerSize, size_t length, size_t capacity);
+
+// Index carried by a protected packet; false if too short to be one
+bool ReadMediaPacketIndex(const uint8_t* packet, size_t headerSize, size_t length, uint32_t& index);
+
+// Verifies and decrypts in place; on success length becomes the plaintext
+// packet's length (trailer removed)
+bool UnprotectMediaPacket(const MediaKey& key, MediaStream stream, uint8_t* packet, size_t headerSize,
+                          size_t& length);
+
+// Sliding window over received indices (RFC 3711 3.3.2): new, within the
+// window and unseen, or rejected. Check first, Accept once authenticated.
+class MediaReplayWindow {
+public:
+    bool Check(uint32_t index) const {
+        if (!started || index > highest) return true;
+        uint32_t behind = highest - index;
+        if (behind >= MEDIA_REPLAY_WINDOW) return false;
+        return (seen & (1ull << behind)) == 0;
+    }
+
+    void Accept(uint32_t index) {
+        if (!started) {
+            started = true;
+            highest = index;
+            seen = 1;
+        } else if (index > highest) {
+            uint32_t ahead = index - highest;
+            seen = ahead >= MEDIA_REPLAY_WINDOW ? 1 : (seen << ahead) | 1;
+            highest = index;
+        } else {
+            seen |= 1ull << (highest - index);
+        }
+    }
+
+    void Reset() {
+        started = false;
+        highest = 0;
+        seen = 0;
+    }
+
+private:
+    bool started = false;
+    uint32_t highest = 0;
+    uint64_t seen = 0;     // bit n: index highest - n received
+};
+
+#endif // VOICEQWIK_MEDIA_CRYPTO_H
@@ -0,0 +1,107 @@
+#ifndef VOICEQWIK_NETWORK_IMPAIRMENT_H
+#define VOICEQWIK_NETWORK_IMPAIRMENT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <string>
+#include <vector>
+
+// Deterministic network impairment for loopback testing. Datagrams go in
+// with the time they arrived and come back out when an emulated bad link
+// would have delivered them: through a rate-limited drop-tail bottleneck,
+// then Gilbert-Elliott loss, propagation delay with jitter, occasional
+// reordering and duplication. The random stream is a seeded SplitMix64, so
+// the same profile, seed and input always give the same output.
+
+// A link, as a bundle of impairments. Random (Bernoulli) loss is the
+// Gilbert-Elliott special case goodToBad = 0 with lossGood = the rate.
+struct ImpairmentProfile {
+    const char* name;
+    const char* description;
+
+    double goodToBad;        // per-packet P(good -> bad)
+    double badToGood;        // per-packet P(bad -> good); mean burst = 1 / badToGood
+    double lossGood;         // loss probability in each state
+    double lossBad;
+
+    double delayMs;          // fixed one-way delay
+    double jitterMs;         // mean extra delay, exponentially distributed
+    double reorderRate;      // share of packets held back by reorderDelayMs
+    double reorderDelayMs;
+    double duplicateRate;
+
+    double bandwidthKbps;    // bottleneck rate; 0 = unlimited
+    size_t queueBytes;       // bottleneck buffer (drop-tail)
+};
+
+struct ImpairmentStats {
+    uint64_t submitted = 0;
+    uint64_t delivered = 0;      // duplicates included
+    uint64_t lost = 0;           // Gilbert-Elliott losses
+    uint64_t queueDrops = 0;     // bottleneck buffer overflows
+    uint64_t reordered = 0;
+    uint64_t duplicated = 0;
+};
+
+struct ImpairedDatagram {
+    std::vector<uint8_t> data;
+    uint64_t tag;                // caller's, e.g. the sender address
+    int64_t deliverMicros;
+};
+
+class NetworkImpairment {
+public:
+    NetworkImpairment(const ImpairmentProfile& profile, uint64_t seed);
+
+    // A datagram reaching the impaired link at nowMicros
+    void Submit(int64_t nowMicros, const uint8_t* data, size_t length, uint64_t tag);
+
+    // Next datagram due by nowMicros, in delivery order; false if none
+    bool Poll(int64_t nowMicros, ImpairedDatagram& out);
+
+    // When the next datagram is due; INT64_MAX if nothing is in flight
+    int64_t GetNextDeliveryMicros() const;
+
+    const ImpairmentProfile& GetProfile() const { return profile; }
+    const ImpairmentStats& GetStats() const { return stats; }
+
+private:
+    struct InFlight {
+        int64_t deliverMicros;
+        uint64_t order;          // submission order breaks ties
+        ImpairedDatagram datagram;
+
+        bool operator>(const InFlight& other) const {
+            return deliverMicros != other.deliverMicros ? deliverMicros > other.deliverMicros
+                                                        : order > other.order;
+        }
+    };
+
+    ImpairmentProfile profile;
+    uint64_t randomState;
+    bool badState;
+
+    // Bottleneck: when the link is next free, and what is still queued on it
+    int64_t linkFreeMicros;
+    std::deque<std::pair<int64_t, size_t>> bottleneck;   // departure, bytes
+    size_t bottleneckBytes;
+
+    int64_t lastInOrderMicros;   // jitter never reorders on its own
+    uint64_t nextOrder;
+    std::priority_queue<InFlight, std::vector<InFlight>, std::greater<InFlight>> inFlight;
+    ImpairmentStats stats;
+
+    uint64_t NextRandom();
+    double NextUniform();        // [0, 1)
+    bool Chance(double probability);
+    void Schedule(int64_t deliverMicros, const uint8_t* data, size_t length, uint64_t tag);
+};
+
+// Canned profiles: lan, wifi-congested, mobile-tether, lossy-random
+const ImpairmentProfile* GetImpairmentProfiles(size_t& count);
+const ImpairmentProfile* FindImpairmentProfile(const std::string& name);
+
+#endif // VOICEQWIK_NETWORK_IMPAIRMENT_H
@@ -0,0 +1,138 @@
+#ifndef VOICEQWIK_PACKET_CAPTURE_H
+#define VOICEQWIK_PACKET_CAPTURE_H
+
+#include <utils/Common.h>
+#include <utils/SpscRing.h>
+#include <platform/Socket.h>
+#include <networking/RtpPacket.h>
+#include <cstdio>
+
+// Audio-socket traffic (RTP, RTCP, clock sync, path checks) as pcapng: one
+// raw-IP interface, each datagram wrapped in synthesized IPv4 or IPv6 and UDP
+// headers so
+// Wireshark decodes it ("Decode As... RTP" on the audio port), with its
+// direction in the packet flags and its send/arrival time in microseconds.
+
+constexpr size_t CAPTURE_RING_CAPACITY = 256;    // datagrams per producing thread
+constexpr size_t CAPTURE_SNAP_LENGTH = MAX_RTP_PACKET_SIZE;
+constexpr int CAPTURE_DRAIN_INTERVAL_MS = 20;
+constexpr size_t CAPTURE_FILE_BUFFER_SIZE = 1 << 20;
+
+enum class CaptureDirection : uint8_t {
+    Inbound,
+    Outbound
+};
+
+// The two threads that touch the audio socket; each has its own ring
+enum class CaptureProducer : uint8_t {
+    SendThread,      // the main loop sending audio
+    ReceiveThread,   // everything received, plus RTCP and clock sync sent
+    Count
+};
+
+// One datagram as captured, or as read back from a capture
+struct CapturedDatagram {
+    int64_t micros;             // when sent or received: LatencyClockMicros, or Unix time when read back
+    CaptureDirection direction;
+    uint8_t remoteAddress[16];  // network byte order; IPv4 uses the first 4 bytes
+    bool remoteIpv6;
+    uint16_t remotePort;        // host byte order
+    uint16_t localPort;
+    uint16_t length;            // bytes in data (after snapping)
+    uint16_t originalLength;
+    uint8_t data[CAPTURE_SNAP_LENGTH];
+};
+
+// Writes captures without blocking the socket threads: Capture() copies the
+// datagram into the producer's preallocated ring (dropped and counted when
+// full) and a background thread encodes and writes the pcapng blocks.
+class PacketCapture {
+public:
+    PacketCapture();
+    ~PacketCapture();
+
+    bool Open(const std::string& filename, uint16_t localPort);
+    void Close();
+    bool IsOpen() const { return active.load(std::memory_order_relaxed); }
+
+    // Each producer must only be used from its own thread
+    void Capture(CaptureProducer producer, CaptureDirection direction, const SocketAddress& remote,
+                 const uint8_t* data, size_t length);
+
+    uint64_t GetCapturedCount() const { return captured.load(std::memory_order_relaxed); }
+    uint64_t GetDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    PacketCapture(const PacketCapture&) = delete;
+    PacketCapture& operator=(const PacketCapture&) = delete;
+
+    using CaptureRing = SpscRing<CapturedDatagram, CAPTURE_RING_CAPACITY>;
+
+    std::atomic<bool> active;
+    std::atomic<uint64_t> captured;
+    std::atomic<uint64_t> dropped;
+    uint16_t localPort;
+    int64_t wallClockOffsetMicros;   // LatencyClockMicros to Unix time
+    std::unique_ptr<CaptureRing> rings[(size_t)CaptureProducer::Count];
+
+    FILE* file;
+    std::vector<char> fileBuffer;
+    std::vector<uint8_t> blockBuffer;
+    std::thread writerThread;
+    std::mutex writerMutex;
+    std::condition_variable writerCV;
+    bool stopRequested;
+
+    void WriterThreadProc();
+    void DrainRings();
+    bool WriteHeaderBlocks();
+    void WritePacketBlock(const CapturedDatagram& datagram);
+};
+
+// Reads back what PacketCapture wrote, and other pcapng or classic pcap
+// captures of IPv4 or IPv6 UDP on raw-IP or Ethernet links (tcpdump -w).
+// Other packets (IPv6 with extension headers too) and block types are skipped.
+class PacketCaptureReader {
+public:
+    PacketCaptureReader();
+    ~PacketCaptureReader();
+
+    bool Open(const std::string& filename);
+    void Close();
+
+    // Next UDP datagram; false at the end of the file or on a malformed block.
+    // Direction comes from the packet flags; without them a datagram to
+    // `localPort` (when nonzero) is inbound.
+    bool Next(CapturedDatagram& datagram, uint16_t localPort = 0);
+
+private:
+    PacketCaptureReader(const PacketCaptureReader&) = delete;
+    PacketCaptureReader& operator=(const PacketCaptureReader&) = delete;
+
+    struct UdpEndpoints {
+        uint8_t sourceAddress[16];     // network byte order
+        uint8_t destinationAddress[16];
+        bool ipv6;
+        uint16_t sourcePort;           // host byte order
+        uint16_t destinationPort;
+    };
+
+    FILE* file;
+    bool classic;                    // classic pcap rather than pcapng
+    bool swapped;                    // written on an opposite-endian host
+    bool classicNanos;               // classic pcap with nanosecond timestamps
+    uint32_t classicLinkType;
+    std::vector<uint32_t> linkTypes;             // pcapng: per interface in the section
+    std::vector<uint64_t> ticksPerSecond;
+    std::vector<uint8_t> blockBuffer;
+
+    uint16_t Read16(const uint8_t* p) const;
+    uint32_t Read32(const uint8_t* p) const;
+    bool NextClassic(CapturedDatagram& datagram, uint16_t localPort);
+    void ParseInterface(const uint8_t* body, size_t length);
+    bool ParseFrame(uint32_t linkType, const uint8_t* frame, size_t length, CapturedDatagram& datagram,
+                    UdpEndpoints& endpoints);
+    static void SetDirection(CapturedDatagram& datagram, const UdpEndpoints& endpoints, bool outbound);
+};
+
+#endif // VOICEQWIK_PACKET_CAPTURE_H
@@ -0,0 +1,109 @@
+#ifndef VOICEQWIK_PATH_SELECTOR_H
+#define VOICEQWIK_PATH_SELECTOR_H
+
+#include <networking/ControlProtocol.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Media path selection, ICE-lite style: each peer announces its interface
+// addresses (candidates) in the control hello, and each side checks every
+// candidate of the other with STUN binding requests (RFC 5389 header only)
+// on the audio socket, sending its media to the working one with the lowest
+// round trip. Every peer chooses its own send path; the local interface
+// follows from the OS route to the chosen address.
+constexpr size_t MAX_PATH_CANDIDATES = CONTROL_MAX_CANDIDATES + 1;   // plus the control connection's address
+
+constexpr int64_t PATH_CHECK_INTERVAL_MICROS = 250000;   // per candidate
+constexpr int64_t PATH_RECHECK_INTERVAL_MICROS = 50000;  // while no path answers, to find one coming back
+constexpr int64_t PATH_FAILED_MICROS = 1000000;          // no answer for this long: the path is down
+constexpr int64_t PATH_SWITCH_MIN_MICROS = 2000;         // closer round trips count as a tie
+constexpr double PATH_SWITCH_RATIO = 0.75;               // a faster path must also be this much faster
+
+// STUN binding request/response: type(2) length(2) cookie(4) transaction(12).
+// The top two bits are zero, which tells it from RTP, RTCP and clock sync.
+constexpr size_t PATH_CHECK_SIZE = 20;
+constexpr size_t PATH_TRANSACTION_ID_SIZE = 12;
+constexpr uint16_t STUN_BINDING_REQUEST = 0x0001;
+constexpr uint16_t STUN_BINDING_RESPONSE = 0x0101;
+constexpr uint32_t STUN_MAGIC_COOKIE = 0x2112A442;
+
+struct PathCheckMessage {
+    bool response;
+    uint8_t transactionId[PATH_TRANSACTION_ID_SIZE];
+};
+
+inline void WritePathCheck(uint8_t* out, const PathCheckMessage& message) {
+    uint16_t type = message.response ? STUN_BINDING_RESPONSE : STUN_BINDING_REQUEST;
+    out[0] = static_cast<uint8_t>(type >> 8);
+    out[1] = static_cast<uint8_t>(type);
+    out[2] = out[3] = 0;
+    out[4] = static_cast<uint8_t>(STUN_MAGIC_COOKIE >> 24);
+    out[5] = static_cast<uint8_t>(STUN_MAGIC_COOKIE >> 16);
+    out[6] = static_cast<uint8_t>(STUN_MAGIC_COOKIE >> 8);
+    out[7] = static_cast<uint8_t>(STUN_MAGIC_COOKIE);
+    for (size_t i = 0; i < PATH_TRANSACTION_ID_SIZE; i++) out[8 + i] = message.transactionId[i];
+}
+
+inline bool IsPathCheck(const uint8_t* data, size_t length) {
+    return length == PATH_CHECK_SIZE && (data[0] & 0xC0) == 0 &&
+           ((static_cast<uint32_t>(data[4]) << 24) | (static_cast<uint32_t>(data[5]) << 16) |
+            (static_cast<uint32_t>(data[6]) << 8) | data[7]) == STUN_MAGIC_COOKIE;
+}
+
+inline bool ParsePathCheck(const uint8_t* data, size_t length, PathCheckMessage& message) {
+    if (!IsPathCheck(data, length)) return false;
+    uint16_t type = static_cast<uint16_t>((data[0] << 8) | data[1]);
+    if (type != STUN_BINDING_REQUEST && type != STUN_BINDING_RESPONSE) return false;
+    message.response = type == STUN_BINDING_RESPONSE;
+    for (size_t i = 0; i < PATH_TRANSACTION_ID_SIZE; i++) message.transactionId[i] = data[8 + i];
+    return true;
+}
+
+// Checks one peer's candidates and picks the path to send on. Round trips
+// are smoothed; a working path is only left for one clearly faster (or as
+// fast on a preferred interface), so similar paths do not flap. Candidate 0
+// is used until some candidate has answered.
+class PathSelector {
+public:
+    PathSelector();
+
+    // New peer, or new candidates: preferences per candidate (InterfaceKind),
+    // checks due at once
+    void Reset(const uint8_t* preferences, size_t count);
+
+    // A candidate due for a check at nowMicros, with the request to send it;
+    // false when none is due
+    bool NextCheck(int64_t nowMicros, size_t& candidate, PathCheckMessage& request);
+
+    // False if the response is not to one of this selector's checks
+    bool OnResponse(const PathCheckMessage& response, int64_t nowMicros);
+
+    // Re-evaluates the choice; true if it changed
+    bool Update(int64_t nowMicros);
+
+    size_t GetSelected() const { return selected; }
+    size_t GetCount() const { return count; }
+    bool IsWorking(size_t candidate, int64_t nowMicros) const;
+    bool HasWorkingPath(int64_t nowMicros) const;
+    int64_t GetRttMicros(size_t candidate) const { return candidates[candidate].rttMicros; }   // -1 until answered
+
+private:
+    struct CandidateState {
+        uint8_t preference = 0;
+        int64_t lastCheckMicros = -1;    // -1 = never checked
+        int64_t lastAnswerMicros = 0;    // 0 = never answered
+        int64_t rttMicros = -1;
+    };
+
+    std::array<CandidateState, MAX_PATH_CANDIDATES> candidates;
+    size_t count;
+    size_t selected;
+    // Random per Reset; the rest of a transaction ID is the candidate and
+    // the send time, so an answer to any check gives a round trip
+    uint8_t transactionPrefix[PATH_TRANSACTION_ID_SIZE - 4];
+
+    bool IsBetter(size_t a, size_t b) const;
+};
+
+#endif // VOICEQWIK_PATH_SELECTOR_H
@@ -2,19 +2,55 @@
 #define VOICEQWIK_PEER_NETWORK_H
 
 #include <utils/Common.h>
-#include <winsock2.h>
-#include <ws2tcpip.h>
+#include <networking/ControlProtocol.h>
+#include <networking/PathSelector.h>
+#include <platform/Socket.h>
+#include <array>
+#include <chrono>
 #include <map>
 #include <optional>
 
+// The peer's audio socket as reached over one of its interfaces
+struct PeerCandidate {
+    SocketAddress address;
+    uint8_t preference;      // InterfaceKind
+};
+
 struct PeerInfo {
     PeerID id;
-    std::string ipAddress;
+    std::string ipAddress;   // of the control connection
     uint16_t audioPort;
     bool connected;
-    std::chrono::steady_clock::time_point lastHeartbeat;
+    std::chrono::steady_clock::time_point lastHeartbeat;   // control thread's; not kept up in a PeerList
+
+    // Media encryption, settled by the control handshake; fixed from then on
+    bool encrypted;
+    bool authenticated;      // keys bound to the room secret, not just to the exchange
+    MediaKeys mediaKeys;
+
+    // Media paths: [0] is the control connection's address, then what the
+    // peer announced. Replaced only when the session resumes (sessionEpoch
+    // changes); AudioStreamer picks one.
+    std::array<PeerCandidate, MAX_PATH_CANDIDATES> candidates;
+    uint8_t candidateCount;
+    bool pathChecks;         // the peer answers path checks
+
+    // Resumable session: while its control connection is down the peer stays
+    // in the call for up to PEER_TIMEOUT, keeping its ID and so all of its
+    // stream state (SSRC, sequence, jitter buffer, keys) for when it is back
+    bool resumable;
+    bool resuming;           // control connection lost, waiting for it to come back
+    uint32_t sessionEpoch;   // resumes so far
+    int64_t resumedMicros;   // LatencyClockMicros of the last resume
+
+    int64_t joinedMicros;    // LatencyClockMicros when it joined, for its time to first audio
 };
 
+// The peer list as of its last change (join, resume, lost connection,
+// leave). Immutable: it can be held and read on any thread while peers come
+// and go, and the keys in it are wiped when the last holder lets go.
+using PeerList = std::shared_ptr<const std::vector<PeerInfo>>;
+
 class PeerNetwork {
 public:
     static PeerNetwork& GetInstance();
@@ -29,16 +65,41 @@ public:
     // Client mode (join room)
     bool ConnectToPeer(const std::string& peerIP, uint16_t port);
 
-    // Connection status
+    // Connection status. Peers join and leave one at a time; audio to each
+    // flows as soon as its media path answers (AudioStreamer::IsMediaHeld),
+    // whether or not the room is full.
     int GetConnectedPeersCount() const;
     bool IsConnected() const;
     bool IsAllPeersConnected() const;
-    const std::vector<PeerInfo>& GetPeers() const;
+
+    // Take one per tick and keep it for the tick: a peer leaving meanwhile
+    // shows up in the next one
+    PeerList GetPeers() const;
 
     // Set expected participant count
     void SetExpectedParticipants(int count);
     int GetExpectedParticipants() const;
 
+    // Packet time: our preference, and what the control handshake settled on
+    void SetPreferredPacketTime(PacketTime ptime);
+    PacketTime GetPreferredPacketTime() const;
+    PacketTime GetSessionPacketTime() const;
+
+    // UDP port announced in the handshake (AudioStreamer's socket)
+    void SetLocalAudioPort(uint16_t port);
+
+    // Offer media encryption in the handshake (on by default). A peer that
+    // does not offer it too gets plaintext media, with a warning.
+    void SetMediaEncryption(bool enabled);
+    bool GetMediaEncryption() const;
+
+    // Room secret, shared by all participants out of band, that the media
+    // keys are bound to (MediaCrypto.h); empty for none. With one set, only
+    // peers with the same secret get in, and only with encryption. Set it
+    // before listening or connecting.
+    void SetRoomSecret(const std::string& secret);
+    bool HasRoomSecret() const { return roomSecret; }
+
 private:
     PeerNetwork();
     ~PeerNetwork();
@@ -46,20 +107,76 @@ private:
     PeerNetwork(const PeerNetwork&) = delete;
     PeerNetwork& operator=(const PeerNetwork&) = delete;
 
+    // A peer's control connection, and what it takes to resume it
+    struct ControlSession {
+        SocketHandle socket = INVALID_SOCKET_HANDLE;   // invalid while lost
+        bool redial = false;          // we joined the peer, so we reconnect
+        uint16_t controlPort = 0;     // the peer's listening port, for redialing
+        uint8_t token[CONTROL_SESSION_TOKEN_SIZE]{};
+        std::chrono::steady_clock::time_point lastHeartbeatSent;
+        std::chrono::steady_clock::time_point lostAt;
+        std::chrono::steady_clock::time_point nextRedial;
+        int redialDelayMs = 0;
+        bool left = false;            // the peer said it is leaving
+        std::array<uint8_t, CONTROL_MAX_MESSAGE_SIZE> received{};   // partial message
+        size_t receivedLength = 0;
+    };
+
     int maxParticipants;
     int expectedParticipants;
-    std::vector<PeerInfo> peers;
-    std::map<SOCKET, PeerID> socketToPeerMap;
+    std::vector<PeerInfo> peers;                 // the control side's copy, under peersMutex
+    std::map<PeerID, ControlSession> sessions;
 
-    SOCKET listeningSocket;
+    // What GetPeers hands out. Its own lock, so the media threads never wait
+    // on the control thread's socket work under peersMutex.
+    PeerList publishedPeers;
+    mutable std::mutex publishedMutex;
+
+    SocketHandle listeningSocket;
     std::thread acceptThread;
     std::atomic<bool> listening;
 
+    std::thread controlThread;
+    std::atomic<bool> controlRunning;
+
     mutable std::mutex peersMutex;
 
+    std::atomic<PacketTime> preferredPacketTime;
+    std::atomic<PacketTime> sessionPacketTime;
+    uint16_t localAudioPort;
+    std::atomic<bool> mediaEncryption;
+    bool roomSecret;
+    uint8_t roomKey[MEDIA_ROOM_KEY_SIZE];
+
     void AcceptThreadProc();
+    // Also settles media encryption (refusing a peer whose room secret
+    // differs from ours), filling in peerInfo's keys, and the
+    // session token: the one to resume going in (zeros for a new session)
+    // when joining, the session's coming out (zeros if not resumable)
+    bool ExchangeHello(SocketHandle peerSocket, bool isHost, ControlHello& remoteHello, PeerInfo& peerInfo,
+                       uint8_t* sessionToken);
+    void GatherCandidates(ControlHello& hello);
+    static void SetPeerCandidates(PeerInfo& peerInfo, const SocketAddress& controlAddress,
+                                  const ControlHello& remoteHello);
     PeerID GeneratePeerID();
+    // Caller holds peersMutex
+    void AddPeer(PeerInfo& peerInfo, SocketHandle peerSocket, const SocketAddress& controlAddress,
+                 const ControlHello& remoteHello, const uint8_t* sessionToken, uint16_t redialPort);
+    void ResumePeer(PeerInfo& peer, SocketHandle peerSocket, const SocketAddress& controlAddress,
+                    const ControlHello& remoteHello);
+    PeerInfo* FindPeer(PeerID id);
+    // Caller holds peersMutex; after any change to peers that readers need
+    void PublishPeers();
+    PeerID FindSessionByToken(const uint8_t* token) const;
     void RemovePeer(PeerID id);
+
+    // Control thread: heartbeats, lost connections and reconnects
+    void ControlThreadProc();
+    void ServiceControlConnections();
+    bool ReadControlMessages(ControlSession& session, PeerInfo& peer);
+    void LoseControlConnection(PeerInfo& peer, ControlSession& session);
+    void RedialLostSession();
+    bool Redial(PeerID id, const SocketAddress& address, const uint8_t* token);
     void CheckPeerHeartbeats();
 };
 
@@ -0,0 +1,134 @@
+#ifndef VOICEQWIK_PLAYOUT_QUEUE_H
+#define VOICEQWIK_PLAYOUT_QUEUE_H
+
+#include <audio/AudioFormat.h>
+#include <networking/RtpSourceStats.h>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Packets a playout queue holds; at the longest packet time that is over
+// two seconds of audio, far more than a mix loop keeping up lets build
+constexpr size_t PLAYOUT_QUEUE_CAPACITY = 64;
+
+// Per-peer playout queue, kept in sequence order so reordered packets
+// still play in place; packets older than the last one played are late.
+// A packet can play out in pieces, so a sender aggregating several capture
+// packets per RTP packet still plays one capture packet per mix.
+// Its packet slots are allocated up front, so Add and Pop do not allocate
+// (for packets up to MAX_SAMPLES_PER_PACKET, and a caller's buffer that has
+// reached that size). Not synchronized: the owner holds its own lock.
+class PlayoutQueue {
+public:
+    enum class Insert {
+        Queued,
+        Late,        // its playout slot has passed
+        Duplicate    // already queued
+    };
+
+    struct Packet {
+        uint16_t sequence = 0;
+        int64_t arrivalMicros = 0;
+        AudioBuffer samples;
+        size_t playedSamples = 0;   // taken by earlier Pops
+    };
+
+    PlayoutQueue() : slots(PLAYOUT_QUEUE_CAPACITY), head(0), count(0) {
+        for (auto& slot : slots) slot.samples.reserve(MAX_SAMPLES_PER_PACKET);
+    }
+
+    // True if a packet with this sequence would arrive too late to play
+    bool IsLate(uint16_t sequence) const {
+        return played && !RtpSequenceBefore(lastPlayedSequence, sequence);
+    }
+
+    bool Contains(uint16_t sequence) const {
+        for (size_t i = 0; i < count; i++) {
+            if (At(i).sequence == sequence) return true;
+        }
+        return false;
+    }
+
+    Insert Add(uint16_t sequence, int64_t arrivalMicros, const int16_t* samples, size_t sampleCount) {
+        if (IsLate(sequence)) {
+            return Insert::Late;
+        }
+
+        // Insert in sequence order, normally at the back
+        size_t pos = count;
+        while (pos > 0 && RtpSequenceBefore(sequence, At(pos - 1).sequence)) {
+            --pos;
+        }
+        if (pos > 0 && At(pos - 1).sequence == sequence) {
+            return Insert::Duplicate;
+        }
+
+        // Full: the oldest packet makes way, as if it had played
+        if (count == slots.size()) {
+            if (pos == 0) return Insert::Late;
+            lastPlayedSequence = At(0).sequence;
+            played = true;
+            head = (head + 1) % slots.size();
+            count--;
+            pos--;
+        }
+
+        // Later packets move back a slot; their buffers swap, nothing is copied
+        count++;
+        for (size_t i = count - 1; i > pos; i--) {
+            std::swap(At(i), At(i - 1));
+        }
+        Packet& packet = At(pos);
+        packet.sequence = sequence;
+        packet.arrivalMicros = arrivalMicros;
+        packet.samples.assign(samples, samples + sampleCount);
+        packet.playedSamples = 0;
+        return Insert::Queued;
+    }
+
+    // Copies up to maxSamples from the oldest packet into buffer, which keeps
+    // its capacity; the packet leaves the queue once all of it is taken.
+    // False if empty.
+    bool Pop(AudioBuffer& buffer, int64_t& arrivalMicros, size_t maxSamples = SIZE_MAX) {
+        if (count == 0) return false;
+
+        Packet& packet = At(0);
+        arrivalMicros = packet.arrivalMicros;
+        lastPlayedSequence = packet.sequence;
+        played = true;
+
+        size_t remaining = packet.samples.size() - packet.playedSamples;
+        size_t take = remaining < maxSamples ? remaining : maxSamples;
+        const int16_t* first = packet.samples.data() + packet.playedSamples;
+        buffer.assign(first, first + take);
+        packet.playedSamples += take;
+        if (packet.playedSamples == packet.samples.size()) {
+            head = (head + 1) % slots.size();
+            count--;
+        }
+        return true;
+    }
+
+    // Forget queued packets and playout position (sender restarted)
+    void Clear() {
+        head = 0;
+        count = 0;
+        played = false;
+    }
+
+    bool Empty() const { return count == 0; }
+    size_t Size() const { return count; }
+
+private:
+    Packet& At(size_t index) { return slots[(head + index) % slots.size()]; }
+    const Packet& At(size_t index) const { return slots[(head + index) % slots.size()]; }
+
+    std::vector<Packet> slots;   // a ring: count packets from head, in sequence order
+    size_t head;
+    size_t count;
+    bool played = false;
+    uint16_t lastPlayedSequence = 0;
+};
+
+#endif // VOICEQWIK_PLAYOUT_QUEUE_H
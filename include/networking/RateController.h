@@ -0,0 +1,123 @@
+#ifndef VOICEQWIK_RATE_CONTROLLER_H
+#define VOICEQWIK_RATE_CONTROLLER_H
+
+#include <audio/AudioFormat.h>
+#include <audio/PayloadCodec.h>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Closed-loop send rate control for one outgoing stream. RTCP feedback
+// (loss, RTT, jitter) moves the stream along a ladder of payload encodings
+// and packet times, and turns RFC 2198 redundancy on for random loss, within
+// the rate the path is known to carry.
+// Congestion (queueing delay above the RTT floor, or heavy loss) backs off
+// at once, by two steps when severe; recovery probes one step at a time
+// after a hold period that doubles every time a probe fails.
+
+constexpr int64_t RATE_PROBE_HOLD_MICROS = 5000000;       // quiet time before stepping up
+constexpr int64_t RATE_MAX_PROBE_HOLD_MICROS = 60000000;
+constexpr int64_t RATE_FEEDBACK_TIMEOUT_MICROS = 3000000; // no reports while sending = congested
+constexpr double RATE_QUEUE_DELAY_MS = 40.0;              // RTT rise that counts as congestion
+constexpr double RATE_SEVERE_QUEUE_DELAY_MS = 150.0;
+constexpr double RATE_CONGESTION_LOSS = 0.20;             // loss this high is congestion regardless of delay
+constexpr double RATE_REDUNDANCY_LOSS = 0.02;             // random loss worth repeating packets for
+constexpr size_t RATE_RTT_FLOOR_WINDOW = 32;              // reports the RTT floor is taken over
+constexpr double RATE_BACKOFF_HEADROOM = 0.85;            // share of the delivered rate to back off to
+constexpr double RATE_REDUNDANCY_GROWTH = 1.1;            // redundancy's room above the carried rate, no ceiling known
+
+// One rung of the rate ladder
+struct StreamConfig {
+    PayloadEncoding encoding;
+    uint8_t packetsPerRtp;   // capture packets aggregated into one RTP packet
+    uint8_t redundancy;      // earlier packets repeated in each one (0 = off)
+};
+
+struct RateFeedback {
+    double fractionLost;     // 0..1 over the reporter's last interval
+    double rttMs;            // negative if not measured yet
+    double jitterMs;
+    double receivedBitrate;  // bits/s that reached the receiver; 0 if unknown
+};
+
+enum class RateDecision : uint8_t {
+    Hold,
+    Decrease,
+    Increase,
+    AddRedundancy,
+    DropRedundancy
+};
+
+const char* RateDecisionToString(RateDecision decision);
+
+// Audit record for a decision; produced for every change
+struct RateDecisionRecord {
+    RateDecision decision;
+    const char* reason;
+    size_t level;
+    StreamConfig config;
+    uint32_t bitrate;        // estimated bits/s on the wire
+    RateFeedback feedback;
+    double queueDelayMs;     // smoothed RTT above the floor
+};
+
+class RateController {
+public:
+    // capturePacketTime is the packet time audio arrives in from capture
+    explicit RateController(PacketTime capturePacketTime);
+
+    void Reset();
+
+    // Feeds one receiver report. Returns true if the configuration changed,
+    // with the decision in record.
+    bool OnFeedback(int64_t nowMicros, const RateFeedback& feedback, RateDecisionRecord& record);
+
+    // Called while sending; backs off when reports stop arriving
+    bool OnTick(int64_t nowMicros, RateDecisionRecord& record);
+
+    const StreamConfig& GetConfig() const { return config; }
+    size_t GetLevel() const { return level; }
+    uint32_t GetBitrate() const { return EstimateBitrate(config, capturePacketTime); }
+
+    static size_t GetLevelCount();
+
+    // Wire bitrate (headers included) for a configuration
+    static uint32_t EstimateBitrate(const StreamConfig& config, PacketTime capturePacketTime);
+
+    // Whether `redundancy` earlier packets fit the RED block and packet limits
+    static bool RedundancyFits(const StreamConfig& config, PacketTime capturePacketTime, uint8_t redundancy);
+
+private:
+    PacketTime capturePacketTime;
+    StreamConfig config;
+    size_t level;
+
+    bool hasFeedback;
+    int64_t lastFeedbackMicros;
+    int64_t lastChangeMicros;
+    int64_t lastLossMicros;
+    bool decreased;
+    int64_t lastDecreaseMicros;
+    double lastQueueDelayMs;
+    double ceilingBitrate;     // delivered rate at the last congestion; 0 = unknown
+    int64_t probeHoldMicros;
+    bool probing;
+    int64_t probeStartMicros;
+
+    double rttHistory[RATE_RTT_FLOOR_WINDOW];
+    size_t rttCount;
+    size_t rttNext;
+    double smoothedRttMs;
+
+    StreamConfig LevelConfig(size_t forLevel) const;
+    double RedundancyBudget(const RateFeedback& feedback) const;
+    void ApplyLevel(size_t newLevel);
+    double UpdateQueueDelay(double rttMs);
+    void Fill(RateDecisionRecord& record, RateDecision decision, const char* reason,
+              const RateFeedback& feedback, double queueDelayMs) const;
+};
+
+// One line for the log
+std::string FormatRateDecision(uint32_t peerId, const RateDecisionRecord& record, PacketTime capturePacketTime);
+
+#endif // VOICEQWIK_RATE_CONTROLLER_H
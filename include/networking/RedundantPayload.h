@@ -0,0 +1,108 @@
+#ifndef VOICEQWIK_REDUNDANT_PAYLOAD_H
+#define VOICEQWIK_REDUNDANT_PAYLOAD_H
+
+#include <cstddef>
+#include <cstdint>
+
+// RFC 2198 redundant audio: the RTP payload carries up to
+// RED_MAX_REDUNDANCY earlier payloads ahead of the current one, so a single
+// lost packet is recovered from the next. VoiceQwik always repeats the
+// immediately preceding packets, so the receiver maps block i of n
+// (oldest first) to sequence - (n - i).
+//
+//   redundant block header:  F=1 | PT(7) | timestamp offset(14) | length(10)
+//   primary block header:    F=0 | PT(7)
+
+constexpr uint8_t RTP_PAYLOAD_TYPE_RED = 114;
+constexpr size_t RED_MAX_REDUNDANCY = 2;
+constexpr size_t RED_MAX_BLOCK_SIZE = 1023;           // 10-bit length field
+constexpr uint32_t RED_MAX_TIMESTAMP_OFFSET = 16383;  // 14-bit offset field
+constexpr size_t RED_BLOCK_HEADER_SIZE = 4;
+constexpr size_t RED_PRIMARY_HEADER_SIZE = 1;
+
+struct RedundantBlock {
+    uint8_t payloadType;
+    uint32_t timestampOffset;   // 0 for the primary
+    const uint8_t* data;
+    size_t length;
+};
+
+// Bytes of RED framing for a packet carrying `redundancy` earlier blocks
+constexpr size_t RedundantHeaderSize(size_t redundancy) {
+    return redundancy * RED_BLOCK_HEADER_SIZE + RED_PRIMARY_HEADER_SIZE;
+}
+
+// Writes blocks[0..count) with the last one as the primary. Returns the
+// payload size, or 0 if a redundant block is too long or too old.
+inline size_t WriteRedundantPayload(uint8_t* out, size_t capacity, const RedundantBlock* blocks, size_t count) {
+    if (count == 0) return 0;
+
+    size_t total = RedundantHeaderSize(count - 1);
+    for (size_t i = 0; i < count; i++) {
+        if (i + 1 < count && (blocks[i].length > RED_MAX_BLOCK_SIZE ||
+                              blocks[i].timestampOffset > RED_MAX_TIMESTAMP_OFFSET)) {
+            return 0;
+        }
+        total += blocks[i].length;
+    }
+    if (total > capacity) return 0;
+
+    size_t offset = 0;
+    for (size_t i = 0; i + 1 < count; i++) {
+        uint32_t word = 0x80000000u | ((uint32_t)(blocks[i].payloadType & 0x7F) << 24) |
+                        (blocks[i].timestampOffset << 10) | (uint32_t)blocks[i].length;
+        out[offset++] = (uint8_t)(word >> 24);
+        out[offset++] = (uint8_t)(word >> 16);
+        out[offset++] = (uint8_t)(word >> 8);
+        out[offset++] = (uint8_t)word;
+    }
+    out[offset++] = blocks[count - 1].payloadType & 0x7F;
+
+    for (size_t i = 0; i < count; i++) {
+        for (size_t b = 0; b < blocks[i].length; b++) {
+            out[offset + b] = blocks[i].data[b];
+        }
+        offset += blocks[i].length;
+    }
+    return offset;
+}
+
+// Splits a RED payload into blocks (oldest first, primary last). Returns the
+// block count, 0 if malformed.
+inline size_t ParseRedundantPayload(const uint8_t* data, size_t length,
+                                    RedundantBlock* blocks, size_t maxBlocks) {
+    size_t count = 0;
+    size_t offset = 0;
+    size_t redundantBytes = 0;
+
+    while (true) {
+        if (offset >= length || count == maxBlocks) return 0;
+        if ((data[offset] & 0x80) == 0) {
+            blocks[count].payloadType = data[offset] & 0x7F;
+            blocks[count].timestampOffset = 0;
+            count++;
+            offset++;
+            break;
+        }
+        if (offset + RED_BLOCK_HEADER_SIZE > length) return 0;
+        uint32_t word = ((uint32_t)data[offset] << 24) | ((uint32_t)data[offset + 1] << 16) |
+                        ((uint32_t)data[offset + 2] << 8) | data[offset + 3];
+        blocks[count].payloadType = (uint8_t)((word >> 24) & 0x7F);
+        blocks[count].timestampOffset = (word >> 10) & RED_MAX_TIMESTAMP_OFFSET;
+        blocks[count].length = word & 0x3FF;
+        redundantBytes += blocks[count].length;
+        count++;
+        offset += RED_BLOCK_HEADER_SIZE;
+    }
+
+    if (offset + redundantBytes > length) return 0;
+    for (size_t i = 0; i + 1 < count; i++) {
+        blocks[i].data = data + offset;
+        offset += blocks[i].length;
+    }
+    blocks[count - 1].data = data + offset;
+    blocks[count - 1].length = length - offset;
+    return count;
+}
+
+#endif // VOICEQWIK_REDUNDANT_PAYLOAD_H
@@ -0,0 +1,273 @@
+#ifndef VOICEQWIK_RTCP_PACKET_H
+#define VOICEQWIK_RTCP_PACKET_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+// RTCP sender/receiver reports (RFC 3550 section 6.4), sent as compound
+// packets on the RTP socket (RFC 5761 multiplexing). Every compound starts
+// with an SR or RR and carries an SDES CNAME, as section 6.1 requires.
+
+constexpr uint8_t RTCP_PT_SR = 200;
+constexpr uint8_t RTCP_PT_RR = 201;
+constexpr uint8_t RTCP_PT_SDES = 202;
+constexpr uint8_t RTCP_PT_BYE = 203;
+constexpr uint8_t RTCP_SDES_CNAME = 1;
+
+constexpr size_t RTCP_HEADER_SIZE = 8;          // common header + sender SSRC
+constexpr size_t RTCP_SENDER_INFO_SIZE = 20;
+constexpr size_t RTCP_REPORT_BLOCK_SIZE = 24;
+constexpr size_t RTCP_MAX_REPORT_BLOCKS = 31;   // 5-bit count field
+constexpr size_t RTCP_MAX_CNAME_LENGTH = 64;
+constexpr size_t RTCP_BYE_SIZE = 8;             // header + one SSRC, no reason
+constexpr size_t RTCP_MAX_PACKET_SIZE =
+    RTCP_HEADER_SIZE + RTCP_SENDER_INFO_SIZE + RTCP_MAX_REPORT_BLOCKS * RTCP_REPORT_BLOCK_SIZE +
+    12 + RTCP_MAX_CNAME_LENGTH + RTCP_BYE_SIZE;
+
+// Reporting interval (RFC 3550 section 6.2/6.3): RTCP gets 5% of the session
+// bandwidth, a quarter of it for senders once they are few
+constexpr double RTCP_BANDWIDTH_FRACTION = 0.05;
+constexpr double RTCP_SENDER_BANDWIDTH_FRACTION = 0.25;
+constexpr double RTCP_MIN_INTERVAL_SECONDS = 5.0;
+
+// Optional reduced minimum of 360 / session kbps seconds (section 6.2), so
+// feedback-driven rate control hears about loss and delay within a second
+constexpr double RTCP_REDUCED_MIN_INTERVAL_KBPS = 360.0;
+
+struct RtcpSenderInfo {
+    uint64_t ntpTimestamp;     // wallclock, NTP format
+    uint32_t rtpTimestamp;     // same instant on the RTP clock
+    uint32_t packetCount;
+    uint32_t octetCount;       // payload octets
+};
+
+struct RtcpReportBlock {
+    uint32_t ssrc;                      // source this block is about
+    uint8_t fractionLost;               // since the previous report, /256
+    int32_t cumulativeLost;             // 24-bit signed on the wire
+    uint32_t extendedHighestSequence;
+    uint32_t jitter;                    // RTP timestamp units
+    uint32_t lastSenderReport;          // LSR: middle 32 bits of the last SR's NTP time
+    uint32_t delaySinceLastSenderReport; // DLSR: 1/65536 s
+};
+
+// Everything VoiceQwik uses from one compound packet
+struct RtcpReport {
+    uint32_t senderSsrc;
+    bool hasSenderInfo;
+    RtcpSenderInfo senderInfo;
+    RtcpReportBlock blocks[RTCP_MAX_REPORT_BLOCKS];
+    size_t blockCount;
+    bool bye;
+};
+
+// RFC 5761 section 4: RTCP packet types 192-223 never collide with the
+// dynamic RTP payload types, so the second byte tells them apart
+inline bool IsRtcpPacket(const uint8_t* data, size_t length) {
+    return length >= RTCP_HEADER_SIZE && (data[0] >> 6) == 2 && data[1] >= 192 && data[1] <= 223;
+}
+
+// Current wallclock as a 64-bit NTP timestamp
+inline uint64_t RtcpNtpNow() {
+    constexpr uint64_t NTP_UNIX_OFFSET = 2208988800ull;   // 1900 to 1970, seconds
+    auto sinceEpoch = std::chrono::system_clock::now().time_since_epoch();
+    uint64_t micros = (uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(sinceEpoch).count();
+    uint64_t seconds = micros / 1000000 + NTP_UNIX_OFFSET;
+    uint64_t fraction = ((micros % 1000000) << 32) / 1000000;
+    return (seconds << 32) | fraction;
+}
+
+// Middle 32 bits, the compact form used by LSR and RTT arithmetic
+inline uint32_t RtcpNtpMiddle(uint64_t ntp) {
+    return static_cast<uint32_t>(ntp >> 16);
+}
+
+// Deterministic part of the reporting interval in seconds; callers randomize
+// it by a factor in [0.5, 1.5] and divide by e - 3/2 (section 6.3.1)
+inline double ComputeRtcpInterval(size_t members, size_t senders, double sessionBytesPerSecond,
+                                  double averageRtcpSize, bool weSent, bool initial,
+                                  bool reducedMinimum = false) {
+    double rtcpBandwidth = sessionBytesPerSecond * RTCP_BANDWIDTH_FRACTION;
+    double n = (double)(members ? members : 1);
+
+    if (senders > 0 && senders <= members * RTCP_SENDER_BANDWIDTH_FRACTION) {
+        if (weSent) {
+            rtcpBandwidth *= RTCP_SENDER_BANDWIDTH_FRACTION;
+            n = (double)senders;
+        } else {
+            rtcpBandwidth *= 1.0 - RTCP_SENDER_BANDWIDTH_FRACTION;
+            n = (double)(members - senders);
+        }
+    }
+
+    double minimum = RTCP_MIN_INTERVAL_SECONDS;
+    if (reducedMinimum && sessionBytesPerSecond > 0.0) {
+        minimum = RTCP_REDUCED_MIN_INTERVAL_KBPS / (sessionBytesPerSecond * 8.0 / 1000.0);
+    }
+    if (initial) minimum /= 2;
+    double interval = rtcpBandwidth > 0.0 ? averageRtcpSize * n / rtcpBandwidth : minimum;
+    return interval > minimum ? interval : minimum;
+}
+
+inline void RtcpPut16(uint8_t* p, uint16_t v) {
+    p[0] = static_cast<uint8_t>(v >> 8);
+    p[1] = static_cast<uint8_t>(v);
+}
+
+inline void RtcpPut32(uint8_t* p, uint32_t v) {
+    p[0] = static_cast<uint8_t>(v >> 24);
+    p[1] = static_cast<uint8_t>(v >> 16);
+    p[2] = static_cast<uint8_t>(v >> 8);
+    p[3] = static_cast<uint8_t>(v);
+}
+
+inline uint16_t RtcpGet16(const uint8_t* p) {
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t RtcpGet32(const uint8_t* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+           (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// Writes an SR (senderInfo given) or RR followed by SDES CNAME, and a BYE
+// for byeSsrc if given. Returns the compound size, or 0 if it does not fit
+// in capacity.
+inline size_t WriteRtcpCompound(uint8_t* out, size_t capacity, uint32_t ssrc,
+                                const RtcpSenderInfo* senderInfo,
+                                const RtcpReportBlock* blocks, size_t blockCount,
+                                const char* cname, const uint32_t* byeSsrc = nullptr) {
+    if (blockCount > RTCP_MAX_REPORT_BLOCKS) blockCount = RTCP_MAX_REPORT_BLOCKS;
+    size_t cnameLength = std::strlen(cname);
+    if (cnameLength > RTCP_MAX_CNAME_LENGTH) cnameLength = RTCP_MAX_CNAME_LENGTH;
+
+    size_t reportSize = RTCP_HEADER_SIZE + (senderInfo ? RTCP_SENDER_INFO_SIZE : 0) +
+                        blockCount * RTCP_REPORT_BLOCK_SIZE;
+    // SDES: header, SSRC, CNAME item (type, length, text), null terminator, pad to 32 bits
+    size_t sdesSize = (8 + 2 + cnameLength + 1 + 3) & ~(size_t)3;
+    size_t byeSize = byeSsrc ? RTCP_BYE_SIZE : 0;
+    if (reportSize + sdesSize + byeSize > capacity) {
+        return 0;
+    }
+
+    uint8_t* p = out;
+    p[0] = static_cast<uint8_t>(0x80 | blockCount);
+    p[1] = senderInfo ? RTCP_PT_SR : RTCP_PT_RR;
+    RtcpPut16(p + 2, static_cast<uint16_t>(reportSize / 4 - 1));
+    RtcpPut32(p + 4, ssrc);
+    p += RTCP_HEADER_SIZE;
+
+    if (senderInfo) {
+        RtcpPut32(p, static_cast<uint32_t>(senderInfo->ntpTimestamp >> 32));
+        RtcpPut32(p + 4, static_cast<uint32_t>(senderInfo->ntpTimestamp));
+        RtcpPut32(p + 8, senderInfo->rtpTimestamp);
+        RtcpPut32(p + 12, senderInfo->packetCount);
+        RtcpPut32(p + 16, senderInfo->octetCount);
+        p += RTCP_SENDER_INFO_SIZE;
+    }
+
+    for (size_t i = 0; i < blockCount; i++) {
+        const RtcpReportBlock& block = blocks[i];
+        int32_t lost = block.cumulativeLost;
+        if (lost > 0x7FFFFF) lost = 0x7FFFFF;
+        if (lost < -0x800000) lost = -0x800000;
+
+        RtcpPut32(p, block.ssrc);
+        RtcpPut32(p + 4, (static_cast<uint32_t>(block.fractionLost) << 24) | (static_cast<uint32_t>(lost) & 0xFFFFFF));
+        RtcpPut32(p + 8, block.extendedHighestSequence);
+        RtcpPut32(p + 12, block.jitter);
+        RtcpPut32(p + 16, block.lastSenderReport);
+        RtcpPut32(p + 20, block.delaySinceLastSenderReport);
+        p += RTCP_REPORT_BLOCK_SIZE;
+    }
+
+    std::memset(p, 0, sdesSize);
+    p[0] = 0x81;   // one chunk
+    p[1] = RTCP_PT_SDES;
+    RtcpPut16(p + 2, static_cast<uint16_t>(sdesSize / 4 - 1));
+    RtcpPut32(p + 4, ssrc);
+    p[8] = RTCP_SDES_CNAME;
+    p[9] = static_cast<uint8_t>(cnameLength);
+    std::memcpy(p + 10, cname, cnameLength);
+    p += sdesSize;
+
+    if (byeSsrc) {
+        p[0] = 0x81;   // one SSRC
+        p[1] = RTCP_PT_BYE;
+        RtcpPut16(p + 2, static_cast<uint16_t>(RTCP_BYE_SIZE / 4 - 1));
+        RtcpPut32(p + 4, *byeSsrc);
+    }
+
+    return reportSize + sdesSize + byeSize;
+}
+
+// Parses a compound packet. Unknown packet types are skipped; a malformed
+// length anywhere rejects the whole compound.
+inline bool ParseRtcpCompound(const uint8_t* data, size_t length, RtcpReport& report) {
+    report.senderSsrc = 0;
+    report.hasSenderInfo = false;
+    report.blockCount = 0;
+    report.bye = false;
+
+    if (!IsRtcpPacket(data, length)) {
+        return false;
+    }
+
+    size_t offset = 0;
+    bool first = true;
+    while (offset + 4 <= length) {
+        const uint8_t* p = data + offset;
+        if ((p[0] >> 6) != 2) return false;
+
+        size_t packetSize = (static_cast<size_t>(RtcpGet16(p + 2)) + 1) * 4;
+        if (offset + packetSize > length) return false;
+
+        uint8_t count = p[0] & 0x1F;
+        uint8_t type = p[1];
+
+        // Section 6.1: the compound must lead with a report
+        if (first && type != RTCP_PT_SR && type != RTCP_PT_RR) return false;
+        first = false;
+
+        if (type == RTCP_PT_SR || type == RTCP_PT_RR) {
+            size_t blocksOffset = RTCP_HEADER_SIZE + (type == RTCP_PT_SR ? RTCP_SENDER_INFO_SIZE : 0);
+            if (packetSize < blocksOffset + count * RTCP_REPORT_BLOCK_SIZE) return false;
+
+            if (report.senderSsrc == 0) {
+                report.senderSsrc = RtcpGet32(p + 4);
+            }
+
+            if (type == RTCP_PT_SR && !report.hasSenderInfo) {
+                const uint8_t* info = p + RTCP_HEADER_SIZE;
+                report.hasSenderInfo = true;
+                report.senderInfo.ntpTimestamp = (static_cast<uint64_t>(RtcpGet32(info)) << 32) | RtcpGet32(info + 4);
+                report.senderInfo.rtpTimestamp = RtcpGet32(info + 8);
+                report.senderInfo.packetCount = RtcpGet32(info + 12);
+                report.senderInfo.octetCount = RtcpGet32(info + 16);
+            }
+
+            for (uint8_t i = 0; i < count && report.blockCount < RTCP_MAX_REPORT_BLOCKS; i++) {
+                const uint8_t* b = p + blocksOffset + i * RTCP_REPORT_BLOCK_SIZE;
+                RtcpReportBlock& block = report.blocks[report.blockCount++];
+                uint32_t lossWord = RtcpGet32(b + 4);
+                block.ssrc = RtcpGet32(b);
+                block.fractionLost = static_cast<uint8_t>(lossWord >> 24);
+                block.cumulativeLost = static_cast<int32_t>(lossWord << 8) >> 8;   // sign-extend 24 bits
+                block.extendedHighestSequence = RtcpGet32(b + 8);
+                block.jitter = RtcpGet32(b + 12);
+                block.lastSenderReport = RtcpGet32(b + 16);
+                block.delaySinceLastSenderReport = RtcpGet32(b + 20);
+            }
+        } else if (type == RTCP_PT_BYE) {
+            report.bye = true;
+        }
+
+        offset += packetSize;
+    }
+
+    return offset == length && report.senderSsrc != 0;
+}
+
+#endif // VOICEQWIK_RTCP_PACKET_H
@@ -0,0 +1,83 @@
+#ifndef VOICEQWIK_RTP_PACKET_H
+#define VOICEQWIK_RTP_PACKET_H
+
+#include <audio/AudioFormat.h>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed RTP header (RFC 3550 section 5.1), without CSRCs
+constexpr size_t RTP_HEADER_SIZE = 12;
+
+// IPv4 (20) + UDP (8) bytes carried by every datagram
+constexpr size_t IPV4_UDP_OVERHEAD = 28;
+
+// Room for the header extensions VoiceQwik sends (see LatencyProbe.h)
+constexpr size_t MAX_RTP_HEADER_EXTENSION_SIZE = 16;
+
+constexpr size_t MAX_RTP_PAYLOAD_SIZE = MAX_SAMPLES_PER_PACKET * sizeof(int16_t);
+constexpr size_t MAX_RTP_PACKET_SIZE = RTP_HEADER_SIZE + MAX_RTP_HEADER_EXTENSION_SIZE + MAX_RTP_PAYLOAD_SIZE;
+
+// Host-order view of an RTP header
+struct RTPHeader {
+    bool marker;
+    uint8_t payloadType;
+    uint16_t sequence;
+    uint32_t timestamp;
+    uint32_t ssrc;
+};
+
+// Serializes the fixed header (V=2, P=0, CC=0) into out[0..RTP_HEADER_SIZE).
+// With hasExtension the X bit is set and the extension must follow.
+inline void WriteRTPHeader(uint8_t* out, const RTPHeader& header, bool hasExtension = false) {
+    out[0] = hasExtension ? 0x90 : 0x80;
+    out[1] = static_cast<uint8_t>((header.marker ? 0x80 : 0x00) | (header.payloadType & 0x7F));
+    out[2] = static_cast<uint8_t>(header.sequence >> 8);
+    out[3] = static_cast<uint8_t>(header.sequence);
+    out[4] = static_cast<uint8_t>(header.timestamp >> 24);
+    out[5] = static_cast<uint8_t>(header.timestamp >> 16);
+    out[6] = static_cast<uint8_t>(header.timestamp >> 8);
+    out[7] = static_cast<uint8_t>(header.timestamp);
+    out[8] = static_cast<uint8_t>(header.ssrc >> 24);
+    out[9] = static_cast<uint8_t>(header.ssrc >> 16);
+    out[10] = static_cast<uint8_t>(header.ssrc >> 8);
+    out[11] = static_cast<uint8_t>(header.ssrc);
+}
+
+// Parses an RTP header, skipping CSRCs and any header extension.
+// headerSize receives the payload offset; payloadSize excludes padding.
+inline bool ParseRTPHeader(const uint8_t* data, size_t length, RTPHeader& header,
+                           size_t& headerSize, size_t& payloadSize) {
+    if (length < RTP_HEADER_SIZE || (data[0] >> 6) != 2) {
+        return false;
+    }
+
+    size_t offset = RTP_HEADER_SIZE + (data[0] & 0x0F) * 4;
+    if (data[0] & 0x10) {
+        if (length < offset + 4) return false;
+        size_t extensionWords = (static_cast<size_t>(data[offset + 2]) << 8) | data[offset + 3];
+        offset += 4 + extensionWords * 4;
+    }
+    if (length < offset) {
+        return false;
+    }
+
+    size_t padding = 0;
+    if (data[0] & 0x20) {
+        padding = data[length - 1];
+        if (padding == 0 || offset + padding > length) return false;
+    }
+
+    header.marker = (data[1] & 0x80) != 0;
+    header.payloadType = data[1] & 0x7F;
+    header.sequence = static_cast<uint16_t>((data[2] << 8) | data[3]);
+    header.timestamp = (static_cast<uint32_t>(data[4]) << 24) | (static_cast<uint32_t>(data[5]) << 16) |
+                       (static_cast<uint32_t>(data[6]) << 8) | data[7];
+    header.ssrc = (static_cast<uint32_t>(data[8]) << 24) | (static_cast<uint32_t>(data[9]) << 16) |
+                  (static_cast<uint32_t>(data[10]) << 8) | data[11];
+
+    headerSize = offset;
+    payloadSize = length - offset - padding;
+    return true;
+}
+
+#endif // VOICEQWIK_RTP_PACKET_H
@@ -0,0 +1,130 @@
+#ifndef VOICEQWIK_RTP_SOURCE_STATS_H
+#define VOICEQWIK_RTP_SOURCE_STATS_H
+
+#include <cstdint>
+
+// True if sequence a comes before b, allowing for 16-bit wraparound
+inline bool RtpSequenceBefore(uint16_t a, uint16_t b) {
+    return static_cast<int16_t>(static_cast<uint16_t>(a - b)) < 0;
+}
+
+// Receive-side state for one RTP source: sequence tracking (RFC 3550 A.1,
+// without the probation period) and interarrival jitter (A.8).
+class RtpSourceStats {
+public:
+    enum class Arrival {
+        InOrder,     // next expected or later (gap counts as loss)
+        Reordered,   // older than the highest seen
+        Duplicate,   // same as the highest seen
+        Restarted    // jump too large; sender restarted, state reset
+    };
+
+    static constexpr uint16_t MAX_DROPOUT = 3000;
+    static constexpr uint16_t MAX_MISORDER = 100;
+
+    RtpSourceStats() {
+        Reset();
+    }
+
+    void Reset() {
+        initialized = false;
+        maxSequence = 0;
+        cycles = 0;
+        baseSequence = 0;
+        received = 0;
+        expectedPrior = 0;
+        receivedPrior = 0;
+        lastTransit = 0;
+        jitterScaled = 0;
+    }
+
+    // arrivalTime is the local arrival clock in RTP timestamp units
+    Arrival Update(uint16_t sequence, uint32_t rtpTimestamp, uint32_t arrivalTime) {
+        if (!initialized) {
+            Start(sequence, rtpTimestamp, arrivalTime);
+            return Arrival::InOrder;
+        }
+
+        Arrival arrival;
+        uint16_t delta = static_cast<uint16_t>(sequence - maxSequence);
+        if (delta == 0) {
+            arrival = Arrival::Duplicate;
+        } else if (delta < MAX_DROPOUT) {
+            if (sequence < maxSequence) {
+                cycles += 1u << 16;
+            }
+            maxSequence = sequence;
+            arrival = Arrival::InOrder;
+        } else if (delta <= 0xFFFF - MAX_MISORDER) {
+            Start(sequence, rtpTimestamp, arrivalTime);
+            return Arrival::Restarted;
+        } else {
+            arrival = Arrival::Reordered;
+        }
+
+        received++;
+
+        // Jitter is defined over all packets, in arrival order
+        int32_t transit = static_cast<int32_t>(arrivalTime - rtpTimestamp);
+        int32_t d = transit - lastTransit;
+        lastTransit = transit;
+        if (d < 0) d = -d;
+        jitterScaled += static_cast<uint32_t>(d) - ((jitterScaled + 8) >> 4);
+
+        return arrival;
+    }
+
+    bool IsInitialized() const { return initialized; }
+
+    uint32_t GetExtendedHighestSequence() const { return cycles + maxSequence; }
+    uint32_t GetReceived() const { return received; }
+
+    uint32_t GetExpected() const {
+        return initialized ? GetExtendedHighestSequence() - baseSequence + 1 : 0;
+    }
+
+    // Cumulative packets lost; negative when duplicates outnumber losses
+    int32_t GetCumulativeLost() const {
+        return static_cast<int32_t>(GetExpected() - received);
+    }
+
+    // Interarrival jitter in RTP timestamp units
+    uint32_t GetJitter() const { return jitterScaled >> 4; }
+    // The same, keeping the estimator's four fractional bits
+    double GetJitterExact() const { return jitterScaled / 16.0; }
+
+    // Fraction lost since the previous call, as the 8-bit fixed point value
+    // carried in receiver reports
+    uint8_t TakeFractionLost() {
+        uint32_t expected = GetExpected();
+        uint32_t expectedInterval = expected - expectedPrior;
+        uint32_t receivedInterval = received - receivedPrior;
+        expectedPrior = expected;
+        receivedPrior = received;
+
+        if (expectedInterval == 0 || receivedInterval >= expectedInterval) return 0;
+        return static_cast<uint8_t>(((expectedInterval - receivedInterval) << 8) / expectedInterval);
+    }
+
+private:
+    void Start(uint16_t sequence, uint32_t rtpTimestamp, uint32_t arrivalTime) {
+        Reset();
+        initialized = true;
+        maxSequence = sequence;
+        baseSequence = sequence;
+        received = 1;
+        lastTransit = static_cast<int32_t>(arrivalTime - rtpTimestamp);
+    }
+
+    bool initialized;
+    uint16_t maxSequence;
+    uint32_t cycles;          // wraps counted, shifted left 16
+    uint32_t baseSequence;
+    uint32_t received;
+    uint32_t expectedPrior;
+    uint32_t receivedPrior;
+    int32_t lastTransit;
+    uint32_t jitterScaled;    // jitter * 16
+};
+
+#endif // VOICEQWIK_RTP_SOURCE_STATS_H
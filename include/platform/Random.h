@@ -0,0 +1,13 @@
+#ifndef VOICEQWIK_RANDOM_H
+#define VOICEQWIK_RANDOM_H
+
+#include <cstddef>
+
+// Cryptographically secure random bytes from the OS (BCryptGenRandom,
+// getrandom); false if the source failed, in which case nothing is usable
+bool FillRandomBytes(void* out, size_t length);
+
+// Zeroes memory the compiler must not optimize away (keys, secrets)
+void SecureZero(void* data, size_t length);
+
+#endif // VOICEQWIK_RANDOM_H
@@ -0,0 +1,46 @@
+#ifndef VOICEQWIK_SHARED_MEMORY_H
+#define VOICEQWIK_SHARED_MEMORY_H
+
+#include <cstddef>
+#include <string>
+
+// A named shared memory region mapped into this process: a POSIX shm object
+// ("/voiceqwik-<name>", owner-only) or a pagefile-backed file mapping
+// ("Local\voiceqwik-<name>", this session). Other processes map the same
+// region by name. Mapping and unmapping are the only system calls; reading
+// and writing the memory is plain loads and stores.
+class SharedMemory {
+public:
+    SharedMemory();
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    // New region of size bytes, zeroed. On POSIX one left behind under the
+    // name (a crashed writer) is replaced, and processes still mapping it
+    // keep theirs; Windows refuses while any process still maps it.
+    bool Create(const std::string& name, size_t size);
+
+    // Maps a region another process created, read-only
+    bool Open(const std::string& name);
+
+    // Unmaps; a created region's name goes away with it (POSIX), or with the
+    // last process mapping it (Windows)
+    void Close();
+
+    bool IsOpen() const { return data != nullptr; }
+    void* GetData() const { return data; }
+    size_t GetSize() const { return size; }
+
+private:
+    void* data;
+    size_t size;
+    bool owner;
+    std::string objectName;
+#ifdef _WIN32
+    void* mapping;   // HANDLE
+#endif
+};
+
+#endif // VOICEQWIK_SHARED_MEMORY_H
@@ -0,0 +1,125 @@
+#ifndef VOICEQWIK_SOCKET_H
+#define VOICEQWIK_SOCKET_H
+
+// Thin socket layer over Winsock and BSD sockets. Both expose the same calls
+// (socket, bind, sendto, recvfrom, ...); this covers the parts that differ:
+// the handle type, startup, closing, blocking mode, timeouts and error codes,
+// plus IPv4/IPv6 addresses and the local interfaces' addresses.
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+
+using SocketHandle = SOCKET;
+using SocketLength = int;
+constexpr SocketHandle INVALID_SOCKET_HANDLE = INVALID_SOCKET;
+#else
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+using SocketHandle = int;
+using SocketLength = socklen_t;
+constexpr SocketHandle INVALID_SOCKET_HANDLE = -1;
+#endif
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Winsock needs a startup before any socket call and a matching cleanup;
+// calls nest. Nothing to do on POSIX.
+bool SocketStartup();
+void SocketCleanup();
+
+void CloseSocket(SocketHandle socket);
+bool SetSocketBlocking(SocketHandle socket, bool blocking);
+
+// Send and receive timeouts for blocking calls
+bool SetSocketTimeouts(SocketHandle socket, int timeoutMs);
+
+bool SetSocketOption(SocketHandle socket, int level, int name, int value);
+
+// Error code of the last failed socket call on this thread
+int GetLastSocketError();
+bool IsWouldBlockError(int error);
+
+// For send(): a write to a connection the peer closed fails instead of
+// raising SIGPIPE
+#ifdef MSG_NOSIGNAL
+constexpr int SOCKET_SEND_FLAGS = MSG_NOSIGNAL;
+#else
+constexpr int SOCKET_SEND_FLAGS = 0;
+#endif
+
+// Waits up to timeoutMs for data (or a pending connection); false on timeout
+bool WaitSocketReadable(SocketHandle socket, int timeoutMs);
+
+// An IPv4 or IPv6 endpoint. IPv4-mapped IPv6 addresses, which a dual-stack
+// socket reports for IPv4 senders, are kept as plain IPv4 so both forms
+// compare equal; ForFamily turns them back for sending.
+struct SocketAddress {
+    sockaddr_storage storage{};
+    SocketLength length = 0;
+
+    // From an IP literal ("192.0.2.1", "2001:db8::1"); false if it is not one
+    static bool FromString(const std::string& ip, uint16_t port, SocketAddress& address);
+    static SocketAddress FromSockaddr(const sockaddr* address, SocketLength length);
+
+    bool IsValid() const { return length > 0; }
+    int Family() const { return storage.ss_family; }
+    const sockaddr* Get() const { return reinterpret_cast<const sockaddr*>(&storage); }
+    uint16_t Port() const;
+    void SetPort(uint16_t port);
+
+    // The address bytes in network order: 4 for IPv4, 16 for IPv6
+    const uint8_t* AddressBytes() const;
+    size_t AddressSize() const;
+
+    // Address only, without the port
+    std::string ToString() const;
+    bool SameAddress(const SocketAddress& other) const;
+    bool operator==(const SocketAddress& other) const { return SameAddress(other) && Port() == other.Port(); }
+
+    // As a socket of socketFamily must be given it: IPv4 addresses become
+    // IPv4-mapped for a dual-stack AF_INET6 socket
+    SocketAddress ForFamily(int socketFamily) const;
+};
+
+// Opens a socket on the IPv6 wildcard that takes IPv4 too, falling back to
+// IPv4 only where the host has no IPv6, and binds it to port (0 = any) with
+// SO_REUSEADDR. family is what it got.
+SocketHandle OpenDualStackSocket(int type, int protocol, uint16_t port, int& family);
+
+// Connects a stream socket, giving up after timeoutMs (a plain connect to an
+// unreachable address can block for a minute). Leaves the socket blocking.
+bool ConnectSocket(SocketHandle socket, const SocketAddress& address, int timeoutMs);
+
+// "host", "host:port", "[v6]:port" or a bare IPv6 literal; the host must be
+// an IP literal. port is left alone when the input has none.
+bool ParseHostPort(const std::string& input, std::string& host, uint16_t& port);
+// host:port, with IPv6 hosts in brackets
+std::string FormatHostPort(const std::string& host, uint16_t port);
+
+// Kind of link, ordered by preference: wired beats other (virtual, unknown)
+// beats wireless
+enum class InterfaceKind : uint8_t {
+    Wireless = 0,
+    Other = 1,
+    Wired = 2
+};
+
+struct LocalInterfaceAddress {
+    std::string name;
+    SocketAddress address;   // port 0
+    InterfaceKind kind;
+};
+
+// Unicast addresses of the interfaces that are up, loopback and link-local
+// addresses left out (IP Helper on Windows, getifaddrs elsewhere)
+bool GetLocalInterfaceAddresses(std::vector<LocalInterfaceAddress>& addresses);
+
+#endif // VOICEQWIK_SOCKET_H
@@ -0,0 +1,51 @@
+#ifndef VOICEQWIK_THREAD_H
+#define VOICEQWIK_THREAD_H
+
+#include <cstdint>
+
+// Scheduling hints for the calling thread. Best effort: the bool-returning
+// calls report whether the OS granted the request, and a refusal leaves the
+// thread as it was.
+
+enum class ThreadPriority : uint8_t {
+    Background,     // below normal: file writers that must never take CPU from audio
+    Normal,
+    Network,        // above normal; SCHED_RR on Linux
+    Audio,          // MMCSS "Pro Audio" on Windows, SCHED_FIFO on Linux
+};
+
+// Name shown by debuggers, top and perf (Linux keeps the first 15 characters)
+void SetCurrentThreadName(const char* name);
+
+// Linux needs CAP_SYS_NICE or an RLIMIT_RTPRIO for Network and Audio
+bool SetCurrentThreadPriority(ThreadPriority priority);
+
+// Back to Normal, releasing an MMCSS registration
+void ResetCurrentThreadPriority();
+
+// Below normal priority, for background work (file writers) that must never
+// take CPU from the audio and network threads
+void SetCurrentThreadBackgroundPriority();
+
+// Pins the calling thread to one CPU
+bool SetCurrentThreadAffinity(uint32_t cpu);
+
+// Touches the next stack pages so the first deep call on a real-time thread
+// does not take page faults
+void PrefaultCurrentThreadStack();
+
+// OS thread id (Linux tid, Windows thread id)
+int64_t GetCurrentThreadOsId();
+
+// Total time the thread has spent runnable but waiting for a CPU, from
+// /proc schedstat. False where the OS does not report it (Windows).
+bool ReadThreadRunQueueNanos(int64_t osThreadId, uint64_t& nanos);
+
+// Keeps the process's pages resident: mlockall on Linux, a hard minimum
+// working set on Windows. Linux needs CAP_IPC_LOCK or an RLIMIT_MEMLOCK
+// covering the process; false if refused. With glibc it also keeps freed
+// and large blocks in the heap; the unlock (or a refusal) puts that back.
+bool LockProcessMemory();
+void UnlockProcessMemory();
+
+#endif // VOICEQWIK_THREAD_H
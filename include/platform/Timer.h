@@ -0,0 +1,17 @@
+#ifndef VOICEQWIK_TIMER_H
+#define VOICEQWIK_TIMER_H
+
+#include <cstdint>
+
+// Scheduler granularity. Windows sleeps and timed waits round up to the
+// 15.6 ms system tick unless a 1 ms resolution is requested; POSIX timers
+// are already fine-grained, so these are no-ops there. Requests nest.
+void AcquireTimerResolution();
+void ReleaseTimerResolution();
+
+void SleepMillis(uint32_t milliseconds);
+
+// Absolute deadline on the steady clock (microseconds since its epoch, as LatencyClockMicros)
+void SleepUntilMicros(int64_t deadlineMicros);
+
+#endif // VOICEQWIK_TIMER_H
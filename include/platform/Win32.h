@@ -0,0 +1,17 @@
+#ifndef VOICEQWIK_WIN32_H
+#define VOICEQWIK_WIN32_H
+
+// Windows SDK headers for the Windows-only modules (WASAPI engine, GUI,
+// entry point). winsock2.h must come before windows.h, so they include this
+// rather than windows.h directly.
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#include <windows.h>
+#include <mmsystem.h>
+
+#pragma comment(lib, "winmm.lib")
+
+#endif // VOICEQWIK_WIN32_H
@@ -11,21 +11,12 @@
 #include <thread>
 #include <condition_variable>
 
-// Windows headers
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <mmsystem.h>
-#include <audioclient.h>
-#include <windows.h>
-
-#pragma comment(lib, "ws2_32.lib")
-#pragma comment(lib, "winmm.lib")
-
-// Application constants
-constexpr uint16_t AUDIO_SAMPLE_RATE = 48000;
-constexpr uint16_t AUDIO_CHANNELS = 1;  // Mono for lower bandwidth
-constexpr uint16_t AUDIO_BITS_PER_SAMPLE = 16;
-constexpr uint32_t AUDIO_BUFFER_SIZE = 480;  // 10ms at 48kHz
+#include <audio/AudioFormat.h>
+
+// No OS headers here: sockets come from platform/Socket.h, and the
+// Windows-only modules include platform/Win32.h themselves
+
+// Application constants (audio format and packet time live in audio/AudioFormat.h)
 constexpr uint32_t RTP_PAYLOAD_TYPE = 111;  // Arbitrary for raw audio
 constexpr uint16_t DEFAULT_AUDIO_PORT = 5000;
 
@@ -35,16 +26,14 @@ constexpr int MIN_PARTICIPANTS = 2;
 
 // Network timeouts (ms)
 constexpr int CONNECTION_TIMEOUT = 5000;
-constexpr int PEER_TIMEOUT = 10000;
+constexpr int PEER_TIMEOUT = 30000;          // a peer whose control connection broke has this long to resume
+constexpr int RESUME_CONNECT_TIMEOUT = 300;  // per reconnect attempt, so a dead address is not waited on
+constexpr int RESUME_BACKOFF_MIN = 50;       // reconnect delay, doubling up to the max
+constexpr int RESUME_BACKOFF_MAX = 1000;
 
 // Typedefs
-using AudioBuffer = std::vector<int16_t>;
 using PeerID = uint32_t;
 
-// Logging macros
-#define LOG_INFO(msg) Logger::GetInstance().Log(LogLevel::INFO, msg)
-#define LOG_ERROR(msg) Logger::GetInstance().Log(LogLevel::ERROR, msg)
-#define LOG_DEBUG(msg) Logger::GetInstance().Log(LogLevel::DEBUG, msg)
-#define LOG_WARNING(msg) Logger::GetInstance().Log(LogLevel::WARNING, msg)
+// Logging macros live in utils/Logger.h
 
 #endif // VOICEQWIK_COMMON_H
@@ -5,11 +5,18 @@
 #undef ERROR
 #endif
 
+#include <utils/SpscRing.h>
 #include <string>
 #include <fstream>
-#include <sstream>
 #include <mutex>
-#include <chrono>
+#include <condition_variable>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 enum class LogLevel {
     DEBUG,
@@ -18,6 +25,55 @@ enum class LogLevel {
     ERROR
 };
 
+// Lowest level compiled in (0 = DEBUG ... 3 = ERROR). Calls below it expand to
+// nothing, arguments included. Debug builds keep everything, release builds
+// drop DEBUG unless VOICEQWIK_LOG_LEVEL is set explicitly.
+#ifndef VOICEQWIK_LOG_LEVEL
+#ifdef NDEBUG
+#define VOICEQWIK_LOG_LEVEL 1
+#else
+#define VOICEQWIK_LOG_LEVEL 0
+#endif
+#endif
+
+constexpr size_t LOG_MAX_ARGS = 4;
+constexpr size_t LOG_RECORD_TEXT_SIZE = 256;   // longer text is cut and marked "..."
+constexpr size_t LOG_RING_CAPACITY = 512;   // records per producing thread
+constexpr int LOG_FLUSH_INTERVAL_MS = 5;
+
+// Raw argument captured by LogFormat; strings are copied into the record text
+struct LogArg {
+    enum class Type : uint8_t { Signed, Unsigned, Double, String };
+
+    Type type;
+    union {
+        int64_t i;
+        uint64_t u;
+        double d;
+        struct { uint16_t offset; uint16_t length; } s;
+    };
+};
+
+// One fixed-size log entry. Either preformatted text (format == nullptr) or a
+// format string with {} placeholders plus raw arguments, formatted later by
+// the writer thread. The format string must outlive the record (use literals).
+struct LogRecord {
+    int64_t timestampNs;
+    const char* format;
+    LogArg args[LOG_MAX_ARGS];
+    uint32_t threadIndex;
+    LogLevel level;
+    uint8_t argCount;
+    bool truncated;            // text or a string argument did not fit
+    uint16_t textLength;
+    char text[LOG_RECORD_TEXT_SIZE];
+};
+
+// Asynchronous logger. Callers only fill a slot in their own thread's
+// lock-free ring; a background thread formats, batches and writes. After a
+// thread's first log call (which registers its ring) the caller side takes
+// no locks and does no I/O. When a ring is full the record is dropped and
+// counted rather than blocking the caller.
 class Logger {
 public:
     static Logger& GetInstance() {
@@ -25,20 +81,146 @@ public:
         return instance;
     }
 
+    // Preformatted message (cut at LOG_RECORD_TEXT_SIZE)
     void Log(LogLevel level, const std::string& message);
+    void Log(LogLevel level, const char* message);
+
+    // Deferred formatting: LogFormat(level, "send to {} failed: {}", id, err)
+    template <typename... Args>
+    void LogFormat(LogLevel level, const char* format, const Args&... args) {
+        static_assert(sizeof...(Args) <= LOG_MAX_ARGS, "Too many log arguments");
+        LogRecord* record = BeginRecord(level);
+        if (!record) return;
+        record->format = format;
+        (AppendArg(*record, args), ...);
+        CommitRecord();
+    }
+
+    // Sets up the calling thread's ring now rather than on its first log
+    // call, which allocates and waits for the writer; for threads with a deadline
+    void RegisterThread();
+
     void SetLogFile(const std::string& filename);
+    void SetConsoleOutput(bool enabled);
+
+    // Blocks until everything logged before the call has been written
+    void Flush();
+
+    // Records dropped because a producer ring was full
+    uint64_t GetDroppedCount() const;
+    // Records written cut short, text beyond LOG_RECORD_TEXT_SIZE
+    uint64_t GetTruncatedCount() const;
 
 private:
     Logger();
     ~Logger();
-    
+
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
+    using LogRing = SpscRing<LogRecord, LOG_RING_CAPACITY>;
+
+    struct ProducerRing {
+        LogRing ring;
+        uint32_t threadIndex = 0;
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> retired{false};
+    };
+
+    friend struct ProducerRingHandle;
+
+    static thread_local ProducerRing* threadRing;
+    static thread_local bool threadRingRetired;
+
+    // Producer rings, owned here; threads hold a thread_local pointer
+    std::vector<std::unique_ptr<ProducerRing>> rings;
+    mutable std::mutex ringsMutex;
+    uint32_t nextThreadIndex;
+    std::atomic<uint64_t> retiredDropped;
+
+    // Shared ring for threads whose own ring was already retired (logging from
+    // static destructors at exit); producers serialize on fallbackMutex
+    ProducerRing* fallbackRing;
+    std::mutex fallbackMutex;
+
+    // Writer thread state
+    std::thread writerThread;
+    std::atomic<bool> running;
+    std::mutex writerMutex;
+    std::condition_variable writerCV;
+    uint64_t flushRequested;
+    uint64_t flushCompleted;
+    uint64_t reportedDropped;
+    std::atomic<uint64_t> truncatedCount;
+
     std::ofstream logFile;
-    std::mutex logMutex;
+    std::mutex fileMutex;
+    std::atomic<bool> consoleOutput;
+
+    LogRecord* BeginRecord(LogLevel level);
+    void CommitRecord();
+    ProducerRing* RegisterThreadRing();
+
+    void WriterThreadProc();
+    bool DrainRings(std::string& batch);
+    void WriteBatch(const std::string& batch);
+    void FormatRecord(const LogRecord& record, std::string& out) const;
 
     std::string LevelToString(LogLevel level) const;
+
+    static void AppendText(LogRecord& record, const char* text, size_t length, LogArg& arg);
+
+    template <typename T>
+    static void AppendArg(LogRecord& record, const T& value) {
+        LogArg& arg = record.args[record.argCount++];
+        if constexpr (std::is_same<T, bool>::value) {
+            AppendText(record, value ? "true" : "false", value ? 4 : 5, arg);
+        } else if constexpr (std::is_enum<T>::value) {
+            arg.type = LogArg::Type::Signed;
+            arg.i = static_cast<int64_t>(value);
+        } else if constexpr (std::is_integral<T>::value && std::is_signed<T>::value) {
+            arg.type = LogArg::Type::Signed;
+            arg.i = value;
+        } else if constexpr (std::is_integral<T>::value) {
+            arg.type = LogArg::Type::Unsigned;
+            arg.u = value;
+        } else if constexpr (std::is_floating_point<T>::value) {
+            arg.type = LogArg::Type::Double;
+            arg.d = value;
+        } else if constexpr (std::is_same<T, std::string>::value) {
+            AppendText(record, value.data(), value.size(), arg);
+        } else {
+            const char* text = value;
+            AppendText(record, text, std::strlen(text), arg);
+        }
+    }
 };
 
+#if VOICEQWIK_LOG_LEVEL <= 0
+#define LOG_DEBUG(msg) Logger::GetInstance().Log(LogLevel::DEBUG, msg)
+#define LOG_DEBUG_FMT(...) Logger::GetInstance().LogFormat(LogLevel::DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(msg) ((void)0)
+#define LOG_DEBUG_FMT(...) ((void)0)
+#endif
+
+#if VOICEQWIK_LOG_LEVEL <= 1
+#define LOG_INFO(msg) Logger::GetInstance().Log(LogLevel::INFO, msg)
+#define LOG_INFO_FMT(...) Logger::GetInstance().LogFormat(LogLevel::INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(msg) ((void)0)
+#define LOG_INFO_FMT(...) ((void)0)
+#endif
+
+#if VOICEQWIK_LOG_LEVEL <= 2
+#define LOG_WARNING(msg) Logger::GetInstance().Log(LogLevel::WARNING, msg)
+#define LOG_WARNING_FMT(...) Logger::GetInstance().LogFormat(LogLevel::WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(msg) ((void)0)
+#define LOG_WARNING_FMT(...) ((void)0)
+#endif
+
+#define LOG_ERROR(msg) Logger::GetInstance().Log(LogLevel::ERROR, msg)
+#define LOG_ERROR_FMT(...) Logger::GetInstance().LogFormat(LogLevel::ERROR, __VA_ARGS__)
+
 #endif // VOICEQWIK_LOGGER_H
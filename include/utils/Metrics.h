@@ -0,0 +1,276 @@
+#ifndef VOICEQWIK_METRICS_H
+#define VOICEQWIK_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Call metrics for production monitoring. Every update is a relaxed atomic
+// add/store on preallocated storage, so hot paths (capture, render, send,
+// receive) can record without locks or allocation. Readers take snapshots at
+// their own pace; values are individually consistent, not as a set.
+
+constexpr size_t METRICS_MAX_PEERS = 256;
+constexpr int METRICS_EXPORT_INTERVAL_MS = 1000;
+
+// Histograms: log-linear buckets, HISTOGRAM_SUB_BUCKETS per power of two, so
+// every recorded value lands in a bucket at most 1/16 (6%) wide relative to it
+constexpr uint32_t HISTOGRAM_SUB_BUCKET_BITS = 4;
+constexpr uint32_t HISTOGRAM_SUB_BUCKETS = 1u << HISTOGRAM_SUB_BUCKET_BITS;
+constexpr uint32_t HISTOGRAM_VALUE_BITS = 36;  // values clamp at ~68 s in ns
+constexpr uint64_t HISTOGRAM_MAX_VALUE = (1ull << HISTOGRAM_VALUE_BITS) - 1;
+constexpr size_t HISTOGRAM_BUCKETS =
+    (HISTOGRAM_VALUE_BITS - HISTOGRAM_SUB_BUCKET_BITS + 1) * HISTOGRAM_SUB_BUCKETS;
+
+class MetricCounter {
+public:
+    void Add(uint64_t n = 1) {
+        value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    uint64_t Get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    void Reset() {
+        value.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> value{0};
+};
+
+class MetricGauge {
+public:
+    void Set(int64_t v) {
+        value.store(v, std::memory_order_relaxed);
+    }
+
+    int64_t Get() const {
+        return value.load(std::memory_order_relaxed);
+    }
+
+    void Reset() {
+        value.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<int64_t> value{0};
+};
+
+// Point-in-time copy of a histogram for percentile queries
+struct HistogramSnapshot {
+    std::array<uint64_t, HISTOGRAM_BUCKETS> counts;
+    uint64_t count;
+    uint64_t sum;
+    uint64_t max;
+
+    // Representative value (bucket midpoint) at percentile p in [0, 100]
+    uint64_t ValueAtPercentile(double p) const;
+    double Mean() const;
+};
+
+class MetricHistogram {
+public:
+    void Record(uint64_t value) {
+        if (value > HISTOGRAM_MAX_VALUE) value = HISTOGRAM_MAX_VALUE;
+        buckets[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+
+        uint64_t current = max.load(std::memory_order_relaxed);
+        while (value > current &&
+               !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    void Snapshot(HistogramSnapshot& out) const;
+    void Reset();
+
+    static size_t BucketIndex(uint64_t value) {
+        if (value < HISTOGRAM_SUB_BUCKETS) return (size_t)value;
+        uint32_t msb = 63 - CountLeadingZeros(value);
+        uint32_t shift = msb - HISTOGRAM_SUB_BUCKET_BITS;
+        return (size_t)(shift + 1) * HISTOGRAM_SUB_BUCKETS +
+               (size_t)((value >> shift) - HISTOGRAM_SUB_BUCKETS);
+    }
+
+    // Smallest value that falls into bucket index, and the bucket's width
+    static uint64_t BucketLowerBound(size_t index);
+    static uint64_t BucketWidth(size_t index);
+
+private:
+    static uint32_t CountLeadingZeros(uint64_t value);
+
+    std::array<std::atomic<uint64_t>, HISTOGRAM_BUCKETS> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+};
+
+// Processing stages timed by MetricStageTimer (nanoseconds)
+enum class MetricStage : uint8_t {
+    Capture,
+    Send,
+    Receive,
+    Mix,
+    Render,
+    Record,
+    EchoCancel,
+    NoiseSuppress,
+    Count
+};
+
+const char* MetricStageToString(MetricStage stage);
+
+// Long-running threads whose scheduling is tracked (see ThreadRuntime)
+enum class MetricThread : uint8_t {
+    Capture,
+    Render,
+    DeviceClock,    // software audio devices: one thread for both directions
+    Receive,
+    Accept,
+    Control,        // control connections: heartbeats and session resume
+    Count
+};
+
+const char* MetricThreadToString(MetricThread thread);
+
+struct ThreadMetrics {
+    MetricHistogram wakeLatencyMicros;  // woke this long after the device needed it
+    MetricGauge runQueueMicros;         // total time runnable but not running (Linux)
+    MetricGauge realtime;               // 1 while real-time scheduling is granted
+    MetricGauge cpu;                    // pinned CPU, -1 = any
+    MetricGauge running;                // 1 while the thread exists
+
+    void Reset();
+};
+
+// Per-peer call statistics. Send counters are updated by the sending thread,
+// receive-side ones by the receiver thread.
+struct PeerMetrics {
+    std::atomic<uint32_t> peerId{0};   // 0 = free slot
+    std::atomic<uint32_t> ssrc{0};     // remote SSRC, once seen
+
+    MetricCounter packetsSent;
+    MetricCounter bytesSent;
+    MetricCounter packetsReceived;
+    MetricCounter bytesReceived;
+    MetricCounter packetsReordered;
+    MetricCounter packetsDuplicated;
+    MetricCounter lateDrops;           // arrived after their slot was played
+    MetricCounter packetsRecovered;    // lost, then filled in from a later packet's redundancy
+    MetricCounter rateDecisions;       // send rate controller changes
+    MetricCounter authFailures;        // encrypted peer's packets that failed authentication
+    MetricCounter replayDrops;         // encrypted peer's packets already received, or too old
+    MetricCounter pathSwitches;        // changes of the media path we send this peer on
+    MetricCounter sessionResumes;      // control connection lost and the session resumed
+
+    MetricGauge packetsLost;           // RFC 3550 cumulative loss (can go down)
+    MetricGauge jitterMicros;          // RFC 3550 interarrival jitter
+    MetricGauge jitterBufferDepth;     // packets waiting for playout
+    MetricGauge rttMicros;             // RTCP LSR/DLSR round trip
+    MetricGauge remoteLossPermille;    // peer's RTCP fraction lost for our stream
+    MetricGauge sendBitrate;           // rate controller's current wire bitrate (bits/s)
+    MetricGauge loudnessGainCentibels; // mixer's loudness normalization gain for this peer (0.1 dB)
+    MetricGauge pathRttMicros;         // connectivity check round trip on the selected path
+    MetricGauge firstAudioMicros;      // joined to the first audio received from it (0 until then)
+    MetricGauge mediaSecurity;         // 0 in the clear, 1 encrypted but unauthenticated, 2 under the room secret
+
+    MetricHistogram interarrivalMicros;
+    MetricHistogram resumeTimeToAudioMicros;  // session resumed to the peer's first audio after it
+
+    // Latency measurement mode: audio from this peer, split by component
+    MetricHistogram captureDelayMicros;       // peer's mic to peer's socket
+    MetricHistogram networkDelayMicros;       // peer's socket to ours (clock-offset corrected)
+    MetricHistogram jitterBufferDelayMicros;  // arrival to playout
+    MetricGauge clockOffsetMicros;            // peer clock minus ours
+    MetricGauge clockRoundTripMicros;
+
+    void Reset();
+};
+
+class MetricsRegistry {
+public:
+    static MetricsRegistry& GetInstance();
+
+    // Claims a slot for a peer. PeerNetwork does this once per peer, under its
+    // peer list lock and before the peer is published, so a peer never gets
+    // two; the send, receive and control paths only look theirs up with
+    // FindPeer. nullptr if all slots are taken.
+    PeerMetrics* AcquirePeer(uint32_t peerId);
+    PeerMetrics* FindPeer(uint32_t peerId);
+    void ReleasePeer(uint32_t peerId);
+
+    MetricHistogram& GetStageHistogram(MetricStage stage) {
+        return stages[(size_t)stage];
+    }
+
+    ThreadMetrics& GetThreadMetrics(MetricThread thread) {
+        return threads[(size_t)thread];
+    }
+
+    // Process-wide counters
+    MetricCounter playbackUnderruns;   // playback queue ran short of what the device needed
+    MetricCounter playbackUnderrunFrames;   // silence those gaps lasted, counted as audio resumes
+    MetricCounter renderStarvations;   // device buffer ran dry before a write (late render wake)
+    MetricCounter captureOverruns;     // captured packets discarded unsent
+    MetricCounter recorderDrops;       // packets the call recorder had no room for
+    MetricGauge playbackQueueDepth;
+    MetricHistogram renderDelayMicros;        // mixed to audible: queue wait + device buffer
+    MetricHistogram deviceRoundTripMicros;    // latency marker written to playback until captured
+    MetricGauge echoErleCentiDb;       // echo return loss enhancement, 1/100 dB
+    MetricGauge echoDelayMicros;       // echo canceller's render-to-capture delay, -1 until found
+    MetricGauge noiseLevelCentiDb;     // noise suppressor's noise floor estimate, 1/100 dBFS
+    MetricGauge captureGainCentiDb;    // capture AGC gain, 1/100 dB
+    MetricGauge memoryLocked;          // 1 while the process's pages are locked for a call
+
+    // Prometheus text exposition format (version 0.0.4)
+    void FormatPrometheus(std::string& out) const;
+
+    // Writes atomically (temp file + rename) for a textfile collector
+    bool WritePrometheusFile(const std::string& filename) const;
+
+    // One-line summary for the GUI
+    std::string FormatStatsLine() const;
+
+    // Per-peer mouth-to-ear breakdown (medians), one line per peer
+    std::string FormatLatencyReport() const;
+
+private:
+    MetricsRegistry() = default;
+
+    MetricsRegistry(const MetricsRegistry&) = delete;
+    MetricsRegistry& operator=(const MetricsRegistry&) = delete;
+
+    std::array<PeerMetrics, METRICS_MAX_PEERS> peers;
+    std::atomic<size_t> peerHighWater{0};    // slots [0, peerHighWater) ever used
+    std::array<MetricHistogram, (size_t)MetricStage::Count> stages;
+    std::array<ThreadMetrics, (size_t)MetricThread::Count> threads;
+};
+
+// Records the lifetime of the scope into a stage histogram
+class MetricStageTimer {
+public:
+    explicit MetricStageTimer(MetricStage stage)
+        : histogram(MetricsRegistry::GetInstance().GetStageHistogram(stage)),
+          start(std::chrono::steady_clock::now()) {
+    }
+
+    ~MetricStageTimer() {
+        histogram.Record((uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+
+    MetricStageTimer(const MetricStageTimer&) = delete;
+    MetricStageTimer& operator=(const MetricStageTimer&) = delete;
+
+private:
+    MetricHistogram& histogram;
+    std::chrono::steady_clock::time_point start;
+};
+
+#endif // VOICEQWIK_METRICS_H
@@ -0,0 +1,101 @@
+#ifndef VOICEQWIK_REALTIME_CHECK_H
+#define VOICEQWIK_REALTIME_CHECK_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+// Real-time safety checker for debug builds. Built in only when
+// VOICEQWIK_RT_CHECK is defined to 1 (CMake option VOICEQWIK_ENABLE_RT_CHECK);
+// otherwise the RT_* macros expand to nothing and nothing is intercepted.
+//
+// Code inside RT_SCOPE has an audio deadline. While a thread is inside one,
+// allocating or freeing memory, locking a mutex and making a blocking call
+// are violations: each is counted, and the first time a distinct call stack
+// commits one it is printed to stderr with a stack trace. RT_ALLOW marks a
+// known, deliberate exception for the rest of its scope.
+//
+// What is intercepted: operator new/delete on every platform; on Linux with
+// glibc also the malloc family, pthread_mutex_lock and blocking calls
+// (sleeps, poll/select, file open/read/write/fsync), by symbol interposition;
+// on Windows debug CRTs, malloc/free through the CRT allocation hook.
+
+constexpr uint32_t RT_CHECK_MAX_REPORTS = 32;     // distinct stacks printed
+constexpr int RT_CHECK_STACK_DEPTH = 24;
+
+enum class RealtimeViolation : uint8_t {
+    Allocation,
+    Deallocation,
+    MutexLock,
+    BlockingCall,
+    Count
+};
+
+const char* RealtimeViolationToString(RealtimeViolation violation);
+
+class RealtimeCheck {
+public:
+    // Inside an RT_SCOPE and not inside an RT_ALLOW
+    static bool IsActive() {
+        return realtimeDepth > 0 && allowDepth == 0;
+    }
+
+    static void Enter() { realtimeDepth++; }
+    static void Leave() { realtimeDepth--; }
+    static void Allow() { allowDepth++; }
+    static void Disallow() { allowDepth--; }
+
+    // Counts and (once per distinct stack) prints a violation if active
+    static void Check(RealtimeViolation violation, const char* call) {
+        if (IsActive()) Report(violation, call);
+    }
+
+    static uint64_t GetViolationCount();
+    static uint64_t GetViolationCount(RealtimeViolation violation);
+
+    // "allocation 3, mutex lock 1" style totals
+    static void PrintSummary(FILE* out);
+
+private:
+    static void Report(RealtimeViolation violation, const char* call);
+
+    static inline thread_local int realtimeDepth = 0;
+    static inline thread_local int allowDepth = 0;
+    static inline std::atomic<uint64_t> counts[(size_t)RealtimeViolation::Count]{};
+};
+
+// Marks the calling thread real-time for the scope
+class RealtimeScope {
+public:
+    RealtimeScope() { RealtimeCheck::Enter(); }
+    ~RealtimeScope() { RealtimeCheck::Leave(); }
+
+    RealtimeScope(const RealtimeScope&) = delete;
+    RealtimeScope& operator=(const RealtimeScope&) = delete;
+};
+
+// Suspends checking for the scope
+class RealtimeAllowScope {
+public:
+    RealtimeAllowScope() { RealtimeCheck::Allow(); }
+    ~RealtimeAllowScope() { RealtimeCheck::Disallow(); }
+
+    RealtimeAllowScope(const RealtimeAllowScope&) = delete;
+    RealtimeAllowScope& operator=(const RealtimeAllowScope&) = delete;
+};
+
+#define VQ_RT_CONCAT_INNER(a, b) a##b
+#define VQ_RT_CONCAT(a, b) VQ_RT_CONCAT_INNER(a, b)
+
+#if defined(VOICEQWIK_RT_CHECK) && VOICEQWIK_RT_CHECK
+#define RT_SCOPE() RealtimeScope VQ_RT_CONCAT(realtimeScope_, __LINE__)
+// reason: a string literal saying why the exception is acceptable
+#define RT_ALLOW(reason) RealtimeAllowScope VQ_RT_CONCAT(realtimeAllow_, __LINE__)
+#define RT_CHECK_BLOCKING(call) RealtimeCheck::Check(RealtimeViolation::BlockingCall, call)
+#else
+#define RT_SCOPE() ((void)0)
+#define RT_ALLOW(reason) ((void)0)
+#define RT_CHECK_BLOCKING(call) ((void)0)
+#endif
+
+#endif // VOICEQWIK_REALTIME_CHECK_H
@@ -0,0 +1,90 @@
+#ifndef VOICEQWIK_SPSC_RING_H
+#define VOICEQWIK_SPSC_RING_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+// Bounded single-producer/single-consumer ring. Push and pop are wait-free:
+// one relaxed load, at most one acquire load and one release store each.
+// Slots are reused in place, so producers can fill a slot directly via
+// BeginPush()/EndPush() instead of copying a finished element in.
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0,
+                  "SpscRing capacity must be a power of two");
+
+public:
+    SpscRing() : head(0), tail(0), cachedHead(0), cachedTail(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer: slot to fill, or nullptr if the ring is full
+    T* BeginPush() {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead >= Capacity) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead >= Capacity) {
+                return nullptr;
+            }
+        }
+        return &slots[t & (Capacity - 1)];
+    }
+
+    // Producer: publish the slot returned by BeginPush()
+    void EndPush() {
+        tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool TryPush(const T& value) {
+        T* slot = BeginPush();
+        if (!slot) return false;
+        *slot = value;
+        EndPush();
+        return true;
+    }
+
+    // Consumer: oldest element, or nullptr if the ring is empty
+    T* Front() {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) {
+                return nullptr;
+            }
+        }
+        return &slots[h & (Capacity - 1)];
+    }
+
+    // Consumer: release the element returned by Front(); only after a Front()
+    // that returned one, since it is Front() that refreshes the view of tail
+    void Pop() {
+        head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    bool TryPop(T& value) {
+        T* slot = Front();
+        if (!slot) return false;
+        value = *slot;
+        Pop();
+        return true;
+    }
+
+    // Approximate when called concurrently with push/pop
+    size_t Size() const {
+        return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire);
+    }
+
+    static constexpr size_t GetCapacity() { return Capacity; }
+
+private:
+    // Producer and consumer indices live on separate cache lines
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    alignas(64) size_t cachedHead;   // producer's last view of head
+    alignas(64) size_t cachedTail;   // consumer's last view of tail
+    alignas(64) std::array<T, Capacity> slots;
+};
+
+#endif // VOICEQWIK_SPSC_RING_H
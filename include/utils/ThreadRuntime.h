@@ -0,0 +1,85 @@
+#ifndef VOICEQWIK_THREAD_RUNTIME_H
+#define VOICEQWIK_THREAD_RUNTIME_H
+
+#include <platform/Thread.h>
+#include <utils/Metrics.h>
+#include <array>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+// Leave a CPU unpinned
+constexpr int THREAD_CPU_ANY = -1;
+
+struct ThreadRuntimeConfig {
+    bool realtime = true;           // audio and network threads ask for real-time scheduling
+    bool lockMemory = false;        // lock the process's pages for the duration of a call
+    int audioCpu = THREAD_CPU_ANY;  // device threads
+    int networkCpu = THREAD_CPU_ANY;
+};
+
+// Scheduling for the long-running threads: each registers on entry (named,
+// prioritized and pinned from the config, stack prefaulted) and its wake-up
+// latency and run-queue time land in MetricsRegistry's ThreadMetrics.
+// Refusals are logged once per thread and the thread runs on at its
+// previous priority.
+class ThreadRuntime {
+public:
+    static ThreadRuntime& GetInstance();
+
+    // Takes effect for threads registering afterwards
+    void Configure(const ThreadRuntimeConfig& config);
+    ThreadRuntimeConfig GetConfig() const;
+
+    // Calling thread. Normal priority ignores the realtime switch.
+    void EnterThread(MetricThread thread, ThreadPriority priority);
+    void LeaveThread(MetricThread thread);
+
+    // How late a device thread woke for its deadline (microseconds, clamped at zero)
+    static void RecordWakeLatency(MetricThread thread, int64_t lateMicros) {
+        MetricsRegistry::GetInstance().GetThreadMetrics(thread).wakeLatencyMicros.Record(
+            lateMicros > 0 ? (uint64_t)lateMicros : 0);
+    }
+
+    // Call start and end: lock and prefault memory when configured
+    void BeginCall();
+    void EndCall();
+
+    // Refreshes run-queue times from the OS; call at metrics export
+    void PublishSchedulingStats();
+
+    // One line per running thread: priority, wake latency percentiles, run-queue time
+    std::string FormatSchedulingReport() const;
+
+private:
+    ThreadRuntime();
+
+    ThreadRuntime(const ThreadRuntime&) = delete;
+    ThreadRuntime& operator=(const ThreadRuntime&) = delete;
+
+    mutable std::mutex configMutex;
+    ThreadRuntimeConfig config;
+    bool memoryLocked;
+
+    std::array<std::atomic<int64_t>, (size_t)MetricThread::Count> osThreadIds;  // 0 = not running
+};
+
+// Registers the current thread for the scope's lifetime
+class ThreadRuntimeScope {
+public:
+    ThreadRuntimeScope(MetricThread thread, ThreadPriority priority) : thread(thread) {
+        ThreadRuntime::GetInstance().EnterThread(thread, priority);
+    }
+
+    ~ThreadRuntimeScope() {
+        ThreadRuntime::GetInstance().LeaveThread(thread);
+    }
+
+    ThreadRuntimeScope(const ThreadRuntimeScope&) = delete;
+    ThreadRuntimeScope& operator=(const ThreadRuntimeScope&) = delete;
+
+private:
+    MetricThread thread;
+};
+
+#endif // VOICEQWIK_THREAD_RUNTIME_H
@@ -0,0 +1,205 @@
+#ifndef VOICEQWIK_TRACE_H
+#define VOICEQWIK_TRACE_H
+
+#include <utils/SpscRing.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86)
+#include <intrin.h>
+#define VQ_TRACE_HAS_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define VQ_TRACE_HAS_TSC 1
+#else
+#define VQ_TRACE_HAS_TSC 0
+#endif
+
+// Hot-path tracing. Built in only when VOICEQWIK_TRACE is defined to 1 (CMake
+// option VOICEQWIK_ENABLE_TRACE); otherwise every TRACE_* macro expands to
+// nothing. When built in, recording is switched on at runtime with
+// Tracer::Start(); while stopped each macro costs one relaxed load.
+//
+// Each thread writes fixed-size events into its own lock-free ring. A
+// collector thread drains the rings into a bounded history (the most recent
+// TRACE_HISTORY_EVENTS events), which DumpChromeTrace() writes as Chrome
+// trace JSON for chrome://tracing or ui.perfetto.dev.
+
+constexpr size_t TRACE_RING_CAPACITY = 4096;   // events per thread between drains
+constexpr size_t TRACE_HISTORY_EVENTS = 131072;
+constexpr int TRACE_COLLECT_INTERVAL_MS = 10;
+
+// Event timestamps: TSC where available (a few ns to read), steady clock otherwise
+inline uint64_t TraceTicks() {
+#if VQ_TRACE_HAS_TSC
+    return __rdtsc();
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct TraceEvent {
+    uint64_t start;       // ticks
+    uint64_t duration;    // ticks; spans only
+    const char* name;     // must be a string literal
+    int64_t value;        // span/instant argument or counter value
+    char phase;           // 'X' span, 'i' instant, 'C' counter
+};
+
+class Tracer {
+public:
+    static Tracer& GetInstance();
+
+    // Begin/end recording; Start clears the previous history
+    void Start();
+    void Stop();
+
+    static bool IsRecording() {
+        return recording.load(std::memory_order_relaxed);
+    }
+
+    // Hot-path entry points (use the TRACE_* macros)
+    static void Span(const char* name, uint64_t start, uint64_t end, int64_t value) {
+        Push(TraceEvent{start, end - start, name, value, 'X'});
+    }
+
+    static void Instant(const char* name, int64_t value) {
+        Push(TraceEvent{TraceTicks(), 0, name, value, 'i'});
+    }
+
+    static void Counter(const char* name, int64_t value) {
+        Push(TraceEvent{TraceTicks(), 0, name, value, 'C'});
+    }
+
+    // Label the calling thread in the exported trace
+    static void SetThreadName(const char* name);
+
+    // Move everything the rings hold into the history now
+    void Collect();
+
+    // Write the current history as Chrome trace JSON
+    bool DumpChromeTrace(const std::string& filename);
+
+    // Events lost because a thread's ring filled between collections
+    uint64_t GetDroppedCount() const;
+
+private:
+    Tracer();
+    ~Tracer();
+
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    struct ThreadBuffer {
+        SpscRing<TraceEvent, TRACE_RING_CAPACITY> ring;
+        uint32_t threadIndex = 0;
+        std::string threadName;
+        std::atomic<uint64_t> dropped{0};
+        std::atomic<bool> retired{false};
+    };
+
+    struct CollectedEvent {
+        TraceEvent event;
+        uint32_t threadIndex;
+    };
+
+    friend struct TraceThreadHandle;
+
+    // Inline with constant initializers so hot-path access needs no TLS wrapper
+    static inline std::atomic<bool> recording{false};
+    static inline thread_local ThreadBuffer* threadBuffer = nullptr;
+    static inline thread_local bool threadBufferRetired = false;
+
+    static ThreadBuffer* RegisterThreadBuffer();
+
+    static void Push(const TraceEvent& event) {
+        ThreadBuffer* buffer = threadBuffer;
+        if (!buffer) {
+            buffer = RegisterThreadBuffer();
+            if (!buffer) return;
+        }
+
+        TraceEvent* slot = buffer->ring.BeginPush();
+        if (!slot) {
+            buffer->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        *slot = event;
+        buffer->ring.EndPush();
+    }
+
+    std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+    std::vector<std::pair<uint32_t, std::string>> retiredThreadNames;
+    mutable std::mutex buffersMutex;
+    uint32_t nextThreadIndex;
+    uint64_t retiredDropped;
+
+    // Circular history of collected events
+    std::vector<CollectedEvent> history;
+    size_t historyNext;
+    bool historyWrapped;
+
+    // Tick calibration, taken at Start() and refreshed on dump
+    uint64_t startTicks;
+    std::chrono::steady_clock::time_point startTime;
+
+    std::thread collectorThread;
+    std::atomic<bool> collecting;
+    std::mutex collectorMutex;
+    std::condition_variable collectorCV;
+
+    void CollectorThreadProc();
+    void CollectLocked();
+};
+
+// Records a span from construction to destruction
+class TraceScope {
+public:
+    explicit TraceScope(const char* name, int64_t value = 0)
+        : name(Tracer::IsRecording() ? name : nullptr), value(value),
+          start(this->name ? TraceTicks() : 0) {
+    }
+
+    ~TraceScope() {
+        if (name) {
+            Tracer::Span(name, start, TraceTicks(), value);
+        }
+    }
+
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* name;
+    int64_t value;
+    uint64_t start;
+};
+
+#define VQ_TRACE_CONCAT_INNER(a, b) a##b
+#define VQ_TRACE_CONCAT(a, b) VQ_TRACE_CONCAT_INNER(a, b)
+
+#if defined(VOICEQWIK_TRACE) && VOICEQWIK_TRACE
+#define TRACE_SCOPE(name) TraceScope VQ_TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_SCOPE_VALUE(name, value) TraceScope VQ_TRACE_CONCAT(traceScope_, __LINE__)(name, (int64_t)(value))
+#define TRACE_INSTANT(name, value) \
+    do { if (Tracer::IsRecording()) Tracer::Instant(name, (int64_t)(value)); } while (0)
+#define TRACE_COUNTER(name, value) \
+    do { if (Tracer::IsRecording()) Tracer::Counter(name, (int64_t)(value)); } while (0)
+#define TRACE_THREAD_NAME(name) Tracer::SetThreadName(name)
+#else
+#define TRACE_SCOPE(name) ((void)0)
+#define TRACE_SCOPE_VALUE(name, value) ((void)0)
+#define TRACE_INSTANT(name, value) ((void)0)
+#define TRACE_COUNTER(name, value) ((void)0)
+#define TRACE_THREAD_NAME(name) ((void)0)
+#endif
+
+#endif // VOICEQWIK_TRACE_H
@@ -0,0 +1,449 @@
+#include <audio/AudioEngine.h>
+#include <utils/Logger.h>
+#include <utils/Metrics.h>
+#include <utils/RealtimeCheck.h>
+#include <utils/Trace.h>
+#include <audio/FrameKernels.h>
+#include <networking/LatencyProbe.h>
+#include <algorithm>
+#include <cstring>
+
+// Captured audio older than this is dropped if nobody collects it
+constexpr uint32_t CAPTURE_QUEUE_LIMIT_US = 200000;
+static_assert(CAPTURE_RING_PACKETS >= CAPTURE_QUEUE_LIMIT_US / 2500, "Capture ring must hold the queue limit");
+
+// Room the capture accumulator keeps, so device callbacks never grow it
+// unless capture stalls for longer than this
+constexpr size_t CAPTURE_ACCUMULATOR_RESERVE = (size_t)AUDIO_SAMPLE_RATE * AUDIO_CHANNELS;
+
+// Device callbacks of 10 ms: the WASAPI shared-mode default, and short enough
+// for the 2.5 ms packet time to be cut from
+constexpr uint32_t AUDIO_DEVICE_PERIOD_FRAMES = AUDIO_SAMPLE_RATE / 100;
+
+// Silence filling a playback gap fades in from the last sample over 1 ms
+constexpr size_t RENDER_FADE_FRAMES = AUDIO_SAMPLE_RATE / 1000;
+
+// Echo cancellation and noise suppression both run on 10 ms capture blocks
+constexpr uint32_t CAPTURE_BLOCK_SAMPLES = AEC_BLOCK_FRAMES * AUDIO_CHANNELS;
+static_assert(AEC_BLOCK_FRAMES == NS_BLOCK_FRAMES, "Capture DSP stages share one block size");
+
+AudioEngine& AudioEngine::GetInstance() {
+    static AudioEngine instance;
+    return instance;
+}
+
+AudioEngine::AudioEngine()
+    : format{AUDIO_SAMPLE_RATE, AUDIO_CHANNELS, AUDIO_DEVICE_PERIOD_FRAMES}, capturing(false), playing(false),
+      packetTime(DEFAULT_PACKET_TIME), captureAccumulatorMicros(0), captureProcessed(0), playbackOffset(0),
+      playbackPrimed(false), playbackGap(false), playbackGapFrames(0), renderLast{}, latencyMarkers(false),
+      markerWrittenMicros(0), lastMarkerMicros(0),
+      echoCancellation(false), echoResetPending(true), noiseSuppression(false), noiseResetPending(true),
+      automaticGain(false), gainResetPending(true), captureGain(CAPTURE_GAIN_MIN_DB, CAPTURE_GAIN_MAX_DB) {
+    MetricsRegistry::GetInstance().echoDelayMicros.Set(-1);
+    MetricsRegistry::GetInstance().noiseLevelCentiDb.Set(-12000);
+}
+
+AudioEngine::~AudioEngine() {
+    Shutdown();
+}
+
+bool AudioEngine::Initialize(std::unique_ptr<AudioDevice> audioDevice) {
+    LOG_INFO("Initializing Audio Engine");
+
+    if (!audioDevice) {
+        LOG_ERROR("No audio device");
+        return false;
+    }
+
+    // A packet shorter than the period waits for the whole period to be captured
+    uint32_t periodFrames = std::min(AUDIO_DEVICE_PERIOD_FRAMES, FramesPerPacket(packetTime));
+    AudioDeviceFormat requested{AUDIO_SAMPLE_RATE, AUDIO_CHANNELS, periodFrames};
+    AudioDeviceFormat negotiated{};
+    if (!audioDevice->Open(requested, negotiated)) {
+        LOG_ERROR(std::string("Failed to open audio device: ") + audioDevice->GetName());
+        return false;
+    }
+
+    // Packets go on the wire as they are captured: no resampling or remixing
+    if (negotiated.sampleRate != AUDIO_SAMPLE_RATE || negotiated.channels != AUDIO_CHANNELS) {
+        LOG_ERROR_FMT("Audio device {} runs at {} Hz, {} ch; the wire format needs 48000 Hz mono",
+                      audioDevice->GetName(), negotiated.sampleRate, negotiated.channels);
+        audioDevice->Close();
+        return false;
+    }
+
+    device = std::move(audioDevice);
+    format = negotiated;
+    LOG_INFO_FMT("Audio Engine initialized with device {} ({}-frame period)", device->GetName(),
+                 format.periodFrames);
+    return true;
+}
+
+void AudioEngine::Shutdown() {
+    if (!device) return;
+    LOG_INFO("Shutting down Audio Engine");
+
+    StopCapture();
+    StopPlayback();
+    device->Close();
+    device.reset();
+}
+
+bool AudioEngine::StartCapture() {
+    if (capturing) return true;
+    if (!device) {
+        LOG_ERROR("Audio Engine not initialized");
+        return false;
+    }
+
+    captureAccumulator.clear();
+    captureAccumulator.reserve(CAPTURE_ACCUMULATOR_RESERVE);
+    captureProcessed = 0;
+    markerDetector.Reset();
+    echoResetPending = true;
+    noiseResetPending = true;
+    gainResetPending = true;
+    bool started = device->StartCapture([this](const int16_t* samples, uint32_t frames, int64_t captureMicros) {
+        OnCapture(samples, frames, captureMicros);
+    });
+    if (!started) {
+        LOG_ERROR("Failed to start capture");
+        return false;
+    }
+
+    capturing = true;
+    LOG_INFO("Capture started successfully");
+    return true;
+}
+
+void AudioEngine::StopCapture() {
+    if (!capturing) return;
+
+    device->StopCapture();
+    capturing = false;
+    LOG_INFO("Capture stopped");
+}
+
+bool AudioEngine::GetCaptureBuffer(AudioBuffer& buffer) {
+    int64_t captureMicros;
+    return GetCaptureBuffer(buffer, captureMicros);
+}
+
+bool AudioEngine::GetCaptureBuffer(AudioBuffer& buffer, int64_t& captureMicros) {
+    // Oldest first: nobody wants audio older than the limit. Each Pop needs
+    // its Front, which keeps the consumer's view of the tail current; a blind
+    // Pop can run past what the capture thread has published.
+    size_t queueLimit = CAPTURE_QUEUE_LIMIT_US / PacketTimeMicros(packetTime);
+    while (captureRing.Size() > queueLimit && captureRing.Front()) {
+        captureRing.Pop();
+        MetricsRegistry::GetInstance().captureOverruns.Add();
+    }
+
+    TimedPacket* packet = captureRing.Front();
+    if (!packet) {
+        return false;
+    }
+
+    buffer.assign(packet->samples.begin(), packet->samples.begin() + packet->count);
+    captureMicros = packet->micros;
+    captureRing.Pop();
+    return true;
+}
+
+void AudioEngine::DiscardCapture() {
+    while (captureRing.Front()) {
+        captureRing.Pop();
+    }
+}
+
+void AudioEngine::SetLatencyMarkers(bool enabled) {
+    if (latencyMarkers.exchange(enabled) != enabled) {
+        markerWrittenMicros = 0;
+        LOG_INFO(std::string("Latency markers ") + (enabled ? "enabled" : "disabled"));
+    }
+}
+
+void AudioEngine::SetEchoCancellation(bool enabled) {
+    if (echoCancellation.exchange(enabled) != enabled) {
+        // The capture thread owns the canceller; it starts over on its next callback
+        echoResetPending = true;
+        LOG_INFO(std::string("Echo cancellation ") + (enabled ? "enabled" : "disabled"));
+    }
+}
+
+void AudioEngine::SetNoiseSuppression(bool enabled) {
+    if (noiseSuppression.exchange(enabled) != enabled) {
+        noiseResetPending = true;
+        LOG_INFO(std::string("Noise suppression ") + (enabled ? "enabled" : "disabled"));
+    }
+}
+
+void AudioEngine::SetAutomaticGain(bool enabled) {
+    if (automaticGain.exchange(enabled) != enabled) {
+        gainResetPending = true;
+        LOG_INFO(std::string("Automatic gain control ") + (enabled ? "enabled" : "disabled"));
+    }
+}
+
+void AudioEngine::SetPacketTime(PacketTime ptime) {
+    if (packetTime.exchange(ptime) != ptime) {
+        LOG_INFO("Capture packet time set to: " + std::string(PacketTimeToString(ptime)));
+    }
+}
+
+PacketTime AudioEngine::GetPacketTime() const {
+    return packetTime;
+}
+
+bool AudioEngine::StartPlayback() {
+    if (playing) return true;
+    if (!device) {
+        LOG_ERROR("Audio Engine not initialized");
+        return false;
+    }
+
+    playbackOffset = 0;
+    playbackPrimed = false;
+    playbackGap = false;
+    playbackGapFrames = 0;
+    renderLast.fill(0);
+    bool started = device->StartRender([this](int16_t* samples, uint32_t minFrames, uint32_t maxFrames,
+                                              int64_t presentMicros) {
+        return OnRender(samples, minFrames, maxFrames, presentMicros);
+    });
+    if (!started) {
+        LOG_ERROR("Failed to start playback");
+        return false;
+    }
+
+    playing = true;
+    LOG_INFO("Playback started successfully");
+    return true;
+}
+
+void AudioEngine::StopPlayback() {
+    if (!playing) return;
+
+    device->StopRender();
+    playing = false;
+    LOG_INFO("Playback stopped");
+}
+
+bool AudioEngine::QueuePlaybackBuffer(const AudioBuffer& buffer) {
+    if (buffer.empty() || buffer.size() > MAX_SAMPLES_PER_PACKET) return false;
+
+    TimedPacket* packet = playbackRing.BeginPush();
+    if (!packet) {
+        return false;
+    }
+    std::memcpy(packet->samples.data(), buffer.data(), buffer.size() * sizeof(int16_t));
+    packet->count = (uint32_t)buffer.size();
+    packet->micros = LatencyClockMicros();
+    playbackRing.EndPush();
+    MetricsRegistry::GetInstance().playbackQueueDepth.Set((int64_t)playbackRing.Size());
+    return true;
+}
+
+void AudioEngine::OnCapture(const int16_t* samples, uint32_t frames, int64_t bufferMicros) {
+    RT_SCOPE();
+    TRACE_SCOPE_VALUE("capture", frames);
+    MetricStageTimer stageTimer(MetricStage::Capture);
+
+    if (captureAccumulator.empty()) {
+        captureAccumulatorMicros = bufferMicros;
+    }
+    size_t sampleCount = (size_t)frames * AUDIO_CHANNELS;
+    captureAccumulator.insert(captureAccumulator.end(), samples, samples + sampleCount);
+
+    if (latencyMarkers) {
+        uint64_t startFrame = markerDetector.GetFramesProcessed();
+        uint64_t onsetFrame = 0;
+        if (markerDetector.Process(samples, frames, onsetFrame)) {
+            int64_t onsetMicros = bufferMicros +
+                ((int64_t)onsetFrame - (int64_t)startFrame) * 1000000 / AUDIO_SAMPLE_RATE;
+            int64_t writtenMicros = markerWrittenMicros.exchange(0);
+            if (writtenMicros != 0 && onsetMicros >= writtenMicros) {
+                MetricsRegistry::GetInstance().deviceRoundTripMicros.Record(
+                    (uint64_t)(onsetMicros - writtenMicros));
+            }
+        }
+    }
+
+    // Capture DSP runs in whole blocks, echo cancellation first; packets are
+    // only cut from samples it has been through
+    if (echoResetPending.exchange(false)) {
+        echoCanceller.Reset();
+        MetricsRegistry::GetInstance().echoErleCentiDb.Set(0);
+        MetricsRegistry::GetInstance().echoDelayMicros.Set(-1);
+    }
+    if (noiseResetPending.exchange(false)) {
+        noiseSuppressor.Reset();
+        MetricsRegistry::GetInstance().noiseLevelCentiDb.Set(-12000);
+    }
+    if (gainResetPending.exchange(false)) {
+        captureGain.Reset();
+        MetricsRegistry::GetInstance().captureGainCentiDb.Set(0);
+    }
+    bool cancelEcho = echoCancellation;
+    bool suppressNoise = noiseSuppression;
+    bool controlGain = automaticGain;
+    if (cancelEcho || suppressNoise || controlGain) {
+        while (captureAccumulator.size() - captureProcessed >= CAPTURE_BLOCK_SAMPLES) {
+            int16_t* block = captureAccumulator.data() + captureProcessed;
+            if (cancelEcho) {
+                MetricStageTimer echoTimer(MetricStage::EchoCancel);
+                int64_t blockMicros = captureAccumulatorMicros +
+                    (int64_t)(captureProcessed / AUDIO_CHANNELS) * 1000000 / AUDIO_SAMPLE_RATE;
+                echoCanceller.ProcessBlock(block, blockMicros);
+            }
+            if (suppressNoise) {
+                MetricStageTimer noiseTimer(MetricStage::NoiseSuppress);
+                noiseSuppressor.ProcessBlock(block);
+            }
+            if (controlGain) {
+                // Gain from the level so far; this block's level counts from the next one
+                uint32_t energy = FrameKernels::ScaleLimit(block, captureGain.GetLinearGain(), CAPTURE_BLOCK_SAMPLES);
+                captureGain.Update(energy, CAPTURE_BLOCK_SAMPLES);
+            }
+            captureProcessed += CAPTURE_BLOCK_SAMPLES;
+        }
+        if (cancelEcho) {
+            MetricsRegistry::GetInstance().echoErleCentiDb.Set((int64_t)(echoCanceller.GetErleDb() * 100.0));
+            MetricsRegistry::GetInstance().echoDelayMicros.Set(echoCanceller.GetDelayMicros());
+        }
+        if (suppressNoise) {
+            MetricsRegistry::GetInstance().noiseLevelCentiDb.Set(
+                (int64_t)(noiseSuppressor.GetNoiseLevelDb() * 100.0));
+        }
+        if (controlGain) {
+            MetricsRegistry::GetInstance().captureGainCentiDb.Set((int64_t)(captureGain.GetGainDb() * 100.0f));
+        }
+    } else {
+        captureProcessed = captureAccumulator.size();
+    }
+    // The suppressor's overlap-add delays what it outputs by one hop
+    int64_t processingDelayMicros = suppressNoise ? NS_DELAY_MICROS : 0;
+
+    // Cut complete packets at the current packet time
+    PacketTime ptime = packetTime;
+    uint32_t packetSamples = SamplesPerPacket(ptime);
+    size_t consumed = 0;
+    while (captureProcessed - consumed >= packetSamples) {
+        int64_t packetMicros = captureAccumulatorMicros - processingDelayMicros +
+            (int64_t)(consumed / AUDIO_CHANNELS) * 1000000 / AUDIO_SAMPLE_RATE;
+
+        // The main loop trims to the queue limit; a full ring means it has stopped collecting
+        TimedPacket* packet = captureRing.BeginPush();
+        if (packet) {
+            std::memcpy(packet->samples.data(), captureAccumulator.data() + consumed,
+                        packetSamples * sizeof(int16_t));
+            packet->count = packetSamples;
+            packet->micros = packetMicros;
+            captureRing.EndPush();
+        } else {
+            MetricsRegistry::GetInstance().captureOverruns.Add();
+        }
+        consumed += packetSamples;
+        TRACE_COUNTER("capture_queue", captureRing.Size());
+    }
+    captureAccumulator.erase(captureAccumulator.begin(), captureAccumulator.begin() + consumed);
+    captureProcessed -= consumed;
+    captureAccumulatorMicros += (int64_t)(consumed / AUDIO_CHANNELS) * 1000000 / AUDIO_SAMPLE_RATE;
+}
+
+uint32_t AudioEngine::OnRender(int16_t* samples, uint32_t minFrames, uint32_t maxFrames, int64_t presentMicros) {
+    RT_SCOPE();
+    TRACE_SCOPE_VALUE("render", maxFrames);
+    MetricStageTimer stageTimer(MetricStage::Render);
+
+    // As much queued audio as the device has room for
+    size_t room = (size_t)maxFrames * AUDIO_CHANNELS;
+    size_t filled = 0;
+    while (filled < room) {
+        TimedPacket* front = playbackRing.Front();
+        if (!front) break;
+        if (playbackOffset == 0) {
+            // Heard once the device has played what is ahead of it
+            int64_t audibleMicros = presentMicros + (int64_t)(filled / AUDIO_CHANNELS) * 1000000 / AUDIO_SAMPLE_RATE;
+            if (audibleMicros >= front->micros) {
+                MetricsRegistry::GetInstance().renderDelayMicros.Record((uint64_t)(audibleMicros - front->micros));
+            }
+        }
+
+        size_t take = front->count - playbackOffset;
+        if (take > room - filled) take = room - filled;
+        std::memcpy(samples + filled, front->samples.data() + playbackOffset, take * sizeof(int16_t));
+        filled += take;
+        playbackOffset += take;
+        if (playbackOffset == front->count) {
+            playbackRing.Pop();
+            playbackOffset = 0;
+        }
+    }
+    MetricsRegistry::GetInstance().playbackQueueDepth.Set((int64_t)playbackRing.Size());
+
+    // Short of what the device needs to keep playing: the rest is silence,
+    // faded into from the last sample so the gap does not start with a click.
+    // Running dry mid-stream is an audible gap; silence before the first
+    // packet (or between calls) is not
+    size_t needed = (size_t)minFrames * AUDIO_CHANNELS;
+    size_t rendered = filled;
+    if (filled > 0 && playbackGap) {
+        // Audio is back: the silence since the queue ran dry was a gap in the stream
+        MetricsRegistry::GetInstance().playbackUnderrunFrames.Add(playbackGapFrames);
+        playbackGap = false;
+        playbackGapFrames = 0;
+    }
+    if (filled < needed) {
+        if (filled > 0) {
+            std::memcpy(renderLast.data(), samples + filled - AUDIO_CHANNELS, sizeof(renderLast));
+        }
+        size_t fadeFrames = (needed - filled) / AUDIO_CHANNELS;
+        if (fadeFrames > RENDER_FADE_FRAMES) fadeFrames = RENDER_FADE_FRAMES;
+        for (size_t i = 0; i < fadeFrames; i++) {
+            int32_t gain = (int32_t)(RENDER_FADE_FRAMES - 1 - i);
+            int16_t* frame = samples + filled + i * AUDIO_CHANNELS;
+            for (size_t c = 0; c < AUDIO_CHANNELS; c++) {
+                frame[c] = (int16_t)(renderLast[c] * gain / (int32_t)RENDER_FADE_FRAMES);
+            }
+        }
+        size_t faded = fadeFrames * AUDIO_CHANNELS;
+        std::memset(samples + filled + faded, 0, (needed - filled - faded) * sizeof(int16_t));
+
+        if (playbackPrimed || filled > 0) {
+            MetricsRegistry::GetInstance().playbackUnderruns.Add();
+            playbackGap = true;
+        }
+        if (playbackGap) playbackGapFrames += (needed - filled) / AUDIO_CHANNELS;
+        playbackPrimed = false;
+        rendered = needed;
+    } else if (filled > 0) {
+        playbackPrimed = true;
+    }
+    if (rendered > 0) {
+        std::memcpy(renderLast.data(), samples + rendered - AUDIO_CHANNELS, sizeof(renderLast));
+    }
+    uint32_t frames = (uint32_t)(rendered / AUDIO_CHANNELS);
+
+    if (latencyMarkers) {
+        // One burst outstanding at a time; forget it if capture never heard it
+        int64_t nowMicros = LatencyClockMicros();
+        int64_t written = markerWrittenMicros;
+        if (written != 0 && nowMicros - written > LATENCY_MARKER_TIMEOUT_MS * 1000) {
+            markerWrittenMicros.compare_exchange_strong(written, 0);
+        }
+        if (!markerGenerator.IsActive() && markerWrittenMicros == 0 &&
+            nowMicros - lastMarkerMicros >= LATENCY_MARKER_INTERVAL_MS * 1000) {
+            markerGenerator.Trigger();
+            lastMarkerMicros = nowMicros;
+            markerWrittenMicros = nowMicros;
+        }
+        markerGenerator.Mix(samples, frames);
+    }
+
+    // What is about to be heard, markers included, is the echo reference
+    if (echoCancellation) {
+        echoCanceller.AddReference(samples, frames, presentMicros);
+    }
+    return frames;
+}
@@ -0,0 +1,97 @@
+#include <audio/AudioMixer.h>
+#include <audio/FrameKernels.h>
+
+// A source not heard for this many mixes (5 s at 10 ms) has left; its level is forgotten
+constexpr uint64_t MIXER_SOURCE_IDLE_MIXES = 500;
+
+// Room tracked up front, so a new source normally does not allocate mid-mix
+constexpr size_t MIXER_RESERVED_SOURCES = 16;
+
+AudioMixer::AudioMixer()
+    : accumulator(MAX_SAMPLES_PER_PACKET, 0.0f), mixedSamples(0), sourceCount(0), masterGain(1.0f),
+      normalize(true), mixCount(0) {
+    sources.reserve(MIXER_RESERVED_SOURCES);
+}
+
+void AudioMixer::Begin() {
+    mixedSamples = 0;
+    sourceCount = 0;
+}
+
+void AudioMixer::AddSource(const int16_t* samples, uint32_t count) {
+    AddScaled(samples, count, 1.0f);
+}
+
+void AudioMixer::AddSource(const AudioBuffer& buffer) {
+    AddSource(buffer.data(), static_cast<uint32_t>(buffer.size()));
+}
+
+void AudioMixer::AddSource(uint32_t sourceId, const AudioBuffer& buffer) {
+    SourceLoudness& source = FindSource(sourceId);
+    source.lastMix = mixCount;
+    float gain = normalize ? source.gain.GetLinearGain() : 1.0f;
+    uint32_t count = static_cast<uint32_t>(buffer.size());
+    uint32_t energy = AddScaled(buffer.data(), count, gain);
+    source.gain.Update(energy, count < MAX_SAMPLES_PER_PACKET ? count : MAX_SAMPLES_PER_PACKET);
+}
+
+uint32_t AudioMixer::AddScaled(const int16_t* samples, uint32_t count, float gain) {
+    if (count > MAX_SAMPLES_PER_PACKET) {
+        count = MAX_SAMPLES_PER_PACKET;
+    }
+
+    // Only the tail beyond what earlier sources covered needs clearing
+    if (count > mixedSamples) {
+        FrameKernels::Clear(accumulator.data() + mixedSamples, count - mixedSamples);
+        mixedSamples = count;
+    }
+
+    sourceCount++;
+    return FrameKernels::AccumulateScaled(accumulator.data(), samples, gain, count);
+}
+
+bool AudioMixer::Finish(AudioBuffer& out) {
+    if (sourceCount == 0) {
+        return false;
+    }
+
+    out.resize(mixedSamples);
+    FrameKernels::ScaleLimit(out.data(), accumulator.data(), masterGain, mixedSamples);
+
+    mixCount++;
+    for (size_t i = 0; i < sources.size();) {
+        if (mixCount - sources[i].lastMix > MIXER_SOURCE_IDLE_MIXES) {
+            sources[i] = sources.back();
+            sources.pop_back();
+        } else {
+            i++;
+        }
+    }
+    return true;
+}
+
+uint32_t AudioMixer::GetSourceCount() const {
+    return sourceCount;
+}
+
+void AudioMixer::SetLoudnessNormalization(bool enabled) {
+    normalize = enabled;
+}
+
+bool AudioMixer::GetSourceGainDb(uint32_t sourceId, float& gainDb) const {
+    for (const auto& source : sources) {
+        if (source.sourceId == sourceId) {
+            gainDb = normalize ? source.gain.GetGainDb() : 0.0f;
+            return true;
+        }
+    }
+    return false;
+}
+
+AudioMixer::SourceLoudness& AudioMixer::FindSource(uint32_t sourceId) {
+    for (auto& source : sources) {
+        if (source.sourceId == sourceId) return source;
+    }
+    sources.push_back(SourceLoudness{sourceId, mixCount, GainControl(RECEIVE_GAIN_MIN_DB, RECEIVE_GAIN_MAX_DB)});
+    return sources.back();
+}
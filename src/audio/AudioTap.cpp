@@ -0,0 +1,179 @@
+#include <audio/AudioTap.h>
+#include <utils/Logger.h>
+#include <networking/LatencyProbe.h>
+#include <cstring>
+#include <new>
+
+constexpr size_t AUDIO_TAP_HEADER_SIZE = (sizeof(AudioTapHeader) + 63) / 64 * 64;
+constexpr size_t AUDIO_TAP_REGION_SIZE = AUDIO_TAP_HEADER_SIZE + sizeof(AudioTapSlot) * AUDIO_TAP_SLOTS;
+
+AudioTap& AudioTap::GetInstance() {
+    static AudioTap instance;
+    return instance;
+}
+
+AudioTap::AudioTap()
+    : running(false), header(nullptr), slots(nullptr), published(0), positions{}, positionCount(0) {
+}
+
+AudioTap::~AudioTap() {
+    Stop();
+}
+
+bool AudioTap::Start(const std::string& name) {
+    if (running) {
+        LOG_WARNING("Audio tap already running");
+        return false;
+    }
+
+    if (!memory.Create("tap-" + name, AUDIO_TAP_REGION_SIZE)) {
+        LOG_ERROR("Failed to create shared memory for audio tap " + name);
+        return false;
+    }
+
+    // The region comes zeroed: every slot's sequence is 0, which no reader
+    // expects before packet 0 is published
+    uint8_t* base = (uint8_t*)memory.GetData();
+    header = new (base) AudioTapHeader();
+    slots = (AudioTapSlot*)(base + AUDIO_TAP_HEADER_SIZE);
+    header->magic = AUDIO_TAP_MAGIC;
+    header->version = AUDIO_TAP_VERSION;
+    header->headerSize = (uint32_t)AUDIO_TAP_HEADER_SIZE;
+    header->slotSize = (uint32_t)sizeof(AudioTapSlot);
+    header->slotCount = AUDIO_TAP_SLOTS;
+    header->sampleRate = AUDIO_SAMPLE_RATE;
+    header->channels = AUDIO_CHANNELS;
+    header->published.store(0, std::memory_order_relaxed);
+    header->live.store(1, std::memory_order_release);
+
+    published = 0;
+    positionCount = 0;
+    running.store(true, std::memory_order_release);
+
+    LOG_INFO_FMT("Audio tap {} started ({} slots, {} KB)", name, AUDIO_TAP_SLOTS, AUDIO_TAP_REGION_SIZE / 1024);
+    return true;
+}
+
+void AudioTap::Stop() {
+    if (!running.exchange(false)) return;
+
+    header->live.store(0, std::memory_order_release);
+    LOG_INFO_FMT("Audio tap stopped after {} packets", published);
+    memory.Close();
+    header = nullptr;
+    slots = nullptr;
+}
+
+void AudioTap::PublishCapture(const AudioBuffer& samples, int64_t captureMicros) {
+    Publish(AUDIO_TAP_STREAM_LOCAL, samples, captureMicros);
+}
+
+void AudioTap::PublishSource(uint32_t peerId, const AudioBuffer& samples) {
+    Publish(peerId, samples, LatencyClockMicros());
+}
+
+void AudioTap::PublishMix(const AudioBuffer& samples) {
+    Publish(AUDIO_TAP_STREAM_MIX, samples, LatencyClockMicros());
+}
+
+uint64_t& AudioTap::PositionOf(uint32_t stream) {
+    size_t oldest = 0;
+    for (size_t i = 0; i < positionCount; i++) {
+        if (positions[i].stream == stream) {
+            positions[i].lastSequence = published;
+            return positions[i].samples;
+        }
+        if (positions[i].lastSequence < positions[oldest].lastSequence) oldest = i;
+    }
+
+    size_t index = positionCount < MAX_STREAMS ? positionCount++ : oldest;
+    positions[index] = StreamPosition{stream, 0, published};
+    return positions[index].samples;
+}
+
+void AudioTap::Publish(uint32_t stream, const AudioBuffer& samples, int64_t micros) {
+    if (!running.load(std::memory_order_relaxed)) return;
+
+    size_t count = samples.size() < MAX_SAMPLES_PER_PACKET ? samples.size() : MAX_SAMPLES_PER_PACKET;
+    uint64_t& position = PositionOf(stream);
+
+    // Seqlock write: readers that copy the slot across this see its sequence change
+    uint64_t sequence = published;
+    AudioTapSlot& slot = slots[sequence % AUDIO_TAP_SLOTS];
+    slot.sequence.store(AUDIO_TAP_WRITING, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.micros = micros;
+    slot.streamPosition = position;
+    slot.stream = stream;
+    slot.sampleCount = (uint32_t)count;
+    std::memcpy(slot.samples, samples.data(), count * sizeof(int16_t));
+    slot.sequence.store(sequence, std::memory_order_release);
+
+    published = sequence + 1;
+    header->published.store(published, std::memory_order_release);
+    position += count / AUDIO_CHANNELS;
+}
+
+AudioTapReader::AudioTapReader()
+    : header(nullptr), slots(nullptr), next(0), lost(0) {
+}
+
+bool AudioTapReader::Open(const std::string& name) {
+    Close();
+    if (!memory.Open("tap-" + name)) return false;
+
+    const uint8_t* base = (const uint8_t*)memory.GetData();
+    const AudioTapHeader* candidate = (const AudioTapHeader*)base;
+    if (memory.GetSize() < sizeof(AudioTapHeader) || candidate->magic != AUDIO_TAP_MAGIC ||
+        candidate->version != AUDIO_TAP_VERSION || candidate->slotSize != sizeof(AudioTapSlot) ||
+        candidate->slotCount == 0 ||
+        memory.GetSize() < candidate->headerSize + (size_t)candidate->slotSize * candidate->slotCount) {
+        memory.Close();
+        return false;
+    }
+
+    header = candidate;
+    slots = (const AudioTapSlot*)(base + header->headerSize);
+    next = header->published.load(std::memory_order_acquire);
+    lost = 0;
+    return true;
+}
+
+void AudioTapReader::Close() {
+    memory.Close();
+    header = nullptr;
+    slots = nullptr;
+}
+
+bool AudioTapReader::Read(AudioTapPacket& packet) {
+    if (!header) return false;
+
+    uint64_t published = header->published.load(std::memory_order_acquire);
+    while (next < published) {
+        // A whole ring behind: what is older than the ring is gone
+        if (published - next > header->slotCount) {
+            lost += published - next - header->slotCount;
+            next = published - header->slotCount;
+        }
+
+        const AudioTapSlot& slot = slots[next % header->slotCount];
+        if (slot.sequence.load(std::memory_order_acquire) == next) {
+            packet.micros = slot.micros;
+            packet.streamPosition = slot.streamPosition;
+            packet.stream = slot.stream;
+            packet.sampleCount = slot.sampleCount < MAX_SAMPLES_PER_PACKET ? slot.sampleCount : MAX_SAMPLES_PER_PACKET;
+            std::memcpy(packet.samples, slot.samples, packet.sampleCount * sizeof(int16_t));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (slot.sequence.load(std::memory_order_relaxed) == next) {
+                packet.sequence = next++;
+                return true;
+            }
+        }
+
+        // Refilled before or while we copied it
+        lost++;
+        next++;
+        published = header->published.load(std::memory_order_acquire);
+    }
+    return false;
+}
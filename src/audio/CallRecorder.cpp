@@ -0,0 +1,197 @@
+#include <audio/CallRecorder.h>
+#include <utils/Logger.h>
+#include <utils/Metrics.h>
+#include <platform/Thread.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+// Each recorded channel is one mono track
+static_assert(AUDIO_CHANNELS == 1, "CallRecorder records mono participants");
+
+CallRecorder& CallRecorder::GetInstance() {
+    static CallRecorder instance;
+    return instance;
+}
+
+CallRecorder::CallRecorder()
+    : recording(false), droppedPackets(0), stopRequested(false), channelPeers{}, slotCounts{},
+      writeBufferFrames(0) {
+}
+
+CallRecorder::~CallRecorder() {
+    Stop();
+}
+
+bool CallRecorder::Start(const std::string& filename) {
+    if (recording) {
+        LOG_WARNING("Call recording already running");
+        return false;
+    }
+
+    if (!wavWriter.Open(filename, WavFormat{AUDIO_SAMPLE_RATE, RECORDER_CHANNELS})) {
+        return false;
+    }
+
+    // Everything the writer needs is allocated here, not per packet
+    if (!ring) {
+        ring = std::make_unique<RecorderRing>();
+    }
+    writeBuffer.assign((size_t)RECORDER_WRITE_BUFFER_FRAMES * RECORDER_CHANNELS, 0);
+    writeBufferFrames = 0;
+    std::fill(std::begin(channelPeers), std::end(channelPeers), 0);
+    std::fill(std::begin(slotCounts), std::end(slotCounts), 0);
+    droppedPackets = 0;
+
+    stopRequested = false;
+    writerThread = std::thread(&CallRecorder::WriterThreadProc, this);
+    recording.store(true, std::memory_order_release);
+
+    LOG_INFO_FMT("Recording call to {} ({} channels: mix, then participants)", filename, RECORDER_CHANNELS);
+    return true;
+}
+
+void CallRecorder::Stop() {
+    if (!recording.exchange(false)) return;
+
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        stopRequested = true;
+    }
+    writerCV.notify_all();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+
+    uint64_t frames = wavWriter.GetFramesWritten();
+    if (!wavWriter.Close()) {
+        LOG_ERROR("Failed to finish call recording");
+    }
+    LOG_INFO_FMT("Call recording stopped: {} s recorded, {} packets dropped",
+                 frames / AUDIO_SAMPLE_RATE, GetDroppedPackets());
+}
+
+void CallRecorder::RecordSource(uint32_t peerId, const AudioBuffer& samples) {
+    if (peerId == 0) return;   // 0 marks the mix
+    Record(peerId, samples);
+}
+
+void CallRecorder::RecordMix(const AudioBuffer& samples) {
+    Record(0, samples);
+}
+
+void CallRecorder::Record(uint32_t peerId, const AudioBuffer& samples) {
+    if (!recording.load(std::memory_order_acquire)) return;
+    MetricStageTimer stageTimer(MetricStage::Record);
+
+    // Never waits for the writer: a full ring loses the packet
+    RecorderPacket* slot = ring->BeginPush();
+    if (!slot) {
+        droppedPackets.fetch_add(1, std::memory_order_relaxed);
+        MetricsRegistry::GetInstance().recorderDrops.Add();
+        return;
+    }
+
+    size_t count = std::min(samples.size(), (size_t)MAX_SAMPLES_PER_PACKET);
+    slot->peerId = peerId;
+    slot->sampleCount = (uint32_t)count;
+    std::memcpy(slot->samples, samples.data(), count * sizeof(int16_t));
+    ring->EndPush();
+}
+
+void CallRecorder::WriterThreadProc() {
+    SetCurrentThreadBackgroundPriority();
+
+    auto nextHeaderUpdate = std::chrono::steady_clock::now() +
+                            std::chrono::milliseconds(RECORDER_HEADER_INTERVAL_MS);
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(writerMutex);
+            writerCV.wait_for(lock, std::chrono::milliseconds(RECORDER_DRAIN_INTERVAL_MS),
+                              [this] { return stopRequested; });
+            stopping = stopRequested;
+        }
+
+        DrainRing();
+
+        if (stopping) {
+            EmitSlot();
+            FlushWriteBuffer();
+            break;
+        }
+
+        // Keep the file playable if the process dies mid-call
+        auto now = std::chrono::steady_clock::now();
+        if (now >= nextHeaderUpdate) {
+            nextHeaderUpdate = now + std::chrono::milliseconds(RECORDER_HEADER_INTERVAL_MS);
+            FlushWriteBuffer();
+            wavWriter.UpdateHeader();
+        }
+    }
+}
+
+void CallRecorder::DrainRing() {
+    while (RecorderPacket* packet = ring->Front()) {
+        AddPacket(*packet);
+        ring->Pop();
+    }
+}
+
+void CallRecorder::AddPacket(const RecorderPacket& packet) {
+    int channel = packet.peerId == 0 ? 0 : ChannelForPeer(packet.peerId);
+    if (channel < 0) return;   // more participants than channels
+
+    // A second packet for a channel means a mix was dropped: close the slot
+    if (slotCounts[channel] != 0) {
+        EmitSlot();
+    }
+    std::memcpy(slotSamples[channel], packet.samples, packet.sampleCount * sizeof(int16_t));
+    slotCounts[channel] = packet.sampleCount;
+
+    if (channel == 0) {
+        EmitSlot();
+    }
+}
+
+int CallRecorder::ChannelForPeer(uint32_t peerId) {
+    for (int channel = 1; channel < RECORDER_CHANNELS; channel++) {
+        if (channelPeers[channel] == peerId) return channel;
+        if (channelPeers[channel] == 0) {
+            channelPeers[channel] = peerId;
+            LOG_INFO_FMT("Call recording: peer {} on channel {}", peerId, channel + 1);
+            return channel;
+        }
+    }
+    return -1;
+}
+
+void CallRecorder::EmitSlot() {
+    uint32_t frames = 0;
+    for (uint32_t count : slotCounts) {
+        frames = std::max(frames, count);
+    }
+    if (frames == 0) return;
+
+    if (writeBufferFrames + frames > RECORDER_WRITE_BUFFER_FRAMES) {
+        FlushWriteBuffer();
+    }
+
+    // Channels missing from the slot (or shorter) are silent
+    int16_t* out = writeBuffer.data() + writeBufferFrames * RECORDER_CHANNELS;
+    for (uint32_t frame = 0; frame < frames; frame++) {
+        for (int channel = 0; channel < RECORDER_CHANNELS; channel++) {
+            *out++ = frame < slotCounts[channel] ? slotSamples[channel][frame] : 0;
+        }
+    }
+    writeBufferFrames += frames;
+    std::fill(std::begin(slotCounts), std::end(slotCounts), 0);
+}
+
+void CallRecorder::FlushWriteBuffer() {
+    if (writeBufferFrames == 0) return;
+    if (!wavWriter.Write(writeBuffer.data(), writeBufferFrames)) {
+        LOG_ERROR("Call recording write failed");
+    }
+    writeBufferFrames = 0;
+}
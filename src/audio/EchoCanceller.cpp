@@ -0,0 +1,301 @@
+#include <audio/EchoCanceller.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+constexpr float AEC_STEP = 0.5f;                  // NLMS step while only the far end talks
+constexpr float AEC_DOUBLE_TALK_STEP = 0.05f;     // step once converged and the residual is large
+constexpr float AEC_CONVERGED_ERLE_DB = 10.0f;
+constexpr float AEC_POWER_SMOOTHING = 0.9f;       // per block
+constexpr float AEC_ENERGY_SMOOTHING = 0.9f;      // ERLE averages, per block
+constexpr float AEC_REGULARIZATION = (float)AEC_FFT_SIZE * 1000.0f;   // about -60 dBFS per bin
+constexpr float AEC_FAR_END_ACTIVE = 1000.0f;     // mean square of the reference: about -60 dBFS
+constexpr uint32_t AEC_DIVERGED_BLOCKS = 20;      // output louder than input this long resets the filter
+
+constexpr double AEC_ANCHOR_SMOOTHING = 0.02;     // per reference block
+constexpr double AEC_ANCHOR_JUMP_FRAMES = 2.0 * AEC_BLOCK_FRAMES;   // timestamps this far off re-anchor
+constexpr float AEC_CORRELATION_SMOOTHING = 0.005f;   // per envelope step (~400 ms)
+constexpr float AEC_MEAN_SMOOTHING = 0.002f;
+constexpr float AEC_DELAY_MIN_CORRELATION = 0.4f;
+constexpr uint32_t AEC_DELAY_STABLE_BLOCKS = 10;  // same best lag this many blocks before switching
+
+constexpr uint32_t AEC_STEPS_PER_BLOCK = AEC_BLOCK_FRAMES / AEC_ENVELOPE_FRAMES;
+constexpr uint32_t AEC_OVERLAP_FRAMES = AEC_FFT_SIZE - AEC_BLOCK_FRAMES;
+
+static float LogEnergy(float energy) {
+    return std::log10(energy / AEC_ENVELOPE_FRAMES + 1.0f);
+}
+
+EchoCanceller::EchoCanceller()
+    : referenceRing(std::make_unique<ReferenceRing>()), droppedReference(0), history(AEC_HISTORY_FRAMES),
+      renderEnvelope(AEC_ENVELOPE_HISTORY), correlation(AEC_DELAY_LAGS), fft(AEC_FFT_SIZE),
+      referenceRe(AEC_PARTITIONS * AEC_BINS), referenceIm(AEC_PARTITIONS * AEC_BINS),
+      weightsRe(AEC_PARTITIONS * AEC_BINS), weightsIm(AEC_PARTITIONS * AEC_BINS), referencePower(AEC_BINS),
+      frame(AEC_FFT_SIZE), spectrumRe(AEC_BINS), spectrumIm(AEC_BINS), errorRe(AEC_BINS), errorIm(AEC_BINS),
+      erleDb(0.0), delayMicros(-1) {
+    Reset();
+}
+
+void EchoCanceller::Reset() {
+    while (referenceRing->Front()) referenceRing->Pop();
+
+    std::fill(history.begin(), history.end(), 0.0f);
+    renderFrames = 0;
+    anchored = false;
+    anchorFrames = 0.0;
+
+    std::fill(renderEnvelope.begin(), renderEnvelope.end(), 0.0f);
+    renderEnvelopeSteps = 0;
+    renderEnvelopeEnergy = 0.0f;
+    std::fill(correlation.begin(), correlation.end(), 0.0f);
+    captureMean = 0.0f;
+    renderMean = 0.0f;
+    captureVariance = 0.0f;
+    renderVariance = 0.0f;
+    candidateLag = 0;
+    candidateCount = 0;
+    bulkDelayFrames = -1;
+    delayMicros = -1;
+
+    std::fill(referencePower.begin(), referencePower.end(), 0.0f);
+    ResetFilter();
+}
+
+void EchoCanceller::ResetFilter() {
+    std::fill(referenceRe.begin(), referenceRe.end(), 0.0f);
+    std::fill(referenceIm.begin(), referenceIm.end(), 0.0f);
+    std::fill(weightsRe.begin(), weightsRe.end(), 0.0f);
+    std::fill(weightsIm.begin(), weightsIm.end(), 0.0f);
+    referenceHead = 0;
+    constrainPartition = 0;
+    divergedBlocks = 0;
+    captureEnergy = 0.0f;
+    residualEnergy = 0.0f;
+    erleDb = 0.0;
+}
+
+void EchoCanceller::AddReference(const int16_t* samples, uint32_t frames, int64_t presentMicros) {
+    while (frames > 0) {
+        uint32_t chunk = frames < AEC_BLOCK_FRAMES ? frames : AEC_BLOCK_FRAMES;
+        EchoReferenceBlock* block = referenceRing->BeginPush();
+        if (!block) {
+            // The capture side re-anchors on the next block's timestamp
+            droppedReference.fetch_add(1, std::memory_order_relaxed);
+        } else {
+            block->presentMicros = presentMicros;
+            block->frames = chunk;
+            std::memcpy(block->samples, samples, chunk * sizeof(int16_t));
+            referenceRing->EndPush();
+        }
+        samples += chunk;
+        frames -= chunk;
+        presentMicros += (int64_t)chunk * 1000000 / AUDIO_SAMPLE_RATE;
+    }
+}
+
+void EchoCanceller::DrainReference() {
+    while (EchoReferenceBlock* block = referenceRing->Front()) {
+        AppendHistory(block->samples, block->frames, block->presentMicros);
+        referenceRing->Pop();
+    }
+}
+
+void EchoCanceller::AppendHistory(const int16_t* samples, uint32_t frames, int64_t presentMicros) {
+    // Render frame index = timestamp in frames + anchor; smoothing takes out callback jitter
+    double observed = (double)renderFrames - (double)presentMicros * AUDIO_SAMPLE_RATE / 1000000.0;
+    if (!anchored || std::fabs(observed - anchorFrames) > AEC_ANCHOR_JUMP_FRAMES) {
+        anchorFrames = observed;
+        anchored = true;
+    } else {
+        anchorFrames += AEC_ANCHOR_SMOOTHING * (observed - anchorFrames);
+    }
+
+    for (uint32_t i = 0; i < frames; i++) {
+        float sample = (float)samples[i];
+        history[renderFrames & (AEC_HISTORY_FRAMES - 1)] = sample;
+        renderEnvelopeEnergy += sample * sample;
+        renderFrames++;
+        if (renderFrames % AEC_ENVELOPE_FRAMES == 0) {
+            renderEnvelope[renderEnvelopeSteps & (AEC_ENVELOPE_HISTORY - 1)] = LogEnergy(renderEnvelopeEnergy);
+            renderEnvelopeSteps++;
+            renderEnvelopeEnergy = 0.0f;
+        }
+    }
+}
+
+bool EchoCanceller::ReadReference(uint64_t firstFrame, uint32_t frames, float* out) const {
+    if (firstFrame + frames > renderFrames || renderFrames - firstFrame > AEC_HISTORY_FRAMES) {
+        return false;
+    }
+    for (uint32_t i = 0; i < frames; i++) {
+        out[i] = history[(firstFrame + i) & (AEC_HISTORY_FRAMES - 1)];
+    }
+    return true;
+}
+
+// Correlates capture energy against render energy at every lag; a lag that
+// wins clearly for long enough becomes the bulk delay
+void EchoCanceller::UpdateDelay(const int16_t* samples, uint64_t blockFrame) {
+    for (uint32_t step = 0; step < AEC_STEPS_PER_BLOCK; step++) {
+        float energy = 0.0f;
+        for (uint32_t i = 0; i < AEC_ENVELOPE_FRAMES; i++) {
+            float sample = (float)samples[step * AEC_ENVELOPE_FRAMES + i];
+            energy += sample * sample;
+        }
+        float capture = LogEnergy(energy);
+
+        uint64_t renderStep = (blockFrame + step * AEC_ENVELOPE_FRAMES) / AEC_ENVELOPE_FRAMES;
+        if (renderStep >= renderEnvelopeSteps || renderStep < AEC_DELAY_LAGS) continue;
+
+        float newestRender = renderEnvelope[renderStep & (AEC_ENVELOPE_HISTORY - 1)];
+        captureMean += AEC_MEAN_SMOOTHING * (capture - captureMean);
+        renderMean += AEC_MEAN_SMOOTHING * (newestRender - renderMean);
+        float captureDeviation = capture - captureMean;
+        float renderDeviation = newestRender - renderMean;
+        captureVariance += AEC_CORRELATION_SMOOTHING * (captureDeviation * captureDeviation - captureVariance);
+        renderVariance += AEC_CORRELATION_SMOOTHING * (renderDeviation * renderDeviation - renderVariance);
+
+        for (uint32_t lag = 0; lag < AEC_DELAY_LAGS; lag++) {
+            float render = renderEnvelope[(renderStep - lag) & (AEC_ENVELOPE_HISTORY - 1)] - renderMean;
+            correlation[lag] += AEC_CORRELATION_SMOOTHING * (captureDeviation * render - correlation[lag]);
+        }
+    }
+
+    uint32_t best = 0;
+    for (uint32_t lag = 1; lag < AEC_DELAY_LAGS; lag++) {
+        if (correlation[lag] > correlation[best]) best = lag;
+    }
+    float normalization = std::sqrt(captureVariance * renderVariance);
+    if (normalization <= 0.0f || correlation[best] < AEC_DELAY_MIN_CORRELATION * normalization) {
+        candidateCount = 0;
+        return;
+    }
+
+    if (best == candidateLag) {
+        candidateCount++;
+    } else {
+        candidateLag = best;
+        candidateCount = 1;
+    }
+
+    int64_t delay = (int64_t)best * AEC_ENVELOPE_FRAMES;
+    if (candidateCount >= AEC_DELAY_STABLE_BLOCKS &&
+        (bulkDelayFrames < 0 || std::llabs(delay - bulkDelayFrames) > (int64_t)AEC_ENVELOPE_FRAMES)) {
+        // The filter was modelling the path at the old alignment
+        bulkDelayFrames = delay;
+        delayMicros = (int32_t)(delay * 1000000 / AUDIO_SAMPLE_RATE);
+        ResetFilter();
+    }
+}
+
+void EchoCanceller::ProcessBlock(int16_t* samples, int64_t captureMicros) {
+    DrainReference();
+    if (!anchored) return;
+
+    double position = (double)captureMicros * AUDIO_SAMPLE_RATE / 1000000.0 + anchorFrames;
+    if (position < 0.0) return;
+    uint64_t blockFrame = (uint64_t)std::llround(position);
+
+    UpdateDelay(samples, blockFrame);
+    if (bulkDelayFrames < 0) return;
+
+    // Reference frame: the overlap before the block, then the block, starting a
+    // little before the estimated delay
+    int64_t shift = bulkDelayFrames > (int64_t)AEC_DELAY_MARGIN_FRAMES ? bulkDelayFrames - AEC_DELAY_MARGIN_FRAMES : 0;
+    if ((int64_t)blockFrame < shift + (int64_t)AEC_OVERLAP_FRAMES) return;
+    uint64_t blockStart = blockFrame - (uint64_t)shift;
+    if (!ReadReference(blockStart - AEC_OVERLAP_FRAMES, AEC_FFT_SIZE, frame.data())) return;
+
+    float farEnergy = 0.0f;
+    for (uint32_t i = 0; i < AEC_FFT_SIZE; i++) farEnergy += frame[i] * frame[i];
+    bool farEndActive = farEnergy / AEC_FFT_SIZE > AEC_FAR_END_ACTIVE;
+
+    // Newest reference spectrum goes in front of the partitions
+    referenceHead = (referenceHead + AEC_PARTITIONS - 1) % AEC_PARTITIONS;
+    float* newestRe = referenceRe.data() + referenceHead * AEC_BINS;
+    float* newestIm = referenceIm.data() + referenceHead * AEC_BINS;
+    fft.Forward(frame.data(), newestRe, newestIm);
+
+    FrameKernels::PowerSpectrum(spectrumRe.data(), newestRe, newestIm, AEC_BINS);
+    for (uint32_t bin = 0; bin < AEC_BINS; bin++) {
+        referencePower[bin] = AEC_POWER_SMOOTHING * referencePower[bin] +
+                              (1.0f - AEC_POWER_SMOOTHING) * spectrumRe[bin];
+    }
+
+    // Echo estimate: every partition's reference through its weights
+    std::fill(spectrumRe.begin(), spectrumRe.end(), 0.0f);
+    std::fill(spectrumIm.begin(), spectrumIm.end(), 0.0f);
+    for (uint32_t k = 0; k < AEC_PARTITIONS; k++) {
+        uint32_t slot = (referenceHead + k) % AEC_PARTITIONS;
+        FrameKernels::ComplexMultiplyAdd(spectrumRe.data(), spectrumIm.data(),
+                                         referenceRe.data() + slot * AEC_BINS, referenceIm.data() + slot * AEC_BINS,
+                                         weightsRe.data() + k * AEC_BINS, weightsIm.data() + k * AEC_BINS, AEC_BINS);
+    }
+    fft.Inverse(spectrumRe.data(), spectrumIm.data(), frame.data());
+
+    float nearEnergy = 0.0f;
+    float echoEnergy = 0.0f;
+    float errorEnergy = 0.0f;
+    const float* echo = frame.data() + AEC_OVERLAP_FRAMES;
+    for (uint32_t i = 0; i < AEC_BLOCK_FRAMES; i++) {
+        float near = (float)samples[i];
+        error[i] = near - echo[i];
+        nearEnergy += near * near;
+        echoEnergy += echo[i] * echo[i];
+        errorEnergy += error[i] * error[i];
+    }
+
+    if (farEndActive) {
+        captureEnergy = AEC_ENERGY_SMOOTHING * captureEnergy + (1.0f - AEC_ENERGY_SMOOTHING) * nearEnergy;
+        residualEnergy = AEC_ENERGY_SMOOTHING * residualEnergy +
+                         (1.0f - AEC_ENERGY_SMOOTHING) * (errorEnergy < nearEnergy ? errorEnergy : nearEnergy);
+        if (residualEnergy > 0.0f && captureEnergy > 0.0f) {
+            erleDb = 10.0 * std::log10((double)captureEnergy / residualEnergy);
+        }
+
+        // Error spectrum of the block, zero-padded in front like the overlap
+        std::fill(frame.begin(), frame.begin() + AEC_OVERLAP_FRAMES, 0.0f);
+        std::memcpy(frame.data() + AEC_OVERLAP_FRAMES, error, sizeof(error));
+        fft.Forward(frame.data(), errorRe.data(), errorIm.data());
+
+        // Converged and the residual is large next to the echo: the near end is
+        // talking too, so adapt slowly rather than learn their voice
+        float step = AEC_STEP;
+        if (erleDb > AEC_CONVERGED_ERLE_DB && errorEnergy > 0.5f * echoEnergy) step = AEC_DOUBLE_TALK_STEP;
+
+        for (uint32_t bin = 0; bin < AEC_BINS; bin++) {
+            float gain = step / (AEC_PARTITIONS * referencePower[bin] + AEC_REGULARIZATION);
+            errorRe[bin] *= gain;
+            errorIm[bin] *= gain;
+        }
+        for (uint32_t k = 0; k < AEC_PARTITIONS; k++) {
+            uint32_t slot = (referenceHead + k) % AEC_PARTITIONS;
+            FrameKernels::ComplexMultiplyConjugateAdd(weightsRe.data() + k * AEC_BINS, weightsIm.data() + k * AEC_BINS,
+                                                      errorRe.data(), errorIm.data(),
+                                                      referenceRe.data() + slot * AEC_BINS,
+                                                      referenceIm.data() + slot * AEC_BINS, AEC_BINS);
+        }
+
+        // Keep one partition a block long in time per block, round robin
+        float* constrainRe = weightsRe.data() + constrainPartition * AEC_BINS;
+        float* constrainIm = weightsIm.data() + constrainPartition * AEC_BINS;
+        fft.Inverse(constrainRe, constrainIm, frame.data());
+        std::fill(frame.begin() + AEC_BLOCK_FRAMES, frame.end(), 0.0f);
+        fft.Forward(frame.data(), constrainRe, constrainIm);
+        constrainPartition = (constrainPartition + 1) % AEC_PARTITIONS;
+    }
+
+    // Never make it worse: a filter that adds energy passes capture through,
+    // and one that keeps doing so starts over
+    if (errorEnergy > nearEnergy) {
+        if (++divergedBlocks >= AEC_DIVERGED_BLOCKS) ResetFilter();
+        return;
+    }
+    divergedBlocks = 0;
+    for (uint32_t i = 0; i < AEC_BLOCK_FRAMES; i++) {
+        float value = std::nearbyint(error[i]);
+        value = value < -32768.0f ? -32768.0f : value;
+        value = value > 32767.0f ? 32767.0f : value;
+        samples[i] = (int16_t)value;
+    }
+}
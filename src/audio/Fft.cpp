@@ -0,0 +1,135 @@
+#include <audio/Fft.h>
+#include <cmath>
+
+constexpr double FFT_PI = 3.14159265358979323846;
+
+RealFft::RealFft(uint32_t fftSize)
+    : size(fftSize), half(fftSize / 2), bitReverse(half), splitCos(half + 1), splitSin(half + 1),
+      workRe(half), workIm(half) {
+    uint32_t bits = 0;
+    while ((1u << bits) < half) bits++;
+    for (uint32_t n = 0; n < half; n++) {
+        uint32_t reversed = 0;
+        for (uint32_t b = 0; b < bits; b++) {
+            if (n & (1u << b)) reversed |= 1u << (bits - 1 - b);
+        }
+        bitReverse[n] = reversed;
+    }
+
+    // Stage with butterfly span m uses e^{-i pi j / m}, j < m
+    for (uint32_t m = 1; m < half; m <<= 1) {
+        for (uint32_t j = 0; j < m; j++) {
+            stageCos.push_back((float)std::cos(FFT_PI * j / m));
+            stageSin.push_back((float)-std::sin(FFT_PI * j / m));
+        }
+    }
+
+    for (uint32_t k = 0; k <= half; k++) {
+        splitCos[k] = (float)std::cos(2.0 * FFT_PI * k / size);
+        splitSin[k] = (float)-std::sin(2.0 * FFT_PI * k / size);
+    }
+}
+
+// One group of radix-2 butterflies: a, b = a + w b, a - w b
+static void Butterflies(float* VQ_RESTRICT aRe, float* VQ_RESTRICT aIm, float* VQ_RESTRICT bRe,
+                        float* VQ_RESTRICT bIm, const float* VQ_RESTRICT cosTable,
+                        const float* VQ_RESTRICT sinTable, float sign, uint32_t count) {
+    for (uint32_t j = 0; j < count; j++) {
+        float wr = cosTable[j];
+        float wi = sign * sinTable[j];
+        float tr = wr * bRe[j] - wi * bIm[j];
+        float ti = wr * bIm[j] + wi * bRe[j];
+        bRe[j] = aRe[j] - tr;
+        bIm[j] = aIm[j] - ti;
+        aRe[j] += tr;
+        aIm[j] += ti;
+    }
+}
+
+// In-place radix-2 complex FFT of workRe/workIm, already in bit-reversed order
+void RealFft::Transform(bool inverse) {
+    const float sign = inverse ? -1.0f : 1.0f;
+    const float* cosTable = stageCos.data();
+    const float* sinTable = stageSin.data();
+    float* VQ_RESTRICT re = workRe.data();
+    float* VQ_RESTRICT im = workIm.data();
+    uint32_t m = 1;
+
+    // First two stages as one radix-4 pass: their twiddles are 1 and -i
+    if (half >= 4) {
+        for (uint32_t k = 0; k < half; k += 4) {
+            float r0 = re[k] + re[k + 1], i0 = im[k] + im[k + 1];
+            float r1 = re[k] - re[k + 1], i1 = im[k] - im[k + 1];
+            float r2 = re[k + 2] + re[k + 3], i2 = im[k + 2] + im[k + 3];
+            float r3 = re[k + 2] - re[k + 3], i3 = im[k + 2] - im[k + 3];
+            // (r3, i3) times -i going forward, +i going back
+            float tr = sign * i3, ti = -sign * r3;
+            re[k] = r0 + r2;
+            im[k] = i0 + i2;
+            re[k + 2] = r0 - r2;
+            im[k + 2] = i0 - i2;
+            re[k + 1] = r1 + tr;
+            im[k + 1] = i1 + ti;
+            re[k + 3] = r1 - tr;
+            im[k + 3] = i1 - ti;
+        }
+        cosTable += 3;
+        sinTable += 3;
+        m = 4;
+    }
+
+    for (; m < half; m <<= 1) {
+        for (uint32_t k = 0; k < half; k += 2 * m) {
+            Butterflies(re + k, im + k, re + k + m, im + k + m, cosTable, sinTable, sign, m);
+        }
+        cosTable += m;
+        sinTable += m;
+    }
+}
+
+void RealFft::Forward(const float* VQ_RESTRICT in, float* VQ_RESTRICT re, float* VQ_RESTRICT im) {
+    // Even samples as the real part, odd as the imaginary part of a half-size FFT
+    for (uint32_t n = 0; n < half; n++) {
+        workRe[bitReverse[n]] = in[2 * n];
+        workIm[bitReverse[n]] = in[2 * n + 1];
+    }
+    Transform(false);
+
+    // Split the two interleaved real spectra and combine them; bins 0 and
+    // size/2 only have real parts
+    const float* VQ_RESTRICT zRe = workRe.data();
+    const float* VQ_RESTRICT zIm = workIm.data();
+    re[0] = zRe[0] + zIm[0];
+    im[0] = 0.0f;
+    re[half] = zRe[0] - zIm[0];
+    im[half] = 0.0f;
+    for (uint32_t k = 1; k < half; k++) {
+        float zr = zRe[k], zi = zIm[k];
+        float cr = zRe[half - k], ci = -zIm[half - k];
+        float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+        float orr = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+        re[k] = er + splitCos[k] * orr - splitSin[k] * oi;
+        im[k] = ei + splitCos[k] * oi + splitSin[k] * orr;
+    }
+}
+
+void RealFft::Inverse(const float* VQ_RESTRICT re, const float* VQ_RESTRICT im, float* VQ_RESTRICT out) {
+    for (uint32_t k = 0; k < half; k++) {
+        float xr = re[k], xi = im[k];
+        float cr = re[half - k], ci = -im[half - k];
+        float er = 0.5f * (xr + cr), ei = 0.5f * (xi + ci);
+        float dr = 0.5f * (xr - cr), di = 0.5f * (xi - ci);
+        // Odd spectrum: difference times e^{+2 pi i k / size}
+        float orr = dr * splitCos[k] + di * splitSin[k];
+        float oi = di * splitCos[k] - dr * splitSin[k];
+        workRe[bitReverse[k]] = er - oi;
+        workIm[bitReverse[k]] = ei + orr;
+    }
+    Transform(true);
+
+    const float scale = 1.0f / (float)half;
+    for (uint32_t n = 0; n < half; n++) {
+        out[2 * n] = workRe[n] * scale;
+        out[2 * n + 1] = workIm[n] * scale;
+    }
+}
@@ -0,0 +1,49 @@
+#include <audio/GainControl.h>
+#include <audio/FrameKernels.h>
+#include <cmath>
+
+// Level follows rises quickly and falls slowly, so it sits near the loud
+// parts of speech rather than the tails of words
+constexpr float GAIN_LEVEL_RISE_SECONDS = 0.3f;
+constexpr float GAIN_LEVEL_FALL_SECONDS = 3.0f;
+constexpr float GAIN_UP_DB_PER_SECOND = 6.0f;
+constexpr float GAIN_DOWN_DB_PER_SECOND = 20.0f;
+
+GainControl::GainControl(float minDb, float maxDb)
+    : minGainDb(minDb), maxGainDb(maxDb) {
+    Reset();
+}
+
+void GainControl::Reset() {
+    levelDb = GAIN_TARGET_DBFS;
+    gainDb = 0.0f;
+    linearGain = 1.0f;
+    measured = false;
+}
+
+void GainControl::Update(uint32_t energy, uint32_t count) {
+    if (count == 0) return;
+
+    double meanSquare = (double)energy * (1u << FrameKernels::ENERGY_SHIFT) / count;
+    float packetDb = meanSquare > 0.0 ? (float)(10.0 * std::log10(meanSquare / (32768.0 * 32768.0))) : -120.0f;
+    if (packetDb < GAIN_GATE_DBFS) return;
+
+    float seconds = (float)count / (AUDIO_SAMPLE_RATE * AUDIO_CHANNELS);
+    if (!measured) {
+        levelDb = packetDb;
+        measured = true;
+    } else {
+        float timeConstant = packetDb > levelDb ? GAIN_LEVEL_RISE_SECONDS : GAIN_LEVEL_FALL_SECONDS;
+        levelDb += (packetDb - levelDb) * (seconds / (timeConstant + seconds));
+    }
+
+    float targetDb = GAIN_TARGET_DBFS - levelDb;
+    targetDb = targetDb < minGainDb ? minGainDb : targetDb;
+    targetDb = targetDb > maxGainDb ? maxGainDb : targetDb;
+    float maxStep = (targetDb > gainDb ? GAIN_UP_DB_PER_SECOND : GAIN_DOWN_DB_PER_SECOND) * seconds;
+    float step = targetDb - gainDb;
+    step = step > maxStep ? maxStep : step;
+    step = step < -maxStep ? -maxStep : step;
+    gainDb += step;
+    linearGain = std::pow(10.0f, gainDb / 20.0f);
+}
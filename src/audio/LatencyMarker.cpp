@@ -0,0 +1,105 @@
+#include <audio/LatencyMarker.h>
+#include <cmath>
+
+constexpr double PI = 3.14159265358979323846;
+
+// Tonal energy share (1.0 = pure tone on the bin) and minimum block RMS
+constexpr float TONAL_RATIO_THRESHOLD = 0.5f;
+constexpr float MIN_BLOCK_RMS = 500.0f;
+
+LatencyMarkerGenerator::LatencyMarkerGenerator()
+    : burst(LATENCY_MARKER_FRAMES), position(0), active(false) {
+
+    // 1 ms raised-cosine ramps keep the burst from clicking
+    const uint32_t ramp = AUDIO_SAMPLE_RATE / 1000;
+    for (uint32_t i = 0; i < LATENCY_MARKER_FRAMES; i++) {
+        double gain = 1.0;
+        if (i < ramp) {
+            gain = 0.5 - 0.5 * std::cos(PI * i / ramp);
+        } else if (i >= LATENCY_MARKER_FRAMES - ramp) {
+            gain = 0.5 - 0.5 * std::cos(PI * (LATENCY_MARKER_FRAMES - 1 - i) / ramp);
+        }
+        double phase = 2.0 * PI * LATENCY_MARKER_FREQUENCY * i / AUDIO_SAMPLE_RATE;
+        burst[i] = (int16_t)std::lround(LATENCY_MARKER_AMPLITUDE * gain * std::sin(phase));
+    }
+}
+
+void LatencyMarkerGenerator::Trigger() {
+    position = 0;
+    active = true;
+}
+
+void LatencyMarkerGenerator::Mix(int16_t* samples, size_t frames) {
+    if (!active) return;
+
+    for (size_t frame = 0; frame < frames && position < LATENCY_MARKER_FRAMES; frame++, position++) {
+        for (uint32_t ch = 0; ch < AUDIO_CHANNELS; ch++) {
+            int32_t mixed = samples[frame * AUDIO_CHANNELS + ch] + burst[position];
+            if (mixed > INT16_MAX) mixed = INT16_MAX;
+            if (mixed < INT16_MIN) mixed = INT16_MIN;
+            samples[frame * AUDIO_CHANNELS + ch] = (int16_t)mixed;
+        }
+    }
+
+    if (position >= LATENCY_MARKER_FRAMES) {
+        active = false;
+    }
+}
+
+LatencyMarkerDetector::LatencyMarkerDetector()
+    : coefficient((float)(2.0 * std::cos(2.0 * PI * LATENCY_MARKER_FREQUENCY / AUDIO_SAMPLE_RATE))) {
+    Reset();
+}
+
+void LatencyMarkerDetector::Reset() {
+    s1 = s2 = energy = 0.0f;
+    blockFill = 0;
+    tonalBlocks = 0;
+    framesProcessed = 0;
+    refractoryUntil = 0;
+}
+
+bool LatencyMarkerDetector::FinishBlock() {
+    float power = s1 * s1 + s2 * s2 - coefficient * s1 * s2;
+    float blockEnergy = energy;
+    s1 = s2 = energy = 0.0f;
+    blockFill = 0;
+
+    const float n = (float)LATENCY_MARKER_BLOCK_FRAMES;
+    if (blockEnergy < MIN_BLOCK_RMS * MIN_BLOCK_RMS * n) {
+        return false;
+    }
+    return power / (blockEnergy * n * 0.5f) >= TONAL_RATIO_THRESHOLD;
+}
+
+bool LatencyMarkerDetector::Process(const int16_t* samples, size_t frames, uint64_t& onsetFrame) {
+    bool found = false;
+
+    for (size_t frame = 0; frame < frames; frame++) {
+        float x = samples[frame * AUDIO_CHANNELS];
+        float s = x + coefficient * s1 - s2;
+        s2 = s1;
+        s1 = s;
+        energy += x * x;
+        framesProcessed++;
+
+        if (++blockFill < LATENCY_MARKER_BLOCK_FRAMES) continue;
+
+        if (!FinishBlock() || framesProcessed < refractoryUntil) {
+            tonalBlocks = 0;
+            continue;
+        }
+
+        if (++tonalBlocks == LATENCY_MARKER_MIN_BLOCKS && !found) {
+            // The burst began somewhere in the block before the first tonal
+            // one; split the difference
+            onsetFrame = framesProcessed - (uint64_t)LATENCY_MARKER_MIN_BLOCKS * LATENCY_MARKER_BLOCK_FRAMES -
+                         LATENCY_MARKER_BLOCK_FRAMES / 2;
+            refractoryUntil = onsetFrame + 2 * LATENCY_MARKER_FRAMES;
+            tonalBlocks = 0;
+            found = true;
+        }
+    }
+
+    return found;
+}
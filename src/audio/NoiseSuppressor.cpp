@@ -0,0 +1,99 @@
+#include <audio/NoiseSuppressor.h>
+#include <algorithm>
+#include <cmath>
+
+constexpr double NS_PI = 3.14159265358979323846;
+
+constexpr float NS_POWER_SMOOTHING = 0.7f;      // per hop, before minimum tracking
+constexpr float NS_NOISE_RISE = 1.005f;         // per hop: about 4 dB/s
+constexpr float NS_MINIMUM_BIAS = 2.0f;         // a smoothed minimum sits about 3 dB under the mean
+constexpr float NS_PRIOR_SMOOTHING = 0.98f;     // decision-directed a priori SNR
+constexpr float NS_GAIN_FLOOR = 0.1f;           // -20 dB at most
+constexpr float NS_POWER_EPSILON = 1.0f;
+
+// Noise floor and Wiener gain per bin; branch-free so it vectorizes
+static void UpdateGains(const float* VQ_RESTRICT power, float* VQ_RESTRICT smoothed, float* VQ_RESTRICT noise,
+                        float* VQ_RESTRICT clean, float* VQ_RESTRICT gain, uint32_t bins) {
+    for (uint32_t i = 0; i < bins; ++i) {
+        float s = NS_POWER_SMOOTHING * smoothed[i] + (1.0f - NS_POWER_SMOOTHING) * power[i];
+        smoothed[i] = s;
+        float rising = noise[i] * NS_NOISE_RISE;
+        float n = s < rising ? s : rising;
+        noise[i] = n;
+
+        float inverseNoise = 1.0f / (NS_MINIMUM_BIAS * n + NS_POWER_EPSILON);
+        float posterior = power[i] * inverseNoise - 1.0f;
+        posterior = posterior > 0.0f ? posterior : 0.0f;
+        float prior = NS_PRIOR_SMOOTHING * clean[i] * inverseNoise + (1.0f - NS_PRIOR_SMOOTHING) * posterior;
+        float g = prior / (1.0f + prior);
+        g = g > NS_GAIN_FLOOR ? g : NS_GAIN_FLOOR;
+        gain[i] = g;
+        clean[i] = g * g * power[i];
+    }
+}
+
+NoiseSuppressor::NoiseSuppressor()
+    : fft(NS_FFT_SIZE), window(NS_WINDOW_FRAMES), input(NS_WINDOW_FRAMES), overlap(NS_HOP_FRAMES),
+      frame(NS_FFT_SIZE), re(NS_BINS), im(NS_BINS), power(NS_BINS), smoothedPower(NS_BINS), noise(NS_BINS),
+      cleanPower(NS_BINS), gain(NS_BINS), noiseLevelDb(-120.0) {
+    // sin^2 windows at 50% overlap sum to one, so analysis and synthesis
+    // windows together reconstruct the input exactly at unity gain
+    for (uint32_t n = 0; n < NS_WINDOW_FRAMES; n++) {
+        window[n] = (float)std::sin(NS_PI * n / NS_WINDOW_FRAMES);
+    }
+    Reset();
+}
+
+void NoiseSuppressor::Reset() {
+    std::fill(input.begin(), input.end(), 0.0f);
+    std::fill(overlap.begin(), overlap.end(), 0.0f);
+    std::fill(frame.begin(), frame.end(), 0.0f);
+    std::fill(cleanPower.begin(), cleanPower.end(), 0.0f);
+    primed = false;
+    noiseLevelDb = -120.0;
+}
+
+void NoiseSuppressor::ProcessBlock(int16_t* samples) {
+    for (uint32_t hop = 0; hop < NS_BLOCK_FRAMES / NS_HOP_FRAMES; hop++) {
+        ProcessHop(samples + hop * NS_HOP_FRAMES);
+    }
+}
+
+void NoiseSuppressor::ProcessHop(int16_t* samples) {
+    std::copy(input.begin() + NS_HOP_FRAMES, input.end(), input.begin());
+    for (uint32_t i = 0; i < NS_HOP_FRAMES; i++) {
+        input[NS_HOP_FRAMES + i] = (float)samples[i];
+    }
+
+    // The zero padding past the window stays zero
+    for (uint32_t i = 0; i < NS_WINDOW_FRAMES; i++) {
+        frame[i] = input[i] * window[i];
+    }
+    fft.Forward(frame.data(), re.data(), im.data());
+    FrameKernels::PowerSpectrum(power.data(), re.data(), im.data(), NS_BINS);
+
+    if (!primed) {
+        std::copy(power.begin(), power.end(), smoothedPower.begin());
+        std::copy(power.begin(), power.end(), noise.begin());
+        primed = true;
+    }
+    UpdateGains(power.data(), smoothedPower.data(), noise.data(), cleanPower.data(), gain.data(), NS_BINS);
+    FrameKernels::ScaleSpectrum(re.data(), im.data(), gain.data(), NS_BINS);
+    fft.Inverse(re.data(), im.data(), frame.data());
+
+    for (uint32_t i = 0; i < NS_HOP_FRAMES; i++) {
+        float value = std::nearbyint(overlap[i] + frame[i] * window[i]);
+        value = value < -32768.0f ? -32768.0f : value;
+        value = value > 32767.0f ? 32767.0f : value;
+        samples[i] = (int16_t)value;
+        overlap[i] = frame[NS_HOP_FRAMES + i] * window[NS_HOP_FRAMES + i];
+    }
+    // Leave the padding zero for the next hop's forward transform
+    std::fill(frame.begin() + NS_WINDOW_FRAMES, frame.end(), 0.0f);
+
+    // A windowed bin holds sum(window^2) = NS_WINDOW_FRAMES / 2 times the sample variance
+    float noiseSum = 0.0f;
+    for (uint32_t bin = 0; bin < NS_BINS; bin++) noiseSum += noise[bin];
+    double variance = NS_MINIMUM_BIAS * noiseSum / NS_BINS / (NS_WINDOW_FRAMES / 2.0);
+    noiseLevelDb = variance > 0.0 ? std::max(10.0 * std::log10(variance / (32768.0 * 32768.0)), -120.0) : -120.0;
+}
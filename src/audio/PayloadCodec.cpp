@@ -0,0 +1,133 @@
+#include <audio/PayloadCodec.h>
+#include <cstring>
+
+// G.711 mu-law (ITU-T G.711, as in the Sun reference implementation)
+constexpr int MULAW_BIAS = 0x84;
+constexpr int MULAW_CLIP = 32635;
+
+uint8_t PayloadTypeForEncoding(PayloadEncoding encoding) {
+    switch (encoding) {
+        case PayloadEncoding::Mulaw: return RTP_PAYLOAD_TYPE_MULAW;
+        case PayloadEncoding::MulawHalfRate: return RTP_PAYLOAD_TYPE_MULAW_HALF;
+        default: return RTP_PAYLOAD_TYPE_PCM16;
+    }
+}
+
+bool EncodingForPayloadType(uint8_t payloadType, PayloadEncoding& encoding) {
+    switch (payloadType) {
+        case RTP_PAYLOAD_TYPE_PCM16: encoding = PayloadEncoding::Pcm16; return true;
+        case RTP_PAYLOAD_TYPE_MULAW: encoding = PayloadEncoding::Mulaw; return true;
+        case RTP_PAYLOAD_TYPE_MULAW_HALF: encoding = PayloadEncoding::MulawHalfRate; return true;
+        default: return false;
+    }
+}
+
+const char* PayloadEncodingToString(PayloadEncoding encoding) {
+    switch (encoding) {
+        case PayloadEncoding::Pcm16: return "pcm16";
+        case PayloadEncoding::Mulaw: return "mulaw";
+        case PayloadEncoding::MulawHalfRate: return "mulaw/24k";
+        default: return "unknown";
+    }
+}
+
+uint8_t MulawEncode(int16_t sample) {
+    int value = sample;
+    int sign = (value >> 8) & 0x80;
+    if (sign) value = -value;
+    if (value > MULAW_CLIP) value = MULAW_CLIP;
+    value += MULAW_BIAS;
+
+    int exponent = 7;
+    for (int mask = 0x4000; (value & mask) == 0 && exponent > 0; mask >>= 1) {
+        exponent--;
+    }
+    int mantissa = (value >> (exponent + 3)) & 0x0F;
+    return (uint8_t)~(sign | (exponent << 4) | mantissa);
+}
+
+int16_t MulawDecode(uint8_t value) {
+    value = (uint8_t)~value;
+    int exponent = (value >> 4) & 0x07;
+    int mantissa = value & 0x0F;
+    int magnitude = (((mantissa << 3) + MULAW_BIAS) << exponent) - MULAW_BIAS;
+    return (int16_t)((value & 0x80) ? -magnitude : magnitude);
+}
+
+size_t EncodedPayloadSize(PayloadEncoding encoding, size_t sampleCount) {
+    switch (encoding) {
+        case PayloadEncoding::Pcm16: return sampleCount * sizeof(int16_t);
+        case PayloadEncoding::Mulaw: return sampleCount;
+        case PayloadEncoding::MulawHalfRate: return (sampleCount / AUDIO_CHANNELS + 1) / 2 * AUDIO_CHANNELS;
+        default: return 0;
+    }
+}
+
+size_t EncodePayload(PayloadEncoding encoding, const int16_t* samples, size_t sampleCount, uint8_t* out) {
+    switch (encoding) {
+        case PayloadEncoding::Pcm16:
+            std::memcpy(out, samples, sampleCount * sizeof(int16_t));
+            return sampleCount * sizeof(int16_t);
+
+        case PayloadEncoding::Mulaw:
+            for (size_t i = 0; i < sampleCount; i++) {
+                out[i] = MulawEncode(samples[i]);
+            }
+            return sampleCount;
+
+        case PayloadEncoding::MulawHalfRate: {
+            // Pair averaging is the decimation filter: a zero at 12 kHz, which
+            // is plenty for speech
+            size_t frames = sampleCount / AUDIO_CHANNELS;
+            size_t written = 0;
+            for (size_t frame = 0; frame < frames; frame += 2) {
+                for (uint32_t ch = 0; ch < AUDIO_CHANNELS; ch++) {
+                    int32_t a = samples[frame * AUDIO_CHANNELS + ch];
+                    int32_t b = frame + 1 < frames ? samples[(frame + 1) * AUDIO_CHANNELS + ch] : a;
+                    out[written++] = MulawEncode((int16_t)((a + b) / 2));
+                }
+            }
+            return written;
+        }
+
+        default:
+            return 0;
+    }
+}
+
+size_t DecodePayload(PayloadEncoding encoding, const uint8_t* data, size_t length,
+                     int16_t* out, size_t maxSamples) {
+    switch (encoding) {
+        case PayloadEncoding::Pcm16: {
+            size_t count = length / sizeof(int16_t);
+            if (count > maxSamples) return 0;
+            std::memcpy(out, data, count * sizeof(int16_t));
+            return count;
+        }
+
+        case PayloadEncoding::Mulaw:
+            if (length > maxSamples) return 0;
+            for (size_t i = 0; i < length; i++) {
+                out[i] = MulawDecode(data[i]);
+            }
+            return length;
+
+        case PayloadEncoding::MulawHalfRate: {
+            // Linear interpolation back to 48 kHz; the last frame is held
+            size_t frames = length / AUDIO_CHANNELS;
+            if (frames * 2 * AUDIO_CHANNELS > maxSamples) return 0;
+            for (size_t frame = 0; frame < frames; frame++) {
+                for (uint32_t ch = 0; ch < AUDIO_CHANNELS; ch++) {
+                    int32_t a = MulawDecode(data[frame * AUDIO_CHANNELS + ch]);
+                    int32_t b = frame + 1 < frames ? MulawDecode(data[(frame + 1) * AUDIO_CHANNELS + ch]) : a;
+                    out[(2 * frame) * AUDIO_CHANNELS + ch] = (int16_t)a;
+                    out[(2 * frame + 1) * AUDIO_CHANNELS + ch] = (int16_t)((a + b) / 2);
+                }
+            }
+            return frames * 2 * AUDIO_CHANNELS;
+        }
+
+        default:
+            return 0;
+    }
+}
@@ -0,0 +1,52 @@
+#include <audio/RenderScheduler.h>
+
+RenderScheduler::RenderScheduler()
+    : bufferFrames(0), periodFrames(0), sampleRate(1), safetyFrames(0), padding(0), queued(0),
+      written(false), wakes(0), starvations(0) {
+}
+
+void RenderScheduler::Reset(uint32_t buffer, uint32_t period, uint32_t rate) {
+    bufferFrames = buffer;
+    periodFrames = period;
+    sampleRate = rate > 0 ? rate : 1;
+    // A buffer under the safety level is filled completely every time
+    safetyFrames = RENDER_SAFETY_PERIODS * period < buffer ? RENDER_SAFETY_PERIODS * period : buffer;
+    padding = 0;
+    queued = 0;
+    written = false;
+    wakes = 0;
+    starvations = 0;
+}
+
+bool RenderScheduler::OnWake(uint32_t currentPadding, int64_t nowMicros, RenderRequest& request) {
+    wakes++;
+    padding = currentPadding < bufferFrames ? currentPadding : bufferFrames;
+
+    // The device played what was queued minus what is left; past one period
+    // it was waiting for us. Once it has run dry that is only a lower bound.
+    request.lateMicros = -1;
+    request.starved = false;
+    if (written) {
+        uint32_t played = queued > padding ? queued - padding : 0;
+        request.lateMicros = ((int64_t)played - periodFrames) * 1000000 / sampleRate;
+        if (request.lateMicros < 0) request.lateMicros = 0;
+        if (padding == 0) {
+            request.starved = true;
+            starvations++;
+        }
+    }
+    queued = padding;
+
+    request.maxFrames = bufferFrames - padding;
+    request.minFrames = safetyFrames > padding ? safetyFrames - padding : 0;
+    if (request.minFrames > request.maxFrames) request.minFrames = request.maxFrames;
+
+    // Audible once the device has played the padding ahead of it
+    request.presentMicros = nowMicros + (int64_t)padding * 1000000 / sampleRate;
+    return request.maxFrames > 0;
+}
+
+void RenderScheduler::OnWritten(uint32_t frames) {
+    queued = padding + frames < bufferFrames ? padding + frames : bufferFrames;
+    if (frames > 0) written = true;
+}
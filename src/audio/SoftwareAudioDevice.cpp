@@ -0,0 +1,278 @@
+#include <audio/SoftwareAudioDevice.h>
+#include <networking/LatencyProbe.h>
+#include <platform/Timer.h>
+#include <utils/Logger.h>
+#include <utils/ThreadRuntime.h>
+#include <utils/Trace.h>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+constexpr double TONE_DEVICE_HZ = 440.0;
+constexpr double TONE_DEVICE_AMPLITUDE = 8000.0;
+
+SoftwareAudioDevice::SoftwareAudioDevice(bool realTime)
+    : format{AUDIO_SAMPLE_RATE, AUDIO_CHANNELS, 0}, realTime(realTime), opened(false),
+      clockRunning(false), framesElapsed(0) {
+}
+
+SoftwareAudioDevice::~SoftwareAudioDevice() {
+    Close();
+}
+
+bool SoftwareAudioDevice::Open(const AudioDeviceFormat& requested, AudioDeviceFormat& negotiated) {
+    if (opened) Close();
+
+    // Any rate and channel count works; the period defaults to 10 ms
+    format = requested;
+    if (format.periodFrames == 0) format.periodFrames = format.sampleRate / 100;
+    if (format.sampleRate == 0 || format.channels == 0) {
+        LOG_ERROR("Invalid format requested from software audio device");
+        return false;
+    }
+
+    captureBuffer.assign((size_t)format.periodFrames * format.channels, 0);
+    renderBuffer.assign((size_t)format.periodFrames * format.channels, 0);
+
+    if (!OpenBackend()) {
+        return false;
+    }
+
+    opened = true;
+    negotiated = format;
+    LOG_INFO_FMT("Audio device {} opened: {} Hz, {}-frame period{}", GetName(), format.sampleRate,
+                 format.periodFrames, realTime ? "" : ", free-running");
+    return true;
+}
+
+void SoftwareAudioDevice::Close() {
+    if (!opened) return;
+
+    StopCapture();
+    StopRender();
+    CloseBackend();
+    opened = false;
+}
+
+bool SoftwareAudioDevice::StartCapture(AudioCaptureCallback callback) {
+    if (!opened) {
+        LOG_ERROR("Audio device not open");
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        captureCallback = std::move(callback);
+    }
+    StartClock();
+    return true;
+}
+
+void SoftwareAudioDevice::StopCapture() {
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        captureCallback = nullptr;
+    }
+    StopClockIfIdle();
+}
+
+bool SoftwareAudioDevice::StartRender(AudioRenderCallback callback) {
+    if (!opened) {
+        LOG_ERROR("Audio device not open");
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        renderCallback = std::move(callback);
+    }
+    StartClock();
+    return true;
+}
+
+void SoftwareAudioDevice::StopRender() {
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        renderCallback = nullptr;
+    }
+    StopClockIfIdle();
+}
+
+void SoftwareAudioDevice::StartClock() {
+    if (clockRunning) return;
+    if (clockThread.joinable()) clockThread.join();
+
+    clockRunning = true;
+    clockThread = std::thread(&SoftwareAudioDevice::ClockThreadProc, this);
+}
+
+void SoftwareAudioDevice::StopClockIfIdle() {
+    {
+        std::lock_guard<std::mutex> lock(callbackMutex);
+        if (captureCallback || renderCallback) return;
+    }
+    clockRunning = false;
+    if (clockThread.joinable()) clockThread.join();
+}
+
+void SoftwareAudioDevice::ClockThreadProc() {
+    TRACE_THREAD_NAME("device clock");
+    // Without a clock to wait for the thread never sleeps; it must not starve the machine
+    ThreadRuntimeScope runtime(MetricThread::DeviceClock, realTime ? ThreadPriority::Audio : ThreadPriority::Normal);
+    if (realTime) AcquireTimerResolution();
+
+    const uint32_t period = format.periodFrames;
+    const int64_t periodMicros = (int64_t)period * 1000000 / format.sampleRate;
+    const int64_t startMicros = LatencyClockMicros();
+    uint64_t frames = 0;
+    framesElapsed = 0;
+
+    while (clockRunning) {
+        // Deadlines come from the frame count, so rounding never accumulates
+        frames += period;
+        int64_t tickMicros = startMicros + (int64_t)(frames * 1000000 / format.sampleRate);
+        if (realTime) {
+            SleepUntilMicros(tickMicros);
+            ThreadRuntime::RecordWakeLatency(MetricThread::DeviceClock, LatencyClockMicros() - tickMicros);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(callbackMutex);
+            if (renderCallback) {
+                // Played a period per tick, so it needs exactly that
+                renderCallback(renderBuffer.data(), period, period, tickMicros + periodMicros);
+                ConsumeRender(renderBuffer.data(), period);
+            }
+            if (captureCallback) {
+                ProduceCapture(captureBuffer.data(), period);
+                captureCallback(captureBuffer.data(), period, tickMicros - periodMicros);
+            }
+        }
+        framesElapsed = frames;
+    }
+
+    if (realTime) ReleaseTimerResolution();
+}
+
+void NullAudioDevice::ProduceCapture(int16_t* samples, uint32_t frames) {
+    std::memset(samples, 0, (size_t)frames * format.channels * sizeof(int16_t));
+}
+
+void ToneAudioDevice::ProduceCapture(int16_t* samples, uint32_t frames) {
+    for (uint32_t i = 0; i < frames; i++, sampleClock++) {
+        bool toneOn = sampleClock % format.sampleRate < format.sampleRate / 2;
+        double phase = 2.0 * 3.14159265358979323846 * TONE_DEVICE_HZ * (double)sampleClock / format.sampleRate;
+        int16_t value = toneOn ? (int16_t)(TONE_DEVICE_AMPLITUDE * std::sin(phase)) : 0;
+        for (uint16_t c = 0; c < format.channels; c++) {
+            *samples++ = value;
+        }
+    }
+}
+
+LoopbackAudioDevice::LoopbackAudioDevice(bool realTime, uint32_t delayMs)
+    : SoftwareAudioDevice(realTime), delayMs(delayMs), targetSamples(0) {
+}
+
+bool LoopbackAudioDevice::OpenBackend() {
+    // Rendered at tick T, audible from T + period, captured by T + 2 periods
+    size_t delayFrames = 2 * (size_t)format.periodFrames + (size_t)delayMs * format.sampleRate / 1000;
+    targetSamples = delayFrames * format.channels;
+    delayLine.assign(targetSamples, 0);
+    return true;
+}
+
+void LoopbackAudioDevice::ConsumeRender(const int16_t* samples, uint32_t frames) {
+    size_t count = (size_t)frames * format.channels;
+    delayLine.insert(delayLine.end(), samples, samples + count);
+
+    // Render running without capture: keep the line at its length
+    while (delayLine.size() > targetSamples + count) {
+        delayLine.pop_front();
+    }
+}
+
+void LoopbackAudioDevice::ProduceCapture(int16_t* samples, uint32_t frames) {
+    size_t count = (size_t)frames * format.channels;
+    size_t available = delayLine.size() < count ? delayLine.size() : count;
+    std::copy(delayLine.begin(), delayLine.begin() + available, samples);
+    delayLine.erase(delayLine.begin(), delayLine.begin() + available);
+    std::memset(samples + available, 0, (count - available) * sizeof(int16_t));
+
+    // Capture running without render: hold the delay so it starts right
+    if (delayLine.size() < targetSamples) {
+        delayLine.insert(delayLine.begin(), targetSamples - delayLine.size(), 0);
+    }
+}
+
+WavFileAudioDevice::WavFileAudioDevice(bool realTime, const std::string& captureFile, const std::string& renderFile)
+    : SoftwareAudioDevice(realTime), captureFile(captureFile), renderFile(renderFile), captureFinished(false) {
+}
+
+bool WavFileAudioDevice::OpenBackend() {
+    captureFinished = captureFile.empty();
+    if (!captureFile.empty()) {
+        if (!reader.Open(captureFile)) {
+            return false;
+        }
+        const WavFormat& fileFormat = reader.GetFormat();
+        if (fileFormat.sampleRate != format.sampleRate || fileFormat.channels != format.channels) {
+            LOG_ERROR_FMT("{} is {} Hz, {} ch, which the device was not opened at (no resampling)",
+                          captureFile.c_str(), fileFormat.sampleRate, fileFormat.channels);
+            reader.Close();
+            return false;
+        }
+    }
+    if (!renderFile.empty() && !writer.Open(renderFile, WavFormat{format.sampleRate, format.channels})) {
+        reader.Close();
+        return false;
+    }
+    return true;
+}
+
+void WavFileAudioDevice::CloseBackend() {
+    reader.Close();
+    if (writer.IsOpen()) {
+        uint64_t frames = writer.GetFramesWritten();
+        if (writer.Close()) {
+            LOG_INFO_FMT("Rendered {} frames to {}", frames, renderFile.c_str());
+        } else {
+            LOG_ERROR("Failed to finish WAV file: " + renderFile);
+        }
+    }
+}
+
+void WavFileAudioDevice::ProduceCapture(int16_t* samples, uint32_t frames) {
+    size_t read = reader.Read(samples, frames);
+    std::memset(samples + read * format.channels, 0, (frames - read) * format.channels * sizeof(int16_t));
+    if (read < frames && !captureFinished) {
+        captureFinished = true;
+        LOG_INFO("Capture file finished: " + captureFile);
+    }
+}
+
+void WavFileAudioDevice::ConsumeRender(const int16_t* samples, uint32_t frames) {
+    if (writer.IsOpen()) {
+        writer.Write(samples, frames);
+    }
+}
+
+std::unique_ptr<AudioDevice> CreateSoftwareAudioDevice(const std::string& spec, bool realTime) {
+    if (spec == "null") {
+        return std::unique_ptr<AudioDevice>(new NullAudioDevice(realTime));
+    }
+    if (spec == "tone") {
+        return std::unique_ptr<AudioDevice>(new ToneAudioDevice(realTime));
+    }
+    if (spec == "loopback" || spec.compare(0, 9, "loopback:") == 0) {
+        int delayMs = spec.size() > 9 ? std::atoi(spec.c_str() + 9) : 0;
+        if (delayMs < 0) return nullptr;
+        return std::unique_ptr<AudioDevice>(new LoopbackAudioDevice(realTime, (uint32_t)delayMs));
+    }
+    if (spec.compare(0, 4, "wav:") == 0) {
+        std::string files = spec.substr(4);
+        size_t comma = files.find(',');
+        std::string captureFile = files.substr(0, comma);
+        std::string renderFile = comma == std::string::npos ? std::string() : files.substr(comma + 1);
+        if (captureFile.empty() && renderFile.empty()) return nullptr;
+        return std::unique_ptr<AudioDevice>(new WavFileAudioDevice(realTime, captureFile, renderFile));
+    }
+    return nullptr;
+}
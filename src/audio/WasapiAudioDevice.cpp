@@ -0,0 +1,431 @@
+#include <audio/WasapiAudioDevice.h>
+#include <audio/RenderScheduler.h>
+#include <utils/Logger.h>
+#include <utils/Metrics.h>
+#include <utils/ThreadRuntime.h>
+#include <utils/Trace.h>
+#include <networking/LatencyProbe.h>
+#include <functiondiscoverykeys_devpkey.h>
+#include <algorithm>
+
+WasapiAudioDevice::WasapiAudioDevice()
+    : comInitialized(false), format{AUDIO_SAMPLE_RATE, AUDIO_CHANNELS, 0},
+      deviceEnumerator(nullptr), captureDevice(nullptr), playbackDevice(nullptr),
+      captureClient(nullptr), playbackClient(nullptr), captureControl(nullptr),
+      playbackControl(nullptr), playbackBufferFrames(0), captureEvent(nullptr), playbackEvent(nullptr),
+      captureRunning(false), playbackRunning(false) {
+}
+
+WasapiAudioDevice::~WasapiAudioDevice() {
+    Close();
+}
+
+bool WasapiAudioDevice::Open(const AudioDeviceFormat& requested, AudioDeviceFormat& negotiated) {
+    LOG_INFO("Opening WASAPI audio device");
+
+    HRESULT hr = CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to initialize COM");
+        return false;
+    }
+    comInitialized = true;
+    format = requested;
+
+    // Create device enumerator
+    hr = CoCreateInstance(__uuidof(MMDeviceEnumerator), nullptr, CLSCTX_ALL,
+                          __uuidof(IMMDeviceEnumerator), (void**)&deviceEnumerator);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to create device enumerator");
+        Close();
+        return false;
+    }
+
+    // Get default capture device
+    hr = deviceEnumerator->GetDefaultAudioEndpoint(eCapture, eConsole, &captureDevice);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to get default capture device");
+        Close();
+        return false;
+    }
+
+    // Get default playback device
+    hr = deviceEnumerator->GetDefaultAudioEndpoint(eRender, eConsole, &playbackDevice);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to get default playback device");
+        Close();
+        return false;
+    }
+
+    // Activate capture client
+    hr = captureDevice->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr,
+                                (void**)&captureClient);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to activate capture client");
+        Close();
+        return false;
+    }
+
+    // Activate playback client
+    hr = playbackDevice->Activate(__uuidof(IAudioClient), CLSCTX_ALL, nullptr,
+                                 (void**)&playbackClient);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to activate playback client");
+        Close();
+        return false;
+    }
+
+    // Format negotiation: shared mode takes the requested PCM format or fails.
+    // Events arrive once per engine period, which each client reports back.
+    uint32_t capturePeriodFrames = 0;
+    uint32_t playbackPeriodFrames = 0;
+    if (FAILED(InitializeAudioClient(captureClient, capturePeriodFrames))) {
+        LOG_ERROR("Failed to initialize capture client");
+        Close();
+        return false;
+    }
+    if (FAILED(InitializeAudioClient(playbackClient, playbackPeriodFrames)) ||
+        FAILED(playbackClient->GetBufferSize(&playbackBufferFrames))) {
+        LOG_ERROR("Failed to initialize playback client");
+        Close();
+        return false;
+    }
+    if (playbackPeriodFrames > 0) format.periodFrames = playbackPeriodFrames;
+    negotiated = format;
+
+    LOG_INFO_FMT("WASAPI audio device opened: {}-frame capture and {}-frame render period, {}-frame render buffer",
+                 capturePeriodFrames, playbackPeriodFrames, playbackBufferFrames);
+    if (requested.periodFrames < format.sampleRate / 100 && capturePeriodFrames >= format.sampleRate / 100) {
+        LOG_WARNING_FMT("No shared-mode period under 10 ms on this device: asked for {} frames, runs at {}",
+                        requested.periodFrames, capturePeriodFrames);
+    }
+    return true;
+}
+
+void WasapiAudioDevice::Close() {
+    StopCapture();
+    StopRender();
+
+    if (captureControl) {
+        captureControl->Release();
+        captureControl = nullptr;
+    }
+    if (playbackControl) {
+        playbackControl->Release();
+        playbackControl = nullptr;
+    }
+    if (captureClient) {
+        captureClient->Release();
+        captureClient = nullptr;
+    }
+    if (playbackClient) {
+        playbackClient->Release();
+        playbackClient = nullptr;
+    }
+    if (captureDevice) {
+        captureDevice->Release();
+        captureDevice = nullptr;
+    }
+    if (playbackDevice) {
+        playbackDevice->Release();
+        playbackDevice = nullptr;
+    }
+    if (deviceEnumerator) {
+        deviceEnumerator->Release();
+        deviceEnumerator = nullptr;
+    }
+
+    if (comInitialized) {
+        CoUninitialize();
+        comInitialized = false;
+    }
+}
+
+bool WasapiAudioDevice::StartCapture(AudioCaptureCallback callback) {
+    if (captureRunning) return true;
+    if (!captureClient) {
+        LOG_ERROR("WASAPI capture client not open");
+        return false;
+    }
+
+    captureEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (!captureEvent) {
+        LOG_ERROR("Failed to create capture event");
+        return false;
+    }
+
+    HRESULT hr = captureClient->SetEventHandle(captureEvent);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to set capture event handle");
+        CloseHandle(captureEvent);
+        captureEvent = nullptr;
+        return false;
+    }
+
+    if (!captureControl) {
+        hr = captureClient->GetService(__uuidof(IAudioCaptureClient), (void**)&captureControl);
+        if (FAILED(hr)) {
+            LOG_ERROR("Failed to get audio capture client service");
+            CloseHandle(captureEvent);
+            captureEvent = nullptr;
+            return false;
+        }
+    }
+
+    hr = captureClient->Start();
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to start capture");
+        CloseHandle(captureEvent);
+        captureEvent = nullptr;
+        return false;
+    }
+
+    captureCallback = std::move(callback);
+    captureRunning = true;
+    captureThread = std::thread(&WasapiAudioDevice::CaptureThreadProc, this);
+    return true;
+}
+
+void WasapiAudioDevice::StopCapture() {
+    if (!captureRunning) return;
+
+    captureRunning = false;
+
+    if (captureThread.joinable()) {
+        captureThread.join();
+    }
+
+    if (captureClient) {
+        captureClient->Stop();
+    }
+
+    if (captureEvent) {
+        CloseHandle(captureEvent);
+        captureEvent = nullptr;
+    }
+    captureCallback = nullptr;
+}
+
+bool WasapiAudioDevice::StartRender(AudioRenderCallback callback) {
+    if (playbackRunning) return true;
+    if (!playbackClient) {
+        LOG_ERROR("WASAPI playback client not open");
+        return false;
+    }
+
+    playbackEvent = CreateEvent(nullptr, FALSE, FALSE, nullptr);
+    if (!playbackEvent) {
+        LOG_ERROR("Failed to create playback event");
+        return false;
+    }
+
+    HRESULT hr = playbackClient->SetEventHandle(playbackEvent);
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to set playback event handle");
+        CloseHandle(playbackEvent);
+        playbackEvent = nullptr;
+        return false;
+    }
+
+    if (!playbackControl) {
+        hr = playbackClient->GetService(__uuidof(IAudioRenderClient), (void**)&playbackControl);
+        if (FAILED(hr)) {
+            LOG_ERROR("Failed to get audio render client service");
+            CloseHandle(playbackEvent);
+            playbackEvent = nullptr;
+            return false;
+        }
+    }
+
+    hr = playbackClient->Start();
+    if (FAILED(hr)) {
+        LOG_ERROR("Failed to start playback");
+        CloseHandle(playbackEvent);
+        playbackEvent = nullptr;
+        return false;
+    }
+
+    renderCallback = std::move(callback);
+    playbackRunning = true;
+    playbackThread = std::thread(&WasapiAudioDevice::PlaybackThreadProc, this);
+    return true;
+}
+
+void WasapiAudioDevice::StopRender() {
+    if (!playbackRunning) return;
+
+    playbackRunning = false;
+
+    if (playbackThread.joinable()) {
+        playbackThread.join();
+    }
+
+    if (playbackClient) {
+        playbackClient->Stop();
+    }
+
+    if (playbackEvent) {
+        CloseHandle(playbackEvent);
+        playbackEvent = nullptr;
+    }
+    renderCallback = nullptr;
+}
+
+bool WasapiAudioDevice::EnumerateAudioDevices() {
+    LOG_INFO("Enumerating audio devices");
+    // TODO: Implement device enumeration
+    return true;
+}
+
+bool WasapiAudioDevice::SelectCaptureDevice(int deviceIndex) {
+    LOG_INFO("Selecting capture device: " + std::to_string(deviceIndex));
+    // TODO: Implement device selection
+    return true;
+}
+
+bool WasapiAudioDevice::SelectPlaybackDevice(int deviceIndex) {
+    LOG_INFO("Selecting playback device: " + std::to_string(deviceIndex));
+    // TODO: Implement device selection
+    return true;
+}
+
+HRESULT WasapiAudioDevice::InitializeAudioClient(IAudioClient* client, uint32_t& periodFrames) {
+    WAVEFORMATEX waveFormat;
+    waveFormat.wFormatTag = WAVE_FORMAT_PCM;
+    waveFormat.nChannels = format.channels;
+    waveFormat.nSamplesPerSec = format.sampleRate;
+    waveFormat.wBitsPerSample = AUDIO_BITS_PER_SAMPLE;
+    waveFormat.nBlockAlign = (waveFormat.nChannels * waveFormat.wBitsPerSample) / 8;
+    waveFormat.nAvgBytesPerSec = waveFormat.nSamplesPerSec * waveFormat.nBlockAlign;
+    waveFormat.cbSize = 0;
+
+    // Under 10 ms: the shortest engine period that holds the requested one.
+    // Needs IAudioClient3 (Windows 10) and a driver that offers small periods;
+    // anything else falls through to the default period below.
+    IAudioClient3* lowLatencyClient = nullptr;
+    if (format.periodFrames > 0 && format.periodFrames < format.sampleRate / 100 &&
+        SUCCEEDED(client->QueryInterface(__uuidof(IAudioClient3), (void**)&lowLatencyClient))) {
+        UINT32 defaultFrames = 0;
+        UINT32 fundamentalFrames = 0;
+        UINT32 minimumFrames = 0;
+        UINT32 maximumFrames = 0;
+        HRESULT hr = lowLatencyClient->GetSharedModeEnginePeriod(&waveFormat, &defaultFrames, &fundamentalFrames,
+                                                                 &minimumFrames, &maximumFrames);
+        if (SUCCEEDED(hr) && fundamentalFrames > 0 && minimumFrames < defaultFrames) {
+            UINT32 frames = (format.periodFrames + fundamentalFrames - 1) / fundamentalFrames * fundamentalFrames;
+            frames = std::min(std::max(frames, minimumFrames), defaultFrames);
+            hr = lowLatencyClient->InitializeSharedAudioStream(AUDCLNT_STREAMFLAGS_EVENTCALLBACK, frames, &waveFormat,
+                                                               nullptr);
+            if (SUCCEEDED(hr)) {
+                lowLatencyClient->Release();
+                periodFrames = frames;
+                return hr;
+            }
+        }
+        lowLatencyClient->Release();
+    }
+
+    REFERENCE_TIME hnsRequestedDuration = 100000; // 10ms
+
+    HRESULT hr = client->Initialize(
+        AUDCLNT_SHAREMODE_SHARED,
+        AUDCLNT_STREAMFLAGS_EVENTCALLBACK,
+        hnsRequestedDuration,
+        0,
+        &waveFormat,
+        nullptr
+    );
+    if (FAILED(hr)) return hr;
+
+    REFERENCE_TIME defaultPeriod = 0;
+    REFERENCE_TIME minimumPeriod = 0;
+    if (SUCCEEDED(client->GetDevicePeriod(&defaultPeriod, &minimumPeriod)) && defaultPeriod > 0) {
+        periodFrames = (uint32_t)(defaultPeriod * format.sampleRate / 10000000);
+    }
+    return hr;
+}
+
+void WasapiAudioDevice::CaptureThreadProc() {
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    TRACE_THREAD_NAME("capture");
+    ThreadRuntimeScope runtime(MetricThread::Capture, ThreadPriority::Audio);
+
+    while (captureRunning) {
+        DWORD flags = 0;
+        uint32_t packetLength;
+        bool firstPacket = true;
+
+        HRESULT hr = captureControl->GetNextPacketSize(&packetLength);
+        if (FAILED(hr)) break;
+
+        while (packetLength > 0 && captureRunning) {
+            uint8_t* buffer = nullptr;
+            uint32_t numFrames;
+            UINT64 qpcPosition = 0;
+
+            hr = captureControl->GetBuffer(&buffer, &numFrames, &flags, nullptr, &qpcPosition);
+            if (FAILED(hr)) break;
+
+            // QPC position is in 100 ns units on the clock steady_clock reads
+            int64_t bufferMicros = qpcPosition ? (int64_t)(qpcPosition / 10) : LatencyClockMicros();
+
+            // The event fires once the packet's last frame is captured
+            if (firstPacket && qpcPosition) {
+                int64_t completeMicros = bufferMicros + (int64_t)numFrames * 1000000 / format.sampleRate;
+                ThreadRuntime::RecordWakeLatency(MetricThread::Capture, LatencyClockMicros() - completeMicros);
+                firstPacket = false;
+            }
+
+            // Buffer contains PCM audio data in the negotiated format
+            const int16_t* pcm = reinterpret_cast<const int16_t*>(buffer);
+            if (flags & AUDCLNT_BUFFERFLAGS_SILENT) {
+                silence.assign((size_t)numFrames * format.channels, 0);
+                pcm = silence.data();
+            }
+            captureCallback(pcm, numFrames, bufferMicros);
+
+            hr = captureControl->ReleaseBuffer(numFrames);
+            if (FAILED(hr)) break;
+
+            hr = captureControl->GetNextPacketSize(&packetLength);
+            if (FAILED(hr)) break;
+        }
+
+        WaitForSingleObject(captureEvent, INFINITE);
+    }
+
+    CoUninitialize();
+}
+
+void WasapiAudioDevice::PlaybackThreadProc() {
+    CoInitializeEx(nullptr, COINIT_MULTITHREADED);
+    TRACE_THREAD_NAME("render");
+    ThreadRuntimeScope runtime(MetricThread::Render, ThreadPriority::Audio);
+    RenderScheduler scheduler;
+    scheduler.Reset(playbackBufferFrames, format.periodFrames, format.sampleRate);
+
+    while (playbackRunning) {
+        // The padding says how much the device has left; the scheduler how
+        // much of the free space to fill
+        UINT32 padding = 0;
+        RenderRequest request;
+        if (SUCCEEDED(playbackClient->GetCurrentPadding(&padding)) &&
+            scheduler.OnWake(padding, LatencyClockMicros(), request)) {
+            if (request.lateMicros >= 0) ThreadRuntime::RecordWakeLatency(MetricThread::Render, request.lateMicros);
+            if (request.starved) MetricsRegistry::GetInstance().renderStarvations.Add();
+
+            // Writing fewer frames than the buffer asked for is allowed
+            int16_t* renderBuffer = nullptr;
+            HRESULT hr = playbackControl->GetBuffer(request.maxFrames, (BYTE**)&renderBuffer);
+            if (SUCCEEDED(hr)) {
+                uint32_t written = renderCallback(renderBuffer, request.minFrames, request.maxFrames,
+                                                  request.presentMicros);
+                playbackControl->ReleaseBuffer(written, 0);
+                scheduler.OnWritten(written);
+            }
+        }
+
+        WaitForSingleObject(playbackEvent, INFINITE);
+    }
+
+    CoUninitialize();
+}
@@ -0,0 +1,181 @@
+#include <audio/WavFile.h>
+#include <utils/Logger.h>
+#include <cstring>
+
+constexpr size_t WAV_HEADER_SIZE = 44;
+constexpr uint16_t WAV_FORMAT_PCM = 1;
+constexpr uint16_t WAV_FORMAT_EXTENSIBLE = 0xFFFE;
+
+static uint16_t WavGet16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t WavGet32(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void WavPut16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void WavPut32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+// Canonical 44-byte header; sizes are patched on close
+static void WriteWavHeader(uint8_t* header, const WavFormat& format, uint32_t dataBytes) {
+    uint16_t blockAlign = (uint16_t)(format.channels * 2);
+    std::memcpy(header, "RIFF", 4);
+    WavPut32(header + 4, 36 + dataBytes);
+    std::memcpy(header + 8, "WAVEfmt ", 8);
+    WavPut32(header + 16, 16);
+    WavPut16(header + 20, WAV_FORMAT_PCM);
+    WavPut16(header + 22, format.channels);
+    WavPut32(header + 24, format.sampleRate);
+    WavPut32(header + 28, format.sampleRate * blockAlign);
+    WavPut16(header + 32, blockAlign);
+    WavPut16(header + 34, 16);
+    std::memcpy(header + 36, "data", 4);
+    WavPut32(header + 40, dataBytes);
+}
+
+WavReader::WavReader() : file(nullptr), format{0, 0}, totalFrames(0), framesLeft(0) {
+}
+
+WavReader::~WavReader() {
+    Close();
+}
+
+bool WavReader::Open(const std::string& filename) {
+    Close();
+
+    file = std::fopen(filename.c_str(), "rb");
+    if (!file) {
+        LOG_ERROR("Cannot open WAV file: " + filename);
+        return false;
+    }
+
+    uint8_t riff[12];
+    if (std::fread(riff, 1, sizeof(riff), file) != sizeof(riff) ||
+        std::memcmp(riff, "RIFF", 4) != 0 || std::memcmp(riff + 8, "WAVE", 4) != 0) {
+        LOG_ERROR("Not a RIFF/WAVE file: " + filename);
+        Close();
+        return false;
+    }
+
+    // Walk the chunks: fmt must come before data, anything else is skipped
+    bool haveFormat = false;
+    uint8_t chunk[8];
+    while (std::fread(chunk, 1, sizeof(chunk), file) == sizeof(chunk)) {
+        uint32_t size = WavGet32(chunk + 4);
+        if (std::memcmp(chunk, "fmt ", 4) == 0) {
+            uint8_t fmt[40] = {};
+            size_t readSize = size < sizeof(fmt) ? size : sizeof(fmt);
+            if (size < 16 || std::fread(fmt, 1, readSize, file) != readSize) break;
+            uint16_t tag = WavGet16(fmt);
+            uint16_t bits = WavGet16(fmt + 14);
+            if ((tag != WAV_FORMAT_PCM && tag != WAV_FORMAT_EXTENSIBLE) || bits != 16) {
+                LOG_ERROR("WAV file is not 16-bit PCM: " + filename);
+                Close();
+                return false;
+            }
+            format.channels = WavGet16(fmt + 2);
+            format.sampleRate = WavGet32(fmt + 4);
+            haveFormat = format.channels > 0 && format.sampleRate > 0;
+            std::fseek(file, (long)(size - readSize + (size & 1)), SEEK_CUR);
+        } else if (std::memcmp(chunk, "data", 4) == 0 && haveFormat) {
+            totalFrames = size / (2u * format.channels);
+            framesLeft = totalFrames;
+            return true;
+        } else {
+            std::fseek(file, (long)(size + (size & 1)), SEEK_CUR);
+        }
+    }
+
+    LOG_ERROR("WAV file has no usable fmt/data chunks: " + filename);
+    Close();
+    return false;
+}
+
+void WavReader::Close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    framesLeft = 0;
+}
+
+size_t WavReader::Read(int16_t* samples, size_t frames) {
+    if (!file || framesLeft == 0) return 0;
+    if (frames > framesLeft) frames = (size_t)framesLeft;
+
+    // Samples are little-endian on disk, as on every target we build for
+    size_t read = std::fread(samples, 2 * format.channels, frames, file);
+    framesLeft = read < frames ? 0 : framesLeft - read;
+    return read;
+}
+
+WavWriter::WavWriter() : file(nullptr), format{0, 0}, framesWritten(0) {
+}
+
+WavWriter::~WavWriter() {
+    Close();
+}
+
+bool WavWriter::Open(const std::string& filename, const WavFormat& wavFormat) {
+    Close();
+
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        LOG_ERROR("Cannot create WAV file: " + filename);
+        return false;
+    }
+
+    format = wavFormat;
+    framesWritten = 0;
+
+    uint8_t header[WAV_HEADER_SIZE];
+    WriteWavHeader(header, format, 0);
+    if (std::fwrite(header, 1, sizeof(header), file) != sizeof(header)) {
+        LOG_ERROR("Failed to write WAV header: " + filename);
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+    return true;
+}
+
+bool WavWriter::Write(const int16_t* samples, size_t frames) {
+    if (!file) return false;
+    size_t written = std::fwrite(samples, 2 * format.channels, frames, file);
+    framesWritten += written;
+    return written == frames;
+}
+
+bool WavWriter::Close() {
+    if (!file) return true;
+
+    bool ok = UpdateHeader();
+    ok = (std::fclose(file) == 0) && ok;
+    file = nullptr;
+    return ok;
+}
+
+bool WavWriter::UpdateHeader() {
+    if (!file) return false;
+
+    // RIFF sizes are 32-bit: a longer recording keeps its data but caps the header
+    uint64_t dataBytes = framesWritten * 2 * format.channels;
+    uint32_t headerBytes = dataBytes > 0xFFFFFFFFull - 36 ? 0xFFFFFFFFu - 36 : (uint32_t)dataBytes;
+
+    uint8_t header[WAV_HEADER_SIZE];
+    WriteWavHeader(header, format, headerBytes);
+    bool ok = std::fseek(file, 0, SEEK_SET) == 0 &&
+              std::fwrite(header, 1, sizeof(header), file) == sizeof(header);
+    ok = std::fseek(file, 0, SEEK_END) == 0 && ok;
+    return std::fflush(file) == 0 && ok;
+}
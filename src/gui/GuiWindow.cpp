@@ -1,9 +1,15 @@
 #include <gui/GuiWindow.h>
 #include <utils/Logger.h>
+#include <utils/Trace.h>
 #include <networking/PeerNetwork.h>
 #include <sstream>
 #include <commctrl.h>
 
+// Volume slider: the default position plays at unity gain, and gain follows
+// the square of the position so the travel feels even
+constexpr int VOLUME_SLIDER_MAX = 100;
+constexpr int VOLUME_SLIDER_UNITY = 80;
+
 // Window class name
 static const wchar_t CLASS_NAME[] = L"VoiceQwikWindow";
 
@@ -15,7 +21,9 @@ enum ControlID {
     IDC_REMOTE_PEER_EDIT = 1003,
     IDC_CONNECT_BUTTON = 1004,
     IDC_MUTE_BUTTON = 1005,
-    IDC_VOLUME_SLIDER = 1006
+    IDC_VOLUME_SLIDER = 1006,
+    IDC_PACKET_TIME_COMBO = 1007,
+    IDC_STATS_TEXT = 1008
 };
 
 GuiWindow& GuiWindow::GetInstance() {
@@ -25,10 +33,10 @@ GuiWindow& GuiWindow::GetInstance() {
 
 GuiWindow::GuiWindow()
     : hwnd(nullptr), hInstance(nullptr), running(false),
-      participantCombo(nullptr), statusText(nullptr), connectionInfoEdit(nullptr),
+      participantCombo(nullptr), packetTimeCombo(nullptr), statusText(nullptr), connectionInfoEdit(nullptr),
       remotePeerEdit(nullptr), connectButton(nullptr), muteButton(nullptr),
-    volumeSlider(nullptr), selectedParticipants(2), isMuted(false),
-    connectRequested(false) {
+    volumeSlider(nullptr), statsText(nullptr), selectedParticipants(2), isMuted(false),
+    volumePosition(VOLUME_SLIDER_UNITY), connectRequested(false) {
 }
 
 GuiWindow::~GuiWindow() {
@@ -120,6 +128,11 @@ bool GuiWindow::IsMuted() const {
     return isMuted;
 }
 
+float GuiWindow::GetVolumeGain() const {
+    float ratio = (float)volumePosition / VOLUME_SLIDER_UNITY;
+    return ratio * ratio;
+}
+
 std::string GuiWindow::GetConnectionString() const {
     char hostname[256];
     if (gethostname(hostname, sizeof(hostname)) != 0) {
@@ -175,6 +188,14 @@ void GuiWindow::SetConnectionStatus(const std::string& status) {
     SetWindowText(statusText, wstatus);
 }
 
+void GuiWindow::SetStatsLine(const std::string& stats) {
+    if (!statsText) return;
+
+    wchar_t wstats[256];
+    MultiByteToWideChar(CP_ACP, 0, stats.c_str(), -1, wstats, sizeof(wstats) / sizeof(wstats[0]));
+    SetWindowText(statsText, wstats);
+}
+
 void GuiWindow::SetParticipantCount(int count) {
     selectedParticipants = count;
     LOG_INFO("Participant count set to: " + std::to_string(count));
@@ -213,6 +234,30 @@ void GuiWindow::CreateControls() {
 
     yOffset += lineHeight;
 
+    // Label: Packet time
+    CreateWindow(L"STATIC", L"Packet Time:",
+                WS_CHILD | WS_VISIBLE, xOffset, yOffset, controlWidth, controlHeight,
+                hwnd, (HMENU)0, hInstance, nullptr);
+
+    // Combo box: one entry per ALL_PACKET_TIMES, in order
+    packetTimeCombo = CreateWindow(L"COMBOBOX", L"",
+                                  WS_CHILD | WS_VISIBLE | CBS_DROPDOWNLIST,
+                                  xOffset + controlWidth + 10, yOffset, 100, 150,
+                                  hwnd, (HMENU)IDC_PACKET_TIME_COMBO, hInstance, nullptr);
+
+    SendMessage(packetTimeCombo, CB_ADDSTRING, 0, (LPARAM)L"2.5 ms (LAN)");
+    SendMessage(packetTimeCombo, CB_ADDSTRING, 0, (LPARAM)L"5 ms");
+    SendMessage(packetTimeCombo, CB_ADDSTRING, 0, (LPARAM)L"10 ms");
+    SendMessage(packetTimeCombo, CB_ADDSTRING, 0, (LPARAM)L"20 ms");
+    SendMessage(packetTimeCombo, CB_ADDSTRING, 0, (LPARAM)L"40 ms (WAN)");
+    for (int i = 0; i < (int)(sizeof(ALL_PACKET_TIMES) / sizeof(ALL_PACKET_TIMES[0])); i++) {
+        if (ALL_PACKET_TIMES[i] == PeerNetwork::GetInstance().GetPreferredPacketTime()) {
+            SendMessage(packetTimeCombo, CB_SETCURSEL, i, 0);
+        }
+    }
+
+    yOffset += lineHeight;
+
     // Label: Connection info
     CreateWindow(L"STATIC", L"Your Connection Info:",
                 WS_CHILD | WS_VISIBLE, xOffset, yOffset, controlWidth, controlHeight,
@@ -274,8 +319,16 @@ void GuiWindow::CreateControls() {
                                xOffset + 180, yOffset, 200, controlHeight,
                                hwnd, (HMENU)IDC_VOLUME_SLIDER, hInstance, nullptr);
 
-    SendMessage(volumeSlider, TBM_SETRANGE, TRUE, MAKELPARAM(0, 100));
-    SendMessage(volumeSlider, TBM_SETPOS, TRUE, 80);
+    SendMessage(volumeSlider, TBM_SETRANGE, TRUE, MAKELPARAM(0, VOLUME_SLIDER_MAX));
+    SendMessage(volumeSlider, TBM_SETPOS, TRUE, volumePosition);
+
+    yOffset += lineHeight;
+
+    // Call statistics, refreshed from the metrics registry
+    statsText = CreateWindow(L"STATIC", L"",
+                            WS_CHILD | WS_VISIBLE | SS_LEFT,
+                            xOffset, yOffset, 540, controlHeight,
+                            hwnd, (HMENU)IDC_STATS_TEXT, hInstance, nullptr);
 }
 
 void GuiWindow::UpdateConnectionInfo() {
@@ -326,6 +379,15 @@ LRESULT GuiWindow::HandleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
                     }
                     break;
 
+                case IDC_PACKET_TIME_COMBO:
+                    if (notificationCode == CBN_SELCHANGE) {
+                        int sel = (int)SendMessage(packetTimeCombo, CB_GETCURSEL, 0, 0);
+                        if (sel >= 0 && sel < (int)(sizeof(ALL_PACKET_TIMES) / sizeof(ALL_PACKET_TIMES[0]))) {
+                            PeerNetwork::GetInstance().SetPreferredPacketTime(ALL_PACKET_TIMES[sel]);
+                        }
+                    }
+                    break;
+
                 case IDC_CONNECT_BUTTON: {
                     std::string remotePeer = GetRemotePeerIP();
                     LOG_INFO("Attempting to connect to: " + remotePeer);
@@ -347,10 +409,29 @@ LRESULT GuiWindow::HandleMessage(UINT msg, WPARAM wParam, LPARAM lParam) {
             break;
         }
 
+        case WM_HSCROLL:
+            if ((HWND)lParam == volumeSlider) {
+                volumePosition = (int)SendMessage(volumeSlider, TBM_GETPOS, 0, 0);
+                if (LOWORD(wParam) == TB_ENDTRACK) {
+                    LOG_INFO_FMT("Volume set to {}%", volumePosition);
+                }
+            }
+            break;
+
         case WM_KEYDOWN:
             if (wParam == 'M' || wParam == 'm') {
                 PostMessage(hwnd, WM_COMMAND, MAKEWPARAM(IDC_MUTE_BUTTON, 0), 0);
             }
+#if defined(VOICEQWIK_TRACE) && VOICEQWIK_TRACE
+            // Dump the recent trace history for chrome://tracing / Perfetto
+            if (wParam == 'T' || wParam == 't') {
+                if (Tracer::GetInstance().DumpChromeTrace("VoiceQwik_trace.json")) {
+                    LOG_INFO("Trace written to VoiceQwik_trace.json");
+                } else {
+                    LOG_ERROR("Failed to write VoiceQwik_trace.json");
+                }
+            }
+#endif
             break;
 
         default:
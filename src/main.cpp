@@ -1,23 +1,60 @@
+#include <platform/Win32.h>
 #include <utils/Common.h>
 #include <utils/Logger.h>
-#include <audio/WasapiAudioEngine.h>
+#include <utils/Metrics.h>
+#include <utils/RealtimeCheck.h>
+#include <utils/ThreadRuntime.h>
+#include <networking/LatencyProbe.h>
+#include <utils/Trace.h>
+#include <audio/AudioEngine.h>
+#include <audio/SoftwareAudioDevice.h>
+#include <audio/WasapiAudioDevice.h>
+#include <audio/AudioMixer.h>
+#include <audio/AudioTap.h>
+#include <audio/CallRecorder.h>
 #include <networking/PeerNetwork.h>
 #include <networking/AudioStreamer.h>
 #include <gui/GuiWindow.h>
 #include <thread>
 #include <chrono>
+#include <cmath>
+#include <cstdlib>
 
 class VoiceQwikApplication {
 public:
-    bool Initialize(HINSTANCE hInstance) {
+    VoiceQwikApplication() : measureLatency(false), inCall(false) {
+        // Full size up front: the mix loop is real-time and does not allocate
+        receivedAudio.reserve(MAX_SAMPLES_PER_PACKET);
+        mixedAudio.reserve(MAX_SAMPLES_PER_PACKET);
+    }
+
+    bool Initialize(HINSTANCE hInstance, bool latencyMode, const std::string& impairProfile, uint64_t impairSeed,
+                    const std::string& audioDeviceSpec) {
+        measureLatency = latencyMode;
         LOG_INFO("=== VoiceQwik Application Starting ===");
 
         // Initialize logger
         Logger::GetInstance().SetLogFile("VoiceQwik.log");
 
-        // Initialize audio engine
-        if (!WasapiAudioEngine::GetInstance().Initialize()) {
-            LOG_ERROR("Failed to initialize WASAPI Audio Engine");
+#if defined(VOICEQWIK_TRACE) && VOICEQWIK_TRACE
+        // Trace builds record from startup; the GUI dumps on demand
+        TRACE_THREAD_NAME("main");
+        Tracer::GetInstance().Start();
+#endif
+
+        // Initialize audio engine on the default endpoints, or a software device for testing
+        std::unique_ptr<AudioDevice> audioDevice;
+        if (audioDeviceSpec.empty() || audioDeviceSpec == "wasapi") {
+            audioDevice.reset(new WasapiAudioDevice());
+        } else {
+            audioDevice = CreateSoftwareAudioDevice(audioDeviceSpec);
+            if (!audioDevice) {
+                LOG_ERROR("Unknown audio device: " + audioDeviceSpec);
+                return false;
+            }
+        }
+        if (!AudioEngine::GetInstance().Initialize(std::move(audioDevice))) {
+            LOG_ERROR("Failed to initialize Audio Engine");
             return false;
         }
 
@@ -43,6 +80,22 @@ public:
         PeerNetwork::GetInstance().SetExpectedParticipants(
             GuiWindow::GetInstance().GetSelectedParticipantCount());
 
+        // Measurement mode: timestamped packets, clock sync and device markers
+        if (measureLatency) {
+            AudioStreamer::GetInstance().SetLatencyMeasurement(true);
+            AudioEngine::GetInstance().SetLatencyMarkers(true);
+        }
+
+        // Loopback testing over an emulated bad network
+        if (!impairProfile.empty()) {
+            const ImpairmentProfile* profile = FindImpairmentProfile(impairProfile);
+            if (!profile) {
+                LOG_ERROR("Unknown impairment profile: " + impairProfile);
+                return false;
+            }
+            AudioStreamer::GetInstance().SetImpairment(profile, impairSeed);
+        }
+
         LOG_INFO("Application initialized successfully");
         return true;
     }
@@ -52,9 +105,9 @@ public:
 
         GuiWindow::GetInstance().Show();
 
-        // Start WASAPI capture and playback
-        WasapiAudioEngine::GetInstance().StartCapture();
-        WasapiAudioEngine::GetInstance().StartPlayback();
+        // Start audio capture and playback
+        AudioEngine::GetInstance().StartCapture();
+        AudioEngine::GetInstance().StartPlayback();
 
         // Start listening for incoming connections
         PeerNetwork::GetInstance().StartListening(DEFAULT_AUDIO_PORT);
@@ -69,21 +122,61 @@ public:
                 std::string ip;
                 uint16_t port = DEFAULT_AUDIO_PORT;
                 if (ParseHostPort(remotePeer, ip, port)) {
-                    GuiWindow::GetInstance().SetConnectionStatus("Connecting to " + ip + ":" + std::to_string(port) + "...");
+                    std::string target = FormatHostPort(ip, port);
+                    GuiWindow::GetInstance().SetConnectionStatus("Connecting to " + target + "...");
                     if (PeerNetwork::GetInstance().ConnectToPeer(ip, port)) {
-                        GuiWindow::GetInstance().SetConnectionStatus("Connected to " + ip + ":" + std::to_string(port));
+                        GuiWindow::GetInstance().SetConnectionStatus("Connected to " + target);
                     } else {
-                        GuiWindow::GetInstance().SetConnectionStatus("Failed to connect to " + ip + ":" + std::to_string(port));
+                        GuiWindow::GetInstance().SetConnectionStatus("Failed to connect to " + target);
                     }
                 } else {
-                    GuiWindow::GetInstance().SetConnectionStatus("Invalid address. Use IP:port");
+                    GuiWindow::GetInstance().SetConnectionStatus("Invalid address. Use IP:port or [IPv6]:port");
                 }
             }
 
-            // Process audio if connections are ready
-            if (PeerNetwork::GetInstance().IsAllPeersConnected()) {
+            // Frame capture at whatever packet time the handshake settled on
+            AudioEngine::GetInstance().SetPacketTime(
+                PeerNetwork::GetInstance().GetSessionPacketTime());
+
+            // In a call as long as anyone is connected: each peer's audio flows
+            // once its path answers, and one leaving does not stop the others
+            int connectedPeers = PeerNetwork::GetInstance().GetConnectedPeersCount();
+            if (connectedPeers > 0) {
+                if (!inCall) {
+                    inCall = true;
+                    ThreadRuntime::GetInstance().BeginCall();
+                }
                 ProcessAudio();
-                GuiWindow::GetInstance().SetConnectionStatus("In call");
+                int waitingFor = PeerNetwork::GetInstance().GetExpectedParticipants() - 1 - connectedPeers;
+                GuiWindow::GetInstance().SetConnectionStatus(
+                    waitingFor > 0 ? "In call, waiting for " + std::to_string(waitingFor) + " more" : "In call");
+            } else {
+                if (inCall) {
+                    inCall = false;
+                    ThreadRuntime::GetInstance().EndCall();
+                }
+                // Nobody to send to yet: don't let the call start with stale audio
+                AudioEngine::GetInstance().DiscardCapture();
+            }
+
+            // Publish call metrics for Prometheus and the GUI
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastMetricsExport >= std::chrono::milliseconds(METRICS_EXPORT_INTERVAL_MS)) {
+                lastMetricsExport = now;
+                ThreadRuntime::GetInstance().PublishSchedulingStats();
+                MetricsRegistry::GetInstance().WritePrometheusFile("VoiceQwik_metrics.prom");
+                PublishLoudnessGains();
+                GuiWindow::GetInstance().SetStatsLine(MetricsRegistry::GetInstance().FormatStatsLine());
+            }
+
+            if (measureLatency && now - lastLatencyReport >= std::chrono::milliseconds(LATENCY_REPORT_INTERVAL_MS)) {
+                lastLatencyReport = now;
+                // A line per peer: one record would cut a report for several
+                std::string report = MetricsRegistry::GetInstance().FormatLatencyReport();
+                size_t start = 0;
+                for (size_t end; (end = report.find('\n', start)) != std::string::npos; start = end + 1) {
+                    LOG_INFO("Latency report: " + report.substr(start, end - start));
+                }
             }
 
             // Small sleep to reduce CPU usage
@@ -96,67 +189,182 @@ public:
     void Shutdown() {
         LOG_INFO("Shutting down application");
 
-        WasapiAudioEngine::GetInstance().Shutdown();
+        CallRecorder::GetInstance().Stop();
+        AudioTap::GetInstance().Stop();
+        AudioEngine::GetInstance().Shutdown();
         PeerNetwork::GetInstance().Shutdown();
         AudioStreamer::GetInstance().Shutdown();
+        ThreadRuntime::GetInstance().EndCall();
 
         LOG_INFO("=== VoiceQwik Application Ended ===");
     }
 
-private:
-    // Very small helper: parse "ip:port" with default port fallback
-    bool ParseHostPort(const std::string& input, std::string& ip, uint16_t& port) {
-        if (input.empty()) return false;
+    void SetLoudnessNormalization(bool enabled) {
+        mixer.SetLoudnessNormalization(enabled);
+    }
 
-        auto colonPos = input.find(':');
-        if (colonPos == std::string::npos) {
-            ip = input;
-        } else {
-            ip = input.substr(0, colonPos);
-            try {
-                int parsedPort = std::stoi(input.substr(colonPos + 1));
-                if (parsedPort > 0 && parsedPort < 65536) {
-                    port = static_cast<uint16_t>(parsedPort);
-                }
-            } catch (...) {
-                return false;
+private:
+    // The mixer's per-peer normalization gains, for the peers' metrics
+    void PublishLoudnessGains() {
+        PeerList peers = PeerNetwork::GetInstance().GetPeers();
+        for (const auto& peer : *peers) {
+            float gainDb = 0.0f;
+            PeerMetrics* peerMetrics = MetricsRegistry::GetInstance().FindPeer(peer.id);
+            if (peerMetrics && mixer.GetSourceGainDb(peer.id, gainDb)) {
+                peerMetrics->loudnessGainCentibels.Set((int64_t)std::lround(gainDb * 10.0f));
             }
         }
-
-        sockaddr_in addr{};
-        return inet_pton(AF_INET, ip.c_str(), &addr.sin_addr) == 1;
     }
 
     void ProcessAudio() {
-        // Get audio from microphone
+        TRACE_SCOPE("process_audio");
+
+        // Send every captured packet to peers
         AudioBuffer capturedAudio;
-        
-        // In a full implementation, would capture from WASAPI here
-        // For now, this is a placeholder for the audio processing loop
-        
-        // Send to peers if we have audio data
-        // AudioStreamer::GetInstance().SendAudioToPeers(capturedAudio);
-        
-        // Receive audio from peers and queue for playback
-        auto& peers = PeerNetwork::GetInstance().GetPeers();
-        for (const auto& peer : peers) {
-            AudioBuffer receivedAudio;
-            if (AudioStreamer::GetInstance().ReceiveAudioFromPeer(peer.id, receivedAudio)) {
-                if (!GuiWindow::GetInstance().IsMuted()) {
-                    WasapiAudioEngine::GetInstance().QueuePlaybackBuffer(receivedAudio);
+        int64_t captureMicros = 0;
+        size_t capturedPackets = 0;
+        while (AudioEngine::GetInstance().GetCaptureBuffer(capturedAudio, captureMicros)) {
+            AudioStreamer::GetInstance().SendAudioToPeers(capturedAudio, captureMicros);
+            AudioTap::GetInstance().PublishCapture(capturedAudio, captureMicros);
+            capturedPackets++;
+        }
+
+        // Receive audio from peers, mix one packet per peer at a time and queue
+        // the mix for playback. One mix per captured packet plays as much as
+        // the device clock moved on, whatever the peers pack into each RTP
+        // packet; more only while a peer has a backlog to work off.
+        PeerList peers = PeerNetwork::GetInstance().GetPeers();
+        mixer.SetMasterGain(GuiWindow::GetInstance().GetVolumeGain());
+        AudioStreamer& streamer = AudioStreamer::GetInstance();
+        for (size_t mixes = 0; mixes < capturedPackets || streamer.HasPlayoutBacklog(); mixes++) {
+            RT_SCOPE();
+            TRACE_SCOPE("mix");
+            MetricStageTimer stageTimer(MetricStage::Mix);
+            mixer.Begin();
+            for (const auto& peer : *peers) {
+                if (streamer.ReceiveAudioFromPeer(peer.id, receivedAudio)) {
+                    mixer.AddSource(peer.id, receivedAudio);
+                    CallRecorder::GetInstance().RecordSource(peer.id, receivedAudio);
+                    AudioTap::GetInstance().PublishSource(peer.id, receivedAudio);
                 }
             }
+
+            if (!mixer.Finish(mixedAudio)) break;
+            CallRecorder::GetInstance().RecordMix(mixedAudio);
+            AudioTap::GetInstance().PublishMix(mixedAudio);
+
+            if (!GuiWindow::GetInstance().IsMuted()) {
+                AudioEngine::GetInstance().QueuePlaybackBuffer(mixedAudio);
+            }
         }
     }
+
+    AudioMixer mixer;
+    AudioBuffer receivedAudio;
+    AudioBuffer mixedAudio;
+
+    std::chrono::steady_clock::time_point lastMetricsExport;
+    std::chrono::steady_clock::time_point lastLatencyReport;
+    bool measureLatency;
+    bool inCall;
 };
 
+// Value of a "--name=value" switch (ASCII), empty if absent
+static std::string CommandLineValue(PWSTR commandLine, const wchar_t* prefix) {
+    std::string value;
+    const wchar_t* found = commandLine ? wcsstr(commandLine, prefix) : nullptr;
+    if (!found) return value;
+    for (const wchar_t* p = found + wcslen(prefix); *p && *p != L' '; p++) {
+        value += (char)*p;
+    }
+    return value;
+}
+
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine, int nCmdShow) {
     VoiceQwikApplication app;
 
-    if (!app.Initialize(hInstance)) {
+    // --measure-latency: mouth-to-ear breakdown in the log and metrics
+    bool measureLatency = pCmdLine && wcsstr(pCmdLine, L"--measure-latency") != nullptr;
+
+    // --impair=<profile> [--impair-seed=<n>]: impair received audio (see NetworkImpairment.h)
+    std::string impairProfile = CommandLineValue(pCmdLine, L"--impair=");
+    std::string impairSeed = CommandLineValue(pCmdLine, L"--impair-seed=");
+    uint64_t seed = impairSeed.empty() ? 1 : std::strtoull(impairSeed.c_str(), nullptr, 10);
+
+    // --audio-device=null|tone|loopback[:ms]|wav:in.wav[,out.wav]: no sound card (see AudioDevice.h)
+    std::string audioDevice = CommandLineValue(pCmdLine, L"--audio-device=");
+
+    // --record=<file.wav>: record the call, mix plus one channel per participant
+    std::string recordFile = CommandLineValue(pCmdLine, L"--record=");
+
+    // --tap=<name>: publish the call's audio to shared memory for other processes (voiceqwik_tap_reader)
+    std::string tapName = CommandLineValue(pCmdLine, L"--tap=");
+
+    // --capture=<file.pcapng>: capture the audio socket for voiceqwik_replay and Wireshark
+    std::string captureFile = CommandLineValue(pCmdLine, L"--capture=");
+
+    // --aec=off: no echo cancellation, e.g. on a headset
+    bool echoCancellation = CommandLineValue(pCmdLine, L"--aec=") != "off";
+
+    // --ns=off: send capture without noise suppression
+    bool noiseSuppression = CommandLineValue(pCmdLine, L"--ns=") != "off";
+
+    // --agc=off: no automatic gain on capture and no loudness normalization of peers
+    bool automaticGain = CommandLineValue(pCmdLine, L"--agc=") != "off";
+
+    // --encrypt=off: no media encryption offer; media to and from every peer in the clear
+    bool mediaEncryption = CommandLineValue(pCmdLine, L"--encrypt=") != "off";
+
+    // --room-secret=<text>: bind the media keys to a secret every participant was given;
+    // without one, encryption is not authenticated (shown in the stats line)
+    std::string roomSecret = CommandLineValue(pCmdLine, L"--room-secret=");
+    if (!roomSecret.empty() && !mediaEncryption) {
+        MessageBox(nullptr, L"--room-secret needs media encryption", L"Error", MB_ICONERROR);
+        return 1;
+    }
+
+    // --ptime=2.5|5|10|20|40: preferred packet time. Given here, the audio device
+    // also opens at that period when it is under 10 ms; picked later in the
+    // window, it only changes how capture is cut into packets.
+    double ptimeMs = std::atof(CommandLineValue(pCmdLine, L"--ptime=").c_str());
+    for (PacketTime ptime : ALL_PACKET_TIMES) {
+        if (std::fabs(PacketTimeMicros(ptime) / 1000.0 - ptimeMs) < 0.01) {
+            AudioEngine::GetInstance().SetPacketTime(ptime);
+            PeerNetwork::GetInstance().SetPreferredPacketTime(ptime);
+        }
+    }
+
+    // --rt=off: audio and network threads at normal priority
+    // --lock-memory: lock the process's memory while a call is up (never outside one)
+    // --audio-cpu=<n> --network-cpu=<n>: pin the device and receive threads
+    ThreadRuntimeConfig threadConfig;
+    threadConfig.realtime = CommandLineValue(pCmdLine, L"--rt=") != "off";
+    threadConfig.lockMemory = pCmdLine && wcsstr(pCmdLine, L"--lock-memory") != nullptr;
+    std::string audioCpu = CommandLineValue(pCmdLine, L"--audio-cpu=");
+    std::string networkCpu = CommandLineValue(pCmdLine, L"--network-cpu=");
+    if (!audioCpu.empty()) threadConfig.audioCpu = std::atoi(audioCpu.c_str());
+    if (!networkCpu.empty()) threadConfig.networkCpu = std::atoi(networkCpu.c_str());
+    ThreadRuntime::GetInstance().Configure(threadConfig);
+
+    if (!app.Initialize(hInstance, measureLatency, impairProfile, seed, audioDevice)) {
         MessageBox(nullptr, L"Failed to initialize VoiceQwik", L"Error", MB_ICONERROR);
         return 1;
     }
+    PeerNetwork::GetInstance().SetMediaEncryption(mediaEncryption);
+    PeerNetwork::GetInstance().SetRoomSecret(roomSecret);
+    AudioEngine::GetInstance().SetEchoCancellation(echoCancellation);
+    AudioEngine::GetInstance().SetNoiseSuppression(noiseSuppression);
+    AudioEngine::GetInstance().SetAutomaticGain(automaticGain);
+    app.SetLoudnessNormalization(automaticGain);
+    if (!recordFile.empty()) {
+        CallRecorder::GetInstance().Start(recordFile);
+    }
+    if (!tapName.empty()) {
+        AudioTap::GetInstance().Start(tapName);
+    }
+    if (!captureFile.empty()) {
+        AudioStreamer::GetInstance().StartPacketCapture(captureFile);
+    }
 
     try {
         app.Run();
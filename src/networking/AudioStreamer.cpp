@@ -1,8 +1,27 @@
 #include <networking/AudioStreamer.h>
 #include <networking/PeerNetwork.h>
 #include <utils/Logger.h>
+#include <utils/Metrics.h>
+#include <utils/RealtimeCheck.h>
+#include <utils/ThreadRuntime.h>
+#include <utils/Trace.h>
+#include <platform/Random.h>
+#include <platform/Timer.h>
+#include <algorithm>
+#include <cstdio>
 #include <cstring>
-#include <ctime>
+#include <iterator>
+
+// Zero stays free to mean "none yet" in the receive state
+static uint32_t RandomSsrc(uint32_t avoid) {
+    uint32_t ssrc = 0;
+    while (ssrc == 0 || ssrc == avoid) {
+        if (!FillRandomBytes(&ssrc, sizeof(ssrc))) {
+            ssrc = std::random_device()();
+        }
+    }
+    return ssrc;
+}
 
 AudioStreamer& AudioStreamer::GetInstance() {
     static AudioStreamer instance;
@@ -10,34 +29,41 @@ AudioStreamer& AudioStreamer::GetInstance() {
 }
 
 AudioStreamer::AudioStreamer()
-    : audioSocket(INVALID_SOCKET), audioPort(DEFAULT_AUDIO_PORT),
-      receiving(false), rtpSequence(0), rtpTimestamp(0) {
-    
-    // Generate random SSRC
-    srand((unsigned int)time(nullptr));
-    rtpSSRC = rand();
+    : audioSocket(INVALID_SOCKET_HANDLE), audioPort(DEFAULT_AUDIO_PORT), audioFamily(AF_INET),
+      receiving(false), sendStatesPacketTime(DEFAULT_PACKET_TIME), latencyMeasurement(false),
+      impairmentSenderCount(0), impairmentSenderNext(0), rtpTimestamp(0),
+      lastSentRtpTimestamp(0), lastSentMicros(0), averageRtcpSize(0.0) {
+
+    // From the OS source: peers started together must not share a seed. The
+    // CNAME keeps the first SSRC even if a collision replaces it.
+    uint32_t ssrc = RandomSsrc(0);
+    rtpSSRC = ssrc;
+    ssrcCollision = false;
+    byeSsrc = 0;
+    rtcpRandom.seed(ssrc);
+    rtcpCname = "voiceqwik-" + std::to_string(ssrc);
 }
 
 AudioStreamer::~AudioStreamer() {
     Shutdown();
 }
 
-bool AudioStreamer::Initialize() {
+bool AudioStreamer::Initialize(uint16_t port) {
     LOG_INFO("Initializing Audio Streamer");
 
-    WSADATA wsaData;
-    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (result != 0) {
-        LOG_ERROR("WSAStartup failed for AudioStreamer: " + std::to_string(result));
+    if (!SocketStartup()) {
+        LOG_ERROR("Socket startup failed for AudioStreamer: " + std::to_string(GetLastSocketError()));
         return false;
     }
 
-    if (!CreateAudioSocket(DEFAULT_AUDIO_PORT)) {
-        WSACleanup();
+    if (!CreateAudioSocket(port)) {
+        SocketCleanup();
         return false;
     }
 
-    // Start receiving loop on a non-blocking socket so shutdown stays responsive
+    // Start receiving loop on a non-blocking socket so shutdown stays responsive.
+    // Its 1 ms waits pace clock sync and impaired delivery; keep them 1 ms on Windows.
+    AcquireTimerResolution();
     receiving = true;
     receiverThread = std::thread(&AudioStreamer::ReceiverThreadProc, this);
 
@@ -52,182 +78,1229 @@ void AudioStreamer::Shutdown() {
 
     if (receiverThread.joinable()) {
         receiverThread.join();
+        ReleaseTimerResolution();
     }
+    receivePeers.reset();
+
+    // Both capturing threads are done: the receiver has joined and the
+    // caller is the sender
+    packetCapture.Close();
 
-    CloseAudioSocket();
-    WSACleanup();
+    {
+        std::lock_guard<std::mutex> lock(impairmentMutex);
+        LogImpairmentStats();
+    }
+
+    if (audioSocket != INVALID_SOCKET_HANDLE) {
+        CloseAudioSocket();
+        SocketCleanup();
+    }
 }
 
 bool AudioStreamer::CreateAudioSocket(uint16_t port) {
-    audioSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (audioSocket == INVALID_SOCKET) {
-        LOG_ERROR("Failed to create audio socket");
+    // One dual-stack socket serves every local interface and both IP versions
+    audioSocket = OpenDualStackSocket(SOCK_DGRAM, IPPROTO_UDP, port, audioFamily);
+    if (audioSocket == INVALID_SOCKET_HANDLE) {
+        LOG_ERROR("Failed to create and bind audio socket");
         return false;
     }
 
     // Non-blocking so the receive loop can exit promptly on shutdown
-    u_long nonBlocking = 1;
-    if (ioctlsocket(audioSocket, FIONBIO, &nonBlocking) == SOCKET_ERROR) {
+    if (!SetSocketBlocking(audioSocket, false)) {
         LOG_ERROR("Failed to set audio socket to non-blocking");
-        closesocket(audioSocket);
-        audioSocket = INVALID_SOCKET;
-        return false;
-    }
-
-    // Set socket to reuse address
-    int reuseAddr = 1;
-    if (setsockopt(audioSocket, SOL_SOCKET, SO_REUSEADDR,
-                   (const char*)&reuseAddr, sizeof(reuseAddr)) == SOCKET_ERROR) {
-        LOG_ERROR("Failed to set SO_REUSEADDR on audio socket");
-        closesocket(audioSocket);
-        audioSocket = INVALID_SOCKET;
+        CloseAudioSocket();
         return false;
     }
 
     // Set socket buffer sizes for low latency
-    int recvBufSize = 128 * 1024;  // 128KB
-    int sendBufSize = 128 * 1024;
-    setsockopt(audioSocket, SOL_SOCKET, SO_RCVBUF,
-               (const char*)&recvBufSize, sizeof(recvBufSize));
-    setsockopt(audioSocket, SOL_SOCKET, SO_SNDBUF,
-               (const char*)&sendBufSize, sizeof(sendBufSize));
-
-    // Bind socket
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port);
-
-    if (bind(audioSocket, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
-        LOG_ERROR("Failed to bind audio socket");
-        closesocket(audioSocket);
-        audioSocket = INVALID_SOCKET;
-        return false;
-    }
+    SetSocketOption(audioSocket, SOL_SOCKET, SO_RCVBUF, 128 * 1024);
+    SetSocketOption(audioSocket, SOL_SOCKET, SO_SNDBUF, 128 * 1024);
 
     audioPort = port;
 
-    LOG_INFO("Audio socket created and bound to port " + std::to_string(port));
+    LOG_INFO("Audio socket created and bound to port " + std::to_string(port) +
+             (audioFamily == AF_INET6 ? " (IPv4 and IPv6)" : " (IPv4 only)"));
     return true;
 }
 
 void AudioStreamer::CloseAudioSocket() {
-    if (audioSocket != INVALID_SOCKET) {
-        closesocket(audioSocket);
-        audioSocket = INVALID_SOCKET;
+    if (audioSocket != INVALID_SOCKET_HANDLE) {
+        CloseSocket(audioSocket);
+        audioSocket = INVALID_SOCKET_HANDLE;
     }
 }
 
-bool AudioStreamer::SendAudioToPeers(const AudioBuffer& buffer) {
-    if (audioSocket == INVALID_SOCKET) {
+bool AudioStreamer::SendAudioToPeers(const AudioBuffer& buffer, int64_t captureMicros) {
+    if (audioSocket == INVALID_SOCKET_HANDLE) {
         return false;
     }
 
-    // Build RTP packet
-    RTPHeader header{};
-    BuildRTPHeader(header);
+    TRACE_SCOPE_VALUE("send", buffer.size());
+    MetricStageTimer stageTimer(MetricStage::Send);
 
-    // Construct packet: RTP header + audio data
-    size_t packetSize = sizeof(header) + buffer.size() * sizeof(int16_t);
-    uint8_t* packet = new uint8_t[packetSize];
+    if (buffer.size() * sizeof(int16_t) > MAX_RTP_PAYLOAD_SIZE) {
+        LOG_ERROR_FMT("Audio buffer exceeds the maximum packet time: {} samples", buffer.size());
+        return false;
+    }
 
-    std::memcpy(packet, &header, sizeof(header));
-    std::memcpy(packet + sizeof(header), buffer.data(), buffer.size() * sizeof(int16_t));
+    // RTP clock runs once per capture packet, shared by every peer's stream
+    uint32_t timestamp = rtpTimestamp;
+    rtpTimestamp += (uint32_t)(buffer.size() / AUDIO_CHANNELS);
 
-    // Send to all connected peers
-    const auto& peers = PeerNetwork::GetInstance().GetPeers();
-    for (const auto& peer : peers) {
-        sockaddr_in peerAddr{};
-        peerAddr.sin_family = AF_INET;
-        peerAddr.sin_port = htons(peer.audioPort);
-        inet_pton(AF_INET, peer.ipAddress.c_str(), &peerAddr.sin_addr);
+    PacketTime ptime = PeerNetwork::GetInstance().GetSessionPacketTime();
+    int64_t nowMicros = LatencyClockMicros();
+
+    PeerList peers = PeerNetwork::GetInstance().GetPeers();
+    PeerID decisionPeers[MAX_PARTICIPANTS];
+    RateDecisionRecord decisions[MAX_PARTICIPANTS];
+    size_t decisionCount = 0;
+    {
+        // Shared with RTCP feedback, a few times a second
+        std::lock_guard<std::mutex> lock(sendMutex);
+        SyncSendStates(peers, ptime);
 
-        int result = sendto(audioSocket, (const char*)packet, (int)packetSize, 0,
-                          (const sockaddr*)&peerAddr, sizeof(peerAddr));
+        RT_SCOPE();
+        for (const auto& peer : *peers) {
+            auto it = sendStates.find(peer.id);
+            if (it == sendStates.end()) continue;
+            PeerSendState& send = it->second;
 
-        if (result == SOCKET_ERROR) {
-            int error = WSAGetLastError();
-            LOG_ERROR("Failed to send audio to peer " + std::to_string(peer.id) +
-                     ": " + std::to_string(error));
+            RateDecisionRecord record;
+            if (send.controller.OnTick(nowMicros, record) && decisionCount < (size_t)MAX_PARTICIPANTS) {
+                decisionPeers[decisionCount] = peer.id;
+                decisions[decisionCount++] = record;
+            }
+
+            // Nothing goes down a dead path; the sequence picks up where it stopped
+            if (IsMediaHeld(peer)) {
+                send.pendingPackets = 0;
+                continue;
+            }
+
+            // Collect capture packets until the configured packet time is reached
+            if (send.pendingPackets == 0) {
+                send.pending.clear();
+                send.pendingTimestamp = timestamp;
+                send.pendingCaptureMicros = captureMicros;
+            }
+            send.pending.insert(send.pending.end(), buffer.begin(), buffer.end());
+            if (++send.pendingPackets < send.controller.GetConfig().packetsPerRtp &&
+                send.pending.size() + buffer.size() <= MAX_SAMPLES_PER_PACKET) {
+                continue;
+            }
+
+            SendToPeer(peer, send);
+            send.pendingPackets = 0;
         }
     }
 
-    delete[] packet;
+    // Logged once out of the real-time part
+    for (size_t i = 0; i < decisionCount; i++) {
+        LOG_INFO(FormatRateDecision(decisionPeers[i], decisions[i], ptime));
+        if (PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(decisionPeers[i])) {
+            metrics->rateDecisions.Add();
+            metrics->sendBitrate.Set(decisions[i].bitrate);
+        }
+    }
+
+    lastSentRtpTimestamp.store(timestamp, std::memory_order_relaxed);
+    lastSentMicros.store(nowMicros, std::memory_order_relaxed);
+
     return true;
 }
 
+void AudioStreamer::SyncSendStates(const std::shared_ptr<const std::vector<PeerInfo>>& peers, PacketTime ptime) {
+    if (peers == sendStatesPeers && ptime == sendStatesPacketTime) return;
+    sendStatesPeers = peers;
+    sendStatesPacketTime = ptime;
+
+    for (const auto& peer : *peers) {
+        auto it = sendStates.find(peer.id);
+        if (it != sendStates.end() && it->second.capturePacketTime == ptime) continue;
+
+        // The new stream restarts its sequence but not its encryption index (no nonce reuse)
+        uint32_t protectIndex = it != sendStates.end() ? it->second.protectIndex : 0;
+        sendStates.erase(peer.id);
+        PeerSendState& send = sendStates.emplace(peer.id, PeerSendState(ptime)).first->second;
+        send.protectIndex = protectIndex;
+        send.pending.reserve(MAX_SAMPLES_PER_PACKET);
+    }
+
+    // A peer that left takes its stream with it
+    for (auto it = sendStates.begin(); it != sendStates.end();) {
+        PeerID id = it->first;
+        bool present = std::any_of(peers->begin(), peers->end(), [id](const PeerInfo& p) { return p.id == id; });
+        it = present ? std::next(it) : sendStates.erase(it);
+    }
+}
+
+void AudioStreamer::SendToPeer(const PeerInfo& peer, PeerSendState& send) {
+    const StreamConfig& config = send.controller.GetConfig();
+
+    // Encode the primary payload
+    size_t encodedSize = EncodePayload(config.encoding, send.pending.data(), send.pending.size(), encodeBuffer.data());
+    uint8_t primaryType = PayloadTypeForEncoding(config.encoding);
+
+    RTPHeader header{};
+    BuildRTPHeader(header, send, primaryType);
+
+    bool withTimestamps = latencyMeasurement && send.pendingCaptureMicros != 0;
+    size_t headerSize = RTP_HEADER_SIZE + (withTimestamps ? LATENCY_EXTENSION_SIZE : 0);
+
+    uint8_t* packet = sendBuffer.data();
+    uint8_t* payload = packet + headerSize;
+    size_t capacity = MAX_RTP_PACKET_SIZE - headerSize;   // the rest is for the encryption trailer
+    size_t payloadSize = 0;
+
+    // RFC 2198: the previous payloads first (oldest first), then this one.
+    // Only an unbroken run of immediately preceding packets is usable, since
+    // the receiver maps blocks to sequence numbers by position.
+    if (config.redundancy > 0) {
+        RedundantBlock blocks[RED_MAX_REDUNDANCY + 1];
+        size_t count = 0;
+        size_t usable = 0;
+        while (usable < config.redundancy && usable < send.historyCount &&
+               header.timestamp - send.history[usable].timestamp <= RED_MAX_TIMESTAMP_OFFSET) {
+            usable++;
+        }
+        for (size_t i = usable; i-- > 0;) {
+            const SentPayload& earlier = send.history[i];
+            blocks[count++] = RedundantBlock{earlier.payloadType, header.timestamp - earlier.timestamp,
+                                             earlier.data.data(), earlier.length};
+        }
+        blocks[count++] = RedundantBlock{primaryType, 0, encodeBuffer.data(), encodedSize};
+
+        if (usable > 0) {
+            payloadSize = WriteRedundantPayload(payload, capacity, blocks, count);
+            if (payloadSize > 0) {
+                header.payloadType = RTP_PAYLOAD_TYPE_RED;
+            }
+        }
+    }
+
+    if (payloadSize == 0) {
+        std::memcpy(payload, encodeBuffer.data(), encodedSize);
+        payloadSize = encodedSize;
+    }
+
+    WriteRTPHeader(packet, header, withTimestamps);
+    if (withTimestamps) {
+        LatencyTimestamps stamps{(uint32_t)send.pendingCaptureMicros, (uint32_t)LatencyClockMicros()};
+        WriteLatencyExtension(packet + RTP_HEADER_SIZE, stamps);
+    }
+
+    // Keep this payload for the next packets' redundancy (newest first)
+    if (encodedSize <= RED_MAX_BLOCK_SIZE) {
+        for (size_t i = RED_MAX_REDUNDANCY - 1; i > 0; i--) {
+            send.history[i] = send.history[i - 1];
+        }
+        SentPayload& newest = send.history[0];
+        newest.payloadType = primaryType;
+        newest.timestamp = header.timestamp;
+        newest.length = encodedSize;
+        std::memcpy(newest.data.data(), encodeBuffer.data(), encodedSize);
+        if (send.historyCount < RED_MAX_REDUNDANCY) send.historyCount++;
+    } else {
+        send.historyCount = 0;
+    }
+
+    SocketAddress peerAddr = GetPeerAudioAddress(peer);
+
+    // Captured before encryption, so the capture replays
+    size_t packetSize = headerSize + payloadSize;
+    packetCapture.Capture(CaptureProducer::SendThread, CaptureDirection::Outbound, peerAddr, packet, packetSize);
+
+    // Encrypted in place; the header, extension included, stays readable and authenticated
+    if (peer.encrypted) {
+        if (send.protectIndex == MEDIA_INDEX_LIMIT) return;   // key used up (over a year of packets)
+        packetSize = ProtectMediaPacket(peer.mediaKeys.send, MediaStream::Rtp, send.protectIndex++, packet,
+                                        headerSize, packetSize, sendBuffer.size());
+        if (packetSize == 0) return;
+    }
+
+    SocketAddress sendAddr = peerAddr.ForFamily(audioFamily);
+    int result = (int)sendto(audioSocket, (const char*)packet, (int)packetSize, 0, sendAddr.Get(), sendAddr.length);
+
+    if (result < 0) {
+        int error = GetLastSocketError();
+        LOG_ERROR_FMT("Failed to send audio to peer {}: {}", peer.id, error);
+        return;
+    }
+
+    send.packets++;
+    send.octets += (uint32_t)payloadSize;
+    if (PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(peer.id)) {
+        metrics->packetsSent.Add();
+        metrics->bytesSent.Add(packetSize);
+    }
+}
+
+void AudioStreamer::SetLatencyMeasurement(bool enabled) {
+    if (latencyMeasurement.exchange(enabled) != enabled) {
+        LOG_INFO(std::string("Latency measurement ") + (enabled ? "enabled" : "disabled"));
+    }
+}
+
+bool AudioStreamer::IsLatencyMeasurementEnabled() const {
+    return latencyMeasurement;
+}
+
+void AudioStreamer::SetImpairment(const ImpairmentProfile* profile, uint64_t seed) {
+    std::lock_guard<std::mutex> lock(impairmentMutex);
+    LogImpairmentStats();
+    if (profile) {
+        impairment.reset(new NetworkImpairment(*profile, seed));
+        LOG_INFO("Receive impairment '" + std::string(profile->name) + "' (seed " + std::to_string(seed) +
+                 "): " + profile->description);
+    } else if (impairment) {
+        impairment.reset();
+        LOG_INFO("Receive impairment off");
+    }
+}
+
+bool AudioStreamer::StartPacketCapture(const std::string& filename) {
+    return packetCapture.Open(filename, audioPort);
+}
+
+void AudioStreamer::StopPacketCapture() {
+    packetCapture.Close();
+}
+
+void AudioStreamer::LogImpairmentStats() {
+    if (!impairment) return;
+    const ImpairmentStats& stats = impairment->GetStats();
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "Impairment '%s': %llu in, %llu delivered, %llu lost, %llu queue drops, %llu reordered, %llu duplicated",
+                  impairment->GetProfile().name, (unsigned long long)stats.submitted,
+                  (unsigned long long)stats.delivered, (unsigned long long)stats.lost,
+                  (unsigned long long)stats.queueDrops, (unsigned long long)stats.reordered,
+                  (unsigned long long)stats.duplicated);
+    LOG_INFO(std::string(line));
+}
+
 bool AudioStreamer::ReceiveAudioFromPeer(PeerID peerId, AudioBuffer& buffer) {
-    std::lock_guard<std::mutex> lock(queuesMutex);
-    auto it = receiveQueues.find(peerId);
-    if (it == receiveQueues.end() || it->second.empty()) {
+    RT_SCOPE();
+    TRACE_SCOPE_VALUE("jitter_buffer", peerId);
+
+    std::unique_lock<std::mutex> lock = LockQueues();
+    auto it = receiveStates.find(peerId);
+    if (it == receiveStates.end() || it->second.playout.Empty()) {
         return false;
     }
 
-    buffer = it->second.front();
-    it->second.pop();
+    PeerReceiveState& state = it->second;
+    TRACE_COUNTER("jitter_depth", state.playout.Size());
+
+    // One capture packet's worth: a sender aggregating several per RTP
+    // packet would otherwise mix in longer than the others and outrun the
+    // wall clock
+    int64_t arrivalMicros = 0;
+    size_t frameSamples = SamplesPerPacket(PeerNetwork::GetInstance().GetSessionPacketTime());
+    state.playout.Pop(buffer, arrivalMicros, frameSamples);
+
+    if (PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(peerId)) {
+        metrics->jitterBufferDepth.Set((int64_t)state.playout.Size());
+        if (latencyMeasurement) {
+            metrics->jitterBufferDelayMicros.Record((uint64_t)(LatencyClockMicros() - arrivalMicros));
+        }
+    }
     return true;
 }
 
+bool AudioStreamer::HasPlayoutBacklog() {
+    RT_SCOPE();
+    std::unique_lock<std::mutex> lock = LockQueues();
+    for (const auto& entry : receiveStates) {
+        if (entry.second.playout.Size() > 1) return true;
+    }
+    return false;
+}
+
+std::unique_lock<std::mutex> AudioStreamer::LockQueues() {
+    // The receiver thread and the mixer each hold it to copy one packet
+    RT_ALLOW("queuesMutex is held only briefly, by the receive and mix paths");
+    return std::unique_lock<std::mutex>(queuesMutex);
+}
+
+void AudioStreamer::SyncReceiveStates() {
+    if (receivePeers == receiveStatesPeers) return;
+    receiveStatesPeers = receivePeers;
+
+    const std::vector<PeerInfo>& peers = *receivePeers;
+    auto departed = [&peers](PeerID id) {
+        return std::none_of(peers.begin(), peers.end(), [id](const PeerInfo& peer) { return peer.id == id; });
+    };
+
+    std::lock_guard<std::mutex> lock(queuesMutex);
+    for (const auto& peer : peers) {
+        receiveStates[peer.id];
+    }
+
+    // Peers that left are no longer reported on (nor is their audio played)
+    for (auto it = receiveStates.begin(); it != receiveStates.end();) {
+        it = departed(it->first) ? receiveStates.erase(it) : std::next(it);
+    }
+}
+
 void AudioStreamer::ReceiverThreadProc() {
-    const size_t MAX_PACKET_SIZE = sizeof(RTPHeader) + AUDIO_BUFFER_SIZE * sizeof(int16_t) * 4;
-    uint8_t* recvBuffer = new uint8_t[MAX_PACKET_SIZE];
+    // Receive path is packet-time agnostic: each packet carries whatever ptime
+    // the session negotiated, up to MAX_PACKET_TIME
+    std::array<uint8_t, MAX_PROTECTED_RTP_SIZE> recvBuffer;
+    TRACE_THREAD_NAME("receive");
+    ThreadRuntimeScope runtime(MetricThread::Receive, ThreadPriority::Network);
+
+    auto lastClockSync = std::chrono::steady_clock::now();
+
+    // First report after half the minimum interval (RFC 3550 6.2)
+    auto nextRtcpReport = lastClockSync + std::chrono::milliseconds(
+        (int64_t)(RTCP_MIN_INTERVAL_SECONDS / 2 * 1000));
+    bool initialRtcp = true;
 
     while (receiving) {
-        sockaddr_in senderAddr{};
-        int senderAddrLen = sizeof(senderAddr);
+        // Out here, where taking it (a lock) and dropping the old one (maybe
+        // a free) are allowed; the real-time scopes below only read it
+        receivePeers = PeerNetwork::GetInstance().GetPeers();
+        SyncReceiveStates();
+
+        // The BYE for the old SSRC goes out with the next report, right away
+        if (ssrcCollision) {
+            ssrcCollision = false;
+            ResolveSsrcCollision();
+            nextRtcpReport = std::chrono::steady_clock::now();
+        }
+
+        if (std::chrono::steady_clock::now() >= nextRtcpReport) {
+            double interval = SendRtcpReports(initialRtcp);
+            initialRtcp = false;
+            nextRtcpReport = std::chrono::steady_clock::now() +
+                std::chrono::milliseconds((int64_t)(interval * 1000));
+        }
+
+        if (latencyMeasurement) {
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastClockSync >= std::chrono::milliseconds(CLOCK_SYNC_INTERVAL_MS)) {
+                lastClockSync = now;
+                SendClockSyncRequests();
+            }
+        }
 
-        int bytesReceived = recvfrom(audioSocket, (char*)recvBuffer, (int)MAX_PACKET_SIZE, 0,
-                                    (sockaddr*)&senderAddr, &senderAddrLen);
+        CheckPaths();
 
-        if (bytesReceived == SOCKET_ERROR) {
-            int error = WSAGetLastError();
-            if (error != WSAEWOULDBLOCK) {
-                LOG_ERROR("recvfrom failed: " + std::to_string(error));
+        // Impaired datagrams come back out when the emulated link delivers them
+        {
+            std::lock_guard<std::mutex> lock(impairmentMutex);
+            if (impairment) {
+                ImpairedDatagram datagram;
+                while (impairment->Poll(LatencyClockMicros(), datagram)) {
+                    if (datagram.tag >= impairmentSenderCount) continue;
+                    ProcessDatagram(datagram.data.data(), datagram.data.size(), impairmentSenders[datagram.tag]);
+                }
+            }
+        }
+
+        sockaddr_storage senderStorage{};
+        SocketLength senderAddrLen = sizeof(senderStorage);
+
+        int bytesReceived = (int)recvfrom(audioSocket, (char*)recvBuffer.data(), (int)recvBuffer.size(), 0,
+                                          (sockaddr*)&senderStorage, &senderAddrLen);
+
+        if (bytesReceived < 0) {
+            int error = GetLastSocketError();
+            if (!IsWouldBlockError(error)) {
+                LOG_ERROR_FMT("recvfrom failed: {}", error);
+                SleepMillis(1);
+            } else {
+                // Returns as soon as a datagram arrives
+                WaitSocketReadable(audioSocket, 1);
             }
-            Sleep(1);
             continue;
         }
 
-        if (bytesReceived > (int)sizeof(RTPHeader)) {
-            // Extract audio data (skip RTP header)
-            size_t audioDataSize = bytesReceived - sizeof(RTPHeader);
-            int16_t* audioData = (int16_t*)(recvBuffer + sizeof(RTPHeader));
+        // Decrypted first: capture, impairment and the receive path all see plaintext
+        SocketAddress senderAddr = SocketAddress::FromSockaddr((const sockaddr*)&senderStorage, senderAddrLen);
+        size_t length = (size_t)bytesReceived;
+        if (!UnprotectDatagram(recvBuffer.data(), length, senderAddr)) {
+            continue;
+        }
+        packetCapture.Capture(CaptureProducer::ReceiveThread, CaptureDirection::Inbound, senderAddr,
+                              recvBuffer.data(), length);
+
+        {
+            std::lock_guard<std::mutex> lock(impairmentMutex);
+            if (impairment) {
+                impairment->Submit(LatencyClockMicros(), recvBuffer.data(), length, TagImpairmentSender(senderAddr));
+                continue;
+            }
+        }
+
+        ProcessDatagram(recvBuffer.data(), length, senderAddr);
+    }
+}
+
+uint64_t AudioStreamer::TagImpairmentSender(const SocketAddress& senderAddr) {
+    for (size_t i = 0; i < impairmentSenderCount; i++) {
+        if (impairmentSenders[i] == senderAddr) return i;
+    }
+
+    // Full (paths come and go over a long run): the oldest entry makes way
+    size_t slot = impairmentSenderCount < impairmentSenders.size() ? impairmentSenderCount++ :
+                  impairmentSenderNext++ % impairmentSenders.size();
+    impairmentSenders[slot] = senderAddr;
+    return slot;
+}
+
+bool AudioStreamer::UnprotectDatagram(uint8_t* data, size_t& length, const SocketAddress& senderAddr) {
+    // Clock sync and path checks stay in the clear; neither carries media
+    if (IsClockSync(data, length) || IsPathCheck(data, length)) {
+        return true;
+    }
+
+    RT_SCOPE();
+    const PeerInfo* peer = FindPeerInfoByAddress(senderAddr);
+    if (!peer || !peer->encrypted) {
+        return true;
+    }
+
+    // Everything else from an encrypted peer must authenticate
+    MediaStream stream = MediaStream::Rtp;
+    size_t headerSize = RTCP_AUTHENTICATED_HEADER_SIZE;
+    if (!IsRtcpPacket(data, length)) {
+        RTPHeader header{};
+        size_t payloadSize = 0;
+        if (!ParseRTPHeader(data, length, header, headerSize, payloadSize)) return false;
+    } else {
+        stream = MediaStream::Rtcp;
+    }
+
+    PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(peer->id);
+    ReplayState* replay = FindReplayState(peer->id);
+    uint32_t index = 0;
+    if (!replay || !ReadMediaPacketIndex(data, headerSize, length, index)) {
+        if (metrics) metrics->authFailures.Add();
+        return false;
+    }
+
+    // The window is only moved by packets that authenticate
+    MediaReplayWindow& window = stream == MediaStream::Rtp ? replay->rtp : replay->rtcp;
+    if (!window.Check(index)) {
+        if (metrics) metrics->replayDrops.Add();
+        return false;
+    }
+    if (!UnprotectMediaPacket(peer->mediaKeys.receive, stream, data, headerSize, length)) {
+        if (metrics) metrics->authFailures.Add();
+        return false;
+    }
+    window.Accept(index);
+    return true;
+}
+
+AudioStreamer::ReplayState* AudioStreamer::FindReplayState(PeerID peerId) {
+    ReplayState* claimable = nullptr;
+    const std::vector<PeerInfo>& peers = *receivePeers;
+    for (auto& state : replayStates) {
+        if (state.peerId == peerId) return &state;
+        if (claimable) continue;
+
+        // Peer IDs are never reused, so a departed peer's slot starts over clean
+        bool departed = std::none_of(peers.begin(), peers.end(),
+                                     [&state](const PeerInfo& peer) { return peer.id == state.peerId; });
+        if (state.peerId == 0 || departed) claimable = &state;
+    }
+    if (claimable) {
+        claimable->peerId = peerId;
+        claimable->rtp.Reset();
+        claimable->rtcp.Reset();
+    }
+    return claimable;
+}
+
+void AudioStreamer::ProcessDatagram(const uint8_t* data, size_t length, const SocketAddress& senderAddr) {
+    TRACE_SCOPE_VALUE("receive", length);
+    MetricStageTimer stageTimer(MetricStage::Receive);
+
+    // Clock sync shares the socket; its first byte can never be RTP
+    if (IsClockSync(data, length)) {
+        HandleClockSync(data, length, senderAddr);
+        return;
+    }
+
+    // So are path checks (STUN's first two bits are zero)
+    if (IsPathCheck(data, length)) {
+        HandlePathCheck(data, length, senderAddr);
+        return;
+    }
+
+    // RTCP is muxed on the RTP port (RFC 5761)
+    if (IsRtcpPacket(data, length)) {
+        HandleRtcp(data, length, senderAddr);
+        return;
+    }
+
+    // Audio has the deadline; the control messages above arrive a few times a second
+    RT_SCOPE();
+    RTPHeader header{};
+    size_t headerSize = 0;
+    size_t payloadSize = 0;
+    if (ParseRTPHeader(data, length, header, headerSize, payloadSize) && payloadSize > 0) {
+        LatencyTimestamps stamps{};
+        bool hasStamps = ParseLatencyExtension(data, headerSize, stamps);
+
+        const PeerInfo* sender = FindPeerInfoByAddress(senderAddr);
+        if (sender) {
+            PeerID senderId = sender->id;
+            HandleAudioPayload(senderId, header, hasStamps ? &stamps : nullptr,
+                               data + headerSize, payloadSize, length);
+
+            PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(senderId);
+            if (metrics && metrics->firstAudioMicros.Get() == 0) {
+                metrics->firstAudioMicros.Set(std::max<int64_t>(1, LatencyClockMicros() - sender->joinedMicros));
+            }
+
+            // First audio since the peer's session resumed
+            for (auto& state : pathStates) {
+                if (state.peerId.load(std::memory_order_relaxed) != senderId || state.awaitingAudioSince < 0) continue;
+                state.resumeToAudioMicros = LatencyClockMicros() - state.awaitingAudioSince;
+                state.awaitingAudioSince = -1;
+                if (metrics) metrics->resumeTimeToAudioMicros.Record((uint64_t)state.resumeToAudioMicros);
+            }
+        }
+    }
+}
+
+void AudioStreamer::HandleAudioPayload(PeerID senderId, const RTPHeader& header, const LatencyTimestamps* stamps,
+                                       const uint8_t* payload, size_t payloadSize, size_t packetSize) {
+    PayloadEncoding encoding;
 
-            // Get sender's peer ID (would need to match IP)
-            char senderIP[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &senderAddr.sin_addr, senderIP, INET_ADDRSTRLEN);
+    if (header.payloadType != RTP_PAYLOAD_TYPE_RED) {
+        if (!EncodingForPayloadType(header.payloadType, encoding)) return;
+        size_t samples = DecodePayload(encoding, payload, payloadSize, decodeBuffer.data(), decodeBuffer.size());
+        if (samples > 0) {
+            QueueReceivedPacket(senderId, header, stamps, decodeBuffer.data(), samples, packetSize);
+        }
+        return;
+    }
 
-            // Find peer by IP
-            const auto& peers = PeerNetwork::GetInstance().GetPeers();
-            PeerID senderId = 0;
-            for (const auto& peer : peers) {
-                if (peer.ipAddress == senderIP) {
-                    senderId = peer.id;
-                    break;
+    RedundantBlock blocks[RED_MAX_REDUNDANCY + 1];
+    size_t count = ParseRedundantPayload(payload, payloadSize, blocks, RED_MAX_REDUNDANCY + 1);
+    if (count == 0) return;
+
+    // Primary first so the stream stats see it, then the earlier packets it
+    // repeats, which fill in only where the originals never arrived
+    RTPHeader primary = header;
+    primary.payloadType = blocks[count - 1].payloadType;
+    if (!EncodingForPayloadType(primary.payloadType, encoding)) return;
+    size_t samples = DecodePayload(encoding, blocks[count - 1].data, blocks[count - 1].length,
+                                   decodeBuffer.data(), decodeBuffer.size());
+    if (samples > 0) {
+        QueueReceivedPacket(senderId, primary, stamps, decodeBuffer.data(), samples, packetSize);
+    }
+
+    for (size_t i = 0; i + 1 < count; i++) {
+        if (!EncodingForPayloadType(blocks[i].payloadType, encoding)) continue;
+        samples = DecodePayload(encoding, blocks[i].data, blocks[i].length, decodeBuffer.data(), decodeBuffer.size());
+        if (samples > 0) {
+            QueueRecoveredPacket(senderId, (uint16_t)(header.sequence - (count - 1 - i)), decodeBuffer.data(), samples);
+        }
+    }
+}
+
+PeerID AudioStreamer::FindPeerByAddress(const SocketAddress& addr) const {
+    const PeerInfo* peer = FindPeerInfoByAddress(addr);
+    return peer ? peer->id : 0;
+}
+
+const PeerInfo* AudioStreamer::FindPeerInfoByAddress(const SocketAddress& addr) const {
+    // Any of a peer's paths will do. Peers sharing an address (several
+    // instances on one box) differ by the audio port they announced; the
+    // address alone is the fallback.
+    const PeerInfo* addressMatch = nullptr;
+    const std::vector<PeerInfo>& peers = *receivePeers;
+    for (const auto& peer : peers) {
+        for (size_t i = 0; i < peer.candidateCount; i++) {
+            const SocketAddress& candidate = peer.candidates[i].address;
+            if (!candidate.SameAddress(addr)) continue;
+            if (candidate.Port() == addr.Port()) return &peer;
+            if (!addressMatch) addressMatch = &peer;
+        }
+    }
+    return addressMatch;
+}
+
+SocketAddress AudioStreamer::GetPeerAudioAddress(const PeerInfo& peer) const {
+    size_t selected = 0;
+    for (const auto& state : pathStates) {
+        if (state.peerId.load(std::memory_order_acquire) == peer.id) {
+            selected = state.selected.load(std::memory_order_acquire);
+            break;
+        }
+    }
+    return peer.candidates[selected < peer.candidateCount ? selected : 0].address;
+}
+
+bool AudioStreamer::IsMediaHeld(const PeerInfo& peer) const {
+    if (!peer.pathChecks) return false;
+    for (const auto& state : pathStates) {
+        if (state.peerId.load(std::memory_order_acquire) == peer.id) {
+            return !state.live.load(std::memory_order_acquire);
+        }
+    }
+    return false;   // not checked yet; CheckPaths claims a slot first thing
+}
+
+void AudioStreamer::SendDatagram(CaptureProducer producer, const SocketAddress& address, const uint8_t* data,
+                                 size_t length) {
+    SocketAddress sendAddr = address.ForFamily(audioFamily);
+    if (sendto(audioSocket, (const char*)data, (int)length, 0, sendAddr.Get(), sendAddr.length) >= 0) {
+        packetCapture.Capture(producer, CaptureDirection::Outbound, address, data, length);
+    }
+}
+
+AudioStreamer::PathState* AudioStreamer::ClaimPathState(const PeerInfo& peer) {
+    PathState* claimable = nullptr;
+    const std::vector<PeerInfo>& peers = *receivePeers;
+    for (auto& state : pathStates) {
+        PeerID owner = state.peerId.load(std::memory_order_relaxed);
+        if (owner == peer.id) return &state;
+        if (claimable) continue;
+
+        bool departed = std::none_of(peers.begin(), peers.end(),
+                                     [owner](const PeerInfo& other) { return other.id == owner; });
+        if (owner == 0 || departed) claimable = &state;
+    }
+    if (!claimable) return nullptr;
+
+    ResetPathState(*claimable, peer);
+    claimable->everLive = false;
+    claimable->awaitingAudioSince = -1;
+    claimable->resumeToAudioMicros = -1;
+    claimable->peerId.store(peer.id, std::memory_order_release);
+    return claimable;
+}
+
+void AudioStreamer::ResetPathState(PathState& state, const PeerInfo& peer) {
+    uint8_t preferences[MAX_PATH_CANDIDATES];
+    for (size_t i = 0; i < peer.candidateCount; i++) {
+        preferences[i] = peer.candidates[i].preference;
+    }
+    state.selector.Reset(preferences, peer.candidateCount);
+    state.sessionEpoch = peer.sessionEpoch;
+    state.selected.store(0, std::memory_order_release);
+    state.live.store(false, std::memory_order_release);
+}
+
+void AudioStreamer::CheckPaths() {
+    int64_t nowMicros = LatencyClockMicros();
+    for (const auto& peer : *receivePeers) {
+        // Even a single path is checked, as consent to keep sending on it
+        if (!peer.pathChecks) continue;
+        PathState* state = ClaimPathState(peer);
+        if (!state) continue;
+
+        // A resumed session brings the peer's current addresses
+        if (state->sessionEpoch != peer.sessionEpoch) {
+            ResetPathState(*state, peer);
+            state->awaitingAudioSince = peer.resumedMicros;
+            LOG_INFO_FMT("Peer {} resumed; checking its {} candidate path(s)", peer.id, (int)peer.candidateCount);
+        }
+        if (state->resumeToAudioMicros >= 0) {
+            LOG_INFO_FMT("Peer {} audio back {} ms after its session resumed", peer.id,
+                         state->resumeToAudioMicros / 1000);
+            state->resumeToAudioMicros = -1;
+        }
+
+        size_t candidate = 0;
+        PathCheckMessage request{};
+        uint8_t message[PATH_CHECK_SIZE];
+        while (state->selector.NextCheck(nowMicros, candidate, request)) {
+            WritePathCheck(message, request);
+            SendDatagram(CaptureProducer::ReceiveThread, peer.candidates[candidate].address, message,
+                         sizeof(message));
+        }
+
+        bool live = state->selector.HasWorkingPath(nowMicros);
+        if (live != state->live.load(std::memory_order_relaxed)) {
+            state->live.store(live, std::memory_order_release);
+            if (!live) {
+                LOG_WARNING_FMT("Peer {} not answering on any path; holding its audio", peer.id);
+            } else if (state->everLive) {
+                LOG_INFO_FMT("Peer {} answering again; sending its audio", peer.id);
+            }
+            state->everLive = state->everLive || live;
+        }
+
+        if (!state->selector.Update(nowMicros)) continue;
+        size_t selected = state->selector.GetSelected();
+        state->selected.store((uint8_t)selected, std::memory_order_release);
+
+        int64_t rttMicros = state->selector.GetRttMicros(selected);
+        LOG_INFO_FMT("Peer {} media path: {} ({} us round trip)", peer.id,
+                     FormatHostPort(peer.candidates[selected].address.ToString(), peer.audioPort), rttMicros);
+        if (PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(peer.id)) {
+            metrics->pathSwitches.Add();
+        }
+    }
+
+    // The selected path's round trip, for the metrics
+    for (const auto& state : pathStates) {
+        PeerID peerId = state.peerId.load(std::memory_order_relaxed);
+        if (peerId == 0) continue;
+        int64_t rttMicros = state.selector.GetRttMicros(state.selector.GetSelected());
+        if (PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(peerId)) {
+            if (rttMicros >= 0) metrics->pathRttMicros.Set(rttMicros);
+        }
+    }
+}
+
+void AudioStreamer::HandlePathCheck(const uint8_t* data, size_t length, const SocketAddress& senderAddr) {
+    PathCheckMessage message{};
+    if (!ParsePathCheck(data, length, message)) {
+        return;
+    }
+
+    if (!message.response) {
+        // Answered back to where it came from, which is what measures that
+        // path; only for peers, so the socket reflects nothing for strangers
+        if (!FindPeerInfoByAddress(senderAddr)) return;
+        uint8_t reply[PATH_CHECK_SIZE];
+        message.response = true;
+        WritePathCheck(reply, message);
+        SendDatagram(CaptureProducer::ReceiveThread, senderAddr, reply, sizeof(reply));
+        return;
+    }
+
+    int64_t nowMicros = LatencyClockMicros();
+    for (auto& state : pathStates) {
+        if (state.peerId.load(std::memory_order_relaxed) == 0) continue;
+        if (state.selector.OnResponse(message, nowMicros)) return;
+    }
+}
+
+void AudioStreamer::SendClockSyncRequests() {
+    uint8_t message[CLOCK_SYNC_SIZE];
+
+    for (const auto& peer : *receivePeers) {
+        ClockSyncMessage request{ClockSyncType::Request, LatencyClockMicros(), 0, 0};
+        WriteClockSync(message, request);
+        SendDatagram(CaptureProducer::ReceiveThread, GetPeerAudioAddress(peer), message, sizeof(message));
+    }
+}
+
+void AudioStreamer::HandleClockSync(const uint8_t* data, size_t length, const SocketAddress& senderAddr) {
+    int64_t arrivalMicros = LatencyClockMicros();
+
+    ClockSyncMessage message{};
+    if (!ParseClockSync(data, length, message)) {
+        return;
+    }
+
+    if (message.type == ClockSyncType::Request) {
+        // Answer every request, measuring or not, so peers can always sync
+        uint8_t reply[CLOCK_SYNC_SIZE];
+        message.type = ClockSyncType::Response;
+        message.receiveMicros = arrivalMicros;
+        message.transmitMicros = LatencyClockMicros();
+        WriteClockSync(reply, message);
+        SendDatagram(CaptureProducer::ReceiveThread, senderAddr, reply, sizeof(reply));
+        return;
+    }
+
+    PeerID senderId = FindPeerByAddress(senderAddr);
+    if (senderId == 0) return;
+
+    std::lock_guard<std::mutex> lock(queuesMutex);
+    ClockOffsetEstimator& clockOffset = receiveStates[senderId].clockOffset;
+    clockOffset.AddSample(message.originateMicros, message.receiveMicros,
+                          message.transmitMicros, arrivalMicros);
+
+    if (PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(senderId)) {
+        metrics->clockOffsetMicros.Set(clockOffset.GetOffsetMicros());
+        metrics->clockRoundTripMicros.Set(clockOffset.GetRoundTripMicros());
+    }
+}
+
+void AudioStreamer::QueueReceivedPacket(PeerID senderId, const RTPHeader& header, const LatencyTimestamps* stamps,
+                                        const int16_t* samples, size_t sampleCount, size_t packetSize) {
+    auto now = std::chrono::steady_clock::now();
+    int64_t nowMicros = std::chrono::duration_cast<std::chrono::microseconds>(now.time_since_epoch()).count();
+    uint32_t arrivalTime = (uint32_t)((uint64_t)nowMicros * AUDIO_SAMPLE_RATE / 1000000);
+
+    PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(senderId);
+
+    std::unique_lock<std::mutex> lock = LockQueues();
+    auto it = receiveStates.find(senderId);
+    if (it == receiveStates.end()) return;
+    PeerReceiveState& state = it->second;
+
+    RtpSourceStats::Arrival arrival = state.stats.Update(header.sequence, header.timestamp, arrivalTime);
+    if (arrival == RtpSourceStats::Arrival::Restarted) {
+        // Sender restarted its stream; what is queued belongs to the old one
+        state.playout.Clear();
+    }
+
+    state.remoteSsrc = header.ssrc;
+    if (header.ssrc == rtpSSRC.load(std::memory_order_relaxed)) {
+        ssrcCollision = true;
+    }
+
+    if (metrics) {
+        metrics->ssrc.store(header.ssrc, std::memory_order_relaxed);
+        metrics->packetsReceived.Add();
+        metrics->bytesReceived.Add(packetSize);
+        metrics->packetsLost.Set(state.stats.GetCumulativeLost());
+        metrics->jitterMicros.Set((int64_t)(state.stats.GetJitterExact() * 1e6 / AUDIO_SAMPLE_RATE));
+        if (state.hasArrival) {
+            metrics->interarrivalMicros.Record((uint64_t)std::chrono::duration_cast<std::chrono::microseconds>(
+                now - state.lastArrival).count());
+        }
+        if (arrival == RtpSourceStats::Arrival::Reordered) {
+            metrics->packetsReordered.Add();
+        }
+
+        // Sender-side capture delay needs no clock mapping; the network leg
+        // needs the peer's offset first
+        if (stamps) {
+            metrics->captureDelayMicros.Record((uint32_t)(stamps->sendMicros - stamps->captureMicros));
+            if (state.clockOffset.HasEstimate()) {
+                int64_t sentLocal = state.clockOffset.RemoteToLocal(stamps->sendMicros, nowMicros);
+                if (nowMicros >= sentLocal) {
+                    metrics->networkDelayMicros.Record((uint64_t)(nowMicros - sentLocal));
+                }
+            }
+        }
+    }
+    state.hasArrival = true;
+    state.lastArrival = now;
+
+    // Its playout slot has passed; playing it now would only add delay
+    if (state.playout.IsLate(header.sequence)) {
+        if (metrics) metrics->lateDrops.Add();
+        return;
+    }
+
+    if (arrival == RtpSourceStats::Arrival::Duplicate) {
+        if (metrics) metrics->packetsDuplicated.Add();
+        return;
+    }
+
+    PlayoutQueue::Insert result = state.playout.Add(header.sequence, nowMicros, samples, sampleCount);
+    if (metrics) {
+        if (result == PlayoutQueue::Insert::Duplicate) {
+            metrics->packetsDuplicated.Add();
+        }
+        metrics->jitterBufferDepth.Set((int64_t)state.playout.Size());
+    }
+}
+
+void AudioStreamer::QueueRecoveredPacket(PeerID senderId, uint16_t sequence, const int16_t* samples,
+                                         size_t sampleCount) {
+    PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(senderId);
+
+    std::unique_lock<std::mutex> lock = LockQueues();
+    auto it = receiveStates.find(senderId);
+    if (it == receiveStates.end()) return;
+    PeerReceiveState& state = it->second;
+
+    // Only gaps behind the newest packet are worth filling; anything else
+    // is a copy of a packet we already have or had
+    if (!RtpSequenceBefore(sequence, (uint16_t)state.stats.GetExtendedHighestSequence()) ||
+        state.playout.IsLate(sequence) || state.playout.Contains(sequence)) {
+        return;
+    }
+
+    if (state.playout.Add(sequence, LatencyClockMicros(), samples, sampleCount) == PlayoutQueue::Insert::Queued &&
+        metrics) {
+        metrics->packetsRecovered.Add();
+    }
+}
+
+double AudioStreamer::SendRtcpReports(bool initial) {
+    std::array<uint8_t, MAX_PROTECTED_RTCP_SIZE> packet;
+    RtcpReportBlock blocks[RTCP_MAX_REPORT_BLOCKS];
+    PeerID blockPeers[RTCP_MAX_REPORT_BLOCKS];
+    size_t blockCount = 0;
+    size_t activeSenders = 0;
+    auto now = std::chrono::steady_clock::now();
+    const std::vector<PeerInfo>& peers = *receivePeers;
+    auto departed = [&peers](PeerID id) {
+        return std::none_of(peers.begin(), peers.end(), [id](const PeerInfo& peer) { return peer.id == id; });
+    };
+
+    {
+        std::lock_guard<std::mutex> lock(queuesMutex);
+        for (auto& entry : receiveStates) {
+            PeerReceiveState& state = entry.second;
+            if (!state.stats.IsInitialized() || blockCount == RTCP_MAX_REPORT_BLOCKS) continue;
+
+            // Sources heard from within the last interval count as senders
+            if (state.hasArrival && now - state.lastArrival < std::chrono::seconds((int)RTCP_MIN_INTERVAL_SECONDS * 2)) {
+                activeSenders++;
+            }
+
+            blockPeers[blockCount] = entry.first;
+            RtcpReportBlock& block = blocks[blockCount++];
+            block.ssrc = state.remoteSsrc;
+            block.fractionLost = state.stats.TakeFractionLost();
+            block.cumulativeLost = state.stats.GetCumulativeLost();
+            block.extendedHighestSequence = state.stats.GetExtendedHighestSequence();
+            block.jitter = state.stats.GetJitter();
+            block.lastSenderReport = 0;
+            block.delaySinceLastSenderReport = 0;
+            if (state.hasSenderReport) {
+                double delay = std::chrono::duration<double>(now - state.lastSenderReportArrival).count();
+                block.lastSenderReport = state.lastSenderReportNtp;
+                block.delaySinceLastSenderReport = (uint32_t)(delay * 65536.0);
+            }
+        }
+    }
+
+    // RTP time of "now", extrapolated from the last capture packet sent
+    int64_t sinceLastSend = LatencyClockMicros() - lastSentMicros.load(std::memory_order_relaxed);
+    uint32_t rtpNow = lastSentRtpTimestamp.load(std::memory_order_relaxed) +
+                      (uint32_t)(sinceLastSend * AUDIO_SAMPLE_RATE / 1000000);
+
+    // Each peer gets its own stream, so the SR counts differ per peer: an SR
+    // if we sent that peer media since the last report, RR otherwise. The
+    // only block a peer gets is about the stream it sends us: blocks about
+    // other peers' streams are no use to it, and two of them sharing its
+    // SSRC would pass one's feedback off as the other's.
+    uint32_t ssrc = rtpSSRC.load(std::memory_order_relaxed);
+    bool weSent = false;
+    for (auto it = rtcpProtectIndices.begin(); it != rtcpProtectIndices.end();) {
+        it = departed(it->first) ? rtcpProtectIndices.erase(it) : std::next(it);
+    }
+    for (const auto& peer : peers) {
+        RtcpSenderInfo senderInfo{};
+        bool sentToPeer = false;
+        {
+            std::lock_guard<std::mutex> lock(sendMutex);
+            auto it = sendStates.find(peer.id);
+            if (it != sendStates.end() && it->second.packets != it->second.reportedPackets) {
+                sentToPeer = true;
+                it->second.reportedPackets = it->second.packets;
+                senderInfo.ntpTimestamp = RtcpNtpNow();
+                senderInfo.rtpTimestamp = rtpNow;
+                senderInfo.packetCount = it->second.packets;
+                senderInfo.octetCount = it->second.octets;
+            }
+        }
+        weSent = weSent || sentToPeer;
+
+        const RtcpReportBlock* peerBlock = nullptr;
+        for (size_t i = 0; i < blockCount; i++) {
+            if (blockPeers[i] == peer.id) peerBlock = &blocks[i];
+        }
+
+        size_t size = WriteRtcpCompound(packet.data(), RTCP_MAX_PACKET_SIZE, ssrc,
+                                        sentToPeer ? &senderInfo : nullptr, peerBlock, peerBlock ? 1 : 0,
+                                        rtcpCname.c_str(), byeSsrc != 0 ? &byeSsrc : nullptr);
+        if (size == 0) continue;
+
+        SocketAddress peerAddr = GetPeerAudioAddress(peer);
+
+        // As with RTP: captured in the clear, then encrypted past the sender SSRC
+        packetCapture.Capture(CaptureProducer::ReceiveThread, CaptureDirection::Outbound, peerAddr,
+                              packet.data(), size);
+        if (peer.encrypted) {
+            uint32_t& index = rtcpProtectIndices[peer.id];
+            if (index == MEDIA_INDEX_LIMIT) continue;
+            size = ProtectMediaPacket(peer.mediaKeys.send, MediaStream::Rtcp, index++, packet.data(),
+                                      RTCP_AUTHENTICATED_HEADER_SIZE, size, packet.size());
+            if (size == 0) continue;
+        }
+
+        SocketAddress sendAddr = peerAddr.ForFamily(audioFamily);
+        sendto(audioSocket, (const char*)packet.data(), (int)size, 0, sendAddr.Get(), sendAddr.length);
+
+        double wireSize = (double)(size + IPV4_UDP_OVERHEAD);
+        averageRtcpSize = averageRtcpSize > 0.0 ? averageRtcpSize + (wireSize - averageRtcpSize) / 16.0 : wireSize;
+    }
+    byeSsrc = 0;
+
+    // Next interval scales with the number of participants (RFC 3550 6.3)
+    PacketTime ptime = PeerNetwork::GetInstance().GetSessionPacketTime();
+    double sessionBytesPerSecond = (double)AUDIO_SAMPLE_RATE * AUDIO_CHANNELS * sizeof(int16_t) +
+        (double)(RTP_HEADER_SIZE + IPV4_UDP_OVERHEAD) * 1000000.0 / PacketTimeMicros(ptime);
+    size_t members = peers.size() + 1;
+    size_t senders = activeSenders + (weSent ? 1 : 0);
+    double interval = ComputeRtcpInterval(members, senders, sessionBytesPerSecond,
+                                          averageRtcpSize, weSent, initial, true);
+
+    // Randomize to avoid synchronized reports, then compensate (6.3.1)
+    double randomFactor = std::uniform_real_distribution<double>(0.5, 1.5)(rtcpRandom);
+    return interval * randomFactor / 1.21828;
+}
+
+void AudioStreamer::HandleRtcp(const uint8_t* data, size_t length, const SocketAddress& senderAddr) {
+    auto now = std::chrono::steady_clock::now();
+    uint32_t arrivalNtp = RtcpNtpMiddle(RtcpNtpNow());
+
+    RtcpReport report;
+    if (!ParseRtcpCompound(data, length, report)) {
+        return;
+    }
+
+    PeerID senderId = FindPeerByAddress(senderAddr);
+    if (senderId == 0) return;
+
+    double wireSize = (double)(length + IPV4_UDP_OVERHEAD);
+    PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(senderId);
+
+    bool hasFeedback = false;
+    RtcpReportBlock feedbackBlock{};
+    double rttMs = -1.0;
+    {
+        std::lock_guard<std::mutex> lock(queuesMutex);
+        averageRtcpSize = averageRtcpSize > 0.0 ? averageRtcpSize + (wireSize - averageRtcpSize) / 16.0 : wireSize;
+
+        PeerReceiveState& state = receiveStates[senderId];
+        if (report.senderSsrc == rtpSSRC.load(std::memory_order_relaxed)) {
+            ssrcCollision = true;
+        }
+        if (report.hasSenderInfo) {
+            state.hasSenderReport = true;
+            state.lastSenderReportNtp = RtcpNtpMiddle(report.senderInfo.ntpTimestamp);
+            state.lastSenderReportArrival = now;
+        }
+
+        // Blocks about our own stream are the peer's feedback to us
+        for (size_t i = 0; i < report.blockCount; i++) {
+            const RtcpReportBlock& block = report.blocks[i];
+            if (block.ssrc != rtpSSRC.load(std::memory_order_relaxed)) continue;
+
+            state.hasRemoteReport = true;
+            state.remoteReport = block;
+            state.lastRemoteReport = now;
+
+            if (block.lastSenderReport != 0) {
+                // RTT = arrival - LSR - DLSR, all in 1/65536 s (RFC 3550 6.4.1)
+                uint32_t rtt = arrivalNtp - block.lastSenderReport - block.delaySinceLastSenderReport;
+                if (rtt < 0x80000000u) {
+                    state.rttMs = rtt * 1000.0 / 65536.0;
                 }
             }
 
-            if (senderId > 0) {
-                std::lock_guard<std::mutex> lock(queuesMutex);
-                AudioBuffer audioBuffer(audioData, audioData + audioDataSize / sizeof(int16_t));
-                receiveQueues[senderId].push(audioBuffer);
+            if (metrics) {
+                metrics->remoteLossPermille.Set(block.fractionLost * 1000 / 256);
+                if (state.rttMs >= 0.0) {
+                    metrics->rttMicros.Set((int64_t)(state.rttMs * 1000.0));
+                }
             }
+
+            hasFeedback = true;
+            feedbackBlock = block;
+            rttMs = state.rttMs;
+        }
+    }
+
+    if (report.bye) {
+        LOG_INFO_FMT("RTCP BYE from peer {}", senderId);
+    }
+
+    if (hasFeedback) {
+        UpdateRateControl(senderId, feedbackBlock, rttMs, now);
+    }
+}
+
+void AudioStreamer::UpdateRateControl(PeerID peerId, const RtcpReportBlock& block, double rttMs,
+                                      std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(sendMutex);
+    auto it = sendStates.find(peerId);
+    if (it == sendStates.end()) return;
+    PeerSendState& send = it->second;
+
+    RateFeedback feedback{};
+    feedback.fractionLost = block.fractionLost / 256.0;
+    feedback.rttMs = rttMs;
+    feedback.jitterMs = block.jitter * 1000.0 / AUDIO_SAMPLE_RATE;
+
+    // Packets that got through since the previous report, at the current
+    // configuration's wire size, give the delivered bitrate
+    if (send.hasReport) {
+        double seconds = std::chrono::duration<double>(now - send.reportTime).count();
+        int64_t expected = (int64_t)(block.extendedHighestSequence - send.reportHighestSequence);
+        int64_t received = expected - ((int64_t)block.cumulativeLost - send.reportCumulativeLost);
+        const StreamConfig& config = send.controller.GetConfig();
+        double packetsPerSecond = 1000000.0 / ((double)PacketTimeMicros(send.capturePacketTime) * config.packetsPerRtp);
+        if (seconds > 0.0 && received >= 0 && expected < 0x8000) {
+            feedback.receivedBitrate = received * (send.controller.GetBitrate() / packetsPerSecond) / seconds;
         }
     }
+    send.hasReport = true;
+    send.reportHighestSequence = block.extendedHighestSequence;
+    send.reportCumulativeLost = block.cumulativeLost;
+    send.reportTime = now;
+
+    RateDecisionRecord record;
+    if (send.controller.OnFeedback(LatencyClockMicros(), feedback, record)) {
+        LOG_INFO(FormatRateDecision(peerId, record, send.capturePacketTime));
+        if (PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(peerId)) {
+            metrics->rateDecisions.Add();
+            metrics->sendBitrate.Set(record.bitrate);
+        }
+    }
+}
+
+std::vector<RtpStreamStats> AudioStreamer::GetStreamStats() {
+    std::vector<RtpStreamStats> result;
+    std::lock_guard<std::mutex> lock(queuesMutex);
+    for (const auto& entry : receiveStates) {
+        const PeerReceiveState& state = entry.second;
+
+        RtpStreamStats stats{};
+        stats.peerId = entry.first;
+        stats.remoteSsrc = state.remoteSsrc;
+        stats.packetsReceived = state.stats.GetReceived();
+        stats.packetsLost = state.stats.GetCumulativeLost();
+        stats.jitterMs = state.stats.GetJitter() * 1000.0 / AUDIO_SAMPLE_RATE;
+        stats.hasRemoteReport = state.hasRemoteReport;
+        stats.remoteFractionLost = state.remoteReport.fractionLost / 256.0;
+        stats.remotePacketsLost = state.remoteReport.cumulativeLost;
+        stats.remoteJitterMs = state.remoteReport.jitter * 1000.0 / AUDIO_SAMPLE_RATE;
+        stats.rttMs = state.rttMs;
+        stats.lastRemoteReport = state.lastRemoteReport;
+        stats.sendConfig = StreamConfig{PayloadEncoding::Pcm16, 1, 0};
+        result.push_back(stats);
+    }
+
+    std::lock_guard<std::mutex> sendLock(sendMutex);
+    for (auto& stats : result) {
+        auto it = sendStates.find(stats.peerId);
+        if (it != sendStates.end()) {
+            stats.sendConfig = it->second.controller.GetConfig();
+            stats.sendBitrate = it->second.controller.GetBitrate();
+        }
+    }
+    return result;
+}
+
+bool AudioStreamer::GetStreamStats(PeerID peerId, RtpStreamStats& stats) {
+    for (const auto& entry : GetStreamStats()) {
+        if (entry.peerId == peerId) {
+            stats = entry;
+            return true;
+        }
+    }
+    return false;
+}
+
+void AudioStreamer::BuildRTPHeader(RTPHeader& header, PeerSendState& send, uint8_t payloadType) {
+    header.marker = false;
+    header.payloadType = payloadType & 0x7F;
 
-    delete[] recvBuffer;
+    // Sequence is per peer stream; the timestamp is the first aggregated
+    // capture packet's position on the shared clock
+    header.sequence = ++send.sequence;
+    header.timestamp = send.pendingTimestamp;
+    header.ssrc = rtpSSRC.load(std::memory_order_relaxed);
 }
 
-void AudioStreamer::BuildRTPHeader(RTPHeader& header) {
-    // V=2, P=0, X=0, CC=0
-    header.vpxcc = 0x80;
-    
-    // M=0, PT=111
-    header.mpt = RTP_PAYLOAD_TYPE & 0x7F;
-    
-    header.seq = htons(++rtpSequence);
-    header.timestamp = htonl(rtpTimestamp);
-    header.ssrc = htonl(rtpSSRC);
-    
-    rtpTimestamp += AUDIO_BUFFER_SIZE;
+void AudioStreamer::ResolveSsrcCollision() {
+    // RFC 3550 8.2: say BYE for the old SSRC and draw another. The peer saw
+    // the same clash and may move as well; two fresh draws hardly ever meet.
+    uint32_t old = rtpSSRC.load(std::memory_order_relaxed);
+    uint32_t ssrc = RandomSsrc(old);
+    rtpSSRC.store(ssrc, std::memory_order_relaxed);
+    byeSsrc = old;
+    LOG_WARNING_FMT("SSRC {} collided with a peer's; now {}", old, ssrc);
 }
@@ -0,0 +1,523 @@
+#include <networking/MediaCrypto.h>
+#include <platform/Random.h>
+#include <cstring>
+
+// Key derivation label, the ChaCha20 nonce for expanding the shared secret
+static const uint8_t MEDIA_KDF_LABEL[12] = {'V', 'Q', ' ', 'm', 'e', 'd', 'i', 'a', ' ', 'k', 'd', 'f'};
+// Where DeriveRoomKey's chain starts
+static const uint8_t MEDIA_ROOM_LABEL[12] = {'V', 'Q', ' ', 'r', 'o', 'o', 'm', ' ', 'k', 'e', 'y', 's'};
+
+static inline uint32_t Load32LE(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline void Store32LE(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline void Store64LE(uint8_t* p, uint64_t v) {
+    Store32LE(p, (uint32_t)v);
+    Store32LE(p + 4, (uint32_t)(v >> 32));
+}
+
+// ChaCha20 (RFC 8439 2.3)
+
+static inline uint32_t Rotl32(uint32_t v, int n) {
+    return (v << n) | (v >> (32 - n));
+}
+
+#define CHACHA_QUARTER_ROUND(a, b, c, d) \
+    a += b; d = Rotl32(d ^ a, 16);       \
+    c += d; b = Rotl32(b ^ c, 12);       \
+    a += b; d = Rotl32(d ^ a, 8);        \
+    c += d; b = Rotl32(b ^ c, 7)
+
+static void ChaCha20Rounds(uint32_t* x) {
+    for (int i = 0; i < 10; i++) {
+        CHACHA_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        CHACHA_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        CHACHA_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        CHACHA_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        CHACHA_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        CHACHA_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        CHACHA_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        CHACHA_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+    }
+}
+
+static void ChaCha20Init(uint32_t* state, const uint8_t* key, uint32_t counter, const uint8_t* nonce) {
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) state[4 + i] = Load32LE(key + 4 * i);
+    state[12] = counter;
+    state[13] = Load32LE(nonce);
+    state[14] = Load32LE(nonce + 4);
+    state[15] = Load32LE(nonce + 8);
+}
+
+static void ChaCha20Block(const uint32_t* state, uint8_t* out) {
+    uint32_t x[16];
+    std::memcpy(x, state, sizeof(x));
+    ChaCha20Rounds(x);
+    for (int i = 0; i < 16; i++) Store32LE(out + 4 * i, x[i] + state[i]);
+}
+
+// XORs the keystream from block counter onwards into data
+static void ChaCha20Xor(const uint8_t* key, uint32_t counter, const uint8_t* nonce, uint8_t* data, size_t length) {
+    uint32_t state[16];
+    uint8_t block[64];
+    ChaCha20Init(state, key, counter, nonce);
+    while (length > 0) {
+        ChaCha20Block(state, block);
+        size_t take = length < 64 ? length : 64;
+        for (size_t i = 0; i < take; i++) data[i] ^= block[i];
+        data += take;
+        length -= take;
+        state[12]++;
+    }
+    SecureZero(block, sizeof(block));
+}
+
+void HChaCha20(uint8_t* out, const uint8_t* key, const uint8_t* input) {
+    uint32_t x[16];
+    x[0] = 0x61707865;
+    x[1] = 0x3320646e;
+    x[2] = 0x79622d32;
+    x[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) x[4 + i] = Load32LE(key + 4 * i);
+    for (int i = 0; i < 4; i++) x[12 + i] = Load32LE(input + 4 * i);
+    ChaCha20Rounds(x);
+    for (int i = 0; i < 4; i++) Store32LE(out + 4 * i, x[i]);
+    for (int i = 0; i < 4; i++) Store32LE(out + 16 + 4 * i, x[12 + i]);
+    SecureZero(x, sizeof(x));
+}
+
+// Poly1305 (RFC 8439 2.5), 26-bit limbs so it needs no 128-bit multiply.
+// The AEAD only ever feeds it whole, zero-padded 16-byte blocks.
+
+struct Poly1305 {
+    uint32_t r[5];
+    uint32_t h[5];
+    uint32_t pad[4];
+};
+
+static void Poly1305Init(Poly1305& st, const uint8_t* key) {
+    st.r[0] = Load32LE(key + 0) & 0x3ffffff;
+    st.r[1] = (Load32LE(key + 3) >> 2) & 0x3ffff03;
+    st.r[2] = (Load32LE(key + 6) >> 4) & 0x3ffc0ff;
+    st.r[3] = (Load32LE(key + 9) >> 6) & 0x3f03fff;
+    st.r[4] = (Load32LE(key + 12) >> 8) & 0x00fffff;
+    for (int i = 0; i < 5; i++) st.h[i] = 0;
+    for (int i = 0; i < 4; i++) st.pad[i] = Load32LE(key + 16 + 4 * i);
+}
+
+static void Poly1305Blocks(Poly1305& st, const uint8_t* m, size_t length) {
+    const uint32_t r0 = st.r[0], r1 = st.r[1], r2 = st.r[2], r3 = st.r[3], r4 = st.r[4];
+    const uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+    uint32_t h0 = st.h[0], h1 = st.h[1], h2 = st.h[2], h3 = st.h[3], h4 = st.h[4];
+
+    while (length >= 16) {
+        h0 += Load32LE(m + 0) & 0x3ffffff;
+        h1 += (Load32LE(m + 3) >> 2) & 0x3ffffff;
+        h2 += (Load32LE(m + 6) >> 4) & 0x3ffffff;
+        h3 += (Load32LE(m + 9) >> 6) & 0x3ffffff;
+        h4 += (Load32LE(m + 12) >> 8) | (1u << 24);
+
+        uint64_t d0 = (uint64_t)h0 * r0 + (uint64_t)h1 * s4 + (uint64_t)h2 * s3 + (uint64_t)h3 * s2 + (uint64_t)h4 * s1;
+        uint64_t d1 = (uint64_t)h0 * r1 + (uint64_t)h1 * r0 + (uint64_t)h2 * s4 + (uint64_t)h3 * s3 + (uint64_t)h4 * s2;
+        uint64_t d2 = (uint64_t)h0 * r2 + (uint64_t)h1 * r1 + (uint64_t)h2 * r0 + (uint64_t)h3 * s4 + (uint64_t)h4 * s3;
+        uint64_t d3 = (uint64_t)h0 * r3 + (uint64_t)h1 * r2 + (uint64_t)h2 * r1 + (uint64_t)h3 * r0 + (uint64_t)h4 * s4;
+        uint64_t d4 = (uint64_t)h0 * r4 + (uint64_t)h1 * r3 + (uint64_t)h2 * r2 + (uint64_t)h3 * r1 + (uint64_t)h4 * r0;
+
+        uint32_t c = (uint32_t)(d0 >> 26); h0 = (uint32_t)d0 & 0x3ffffff;
+        d1 += c; c = (uint32_t)(d1 >> 26); h1 = (uint32_t)d1 & 0x3ffffff;
+        d2 += c; c = (uint32_t)(d2 >> 26); h2 = (uint32_t)d2 & 0x3ffffff;
+        d3 += c; c = (uint32_t)(d3 >> 26); h3 = (uint32_t)d3 & 0x3ffffff;
+        d4 += c; c = (uint32_t)(d4 >> 26); h4 = (uint32_t)d4 & 0x3ffffff;
+        h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+        h1 += c;
+
+        m += 16;
+        length -= 16;
+    }
+
+    st.h[0] = h0; st.h[1] = h1; st.h[2] = h2; st.h[3] = h3; st.h[4] = h4;
+}
+
+// Whole blocks, then the tail zero-padded to a block (the AEAD's padding)
+static void Poly1305Padded(Poly1305& st, const uint8_t* m, size_t length) {
+    size_t whole = length & ~(size_t)15;
+    Poly1305Blocks(st, m, whole);
+    if (whole < length) {
+        uint8_t block[16] = {};
+        std::memcpy(block, m + whole, length - whole);
+        Poly1305Blocks(st, block, 16);
+    }
+}
+
+static void Poly1305Finish(Poly1305& st, uint8_t* tag) {
+    uint32_t h0 = st.h[0], h1 = st.h[1], h2 = st.h[2], h3 = st.h[3], h4 = st.h[4];
+
+    uint32_t c = h1 >> 26; h1 &= 0x3ffffff;
+    h2 += c; c = h2 >> 26; h2 &= 0x3ffffff;
+    h3 += c; c = h3 >> 26; h3 &= 0x3ffffff;
+    h4 += c; c = h4 >> 26; h4 &= 0x3ffffff;
+    h0 += c * 5; c = h0 >> 26; h0 &= 0x3ffffff;
+    h1 += c;
+
+    // h - p, selected without a branch if h >= p
+    uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= 0x3ffffff;
+    uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= 0x3ffffff;
+    uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= 0x3ffffff;
+    uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= 0x3ffffff;
+    uint32_t g4 = h4 + c - (1u << 26);
+
+    uint32_t mask = (g4 >> 31) - 1;
+    g0 &= mask; g1 &= mask; g2 &= mask; g3 &= mask; g4 &= mask;
+    mask = ~mask;
+    h0 = (h0 & mask) | g0;
+    h1 = (h1 & mask) | g1;
+    h2 = (h2 & mask) | g2;
+    h3 = (h3 & mask) | g3;
+    h4 = (h4 & mask) | g4;
+
+    h0 = h0 | (h1 << 26);
+    h1 = (h1 >> 6) | (h2 << 20);
+    h2 = (h2 >> 12) | (h3 << 14);
+    h3 = (h3 >> 18) | (h4 << 8);
+
+    uint64_t f = (uint64_t)h0 + st.pad[0];
+    Store32LE(tag + 0, (uint32_t)f);
+    f = (uint64_t)h1 + st.pad[1] + (f >> 32);
+    Store32LE(tag + 4, (uint32_t)f);
+    f = (uint64_t)h2 + st.pad[2] + (f >> 32);
+    Store32LE(tag + 8, (uint32_t)f);
+    f = (uint64_t)h3 + st.pad[3] + (f >> 32);
+    Store32LE(tag + 12, (uint32_t)f);
+
+    SecureZero(&st, sizeof(st));
+}
+
+// AEAD construction (RFC 8439 2.8)
+
+static void AeadTag(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aadLength,
+                    const uint8_t* ciphertext, size_t length, uint8_t* tag) {
+    uint32_t state[16];
+    uint8_t block[64];
+    ChaCha20Init(state, key, 0, nonce);
+    ChaCha20Block(state, block);
+
+    Poly1305 mac;
+    Poly1305Init(mac, block);
+    Poly1305Padded(mac, aad, aadLength);
+    Poly1305Padded(mac, ciphertext, length);
+    uint8_t lengths[16];
+    Store64LE(lengths, aadLength);
+    Store64LE(lengths + 8, length);
+    Poly1305Blocks(mac, lengths, 16);
+    Poly1305Finish(mac, tag);
+
+    SecureZero(block, sizeof(block));
+    SecureZero(state, sizeof(state));
+}
+
+void ChaCha20Poly1305Seal(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aadLength,
+                          uint8_t* data, size_t length, uint8_t* tag) {
+    ChaCha20Xor(key, 1, nonce, data, length);
+    AeadTag(key, nonce, aad, aadLength, data, length, tag);
+}
+
+bool ChaCha20Poly1305Open(const uint8_t* key, const uint8_t* nonce, const uint8_t* aad, size_t aadLength,
+                          uint8_t* data, size_t length, const uint8_t* tag) {
+    uint8_t expected[MEDIA_TAG_SIZE];
+    AeadTag(key, nonce, aad, aadLength, data, length, expected);
+
+    // Constant time: how much of the tag matched must not show
+    uint8_t difference = 0;
+    for (size_t i = 0; i < MEDIA_TAG_SIZE; i++) difference |= (uint8_t)(expected[i] ^ tag[i]);
+    if (difference != 0) return false;
+
+    ChaCha20Xor(key, 1, nonce, data, length);
+    return true;
+}
+
+// X25519 (RFC 7748) on 16 limbs of 16 bits, after TweetNaCl
+
+typedef int64_t FieldElement[16];
+
+static const FieldElement FIELD_121665 = {0xDB41, 1};
+
+static void FieldCarry(int64_t* o) {
+    for (int i = 0; i < 16; i++) {
+        o[i] += (int64_t)1 << 16;
+        int64_t c = o[i] >> 16;
+        if (i < 15) {
+            o[i + 1] += c - 1;
+        } else {
+            o[0] += 38 * (c - 1);
+        }
+        o[i] -= c * 65536;
+    }
+}
+
+// Swaps p and q if bit is 1, without branching on it
+static void FieldSwap(int64_t* p, int64_t* q, int bit) {
+    int64_t mask = ~((int64_t)bit - 1);
+    for (int i = 0; i < 16; i++) {
+        int64_t t = mask & (p[i] ^ q[i]);
+        p[i] ^= t;
+        q[i] ^= t;
+    }
+}
+
+static void FieldPack(uint8_t* out, const int64_t* n) {
+    FieldElement t, m;
+    for (int i = 0; i < 16; i++) t[i] = n[i];
+    FieldCarry(t);
+    FieldCarry(t);
+    FieldCarry(t);
+    for (int j = 0; j < 2; j++) {
+        m[0] = t[0] - 0xffed;
+        for (int i = 1; i < 15; i++) {
+            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+            m[i - 1] &= 0xffff;
+        }
+        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+        int borrow = (int)((m[15] >> 16) & 1);
+        m[14] &= 0xffff;
+        FieldSwap(t, m, 1 - borrow);
+    }
+    for (int i = 0; i < 16; i++) {
+        out[2 * i] = (uint8_t)(t[i] & 0xff);
+        out[2 * i + 1] = (uint8_t)(t[i] >> 8);
+    }
+}
+
+static void FieldUnpack(int64_t* o, const uint8_t* n) {
+    for (int i = 0; i < 16; i++) o[i] = n[2 * i] + ((int64_t)n[2 * i + 1] << 8);
+    o[15] &= 0x7fff;
+}
+
+static void FieldAdd(int64_t* o, const int64_t* a, const int64_t* b) {
+    for (int i = 0; i < 16; i++) o[i] = a[i] + b[i];
+}
+
+static void FieldSub(int64_t* o, const int64_t* a, const int64_t* b) {
+    for (int i = 0; i < 16; i++) o[i] = a[i] - b[i];
+}
+
+static void FieldMul(int64_t* o, const int64_t* a, const int64_t* b) {
+    int64_t t[31] = {};
+    for (int i = 0; i < 16; i++) {
+        for (int j = 0; j < 16; j++) t[i + j] += a[i] * b[j];
+    }
+    for (int i = 0; i < 15; i++) t[i] += 38 * t[i + 16];
+    for (int i = 0; i < 16; i++) o[i] = t[i];
+    FieldCarry(o);
+    FieldCarry(o);
+}
+
+static void FieldInvert(int64_t* o, const int64_t* in) {
+    FieldElement c;
+    for (int i = 0; i < 16; i++) c[i] = in[i];
+    for (int a = 253; a >= 0; a--) {
+        FieldMul(c, c, c);
+        if (a != 2 && a != 4) FieldMul(c, c, in);
+    }
+    for (int i = 0; i < 16; i++) o[i] = c[i];
+}
+
+void X25519(uint8_t* out, const uint8_t* scalar, const uint8_t* point) {
+    uint8_t z[32];
+    std::memcpy(z, scalar, 32);
+    z[31] = (uint8_t)((z[31] & 127) | 64);
+    z[0] &= 248;
+
+    FieldElement x, a, b, c, d, e, f;
+    FieldUnpack(x, point);
+    for (int i = 0; i < 16; i++) {
+        b[i] = x[i];
+        a[i] = c[i] = d[i] = 0;
+    }
+    a[0] = d[0] = 1;
+
+    // Montgomery ladder
+    for (int i = 254; i >= 0; i--) {
+        int bit = (z[i >> 3] >> (i & 7)) & 1;
+        FieldSwap(a, b, bit);
+        FieldSwap(c, d, bit);
+        FieldAdd(e, a, c);
+        FieldSub(a, a, c);
+        FieldAdd(c, b, d);
+        FieldSub(b, b, d);
+        FieldMul(d, e, e);
+        FieldMul(f, a, a);
+        FieldMul(a, c, a);
+        FieldMul(c, b, e);
+        FieldAdd(e, a, c);
+        FieldSub(a, a, c);
+        FieldMul(b, a, a);
+        FieldSub(c, d, f);
+        FieldMul(a, c, FIELD_121665);
+        FieldAdd(a, a, d);
+        FieldMul(c, c, a);
+        FieldMul(a, d, f);
+        FieldMul(d, b, x);
+        FieldMul(b, e, e);
+        FieldSwap(a, b, bit);
+        FieldSwap(c, d, bit);
+    }
+
+    FieldInvert(c, c);
+    FieldMul(a, a, c);
+    FieldPack(out, a);
+
+    SecureZero(z, sizeof(z));
+    SecureZero(a, sizeof(a));
+    SecureZero(b, sizeof(b));
+    SecureZero(c, sizeof(c));
+    SecureZero(d, sizeof(d));
+    SecureZero(e, sizeof(e));
+    SecureZero(f, sizeof(f));
+}
+
+bool GenerateMediaKeyPair(uint8_t* privateKey, uint8_t* publicKey) {
+    static const uint8_t basePoint[32] = {9};
+    if (!FillRandomBytes(privateKey, MEDIA_KEY_SIZE)) return false;
+    X25519(publicKey, privateKey, basePoint);
+    return true;
+}
+
+void DeriveRoomKey(const uint8_t* secret, size_t length, uint8_t* roomKey) {
+    uint8_t chain[MEDIA_ROOM_KEY_SIZE] = {};
+    std::memcpy(chain, MEDIA_ROOM_LABEL, sizeof(MEDIA_ROOM_LABEL));
+    uint8_t block[16];
+    uint8_t next[MEDIA_ROOM_KEY_SIZE];
+
+    // The last block is padded 0x80 0..., a whole block of padding if the secret fills the one before
+    for (size_t offset = 0;; offset += sizeof(block)) {
+        size_t take = length - offset < sizeof(block) ? length - offset : sizeof(block);
+        std::memset(block, 0, sizeof(block));
+        std::memcpy(block, secret + offset, take);
+        if (take < sizeof(block)) block[take] = 0x80;
+
+        HChaCha20(next, chain, block);
+        for (size_t i = 0; i < sizeof(chain); i++) chain[i] ^= next[i];
+        if (take < sizeof(block)) break;
+    }
+    std::memcpy(roomKey, chain, MEDIA_ROOM_KEY_SIZE);
+
+    SecureZero(chain, sizeof(chain));
+    SecureZero(block, sizeof(block));
+    SecureZero(next, sizeof(next));
+}
+
+bool DeriveMediaKeys(uint8_t* privateKey, const uint8_t* peerPublicKey, bool isHost, const uint8_t* roomKey,
+                     MediaKeys& keys) {
+    uint8_t shared[32];
+    X25519(shared, privateKey, peerPublicKey);
+    SecureZero(privateKey, MEDIA_KEY_SIZE);
+
+    // A low-order public key gives an all-zero secret (RFC 7748 6.1)
+    uint8_t any = 0;
+    for (uint8_t byte : shared) any |= byte;
+    if (any == 0) return false;
+
+    // The raw X25519 output is not uniform; HChaCha20 turns it into a key
+    // (as NaCl's crypto_box does), whose keystream is both directions' keys
+    static const uint8_t zeros[16] = {};
+    uint8_t secret[32];
+    HChaCha20(secret, shared, zeros);
+
+    // Without the room key, one in the middle knows the secret but not the keys
+    if (roomKey) {
+        for (size_t i = 0; i < sizeof(secret); i++) secret[i] ^= roomKey[i];
+    }
+
+    uint8_t material[2 * (MEDIA_KEY_SIZE + MEDIA_SALT_SIZE) + MEDIA_KEY_PROOF_SIZE] = {};
+    ChaCha20Xor(secret, 0, MEDIA_KDF_LABEL, material, sizeof(material));
+
+    const uint8_t* hostKey = material;
+    const uint8_t* joinerKey = material + MEDIA_KEY_SIZE + MEDIA_SALT_SIZE;
+    const uint8_t* sendMaterial = isHost ? hostKey : joinerKey;
+    const uint8_t* receiveMaterial = isHost ? joinerKey : hostKey;
+    std::memcpy(keys.send.key, sendMaterial, MEDIA_KEY_SIZE);
+    std::memcpy(keys.send.salt, sendMaterial + MEDIA_KEY_SIZE, MEDIA_SALT_SIZE);
+    std::memcpy(keys.receive.key, receiveMaterial, MEDIA_KEY_SIZE);
+    std::memcpy(keys.receive.salt, receiveMaterial + MEDIA_KEY_SIZE, MEDIA_SALT_SIZE);
+    std::memcpy(keys.proof, material + 2 * (MEDIA_KEY_SIZE + MEDIA_SALT_SIZE), MEDIA_KEY_PROOF_SIZE);
+
+    SecureZero(shared, sizeof(shared));
+    SecureZero(secret, sizeof(secret));
+    SecureZero(material, sizeof(material));
+    return true;
+}
+
+bool MediaKeyProofsEqual(const uint8_t* a, const uint8_t* b) {
+    uint8_t difference = 0;
+    for (size_t i = 0; i < MEDIA_KEY_PROOF_SIZE; i++) difference |= (uint8_t)(a[i] ^ b[i]);
+    return difference == 0;
+}
+
+// Packet protection
+
+// salt XOR (stream | 0...0 | index), so each key, stream and index has its own nonce
+static void BuildMediaNonce(uint8_t* nonce, const MediaKey& key, MediaStream stream, uint32_t index) {
+    std::memcpy(nonce, key.salt, MEDIA_SALT_SIZE);
+    nonce[0] ^= (uint8_t)stream;
+    nonce[8] ^= (uint8_t)(index >> 24);
+    nonce[9] ^= (uint8_t)(index >> 16);
+    nonce[10] ^= (uint8_t)(index >> 8);
+    nonce[11] ^= (uint8_t)index;
+}
+
+size_t ProtectMediaPacket(const MediaKey& key, MediaStream stream, uint32_t index,
+                          uint8_t* packet, size_t headerSize, size_t length, size_t capacity) {
+    if (length < headerSize || length + MEDIA_CRYPTO_OVERHEAD > capacity) {
+        return 0;
+    }
+
+    uint8_t* trailer = packet + length;
+    trailer[0] = (uint8_t)(index >> 24);
+    trailer[1] = (uint8_t)(index >> 16);
+    trailer[2] = (uint8_t)(index >> 8);
+    trailer[3] = (uint8_t)index;
+
+    uint8_t nonce[MEDIA_SALT_SIZE];
+    BuildMediaNonce(nonce, key, stream, index);
+    ChaCha20Poly1305Seal(key.key, nonce, packet, headerSize, packet + headerSize, length - headerSize,
+                         trailer + MEDIA_INDEX_SIZE);
+    return length + MEDIA_CRYPTO_OVERHEAD;
+}
+
+bool ReadMediaPacketIndex(const uint8_t* packet, size_t headerSize, size_t length, uint32_t& index) {
+    if (length < headerSize + MEDIA_CRYPTO_OVERHEAD) {
+        return false;
+    }
+    const uint8_t* trailer = packet + length - MEDIA_CRYPTO_OVERHEAD;
+    index = ((uint32_t)trailer[0] << 24) | ((uint32_t)trailer[1] << 16) | ((uint32_t)trailer[2] << 8) | trailer[3];
+    return true;
+}
+
+bool UnprotectMediaPacket(const MediaKey& key, MediaStream stream, uint8_t* packet, size_t headerSize,
+                          size_t& length) {
+    uint32_t index = 0;
+    if (!ReadMediaPacketIndex(packet, headerSize, length, index)) {
+        return false;
+    }
+
+    size_t plainLength = length - MEDIA_CRYPTO_OVERHEAD;
+    uint8_t nonce[MEDIA_SALT_SIZE];
+    BuildMediaNonce(nonce, key, stream, index);
+    if (!ChaCha20Poly1305Open(key.key, nonce, packet, headerSize, packet + headerSize, plainLength - headerSize,
+                              packet + plainLength + MEDIA_INDEX_SIZE)) {
+        return false;
+    }
+    length = plainLength;
+    return true;
+}
@@ -0,0 +1,130 @@
+#include <networking/NetworkImpairment.h>
+#include <cmath>
+#include <cstdint>
+
+static const ImpairmentProfile IMPAIRMENT_PROFILES[] = {
+    // name, description,
+    // goodToBad, badToGood, lossGood, lossBad,
+    // delayMs, jitterMs, reorderRate, reorderDelayMs, duplicateRate,
+    // bandwidthKbps, queueBytes
+    {"lan", "Wired LAN: sub-millisecond delay, no loss",
+     0.0, 1.0, 0.0, 0.0,
+     0.3, 0.1, 0.0, 0.0, 0.0,
+     0.0, 0},
+    {"wifi-congested", "Busy 2.4 GHz Wi-Fi: contention jitter, short loss bursts, 4 Mbps",
+     0.01, 0.35, 0.002, 0.6,
+     6.0, 12.0, 0.005, 15.0, 0.001,
+     4000.0, 64 * 1024},
+    {"mobile-tether", "Phone hotspot on LTE: long delay, deep fades, 2 Mbps uplink",
+     0.004, 0.08, 0.003, 0.8,
+     30.0, 8.0, 0.01, 25.0, 0.002,
+     2000.0, 48 * 1024},
+    {"lossy-random", "Independent 2% loss over a 20 ms path",
+     0.0, 1.0, 0.02, 0.0,
+     20.0, 2.0, 0.0, 0.0, 0.0,
+     0.0, 0},
+};
+
+const ImpairmentProfile* GetImpairmentProfiles(size_t& count) {
+    count = sizeof(IMPAIRMENT_PROFILES) / sizeof(IMPAIRMENT_PROFILES[0]);
+    return IMPAIRMENT_PROFILES;
+}
+
+const ImpairmentProfile* FindImpairmentProfile(const std::string& name) {
+    for (const auto& profile : IMPAIRMENT_PROFILES) {
+        if (name == profile.name) return &profile;
+    }
+    return nullptr;
+}
+
+NetworkImpairment::NetworkImpairment(const ImpairmentProfile& profile, uint64_t seed)
+    : profile(profile), randomState(seed), badState(false), linkFreeMicros(0),
+      bottleneckBytes(0), lastInOrderMicros(0), nextOrder(0) {
+}
+
+uint64_t NetworkImpairment::NextRandom() {
+    // SplitMix64: same sequence on every platform and standard library
+    uint64_t z = (randomState += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+double NetworkImpairment::NextUniform() {
+    return (double)(NextRandom() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+bool NetworkImpairment::Chance(double probability) {
+    // Always draw, so changing one rate does not shift every later decision
+    double value = NextUniform();
+    return value < probability;
+}
+
+void NetworkImpairment::Submit(int64_t nowMicros, const uint8_t* data, size_t length, uint64_t tag) {
+    stats.submitted++;
+
+    // Bottleneck first: serialization at the link rate, drop-tail when full
+    int64_t departMicros = nowMicros;
+    if (profile.bandwidthKbps > 0.0) {
+        while (!bottleneck.empty() && bottleneck.front().first <= nowMicros) {
+            bottleneckBytes -= bottleneck.front().second;
+            bottleneck.pop_front();
+        }
+        if (bottleneckBytes + length > profile.queueBytes) {
+            stats.queueDrops++;
+            return;
+        }
+        int64_t start = linkFreeMicros > nowMicros ? linkFreeMicros : nowMicros;
+        departMicros = start + (int64_t)(length * 8 * 1000.0 / profile.bandwidthKbps);
+        linkFreeMicros = departMicros;
+        bottleneck.emplace_back(departMicros, length);
+        bottleneckBytes += length;
+    }
+
+    // Gilbert-Elliott: move the chain, then lose with the state's probability
+    bool transition = Chance(badState ? profile.badToGood : profile.goodToBad);
+    if (transition) badState = !badState;
+    if (Chance(badState ? profile.lossBad : profile.lossGood)) {
+        stats.lost++;
+        return;
+    }
+
+    double jitterMicros = -std::log(1.0 - NextUniform()) * profile.jitterMs * 1000.0;
+    int64_t deliverMicros = departMicros + (int64_t)(profile.delayMs * 1000.0 + jitterMicros);
+
+    if (Chance(profile.reorderRate)) {
+        // Held back past its successors; does not move the in-order floor
+        stats.reordered++;
+        deliverMicros += (int64_t)(profile.reorderDelayMs * 1000.0);
+    } else {
+        if (deliverMicros < lastInOrderMicros) deliverMicros = lastInOrderMicros;
+        lastInOrderMicros = deliverMicros;
+    }
+    Schedule(deliverMicros, data, length, tag);
+
+    if (Chance(profile.duplicateRate)) {
+        stats.duplicated++;
+        Schedule(deliverMicros, data, length, tag);
+    }
+}
+
+void NetworkImpairment::Schedule(int64_t deliverMicros, const uint8_t* data, size_t length, uint64_t tag) {
+    InFlight entry{deliverMicros, nextOrder++, ImpairedDatagram{std::vector<uint8_t>(data, data + length), tag,
+                                                                deliverMicros}};
+    inFlight.push(std::move(entry));
+}
+
+bool NetworkImpairment::Poll(int64_t nowMicros, ImpairedDatagram& out) {
+    if (inFlight.empty() || inFlight.top().deliverMicros > nowMicros) {
+        return false;
+    }
+    // priority_queue::top is const; the entry is popped right after
+    out = std::move(const_cast<InFlight&>(inFlight.top()).datagram);
+    inFlight.pop();
+    stats.delivered++;
+    return true;
+}
+
+int64_t NetworkImpairment::GetNextDeliveryMicros() const {
+    return inFlight.empty() ? INT64_MAX : inFlight.top().deliverMicros;
+}
@@ -0,0 +1,554 @@
+#include <networking/PacketCapture.h>
+#include <networking/LatencyProbe.h>
+#include <utils/Logger.h>
+#include <platform/Thread.h>
+#include <chrono>
+#include <cstring>
+
+// pcapng block types and options (draft-ietf-opsawg-pcapng)
+constexpr uint32_t PCAPNG_SECTION_HEADER = 0x0A0D0D0A;
+constexpr uint32_t PCAPNG_INTERFACE_DESCRIPTION = 0x00000001;
+constexpr uint32_t PCAPNG_ENHANCED_PACKET = 0x00000006;
+constexpr uint32_t PCAPNG_SIMPLE_PACKET = 0x00000003;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1A2B3C4D;
+constexpr uint16_t PCAPNG_OPT_END = 0;
+constexpr uint16_t PCAPNG_OPT_IF_TSRESOL = 9;
+constexpr uint16_t PCAPNG_OPT_EPB_FLAGS = 2;
+constexpr uint32_t PCAPNG_FLAG_INBOUND = 1;
+constexpr uint32_t PCAPNG_FLAG_OUTBOUND = 2;
+constexpr size_t PCAPNG_MAX_BLOCK_SIZE = 256 * 1024;
+
+// Classic pcap
+constexpr uint32_t PCAP_MAGIC_MICROS = 0xA1B2C3D4;
+constexpr uint32_t PCAP_MAGIC_NANOS = 0xA1B23C4D;
+constexpr size_t PCAP_FILE_HEADER_SIZE = 24;
+constexpr size_t PCAP_RECORD_HEADER_SIZE = 16;
+
+constexpr uint32_t LINKTYPE_ETHERNET = 1;
+constexpr uint32_t LINKTYPE_RAW = 101;
+constexpr uint32_t LINKTYPE_IPV4 = 228;
+constexpr uint32_t LINKTYPE_IPV6 = 229;
+
+constexpr size_t IPV4_HEADER_SIZE = 20;
+constexpr size_t IPV6_HEADER_SIZE = 40;
+constexpr size_t UDP_HEADER_SIZE = 8;
+constexpr uint8_t IP_PROTOCOL_UDP = 17;
+
+static size_t Pad4(size_t length) {
+    return (length + 3) & ~(size_t)3;
+}
+
+static void Put16(uint8_t* p, uint16_t v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+static void Put32(uint8_t* p, uint32_t v) {
+    std::memcpy(p, &v, sizeof(v));
+}
+
+static void PutBig16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static uint16_t Swap16(uint16_t v) {
+    return (uint16_t)((v << 8) | (v >> 8));
+}
+
+static uint32_t Swap32(uint32_t v) {
+    return (v << 24) | ((v << 8) & 0x00FF0000u) | ((v >> 8) & 0x0000FF00u) | (v >> 24);
+}
+
+static uint16_t GetBig16(const uint8_t* p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint16_t Ipv4Checksum(const uint8_t* header) {
+    uint32_t sum = 0;
+    for (size_t i = 0; i < IPV4_HEADER_SIZE; i += 2) {
+        sum += GetBig16(header + i);
+    }
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return (uint16_t)~sum;
+}
+
+PacketCapture::PacketCapture()
+    : active(false), captured(0), dropped(0), localPort(0), wallClockOffsetMicros(0), file(nullptr),
+      stopRequested(false) {
+}
+
+PacketCapture::~PacketCapture() {
+    Close();
+}
+
+bool PacketCapture::Open(const std::string& filename, uint16_t port) {
+    if (active) {
+        LOG_WARNING("Packet capture already running");
+        return false;
+    }
+
+    file = std::fopen(filename.c_str(), "wb");
+    if (!file) {
+        LOG_ERROR("Cannot create packet capture: " + filename);
+        return false;
+    }
+    fileBuffer.resize(CAPTURE_FILE_BUFFER_SIZE);
+    std::setvbuf(file, fileBuffer.data(), _IOFBF, fileBuffer.size());
+    blockBuffer.resize(Pad4(28 + IPV6_HEADER_SIZE + UDP_HEADER_SIZE + CAPTURE_SNAP_LENGTH) + 16);
+
+    localPort = port;
+    int64_t unixMicros = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    wallClockOffsetMicros = unixMicros - LatencyClockMicros();
+
+    if (!WriteHeaderBlocks()) {
+        LOG_ERROR("Failed to write packet capture header: " + filename);
+        std::fclose(file);
+        file = nullptr;
+        return false;
+    }
+
+    // Rings live as long as the capture object, so a socket thread that saw
+    // the capture active a moment before Close never writes into freed memory
+    for (auto& ring : rings) {
+        if (!ring) {
+            ring = std::make_unique<CaptureRing>();
+        }
+        while (ring->Front()) ring->Pop();   // leftovers from a capture that raced Close
+    }
+    captured = 0;
+    dropped = 0;
+
+    stopRequested = false;
+    writerThread = std::thread(&PacketCapture::WriterThreadProc, this);
+    active.store(true, std::memory_order_release);
+
+    LOG_INFO("Capturing audio socket traffic to " + filename);
+    return true;
+}
+
+void PacketCapture::Close() {
+    if (!active.exchange(false)) return;
+
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        stopRequested = true;
+    }
+    writerCV.notify_all();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+
+    std::fclose(file);
+    file = nullptr;
+    LOG_INFO_FMT("Packet capture closed: {} datagrams, {} dropped", GetCapturedCount(), GetDroppedCount());
+}
+
+void PacketCapture::Capture(CaptureProducer producer, CaptureDirection direction, const SocketAddress& remote,
+                            const uint8_t* data, size_t length) {
+    if (!active.load(std::memory_order_acquire)) return;
+
+    CaptureRing& ring = *rings[(size_t)producer];
+    CapturedDatagram* slot = ring.BeginPush();
+    if (!slot) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    size_t snapped = length < CAPTURE_SNAP_LENGTH ? length : CAPTURE_SNAP_LENGTH;
+    slot->micros = LatencyClockMicros();
+    slot->direction = direction;
+    slot->remoteIpv6 = remote.Family() == AF_INET6;
+    std::memcpy(slot->remoteAddress, remote.AddressBytes(), remote.AddressSize());
+    slot->remotePort = remote.Port();
+    slot->localPort = localPort;
+    slot->length = (uint16_t)snapped;
+    slot->originalLength = (uint16_t)length;
+    std::memcpy(slot->data, data, snapped);
+    ring.EndPush();
+    captured.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PacketCapture::WriterThreadProc() {
+    SetCurrentThreadBackgroundPriority();
+
+    while (true) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(writerMutex);
+            writerCV.wait_for(lock, std::chrono::milliseconds(CAPTURE_DRAIN_INTERVAL_MS),
+                              [this] { return stopRequested; });
+            stopping = stopRequested;
+        }
+
+        DrainRings();
+        std::fflush(file);
+        if (stopping) break;
+    }
+}
+
+void PacketCapture::DrainRings() {
+    // Each ring is in time order; merge them so the file is too
+    CaptureRing& sendRing = *rings[(size_t)CaptureProducer::SendThread];
+    CaptureRing& receiveRing = *rings[(size_t)CaptureProducer::ReceiveThread];
+    while (true) {
+        CapturedDatagram* sent = sendRing.Front();
+        CapturedDatagram* received = receiveRing.Front();
+        if (!sent && !received) break;
+
+        if (sent && (!received || sent->micros <= received->micros)) {
+            WritePacketBlock(*sent);
+            sendRing.Pop();
+        } else {
+            WritePacketBlock(*received);
+            receiveRing.Pop();
+        }
+    }
+}
+
+bool PacketCapture::WriteHeaderBlocks() {
+    // Section header: host byte order, unknown section length
+    uint8_t section[28];
+    Put32(section, PCAPNG_SECTION_HEADER);
+    Put32(section + 4, sizeof(section));
+    Put32(section + 8, PCAPNG_BYTE_ORDER_MAGIC);
+    Put16(section + 12, 1);
+    Put16(section + 14, 0);
+    Put32(section + 16, 0xFFFFFFFFu);
+    Put32(section + 20, 0xFFFFFFFFu);
+    Put32(section + 24, sizeof(section));
+
+    // One raw IP interface with the default microsecond timestamps
+    uint8_t interface[20];
+    Put32(interface, PCAPNG_INTERFACE_DESCRIPTION);
+    Put32(interface + 4, sizeof(interface));
+    Put16(interface + 8, (uint16_t)LINKTYPE_RAW);
+    Put16(interface + 10, 0);
+    Put32(interface + 12, (uint32_t)(IPV6_HEADER_SIZE + UDP_HEADER_SIZE + CAPTURE_SNAP_LENGTH));
+    Put32(interface + 16, sizeof(interface));
+
+    return std::fwrite(section, 1, sizeof(section), file) == sizeof(section) &&
+           std::fwrite(interface, 1, sizeof(interface), file) == sizeof(interface);
+}
+
+void PacketCapture::WritePacketBlock(const CapturedDatagram& datagram) {
+    size_t ipHeaderSize = datagram.remoteIpv6 ? IPV6_HEADER_SIZE : IPV4_HEADER_SIZE;
+    size_t capturedLength = ipHeaderSize + UDP_HEADER_SIZE + datagram.length;
+    size_t originalLength = ipHeaderSize + UDP_HEADER_SIZE + datagram.originalLength;
+    size_t blockLength = 28 + Pad4(capturedLength) + 12 + 4;
+
+    uint8_t* block = blockBuffer.data();
+    std::memset(block, 0, blockLength);
+    uint64_t micros = (uint64_t)(datagram.micros + wallClockOffsetMicros);
+    Put32(block, PCAPNG_ENHANCED_PACKET);
+    Put32(block + 4, (uint32_t)blockLength);
+    Put32(block + 8, 0);
+    Put32(block + 12, (uint32_t)(micros >> 32));
+    Put32(block + 16, (uint32_t)micros);
+    Put32(block + 20, (uint32_t)capturedLength);
+    Put32(block + 24, (uint32_t)originalLength);
+
+    // The socket is bound to any address, so the local side shows as 0.0.0.0 (or ::)
+    bool outbound = datagram.direction == CaptureDirection::Outbound;
+    uint8_t* ip = block + 28;
+    if (datagram.remoteIpv6) {
+        ip[0] = 0x60;
+        PutBig16(ip + 4, (uint16_t)(UDP_HEADER_SIZE + datagram.originalLength));
+        ip[6] = IP_PROTOCOL_UDP;
+        ip[7] = 64;
+        std::memcpy(ip + (outbound ? 24 : 8), datagram.remoteAddress, 16);
+    } else {
+        ip[0] = 0x45;
+        PutBig16(ip + 2, (uint16_t)originalLength);
+        PutBig16(ip + 6, 0x4000);   // don't fragment
+        ip[8] = 64;
+        ip[9] = IP_PROTOCOL_UDP;
+        std::memcpy(ip + (outbound ? 16 : 12), datagram.remoteAddress, 4);
+        PutBig16(ip + 10, Ipv4Checksum(ip));
+    }
+
+    uint8_t* udp = ip + ipHeaderSize;
+    PutBig16(udp, outbound ? datagram.localPort : datagram.remotePort);
+    PutBig16(udp + 2, outbound ? datagram.remotePort : datagram.localPort);
+    PutBig16(udp + 4, (uint16_t)(UDP_HEADER_SIZE + datagram.originalLength));
+    std::memcpy(udp + UDP_HEADER_SIZE, datagram.data, datagram.length);
+
+    uint8_t* options = block + 28 + Pad4(capturedLength);
+    Put16(options, PCAPNG_OPT_EPB_FLAGS);
+    Put16(options + 2, 4);
+    Put32(options + 4, outbound ? PCAPNG_FLAG_OUTBOUND : PCAPNG_FLAG_INBOUND);
+    Put16(options + 8, PCAPNG_OPT_END);
+    Put16(options + 10, 0);
+    Put32(options + 12, (uint32_t)blockLength);
+
+    if (std::fwrite(block, 1, blockLength, file) != blockLength) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+PacketCaptureReader::PacketCaptureReader()
+    : file(nullptr), classic(false), swapped(false), classicNanos(false), classicLinkType(0) {
+}
+
+PacketCaptureReader::~PacketCaptureReader() {
+    Close();
+}
+
+bool PacketCaptureReader::Open(const std::string& filename) {
+    Close();
+
+    file = std::fopen(filename.c_str(), "rb");
+    if (!file) {
+        LOG_ERROR("Cannot open packet capture: " + filename);
+        return false;
+    }
+
+    uint8_t header[PCAP_FILE_HEADER_SIZE];
+    if (std::fread(header, 1, 4, file) != 4) {
+        Close();
+        return false;
+    }
+
+    uint32_t magic;
+    std::memcpy(&magic, header, 4);
+    uint32_t swappedMagic = Swap32(magic);
+    if (magic == PCAPNG_SECTION_HEADER) {
+        // Byte order is settled by the section header, read as the first block
+        classic = false;
+        std::fseek(file, 0, SEEK_SET);
+        return true;
+    }
+
+    if (magic == PCAP_MAGIC_MICROS || magic == PCAP_MAGIC_NANOS ||
+        swappedMagic == PCAP_MAGIC_MICROS || swappedMagic == PCAP_MAGIC_NANOS) {
+        classic = true;
+        swapped = swappedMagic == PCAP_MAGIC_MICROS || swappedMagic == PCAP_MAGIC_NANOS;
+        classicNanos = magic == PCAP_MAGIC_NANOS || swappedMagic == PCAP_MAGIC_NANOS;
+        if (std::fread(header + 4, 1, PCAP_FILE_HEADER_SIZE - 4, file) != PCAP_FILE_HEADER_SIZE - 4) {
+            Close();
+            return false;
+        }
+        classicLinkType = Read32(header + 20) & 0xFFFF;
+        return true;
+    }
+
+    LOG_ERROR("Not a pcap or pcapng file: " + filename);
+    Close();
+    return false;
+}
+
+void PacketCaptureReader::Close() {
+    if (file) {
+        std::fclose(file);
+        file = nullptr;
+    }
+    linkTypes.clear();
+    ticksPerSecond.clear();
+}
+
+uint16_t PacketCaptureReader::Read16(const uint8_t* p) const {
+    uint16_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return swapped ? Swap16(v) : v;
+}
+
+uint32_t PacketCaptureReader::Read32(const uint8_t* p) const {
+    uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return swapped ? Swap32(v) : v;
+}
+
+bool PacketCaptureReader::Next(CapturedDatagram& datagram, uint16_t localPort) {
+    if (!file) return false;
+    if (classic) return NextClassic(datagram, localPort);
+
+    while (true) {
+        uint8_t head[8];
+        if (std::fread(head, 1, sizeof(head), file) != sizeof(head)) return false;
+
+        uint32_t rawType;
+        std::memcpy(&rawType, head, 4);
+        if (rawType == PCAPNG_SECTION_HEADER) {
+            // New section: its byte order magic decides how to read it
+            uint8_t magic[4];
+            if (std::fread(magic, 1, 4, file) != 4) return false;
+            uint32_t value;
+            std::memcpy(&value, magic, 4);
+            if (value == PCAPNG_BYTE_ORDER_MAGIC) {
+                swapped = false;
+            } else if (Swap32(value) == PCAPNG_BYTE_ORDER_MAGIC) {
+                swapped = true;
+            } else {
+                return false;
+            }
+            linkTypes.clear();
+            ticksPerSecond.clear();
+            uint32_t length = Read32(head + 4);
+            if (length < 28 || length % 4 != 0) return false;
+            std::fseek(file, (long)(length - 12), SEEK_CUR);
+            continue;
+        }
+
+        uint32_t type = Read32(head);
+        uint32_t length = Read32(head + 4);
+        if (length < 12 || length % 4 != 0 || length > PCAPNG_MAX_BLOCK_SIZE) return false;
+
+        blockBuffer.resize(length - 8);
+        if (std::fread(blockBuffer.data(), 1, blockBuffer.size(), file) != blockBuffer.size()) return false;
+        const uint8_t* body = blockBuffer.data();
+        size_t bodyLength = length - 12;
+
+        if (type == PCAPNG_INTERFACE_DESCRIPTION) {
+            ParseInterface(body, bodyLength);
+            continue;
+        }
+        if (type != PCAPNG_ENHANCED_PACKET && type != PCAPNG_SIMPLE_PACKET) continue;
+
+        uint32_t interfaceId = 0;
+        uint64_t timestamp = 0;
+        size_t frameOffset = 4;
+        size_t frameLength = 0;
+        if (type == PCAPNG_ENHANCED_PACKET) {
+            if (bodyLength < 20) return false;
+            interfaceId = Read32(body);
+            timestamp = ((uint64_t)Read32(body + 4) << 32) | Read32(body + 8);
+            frameLength = Read32(body + 12);
+            frameOffset = 20;
+        } else {
+            frameLength = bodyLength - 4;
+        }
+        if (interfaceId >= linkTypes.size() || frameOffset + frameLength > bodyLength) continue;
+
+        UdpEndpoints endpoints{};
+        if (!ParseFrame(linkTypes[interfaceId], body + frameOffset, frameLength, datagram, endpoints)) continue;
+        uint64_t ticks = ticksPerSecond[interfaceId];
+        datagram.micros = ticks == 1000000 ? (int64_t)timestamp :
+                          (int64_t)((double)timestamp * 1e6 / (double)ticks);
+
+        // Packet flags, when present, say which way it went
+        uint32_t flags = 0;
+        size_t option = frameOffset + Pad4(frameLength);
+        while (type == PCAPNG_ENHANCED_PACKET && option + 4 <= bodyLength) {
+            uint16_t code = Read16(body + option);
+            uint16_t optionLength = Read16(body + option + 2);
+            if (code == PCAPNG_OPT_END || option + 4 + optionLength > bodyLength) break;
+            if (code == PCAPNG_OPT_EPB_FLAGS && optionLength == 4) {
+                flags = Read32(body + option + 4);
+            }
+            option += 4 + Pad4(optionLength);
+        }
+
+        bool outbound = (flags & 3) == PCAPNG_FLAG_OUTBOUND ||
+                        ((flags & 3) == 0 && localPort != 0 && endpoints.sourcePort == localPort &&
+                         endpoints.destinationPort != localPort);
+        SetDirection(datagram, endpoints, outbound);
+        return true;
+    }
+}
+
+bool PacketCaptureReader::NextClassic(CapturedDatagram& datagram, uint16_t localPort) {
+    while (true) {
+        uint8_t record[PCAP_RECORD_HEADER_SIZE];
+        if (std::fread(record, 1, sizeof(record), file) != sizeof(record)) return false;
+
+        uint32_t seconds = Read32(record);
+        uint32_t fraction = Read32(record + 4);
+        uint32_t capturedLength = Read32(record + 8);
+        if (capturedLength > PCAPNG_MAX_BLOCK_SIZE) return false;
+
+        blockBuffer.resize(capturedLength);
+        if (std::fread(blockBuffer.data(), 1, capturedLength, file) != capturedLength) return false;
+
+        UdpEndpoints endpoints{};
+        if (!ParseFrame(classicLinkType, blockBuffer.data(), capturedLength, datagram, endpoints)) continue;
+        datagram.micros = (int64_t)seconds * 1000000 + (classicNanos ? fraction / 1000 : fraction);
+
+        bool outbound = localPort != 0 && endpoints.sourcePort == localPort && endpoints.destinationPort != localPort;
+        SetDirection(datagram, endpoints, outbound);
+        return true;
+    }
+}
+
+void PacketCaptureReader::ParseInterface(const uint8_t* body, size_t length) {
+    if (length < 8) return;
+    linkTypes.push_back(Read16(body));
+
+    // Default resolution is microseconds; if_tsresol overrides it
+    uint64_t ticks = 1000000;
+    size_t option = 8;
+    while (option + 4 <= length) {
+        uint16_t code = Read16(body + option);
+        uint16_t optionLength = Read16(body + option + 2);
+        if (code == PCAPNG_OPT_END || option + 4 + optionLength > length) break;
+        if (code == PCAPNG_OPT_IF_TSRESOL && optionLength >= 1) {
+            uint8_t resolution = body[option + 4];
+            uint32_t exponent = resolution & 0x7F;
+            if (exponent < 64) {
+                ticks = 1;
+                for (uint32_t i = 0; i < exponent; i++) ticks *= (resolution & 0x80) ? 2 : 10;
+            }
+        }
+        option += 4 + Pad4(optionLength);
+    }
+    ticksPerSecond.push_back(ticks);
+}
+
+bool PacketCaptureReader::ParseFrame(uint32_t linkType, const uint8_t* frame, size_t length,
+                                     CapturedDatagram& datagram, UdpEndpoints& endpoints) {
+    if (linkType == LINKTYPE_ETHERNET) {
+        if (length < 14) return false;
+        size_t offset = 12;
+        uint16_t etherType = GetBig16(frame + offset);
+        if (etherType == 0x8100 && length >= 18) {   // one VLAN tag
+            offset += 4;
+            etherType = GetBig16(frame + offset);
+        }
+        if (etherType != 0x0800 && etherType != 0x86DD) return false;
+        frame += offset + 2;
+        length -= offset + 2;
+    } else if (linkType != LINKTYPE_RAW && linkType != LINKTYPE_IPV4 && linkType != LINKTYPE_IPV6) {
+        return false;
+    }
+
+    if (length < 1) return false;
+    size_t ipHeaderLength = 0;
+    std::memset(&endpoints, 0, sizeof(endpoints));
+    if ((frame[0] >> 4) == 6) {
+        if (length < IPV6_HEADER_SIZE || frame[6] != IP_PROTOCOL_UDP) return false;
+        ipHeaderLength = IPV6_HEADER_SIZE;
+        endpoints.ipv6 = true;
+        std::memcpy(endpoints.sourceAddress, frame + 8, 16);
+        std::memcpy(endpoints.destinationAddress, frame + 24, 16);
+    } else {
+        if (length < IPV4_HEADER_SIZE || (frame[0] >> 4) != 4 || frame[9] != IP_PROTOCOL_UDP) return false;
+        ipHeaderLength = (size_t)(frame[0] & 0x0F) * 4;
+        if ((GetBig16(frame + 6) & 0x1FFF) != 0) return false;   // later fragment
+        std::memcpy(endpoints.sourceAddress, frame + 12, 4);
+        std::memcpy(endpoints.destinationAddress, frame + 16, 4);
+    }
+    if (length < ipHeaderLength + UDP_HEADER_SIZE) return false;
+
+    const uint8_t* udp = frame + ipHeaderLength;
+    endpoints.sourcePort = GetBig16(udp);
+    endpoints.destinationPort = GetBig16(udp + 2);
+
+    size_t udpLength = GetBig16(udp + 4);
+    if (udpLength < UDP_HEADER_SIZE) return false;
+    size_t payloadLength = udpLength - UDP_HEADER_SIZE;
+    size_t available = length - ipHeaderLength - UDP_HEADER_SIZE;
+    size_t copied = payloadLength < available ? payloadLength : available;
+    if (copied > CAPTURE_SNAP_LENGTH) copied = CAPTURE_SNAP_LENGTH;
+
+    datagram.length = (uint16_t)copied;
+    datagram.originalLength = (uint16_t)payloadLength;
+    std::memcpy(datagram.data, udp + UDP_HEADER_SIZE, copied);
+    return true;
+}
+
+void PacketCaptureReader::SetDirection(CapturedDatagram& datagram, const UdpEndpoints& endpoints, bool outbound) {
+    datagram.direction = outbound ? CaptureDirection::Outbound : CaptureDirection::Inbound;
+    std::memcpy(datagram.remoteAddress, outbound ? endpoints.destinationAddress : endpoints.sourceAddress, 16);
+    datagram.remoteIpv6 = endpoints.ipv6;
+    datagram.remotePort = outbound ? endpoints.destinationPort : endpoints.sourcePort;
+    datagram.localPort = outbound ? endpoints.sourcePort : endpoints.destinationPort;
+}
@@ -0,0 +1,105 @@
+#include <networking/PathSelector.h>
+#include <platform/Random.h>
+#include <cstring>
+
+PathSelector::PathSelector()
+    : count(0), selected(0), transactionPrefix{} {
+}
+
+void PathSelector::Reset(const uint8_t* preferences, size_t candidateCount) {
+    count = candidateCount < MAX_PATH_CANDIDATES ? candidateCount : MAX_PATH_CANDIDATES;
+    selected = 0;
+    for (size_t i = 0; i < MAX_PATH_CANDIDATES; i++) {
+        candidates[i] = CandidateState{};
+        if (i < count) candidates[i].preference = preferences[i];
+    }
+
+    // Responses are told apart from other peers' by the random prefix; with
+    // no random source a fixed prefix still works, just less robustly
+    if (!FillRandomBytes(transactionPrefix, sizeof(transactionPrefix))) {
+        std::memset(transactionPrefix, 0x5A, sizeof(transactionPrefix));
+    }
+}
+
+bool PathSelector::NextCheck(int64_t nowMicros, size_t& candidate, PathCheckMessage& request) {
+    // With no path up the peer's audio is held, so look for one more often
+    int64_t interval = HasWorkingPath(nowMicros) ? PATH_CHECK_INTERVAL_MICROS : PATH_RECHECK_INTERVAL_MICROS;
+    for (size_t i = 0; i < count; i++) {
+        CandidateState& state = candidates[i];
+        if (state.lastCheckMicros >= 0 && nowMicros - state.lastCheckMicros < interval) continue;
+
+        state.lastCheckMicros = nowMicros;
+
+        candidate = i;
+        request.response = false;
+        std::memcpy(request.transactionId, transactionPrefix, sizeof(transactionPrefix));
+        uint8_t* id = request.transactionId + sizeof(transactionPrefix);
+        id[0] = (uint8_t)i;
+        id[1] = (uint8_t)(nowMicros >> 16);
+        id[2] = (uint8_t)(nowMicros >> 8);
+        id[3] = (uint8_t)nowMicros;
+        return true;
+    }
+    return false;
+}
+
+bool PathSelector::OnResponse(const PathCheckMessage& response, int64_t nowMicros) {
+    if (std::memcmp(response.transactionId, transactionPrefix, sizeof(transactionPrefix)) != 0) return false;
+
+    const uint8_t* id = response.transactionId + sizeof(transactionPrefix);
+    if (id[0] >= count) return true;
+    CandidateState& state = candidates[id[0]];
+
+    // Send time modulo 2^24 us (16.7 s), far beyond any round trip worth measuring
+    uint32_t sentMicros = ((uint32_t)id[1] << 16) | ((uint32_t)id[2] << 8) | id[3];
+    int64_t sample = (int64_t)(((uint32_t)nowMicros - sentMicros) & 0xFFFFFFu);
+
+    // Smoothed like TCP's SRTT, gain 1/4 so a path's change shows within a second
+    state.rttMicros = state.rttMicros < 0 ? sample : state.rttMicros + (sample - state.rttMicros) / 4;
+    state.lastAnswerMicros = nowMicros;
+    return true;
+}
+
+bool PathSelector::IsWorking(size_t candidate, int64_t nowMicros) const {
+    const CandidateState& state = candidates[candidate];
+    return state.lastAnswerMicros > 0 && nowMicros - state.lastAnswerMicros <= PATH_FAILED_MICROS;
+}
+
+bool PathSelector::HasWorkingPath(int64_t nowMicros) const {
+    for (size_t i = 0; i < count; i++) {
+        if (IsWorking(i, nowMicros)) return true;
+    }
+    return false;
+}
+
+bool PathSelector::IsBetter(size_t a, size_t b) const {
+    int64_t difference = candidates[a].rttMicros - candidates[b].rttMicros;
+    if (difference > -PATH_SWITCH_MIN_MICROS && difference < PATH_SWITCH_MIN_MICROS) {
+        return candidates[a].preference > candidates[b].preference;
+    }
+    return difference < 0;
+}
+
+bool PathSelector::Update(int64_t nowMicros) {
+    size_t best = count;
+    for (size_t i = 0; i < count; i++) {
+        if (!IsWorking(i, nowMicros)) continue;
+        if (best == count || IsBetter(i, best)) best = i;
+    }
+
+    // Nothing answering: stay put rather than guess
+    if (best == count || best == selected) return false;
+
+    if (IsWorking(selected, nowMicros)) {
+        const CandidateState& current = candidates[selected];
+        const CandidateState& candidate = candidates[best];
+        bool preferred = candidate.preference > current.preference &&
+                         candidate.rttMicros < current.rttMicros + PATH_SWITCH_MIN_MICROS;
+        bool faster = candidate.rttMicros + PATH_SWITCH_MIN_MICROS <= current.rttMicros &&
+                      candidate.rttMicros <= current.rttMicros * PATH_SWITCH_RATIO;
+        if (!preferred && !faster) return false;
+    }
+
+    selected = best;
+    return true;
+}
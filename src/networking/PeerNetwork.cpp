@@ -1,18 +1,50 @@
-#define NOMINMAX
-
-#include <winsock2.h>
-#include <ws2tcpip.h>
-#include <windows.h>
-#include <iphlpapi.h>
+#include <networking/PeerNetwork.h>
+#include <utils/Logger.h>
+#include <utils/Metrics.h>
+#include <utils/ThreadRuntime.h>
+#include <networking/LatencyProbe.h>
+#include <platform/Random.h>
+#include <platform/Timer.h>
 
 #include <algorithm>
+#include <cstring>
+
+// Control thread wake-up: well inside the heartbeat interval
+constexpr uint32_t CONTROL_POLL_MS = 10;
+
+// Blocking helpers for the control handshake
+static bool SendAll(SocketHandle s, const uint8_t* data, size_t length) {
+    size_t sent = 0;
+    while (sent < length) {
+        int result = (int)send(s, (const char*)data + sent, (int)(length - sent), SOCKET_SEND_FLAGS);
+        if (result <= 0) return false;
+        sent += result;
+    }
+    return true;
+}
 
-#include <networking/PeerNetwork.h>
-#include <utils/Logger.h>
+static bool RecvAll(SocketHandle s, uint8_t* data, size_t length) {
+    size_t received = 0;
+    while (received < length) {
+        int result = (int)recv(s, (char*)data + received, (int)(length - received), 0);
+        if (result <= 0) return false;
+        received += result;
+    }
+    return true;
+}
 
+static bool IsZeroToken(const uint8_t* token) {
+    uint8_t bits = 0;
+    for (size_t i = 0; i < CONTROL_SESSION_TOKEN_SIZE; i++) bits |= token[i];
+    return bits == 0;
+}
 
-#pragma comment(lib, "ws2_32.lib")
-#pragma comment(lib, "iphlpapi.lib")
+// Constant time: the token is all a resume needs
+static bool TokensEqual(const uint8_t* a, const uint8_t* b) {
+    uint8_t difference = 0;
+    for (size_t i = 0; i < CONTROL_SESSION_TOKEN_SIZE; i++) difference |= a[i] ^ b[i];
+    return difference == 0;
+}
 
 PeerNetwork& PeerNetwork::GetInstance() {
     static PeerNetwork instance;
@@ -21,11 +53,21 @@ PeerNetwork& PeerNetwork::GetInstance() {
 
 PeerNetwork::PeerNetwork()
     : maxParticipants(MAX_PARTICIPANTS), expectedParticipants(2),
-      listeningSocket(INVALID_SOCKET), listening(false) {
+      listeningSocket(INVALID_SOCKET_HANDLE), listening(false), controlRunning(false),
+      preferredPacketTime(DEFAULT_PACKET_TIME), sessionPacketTime(DEFAULT_PACKET_TIME),
+      localAudioPort(DEFAULT_AUDIO_PORT), mediaEncryption(true), roomSecret(false), roomKey{} {
+    PublishPeers();
 }
 
 PeerNetwork::~PeerNetwork() {
     Shutdown();
+    SecureZero(roomKey, sizeof(roomKey));
+}
+
+// For the join and accept log lines
+static const char* MediaSecurityNote(const PeerInfo& peer) {
+    if (!peer.encrypted) return "";
+    return peer.authenticated ? " (media encrypted, room secret)" : " (media encrypted, unauthenticated)";
 }
 
 bool PeerNetwork::Initialize(int maxPeers) {
@@ -34,13 +76,15 @@ bool PeerNetwork::Initialize(int maxPeers) {
     maxParticipants = std::min(maxPeers, MAX_PARTICIPANTS);
     maxParticipants = std::max(maxParticipants, MIN_PARTICIPANTS);
 
-    WSADATA wsaData;
-    int result = WSAStartup(MAKEWORD(2, 2), &wsaData);
-    if (result != 0) {
-        LOG_ERROR("WSAStartup failed: " + std::to_string(result));
+    if (!SocketStartup()) {
+        LOG_ERROR("Socket startup failed: " + std::to_string(GetLastSocketError()));
         return false;
     }
 
+    if (!controlRunning.exchange(true)) {
+        controlThread = std::thread(&PeerNetwork::ControlThreadProc, this);
+    }
+
     LOG_INFO("Peer Network initialized successfully");
     return true;
 }
@@ -50,13 +94,32 @@ void PeerNetwork::Shutdown() {
 
     StopListening();
 
+    controlRunning = false;
+    if (controlThread.joinable()) {
+        controlThread.join();
+    }
+
     {
+        // Peers drop us at once instead of waiting for us to resume
+        uint8_t leave[CONTROL_MESSAGE_SIZE];
+        WriteControlMessage(leave, ControlMessageType::Leave);
+
         std::lock_guard<std::mutex> lock(peersMutex);
+        for (auto& entry : sessions) {
+            if (entry.second.socket == INVALID_SOCKET_HANDLE) continue;
+            const PeerInfo* peer = FindPeer(entry.first);
+            if (peer && peer->resumable) {
+                send(entry.second.socket, (const char*)leave, (int)sizeof(leave), SOCKET_SEND_FLAGS);
+            }
+            CloseSocket(entry.second.socket);
+        }
+        for (const auto& peer : peers) MetricsRegistry::GetInstance().ReleasePeer(peer.id);
         peers.clear();
-        socketToPeerMap.clear();
+        sessions.clear();
+        PublishPeers();
     }
 
-    WSACleanup();
+    SocketCleanup();
 }
 
 bool PeerNetwork::StartListening(uint16_t port) {
@@ -64,45 +127,26 @@ bool PeerNetwork::StartListening(uint16_t port) {
 
     LOG_INFO("Starting to listen for peer connections on port " + std::to_string(port));
 
-    listeningSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (listeningSocket == INVALID_SOCKET) {
-        LOG_ERROR("Failed to create listening socket");
+    // Dual-stack, so joiners can come in over IPv4 or IPv6
+    int family = AF_INET;
+    listeningSocket = OpenDualStackSocket(SOCK_STREAM, IPPROTO_TCP, port, family);
+    if (listeningSocket == INVALID_SOCKET_HANDLE) {
+        LOG_ERROR("Failed to create and bind listening socket");
         return false;
     }
 
     // Set socket to non-blocking
-    u_long nonBlocking = 1;
-    if (ioctlsocket(listeningSocket, FIONBIO, &nonBlocking) == SOCKET_ERROR) {
+    if (!SetSocketBlocking(listeningSocket, false)) {
         LOG_ERROR("Failed to set socket to non-blocking");
-        closesocket(listeningSocket);
-        return false;
-    }
-
-    // Allow address reuse
-    int reuseAddr = 1;
-    if (setsockopt(listeningSocket, SOL_SOCKET, SO_REUSEADDR,
-                   (const char*)&reuseAddr, sizeof(reuseAddr)) == SOCKET_ERROR) {
-        LOG_ERROR("Failed to set SO_REUSEADDR");
-        closesocket(listeningSocket);
-        return false;
-    }
-
-    // Bind socket
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    addr.sin_port = htons(port);
-
-    if (bind(listeningSocket, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
-        LOG_ERROR("Failed to bind listening socket");
-        closesocket(listeningSocket);
+        CloseSocket(listeningSocket);
+        listeningSocket = INVALID_SOCKET_HANDLE;
         return false;
     }
 
     // Listen
-    if (listen(listeningSocket, maxParticipants - 1) == SOCKET_ERROR) {
+    if (listen(listeningSocket, maxParticipants - 1) != 0) {
         LOG_ERROR("Failed to listen on socket");
-        closesocket(listeningSocket);
+        CloseSocket(listeningSocket);
         return false;
     }
 
@@ -122,9 +166,9 @@ void PeerNetwork::StopListening() {
         acceptThread.join();
     }
 
-    if (listeningSocket != INVALID_SOCKET) {
-        closesocket(listeningSocket);
-        listeningSocket = INVALID_SOCKET;
+    if (listeningSocket != INVALID_SOCKET_HANDLE) {
+        CloseSocket(listeningSocket);
+        listeningSocket = INVALID_SOCKET_HANDLE;
     }
 
     LOG_INFO("Listening stopped");
@@ -133,39 +177,53 @@ void PeerNetwork::StopListening() {
 bool PeerNetwork::ConnectToPeer(const std::string& peerIP, uint16_t port) {
     LOG_INFO("Attempting to connect to peer: " + peerIP + ":" + std::to_string(port));
 
-    SOCKET peerSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
-    if (peerSocket == INVALID_SOCKET) {
-        LOG_ERROR("Failed to create peer socket");
+    SocketAddress addr;
+    if (!SocketAddress::FromString(peerIP, port, addr)) {
+        LOG_ERROR("Not an IPv4 or IPv6 address: " + peerIP);
         return false;
     }
 
-    sockaddr_in addr{};
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-    inet_pton(AF_INET, peerIP.c_str(), &addr.sin_addr);
+    if (GetConnectedPeersCount() >= maxParticipants - 1) {
+        LOG_ERROR("Already connected to " + std::to_string(maxParticipants - 1) + " peers");
+        return false;
+    }
+
+    SocketHandle peerSocket = socket(addr.Family(), SOCK_STREAM, IPPROTO_TCP);
+    if (peerSocket == INVALID_SOCKET_HANDLE) {
+        LOG_ERROR("Failed to create peer socket");
+        return false;
+    }
 
-    if (connect(peerSocket, (sockaddr*)&addr, sizeof(addr)) == SOCKET_ERROR) {
-        int error = WSAGetLastError();
+    if (!ConnectSocket(peerSocket, addr, CONNECTION_TIMEOUT)) {
+        int error = GetLastSocketError();
         LOG_ERROR("Failed to connect to peer: " + std::to_string(error));
-        closesocket(peerSocket);
+        CloseSocket(peerSocket);
+        return false;
+    }
+
+    ControlHello remoteHello{};
+    PeerInfo peerInfo{};
+    uint8_t sessionToken[CONTROL_SESSION_TOKEN_SIZE] = {};
+    if (!ExchangeHello(peerSocket, false, remoteHello, peerInfo, sessionToken)) {
+        LOG_ERROR("Control handshake with " + peerIP + " failed");
+        CloseSocket(peerSocket);
         return false;
     }
 
-    PeerID peerId = GeneratePeerID();
+    // The host's answer carries the session packet time
+    sessionPacketTime = remoteHello.packetTime;
+    LOG_INFO("Session packet time: " + std::string(PacketTimeToString(remoteHello.packetTime)));
 
     {
         std::lock_guard<std::mutex> lock(peersMutex);
-        PeerInfo peerInfo{};
-        peerInfo.id = peerId;
-        peerInfo.ipAddress = peerIP;
-        peerInfo.audioPort = port;
-        peerInfo.connected = true;
-        peerInfo.lastHeartbeat = std::chrono::steady_clock::now();
-        peers.push_back(peerInfo);
-        socketToPeerMap[peerSocket] = peerId;
+        AddPeer(peerInfo, peerSocket, addr, remoteHello, sessionToken, port);
     }
+    SecureZero(&peerInfo.mediaKeys, sizeof(peerInfo.mediaKeys));   // the list has its own copy
+    SecureZero(sessionToken, sizeof(sessionToken));
 
-    LOG_INFO("Connected to peer " + std::to_string(peerId));
+    LOG_INFO("Connected to peer " + std::to_string(peerInfo.id) + MediaSecurityNote(peerInfo) +
+             ", " + std::to_string(peerInfo.candidateCount) + " candidate path(s)" +
+             (peerInfo.resumable ? ", resumable" : ""));
     return true;
 }
 
@@ -193,8 +251,21 @@ bool PeerNetwork::IsAllPeersConnected() const {
     return true;
 }
 
-const std::vector<PeerInfo>& PeerNetwork::GetPeers() const {
-    return peers;
+PeerList PeerNetwork::GetPeers() const {
+    std::lock_guard<std::mutex> lock(publishedMutex);
+    return publishedPeers;
+}
+
+void PeerNetwork::PublishPeers() {
+    // A fresh copy each time: readers keep whichever one they took
+    PeerList list(new std::vector<PeerInfo>(peers), [](std::vector<PeerInfo>* copy) {
+        for (auto& peer : *copy) SecureZero(&peer.mediaKeys, sizeof(peer.mediaKeys));
+        delete copy;
+    });
+
+    // The old list goes after the lock, with its last holder
+    std::lock_guard<std::mutex> lock(publishedMutex);
+    publishedPeers.swap(list);
 }
 
 void PeerNetwork::SetExpectedParticipants(int count) {
@@ -207,44 +278,278 @@ int PeerNetwork::GetExpectedParticipants() const {
     return expectedParticipants;
 }
 
-void PeerNetwork::AcceptThreadProc() {
-    while (listening) {
-        sockaddr_in clientAddr{};
-        int addrLen = sizeof(clientAddr);
+void PeerNetwork::SetPreferredPacketTime(PacketTime ptime) {
+    preferredPacketTime = ptime;
+    LOG_INFO("Preferred packet time set to: " + std::string(PacketTimeToString(ptime)));
+}
 
-        SOCKET clientSocket = accept(listeningSocket, (sockaddr*)&clientAddr, &addrLen);
-        if (clientSocket == INVALID_SOCKET) {
-            Sleep(100);
-            continue;
+PacketTime PeerNetwork::GetPreferredPacketTime() const {
+    return preferredPacketTime;
+}
+
+void PeerNetwork::SetLocalAudioPort(uint16_t port) {
+    localAudioPort = port;
+}
+
+void PeerNetwork::SetRoomSecret(const std::string& secret) {
+    roomSecret = !secret.empty();
+    if (roomSecret) {
+        DeriveRoomKey((const uint8_t*)secret.data(), secret.size(), roomKey);
+    } else {
+        SecureZero(roomKey, sizeof(roomKey));
+    }
+    LOG_INFO(std::string("Room secret ") + (roomSecret ? "set: only peers that share it can join" : "not set"));
+}
+
+void PeerNetwork::SetMediaEncryption(bool enabled) {
+    mediaEncryption = enabled;
+    LOG_INFO(std::string("Media encryption ") + (enabled ? "offered" : "off"));
+}
+
+bool PeerNetwork::GetMediaEncryption() const {
+    return mediaEncryption;
+}
+
+PacketTime PeerNetwork::GetSessionPacketTime() const {
+    return sessionPacketTime;
+}
+
+bool PeerNetwork::ExchangeHello(SocketHandle peerSocket, bool isHost, ControlHello& remoteHello,
+                                PeerInfo& peerInfo, uint8_t* sessionToken) {
+    // The handshake runs blocking with a timeout (accepted sockets inherit non-blocking mode on Windows)
+    SetSocketBlocking(peerSocket, true);
+    SetSocketTimeouts(peerSocket, CONNECTION_TIMEOUT);
+
+    ControlHello localHello{};
+    localHello.version = CONTROL_VERSION;
+    localHello.audioPort = localAudioPort;
+    localHello.packetTime = preferredPacketTime;
+
+    // A fresh key pair per connection; the private half is wiped however this returns
+    uint8_t privateKey[MEDIA_KEY_SIZE];
+    struct KeyWipe {
+        uint8_t* key;
+        ~KeyWipe() { SecureZero(key, MEDIA_KEY_SIZE); }
+    } keyWipe{privateKey};
+    if (mediaEncryption) {
+        if (!GenerateMediaKeyPair(privateKey, localHello.publicKey)) {
+            LOG_ERROR("Failed to generate a media key pair");
+            return false;
         }
+        localHello.flags |= CONTROL_FLAG_MEDIA_ENCRYPTION;
+    }
+    if (roomSecret) localHello.flags |= CONTROL_FLAG_ROOM_SECRET;   // the host fills in its proof below
+    GatherCandidates(localHello);
+
+    uint8_t message[CONTROL_MAX_MESSAGE_SIZE];
+
+    if (!isHost) {
+        localHello.flags |= CONTROL_FLAG_SESSION;
+        std::memcpy(localHello.sessionToken, sessionToken, CONTROL_SESSION_TOKEN_SIZE);
+        size_t helloSize = WriteControlHello(message, localHello);
+        if (!SendAll(peerSocket, message, helloSize)) return false;
+    }
+
+    if (!RecvAll(peerSocket, message, CONTROL_PREFIX_SIZE)) return false;
+    size_t length = ReadControlMessageLength(message);
+    if (length < CONTROL_HELLO_SIZE) return false;
+    if (!RecvAll(peerSocket, message + CONTROL_PREFIX_SIZE, length - CONTROL_PREFIX_SIZE)) return false;
+    if (!ParseControlHello(message, length, remoteHello)) return false;
+
+    bool peerOffered = (remoteHello.flags & CONTROL_FLAG_MEDIA_ENCRYPTION) != 0;
+    bool peerRoomSecret = (remoteHello.flags & CONTROL_FLAG_ROOM_SECRET) != 0;
+
+    // With a room secret, encrypted media under it or nothing: one in the
+    // middle could otherwise strip the flag or the encryption offer
+    if (roomSecret && !(mediaEncryption && peerOffered && peerRoomSecret)) {
+        LOG_ERROR("Peer did not offer encryption under a room secret; refusing it");
+        return false;
+    }
+    if (!roomSecret && peerRoomSecret) {
+        LOG_ERROR("Peer expects a room secret and none is set; refusing it");
+        return false;
+    }
 
+    // Keys as soon as both public keys are known, so the host can prove them in its hello
+    bool encrypt = mediaEncryption && peerOffered;
+    if (encrypt && !DeriveMediaKeys(privateKey, remoteHello.publicKey, isHost, roomSecret ? roomKey : nullptr,
+                                    peerInfo.mediaKeys)) {
+        LOG_ERROR("Peer sent an invalid media public key");
+        return false;
+    }
+    if (roomSecret && isHost) {
+        std::memcpy(localHello.keyProof, peerInfo.mediaKeys.proof, MEDIA_KEY_PROOF_SIZE);
+    } else if (roomSecret && !MediaKeyProofsEqual(remoteHello.keyProof, peerInfo.mediaKeys.proof)) {
+        // The host has taken us in by now: say we are leaving so it does not wait for a resume
+        LOG_ERROR("Host's media keys differ from ours: another room secret, or someone in the middle");
+        uint8_t leave[CONTROL_MESSAGE_SIZE];
+        SendAll(peerSocket, leave, WriteControlMessage(leave, ControlMessageType::Leave));
+        return false;
+    }
+
+    if (isHost) {
+        // The first peer settles the session packet time; later peers join at it
+        // A known token resumes that session and is echoed; anything else gets a new one
+        bool sessionOffered = (remoteHello.flags & CONTROL_FLAG_SESSION) != 0;
+        bool firstPeer;
+        bool knownSession = false;
         {
             std::lock_guard<std::mutex> lock(peersMutex);
+            firstPeer = peers.empty();
+            if (sessionOffered) knownSession = FindSessionByToken(remoteHello.sessionToken) != 0;
+        }
+        if (knownSession) {
+            std::memcpy(localHello.sessionToken, remoteHello.sessionToken, CONTROL_SESSION_TOKEN_SIZE);
+        } else if (sessionOffered && !FillRandomBytes(localHello.sessionToken, CONTROL_SESSION_TOKEN_SIZE)) {
+            LOG_WARNING("No random source for a session token; this connection cannot be resumed");
+            sessionOffered = false;
+        }
+        if (sessionOffered) localHello.flags |= CONTROL_FLAG_SESSION;
+        if (firstPeer) {
+            sessionPacketTime = NegotiatePacketTime(preferredPacketTime, remoteHello.packetTime);
+            LOG_INFO("Session packet time: " + std::string(PacketTimeToString(sessionPacketTime)));
+        }
 
-            // Check if we've reached the participant limit
-            if (peers.size() >= (size_t)(expectedParticipants - 1)) {
-                LOG_WARNING("Maximum participants reached, rejecting connection");
-                closesocket(clientSocket);
-                continue;
-            }
+        // Our key and candidates go back only to a peer that sent its own, so both sides agree
+        localHello.packetTime = sessionPacketTime;
+        if (!peerOffered) {
+            localHello.flags &= static_cast<uint8_t>(~CONTROL_FLAG_MEDIA_ENCRYPTION);
+        }
+        if ((remoteHello.flags & CONTROL_FLAG_CANDIDATES) == 0) {
+            localHello.flags &= static_cast<uint8_t>(~CONTROL_FLAG_CANDIDATES);
+        }
+        size_t helloSize = WriteControlHello(message, localHello);
+        if (!SendAll(peerSocket, message, helloSize)) return false;
+    }
+
+    // The host's token is the session's, on both sides
+    peerInfo.resumable = (localHello.flags & CONTROL_FLAG_SESSION) != 0 &&
+                         (remoteHello.flags & CONTROL_FLAG_SESSION) != 0;
+    if (peerInfo.resumable) {
+        std::memcpy(sessionToken, isHost ? localHello.sessionToken : remoteHello.sessionToken,
+                    CONTROL_SESSION_TOKEN_SIZE);
+    } else {
+        std::memset(sessionToken, 0, CONTROL_SESSION_TOKEN_SIZE);
+    }
+    SecureZero(localHello.sessionToken, sizeof(localHello.sessionToken));
+
+    peerInfo.encrypted = encrypt;
+    peerInfo.authenticated = encrypt && roomSecret;
+    if (mediaEncryption && !peerOffered) {
+        LOG_WARNING("Peer does not support media encryption; its audio is sent in the clear");
+    }
+    return true;
+}
 
-            PeerID peerId = GeneratePeerID();
-            char ip_str[INET_ADDRSTRLEN];
-            inet_ntop(AF_INET, &clientAddr.sin_addr, ip_str, INET_ADDRSTRLEN);
+void PeerNetwork::GatherCandidates(ControlHello& hello) {
+    std::vector<LocalInterfaceAddress> addresses;
+    if (!GetLocalInterfaceAddresses(addresses)) {
+        LOG_WARNING("Cannot list local interfaces; media goes over the control connection's path only");
+        return;
+    }
 
-            PeerInfo peerInfo{};
-            peerInfo.id = peerId;
-            peerInfo.ipAddress = std::string(ip_str);
-            peerInfo.audioPort = ntohs(clientAddr.sin_port);
-            peerInfo.connected = true;
-            peerInfo.lastHeartbeat = std::chrono::steady_clock::now();
+    // Preferred interfaces first, so they survive the cap
+    std::stable_sort(addresses.begin(), addresses.end(),
+                     [](const LocalInterfaceAddress& a, const LocalInterfaceAddress& b) { return a.kind > b.kind; });
+
+    hello.candidateCount = 0;
+    for (const auto& local : addresses) {
+        if (hello.candidateCount == CONTROL_MAX_CANDIDATES) break;
+        ControlCandidate& candidate = hello.candidates[hello.candidateCount++];
+        candidate.family = local.address.Family() == AF_INET6 ? CONTROL_CANDIDATE_IPV6 : CONTROL_CANDIDATE_IPV4;
+        candidate.preference = static_cast<uint8_t>(local.kind);
+        std::memset(candidate.address, 0, sizeof(candidate.address));
+        std::memcpy(candidate.address, local.address.AddressBytes(), local.address.AddressSize());
+    }
+    hello.flags |= CONTROL_FLAG_CANDIDATES;
+}
 
-            peers.push_back(peerInfo);
-            socketToPeerMap[clientSocket] = peerId;
+void PeerNetwork::SetPeerCandidates(PeerInfo& peerInfo, const SocketAddress& controlAddress,
+                                    const ControlHello& remoteHello) {
+    peerInfo.candidateCount = 1;
+    peerInfo.candidates[0].address = controlAddress;
+    peerInfo.candidates[0].address.SetPort(remoteHello.audioPort);
+    peerInfo.candidates[0].preference = static_cast<uint8_t>(InterfaceKind::Other);
+
+    peerInfo.pathChecks = (remoteHello.flags & CONTROL_FLAG_CANDIDATES) != 0;
+    if (!peerInfo.pathChecks) return;
+
+    for (size_t i = 0; i < remoteHello.candidateCount && peerInfo.candidateCount < MAX_PATH_CANDIDATES; i++) {
+        const ControlCandidate& announced = remoteHello.candidates[i];
+        SocketAddress address;
+        if (announced.family == CONTROL_CANDIDATE_IPV6) {
+            sockaddr_in6 v6{};
+            v6.sin6_family = AF_INET6;
+            std::memcpy(&v6.sin6_addr, announced.address, 16);
+            address = SocketAddress::FromSockaddr((const sockaddr*)&v6, sizeof(v6));
+        } else {
+            sockaddr_in v4{};
+            v4.sin_family = AF_INET;
+            std::memcpy(&v4.sin_addr, announced.address, 4);
+            address = SocketAddress::FromSockaddr((const sockaddr*)&v4, sizeof(v4));
+        }
+        address.SetPort(remoteHello.audioPort);
 
-            LOG_INFO("Accepted connection from peer " + std::to_string(peerId) +
-                    " at " + peerInfo.ipAddress);
+        // The control connection's address is usually one of them; it just learns its interface
+        if (address == peerInfo.candidates[0].address) {
+            peerInfo.candidates[0].preference = announced.preference;
+            continue;
         }
+        peerInfo.candidates[peerInfo.candidateCount++] = {address, announced.preference};
+    }
+}
+
+void PeerNetwork::AcceptThreadProc() {
+    // Control path only: named and tracked, at normal priority
+    ThreadRuntimeScope runtime(MetricThread::Accept, ThreadPriority::Normal);
+
+    while (listening) {
+        sockaddr_storage clientAddr{};
+        SocketLength addrLen = sizeof(clientAddr);
+
+        SocketHandle clientSocket = accept(listeningSocket, (sockaddr*)&clientAddr, &addrLen);
+        if (clientSocket == INVALID_SOCKET_HANDLE) {
+            // Wakes as soon as a connection is pending
+            WaitSocketReadable(listeningSocket, 100);
+            continue;
+        }
+
+        ControlHello remoteHello{};
+        PeerInfo peerInfo{};
+        uint8_t sessionToken[CONTROL_SESSION_TOKEN_SIZE] = {};
+        if (!ExchangeHello(clientSocket, true, remoteHello, peerInfo, sessionToken)) {
+            LOG_WARNING("Control handshake failed, rejecting connection");
+            CloseSocket(clientSocket);
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(peersMutex);
+            SocketAddress controlAddress = SocketAddress::FromSockaddr((const sockaddr*)&clientAddr, addrLen);
+
+            // The token we answered with is the peer's old one: it is coming back
+            bool resuming = peerInfo.resumable && TokensEqual(remoteHello.sessionToken, sessionToken);
+            PeerInfo* resumed = resuming ? FindPeer(FindSessionByToken(sessionToken)) : nullptr;
+            if (resumed) {
+                ResumePeer(*resumed, clientSocket, controlAddress, remoteHello);
+            } else if (resuming) {
+                // Expired between the handshake and now; a fresh join sorts it out
+                LOG_WARNING("Session expired while resuming, rejecting connection");
+                CloseSocket(clientSocket);
+            } else if (peers.size() >= (size_t)(expectedParticipants - 1)) {
+                // Resumes do not count: their peer is still on the list
+                LOG_WARNING("Maximum participants reached, rejecting connection");
+                CloseSocket(clientSocket);
+            } else {
+                AddPeer(peerInfo, clientSocket, controlAddress, remoteHello, sessionToken, 0);
+                LOG_INFO("Accepted connection from peer " + std::to_string(peerInfo.id) +
+                        " at " + peerInfo.ipAddress + MediaSecurityNote(peerInfo) + ", " +
+                        std::to_string(peerInfo.candidateCount) + " candidate path(s)" +
+                        (peerInfo.resumable ? ", resumable" : ""));
+            }
+        }
+        SecureZero(&peerInfo.mediaKeys, sizeof(peerInfo.mediaKeys));   // the list has its own copy
+        SecureZero(sessionToken, sizeof(sessionToken));
     }
 }
 
@@ -253,14 +558,275 @@ PeerID PeerNetwork::GeneratePeerID() {
     return nextId++;
 }
 
+void PeerNetwork::AddPeer(PeerInfo& peerInfo, SocketHandle peerSocket, const SocketAddress& controlAddress,
+                          const ControlHello& remoteHello, const uint8_t* sessionToken, uint16_t redialPort) {
+    auto now = std::chrono::steady_clock::now();
+
+    peerInfo.id = GeneratePeerID();
+    peerInfo.ipAddress = controlAddress.ToString();
+    peerInfo.audioPort = remoteHello.audioPort;
+    SetPeerCandidates(peerInfo, controlAddress, remoteHello);
+    peerInfo.connected = true;
+    peerInfo.lastHeartbeat = now;
+    peerInfo.resuming = false;
+    peerInfo.sessionEpoch = 0;
+    peerInfo.resumedMicros = 0;
+    peerInfo.joinedMicros = LatencyClockMicros();
+    peers.push_back(peerInfo);
+    // Before publishing: the media threads only ever look the slot up
+    PeerMetrics* metrics = MetricsRegistry::GetInstance().AcquirePeer(peerInfo.id);
+    if (metrics) metrics->mediaSecurity.Set(peerInfo.authenticated ? 2 : peerInfo.encrypted ? 1 : 0);
+    PublishPeers();
+
+    ControlSession& session = sessions[peerInfo.id];
+    session.socket = peerSocket;
+    session.redial = redialPort != 0;
+    session.controlPort = redialPort;
+    std::memcpy(session.token, sessionToken, CONTROL_SESSION_TOKEN_SIZE);
+    session.lastHeartbeatSent = now;
+
+    // From here on the control thread polls it
+    if (peerInfo.resumable) SetSocketBlocking(peerSocket, false);
+}
+
+void PeerNetwork::ResumePeer(PeerInfo& peer, SocketHandle peerSocket, const SocketAddress& controlAddress,
+                             const ControlHello& remoteHello) {
+    auto now = std::chrono::steady_clock::now();
+
+    // The old connection may not have been noticed broken yet
+    ControlSession& session = sessions[peer.id];
+    bool wasLost = session.socket == INVALID_SOCKET_HANDLE;
+    if (!wasLost) CloseSocket(session.socket);
+    session.socket = peerSocket;
+    session.receivedLength = 0;
+    session.lastHeartbeatSent = now;
+    SetSocketBlocking(peerSocket, false);
+
+    // Same ID, keys and streams; only where the peer can be reached changes
+    peer.ipAddress = controlAddress.ToString();
+    peer.audioPort = remoteHello.audioPort;
+    SetPeerCandidates(peer, controlAddress, remoteHello);
+    peer.lastHeartbeat = now;
+    peer.resuming = false;
+    peer.resumedMicros = LatencyClockMicros();
+    peer.sessionEpoch++;
+    PublishPeers();
+
+    if (PeerMetrics* metrics = MetricsRegistry::GetInstance().FindPeer(peer.id)) {
+        metrics->sessionResumes.Add();
+    }
+    long long downMs = wasLost
+        ? (long long)std::chrono::duration_cast<std::chrono::milliseconds>(now - session.lostAt).count() : 0;
+    LOG_INFO_FMT("Peer {} resumed its session from {} after {} ms, {} candidate path(s)", peer.id,
+                 peer.ipAddress, downMs, (int)peer.candidateCount);
+}
+
+PeerInfo* PeerNetwork::FindPeer(PeerID id) {
+    for (auto& peer : peers) {
+        if (peer.id == id) return &peer;
+    }
+    return nullptr;
+}
+
+PeerID PeerNetwork::FindSessionByToken(const uint8_t* token) const {
+    // Sessions that cannot be resumed have a zero token, which never matches
+    if (IsZeroToken(token)) return 0;
+    for (const auto& entry : sessions) {
+        if (TokensEqual(entry.second.token, token)) return entry.first;
+    }
+    return 0;
+}
+
 void PeerNetwork::RemovePeer(PeerID id) {
     std::lock_guard<std::mutex> lock(peersMutex);
     auto it = std::find_if(peers.begin(), peers.end(),
                           [id](const PeerInfo& p) { return p.id == id; });
     if (it != peers.end()) {
         LOG_INFO("Removing peer " + std::to_string(id));
+        SecureZero(&it->mediaKeys, sizeof(it->mediaKeys));
         peers.erase(it);
+        PublishPeers();
+        MetricsRegistry::GetInstance().ReleasePeer(id);
     }
+
+    auto session = sessions.find(id);
+    if (session != sessions.end()) {
+        if (session->second.socket != INVALID_SOCKET_HANDLE) CloseSocket(session->second.socket);
+        SecureZero(session->second.token, sizeof(session->second.token));
+        sessions.erase(session);
+    }
+}
+
+void PeerNetwork::ControlThreadProc() {
+    // Control path only: named and tracked, at normal priority
+    ThreadRuntimeScope runtime(MetricThread::Control, ThreadPriority::Normal);
+
+    while (controlRunning) {
+        ServiceControlConnections();
+        CheckPeerHeartbeats();
+        RedialLostSession();
+        SleepMillis(CONTROL_POLL_MS);
+    }
+}
+
+void PeerNetwork::ServiceControlConnections() {
+    auto now = std::chrono::steady_clock::now();
+    uint8_t heartbeat[CONTROL_MESSAGE_SIZE];
+    WriteControlMessage(heartbeat, ControlMessageType::Heartbeat);
+
+    std::vector<PeerID> departed;
+    std::unique_lock<std::mutex> lock(peersMutex);
+    for (auto& entry : sessions) {
+        ControlSession& session = entry.second;
+        PeerInfo* peer = FindPeer(entry.first);
+        if (!peer || !peer->resumable || session.socket == INVALID_SOCKET_HANDLE) continue;
+
+        bool alive = ReadControlMessages(session, *peer);
+        if (session.left) {
+            departed.push_back(entry.first);
+            continue;
+        }
+        if (alive && now - session.lastHeartbeatSent >= std::chrono::milliseconds(CONTROL_HEARTBEAT_INTERVAL_MS)) {
+            session.lastHeartbeatSent = now;
+            // A full send buffer is left to the heartbeat timeout; a partial
+            // send would break the framing
+            int sent = (int)send(session.socket, (const char*)heartbeat, (int)sizeof(heartbeat), SOCKET_SEND_FLAGS);
+            if (sent < 0) {
+                alive = IsWouldBlockError(GetLastSocketError());
+            } else if (sent != (int)sizeof(heartbeat)) {
+                alive = false;
+            }
+        }
+        if (!alive) LoseControlConnection(*peer, session);
+    }
+    lock.unlock();
+
+    // Only the leaver goes; everyone else's audio carries on
+    for (PeerID id : departed) {
+        LOG_INFO("Peer " + std::to_string(id) + " left the call");
+        RemovePeer(id);
+    }
+}
+
+bool PeerNetwork::ReadControlMessages(ControlSession& session, PeerInfo& peer) {
+    while (true) {
+        // Room for a whole message always remains: complete ones are consumed below
+        size_t space = session.received.size() - session.receivedLength;
+        int result = (int)recv(session.socket, (char*)session.received.data() + session.receivedLength,
+                               (int)space, 0);
+        if (result == 0) return false;   // closed by the peer
+        if (result < 0) return IsWouldBlockError(GetLastSocketError());
+        session.receivedLength += (size_t)result;
+
+        // Any message shows the peer is there; heartbeats are nothing more.
+        // A bad prefix means the stream is out of step, so start over.
+        size_t offset = 0;
+        while (session.receivedLength - offset >= CONTROL_PREFIX_SIZE) {
+            size_t length = ReadControlMessageLength(session.received.data() + offset);
+            if (length < CONTROL_MESSAGE_SIZE) return false;
+            if (session.receivedLength - offset < length) break;
+            peer.lastHeartbeat = std::chrono::steady_clock::now();
+            if (session.received[offset + CONTROL_PREFIX_SIZE] == (uint8_t)ControlMessageType::Leave) {
+                session.left = true;
+                return false;
+            }
+            offset += length;
+        }
+        std::memmove(session.received.data(), session.received.data() + offset, session.receivedLength - offset);
+        session.receivedLength -= offset;
+    }
+}
+
+void PeerNetwork::LoseControlConnection(PeerInfo& peer, ControlSession& session) {
+    auto now = std::chrono::steady_clock::now();
+
+    CloseSocket(session.socket);
+    session.socket = INVALID_SOCKET_HANDLE;
+    session.receivedLength = 0;
+    session.lostAt = now;
+    session.nextRedial = now;
+    session.redialDelayMs = RESUME_BACKOFF_MIN;
+    peer.resuming = true;
+    PublishPeers();
+
+    LOG_WARNING("Lost the control connection to peer " + std::to_string(peer.id) +
+                (session.redial ? "; reconnecting" : "; waiting for it to reconnect"));
+}
+
+void PeerNetwork::RedialLostSession() {
+    // One due session per pass; the dialing itself happens unlocked
+    PeerID id = 0;
+    uint8_t token[CONTROL_SESSION_TOKEN_SIZE];
+    std::vector<SocketAddress> targets;
+    {
+        std::lock_guard<std::mutex> lock(peersMutex);
+        auto now = std::chrono::steady_clock::now();
+        for (auto& entry : sessions) {
+            ControlSession& session = entry.second;
+            if (!session.redial || session.socket != INVALID_SOCKET_HANDLE || now < session.nextRedial) continue;
+            const PeerInfo* peer = FindPeer(entry.first);
+            if (!peer || !peer->resuming) continue;
+
+            // Every address the peer announced, the one we dialed first
+            for (size_t i = 0; i < peer->candidateCount; i++) {
+                SocketAddress target = peer->candidates[i].address;
+                target.SetPort(session.controlPort);
+                targets.push_back(target);
+            }
+            std::memcpy(token, session.token, sizeof(token));
+            session.nextRedial = now + std::chrono::milliseconds(session.redialDelayMs);
+            session.redialDelayMs = std::min(session.redialDelayMs * 2, RESUME_BACKOFF_MAX);
+            id = entry.first;
+            break;
+        }
+    }
+
+    for (const auto& target : targets) {
+        if (Redial(id, target, token)) break;
+    }
+    SecureZero(token, sizeof(token));
+}
+
+bool PeerNetwork::Redial(PeerID id, const SocketAddress& address, const uint8_t* token) {
+    SocketHandle peerSocket = socket(address.Family(), SOCK_STREAM, IPPROTO_TCP);
+    if (peerSocket == INVALID_SOCKET_HANDLE) return false;
+    if (!ConnectSocket(peerSocket, address, RESUME_CONNECT_TIMEOUT)) {
+        CloseSocket(peerSocket);
+        return false;
+    }
+
+    ControlHello remoteHello{};
+    PeerInfo peerInfo{};
+    uint8_t sessionToken[CONTROL_SESSION_TOKEN_SIZE];
+    std::memcpy(sessionToken, token, sizeof(sessionToken));
+    if (!ExchangeHello(peerSocket, false, remoteHello, peerInfo, sessionToken)) {
+        CloseSocket(peerSocket);
+        return false;
+    }
+
+    // Resumed: the old keys stay, the ones just derived go
+    bool resumed = peerInfo.resumable && TokensEqual(sessionToken, token);
+    if (resumed) {
+        std::lock_guard<std::mutex> lock(peersMutex);
+        PeerInfo* peer = FindPeer(id);
+        if (peer) {
+            ResumePeer(*peer, peerSocket, address, remoteHello);
+        } else {
+            CloseSocket(peerSocket);   // given up on meanwhile
+        }
+    } else {
+        // The peer no longer knows the session (it gave up on us, or
+        // restarted): join it afresh
+        LOG_WARNING("Peer " + std::to_string(id) + " did not know our session; joining it again");
+        RemovePeer(id);
+        sessionPacketTime = remoteHello.packetTime;
+        std::lock_guard<std::mutex> lock(peersMutex);
+        AddPeer(peerInfo, peerSocket, address, remoteHello, sessionToken, address.Port());
+        LOG_INFO("Rejoined as peer " + std::to_string(peerInfo.id));
+    }
+    SecureZero(&peerInfo.mediaKeys, sizeof(peerInfo.mediaKeys));
+    SecureZero(sessionToken, sizeof(sessionToken));
+    return true;
 }
 
 void PeerNetwork::CheckPeerHeartbeats() {
@@ -269,16 +835,23 @@ void PeerNetwork::CheckPeerHeartbeats() {
 
     {
         std::lock_guard<std::mutex> lock(peersMutex);
-        for (auto& peer : peers) {
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
-                now - peer.lastHeartbeat).count();
-            if (elapsed > PEER_TIMEOUT) {
-                deadPeers.push_back(peer.id);
+        for (auto& entry : sessions) {
+            ControlSession& session = entry.second;
+            PeerInfo* peer = FindPeer(entry.first);
+            if (!peer || !peer->resumable) continue;
+
+            if (session.socket != INVALID_SOCKET_HANDLE) {
+                auto silent = std::chrono::duration_cast<std::chrono::milliseconds>(now - peer->lastHeartbeat);
+                if (silent.count() > CONTROL_HEARTBEAT_TIMEOUT_MS) LoseControlConnection(*peer, session);
+            } else if (std::chrono::duration_cast<std::chrono::milliseconds>(now - session.lostAt).count() >
+                       PEER_TIMEOUT) {
+                deadPeers.push_back(peer->id);
             }
         }
     }
 
     for (PeerID id : deadPeers) {
+        LOG_WARNING("Peer " + std::to_string(id) + " did not resume its session in time");
         RemovePeer(id);
     }
 }
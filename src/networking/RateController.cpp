@@ -0,0 +1,297 @@
+#include <networking/RateController.h>
+#include <networking/RedundantPayload.h>
+#include <networking/RtpPacket.h>
+#include <cstdio>
+
+// Highest quality first. Packet aggregation is clamped to MAX_PACKET_TIME.
+struct RateLadderStep {
+    PayloadEncoding encoding;
+    uint8_t packetsPerRtp;
+};
+
+static const RateLadderStep RATE_LADDER[] = {
+    {PayloadEncoding::Pcm16, 1},
+    {PayloadEncoding::Mulaw, 1},
+    {PayloadEncoding::Mulaw, 2},
+    {PayloadEncoding::MulawHalfRate, 2},
+    {PayloadEncoding::MulawHalfRate, 4},
+};
+
+constexpr size_t RATE_LEVEL_COUNT = sizeof(RATE_LADDER) / sizeof(RATE_LADDER[0]);
+
+// A backed-off queue needs time to drain before the RTT says so
+constexpr int64_t RATE_DECREASE_INTERVAL_MICROS = 1000000;
+constexpr double RATE_RTT_SMOOTHING = 0.5;
+
+const char* RateDecisionToString(RateDecision decision) {
+    switch (decision) {
+        case RateDecision::Hold: return "hold";
+        case RateDecision::Decrease: return "decrease";
+        case RateDecision::Increase: return "increase";
+        case RateDecision::AddRedundancy: return "add redundancy";
+        case RateDecision::DropRedundancy: return "drop redundancy";
+        default: return "unknown";
+    }
+}
+
+RateController::RateController(PacketTime capturePacketTime)
+    : capturePacketTime(capturePacketTime) {
+    Reset();
+}
+
+void RateController::Reset() {
+    config = StreamConfig{PayloadEncoding::Pcm16, 1, 0};
+    level = 0;
+    hasFeedback = false;
+    lastFeedbackMicros = 0;
+    lastChangeMicros = 0;
+    lastLossMicros = 0;
+    decreased = false;
+    lastDecreaseMicros = 0;
+    lastQueueDelayMs = 0.0;
+    ceilingBitrate = 0.0;
+    probeHoldMicros = RATE_PROBE_HOLD_MICROS;
+    probing = false;
+    probeStartMicros = 0;
+    rttCount = 0;
+    rttNext = 0;
+    smoothedRttMs = -1.0;
+    ApplyLevel(0);
+}
+
+size_t RateController::GetLevelCount() {
+    return RATE_LEVEL_COUNT;
+}
+
+uint32_t RateController::EstimateBitrate(const StreamConfig& config, PacketTime capturePacketTime) {
+    size_t samples = (size_t)SamplesPerPacket(capturePacketTime) * config.packetsPerRtp;
+    size_t block = EncodedPayloadSize(config.encoding, samples);
+    size_t payload = block * (1 + config.redundancy) + (config.redundancy ? RedundantHeaderSize(config.redundancy) : 0);
+    size_t packet = payload + RTP_HEADER_SIZE + IPV4_UDP_OVERHEAD;
+    double packetsPerSecond = 1000000.0 / ((double)PacketTimeMicros(capturePacketTime) * config.packetsPerRtp);
+    return (uint32_t)(packet * 8 * packetsPerSecond);
+}
+
+bool RateController::RedundancyFits(const StreamConfig& config, PacketTime capturePacketTime, uint8_t redundancy) {
+    if (redundancy == 0) return true;
+    if (redundancy > RED_MAX_REDUNDANCY) return false;
+
+    uint32_t frames = FramesPerPacket(capturePacketTime) * config.packetsPerRtp;
+    size_t block = EncodedPayloadSize(config.encoding, (size_t)frames * AUDIO_CHANNELS);
+    return block <= RED_MAX_BLOCK_SIZE &&
+           frames * redundancy <= RED_MAX_TIMESTAMP_OFFSET &&
+           block * (1 + redundancy) + RedundantHeaderSize(redundancy) <= MAX_RTP_PAYLOAD_SIZE;
+}
+
+StreamConfig RateController::LevelConfig(size_t forLevel) const {
+    uint32_t maxAggregation = (uint32_t)MAX_PACKET_TIME / (uint32_t)capturePacketTime;
+    if (maxAggregation == 0) maxAggregation = 1;
+
+    StreamConfig levelConfig{};
+    levelConfig.encoding = RATE_LADDER[forLevel].encoding;
+    levelConfig.packetsPerRtp = (uint8_t)(RATE_LADDER[forLevel].packetsPerRtp < maxAggregation
+                                              ? RATE_LADDER[forLevel].packetsPerRtp : maxAggregation);
+    return levelConfig;
+}
+
+// The most a configuration with more redundancy may send: the known
+// ceiling's share, else about what the path carries now (what the receiver
+// got, or our own rate before it says). Repeats cost quality, not load.
+double RateController::RedundancyBudget(const RateFeedback& feedback) const {
+    if (ceilingBitrate > 0.0) return ceilingBitrate * RATE_BACKOFF_HEADROOM;
+    double carried = feedback.receivedBitrate > 0.0 ? feedback.receivedBitrate : (double)GetBitrate();
+    return carried * RATE_REDUNDANCY_GROWTH;
+}
+
+void RateController::ApplyLevel(size_t newLevel) {
+    StreamConfig levelConfig = LevelConfig(newLevel);
+    level = newLevel;
+    config.encoding = levelConfig.encoding;
+    config.packetsPerRtp = levelConfig.packetsPerRtp;
+
+    while (config.redundancy > 0 && !RedundancyFits(config, capturePacketTime, config.redundancy)) {
+        config.redundancy--;
+    }
+}
+
+double RateController::UpdateQueueDelay(double rttMs) {
+    rttHistory[rttNext] = rttMs;
+    rttNext = (rttNext + 1) % RATE_RTT_FLOOR_WINDOW;
+    if (rttCount < RATE_RTT_FLOOR_WINDOW) rttCount++;
+
+    double floor = rttMs;
+    for (size_t i = 0; i < rttCount; i++) {
+        if (rttHistory[i] < floor) floor = rttHistory[i];
+    }
+
+    smoothedRttMs = smoothedRttMs < 0.0 ? rttMs : smoothedRttMs + (rttMs - smoothedRttMs) * RATE_RTT_SMOOTHING;
+    double queueDelay = smoothedRttMs - floor;
+    return queueDelay > 0.0 ? queueDelay : 0.0;
+}
+
+void RateController::Fill(RateDecisionRecord& record, RateDecision decision, const char* reason,
+                          const RateFeedback& feedback, double queueDelayMs) const {
+    record.decision = decision;
+    record.reason = reason;
+    record.level = level;
+    record.config = config;
+    record.bitrate = GetBitrate();
+    record.feedback = feedback;
+    record.queueDelayMs = queueDelayMs;
+}
+
+bool RateController::OnFeedback(int64_t nowMicros, const RateFeedback& feedback, RateDecisionRecord& record) {
+    hasFeedback = true;
+    lastFeedbackMicros = nowMicros;
+    if (feedback.fractionLost > 0.0) {
+        lastLossMicros = nowMicros;
+    }
+
+    double queueDelay = feedback.rttMs >= 0.0 ? UpdateQueueDelay(feedback.rttMs) : 0.0;
+    bool severe = queueDelay >= RATE_SEVERE_QUEUE_DELAY_MS || feedback.fractionLost >= 2 * RATE_CONGESTION_LOSS;
+    bool delayed = queueDelay >= RATE_QUEUE_DELAY_MS;
+    bool heavyLoss = feedback.fractionLost >= RATE_CONGESTION_LOSS;
+    bool congested = severe || delayed || heavyLoss;
+
+    // After a back-off the queue takes a while to empty; a shrinking delay
+    // is the decrease working, not more congestion
+    bool draining = decreased && !heavyLoss && queueDelay < lastQueueDelayMs;
+    lastQueueDelayMs = queueDelay;
+
+    if (congested && !draining) {
+        // A probe that ran into congestion waits twice as long next time
+        if (probing) {
+            probing = false;
+            probeHoldMicros = probeHoldMicros * 2 < RATE_MAX_PROBE_HOLD_MICROS
+                                  ? probeHoldMicros * 2 : RATE_MAX_PROBE_HOLD_MICROS;
+        }
+
+        bool canDecrease = level + 1 < RATE_LEVEL_COUNT || config.redundancy > 0;
+        if (!canDecrease || (decreased && nowMicros - lastDecreaseMicros < RATE_DECREASE_INTERVAL_MICROS)) {
+            return false;
+        }
+
+        // Back off to what actually got through when the receiver says;
+        // otherwise one step, two when severe
+        size_t target = level + (severe ? 2 : 1);
+        if (feedback.receivedBitrate > 0.0) {
+            target = level + 1;
+            while (target + 1 < RATE_LEVEL_COUNT &&
+                   EstimateBitrate(LevelConfig(target), capturePacketTime) >
+                       feedback.receivedBitrate * RATE_BACKOFF_HEADROOM) {
+                target++;
+            }
+        }
+
+        // What got through is the capacity until a probe finds more
+        ceilingBitrate = feedback.receivedBitrate > 0.0 ? feedback.receivedBitrate
+                                                        : GetBitrate() * RATE_BACKOFF_HEADROOM;
+
+        // Redundancy only adds load to a congested link
+        config.redundancy = 0;
+        ApplyLevel(target < RATE_LEVEL_COUNT ? target : RATE_LEVEL_COUNT - 1);
+        lastChangeMicros = nowMicros;
+        lastDecreaseMicros = nowMicros;
+        decreased = true;
+        Fill(record, RateDecision::Decrease,
+             severe ? "severe congestion" : (delayed ? "queueing delay" : "heavy loss"),
+             feedback, queueDelay);
+        return true;
+    }
+
+    if (congested) {
+        return false;
+    }
+
+    // Loss without queueing is random loss; repeating packets fixes it, as
+    // long as the repeats fit the budget. Quality steps down to make room for
+    // the first repeat (which covers most single losses), not for further ones.
+    if (feedback.fractionLost >= RATE_REDUNDANCY_LOSS && config.redundancy < RED_MAX_REDUNDANCY) {
+        uint8_t redundancy = (uint8_t)(config.redundancy + 1);
+        size_t lowestLevel = redundancy == 1 ? RATE_LEVEL_COUNT : level + 1;
+        double budget = RedundancyBudget(feedback);
+        for (size_t candidate = level; candidate < lowestLevel; candidate++) {
+            StreamConfig protectedConfig = LevelConfig(candidate);
+            protectedConfig.redundancy = redundancy;
+            if (!RedundancyFits(protectedConfig, capturePacketTime, redundancy)) continue;
+            if (EstimateBitrate(protectedConfig, capturePacketTime) > budget) continue;
+
+            bool traded = candidate != level;
+            config.redundancy = redundancy;
+            ApplyLevel(candidate);
+            lastChangeMicros = nowMicros;
+            Fill(record, RateDecision::AddRedundancy, traded ? "random loss, traded for quality" : "random loss",
+                 feedback, queueDelay);
+            return true;
+        }
+    }
+
+    if (config.redundancy > 0 && nowMicros - lastLossMicros >= RATE_PROBE_HOLD_MICROS &&
+        nowMicros - lastChangeMicros >= RATE_PROBE_HOLD_MICROS) {
+        config.redundancy--;
+        lastChangeMicros = nowMicros;
+        Fill(record, RateDecision::DropRedundancy, "loss cleared", feedback, queueDelay);
+        return true;
+    }
+
+    // A probe that held for the base period resets the pace
+    if (probing && nowMicros - probeStartMicros >= RATE_PROBE_HOLD_MICROS) {
+        probing = false;
+        probeHoldMicros = RATE_PROBE_HOLD_MICROS;
+        if (GetBitrate() > ceilingBitrate) {
+            ceilingBitrate = 0.0;
+        }
+    }
+
+    if (level == 0 || nowMicros - lastChangeMicros < probeHoldMicros) {
+        return false;
+    }
+
+    // Probe quality first; redundancy beyond one packet waits for headroom
+    double budget = RedundancyBudget(feedback);
+    ApplyLevel(level - 1);
+    while (config.redundancy > 1 && GetBitrate() > budget) {
+        config.redundancy--;
+    }
+    probing = true;
+    probeStartMicros = nowMicros;
+    lastChangeMicros = nowMicros;
+    Fill(record, RateDecision::Increase, "probe", feedback, queueDelay);
+    return true;
+}
+
+bool RateController::OnTick(int64_t nowMicros, RateDecisionRecord& record) {
+    if (!hasFeedback || nowMicros - lastFeedbackMicros < RATE_FEEDBACK_TIMEOUT_MICROS ||
+        nowMicros - lastChangeMicros < RATE_FEEDBACK_TIMEOUT_MICROS || level + 1 >= RATE_LEVEL_COUNT) {
+        return false;
+    }
+
+    // Reports stopped while we are sending: the path is likely saturated
+    if (probing) {
+        probing = false;
+        probeHoldMicros = probeHoldMicros * 2 < RATE_MAX_PROBE_HOLD_MICROS
+                              ? probeHoldMicros * 2 : RATE_MAX_PROBE_HOLD_MICROS;
+    }
+    ceilingBitrate = GetBitrate() * RATE_BACKOFF_HEADROOM;
+    config.redundancy = 0;
+    ApplyLevel(level + 1);
+    lastChangeMicros = nowMicros;
+    lastDecreaseMicros = nowMicros;
+    decreased = true;
+    Fill(record, RateDecision::Decrease, "feedback timeout", RateFeedback{0.0, -1.0, 0.0, 0.0}, 0.0);
+    return true;
+}
+
+std::string FormatRateDecision(uint32_t peerId, const RateDecisionRecord& record, PacketTime capturePacketTime) {
+    char line[256];
+    std::snprintf(line, sizeof(line),
+                  "Rate control peer %u: %s (%s) -> level %zu %s %.1fms red %u, ~%u kbps; "
+                  "loss %.1f%% rtt %.0fms queue %.0fms jitter %.1fms",
+                  peerId, RateDecisionToString(record.decision), record.reason, record.level,
+                  PayloadEncodingToString(record.config.encoding),
+                  PacketTimeMicros(capturePacketTime) * record.config.packetsPerRtp / 1000.0,
+                  (unsigned)record.config.redundancy, record.bitrate / 1000,
+                  record.feedback.fractionLost * 100.0, record.feedback.rttMs,
+                  record.queueDelayMs, record.feedback.jitterMs);
+    return line;
+}
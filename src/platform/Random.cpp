@@ -0,0 +1,40 @@
+#include <platform/Random.h>
+
+#ifdef _WIN32
+#include <platform/Win32.h>
+#include <bcrypt.h>
+#pragma comment(lib, "bcrypt.lib")
+#else
+#include <cerrno>
+#include <sys/random.h>
+#endif
+#include <cstdint>
+
+#ifdef _WIN32
+
+bool FillRandomBytes(void* out, size_t length) {
+    return BCryptGenRandom(nullptr, (PUCHAR)out, (ULONG)length, BCRYPT_USE_SYSTEM_PREFERRED_RNG) >= 0;
+}
+
+#else
+
+bool FillRandomBytes(void* out, size_t length) {
+    uint8_t* bytes = (uint8_t*)out;
+    while (length > 0) {
+        ssize_t result = getrandom(bytes, length, 0);
+        if (result < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        bytes += result;
+        length -= (size_t)result;
+    }
+    return true;
+}
+
+#endif
+
+void SecureZero(void* data, size_t length) {
+    volatile uint8_t* bytes = (volatile uint8_t*)data;
+    while (length-- > 0) *bytes++ = 0;
+}
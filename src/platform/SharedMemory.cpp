@@ -0,0 +1,155 @@
+#include <platform/SharedMemory.h>
+#include <cstdint>
+
+#ifdef _WIN32
+#include <platform/Win32.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+SharedMemory::SharedMemory()
+    : data(nullptr), size(0), owner(false), mapping(nullptr) {
+}
+
+static std::wstring MappingName(const std::string& name) {
+    std::string full = "Local\\voiceqwik-" + name;
+    return std::wstring(full.begin(), full.end());
+}
+
+bool SharedMemory::Create(const std::string& name, size_t regionSize) {
+    Close();
+
+    // Backed by the pagefile and zero-filled by the OS
+    HANDLE handle = CreateFileMappingW(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                       (DWORD)((uint64_t)regionSize >> 32), (DWORD)regionSize,
+                                       MappingName(name).c_str());
+    if (!handle) return false;
+    if (GetLastError() == ERROR_ALREADY_EXISTS) {
+        // Someone else's, or a reader holding a dead writer's; either way not ours to reuse
+        CloseHandle(handle);
+        return false;
+    }
+
+    void* view = MapViewOfFile(handle, FILE_MAP_ALL_ACCESS, 0, 0, regionSize);
+    if (!view) {
+        CloseHandle(handle);
+        return false;
+    }
+
+    mapping = handle;
+    data = view;
+    size = regionSize;
+    owner = true;
+    objectName = name;
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name) {
+    Close();
+
+    HANDLE handle = OpenFileMappingW(FILE_MAP_READ, FALSE, MappingName(name).c_str());
+    if (!handle) return false;
+    void* view = MapViewOfFile(handle, FILE_MAP_READ, 0, 0, 0);
+    MEMORY_BASIC_INFORMATION info{};
+    if (!view || VirtualQuery(view, &info, sizeof(info)) == 0) {
+        if (view) UnmapViewOfFile(view);
+        CloseHandle(handle);
+        return false;
+    }
+
+    mapping = handle;
+    data = view;
+    size = info.RegionSize;   // rounded up to whole pages
+    owner = false;
+    objectName = name;
+    return true;
+}
+
+void SharedMemory::Close() {
+    if (data) UnmapViewOfFile(data);
+    if (mapping) CloseHandle((HANDLE)mapping);
+    data = nullptr;
+    mapping = nullptr;
+    size = 0;
+    owner = false;
+    objectName.clear();
+}
+
+#else
+
+SharedMemory::SharedMemory()
+    : data(nullptr), size(0), owner(false) {
+}
+
+static std::string ObjectName(const std::string& name) {
+    return "/voiceqwik-" + name;
+}
+
+bool SharedMemory::Create(const std::string& name, size_t regionSize) {
+    Close();
+
+    // A fresh object, so a reader still mapping a stale one is not written under
+    std::string path = ObjectName(name);
+    shm_unlink(path.c_str());
+    int fd = shm_open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    if (fd < 0) return false;
+    // ftruncate zero-fills
+    if (ftruncate(fd, (off_t)regionSize) != 0) {
+        close(fd);
+        shm_unlink(path.c_str());
+        return false;
+    }
+    void* view = mmap(nullptr, regionSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (view == MAP_FAILED) {
+        shm_unlink(path.c_str());
+        return false;
+    }
+
+    data = view;
+    size = regionSize;
+    owner = true;
+    objectName = path;
+    return true;
+}
+
+bool SharedMemory::Open(const std::string& name) {
+    Close();
+
+    std::string path = ObjectName(name);
+    int fd = shm_open(path.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+    struct stat info {};
+    void* view = MAP_FAILED;
+    if (fstat(fd, &info) == 0 && info.st_size > 0) {
+        view = mmap(nullptr, (size_t)info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    close(fd);
+    if (view == MAP_FAILED) return false;
+
+    data = view;
+    size = (size_t)info.st_size;
+    owner = false;
+    objectName = path;
+    return true;
+}
+
+void SharedMemory::Close() {
+    if (data) munmap(data, size);
+    if (owner) shm_unlink(objectName.c_str());
+    data = nullptr;
+    size = 0;
+    owner = false;
+    objectName.clear();
+}
+
+#endif
+
+SharedMemory::~SharedMemory() {
+    Close();
+}
@@ -0,0 +1,368 @@
+#include <platform/Socket.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+#include <iphlpapi.h>
+#pragma comment(lib, "ws2_32.lib")
+#pragma comment(lib, "iphlpapi.lib")
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <ifaddrs.h>
+#include <net/if.h>
+#include <poll.h>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+bool SocketStartup() {
+    WSADATA wsaData;
+    return WSAStartup(MAKEWORD(2, 2), &wsaData) == 0;
+}
+
+void SocketCleanup() {
+    WSACleanup();
+}
+
+void CloseSocket(SocketHandle socket) {
+    closesocket(socket);
+}
+
+bool SetSocketBlocking(SocketHandle socket, bool blocking) {
+    u_long nonBlocking = blocking ? 0 : 1;
+    return ioctlsocket(socket, FIONBIO, &nonBlocking) == 0;
+}
+
+bool SetSocketTimeouts(SocketHandle socket, int timeoutMs) {
+    DWORD timeout = (DWORD)timeoutMs;
+    return setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeout, sizeof(timeout)) == 0 &&
+           setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout)) == 0;
+}
+
+int GetLastSocketError() {
+    return WSAGetLastError();
+}
+
+bool IsWouldBlockError(int error) {
+    return error == WSAEWOULDBLOCK;
+}
+
+bool WaitSocketReadable(SocketHandle socket, int timeoutMs) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(socket, &readable);
+    timeval timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    return select(0, &readable, nullptr, nullptr, &timeout) > 0;
+}
+
+bool ConnectSocket(SocketHandle socket, const SocketAddress& address, int timeoutMs) {
+    if (!SetSocketBlocking(socket, false)) return false;
+    if (connect(socket, address.Get(), address.length) != 0 && WSAGetLastError() != WSAEWOULDBLOCK) return false;
+
+    // Writable once connected; a refused or failed connect shows in the except set
+    fd_set writable;
+    fd_set failed;
+    FD_ZERO(&writable);
+    FD_ZERO(&failed);
+    FD_SET(socket, &writable);
+    FD_SET(socket, &failed);
+    timeval timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    if (select(0, nullptr, &writable, &failed, &timeout) <= 0 || FD_ISSET(socket, &failed)) return false;
+    return SetSocketBlocking(socket, true);
+}
+
+#else
+
+bool SocketStartup() {
+    return true;
+}
+
+void SocketCleanup() {
+}
+
+void CloseSocket(SocketHandle socket) {
+    close(socket);
+}
+
+bool SetSocketBlocking(SocketHandle socket, bool blocking) {
+    int flags = fcntl(socket, F_GETFL, 0);
+    if (flags < 0) return false;
+    flags = blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK);
+    return fcntl(socket, F_SETFL, flags) == 0;
+}
+
+bool SetSocketTimeouts(SocketHandle socket, int timeoutMs) {
+    timeval timeout{timeoutMs / 1000, (timeoutMs % 1000) * 1000};
+    return setsockopt(socket, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) == 0 &&
+           setsockopt(socket, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout)) == 0;
+}
+
+int GetLastSocketError() {
+    return errno;
+}
+
+bool IsWouldBlockError(int error) {
+    return error == EAGAIN || error == EWOULDBLOCK;
+}
+
+bool WaitSocketReadable(SocketHandle socket, int timeoutMs) {
+    pollfd entry{socket, POLLIN, 0};
+    return poll(&entry, 1, timeoutMs) > 0;
+}
+
+bool ConnectSocket(SocketHandle socket, const SocketAddress& address, int timeoutMs) {
+    if (!SetSocketBlocking(socket, false)) return false;
+    if (connect(socket, address.Get(), address.length) != 0 && errno != EINPROGRESS) return false;
+
+    // Writable once the attempt is over; SO_ERROR tells how it went
+    pollfd entry{socket, POLLOUT, 0};
+    if (poll(&entry, 1, timeoutMs) <= 0) return false;
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if (getsockopt(socket, SOL_SOCKET, SO_ERROR, &error, &length) != 0 || error != 0) {
+        if (error != 0) errno = error;
+        return false;
+    }
+    return SetSocketBlocking(socket, true);
+}
+
+#endif
+
+bool SetSocketOption(SocketHandle socket, int level, int name, int value) {
+    return setsockopt(socket, level, name, (const char*)&value, sizeof(value)) == 0;
+}
+
+uint16_t SocketAddress::Port() const {
+    if (Family() == AF_INET6) return ntohs(reinterpret_cast<const sockaddr_in6*>(&storage)->sin6_port);
+    if (Family() == AF_INET) return ntohs(reinterpret_cast<const sockaddr_in*>(&storage)->sin_port);
+    return 0;
+}
+
+void SocketAddress::SetPort(uint16_t port) {
+    if (Family() == AF_INET6) {
+        reinterpret_cast<sockaddr_in6*>(&storage)->sin6_port = htons(port);
+    } else if (Family() == AF_INET) {
+        reinterpret_cast<sockaddr_in*>(&storage)->sin_port = htons(port);
+    }
+}
+
+const uint8_t* SocketAddress::AddressBytes() const {
+    if (Family() == AF_INET6) {
+        return reinterpret_cast<const uint8_t*>(&reinterpret_cast<const sockaddr_in6*>(&storage)->sin6_addr);
+    }
+    return reinterpret_cast<const uint8_t*>(&reinterpret_cast<const sockaddr_in*>(&storage)->sin_addr);
+}
+
+size_t SocketAddress::AddressSize() const {
+    if (Family() == AF_INET6) return 16;
+    return Family() == AF_INET ? 4 : 0;
+}
+
+bool SocketAddress::FromString(const std::string& ip, uint16_t port, SocketAddress& address) {
+    address = SocketAddress{};
+    sockaddr_in6 v6{};
+    if (inet_pton(AF_INET6, ip.c_str(), &v6.sin6_addr) == 1) {
+        v6.sin6_family = AF_INET6;
+        address = FromSockaddr(reinterpret_cast<const sockaddr*>(&v6), sizeof(v6));
+    } else {
+        sockaddr_in v4{};
+        if (inet_pton(AF_INET, ip.c_str(), &v4.sin_addr) != 1) return false;
+        v4.sin_family = AF_INET;
+        address = FromSockaddr(reinterpret_cast<const sockaddr*>(&v4), sizeof(v4));
+    }
+    address.SetPort(port);
+    return true;
+}
+
+SocketAddress SocketAddress::FromSockaddr(const sockaddr* source, SocketLength sourceLength) {
+    SocketAddress address;
+    if (source->sa_family == AF_INET && sourceLength >= (SocketLength)sizeof(sockaddr_in)) {
+        std::memcpy(&address.storage, source, sizeof(sockaddr_in));
+        address.length = sizeof(sockaddr_in);
+    } else if (source->sa_family == AF_INET6 && sourceLength >= (SocketLength)sizeof(sockaddr_in6)) {
+        const sockaddr_in6* v6 = reinterpret_cast<const sockaddr_in6*>(source);
+        const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&v6->sin6_addr);
+        static const uint8_t mappedPrefix[12] = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0xFF, 0xFF};
+        if (std::memcmp(bytes, mappedPrefix, sizeof(mappedPrefix)) == 0) {
+            sockaddr_in* v4 = reinterpret_cast<sockaddr_in*>(&address.storage);
+            v4->sin_family = AF_INET;
+            v4->sin_port = v6->sin6_port;
+            std::memcpy(&v4->sin_addr, bytes + 12, 4);
+            address.length = sizeof(sockaddr_in);
+        } else {
+            std::memcpy(&address.storage, source, sizeof(sockaddr_in6));
+            address.length = sizeof(sockaddr_in6);
+        }
+    }
+    return address;
+}
+
+std::string SocketAddress::ToString() const {
+    char text[INET6_ADDRSTRLEN] = "";
+    if (!IsValid() || !inet_ntop(Family(), AddressBytes(), text, sizeof(text))) return "";
+    return text;
+}
+
+bool SocketAddress::SameAddress(const SocketAddress& other) const {
+    return Family() == other.Family() && AddressSize() > 0 &&
+           std::memcmp(AddressBytes(), other.AddressBytes(), AddressSize()) == 0;
+}
+
+SocketAddress SocketAddress::ForFamily(int socketFamily) const {
+    if (socketFamily != AF_INET6 || Family() != AF_INET) return *this;
+
+    SocketAddress mapped;
+    sockaddr_in6* v6 = reinterpret_cast<sockaddr_in6*>(&mapped.storage);
+    v6->sin6_family = AF_INET6;
+    v6->sin6_port = reinterpret_cast<const sockaddr_in*>(&storage)->sin_port;
+    uint8_t* bytes = reinterpret_cast<uint8_t*>(&v6->sin6_addr);
+    bytes[10] = 0xFF;
+    bytes[11] = 0xFF;
+    std::memcpy(bytes + 12, AddressBytes(), 4);
+    mapped.length = sizeof(sockaddr_in6);
+    return mapped;
+}
+
+SocketHandle OpenDualStackSocket(int type, int protocol, uint16_t port, int& family) {
+    for (int candidate : {AF_INET6, AF_INET}) {
+        SocketHandle s = socket(candidate, type, protocol);
+        if (s == INVALID_SOCKET_HANDLE) continue;
+
+        SetSocketOption(s, SOL_SOCKET, SO_REUSEADDR, 1);
+        bool bound;
+        if (candidate == AF_INET6) {
+            sockaddr_in6 addr{};
+            addr.sin6_family = AF_INET6;
+            addr.sin6_addr = in6addr_any;
+            addr.sin6_port = htons(port);
+            bound = SetSocketOption(s, IPPROTO_IPV6, IPV6_V6ONLY, 0) &&
+                    bind(s, (const sockaddr*)&addr, sizeof(addr)) == 0;
+        } else {
+            sockaddr_in addr{};
+            addr.sin_family = AF_INET;
+            addr.sin_addr.s_addr = htonl(INADDR_ANY);
+            addr.sin_port = htons(port);
+            bound = bind(s, (const sockaddr*)&addr, sizeof(addr)) == 0;
+        }
+        if (bound) {
+            family = candidate;
+            return s;
+        }
+        CloseSocket(s);
+    }
+    return INVALID_SOCKET_HANDLE;
+}
+
+bool ParseHostPort(const std::string& input, std::string& host, uint16_t& port) {
+    std::string portText;
+    if (!input.empty() && input[0] == '[') {
+        size_t close = input.find(']');
+        if (close == std::string::npos) return false;
+        host = input.substr(1, close - 1);
+        if (close + 1 < input.size()) {
+            if (input[close + 1] != ':') return false;
+            portText = input.substr(close + 2);
+        }
+    } else if (std::count(input.begin(), input.end(), ':') == 1) {
+        size_t colon = input.find(':');
+        host = input.substr(0, colon);
+        portText = input.substr(colon + 1);
+    } else {
+        host = input;   // IPv4 without a port, or a bare IPv6 literal
+    }
+
+    if (!portText.empty()) {
+        char* end = nullptr;
+        long parsed = std::strtol(portText.c_str(), &end, 10);
+        if (*end != '\0' || parsed <= 0 || parsed > 65535) return false;
+        port = (uint16_t)parsed;
+    }
+
+    SocketAddress address;
+    return SocketAddress::FromString(host, port, address);
+}
+
+std::string FormatHostPort(const std::string& host, uint16_t port) {
+    bool v6 = host.find(':') != std::string::npos;
+    return (v6 ? "[" + host + "]" : host) + ":" + std::to_string(port);
+}
+
+// Link-local addresses only reach the local link and need a scope to send to
+static bool IsLinkLocal(const SocketAddress& address) {
+    const uint8_t* bytes = address.AddressBytes();
+    if (address.Family() == AF_INET) return bytes[0] == 169 && bytes[1] == 254;
+    return address.Family() == AF_INET6 && bytes[0] == 0xFE && (bytes[1] & 0xC0) == 0x80;
+}
+
+#ifdef _WIN32
+
+bool GetLocalInterfaceAddresses(std::vector<LocalInterfaceAddress>& addresses) {
+    addresses.clear();
+
+    // The size needed can grow between calls; retry a few times
+    std::vector<uint8_t> buffer(16 * 1024);
+    ULONG flags = GAA_FLAG_SKIP_ANYCAST | GAA_FLAG_SKIP_MULTICAST | GAA_FLAG_SKIP_DNS_SERVER;
+    ULONG result = ERROR_BUFFER_OVERFLOW;
+    for (int attempt = 0; attempt < 3 && result == ERROR_BUFFER_OVERFLOW; attempt++) {
+        ULONG size = (ULONG)buffer.size();
+        result = GetAdaptersAddresses(AF_UNSPEC, flags, nullptr,
+                                      reinterpret_cast<IP_ADAPTER_ADDRESSES*>(buffer.data()), &size);
+        if (result == ERROR_BUFFER_OVERFLOW) buffer.resize(size);
+    }
+    if (result != NO_ERROR) return false;
+
+    for (auto* adapter = reinterpret_cast<IP_ADAPTER_ADDRESSES*>(buffer.data()); adapter; adapter = adapter->Next) {
+        if (adapter->OperStatus != IfOperStatusUp || adapter->IfType == IF_TYPE_SOFTWARE_LOOPBACK) continue;
+
+        InterfaceKind kind = InterfaceKind::Other;
+        if (adapter->IfType == IF_TYPE_IEEE80211) kind = InterfaceKind::Wireless;
+        if (adapter->IfType == IF_TYPE_ETHERNET_CSMACD) kind = InterfaceKind::Wired;
+
+        for (auto* unicast = adapter->FirstUnicastAddress; unicast; unicast = unicast->Next) {
+            SocketAddress address = SocketAddress::FromSockaddr(unicast->Address.lpSockaddr,
+                                                                unicast->Address.iSockaddrLength);
+            if (!address.IsValid() || IsLinkLocal(address)) continue;
+            address.SetPort(0);
+            addresses.push_back({adapter->AdapterName, address, kind});
+        }
+    }
+    return true;
+}
+
+#else
+
+bool GetLocalInterfaceAddresses(std::vector<LocalInterfaceAddress>& addresses) {
+    addresses.clear();
+
+    ifaddrs* list = nullptr;
+    if (getifaddrs(&list) != 0) return false;
+
+    for (ifaddrs* entry = list; entry; entry = entry->ifa_next) {
+        if (!entry->ifa_addr || (entry->ifa_flags & IFF_UP) == 0 || (entry->ifa_flags & IFF_LOOPBACK) != 0) continue;
+        SocketLength length = entry->ifa_addr->sa_family == AF_INET6 ? sizeof(sockaddr_in6) : sizeof(sockaddr_in);
+        SocketAddress address = SocketAddress::FromSockaddr(entry->ifa_addr, length);
+        if (!address.IsValid() || IsLinkLocal(address)) continue;
+        address.SetPort(0);
+
+        // sysfs tells a wireless card from a wired one; virtual links (veth,
+        // bridges, tunnels) have no device behind them
+        std::string sysfs = std::string("/sys/class/net/") + entry->ifa_name;
+        InterfaceKind kind = InterfaceKind::Other;
+        if (access((sysfs + "/wireless").c_str(), F_OK) == 0 || access((sysfs + "/phy80211").c_str(), F_OK) == 0) {
+            kind = InterfaceKind::Wireless;
+        } else if (access((sysfs + "/device").c_str(), F_OK) == 0) {
+            kind = InterfaceKind::Wired;
+        }
+        addresses.push_back({entry->ifa_name, address, kind});
+    }
+
+    freeifaddrs(list);
+    return true;
+}
+
+#endif
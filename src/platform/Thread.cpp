@@ -0,0 +1,289 @@
+#include <platform/Thread.h>
+
+#ifdef _WIN32
+#include <platform/Win32.h>
+#include <avrt.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#endif
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <cstdio>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+#include <cstdlib>
+#include <cstring>
+
+// Niceness a background thread runs at on Linux (0 = normal, 19 = lowest)
+constexpr int BACKGROUND_THREAD_NICE = 10;
+
+// SCHED_FIFO/SCHED_RR priorities (1-99). Low enough to leave the kernel's
+// own threaded IRQ handlers (50) ahead of us; audio preempts network.
+constexpr int AUDIO_THREAD_RT_PRIORITY = 40;
+constexpr int NETWORK_THREAD_RT_PRIORITY = 30;
+
+constexpr size_t STACK_PREFAULT_BYTES = 64 * 1024;
+constexpr size_t STACK_PAGE_BYTES = 4096;
+
+#ifdef _WIN32
+
+#pragma comment(lib, "avrt.lib")
+
+// Working set the call's buffers, DSP state and code comfortably fit in
+constexpr SIZE_T LOCKED_WORKING_SET_MIN = 64 * 1024 * 1024;
+constexpr SIZE_T LOCKED_WORKING_SET_MAX = 256 * 1024 * 1024;
+
+// MMCSS registration of this thread, reverted by ResetCurrentThreadPriority
+static thread_local HANDLE mmcssHandle = nullptr;
+
+static SIZE_T savedWorkingSetMin = 0;
+static SIZE_T savedWorkingSetMax = 0;
+static DWORD savedWorkingSetFlags = 0;
+static bool memoryLocked = false;
+
+void SetCurrentThreadName(const char* name) {
+    // SetThreadDescription is Windows 10 1607+; older systems keep the thread unnamed
+    typedef HRESULT(WINAPI * SetThreadDescriptionProc)(HANDLE, PCWSTR);
+    HMODULE kernel = GetModuleHandleW(L"kernel32.dll");
+    auto setDescription = kernel ? (SetThreadDescriptionProc)GetProcAddress(kernel, "SetThreadDescription")
+                                 : nullptr;
+    if (!setDescription) return;
+
+    wchar_t wideName[64];
+    size_t i = 0;
+    for (; name[i] && i < 63; i++) wideName[i] = (wchar_t)name[i];
+    wideName[i] = L'\0';
+    setDescription(GetCurrentThread(), wideName);
+}
+
+bool SetCurrentThreadPriority(ThreadPriority priority) {
+    switch (priority) {
+        case ThreadPriority::Background:
+            return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_BELOW_NORMAL) != 0;
+        case ThreadPriority::Normal:
+            return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL) != 0;
+        case ThreadPriority::Network:
+            return SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST) != 0;
+        case ThreadPriority::Audio: {
+            if (!mmcssHandle) {
+                DWORD taskIndex = 0;
+                mmcssHandle = AvSetMmThreadCharacteristicsW(L"Pro Audio", &taskIndex);
+                if (!mmcssHandle) return false;
+            }
+            return AvSetMmThreadPriority(mmcssHandle, AVRT_PRIORITY_HIGH) != 0;
+        }
+    }
+    return false;
+}
+
+void ResetCurrentThreadPriority() {
+    if (mmcssHandle) {
+        AvRevertMmThreadCharacteristics(mmcssHandle);
+        mmcssHandle = nullptr;
+    }
+    SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+}
+
+bool SetCurrentThreadAffinity(uint32_t cpu) {
+    if (cpu >= sizeof(DWORD_PTR) * 8) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+}
+
+int64_t GetCurrentThreadOsId() {
+    return (int64_t)GetCurrentThreadId();
+}
+
+bool ReadThreadRunQueueNanos(int64_t osThreadId, uint64_t& nanos) {
+    (void)osThreadId;
+    nanos = 0;
+    return false;
+}
+
+bool LockProcessMemory() {
+    if (memoryLocked) return true;
+    if (!GetProcessWorkingSetSizeEx(GetCurrentProcess(), &savedWorkingSetMin, &savedWorkingSetMax,
+                                    &savedWorkingSetFlags)) {
+        return false;
+    }
+    // A hard minimum keeps the memory manager from trimming our pages
+    if (!SetProcessWorkingSetSizeEx(GetCurrentProcess(), LOCKED_WORKING_SET_MIN, LOCKED_WORKING_SET_MAX,
+                                    QUOTA_LIMITS_HARDWS_MIN_ENABLE | QUOTA_LIMITS_HARDWS_MAX_DISABLE)) {
+        return false;
+    }
+    memoryLocked = true;
+    return true;
+}
+
+void UnlockProcessMemory() {
+    if (!memoryLocked) return;
+    DWORD flags = (savedWorkingSetFlags & QUOTA_LIMITS_HARDWS_MIN_ENABLE) ? QUOTA_LIMITS_HARDWS_MIN_ENABLE
+                                                                          : QUOTA_LIMITS_HARDWS_MIN_DISABLE;
+    flags |= (savedWorkingSetFlags & QUOTA_LIMITS_HARDWS_MAX_ENABLE) ? QUOTA_LIMITS_HARDWS_MAX_ENABLE
+                                                                     : QUOTA_LIMITS_HARDWS_MAX_DISABLE;
+    SetProcessWorkingSetSizeEx(GetCurrentProcess(), savedWorkingSetMin, savedWorkingSetMax, flags);
+    memoryLocked = false;
+}
+
+#else
+
+static bool SetCurrentThreadScheduler(int policy, int priority) {
+    sched_param param{};
+    param.sched_priority = priority;
+    return pthread_setschedparam(pthread_self(), policy, &param) == 0;
+}
+
+static void SetCurrentThreadNice(int nice) {
+#if defined(__linux__)
+    // Linux applies niceness per thread when given a thread id
+    setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice);
+#else
+    (void)nice;
+#endif
+}
+
+void SetCurrentThreadName(const char* name) {
+#if defined(__linux__)
+    char shortName[16];
+    std::strncpy(shortName, name, sizeof(shortName) - 1);
+    shortName[sizeof(shortName) - 1] = '\0';
+    pthread_setname_np(pthread_self(), shortName);
+#elif defined(__APPLE__)
+    pthread_setname_np(name);
+#else
+    (void)name;
+#endif
+}
+
+bool SetCurrentThreadPriority(ThreadPriority priority) {
+    switch (priority) {
+        case ThreadPriority::Background:
+            SetCurrentThreadScheduler(SCHED_OTHER, 0);
+            SetCurrentThreadNice(BACKGROUND_THREAD_NICE);
+            return true;
+        case ThreadPriority::Normal:
+            SetCurrentThreadNice(0);
+            return SetCurrentThreadScheduler(SCHED_OTHER, 0);
+        case ThreadPriority::Network:
+            return SetCurrentThreadScheduler(SCHED_RR, NETWORK_THREAD_RT_PRIORITY);
+        case ThreadPriority::Audio:
+            return SetCurrentThreadScheduler(SCHED_FIFO, AUDIO_THREAD_RT_PRIORITY);
+    }
+    return false;
+}
+
+void ResetCurrentThreadPriority() {
+    SetCurrentThreadPriority(ThreadPriority::Normal);
+}
+
+bool SetCurrentThreadAffinity(uint32_t cpu) {
+#if defined(__linux__)
+    if (cpu >= CPU_SETSIZE) return false;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+    return false;
+#endif
+}
+
+int64_t GetCurrentThreadOsId() {
+#if defined(__linux__)
+    return (int64_t)syscall(SYS_gettid);
+#else
+    return (int64_t)(uintptr_t)pthread_self();
+#endif
+}
+
+bool ReadThreadRunQueueNanos(int64_t osThreadId, uint64_t& nanos) {
+    nanos = 0;
+#if defined(__linux__)
+    // schedstat: time on CPU, time waiting on a run queue, timeslices (ns)
+    char path[64];
+    std::snprintf(path, sizeof(path), "/proc/self/task/%lld/schedstat", (long long)osThreadId);
+    FILE* file = std::fopen(path, "r");
+    if (!file) return false;
+    unsigned long long running = 0;
+    unsigned long long waiting = 0;
+    bool parsed = std::fscanf(file, "%llu %llu", &running, &waiting) == 2;
+    std::fclose(file);
+    nanos = waiting;
+    return parsed;
+#else
+    (void)osThreadId;
+    return false;
+#endif
+}
+
+#if defined(__GLIBC__)
+// glibc's defaults for what LockProcessMemory changes. mallopt cannot read
+// a setting back, so these (or the MALLOC_*_ environment overrides glibc
+// started with) are what the unlock puts back. Either way glibc's dynamic
+// mmap threshold stays off once set, as any mallopt of these leaves it.
+constexpr int MALLOC_DEFAULT_TRIM_THRESHOLD = 128 * 1024;
+constexpr int MALLOC_DEFAULT_MMAP_MAX = 65536;
+
+static int savedTrimThreshold = 0;
+static int savedMmapMax = 0;
+static bool mallocTuned = false;
+
+static int MallocSetting(const char* variable, int fallback) {
+    const char* value = std::getenv(variable);
+    return value && *value ? std::atoi(value) : fallback;
+}
+
+static void RestoreMallocSettings() {
+    if (!mallocTuned) return;
+    mallopt(M_TRIM_THRESHOLD, savedTrimThreshold);
+    mallopt(M_MMAP_MAX, savedMmapMax);
+    mallocTuned = false;
+}
+#endif
+
+bool LockProcessMemory() {
+#if defined(__GLIBC__)
+    // Freed memory stays in the heap rather than going back to the OS, and
+    // large blocks come from the locked heap rather than fresh mmaps
+    if (!mallocTuned) {
+        savedTrimThreshold = MallocSetting("MALLOC_TRIM_THRESHOLD_", MALLOC_DEFAULT_TRIM_THRESHOLD);
+        savedMmapMax = MallocSetting("MALLOC_MMAP_MAX_", MALLOC_DEFAULT_MMAP_MAX);
+        mallocTuned = true;
+    }
+    mallopt(M_TRIM_THRESHOLD, -1);
+    mallopt(M_MMAP_MAX, 0);
+#endif
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) return true;
+#if defined(__GLIBC__)
+    RestoreMallocSettings();
+#endif
+    return false;
+}
+
+void UnlockProcessMemory() {
+    munlockall();
+#if defined(__GLIBC__)
+    RestoreMallocSettings();
+#endif
+}
+
+#endif
+
+void SetCurrentThreadBackgroundPriority() {
+    SetCurrentThreadPriority(ThreadPriority::Background);
+}
+
+void PrefaultCurrentThreadStack() {
+    // volatile so the stores are not optimized away
+    volatile char pages[STACK_PREFAULT_BYTES];
+    for (size_t i = 0; i < STACK_PREFAULT_BYTES; i += STACK_PAGE_BYTES) {
+        pages[i] = 0;
+    }
+    (void)pages[0];
+}
@@ -0,0 +1,40 @@
+#include <platform/Timer.h>
+
+#ifdef _WIN32
+#include <platform/Win32.h>
+#endif
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+
+void AcquireTimerResolution() {
+    timeBeginPeriod(1);
+}
+
+void ReleaseTimerResolution() {
+    timeEndPeriod(1);
+}
+
+void SleepMillis(uint32_t milliseconds) {
+    Sleep(milliseconds);
+}
+
+#else
+
+void AcquireTimerResolution() {
+}
+
+void ReleaseTimerResolution() {
+}
+
+void SleepMillis(uint32_t milliseconds) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+}
+
+#endif
+
+// steady_clock on both platforms; Windows honors it to the timer resolution above
+void SleepUntilMicros(int64_t deadlineMicros) {
+    std::this_thread::sleep_until(std::chrono::steady_clock::time_point(std::chrono::microseconds(deadlineMicros)));
+}
@@ -1,47 +1,323 @@
 #include <utils/Logger.h>
-#include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <ctime>
 
-Logger::Logger() {
-    // Initialize console for debug output
+// Each producing thread owns one ring. The handle retires it on thread exit
+// so the writer can reclaim it once drained; anything the thread logs after
+// that (static destructors on the main thread) goes to the fallback ring.
+thread_local Logger::ProducerRing* Logger::threadRing = nullptr;
+thread_local bool Logger::threadRingRetired = false;
+
+struct ProducerRingHandle {
+    ~ProducerRingHandle() {
+        if (Logger::threadRing) {
+            Logger::threadRing->retired.store(true, std::memory_order_release);
+            Logger::threadRing = nullptr;
+        }
+        Logger::threadRingRetired = true;
+    }
+};
+
+static thread_local ProducerRingHandle threadRingHandle;
+
+Logger::Logger()
+    : nextThreadIndex(1), retiredDropped(0), fallbackRing(nullptr), running(true),
+      flushRequested(0), flushCompleted(0), reportedDropped(0), truncatedCount(0), consoleOutput(true) {
+    // Thread index 0 is the fallback ring
+    rings.push_back(std::make_unique<ProducerRing>());
+    fallbackRing = rings.back().get();
+
+    writerThread = std::thread(&Logger::WriterThreadProc, this);
 }
 
 Logger::~Logger() {
+    {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        running = false;
+    }
+    writerCV.notify_all();
+
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+
     if (logFile.is_open()) {
         logFile.close();
     }
 }
 
 void Logger::SetLogFile(const std::string& filename) {
-    std::lock_guard<std::mutex> lock(logMutex);
+    std::lock_guard<std::mutex> lock(fileMutex);
     if (logFile.is_open()) {
         logFile.close();
     }
     logFile.open(filename, std::ios::app);
 }
 
+void Logger::SetConsoleOutput(bool enabled) {
+    consoleOutput = enabled;
+}
+
 void Logger::Log(LogLevel level, const std::string& message) {
-    std::lock_guard<std::mutex> lock(logMutex);
-
-    auto now = std::chrono::system_clock::now();
-    auto time = std::chrono::system_clock::to_time_t(now);
-    char timeBuf[100];
-    ctime_s(timeBuf, sizeof(timeBuf), &time);
-    
-    std::string levelStr = LevelToString(level);
-    std::stringstream ss;
-    ss << "[" << timeBuf << "] [" << levelStr << "] " << message;
-    std::string output = ss.str();
-
-    // Console output
-    std::cout << output << std::endl;
-
-    // File output
+    LogRecord* record = BeginRecord(level);
+    if (!record) return;
+
+    size_t length = std::min(message.size(), LOG_RECORD_TEXT_SIZE);
+    std::memcpy(record->text, message.data(), length);
+    record->textLength = (uint16_t)length;
+    record->truncated = length < message.size();
+    CommitRecord();
+}
+
+void Logger::Log(LogLevel level, const char* message) {
+    LogRecord* record = BeginRecord(level);
+    if (!record) return;
+
+    size_t length = strnlen(message, LOG_RECORD_TEXT_SIZE + 1);
+    record->truncated = length > LOG_RECORD_TEXT_SIZE;
+    length = std::min(length, LOG_RECORD_TEXT_SIZE);
+    std::memcpy(record->text, message, length);
+    record->textLength = (uint16_t)length;
+    CommitRecord();
+}
+
+void Logger::RegisterThread() {
+    if (!threadRing && !threadRingRetired) {
+        RegisterThreadRing();
+    }
+}
+
+void Logger::Flush() {
+    std::unique_lock<std::mutex> lock(writerMutex);
+    if (!running) return;
+
+    uint64_t target = ++flushRequested;
+    writerCV.notify_all();
+    writerCV.wait(lock, [this, target] { return flushCompleted >= target || !running; });
+}
+
+uint64_t Logger::GetDroppedCount() const {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    uint64_t dropped = retiredDropped.load(std::memory_order_relaxed);
+    for (const auto& producer : rings) {
+        dropped += producer->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+uint64_t Logger::GetTruncatedCount() const {
+    return truncatedCount.load(std::memory_order_relaxed);
+}
+
+LogRecord* Logger::BeginRecord(LogLevel level) {
+    ProducerRing* producer = threadRing;
+    if (!producer) {
+        if (threadRingRetired) {
+            fallbackMutex.lock();
+            producer = fallbackRing;
+        } else {
+            producer = RegisterThreadRing();
+        }
+    }
+
+    LogRecord* record = producer->ring.BeginPush();
+    if (!record) {
+        producer->dropped.fetch_add(1, std::memory_order_relaxed);
+        if (producer == fallbackRing) {
+            fallbackMutex.unlock();
+        }
+        return nullptr;
+    }
+
+    record->timestampNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    record->format = nullptr;
+    record->threadIndex = producer->threadIndex;
+    record->level = level;
+    record->argCount = 0;
+    record->truncated = false;
+    record->textLength = 0;
+    return record;
+}
+
+void Logger::CommitRecord() {
+    if (threadRing) {
+        threadRing->ring.EndPush();
+        return;
+    }
+
+    fallbackRing->ring.EndPush();
+    fallbackMutex.unlock();
+}
+
+Logger::ProducerRing* Logger::RegisterThreadRing() {
+    // Touch the handle so its destructor runs when this thread exits
+    (void)&threadRingHandle;
+
+    auto producer = std::make_unique<ProducerRing>();
+
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    producer->threadIndex = nextThreadIndex++;
+    threadRing = producer.get();
+    rings.push_back(std::move(producer));
+    return threadRing;
+}
+
+void Logger::AppendText(LogRecord& record, const char* text, size_t length, LogArg& arg) {
+    size_t available = LOG_RECORD_TEXT_SIZE - record.textLength;
+    if (length > available) {
+        record.truncated = true;
+        length = available;
+    }
+    std::memcpy(record.text + record.textLength, text, length);
+
+    arg.type = LogArg::Type::String;
+    arg.s.offset = record.textLength;
+    arg.s.length = (uint16_t)length;
+    record.textLength = (uint16_t)(record.textLength + length);
+}
+
+void Logger::WriterThreadProc() {
+    std::string batch;
+    batch.reserve(64 * 1024);
+
+    while (true) {
+        uint64_t flushTarget;
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(writerMutex);
+            writerCV.wait_for(lock, std::chrono::milliseconds(LOG_FLUSH_INTERVAL_MS),
+                              [this] { return !running || flushRequested != flushCompleted; });
+            flushTarget = flushRequested;
+            stopping = !running;
+        }
+
+        if (DrainRings(batch)) {
+            WriteBatch(batch);
+            batch.clear();
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(writerMutex);
+            flushCompleted = flushTarget;
+        }
+        writerCV.notify_all();
+
+        if (stopping) break;
+    }
+}
+
+bool Logger::DrainRings(std::string& batch) {
+    std::lock_guard<std::mutex> lock(ringsMutex);
+
+    // One pass takes at most a ring's capacity from each thread, which covers
+    // everything published before the pass started without starving on a
+    // thread that logs continuously
+    uint64_t dropped = retiredDropped.load(std::memory_order_relaxed);
+    for (auto it = rings.begin(); it != rings.end();) {
+        ProducerRing& producer = **it;
+        bool retired = producer.retired.load(std::memory_order_acquire);
+
+        for (size_t i = 0; i < LOG_RING_CAPACITY; i++) {
+            LogRecord* record = producer.ring.Front();
+            if (!record) break;
+            FormatRecord(*record, batch);
+            if (record->truncated) truncatedCount.fetch_add(1, std::memory_order_relaxed);
+            producer.ring.Pop();
+        }
+
+        uint64_t ringDropped = producer.dropped.load(std::memory_order_relaxed);
+        dropped += ringDropped;
+
+        if (retired && producer.ring.Size() == 0) {
+            retiredDropped.fetch_add(ringDropped, std::memory_order_relaxed);
+            it = rings.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    if (dropped > reportedDropped) {
+        char line[96];
+        std::snprintf(line, sizeof(line), "[WARNING] %llu log records dropped (producer ring full)\n",
+                      (unsigned long long)(dropped - reportedDropped));
+        batch += line;
+        reportedDropped = dropped;
+    }
+
+    return !batch.empty();
+}
+
+void Logger::WriteBatch(const std::string& batch) {
+    if (consoleOutput) {
+        std::fwrite(batch.data(), 1, batch.size(), stdout);
+        std::fflush(stdout);
+    }
+
+    std::lock_guard<std::mutex> lock(fileMutex);
     if (logFile.is_open()) {
-        logFile << output << std::endl;
+        logFile.write(batch.data(), (std::streamsize)batch.size());
         logFile.flush();
     }
 }
 
+void Logger::FormatRecord(const LogRecord& record, std::string& out) const {
+    time_t seconds = (time_t)(record.timestampNs / 1000000000);
+    int millis = (int)((record.timestampNs / 1000000) % 1000);
+
+    std::tm local{};
+#ifdef _WIN32
+    localtime_s(&local, &seconds);
+#else
+    localtime_r(&seconds, &local);
+#endif
+
+    char prefix[96];
+    size_t prefixLength = std::strftime(prefix, sizeof(prefix), "[%Y-%m-%d %H:%M:%S", &local);
+    std::snprintf(prefix + prefixLength, sizeof(prefix) - prefixLength, ".%03d] [%s] [T%u] ",
+                  millis, LevelToString(record.level).c_str(), record.threadIndex);
+    out += prefix;
+
+    if (!record.format) {
+        out.append(record.text, record.textLength);
+        if (record.truncated) out += "...";
+        out += '\n';
+        return;
+    }
+
+    // Substitute {} placeholders in order
+    size_t argIndex = 0;
+    for (const char* p = record.format; *p; ++p) {
+        if (p[0] == '{' && p[1] == '}' && argIndex < record.argCount) {
+            const LogArg& arg = record.args[argIndex++];
+            switch (arg.type) {
+                case LogArg::Type::Signed:
+                    out += std::to_string(arg.i);
+                    break;
+                case LogArg::Type::Unsigned:
+                    out += std::to_string(arg.u);
+                    break;
+                case LogArg::Type::Double: {
+                    char number[32];
+                    std::snprintf(number, sizeof(number), "%g", arg.d);
+                    out += number;
+                    break;
+                }
+                case LogArg::Type::String:
+                    out.append(record.text + arg.s.offset, arg.s.length);
+                    break;
+            }
+            ++p;
+        } else {
+            out += *p;
+        }
+    }
+    if (record.truncated) out += "...";
+    out += '\n';
+}
+
 std::string Logger::LevelToString(LogLevel level) const {
     switch (level) {
         case LogLevel::DEBUG:
@@ -0,0 +1,475 @@
+#include <utils/Metrics.h>
+#include <cstdio>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// Marks a slot that is being claimed and reset
+constexpr uint32_t PEER_SLOT_CLAIMING = 0xFFFFFFFFu;
+
+uint32_t MetricHistogram::CountLeadingZeros(uint64_t value) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - (uint32_t)index;
+#else
+    return (uint32_t)__builtin_clzll(value);
+#endif
+}
+
+uint64_t MetricHistogram::BucketLowerBound(size_t index) {
+    if (index < HISTOGRAM_SUB_BUCKETS) return index;
+    uint32_t shift = (uint32_t)(index / HISTOGRAM_SUB_BUCKETS) - 1;
+    return (uint64_t)(HISTOGRAM_SUB_BUCKETS + index % HISTOGRAM_SUB_BUCKETS) << shift;
+}
+
+uint64_t MetricHistogram::BucketWidth(size_t index) {
+    if (index < HISTOGRAM_SUB_BUCKETS) return 1;
+    return 1ull << ((uint32_t)(index / HISTOGRAM_SUB_BUCKETS) - 1);
+}
+
+void MetricHistogram::Snapshot(HistogramSnapshot& out) const {
+    out.count = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        out.counts[i] = buckets[i].load(std::memory_order_relaxed);
+        out.count += out.counts[i];
+    }
+    out.sum = sum.load(std::memory_order_relaxed);
+    out.max = max.load(std::memory_order_relaxed);
+}
+
+void MetricHistogram::Reset() {
+    for (auto& bucket : buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    count.store(0, std::memory_order_relaxed);
+    sum.store(0, std::memory_order_relaxed);
+    max.store(0, std::memory_order_relaxed);
+}
+
+uint64_t HistogramSnapshot::ValueAtPercentile(double p) const {
+    if (count == 0) return 0;
+
+    uint64_t rank = (uint64_t)(p / 100.0 * (double)count + 0.5);
+    if (rank < 1) rank = 1;
+    if (rank > count) rank = count;
+
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t value = MetricHistogram::BucketLowerBound(i) + MetricHistogram::BucketWidth(i) / 2;
+            return value < max ? value : max;
+        }
+    }
+    return max;
+}
+
+double HistogramSnapshot::Mean() const {
+    return count ? (double)sum / (double)count : 0.0;
+}
+
+const char* MetricStageToString(MetricStage stage) {
+    switch (stage) {
+        case MetricStage::Capture: return "capture";
+        case MetricStage::Send: return "send";
+        case MetricStage::Receive: return "receive";
+        case MetricStage::Mix: return "mix";
+        case MetricStage::Render: return "render";
+        case MetricStage::Record: return "record";
+        case MetricStage::EchoCancel: return "echo_cancel";
+        case MetricStage::NoiseSuppress: return "noise_suppress";
+        default: return "unknown";
+    }
+}
+
+const char* MetricThreadToString(MetricThread thread) {
+    switch (thread) {
+        case MetricThread::Capture: return "capture";
+        case MetricThread::Render: return "render";
+        case MetricThread::DeviceClock: return "device_clock";
+        case MetricThread::Receive: return "receive";
+        case MetricThread::Accept: return "accept";
+        case MetricThread::Control: return "control";
+        default: return "unknown";
+    }
+}
+
+void ThreadMetrics::Reset() {
+    wakeLatencyMicros.Reset();
+    runQueueMicros.Reset();
+    realtime.Reset();
+    cpu.Set(-1);
+    running.Reset();
+}
+
+void PeerMetrics::Reset() {
+    ssrc.store(0, std::memory_order_relaxed);
+    packetsSent.Reset();
+    bytesSent.Reset();
+    packetsReceived.Reset();
+    bytesReceived.Reset();
+    packetsReordered.Reset();
+    packetsDuplicated.Reset();
+    lateDrops.Reset();
+    packetsRecovered.Reset();
+    rateDecisions.Reset();
+    authFailures.Reset();
+    replayDrops.Reset();
+    pathSwitches.Reset();
+    sessionResumes.Reset();
+    packetsLost.Reset();
+    jitterMicros.Reset();
+    jitterBufferDepth.Reset();
+    rttMicros.Reset();
+    remoteLossPermille.Reset();
+    sendBitrate.Reset();
+    loudnessGainCentibels.Reset();
+    pathRttMicros.Reset();
+    firstAudioMicros.Reset();
+    mediaSecurity.Reset();
+    interarrivalMicros.Reset();
+    resumeTimeToAudioMicros.Reset();
+    captureDelayMicros.Reset();
+    networkDelayMicros.Reset();
+    jitterBufferDelayMicros.Reset();
+    clockOffsetMicros.Reset();
+    clockRoundTripMicros.Reset();
+}
+
+MetricsRegistry& MetricsRegistry::GetInstance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+PeerMetrics* MetricsRegistry::FindPeer(uint32_t peerId) {
+    size_t used = peerHighWater.load(std::memory_order_acquire);
+    for (size_t i = 0; i < used; i++) {
+        if (peers[i].peerId.load(std::memory_order_acquire) == peerId) {
+            return &peers[i];
+        }
+    }
+    return nullptr;
+}
+
+PeerMetrics* MetricsRegistry::AcquirePeer(uint32_t peerId) {
+    if (peerId == 0 || peerId == PEER_SLOT_CLAIMING) return nullptr;
+
+    if (PeerMetrics* existing = FindPeer(peerId)) {
+        return existing;
+    }
+
+    for (size_t i = 0; i < METRICS_MAX_PEERS; i++) {
+        uint32_t expected = 0;
+        if (!peers[i].peerId.compare_exchange_strong(expected, PEER_SLOT_CLAIMING,
+                                                     std::memory_order_acq_rel)) {
+            continue;
+        }
+
+        peers[i].Reset();
+
+        size_t used = peerHighWater.load(std::memory_order_relaxed);
+        while (used < i + 1 &&
+               !peerHighWater.compare_exchange_weak(used, i + 1, std::memory_order_release)) {
+        }
+
+        peers[i].peerId.store(peerId, std::memory_order_release);
+        return &peers[i];
+    }
+
+    return nullptr;
+}
+
+void MetricsRegistry::ReleasePeer(uint32_t peerId) {
+    if (PeerMetrics* slot = FindPeer(peerId)) {
+        slot->peerId.store(0, std::memory_order_release);
+    }
+}
+
+void MetricsRegistry::FormatPrometheus(std::string& out) const {
+    char line[256];
+    HistogramSnapshot snapshot;
+
+    auto append = [&](int length) {
+        if (length > 0) out.append(line, (size_t)length < sizeof(line) ? (size_t)length : sizeof(line) - 1);
+    };
+
+    auto appendSummary = [&](const char* name, const char* labels, const MetricHistogram& histogram,
+                             double scale) {
+        histogram.Snapshot(snapshot);
+        const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+        for (double q : quantiles) {
+            append(std::snprintf(line, sizeof(line), "%s{%s%squantile=\"%g\"} %.9g\n",
+                                 name, labels, labels[0] ? "," : "", q,
+                                 snapshot.ValueAtPercentile(q * 100.0) * scale));
+        }
+        append(std::snprintf(line, sizeof(line), "%s_sum%s%s%s %.9g\n", name,
+                             labels[0] ? "{" : "", labels, labels[0] ? "}" : "",
+                             snapshot.sum * scale));
+        append(std::snprintf(line, sizeof(line), "%s_count%s%s%s %llu\n", name,
+                             labels[0] ? "{" : "", labels, labels[0] ? "}" : "",
+                             (unsigned long long)snapshot.count));
+    };
+
+    // Process-wide
+    out += "# TYPE voiceqwik_playback_underruns_total counter\n";
+    append(std::snprintf(line, sizeof(line), "voiceqwik_playback_underruns_total %llu\n",
+                         (unsigned long long)playbackUnderruns.Get()));
+    out += "# TYPE voiceqwik_playback_underrun_frames_total counter\n";
+    append(std::snprintf(line, sizeof(line), "voiceqwik_playback_underrun_frames_total %llu\n",
+                         (unsigned long long)playbackUnderrunFrames.Get()));
+    out += "# TYPE voiceqwik_render_starvations_total counter\n";
+    append(std::snprintf(line, sizeof(line), "voiceqwik_render_starvations_total %llu\n",
+                         (unsigned long long)renderStarvations.Get()));
+    out += "# TYPE voiceqwik_capture_overruns_total counter\n";
+    append(std::snprintf(line, sizeof(line), "voiceqwik_capture_overruns_total %llu\n",
+                         (unsigned long long)captureOverruns.Get()));
+    out += "# TYPE voiceqwik_recorder_drops_total counter\n";
+    append(std::snprintf(line, sizeof(line), "voiceqwik_recorder_drops_total %llu\n",
+                         (unsigned long long)recorderDrops.Get()));
+    out += "# TYPE voiceqwik_playback_queue_depth gauge\n";
+    append(std::snprintf(line, sizeof(line), "voiceqwik_playback_queue_depth %lld\n",
+                         (long long)playbackQueueDepth.Get()));
+    out += "# TYPE voiceqwik_aec_erle_db gauge\n";
+    append(std::snprintf(line, sizeof(line), "voiceqwik_aec_erle_db %.2f\n", echoErleCentiDb.Get() / 100.0));
+    out += "# TYPE voiceqwik_ns_noise_level_dbfs gauge\n";
+    append(std::snprintf(line, sizeof(line), "voiceqwik_ns_noise_level_dbfs %.2f\n",
+                         noiseLevelCentiDb.Get() / 100.0));
+    out += "# TYPE voiceqwik_agc_gain_db gauge\n";
+    append(std::snprintf(line, sizeof(line), "voiceqwik_agc_gain_db %.2f\n", captureGainCentiDb.Get() / 100.0));
+    out += "# TYPE voiceqwik_memory_locked gauge\n";
+    append(std::snprintf(line, sizeof(line), "voiceqwik_memory_locked %lld\n", (long long)memoryLocked.Get()));
+    if (echoDelayMicros.Get() >= 0) {
+        out += "# TYPE voiceqwik_aec_delay_seconds gauge\n";
+        append(std::snprintf(line, sizeof(line), "voiceqwik_aec_delay_seconds %.6f\n",
+                             echoDelayMicros.Get() * 1e-6));
+    }
+
+    out += "# TYPE voiceqwik_render_delay_seconds summary\n";
+    appendSummary("voiceqwik_render_delay_seconds", "", renderDelayMicros, 1e-6);
+    out += "# TYPE voiceqwik_device_round_trip_seconds summary\n";
+    appendSummary("voiceqwik_device_round_trip_seconds", "", deviceRoundTripMicros, 1e-6);
+
+    out += "# TYPE voiceqwik_stage_duration_seconds summary\n";
+    for (size_t s = 0; s < (size_t)MetricStage::Count; s++) {
+        char labels[64];
+        std::snprintf(labels, sizeof(labels), "stage=\"%s\"", MetricStageToString((MetricStage)s));
+        appendSummary("voiceqwik_stage_duration_seconds", labels, stages[s], 1e-9);
+    }
+
+    // Per thread, while it runs
+    out += "# TYPE voiceqwik_thread_realtime gauge\n";
+    for (size_t t = 0; t < (size_t)MetricThread::Count; t++) {
+        if (threads[t].running.Get() == 0) continue;
+        append(std::snprintf(line, sizeof(line), "voiceqwik_thread_realtime{thread=\"%s\",cpu=\"%lld\"} %lld\n",
+                             MetricThreadToString((MetricThread)t), (long long)threads[t].cpu.Get(),
+                             (long long)threads[t].realtime.Get()));
+    }
+    out += "# TYPE voiceqwik_thread_runqueue_seconds_total counter\n";
+    for (size_t t = 0; t < (size_t)MetricThread::Count; t++) {
+        if (threads[t].running.Get() == 0) continue;
+        append(std::snprintf(line, sizeof(line), "voiceqwik_thread_runqueue_seconds_total{thread=\"%s\"} %.6f\n",
+                             MetricThreadToString((MetricThread)t), threads[t].runQueueMicros.Get() * 1e-6));
+    }
+    out += "# TYPE voiceqwik_thread_wake_latency_seconds summary\n";
+    for (size_t t = 0; t < (size_t)MetricThread::Count; t++) {
+        if (threads[t].running.Get() == 0) continue;
+        char labels[64];
+        std::snprintf(labels, sizeof(labels), "thread=\"%s\"", MetricThreadToString((MetricThread)t));
+        appendSummary("voiceqwik_thread_wake_latency_seconds", labels, threads[t].wakeLatencyMicros, 1e-6);
+    }
+
+    // Per peer
+    struct PeerCounter {
+        const char* name;
+        const char* type;
+        MetricCounter PeerMetrics::* counter;
+        MetricGauge PeerMetrics::* gauge;
+    };
+    const PeerCounter peerCounters[] = {
+        {"voiceqwik_peer_packets_sent_total", "counter", &PeerMetrics::packetsSent, nullptr},
+        {"voiceqwik_peer_bytes_sent_total", "counter", &PeerMetrics::bytesSent, nullptr},
+        {"voiceqwik_peer_packets_received_total", "counter", &PeerMetrics::packetsReceived, nullptr},
+        {"voiceqwik_peer_bytes_received_total", "counter", &PeerMetrics::bytesReceived, nullptr},
+        {"voiceqwik_peer_packets_reordered_total", "counter", &PeerMetrics::packetsReordered, nullptr},
+        {"voiceqwik_peer_packets_duplicated_total", "counter", &PeerMetrics::packetsDuplicated, nullptr},
+        {"voiceqwik_peer_late_drops_total", "counter", &PeerMetrics::lateDrops, nullptr},
+        {"voiceqwik_peer_packets_recovered_total", "counter", &PeerMetrics::packetsRecovered, nullptr},
+        {"voiceqwik_peer_rate_decisions_total", "counter", &PeerMetrics::rateDecisions, nullptr},
+        {"voiceqwik_peer_auth_failures_total", "counter", &PeerMetrics::authFailures, nullptr},
+        {"voiceqwik_peer_replay_drops_total", "counter", &PeerMetrics::replayDrops, nullptr},
+        {"voiceqwik_peer_path_switches_total", "counter", &PeerMetrics::pathSwitches, nullptr},
+        {"voiceqwik_peer_session_resumes_total", "counter", &PeerMetrics::sessionResumes, nullptr},
+        {"voiceqwik_peer_packets_lost", "gauge", nullptr, &PeerMetrics::packetsLost},
+        {"voiceqwik_peer_jitter_microseconds", "gauge", nullptr, &PeerMetrics::jitterMicros},
+        {"voiceqwik_peer_jitter_buffer_depth", "gauge", nullptr, &PeerMetrics::jitterBufferDepth},
+        {"voiceqwik_peer_rtt_microseconds", "gauge", nullptr, &PeerMetrics::rttMicros},
+        {"voiceqwik_peer_remote_loss_permille", "gauge", nullptr, &PeerMetrics::remoteLossPermille},
+        {"voiceqwik_peer_send_bitrate", "gauge", nullptr, &PeerMetrics::sendBitrate},
+        {"voiceqwik_peer_loudness_gain_centibels", "gauge", nullptr, &PeerMetrics::loudnessGainCentibels},
+        {"voiceqwik_peer_path_rtt_microseconds", "gauge", nullptr, &PeerMetrics::pathRttMicros},
+        {"voiceqwik_peer_time_to_first_audio_microseconds", "gauge", nullptr, &PeerMetrics::firstAudioMicros},
+        {"voiceqwik_peer_media_security", "gauge", nullptr, &PeerMetrics::mediaSecurity},
+        {"voiceqwik_peer_clock_offset_microseconds", "gauge", nullptr, &PeerMetrics::clockOffsetMicros},
+        {"voiceqwik_peer_clock_round_trip_microseconds", "gauge", nullptr, &PeerMetrics::clockRoundTripMicros},
+    };
+
+    size_t used = peerHighWater.load(std::memory_order_acquire);
+    for (const auto& metric : peerCounters) {
+        append(std::snprintf(line, sizeof(line), "# TYPE %s %s\n", metric.name, metric.type));
+        for (size_t i = 0; i < used; i++) {
+            const PeerMetrics& peer = peers[i];
+            uint32_t id = peer.peerId.load(std::memory_order_acquire);
+            if (id == 0 || id == PEER_SLOT_CLAIMING) continue;
+
+            if (metric.counter) {
+                append(std::snprintf(line, sizeof(line), "%s{peer=\"%u\",ssrc=\"%u\"} %llu\n",
+                                     metric.name, id, peer.ssrc.load(std::memory_order_relaxed),
+                                     (unsigned long long)(peer.*metric.counter).Get()));
+            } else {
+                append(std::snprintf(line, sizeof(line), "%s{peer=\"%u\",ssrc=\"%u\"} %lld\n",
+                                     metric.name, id, peer.ssrc.load(std::memory_order_relaxed),
+                                     (long long)(peer.*metric.gauge).Get()));
+            }
+        }
+    }
+
+    struct PeerSummary {
+        const char* name;
+        MetricHistogram PeerMetrics::* histogram;
+    };
+    const PeerSummary peerSummaries[] = {
+        {"voiceqwik_peer_interarrival_seconds", &PeerMetrics::interarrivalMicros},
+        {"voiceqwik_peer_resume_time_to_audio_seconds", &PeerMetrics::resumeTimeToAudioMicros},
+        {"voiceqwik_peer_capture_delay_seconds", &PeerMetrics::captureDelayMicros},
+        {"voiceqwik_peer_network_delay_seconds", &PeerMetrics::networkDelayMicros},
+        {"voiceqwik_peer_jitter_buffer_delay_seconds", &PeerMetrics::jitterBufferDelayMicros},
+    };
+
+    for (const auto& metric : peerSummaries) {
+        append(std::snprintf(line, sizeof(line), "# TYPE %s summary\n", metric.name));
+        for (size_t i = 0; i < used; i++) {
+            const PeerMetrics& peer = peers[i];
+            uint32_t id = peer.peerId.load(std::memory_order_acquire);
+            if (id == 0 || id == PEER_SLOT_CLAIMING) continue;
+
+            char labels[64];
+            std::snprintf(labels, sizeof(labels), "peer=\"%u\",ssrc=\"%u\"",
+                          id, peer.ssrc.load(std::memory_order_relaxed));
+            appendSummary(metric.name, labels, peer.*metric.histogram, 1e-6);
+        }
+    }
+}
+
+bool MetricsRegistry::WritePrometheusFile(const std::string& filename) const {
+    std::string text;
+    text.reserve(16384);
+    FormatPrometheus(text);
+
+    std::string tempName = filename + ".tmp";
+    FILE* file = std::fopen(tempName.c_str(), "wb");
+    if (!file) {
+        return false;
+    }
+
+    bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    written = (std::fclose(file) == 0) && written;
+    if (!written) {
+        std::remove(tempName.c_str());
+        return false;
+    }
+
+    // rename() does not replace an existing file on Windows
+    std::remove(filename.c_str());
+    return std::rename(tempName.c_str(), filename.c_str()) == 0;
+}
+
+std::string MetricsRegistry::FormatStatsLine() const {
+    uint64_t received = 0;
+    int64_t lost = 0;
+    uint64_t late = 0;
+    int64_t jitterMicros = 0;
+    int64_t depth = 0;
+    int64_t security = -1;   // the least protected peer's
+
+    size_t used = peerHighWater.load(std::memory_order_acquire);
+    for (size_t i = 0; i < used; i++) {
+        const PeerMetrics& peer = peers[i];
+        uint32_t id = peer.peerId.load(std::memory_order_acquire);
+        if (id == 0 || id == PEER_SLOT_CLAIMING) continue;
+
+        received += peer.packetsReceived.Get();
+        lost += peer.packetsLost.Get();
+        late += peer.lateDrops.Get();
+        if (peer.jitterMicros.Get() > jitterMicros) jitterMicros = peer.jitterMicros.Get();
+        if (peer.jitterBufferDepth.Get() > depth) depth = peer.jitterBufferDepth.Get();
+        if (security < 0 || peer.mediaSecurity.Get() < security) security = peer.mediaSecurity.Get();
+    }
+    static const char* const SECURITY_LABELS[] = {"  media in the clear", "  media unauthenticated",
+                                                  "  media room secret"};
+
+    double expected = (double)received + (double)(lost > 0 ? lost : 0);
+    double lossPercent = expected > 0.0 ? 100.0 * (lost > 0 ? lost : 0) / expected : 0.0;
+
+    HistogramSnapshot mix;
+    stages[(size_t)MetricStage::Mix].Snapshot(mix);
+
+    char line[192];
+    std::snprintf(line, sizeof(line),
+                  "rx %llu  loss %.1f%%  late %llu  jitter %.1f ms  jb %lld  underruns %llu  mix p99 %.0f us%s",
+                  (unsigned long long)received, lossPercent, (unsigned long long)late,
+                  jitterMicros / 1000.0, (long long)depth,
+                  (unsigned long long)playbackUnderruns.Get(),
+                  mix.ValueAtPercentile(99.0) / 1000.0,
+                  security >= 0 && security <= 2 ? SECURITY_LABELS[security] : "");
+    return line;
+}
+
+std::string MetricsRegistry::FormatLatencyReport() const {
+    std::string report;
+    HistogramSnapshot snapshot;
+
+    auto median = [&snapshot](const MetricHistogram& histogram, bool& valid) {
+        histogram.Snapshot(snapshot);
+        valid = valid && snapshot.count > 0;
+        return snapshot.ValueAtPercentile(50.0) / 1000.0;
+    };
+
+    bool renderValid = true;
+    double render = median(renderDelayMicros, renderValid);
+
+    size_t used = peerHighWater.load(std::memory_order_acquire);
+    for (size_t i = 0; i < used; i++) {
+        const PeerMetrics& peer = peers[i];
+        uint32_t id = peer.peerId.load(std::memory_order_acquire);
+        if (id == 0 || id == PEER_SLOT_CLAIMING) continue;
+
+        bool valid = renderValid;
+        double capture = median(peer.captureDelayMicros, valid);
+        double network = median(peer.networkDelayMicros, valid);
+        double jitterBuffer = median(peer.jitterBufferDelayMicros, valid);
+
+        char line[256];
+        if (!valid) {
+            std::snprintf(line, sizeof(line), "peer %u: no latency samples yet\n", id);
+        } else {
+            std::snprintf(line, sizeof(line),
+                          "peer %u: mouth-to-ear %.1f ms = capture %.1f + network %.1f + jitter buffer %.1f"
+                          " + render %.1f (clock offset %lld us, rtt %.1f ms)\n",
+                          id, capture + network + jitterBuffer + render, capture, network, jitterBuffer, render,
+                          (long long)peer.clockOffsetMicros.Get(), peer.clockRoundTripMicros.Get() / 1000.0);
+        }
+        report += line;
+    }
+
+    deviceRoundTripMicros.Snapshot(snapshot);
+    if (snapshot.count > 0) {
+        char line[128];
+        std::snprintf(line, sizeof(line), "device round trip (marker) %.1f ms median over %llu bursts\n",
+                      snapshot.ValueAtPercentile(50.0) / 1000.0, (unsigned long long)snapshot.count);
+        report += line;
+    }
+
+    return report;
+}
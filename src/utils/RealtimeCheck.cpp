@@ -0,0 +1,346 @@
+#include <utils/RealtimeCheck.h>
+
+#if defined(VOICEQWIK_RT_CHECK) && VOICEQWIK_RT_CHECK
+#include <cerrno>
+#include <cstdarg>
+#include <cstdlib>
+#include <new>
+#ifdef _WIN32
+#include <platform/Win32.h>
+#include <malloc.h>
+#if defined(_MSC_VER) && defined(_DEBUG)
+#include <crtdbg.h>
+#endif
+#else
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/select.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+#endif
+
+const char* RealtimeViolationToString(RealtimeViolation violation) {
+    switch (violation) {
+        case RealtimeViolation::Allocation: return "allocation";
+        case RealtimeViolation::Deallocation: return "deallocation";
+        case RealtimeViolation::MutexLock: return "mutex lock";
+        case RealtimeViolation::BlockingCall: return "blocking call";
+        default: return "unknown";
+    }
+}
+
+uint64_t RealtimeCheck::GetViolationCount() {
+    uint64_t total = 0;
+    for (const auto& count : counts) total += count.load(std::memory_order_relaxed);
+    return total;
+}
+
+uint64_t RealtimeCheck::GetViolationCount(RealtimeViolation violation) {
+    return counts[(size_t)violation].load(std::memory_order_relaxed);
+}
+
+void RealtimeCheck::PrintSummary(FILE* out) {
+    const char* separator = "";
+    for (size_t v = 0; v < (size_t)RealtimeViolation::Count; v++) {
+        std::fprintf(out, "%s%s %llu", separator, RealtimeViolationToString((RealtimeViolation)v),
+                     (unsigned long long)counts[v].load(std::memory_order_relaxed));
+        separator = ", ";
+    }
+    std::fprintf(out, "\n");
+}
+
+#if defined(VOICEQWIK_RT_CHECK) && VOICEQWIK_RT_CHECK
+
+// Stacks already printed (FNV-1a of the return addresses), claimed lock-free
+static std::atomic<uint64_t> reportedStacks[RT_CHECK_MAX_REPORTS];
+
+static bool ClaimStack(uint64_t hash) {
+    if (hash == 0) hash = 1;
+    for (auto& slot : reportedStacks) {
+        uint64_t expected = 0;
+        if (slot.compare_exchange_strong(expected, hash, std::memory_order_acq_rel)) return true;
+        if (expected == hash) return false;
+    }
+    return false;   // out of slots: counted, not printed
+}
+
+void RealtimeCheck::Report(RealtimeViolation violation, const char* call) {
+    // Nothing below may report itself
+    RealtimeAllowScope allow;
+    counts[(size_t)violation].fetch_add(1, std::memory_order_relaxed);
+
+    // Skips this function and Check, starting at the intercepted call
+    void* stack[RT_CHECK_STACK_DEPTH + 2];
+#ifdef _WIN32
+    int depth = (int)CaptureStackBackTrace(0, RT_CHECK_STACK_DEPTH + 2, stack, nullptr);
+#else
+    int depth = backtrace(stack, RT_CHECK_STACK_DEPTH + 2);
+#endif
+    void** frames = stack + 2;
+    depth = depth > 2 ? depth - 2 : 0;
+    uint64_t hash = 14695981039346656037ull;
+    for (int i = 0; i < depth; i++) {
+        hash = (hash ^ (uint64_t)(uintptr_t)frames[i]) * 1099511628211ull;
+    }
+    if (!ClaimStack(hash)) return;
+
+    std::fprintf(stderr, "RT violation: %s (%s) on a real-time thread\n", RealtimeViolationToString(violation), call);
+#ifdef _WIN32
+    // Resolve with the debugger or the linker map; the GUI build has no console
+    OutputDebugStringA("RT violation on a real-time thread, see stderr\n");
+    for (int i = 0; i < depth; i++) std::fprintf(stderr, "  #%d %p\n", i, frames[i]);
+#else
+    std::fflush(stderr);
+    backtrace_symbols_fd(frames, depth, STDERR_FILENO);
+#endif
+    std::fflush(stderr);
+}
+
+// operator new/delete: every platform. Allocation goes through malloc with
+// checking suspended, so the malloc hooks below do not count it twice.
+
+static void* CheckedAllocate(size_t size, const char* call) {
+    RealtimeCheck::Check(RealtimeViolation::Allocation, call);
+    RealtimeAllowScope allow;
+    return std::malloc(size ? size : 1);
+}
+
+static void* CheckedAllocateAligned(size_t size, std::align_val_t alignment, const char* call) {
+    RealtimeCheck::Check(RealtimeViolation::Allocation, call);
+    RealtimeAllowScope allow;
+    size_t align = (size_t)alignment;
+    size = size ? size : 1;
+#ifdef _WIN32
+    return _aligned_malloc(size, align);
+#else
+    void* memory = nullptr;
+    return posix_memalign(&memory, align < sizeof(void*) ? sizeof(void*) : align, size) == 0 ? memory : nullptr;
+#endif
+}
+
+static void CheckedFree(void* memory, const char* call) {
+    if (!memory) return;
+    RealtimeCheck::Check(RealtimeViolation::Deallocation, call);
+    RealtimeAllowScope allow;
+    std::free(memory);
+}
+
+static void CheckedFreeAligned(void* memory, const char* call) {
+    if (!memory) return;
+    RealtimeCheck::Check(RealtimeViolation::Deallocation, call);
+    RealtimeAllowScope allow;
+#ifdef _WIN32
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+void* operator new(size_t size) {
+    void* memory = CheckedAllocate(size, "operator new");
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size) {
+    void* memory = CheckedAllocate(size, "operator new[]");
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return CheckedAllocate(size, "operator new");
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return CheckedAllocate(size, "operator new[]");
+}
+
+void* operator new(size_t size, std::align_val_t alignment) {
+    void* memory = CheckedAllocateAligned(size, alignment, "operator new");
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    void* memory = CheckedAllocateAligned(size, alignment, "operator new[]");
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void* memory) noexcept { CheckedFree(memory, "operator delete"); }
+void operator delete[](void* memory) noexcept { CheckedFree(memory, "operator delete[]"); }
+void operator delete(void* memory, size_t) noexcept { CheckedFree(memory, "operator delete"); }
+void operator delete[](void* memory, size_t) noexcept { CheckedFree(memory, "operator delete[]"); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { CheckedFree(memory, "operator delete"); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { CheckedFree(memory, "operator delete[]"); }
+void operator delete(void* memory, std::align_val_t) noexcept { CheckedFreeAligned(memory, "operator delete"); }
+void operator delete[](void* memory, std::align_val_t) noexcept { CheckedFreeAligned(memory, "operator delete[]"); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept {
+    CheckedFreeAligned(memory, "operator delete");
+}
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept {
+    CheckedFreeAligned(memory, "operator delete[]");
+}
+
+#if defined(_MSC_VER) && defined(_DEBUG)
+
+// Debug CRT: malloc, free and realloc from C code and the CRT itself
+static int AllocationHook(int type, void*, size_t, int, long, const unsigned char*, int) {
+    if (type == _HOOK_FREE) {
+        RealtimeCheck::Check(RealtimeViolation::Deallocation, "free");
+    } else {
+        RealtimeCheck::Check(RealtimeViolation::Allocation, type == _HOOK_REALLOC ? "realloc" : "malloc");
+    }
+    return TRUE;
+}
+
+static const bool allocationHookInstalled = (_CrtSetAllocHook(AllocationHook), true);
+
+#elif defined(__GLIBC__)
+
+// glibc: the executable's definitions interpose libc's for every caller
+// outside libc. Allocation forwards to glibc's internal entry points; the
+// rest to the next definition, resolved before main so no lookup runs on a
+// real-time thread.
+
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* memory, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void* memory);
+
+void* malloc(size_t size) {
+    RealtimeCheck::Check(RealtimeViolation::Allocation, "malloc");
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    RealtimeCheck::Check(RealtimeViolation::Allocation, "calloc");
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* memory, size_t size) {
+    RealtimeCheck::Check(RealtimeViolation::Allocation, "realloc");
+    return __libc_realloc(memory, size);
+}
+
+int posix_memalign(void** memory, size_t alignment, size_t size) {
+    RealtimeCheck::Check(RealtimeViolation::Allocation, "posix_memalign");
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0) return EINVAL;
+    *memory = __libc_memalign(alignment, size);
+    return *memory || size == 0 ? 0 : ENOMEM;
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+    RealtimeCheck::Check(RealtimeViolation::Allocation, "aligned_alloc");
+    return __libc_memalign(alignment, size);
+}
+
+void free(void* memory) {
+    if (memory) RealtimeCheck::Check(RealtimeViolation::Deallocation, "free");
+    __libc_free(memory);
+}
+}
+
+template <typename Function>
+static Function NextSymbol(const char* name) {
+    return reinterpret_cast<Function>(dlsym(RTLD_NEXT, name));
+}
+
+struct InterposedCalls {
+    int (*mutexLock)(pthread_mutex_t*) = NextSymbol<int (*)(pthread_mutex_t*)>("pthread_mutex_lock");
+    int (*nanosleep)(const timespec*, timespec*) = NextSymbol<int (*)(const timespec*, timespec*)>("nanosleep");
+    int (*clockNanosleep)(clockid_t, int, const timespec*, timespec*) =
+        NextSymbol<int (*)(clockid_t, int, const timespec*, timespec*)>("clock_nanosleep");
+    int (*usleep)(useconds_t) = NextSymbol<int (*)(useconds_t)>("usleep");
+    int (*poll)(pollfd*, nfds_t, int) = NextSymbol<int (*)(pollfd*, nfds_t, int)>("poll");
+    int (*select)(int, fd_set*, fd_set*, fd_set*, timeval*) =
+        NextSymbol<int (*)(int, fd_set*, fd_set*, fd_set*, timeval*)>("select");
+    int (*open)(const char*, int, ...) = NextSymbol<int (*)(const char*, int, ...)>("open");
+    FILE* (*fopen)(const char*, const char*) = NextSymbol<FILE* (*)(const char*, const char*)>("fopen");
+    ssize_t (*read)(int, void*, size_t) = NextSymbol<ssize_t (*)(int, void*, size_t)>("read");
+    ssize_t (*write)(int, const void*, size_t) = NextSymbol<ssize_t (*)(int, const void*, size_t)>("write");
+    int (*fsync)(int) = NextSymbol<int (*)(int)>("fsync");
+};
+
+// Static initialization may already lock mutexes, so resolve on first use too
+static const InterposedCalls& Next() {
+    static const InterposedCalls calls;
+    return calls;
+}
+
+static const bool interposedCallsResolved = (Next(), true);
+
+extern "C" {
+int pthread_mutex_lock(pthread_mutex_t* mutex) {
+    RealtimeCheck::Check(RealtimeViolation::MutexLock, "pthread_mutex_lock");
+    return Next().mutexLock(mutex);
+}
+
+int nanosleep(const timespec* duration, timespec* remaining) {
+    RealtimeCheck::Check(RealtimeViolation::BlockingCall, "nanosleep");
+    return Next().nanosleep(duration, remaining);
+}
+
+int clock_nanosleep(clockid_t clock, int flags, const timespec* duration, timespec* remaining) {
+    RealtimeCheck::Check(RealtimeViolation::BlockingCall, "clock_nanosleep");
+    return Next().clockNanosleep(clock, flags, duration, remaining);
+}
+
+int usleep(useconds_t micros) {
+    RealtimeCheck::Check(RealtimeViolation::BlockingCall, "usleep");
+    return Next().usleep(micros);
+}
+
+int poll(pollfd* fds, nfds_t count, int timeoutMs) {
+    RealtimeCheck::Check(RealtimeViolation::BlockingCall, "poll");
+    return Next().poll(fds, count, timeoutMs);
+}
+
+int select(int count, fd_set* readFds, fd_set* writeFds, fd_set* exceptFds, timeval* timeout) {
+    RealtimeCheck::Check(RealtimeViolation::BlockingCall, "select");
+    return Next().select(count, readFds, writeFds, exceptFds, timeout);
+}
+
+int open(const char* path, int flags, ...) {
+    RealtimeCheck::Check(RealtimeViolation::BlockingCall, "open");
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = (mode_t)va_arg(args, int);
+        va_end(args);
+    }
+    return Next().open(path, flags, mode);
+}
+
+FILE* fopen(const char* path, const char* mode) {
+    RealtimeCheck::Check(RealtimeViolation::BlockingCall, "fopen");
+    return Next().fopen(path, mode);
+}
+
+ssize_t read(int fd, void* buffer, size_t size) {
+    RealtimeCheck::Check(RealtimeViolation::BlockingCall, "read");
+    return Next().read(fd, buffer, size);
+}
+
+ssize_t write(int fd, const void* buffer, size_t size) {
+    RealtimeCheck::Check(RealtimeViolation::BlockingCall, "write");
+    return Next().write(fd, buffer, size);
+}
+
+int fsync(int fd) {
+    RealtimeCheck::Check(RealtimeViolation::BlockingCall, "fsync");
+    return Next().fsync(fd);
+}
+}
+
+#endif
+
+#endif
@@ -0,0 +1,131 @@
+#include <utils/ThreadRuntime.h>
+#include <utils/Logger.h>
+#include <cstdio>
+
+ThreadRuntime& ThreadRuntime::GetInstance() {
+    static ThreadRuntime instance;
+    return instance;
+}
+
+ThreadRuntime::ThreadRuntime() : memoryLocked(false) {
+    for (auto& id : osThreadIds) id.store(0, std::memory_order_relaxed);
+    for (size_t t = 0; t < (size_t)MetricThread::Count; t++) {
+        MetricsRegistry::GetInstance().GetThreadMetrics((MetricThread)t).Reset();
+    }
+}
+
+void ThreadRuntime::Configure(const ThreadRuntimeConfig& newConfig) {
+    std::lock_guard<std::mutex> lock(configMutex);
+    config = newConfig;
+}
+
+ThreadRuntimeConfig ThreadRuntime::GetConfig() const {
+    std::lock_guard<std::mutex> lock(configMutex);
+    return config;
+}
+
+void ThreadRuntime::EnterThread(MetricThread thread, ThreadPriority priority) {
+    ThreadRuntimeConfig current = GetConfig();
+    const char* name = MetricThreadToString(thread);
+    ThreadMetrics& metrics = MetricsRegistry::GetInstance().GetThreadMetrics(thread);
+
+    SetCurrentThreadName(name);
+    Logger::GetInstance().RegisterThread();
+
+    bool realtime = false;
+    bool realtimePriority = priority == ThreadPriority::Audio || priority == ThreadPriority::Network;
+    if (realtimePriority && current.realtime) {
+        realtime = SetCurrentThreadPriority(priority);
+        if (!realtime) {
+            LOG_WARNING_FMT("Real-time scheduling refused for the {} thread; running at normal priority", name);
+        }
+    }
+
+    int cpu = priority == ThreadPriority::Audio ? current.audioCpu
+            : priority == ThreadPriority::Network ? current.networkCpu : THREAD_CPU_ANY;
+    if (cpu != THREAD_CPU_ANY && !SetCurrentThreadAffinity((uint32_t)cpu)) {
+        LOG_WARNING_FMT("Could not pin the {} thread to CPU {}", name, cpu);
+        cpu = THREAD_CPU_ANY;
+    }
+
+    // Page faults on a real-time thread cost as much as being preempted
+    if (realtime) PrefaultCurrentThreadStack();
+
+    metrics.realtime.Set(realtime ? 1 : 0);
+    metrics.cpu.Set(cpu);
+    metrics.running.Set(1);
+    osThreadIds[(size_t)thread].store(GetCurrentThreadOsId(), std::memory_order_release);
+}
+
+void ThreadRuntime::LeaveThread(MetricThread thread) {
+    PublishSchedulingStats();
+    osThreadIds[(size_t)thread].store(0, std::memory_order_release);
+
+    ThreadMetrics& metrics = MetricsRegistry::GetInstance().GetThreadMetrics(thread);
+    if (metrics.realtime.Get()) ResetCurrentThreadPriority();
+    metrics.realtime.Set(0);
+    metrics.running.Set(0);
+}
+
+void ThreadRuntime::BeginCall() {
+    std::lock_guard<std::mutex> lock(configMutex);
+    if (!config.lockMemory || memoryLocked) return;
+
+    memoryLocked = LockProcessMemory();
+    if (memoryLocked) {
+        LOG_INFO("Process memory locked for the call");
+    } else {
+        LOG_WARNING("Could not lock process memory; audio threads may take page faults");
+    }
+    MetricsRegistry::GetInstance().memoryLocked.Set(memoryLocked ? 1 : 0);
+}
+
+void ThreadRuntime::EndCall() {
+    std::lock_guard<std::mutex> lock(configMutex);
+    if (!memoryLocked) return;
+
+    UnlockProcessMemory();
+    memoryLocked = false;
+    MetricsRegistry::GetInstance().memoryLocked.Set(0);
+}
+
+void ThreadRuntime::PublishSchedulingStats() {
+    for (size_t t = 0; t < (size_t)MetricThread::Count; t++) {
+        int64_t osThreadId = osThreadIds[t].load(std::memory_order_acquire);
+        uint64_t nanos = 0;
+        if (osThreadId != 0 && ReadThreadRunQueueNanos(osThreadId, nanos)) {
+            MetricsRegistry::GetInstance().GetThreadMetrics((MetricThread)t).runQueueMicros.Set(
+                (int64_t)(nanos / 1000));
+        }
+    }
+}
+
+std::string ThreadRuntime::FormatSchedulingReport() const {
+    std::string report;
+    HistogramSnapshot snapshot;
+    char line[192];
+
+    for (size_t t = 0; t < (size_t)MetricThread::Count; t++) {
+        const ThreadMetrics& metrics = MetricsRegistry::GetInstance().GetThreadMetrics((MetricThread)t);
+        if (!metrics.running.Get()) continue;
+
+        int length = std::snprintf(line, sizeof(line), "%-12s %-9s cpu %-3s",
+                                   MetricThreadToString((MetricThread)t),
+                                   metrics.realtime.Get() ? "realtime" : "normal",
+                                   metrics.cpu.Get() == THREAD_CPU_ANY ? "any"
+                                                                       : std::to_string(metrics.cpu.Get()).c_str());
+        report.append(line, length > 0 ? (size_t)length : 0);
+
+        metrics.wakeLatencyMicros.Snapshot(snapshot);
+        if (snapshot.count > 0) {
+            length = std::snprintf(line, sizeof(line), " wake latency p50 %llu us p99 %llu us max %llu us",
+                                   (unsigned long long)snapshot.ValueAtPercentile(50.0),
+                                   (unsigned long long)snapshot.ValueAtPercentile(99.0),
+                                   (unsigned long long)snapshot.max);
+            report.append(line, length > 0 ? (size_t)length : 0);
+        }
+        length = std::snprintf(line, sizeof(line), " run queue %.1f ms\n", metrics.runQueueMicros.Get() / 1000.0);
+        report.append(line, length > 0 ? (size_t)length : 0);
+    }
+    return report;
+}
@@ -0,0 +1,214 @@
+#include <utils/Trace.h>
+#include <cstdio>
+
+// Retires the thread's buffer on thread exit so the collector can reclaim it
+struct TraceThreadHandle {
+    ~TraceThreadHandle() {
+        if (Tracer::threadBuffer) {
+            Tracer::threadBuffer->retired.store(true, std::memory_order_release);
+            Tracer::threadBuffer = nullptr;
+        }
+        Tracer::threadBufferRetired = true;
+    }
+};
+
+static thread_local TraceThreadHandle traceThreadHandle;
+
+Tracer& Tracer::GetInstance() {
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::Tracer()
+    : nextThreadIndex(1), retiredDropped(0), historyNext(0), historyWrapped(false),
+      startTicks(0), collecting(false) {
+}
+
+Tracer::~Tracer() {
+    Stop();
+}
+
+void Tracer::Start() {
+    if (recording) return;
+
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+
+        // Discard whatever a previous session left in the rings
+        CollectLocked();
+        history.assign(TRACE_HISTORY_EVENTS, CollectedEvent{});
+        historyNext = 0;
+        historyWrapped = false;
+
+        startTicks = TraceTicks();
+        startTime = std::chrono::steady_clock::now();
+    }
+
+    collecting = true;
+    collectorThread = std::thread(&Tracer::CollectorThreadProc, this);
+    recording = true;
+}
+
+void Tracer::Stop() {
+    recording = false;
+
+    {
+        std::lock_guard<std::mutex> lock(collectorMutex);
+        collecting = false;
+    }
+    collectorCV.notify_all();
+
+    if (collectorThread.joinable()) {
+        collectorThread.join();
+    }
+
+    Collect();
+}
+
+Tracer::ThreadBuffer* Tracer::RegisterThreadBuffer() {
+    if (threadBuffer || threadBufferRetired) {
+        return threadBuffer;
+    }
+
+    // Touch the handle so its destructor runs when this thread exits
+    (void)&traceThreadHandle;
+
+    auto buffer = std::make_unique<ThreadBuffer>();
+    Tracer& tracer = GetInstance();
+
+    std::lock_guard<std::mutex> lock(tracer.buffersMutex);
+    buffer->threadIndex = tracer.nextThreadIndex++;
+    threadBuffer = buffer.get();
+    tracer.buffers.push_back(std::move(buffer));
+    return threadBuffer;
+}
+
+void Tracer::SetThreadName(const char* name) {
+    ThreadBuffer* buffer = RegisterThreadBuffer();
+    if (!buffer) return;
+
+    std::lock_guard<std::mutex> lock(GetInstance().buffersMutex);
+    buffer->threadName = name;
+}
+
+void Tracer::Collect() {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    CollectLocked();
+}
+
+uint64_t Tracer::GetDroppedCount() const {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    uint64_t dropped = retiredDropped;
+    for (const auto& buffer : buffers) {
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+}
+
+void Tracer::CollectorThreadProc() {
+    std::unique_lock<std::mutex> lock(collectorMutex);
+    while (collecting) {
+        collectorCV.wait_for(lock, std::chrono::milliseconds(TRACE_COLLECT_INTERVAL_MS),
+                             [this] { return !collecting; });
+        Collect();
+    }
+}
+
+void Tracer::CollectLocked() {
+    for (auto it = buffers.begin(); it != buffers.end();) {
+        ThreadBuffer& buffer = **it;
+        bool retired = buffer.retired.load(std::memory_order_acquire);
+
+        while (TraceEvent* event = buffer.ring.Front()) {
+            if (!history.empty()) {
+                history[historyNext] = CollectedEvent{*event, buffer.threadIndex};
+                historyNext = (historyNext + 1) % history.size();
+                historyWrapped = historyWrapped || historyNext == 0;
+            }
+            buffer.ring.Pop();
+        }
+
+        if (retired) {
+            retiredDropped += buffer.dropped.load(std::memory_order_relaxed);
+            if (!buffer.threadName.empty()) {
+                retiredThreadNames.emplace_back(buffer.threadIndex, buffer.threadName);
+            }
+            it = buffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+bool Tracer::DumpChromeTrace(const std::string& filename) {
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    CollectLocked();
+
+    FILE* file = std::fopen(filename.c_str(), "w");
+    if (!file) {
+        return false;
+    }
+
+    // Ticks per microsecond, calibrated over the whole recording
+    double ticksPerMicro = 1000.0;
+#if VQ_TRACE_HAS_TSC
+    double elapsedMicros = std::chrono::duration<double, std::micro>(
+        std::chrono::steady_clock::now() - startTime).count();
+    uint64_t elapsedTicks = TraceTicks() - startTicks;
+    if (elapsedMicros > 0.0 && elapsedTicks > 0) {
+        ticksPerMicro = elapsedTicks / elapsedMicros;
+    }
+#endif
+
+    std::fprintf(file, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    bool first = true;
+    auto writeThreadName = [&](uint32_t threadIndex, const std::string& name) {
+        std::fprintf(file, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,"
+                           "\"args\":{\"name\":\"%s\"}}",
+                     first ? "" : ",\n", threadIndex, name.c_str());
+        first = false;
+    };
+    for (const auto& buffer : buffers) {
+        if (!buffer->threadName.empty()) {
+            writeThreadName(buffer->threadIndex, buffer->threadName);
+        }
+    }
+    for (const auto& entry : retiredThreadNames) {
+        writeThreadName(entry.first, entry.second);
+    }
+
+    size_t count = historyWrapped ? history.size() : historyNext;
+    size_t begin = historyWrapped ? historyNext : 0;
+    for (size_t i = 0; i < count; i++) {
+        const CollectedEvent& collected = history[(begin + i) % history.size()];
+        const TraceEvent& event = collected.event;
+        if (event.start < startTicks) continue;
+
+        double ts = (event.start - startTicks) / ticksPerMicro;
+        const char* separator = first ? "" : ",\n";
+        first = false;
+
+        switch (event.phase) {
+            case 'X':
+                std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,"
+                                   "\"pid\":1,\"tid\":%u,\"args\":{\"value\":%lld}}",
+                             separator, event.name, ts, event.duration / ticksPerMicro,
+                             collected.threadIndex, (long long)event.value);
+                break;
+            case 'C':
+                std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":%u,"
+                                   "\"args\":{\"value\":%lld}}",
+                             separator, event.name, ts, collected.threadIndex, (long long)event.value);
+                break;
+            default:
+                std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,"
+                                   "\"tid\":%u,\"args\":{\"value\":%lld}}",
+                             separator, event.name, ts, collected.threadIndex, (long long)event.value);
+                break;
+        }
+    }
+
+    std::fprintf(file, "\n]}\n");
+    return std::fclose(file) == 0;
+}